@@ -22,13 +22,219 @@
 #include "vtkSlicerApplicationLogic.h"
 #include "vtkMRMLCoreTestingMacros.h"
 #include "vtkSlicerConfigure.h"
+#include "vtkSlicerTask.h"
 
 // Slicer MRML includes
+#include "vtkMRMLAbstractLogic.h"
 #include "vtkMRMLScene.h"
 #include "vtkMRMLModelHierarchyNode.h"
 
 // VTK includes
 #include <vtkNew.h>
+#include <vtkObjectFactory.h>
+
+// ITK includes
+#include <itkMutexLock.h>
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Logic whose tasks record their start and wait until they are released
+class vtkTestTaskLogic : public vtkMRMLAbstractLogic
+{
+public:
+  static vtkTestTaskLogic* New();
+  vtkTypeMacro(vtkTestTaskLogic, vtkMRMLAbstractLogic);
+
+  void Run(void* clientData)
+  {
+    this->Lock->Lock();
+    this->StartedTasks.push_back(*static_cast<int*>(clientData));
+    this->Lock->Unlock();
+    while (!this->IsReleased())
+      {
+      itksys::SystemTools::Delay(10);
+      }
+  }
+
+  void Release()
+  {
+    this->Lock->Lock();
+    this->Released = true;
+    this->Lock->Unlock();
+  }
+
+  bool IsReleased()
+  {
+    this->Lock->Lock();
+    bool released = this->Released;
+    this->Lock->Unlock();
+    return released;
+  }
+
+  std::vector<int> GetStartedTasks()
+  {
+    this->Lock->Lock();
+    std::vector<int> startedTasks = this->StartedTasks;
+    this->Lock->Unlock();
+    return startedTasks;
+  }
+
+protected:
+  vtkTestTaskLogic()
+  {
+    this->Lock = itk::MutexLock::New();
+    this->Released = false;
+  }
+
+  itk::MutexLock::Pointer Lock;
+  bool Released;
+  std::vector<int> StartedTasks;
+};
+
+vtkStandardNewMacro(vtkTestTaskLogic);
+
+// Identifiers passed to the tasks
+int TaskIDs[] = {0, 1, 2, 3};
+
+//-----------------------------------------------------------------------------
+void scheduleTestTask(vtkSlicerApplicationLogic* appLogic, vtkTestTaskLogic* logic,
+                      int taskIndex, int priority = 0, int numberOfThreads = 1, vtkIdType memorySize = 0)
+{
+  vtkNew<vtkSlicerTask> task;
+  task->SetTypeToProcessing();
+  task->SetTaskFunction(logic, static_cast<vtkSlicerTask::TaskFunctionPointer>(&vtkTestTaskLogic::Run),
+                        &TaskIDs[taskIndex]);
+  task->SetPriority(priority);
+  task->SetNumberOfThreads(numberOfThreads);
+  task->SetMemorySize(memorySize);
+  appLogic->ScheduleTask(task.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+// Wait (at most 10s) for the number of running tasks to reach the expected
+// value, then check it does not change while the others wait for resources.
+int checkNumberOfRunningTasks(vtkSlicerApplicationLogic* appLogic, int expected)
+{
+  for (int i = 0; i < 1000 && appLogic->GetNumberOfRunningTasks() < expected; ++i)
+    {
+    itksys::SystemTools::Delay(10);
+    }
+  // leave time to the processing threads to (wrongly) start more tasks
+  itksys::SystemTools::Delay(500);
+  CHECK_INT(appLogic->GetNumberOfRunningTasks(), expected);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int waitForCompletedTasks(vtkSlicerApplicationLogic* appLogic, int expected)
+{
+  for (int i = 0; i < 1000 && appLogic->GetNumberOfCompletedTasks() < expected; ++i)
+    {
+    itksys::SystemTools::Delay(10);
+    }
+  CHECK_INT(appLogic->GetNumberOfCompletedTasks(), expected);
+  CHECK_INT(appLogic->GetNumberOfRunningTasks(), 0);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testProcessingTaskPriority()
+{
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  appLogic->CreateProcessingThread();
+  vtkNew<vtkTestTaskLogic> logic;
+
+  // the first task occupies the only processing thread while the others
+  // are scheduled
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 0);
+  CHECK_EXIT_SUCCESS(checkNumberOfRunningTasks(appLogic.GetPointer(), 1));
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 1, 0);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 2, 2);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 3, 1);
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(), 3);
+
+  logic->Release();
+  CHECK_EXIT_SUCCESS(waitForCompletedTasks(appLogic.GetPointer(), 4));
+  std::vector<int> startedTasks = logic->GetStartedTasks();
+  CHECK_INT(static_cast<int>(startedTasks.size()), 4);
+  CHECK_INT(startedTasks[0], 0);
+  CHECK_INT(startedTasks[1], 2);
+  CHECK_INT(startedTasks[2], 3);
+  CHECK_INT(startedTasks[3], 1);
+
+  appLogic->TerminateProcessingThread();
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testProcessingTaskLimits()
+{
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  appLogic->CreateProcessingThread();
+
+  // Only one thread of the processing threader is left for networking
+  appLogic->SetMaximumNumberOfProcessingTasks(ITK_MAX_THREADS + 10);
+  CHECK_INT(appLogic->GetMaximumNumberOfProcessingTasks(), ITK_MAX_THREADS - 1);
+  appLogic->SetMaximumNumberOfProcessingTasks(0);
+  CHECK_INT(appLogic->GetMaximumNumberOfProcessingTasks(), 1);
+
+  appLogic->SetMaximumNumberOfProcessingTaskThreads(100);
+  appLogic->SetMaximumProcessingTaskMemorySize(0);
+  CHECK_INT(appLogic->GetMaximumProcessingTaskMemorySize(), 0);
+
+  // Number of concurrent tasks
+  {
+  vtkNew<vtkTestTaskLogic> logic;
+  appLogic->SetMaximumNumberOfProcessingTasks(2);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 0);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 1);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 2);
+  CHECK_EXIT_SUCCESS(checkNumberOfRunningTasks(appLogic.GetPointer(), 2));
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(), 1);
+  logic->Release();
+  CHECK_EXIT_SUCCESS(waitForCompletedTasks(appLogic.GetPointer(), 3));
+  }
+
+  appLogic->SetMaximumNumberOfProcessingTasks(3);
+
+  // Number of threads: a task exceeding the limit runs, but alone
+  {
+  vtkNew<vtkTestTaskLogic> logic;
+  appLogic->SetMaximumNumberOfProcessingTaskThreads(2);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 0, 0, 3);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 1, 0, 1);
+  CHECK_EXIT_SUCCESS(checkNumberOfRunningTasks(appLogic.GetPointer(), 1));
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(), 1);
+  logic->Release();
+  CHECK_EXIT_SUCCESS(waitForCompletedTasks(appLogic.GetPointer(), 5));
+  }
+  appLogic->SetMaximumNumberOfProcessingTaskThreads(100);
+
+  // Memory
+  {
+  vtkNew<vtkTestTaskLogic> logic;
+  const vtkIdType megabyte = 1024 * 1024;
+  appLogic->SetMaximumProcessingTaskMemorySize(100 * megabyte);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 0, 0, 1, 60 * megabyte);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 1, 0, 1, 30 * megabyte);
+  scheduleTestTask(appLogic.GetPointer(), logic.GetPointer(), 2, 0, 1, 30 * megabyte);
+  CHECK_EXIT_SUCCESS(checkNumberOfRunningTasks(appLogic.GetPointer(), 2));
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(), 1);
+  logic->Release();
+  CHECK_EXIT_SUCCESS(waitForCompletedTasks(appLogic.GetPointer(), 8));
+  }
+
+  appLogic->TerminateProcessingThread();
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
 
 //-----------------------------------------------------------------------------
 int vtkSlicerApplicationLogicTest1(int , char * [])
@@ -343,6 +549,12 @@ int vtkSlicerApplicationLogicTest1(int , char * [])
     }
   }
 
+  //-----------------------------------------------------------------------------
+  // Test ScheduleTask(vtkSlicerTask* task) priorities and resource limits
+  //-----------------------------------------------------------------------------
+  CHECK_EXIT_SUCCESS(testProcessingTaskPriority());
+  CHECK_EXIT_SUCCESS(testProcessingTaskLimits());
+
   return EXIT_SUCCESS;
 }
 
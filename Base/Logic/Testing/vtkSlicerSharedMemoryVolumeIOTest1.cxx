@@ -0,0 +1,150 @@
+/*=========================================================================
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+
+// Slicer includes
+#include "vtkSlicerSharedMemoryVolumeIO.h"
+#include "vtkMRMLCoreTestingMacros.h"
+
+// ITKFactoryRegistration includes
+#include <itkSharedMemoryImageIO.h>
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+
+// ITK includes
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <sstream>
+
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSharedMemoryVolumeIOTest1(int , char * [])
+{
+  if (!vtkSlicerSharedMemoryVolumeIO::IsSupported())
+    {
+    std::cout << "Shared memory is not supported on this platform, test skipped" << std::endl;
+    return EXIT_SUCCESS;
+    }
+
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName("shm:/name"), true);
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName("shm:/"), false);
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName("/tmp/name.nrrd"), false);
+
+  std::ostringstream fileNameStream;
+#ifndef _WIN32
+  fileNameStream << "shm:/vtkSlicerSharedMemoryVolumeIOTest1_" << getpid();
+#endif
+  std::string fileName = fileNameStream.str();
+  vtkSlicerSharedMemoryVolumeIO::RemoveVolume(fileName.c_str());
+
+  // Non-symmetric direction matrix (axis i is the i-th column) and
+  // different dimensions along each axis, so that a transposition of the
+  // geometry cannot go unnoticed.
+  const int dimensions[3] = {2, 3, 4};
+  const double spacing[3] = {0.5, 1.5, 2.5};
+  const double origin[3] = {10., -20., 30.};
+  double directions[3][3] = {{0., 0., 1.},
+                             {1., 0., 0.},
+                             {0., 1., 0.}};
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short* scalars = static_cast<short*>(imageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < imageData->GetNumberOfPoints(); ++i)
+    {
+    scalars[i] = static_cast<short>(i * 3 - 7);
+    }
+
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetSpacing(spacing[0], spacing[1], spacing[2]);
+  volumeNode->SetOrigin(origin[0], origin[1], origin[2]);
+  volumeNode->SetIJKToRASDirections(directions);
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::WriteVolume(volumeNode.GetPointer(), fileName.c_str()), true);
+  // Objects are created exclusively
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::WriteVolume(volumeNode.GetPointer(), fileName.c_str()), false);
+
+  // Read back with ITK: geometry must be the LPS equivalent of the volume
+  typedef itk::Image<short, 3> ImageType;
+  typedef itk::ImageFileReader<ImageType> ReaderType;
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetImageIO(itk::SharedMemoryImageIO::New());
+  reader->SetFileName(fileName);
+  TRY_EXPECT_NO_ITK_EXCEPTION(reader->Update());
+  ImageType::Pointer image = reader->GetOutput();
+
+  for (int i = 0; i < 3; ++i)
+    {
+    const double lpsFlip = (i < 2 ? -1. : 1.);
+    CHECK_INT(static_cast<int>(image->GetLargestPossibleRegion().GetSize()[i]), dimensions[i]);
+    CHECK_DOUBLE(image->GetSpacing()[i], spacing[i]);
+    CHECK_DOUBLE(image->GetOrigin()[i], lpsFlip * origin[i]);
+    for (int j = 0; j < 3; ++j)
+      {
+      CHECK_DOUBLE(image->GetDirection()[i][j], lpsFlip * directions[i][j]);
+      }
+    }
+
+  // The physical position of the last voxel must match the volume node
+  ImageType::IndexType lastIndex;
+  lastIndex[0] = dimensions[0] - 1;
+  lastIndex[1] = dimensions[1] - 1;
+  lastIndex[2] = dimensions[2] - 1;
+  ImageType::PointType lastPointLPS;
+  image->TransformIndexToPhysicalPoint(lastIndex, lastPointLPS);
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  volumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  const double lastIJK[4] = {dimensions[0] - 1., dimensions[1] - 1., dimensions[2] - 1., 1.};
+  double lastPointRAS[4] = {0., 0., 0., 1.};
+  ijkToRAS->MultiplyPoint(lastIJK, lastPointRAS);
+  CHECK_DOUBLE_TOLERANCE(lastPointLPS[0], -lastPointRAS[0], 1e-9);
+  CHECK_DOUBLE_TOLERANCE(lastPointLPS[1], -lastPointRAS[1], 1e-9);
+  CHECK_DOUBLE_TOLERANCE(lastPointLPS[2], lastPointRAS[2], 1e-9);
+  CHECK_INT(image->GetPixel(lastIndex), scalars[imageData->GetNumberOfPoints() - 1]);
+
+  // Round trip into another volume node
+  vtkNew<vtkMRMLScalarVolumeNode> readVolumeNode;
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::ReadVolume(readVolumeNode.GetPointer(), fileName.c_str()), true);
+  double readDirections[3][3];
+  readVolumeNode->GetIJKToRASDirections(readDirections);
+  for (int i = 0; i < 3; ++i)
+    {
+    CHECK_DOUBLE(readVolumeNode->GetSpacing()[i], spacing[i]);
+    CHECK_DOUBLE(readVolumeNode->GetOrigin()[i], origin[i]);
+    for (int j = 0; j < 3; ++j)
+      {
+      CHECK_DOUBLE(readDirections[i][j], directions[i][j]);
+      }
+    }
+  vtkImageData* readImageData = readVolumeNode->GetImageData();
+  CHECK_NOT_NULL(readImageData);
+  CHECK_INT(readImageData->GetScalarType(), VTK_SHORT);
+  CHECK_INT(readImageData->GetNumberOfPoints(), imageData->GetNumberOfPoints());
+  short* readScalars = static_cast<short*>(readImageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < imageData->GetNumberOfPoints(); ++i)
+    {
+    CHECK_INT(readScalars[i], scalars[i]);
+    }
+
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::RemoveVolume(fileName.c_str()), true);
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::ReadVolume(readVolumeNode.GetPointer(), fileName.c_str()), false);
+
+  return EXIT_SUCCESS;
+}
@@ -10,6 +10,7 @@
 #include "vtkSlicerApplicationLogic.h"
 #include "vtkMRMLColorLogic.h"
 #include "vtkSlicerConfigure.h" // For Slicer_BUILD_CLI_SUPPORT
+#include "vtkSlicerSharedMemoryVolumeIO.h"
 #include "vtkSlicerTask.h"
 
 // MRML includes
@@ -50,12 +51,15 @@
 # include <sys/resource.h>
 #endif
 
+#include <deque>
 #include <queue>
 
 #include "vtkSlicerApplicationLogicRequests.h"
 
 //----------------------------------------------------------------------------
-class ProcessingTaskQueue : public std::queue<vtkSmartPointer<vtkSlicerTask> > {};
+// Tasks are kept sorted by decreasing priority, in scheduling order for
+// tasks of the same priority.
+class ProcessingTaskQueue : public std::deque<vtkSmartPointer<vtkSlicerTask> > {};
 class ModifiedQueue : public std::queue<vtkSmartPointer<vtkObject> > {};
 class ReadDataQueue : public std::queue<DataRequest*> {};
 class WriteDataQueue : public std::queue<DataRequest*> {};
@@ -67,7 +71,6 @@ vtkStandardNewMacro(vtkSlicerApplicationLogic);
 vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
 {
   this->ProcessingThreader = itk::MultiThreader::New();
-  this->ProcessingThreadId = -1;
   this->ProcessingThreadActive = false;
   this->ProcessingThreadActiveLock = itk::MutexLock::New();
   this->ProcessingTaskQueueLock = itk::MutexLock::New();
@@ -84,6 +87,16 @@ vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
   this->WriteDataQueueActiveLock = itk::MutexLock::New();
   this->WriteDataQueueLock = itk::MutexLock::New();
 
+  this->MaximumNumberOfProcessingTasks = 1;
+  this->MaximumNumberOfProcessingTaskThreads =
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->MaximumProcessingTaskMemorySize = 0;
+  this->NumberOfIdleProcessingThreads = 0;
+  this->NumberOfRunningTasks = 0;
+  this->NumberOfRunningTaskThreads = 0;
+  this->RunningTaskMemorySize = 0;
+  this->NumberOfCompletedTasks = 0;
+
   this->InternalTaskQueue = new ProcessingTaskQueue;
   this->InternalModifiedQueue = new ModifiedQueue;
 
@@ -99,17 +112,20 @@ vtkSlicerApplicationLogic::~vtkSlicerApplicationLogic()
   // Note that TerminateThread does not kill a thread, it only waits
   // for the thread to finish.  We need to signal the thread that we
   // want to terminate
-  if (this->ProcessingThreadId != -1 && this->ProcessingThreader)
+  if (!this->ProcessingThreadIDs.empty() && this->ProcessingThreader)
     {
     // Signal the processingThread that we are terminating.
     this->ProcessingThreadActiveLock->Lock();
     this->ProcessingThreadActive = false;
     this->ProcessingThreadActiveLock->Unlock();
 
-    // Wait for the thread to finish and clean up the state of the threader
-    this->ProcessingThreader->TerminateThread( this->ProcessingThreadId );
-
-    this->ProcessingThreadId = -1;
+    // Wait for the threads to finish and clean up the state of the threader
+    for (std::vector<int>::const_iterator idIterator = this->ProcessingThreadIDs.begin();
+         idIterator != this->ProcessingThreadIDs.end(); ++idIterator)
+      {
+      this->ProcessingThreader->TerminateThread( *idIterator );
+      }
+    this->ProcessingThreadIDs.clear();
     }
 
   delete this->InternalTaskQueue;
@@ -188,21 +204,32 @@ void vtkSlicerApplicationLogic::PrintSelf(ostream& os, vtkIndent indent)
   this->vtkObject::PrintSelf(os, indent);
 
   os << indent << "SlicerApplicationLogic:             " << this->GetClassName() << "\n";
+
+  this->ProcessingTaskQueueLock->Lock();
+  os << indent << "MaximumNumberOfProcessingTasks:     " << this->MaximumNumberOfProcessingTasks << "\n";
+  os << indent << "MaximumNumberOfProcessingTaskThreads: " << this->MaximumNumberOfProcessingTaskThreads << "\n";
+  os << indent << "MaximumProcessingTaskMemorySize:    " << this->MaximumProcessingTaskMemorySize << "\n";
+  os << indent << "NumberOfProcessingThreads:          " << this->ProcessingThreadIDs.size() << "\n";
+  os << indent << "NumberOfQueuedTasks:                " << (*this->InternalTaskQueue).size() << "\n";
+  os << indent << "NumberOfRunningTasks:               " << this->NumberOfRunningTasks << "\n";
+  os << indent << "NumberOfCompletedTasks:             " << this->NumberOfCompletedTasks << "\n";
+  this->ProcessingTaskQueueLock->Unlock();
 }
 
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::CreateProcessingThread()
 {
-  if (this->ProcessingThreadId == -1)
+  if (this->ProcessingThreadIDs.empty())
     {
     this->ProcessingThreadActiveLock->Lock();
     this->ProcessingThreadActive = true;
     this->ProcessingThreadActiveLock->Unlock();
 
-    this->ProcessingThreadId
-      = this->ProcessingThreader
-      ->SpawnThread(vtkSlicerApplicationLogic::ProcessingThreaderCallback,
-                    this);
+    this->ProcessingTaskQueueLock->Lock();
+    this->NumberOfCompletedTasks = 0;
+    this->NumberOfIdleProcessingThreads = 0;
+    this->SpawnProcessingThread();
+    this->ProcessingTaskQueueLock->Unlock();
 
     // Start four network threads (TODO: make the number of threads a setting)
     this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
@@ -245,7 +272,7 @@ void vtkSlicerApplicationLogic::CreateProcessingThread()
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::TerminateProcessingThread()
 {
-  if (this->ProcessingThreadId != -1)
+  if (!this->ProcessingThreadIDs.empty())
     {
     this->ModifiedQueueActiveLock->Lock();
     this->ModifiedQueueActive = false;
@@ -263,10 +290,20 @@ void vtkSlicerApplicationLogic::TerminateProcessingThread()
     this->ProcessingThreadActive = false;
     this->ProcessingThreadActiveLock->Unlock();
 
-    this->ProcessingThreader->TerminateThread( this->ProcessingThreadId );
-    this->ProcessingThreadId = -1;
+    // No more processing thread can be spawned once inactive
+    this->ProcessingTaskQueueLock->Lock();
+    std::vector<int> processingThreadIDs;
+    processingThreadIDs.swap(this->ProcessingThreadIDs);
+    this->NumberOfIdleProcessingThreads = 0;
+    this->ProcessingTaskQueueLock->Unlock();
 
     std::vector<int>::const_iterator idIterator;
+    for (idIterator = processingThreadIDs.begin();
+         idIterator != processingThreadIDs.end(); ++idIterator)
+      {
+      this->ProcessingThreader->TerminateThread( *idIterator );
+      }
+
     idIterator = this->NetworkingThreadIDs.begin();
     while (idIterator != this->NetworkingThreadIDs.end())
       {
@@ -331,28 +368,31 @@ void vtkSlicerApplicationLogic::ProcessProcessingTasks()
       {
       // pull a task off the queue
       this->ProcessingTaskQueueLock->Lock();
-      if ((*this->InternalTaskQueue).size() > 0)
+      task = this->TakeNextProcessingTask();
+      if (task)
         {
-        // std::cout << "Number of queued tasks: " << (*this->InternalTaskQueue).size() << std::endl;
-
-        // only handle processing tasks in this thread
-        task = (*this->InternalTaskQueue).front();
-        if ( task->GetType() == vtkSlicerTask::Processing )
-          {
-          (*this->InternalTaskQueue).pop();
-          }
-        else
-          {
-          task = NULL;
-          }
+        --this->NumberOfIdleProcessingThreads;
+        ++this->NumberOfRunningTasks;
+        this->NumberOfRunningTaskThreads += task->GetNumberOfThreads();
+        this->RunningTaskMemorySize += task->GetMemorySize();
         }
       this->ProcessingTaskQueueLock->Unlock();
 
-      // process the task (should this be in a separate thread?)
       if (task)
         {
         task->Execute();
+
+        this->ProcessingTaskQueueLock->Lock();
+        ++this->NumberOfIdleProcessingThreads;
+        --this->NumberOfRunningTasks;
+        this->NumberOfRunningTaskThreads -= task->GetNumberOfThreads();
+        this->RunningTaskMemorySize -= task->GetMemorySize();
+        ++this->NumberOfCompletedTasks;
+        this->ProcessingTaskQueueLock->Unlock();
+
         task = 0;
+        // look for the next task right away
+        continue;
         }
       }
 
@@ -361,6 +401,102 @@ void vtkSlicerApplicationLogic::ProcessProcessingTasks()
     }
 }
 
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkSlicerTask> vtkSlicerApplicationLogic::TakeNextProcessingTask()
+{
+  ProcessingTaskQueue::iterator it;
+  for (it = (*this->InternalTaskQueue).begin(); it != (*this->InternalTaskQueue).end(); ++it)
+    {
+    if ((*it)->GetType() == vtkSlicerTask::Processing)
+      {
+      break;
+      }
+    }
+  if (it == (*this->InternalTaskQueue).end())
+    {
+    return NULL;
+    }
+
+  // Lower priority tasks never overtake the first processing task,
+  // they wait for the resources it needs to become available.
+  vtkSlicerTask* task = *it;
+  if (this->NumberOfRunningTasks >= this->MaximumNumberOfProcessingTasks)
+    {
+    return NULL;
+    }
+  // A task that exceeds the limits on its own still runs, but alone.
+  if (this->NumberOfRunningTasks > 0)
+    {
+    if (this->NumberOfRunningTaskThreads + task->GetNumberOfThreads()
+        > this->MaximumNumberOfProcessingTaskThreads)
+      {
+      return NULL;
+      }
+    if (this->MaximumProcessingTaskMemorySize > 0
+        && this->RunningTaskMemorySize + task->GetMemorySize()
+           > this->MaximumProcessingTaskMemorySize)
+      {
+      return NULL;
+      }
+    }
+
+  vtkSmartPointer<vtkSlicerTask> nextTask = task;
+  (*this->InternalTaskQueue).erase(it);
+  return nextTask;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::SpawnProcessingThreadIfNeeded()
+{
+  // Threads are not spawned before CreateProcessingThread() nor after
+  // TerminateProcessingThread().
+  if (this->ProcessingThreadIDs.empty()
+    || static_cast<int>(this->ProcessingThreadIDs.size()) >= this->MaximumNumberOfProcessingTasks)
+    {
+    return;
+    }
+  int numberOfQueuedProcessingTasks = 0;
+  for (ProcessingTaskQueue::const_iterator it = (*this->InternalTaskQueue).begin();
+       it != (*this->InternalTaskQueue).end(); ++it)
+    {
+    if ((*it)->GetType() == vtkSlicerTask::Processing)
+      {
+      ++numberOfQueuedProcessingTasks;
+      }
+    }
+  if (numberOfQueuedProcessingTasks <= this->NumberOfIdleProcessingThreads)
+    {
+    return;
+    }
+  this->SpawnProcessingThread();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerApplicationLogic::SpawnProcessingThread()
+{
+  int threadID = -1;
+  try
+    {
+    threadID = this->ProcessingThreader->SpawnThread(
+      vtkSlicerApplicationLogic::ProcessingThreaderCallback, this);
+    }
+  catch (itk::ExceptionObject& e)
+    {
+    vtkErrorMacro("SpawnProcessingThread: failed to create a processing thread: " << e.GetDescription());
+    return false;
+    }
+  if (threadID < 0)
+    {
+    vtkErrorMacro("SpawnProcessingThread: failed to create a processing thread");
+    return false;
+    }
+  // Queued tasks keep waiting for the running threads if no thread could be
+  // created, the thread is counted as idle only once it exists.
+  this->ProcessingThreadIDs.push_back(threadID);
+  ++this->NumberOfIdleProcessingThreads;
+  return true;
+}
+
 ITK_THREAD_RETURN_TYPE
 vtkSlicerApplicationLogic
 ::NetworkingThreaderCallback( void *arg )
@@ -411,19 +547,16 @@ void vtkSlicerApplicationLogic::ProcessNetworkingTasks()
 
     if (active)
       {
-      // pull a task off the queue
+      // pull the first networking task off the queue
       this->ProcessingTaskQueueLock->Lock();
-      if ((*this->InternalTaskQueue).size() > 0)
+      for (ProcessingTaskQueue::iterator it = (*this->InternalTaskQueue).begin();
+           it != (*this->InternalTaskQueue).end(); ++it)
         {
-        // std::cout << "Number of queued tasks: " << (*this->InternalTaskQueue).size() << std::endl;
-        task = (*this->InternalTaskQueue).front();
-        if ( task->GetType() == vtkSlicerTask::Networking )
-          {
-          (*this->InternalTaskQueue).pop();
-          }
-        else
+        if ( (*it)->GetType() == vtkSlicerTask::Networking )
           {
-          task = NULL;
+          task = *it;
+          (*this->InternalTaskQueue).erase(it);
+          break;
           }
         }
       this->ProcessingTaskQueueLock->Unlock();
@@ -454,11 +587,131 @@ int vtkSlicerApplicationLogic::ScheduleTask( vtkSlicerTask *task )
     }
 
   this->ProcessingTaskQueueLock->Lock();
-  (*this->InternalTaskQueue).push( task );
+  // insert after the tasks of the same or higher priority
+  ProcessingTaskQueue::iterator it = (*this->InternalTaskQueue).begin();
+  while (it != (*this->InternalTaskQueue).end() && (*it)->GetPriority() >= task->GetPriority())
+    {
+    ++it;
+    }
+  (*this->InternalTaskQueue).insert(it, task);
+  if (task->GetType() == vtkSlicerTask::Processing)
+    {
+    this->SpawnProcessingThreadIfNeeded();
+    }
   this->ProcessingTaskQueueLock->Unlock();
   return true;
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::SetMaximumNumberOfProcessingTasks(int maximumNumberOfTasks)
+{
+  // One thread of the processing threader is used for networking tasks
+  maximumNumberOfTasks = std::min(std::max(maximumNumberOfTasks, 1), ITK_MAX_THREADS - 1);
+  this->ProcessingTaskQueueLock->Lock();
+  bool modified = (this->MaximumNumberOfProcessingTasks != maximumNumberOfTasks);
+  this->MaximumNumberOfProcessingTasks = maximumNumberOfTasks;
+  if (modified && !this->ProcessingThreadIDs.empty())
+    {
+    // tasks may already be waiting for a thread
+    while (static_cast<int>(this->ProcessingThreadIDs.size()) < this->MaximumNumberOfProcessingTasks)
+      {
+      size_t numberOfThreads = this->ProcessingThreadIDs.size();
+      this->SpawnProcessingThreadIfNeeded();
+      if (this->ProcessingThreadIDs.size() == numberOfThreads)
+        {
+        break;
+        }
+      }
+    }
+  this->ProcessingTaskQueueLock->Unlock();
+  if (modified)
+    {
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetMaximumNumberOfProcessingTasks()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  int maximumNumberOfTasks = this->MaximumNumberOfProcessingTasks;
+  this->ProcessingTaskQueueLock->Unlock();
+  return maximumNumberOfTasks;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::SetMaximumNumberOfProcessingTaskThreads(int maximumNumberOfThreads)
+{
+  maximumNumberOfThreads = std::max(maximumNumberOfThreads, 1);
+  this->ProcessingTaskQueueLock->Lock();
+  bool modified = (this->MaximumNumberOfProcessingTaskThreads != maximumNumberOfThreads);
+  this->MaximumNumberOfProcessingTaskThreads = maximumNumberOfThreads;
+  this->ProcessingTaskQueueLock->Unlock();
+  if (modified)
+    {
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetMaximumNumberOfProcessingTaskThreads()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  int maximumNumberOfThreads = this->MaximumNumberOfProcessingTaskThreads;
+  this->ProcessingTaskQueueLock->Unlock();
+  return maximumNumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::SetMaximumProcessingTaskMemorySize(vtkIdType maximumMemorySize)
+{
+  maximumMemorySize = std::max(maximumMemorySize, static_cast<vtkIdType>(0));
+  this->ProcessingTaskQueueLock->Lock();
+  bool modified = (this->MaximumProcessingTaskMemorySize != maximumMemorySize);
+  this->MaximumProcessingTaskMemorySize = maximumMemorySize;
+  this->ProcessingTaskQueueLock->Unlock();
+  if (modified)
+    {
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSlicerApplicationLogic::GetMaximumProcessingTaskMemorySize()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  vtkIdType maximumMemorySize = this->MaximumProcessingTaskMemorySize;
+  this->ProcessingTaskQueueLock->Unlock();
+  return maximumMemorySize;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfQueuedTasks()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  int numberOfTasks = static_cast<int>((*this->InternalTaskQueue).size());
+  this->ProcessingTaskQueueLock->Unlock();
+  return numberOfTasks;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfRunningTasks()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  int numberOfTasks = this->NumberOfRunningTasks;
+  this->ProcessingTaskQueueLock->Unlock();
+  return numberOfTasks;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfCompletedTasks()
+{
+  this->ProcessingTaskQueueLock->Lock();
+  int numberOfTasks = this->NumberOfCompletedTasks;
+  this->ProcessingTaskQueueLock->Unlock();
+  return numberOfTasks;
+}
+
 //----------------------------------------------------------------------------
 vtkMTimeType vtkSlicerApplicationLogic::RequestModified(vtkObject *obj)
 {
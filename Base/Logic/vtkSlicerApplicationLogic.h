@@ -26,6 +26,7 @@
 
 // VTK includes
 #include <vtkCollection.h>
+#include <vtkSmartPointer.h>
 
 // ITK includes
 #include <itkMultiThreader.h>
@@ -71,10 +72,46 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
   void PropagateFiducialListSelection();
 
   /// Create a thread for processing
+  /// Additional processing threads are created on demand by ScheduleTask(),
+  /// up to MaximumNumberOfProcessingTasks.
   void CreateProcessingThread();
 
-  /// Shutdown the processing thread
+  /// Shutdown the processing threads
   void TerminateProcessingThread();
+
+  /// Maximum number of processing tasks that can run at the same time.
+  /// Each running task has its own processing thread, the value is clamped
+  /// to the number of threads the processing threader can spawn besides the
+  /// networking thread (ITK_MAX_THREADS - 1).
+  /// Default is 1: tasks run one after the other in the order of their
+  /// priority.
+  /// \sa vtkSlicerTask::GetPriority(), ScheduleTask()
+  void SetMaximumNumberOfProcessingTasks(int maximumNumberOfTasks);
+  int GetMaximumNumberOfProcessingTasks();
+
+  /// Maximum number of CPU cores used by the running processing tasks, based
+  /// on vtkSlicerTask::GetNumberOfThreads(). A task is not started while
+  /// it would exceed the limit, unless no other processing task is running.
+  /// Default is the number of CPU cores.
+  void SetMaximumNumberOfProcessingTaskThreads(int maximumNumberOfThreads);
+  int GetMaximumNumberOfProcessingTaskThreads();
+
+  /// Maximum memory (in bytes) used by the running processing tasks,
+  /// based on vtkSlicerTask::GetMemorySize(). A task is not started while
+  /// it would exceed the limit, unless no other processing task is running.
+  /// 0 (default) means unlimited.
+  void SetMaximumProcessingTaskMemorySize(vtkIdType maximumMemorySize);
+  vtkIdType GetMaximumProcessingTaskMemorySize();
+
+  /// Number of tasks (processing and networking) waiting to be started.
+  int GetNumberOfQueuedTasks();
+
+  /// Number of processing tasks currently running.
+  int GetNumberOfRunningTasks();
+
+  /// Number of processing tasks that finished running since the
+  /// processing thread was created.
+  int GetNumberOfCompletedTasks();
   /// List of events potentially fired by the application logic
   enum RequestEvents
     {
@@ -91,6 +128,10 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
   /// Schedule a task to run in the processing thread. Returns true if
   /// task was successfully scheduled. ScheduleTask() is called from the
   /// main thread to run something in the processing thread.
+  /// Tasks with a higher priority are started first, and processing tasks
+  /// are started as soon as the limits on the number of running tasks,
+  /// threads and memory allow it.
+  /// \sa SetMaximumNumberOfProcessingTasks()
   int ScheduleTask( vtkSlicerTask* );
 
   /// Request a Modified call on an object.  This method allows a
@@ -225,6 +266,21 @@ protected:
   /// Task processing loop that is run in the processing thread
   void ProcessProcessingTasks();
 
+  /// Remove from the queue and return the processing task with the highest
+  /// priority if the resource limits allow it to start now.
+  /// Must be called with ProcessingTaskQueueLock locked.
+  vtkSmartPointer<vtkSlicerTask> TakeNextProcessingTask();
+
+  /// Create a new processing thread if there are more queued processing
+  /// tasks than idle processing threads.
+  /// Must be called with ProcessingTaskQueueLock locked.
+  void SpawnProcessingThreadIfNeeded();
+
+  /// Spawn a processing thread and count it as idle.
+  /// Return false if the thread could not be created.
+  /// Must be called with ProcessingTaskQueueLock locked.
+  bool SpawnProcessingThread();
+
   /// Networking Task processing loop that is run in a networking thread
   void ProcessNetworkingTasks();
 
@@ -249,13 +305,22 @@ private:
   itk::MutexLock::Pointer WriteDataQueueActiveLock;
   itk::MutexLock::Pointer WriteDataQueueLock;
   vtkTimeStamp RequestTimeStamp;
-  int ProcessingThreadId;
+  std::vector<int> ProcessingThreadIDs;
   std::vector<int> NetworkingThreadIDs;
   int ProcessingThreadActive;
   int ModifiedQueueActive;
   int ReadDataQueueActive;
   int WriteDataQueueActive;
 
+  int MaximumNumberOfProcessingTasks;
+  int MaximumNumberOfProcessingTaskThreads;
+  vtkIdType MaximumProcessingTaskMemorySize;
+  int NumberOfIdleProcessingThreads;
+  int NumberOfRunningTasks;
+  int NumberOfRunningTaskThreads;
+  vtkIdType RunningTaskMemorySize;
+  int NumberOfCompletedTasks;
+
   ProcessingTaskQueue* InternalTaskQueue;
   ModifiedQueue*       InternalModifiedQueue;
   ReadDataQueue*       InternalReadDataQueue;
@@ -96,9 +96,24 @@ public:
           }
         }
 
+      // volumes written by a command line module into shared memory
+      // are copied directly into the node, no storage node is involved
+      bool readFromSharedMemory = false;
+      vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(nd);
+      if (storageNode.GetPointer() == NULL && volumeNode != NULL
+        && vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName(m_Filename.c_str()))
+        {
+        vtkDebugWithObjectMacro(appLogic, "ProcessReadNodeData: reading shared memory " << m_Filename);
+        readFromSharedMemory = true;
+        if (!vtkSlicerSharedMemoryVolumeIO::ReadVolume(volumeNode, m_Filename.c_str()))
+          {
+          vtkErrorWithObjectMacro(appLogic, "Failed to read " << m_Filename);
+          }
+        }
+
       // if there wasn't already a matching storage node on the node, make one
       bool createdNewStorageNode = false;
-      if (storageNode.GetPointer() == NULL)
+      if (storageNode.GetPointer() == NULL && !readFromSharedMemory)
         {
         // Read the data into the referenced node
         if (itksys::SystemTools::FileExists(m_Filename.c_str()))
@@ -168,6 +183,10 @@ public:
         {
         removed = 1;
         }
+      else if (vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName(m_Filename.c_str()))
+        {
+        removed = vtkSlicerSharedMemoryVolumeIO::RemoveVolume(m_Filename.c_str());
+        }
       else
         {
         removed = itksys::SystemTools::RemoveFile(m_Filename.c_str());
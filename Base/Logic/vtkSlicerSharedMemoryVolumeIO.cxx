@@ -0,0 +1,249 @@
+/*=========================================================================
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+
+#include "vtkSlicerSharedMemoryVolumeIO.h"
+
+// ITKFactoryRegistration includes
+#include <itkSharedMemoryImageIO.h>
+
+// MRML includes
+#include <vtkMRMLDiffusionImageVolumeNode.h>
+#include <vtkMRMLDiffusionWeightedVolumeNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLVectorVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+itk::ImageIOBase::IOComponentType GetComponentTypeFromScalarType(int scalarType)
+{
+  switch (scalarType)
+    {
+    case VTK_FLOAT: return itk::ImageIOBase::FLOAT;
+    case VTK_DOUBLE: return itk::ImageIOBase::DOUBLE;
+    case VTK_INT: return itk::ImageIOBase::INT;
+    case VTK_UNSIGNED_INT: return itk::ImageIOBase::UINT;
+    case VTK_SHORT: return itk::ImageIOBase::SHORT;
+    case VTK_UNSIGNED_SHORT: return itk::ImageIOBase::USHORT;
+    case VTK_LONG: return itk::ImageIOBase::LONG;
+    case VTK_UNSIGNED_LONG: return itk::ImageIOBase::ULONG;
+    case VTK_CHAR: return itk::ImageIOBase::CHAR;
+    case VTK_SIGNED_CHAR: return itk::ImageIOBase::CHAR;
+    case VTK_UNSIGNED_CHAR: return itk::ImageIOBase::UCHAR;
+    default: return itk::ImageIOBase::UNKNOWNCOMPONENTTYPE;
+    }
+}
+
+//----------------------------------------------------------------------------
+int GetScalarTypeFromComponentType(itk::ImageIOBase::IOComponentType componentType)
+{
+  switch (componentType)
+    {
+    case itk::ImageIOBase::FLOAT: return VTK_FLOAT;
+    case itk::ImageIOBase::DOUBLE: return VTK_DOUBLE;
+    case itk::ImageIOBase::INT: return VTK_INT;
+    case itk::ImageIOBase::UINT: return VTK_UNSIGNED_INT;
+    case itk::ImageIOBase::SHORT: return VTK_SHORT;
+    case itk::ImageIOBase::USHORT: return VTK_UNSIGNED_SHORT;
+    case itk::ImageIOBase::LONG: return VTK_LONG;
+    case itk::ImageIOBase::ULONG: return VTK_UNSIGNED_LONG;
+    case itk::ImageIOBase::CHAR: return VTK_CHAR;
+    case itk::ImageIOBase::UCHAR: return VTK_UNSIGNED_CHAR;
+    default: return VTK_VOID;
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSlicerSharedMemoryVolumeIO);
+
+//----------------------------------------------------------------------------
+vtkSlicerSharedMemoryVolumeIO::vtkSlicerSharedMemoryVolumeIO()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkSlicerSharedMemoryVolumeIO::~vtkSlicerSharedMemoryVolumeIO()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerSharedMemoryVolumeIO::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Supported: " << (IsSupported() ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::IsSupported()
+{
+  return itk::SharedMemoryImageIO::IsSupported();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName(const char* fileName)
+{
+  return itk::SharedMemoryImageIO::IsSharedMemoryFileName(fileName);
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::CanTransferNode(vtkMRMLNode* node)
+{
+  if (!IsSupported())
+    {
+    return false;
+    }
+  // Diffusion volumes derive from scalar volumes but need their gradients
+  // and measurement frame to be transferred as well.
+  if (vtkMRMLDiffusionWeightedVolumeNode::SafeDownCast(node)
+    || vtkMRMLDiffusionImageVolumeNode::SafeDownCast(node))
+    {
+    return false;
+    }
+  return vtkMRMLScalarVolumeNode::SafeDownCast(node) != NULL
+    || vtkMRMLVectorVolumeNode::SafeDownCast(node) != NULL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::WriteVolume(vtkMRMLVolumeNode* volumeNode, const char* fileName)
+{
+  if (!IsSupported() || !IsSharedMemoryFileName(fileName))
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::WriteVolume: invalid shared memory name "
+                           << (fileName ? fileName : "(null)"));
+    return false;
+    }
+  vtkImageData* imageData = volumeNode ? volumeNode->GetImageData() : NULL;
+  if (!imageData)
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::WriteVolume: no image data to write to " << fileName);
+    return false;
+    }
+  itk::ImageIOBase::IOComponentType componentType =
+    GetComponentTypeFromScalarType(imageData->GetScalarType());
+  if (componentType == itk::ImageIOBase::UNKNOWNCOMPONENTTYPE)
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::WriteVolume: unsupported scalar type "
+                           << imageData->GetScalarTypeAsString());
+    return false;
+    }
+
+  itk::SharedMemoryImageIO::Pointer imageIO = itk::SharedMemoryImageIO::New();
+  imageIO->SetFileName(fileName);
+  imageIO->SetNumberOfDimensions(3);
+  imageIO->SetComponentType(componentType);
+  int numberOfComponents = imageData->GetNumberOfScalarComponents();
+  imageIO->SetNumberOfComponents(numberOfComponents);
+  imageIO->SetPixelType(numberOfComponents == 1 ?
+    itk::ImageIOBase::SCALAR : itk::ImageIOBase::VECTOR);
+
+  // ITK images are in LPS, MRML volumes are in RAS
+  int* dimensions = imageData->GetDimensions();
+  double* spacing = volumeNode->GetSpacing();
+  double* origin = volumeNode->GetOrigin();
+  double directions[3][3];
+  volumeNode->GetIJKToRASDirections(directions);
+  for (unsigned int i = 0; i < 3; ++i)
+    {
+    imageIO->SetDimensions(i, dimensions[i]);
+    imageIO->SetSpacing(i, spacing[i]);
+    imageIO->SetOrigin(i, i < 2 ? -origin[i] : origin[i]);
+    // Axis i is the i-th column of the IJK to RAS direction matrix
+    std::vector<double> direction(3);
+    direction[0] = -directions[0][i];
+    direction[1] = -directions[1][i];
+    direction[2] = directions[2][i];
+    imageIO->SetDirection(i, direction);
+    }
+
+  try
+    {
+    imageIO->Write(imageData->GetScalarPointer());
+    }
+  catch (itk::ExceptionObject& exc)
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::WriteVolume: " << exc);
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::ReadVolume(vtkMRMLVolumeNode* volumeNode, const char* fileName)
+{
+  if (!volumeNode || !IsSupported() || !IsSharedMemoryFileName(fileName))
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::ReadVolume: invalid volume or shared memory name "
+                           << (fileName ? fileName : "(null)"));
+    return false;
+    }
+
+  itk::SharedMemoryImageIO::Pointer imageIO = itk::SharedMemoryImageIO::New();
+  imageIO->SetFileName(fileName);
+  vtkNew<vtkImageData> imageData;
+  try
+    {
+    imageIO->ReadImageInformation();
+    int scalarType = GetScalarTypeFromComponentType(imageIO->GetComponentType());
+    if (scalarType == VTK_VOID)
+      {
+      vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::ReadVolume: unsupported component type in "
+                             << fileName);
+      return false;
+      }
+    int dimensions[3] = {1, 1, 1};
+    for (unsigned int i = 0; i < imageIO->GetNumberOfDimensions() && i < 3; ++i)
+      {
+      dimensions[i] = static_cast<int>(imageIO->GetDimensions(i));
+      }
+    imageData->SetDimensions(dimensions);
+    imageData->AllocateScalars(scalarType, imageIO->GetNumberOfComponents());
+    imageIO->Read(imageData->GetScalarPointer());
+    }
+  catch (itk::ExceptionObject& exc)
+    {
+    vtkGenericWarningMacro("vtkSlicerSharedMemoryVolumeIO::ReadVolume: " << exc);
+    return false;
+    }
+
+  // ITK images are in LPS, MRML volumes are in RAS
+  double spacing[3] = {1.0, 1.0, 1.0};
+  double origin[3] = {0.0, 0.0, 0.0};
+  double directions[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+  for (unsigned int i = 0; i < imageIO->GetNumberOfDimensions() && i < 3; ++i)
+    {
+    spacing[i] = imageIO->GetSpacing(i);
+    origin[i] = i < 2 ? -imageIO->GetOrigin(i) : imageIO->GetOrigin(i);
+    std::vector<double> direction = imageIO->GetDirection(i);
+    for (unsigned int j = 0; j < direction.size() && j < 3; ++j)
+      {
+      directions[j][i] = j < 2 ? -direction[j] : direction[j];
+      }
+    }
+
+  int wasModifying = volumeNode->StartModify();
+  volumeNode->SetSpacing(spacing);
+  volumeNode->SetOrigin(origin);
+  volumeNode->SetIJKToRASDirections(directions);
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  volumeNode->EndModify(wasModifying);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSlicerSharedMemoryVolumeIO::RemoveVolume(const char* fileName)
+{
+  return itk::SharedMemoryImageIO::RemoveSharedMemory(fileName);
+}
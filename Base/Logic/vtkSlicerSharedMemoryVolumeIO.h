@@ -0,0 +1,67 @@
+/*=========================================================================
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+///  vtkSlicerSharedMemoryVolumeIO - transfer volumes through shared memory
+///
+/// Writes and reads volume nodes to and from the "shm:/name" shared memory
+/// objects understood by itk::SharedMemoryImageIO. This is how Slicer
+/// passes images to and from executable command line modules without
+/// writing temporary files.
+/// Only scalar, label map and vector volumes are supported, diffusion
+/// volumes need their measurement frame and gradients and still go
+/// through files.
+
+#ifndef __vtkSlicerSharedMemoryVolumeIO_h
+#define __vtkSlicerSharedMemoryVolumeIO_h
+
+// Slicer includes
+#include "vtkSlicerBaseLogic.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkMRMLNode;
+class vtkMRMLVolumeNode;
+
+class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerSharedMemoryVolumeIO : public vtkObject
+{
+public:
+  static vtkSlicerSharedMemoryVolumeIO *New();
+  vtkTypeMacro(vtkSlicerSharedMemoryVolumeIO, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Returns true if shared memory objects are available on this platform.
+  static bool IsSupported();
+
+  /// Returns true if \a fileName is a "shm:/name" shared memory name.
+  static bool IsSharedMemoryFileName(const char* fileName);
+
+  /// Returns true if \a node can be transferred through shared memory.
+  static bool CanTransferNode(vtkMRMLNode* node);
+
+  /// Copy the voxels and geometry of \a volumeNode into a newly created
+  /// shared memory object.
+  static bool WriteVolume(vtkMRMLVolumeNode* volumeNode, const char* fileName);
+
+  /// Replace the image data and geometry of \a volumeNode by the content
+  /// of the shared memory object.
+  static bool ReadVolume(vtkMRMLVolumeNode* volumeNode, const char* fileName);
+
+  /// Remove the shared memory object. Memory is released once all the
+  /// processes that mapped it have unmapped it.
+  static bool RemoveVolume(const char* fileName);
+
+protected:
+  vtkSlicerSharedMemoryVolumeIO();
+  virtual ~vtkSlicerSharedMemoryVolumeIO();
+
+private:
+  vtkSlicerSharedMemoryVolumeIO(const vtkSlicerSharedMemoryVolumeIO&); // Not implemented
+  void operator=(const vtkSlicerSharedMemoryVolumeIO&); // Not implemented
+};
+
+#endif
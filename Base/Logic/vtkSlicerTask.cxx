@@ -12,6 +12,9 @@ vtkSlicerTask::vtkSlicerTask()
   this->TaskObject = 0;
   this->TaskFunction = 0;
   this->Type = vtkSlicerTask::Undefined;
+  this->Priority = 0;
+  this->NumberOfThreads = 1;
+  this->MemorySize = 0;
 }
 //----------------------------------------------------------------------------
 vtkSlicerTask::~vtkSlicerTask()
@@ -41,4 +44,8 @@ void vtkSlicerTask::Execute()
 void vtkSlicerTask::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os, indent);
+  os << indent << "Type: " << this->GetTypeAsString() << "\n";
+  os << indent << "Priority: " << this->Priority << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "MemorySize: " << this->MemorySize << "\n";
 }
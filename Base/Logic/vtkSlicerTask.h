@@ -48,6 +48,27 @@ public:
     return "Unknown";
   }
 
+  ///
+  /// Scheduling priority of the task. Tasks with a higher priority are
+  /// started first, tasks with the same priority are started in the order
+  /// they were scheduled. Default is 0.
+  vtkSetMacro(Priority, int);
+  vtkGetMacro(Priority, int);
+
+  ///
+  /// Number of CPU cores the task is expected to keep busy. Used by the
+  /// application logic to limit the number of processing tasks running
+  /// at the same time. Default is 1.
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  ///
+  /// Peak memory (in bytes) the task is expected to use, 0 if unknown.
+  /// Used by the application logic to limit the number of processing
+  /// tasks running at the same time. Default is 0.
+  vtkSetClampMacro(MemorySize, vtkIdType, 0, VTK_ID_MAX);
+  vtkGetMacro(MemorySize, vtkIdType);
+
 protected:
   vtkSlicerTask();
   virtual ~vtkSlicerTask();
@@ -60,6 +81,9 @@ private:
   void *TaskClientData;
 
   int Type;
+  int Priority;
+  int NumberOfThreads;
+  vtkIdType MemorySize;
 
 };
 #endif
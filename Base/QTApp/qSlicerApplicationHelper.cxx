@@ -21,6 +21,8 @@
 #include "qSlicerApplicationHelper.h"
 
 // Qt includes
+#include <QDir>
+#include <QFileInfo>
 #include <QFont>
 #include <QSettings>
 #include <QSysInfo>
@@ -199,6 +201,12 @@ void qSlicerApplicationHelper::setupModuleFactoryManager(qSlicerModuleFactoryMan
 
     qSlicerCLIExecutableModuleFactory* cliExecutableFactory = new qSlicerCLIExecutableModuleFactory();
     cliExecutableFactory->setTempDirectory(tempDirectory);
+    // Save the XML descriptions of the CLI executables next to the revision
+    // specific settings so that they are not retrieved at each startup.
+    QFileInfo revisionUserSettingsFileInfo(app->slicerRevisionUserSettingsFilePath());
+    cliExecutableFactory->setDescriptionCacheFilePath(
+      revisionUserSettingsFileInfo.dir().filePath(
+        revisionUserSettingsFileInfo.completeBaseName() + "-CLIModuleDescriptions.ini"));
     moduleFactoryManager->registerFactory(cliExecutableFactory, preferExecutableCLIs ? 1 : 0);
 
     if (!options->disableBuiltInModules() &&
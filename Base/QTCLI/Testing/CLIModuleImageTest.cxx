@@ -0,0 +1,60 @@
+/*=========================================================================
+
+  Program:   Slicer
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+#include "CLIModuleImageTestCLP.h"
+
+// ITK includes
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIterator.h>
+
+// STD includes
+#include <fstream>
+
+int main(int argc, char * argv[])
+{
+
+  PARSE_ARGS;
+
+  typedef itk::Image<short, 3> ImageType;
+  typedef itk::ImageFileReader<ImageType> ReaderType;
+  typedef itk::ImageFileWriter<ImageType> WriterType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(InputVolume.c_str());
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName(OutputVolume.c_str());
+  try
+    {
+    reader->Update();
+    ImageType::Pointer image = reader->GetOutput();
+    itk::ImageRegionIterator<ImageType> it(image, image->GetBufferedRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      it.Set(it.Get() + 1);
+      }
+    writer->SetInput(image);
+    writer->Update();
+    }
+  catch (itk::ExceptionObject& exc)
+    {
+    std::cerr << exc << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::ofstream returnFile(returnParameterFile.c_str());
+  returnFile << "InputFileName = " << InputVolume << std::endl;
+  returnFile.close();
+
+  return EXIT_SUCCESS;
+}
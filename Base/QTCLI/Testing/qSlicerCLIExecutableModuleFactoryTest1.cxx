@@ -18,16 +18,82 @@
 
 ==============================================================================*/
 
-// QT includes
+// Qt includes
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
 
 // SlicerQt includes
 #include <qSlicerCLIExecutableModuleFactory.h>
+#include <qSlicerCLIModule.h>
+
+// SlicerExecutionModel includes
+#include <ModuleDescription.h>
 
 // STD includes
 
 #include "vtkMRMLCoreTestingMacros.h"
 
-int qSlicerCLIExecutableModuleFactoryTest1(int, char * [] )
+namespace
+{
+
+//-----------------------------------------------------------------------------
+const char CACHED_XML_DESCRIPTION[] =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<executable>\n"
+  "  <category>Testing</category>\n"
+  "  <title>Cached Module</title>\n"
+  "  <description>Description saved in the cache</description>\n"
+  "</executable>\n";
+
+//-----------------------------------------------------------------------------
+QString cacheEntryKey(const QFileInfo& executable)
+{
+  return QString(QCryptographicHash::hash(
+    executable.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+//-----------------------------------------------------------------------------
+void writeCacheEntry(const QString& cacheFilePath, const QFileInfo& executable)
+{
+  QSettings cache(cacheFilePath, QSettings::IniFormat);
+  cache.beginGroup(cacheEntryKey(executable));
+  cache.setValue("Path", executable.absoluteFilePath());
+  cache.setValue("LastModified", executable.lastModified());
+  cache.setValue("Size", executable.size());
+  cache.setValue("XmlDescription", QString(CACHED_XML_DESCRIPTION));
+  cache.endGroup();
+}
+
+//-----------------------------------------------------------------------------
+QStringList cacheEntries(const QString& cacheFilePath)
+{
+  return QSettings(cacheFilePath, QSettings::IniFormat).childGroups();
+}
+
+//-----------------------------------------------------------------------------
+/// Return the title of the module instantiated from \a executable, or an
+/// empty string if it can't be instantiated.
+QString instantiatedModuleTitle(const QString& cacheFilePath, const QFileInfo& executable)
+{
+  qSlicerCLIExecutableModuleFactory factory;
+  factory.setDescriptionCacheFilePath(cacheFilePath);
+  QString key = factory.registerFileItem(executable);
+  qSlicerCLIModule* module = dynamic_cast<qSlicerCLIModule*>(factory.instantiate(key));
+  QString title;
+  if (module)
+    {
+    title = QString::fromStdString(module->moduleDescription().GetTitle());
+    }
+  factory.uninstantiate(key);
+  return title;
+}
+
+//-----------------------------------------------------------------------------
+int testFileNameToKey()
 {
   QStringList executableNames;
   executableNames << "Threshold.exe"
@@ -47,6 +113,68 @@ int qSlicerCLIExecutableModuleFactoryTest1(int, char * [] )
       return EXIT_FAILURE;
       }
     }
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testDescriptionCache()
+{
+  QDir testDir(QDir::temp().filePath("qSlicerCLIExecutableModuleFactoryTest1"));
+  CHECK_BOOL(testDir.mkpath("."), true);
+  QString cacheFilePath = testDir.filePath("CLIModuleDescriptions.ini");
+  QFile::remove(cacheFilePath);
+
+  // The executable can't be run: the module can only be instantiated from
+  // the description saved in the cache.
+  QFile executableFile(testDir.filePath("CacheTest"));
+  CHECK_BOOL(executableFile.open(QIODevice::WriteOnly | QIODevice::Truncate), true);
+  executableFile.write("not a CLI");
+  executableFile.close();
+  QFileInfo executable(executableFile.fileName());
+
+  // Entry of an executable that has been removed since
+  QFileInfo removedExecutable(testDir.filePath("RemovedCacheTest"));
+  writeCacheEntry(cacheFilePath, removedExecutable);
+  writeCacheEntry(cacheFilePath, executable);
+  CHECK_INT(cacheEntries(cacheFilePath).count(), 2);
+
+  // Cache hit, the stale entry is pruned
+  CHECK_STD_STRING(instantiatedModuleTitle(cacheFilePath, executable).toStdString(), "Cached Module");
+  CHECK_INT(cacheEntries(cacheFilePath).count(), 1);
+  CHECK_BOOL(cacheEntries(cacheFilePath).contains(cacheEntryKey(executable)), true);
+
+  // The executable changed: the entry is not used anymore and the failed
+  // "--xml" run is not saved in the cache
+  CHECK_BOOL(executableFile.open(QIODevice::Append), true);
+  executableFile.write(" anymore");
+  executableFile.close();
+  executable.refresh();
+  CHECK_STD_STRING(instantiatedModuleTitle(cacheFilePath, executable).toStdString(), "");
+  {
+  QSettings cache(cacheFilePath, QSettings::IniFormat);
+  CHECK_BOOL(cache.value(cacheEntryKey(executable) + "/Size").toLongLong() != executable.size(), true);
+  }
+
+  // The invalid entry is pruned
+  {
+  qSlicerCLIExecutableModuleFactory factory;
+  factory.setDescriptionCacheFilePath(cacheFilePath);
+  }
+  CHECK_INT(cacheEntries(cacheFilePath).count(), 0);
+
+  QFile::remove(cacheFilePath);
+  QFile::remove(executable.absoluteFilePath());
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int qSlicerCLIExecutableModuleFactoryTest1(int argc, char * argv[] )
+{
+  QCoreApplication app(argc, argv);
 
+  CHECK_EXIT_SUCCESS(testFileNameToKey());
+  CHECK_EXIT_SUCCESS(testDescriptionCache());
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,150 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+
+// SlicerQt includes
+#include <qSlicerCLIExecutableModuleFactory.h>
+#include <qSlicerCLIModule.h>
+
+// Slicer includes
+#include <vtkSlicerApplicationLogic.h>
+#include <vtkSlicerCLIModuleLogic.h>
+#include <vtkSlicerSharedMemoryVolumeIO.h>
+
+// MRML includes
+#include <vtkMRMLCommandLineModuleNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// STD includes
+
+#include "vtkMRMLCoreTestingMacros.h"
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+/// Run the CLIModuleImageTest executable on a volume through the CLI logic
+/// and check that the output volume is the input plus 1. \a builtIn and the
+/// "Modules/AllowSharedMemoryTransfer" setting decide whether the images
+/// are expected to go through shared memory.
+int runImageModule(const QFileInfo& executable, bool builtIn, bool expectSharedMemory)
+{
+  qSlicerCLIExecutableModuleFactory factory;
+  factory.setDescriptionCacheFilePath(
+    QDir::temp().filePath("qSlicerCLIModuleSharedMemoryTest1.ini"));
+  QString key = factory.registerFileItem(executable);
+  qSlicerCLIModule* module = dynamic_cast<qSlicerCLIModule*>(factory.instantiate(key));
+  CHECK_NOT_NULL(module);
+  module->setBuiltIn(builtIn);
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  appLogic->SetMRMLScene(scene.GetPointer());
+  appLogic->SetTemporaryPath(QDir::tempPath().toStdString().c_str());
+  module->setMRMLScene(scene.GetPointer());
+  module->initialize(appLogic.GetPointer());
+
+  vtkSlicerCLIModuleLogic* logic = module->cliModuleLogic();
+  CHECK_NOT_NULL(logic);
+  CHECK_INT(logic->GetAllowSharedMemoryTransfer(), expectSharedMemory ? 1 : 0);
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(4, 5, 6);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short* voxels = static_cast<short*>(imageData->GetScalarPointer());
+  for (int i = 0; i < 4 * 5 * 6; ++i)
+    {
+    voxels[i] = static_cast<short>(i);
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> inputVolume;
+  inputVolume->SetSpacing(1.5, 2., 2.5);
+  inputVolume->SetOrigin(10., 20., 30.);
+  inputVolume->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(inputVolume.GetPointer());
+  vtkNew<vtkMRMLScalarVolumeNode> outputVolume;
+  scene->AddNode(outputVolume.GetPointer());
+
+  vtkMRMLCommandLineModuleNode* cliNode = logic->CreateNodeInScene();
+  cliNode->SetParameterAsString("InputVolume", inputVolume->GetID());
+  cliNode->SetParameterAsString("OutputVolume", outputVolume->GetID());
+  logic->ApplyAndWait(cliNode, false);
+  CHECK_INT(cliNode->GetStatus(), vtkMRMLCommandLineModuleNode::Completed);
+
+  // Shared memory is not available on all platforms, files are used then
+  CHECK_BOOL(vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName(
+    cliNode->GetParameterAsString("InputFileName").c_str()),
+    expectSharedMemory && vtkSlicerSharedMemoryVolumeIO::IsSupported());
+
+  vtkImageData* outputImageData = outputVolume->GetImageData();
+  CHECK_NOT_NULL(outputImageData);
+  CHECK_INT(outputImageData->GetNumberOfPoints(), 4 * 5 * 6);
+  double* spacing = outputVolume->GetSpacing();
+  CHECK_DOUBLE(spacing[0], 1.5);
+  CHECK_DOUBLE(spacing[2], 2.5);
+  double* origin = outputVolume->GetOrigin();
+  CHECK_DOUBLE(origin[0], 10.);
+  CHECK_DOUBLE(origin[2], 30.);
+  for (vtkIdType i = 0; i < outputImageData->GetNumberOfPoints(); ++i)
+    {
+    CHECK_DOUBLE(outputImageData->GetPointData()->GetScalars()->GetTuple1(i), i + 1.);
+    }
+
+  factory.uninstantiate(key);
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int qSlicerCLIModuleSharedMemoryTest1(int argc, char * argv[] )
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: qSlicerCLIModuleSharedMemoryTest1 /path/to/CLIModuleImageTest" << std::endl;
+    return EXIT_FAILURE;
+    }
+  QCoreApplication app(argc, argv);
+  // Do not change the settings of the application
+  QCoreApplication::setOrganizationName("qSlicerCLIModuleSharedMemoryTest1");
+  QCoreApplication::setApplicationName("qSlicerCLIModuleSharedMemoryTest1");
+  QSettings().clear();
+
+  QFileInfo executable(QString::fromLocal8Bit(argv[1]));
+
+  // Files are used by default
+  CHECK_EXIT_SUCCESS(runImageModule(executable, true, false));
+
+  // The setting enables shared memory transfer for the built-in CLIs only
+  QSettings().setValue("Modules/AllowSharedMemoryTransfer", true);
+  CHECK_EXIT_SUCCESS(runImageModule(executable, true, true));
+  CHECK_EXIT_SUCCESS(runImageModule(executable, false, false));
+
+  QSettings().clear();
+  return EXIT_SUCCESS;
+}
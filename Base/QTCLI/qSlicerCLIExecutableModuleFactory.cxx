@@ -19,7 +19,14 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QMutex>
 #include <QProcess>
+#include <QRunnable>
+#include <QSettings>
+#include <QThreadPool>
+#include <QWaitCondition>
 #if (QT_VERSION > QT_VERSION_CHECK(5, 0, 0))
 #include <QStandardPaths>
 #endif
@@ -31,6 +38,10 @@
 #include "qSlicerUtils.h"
 #include <vtkSlicerCLIModuleLogic.h>
 
+// SlicerExecutionModel includes
+#include <ModuleDescription.h>
+#include <ModuleDescriptionParser.h>
+
 //-----------------------------------------------------------------------------
 QString findPython()
 {
@@ -53,18 +64,301 @@ QString findPython()
 
 }
 
+//-----------------------------------------------------------------------------
+// qSlicerCLIExecutableModuleDescriptionCache
+
+//-----------------------------------------------------------------------------
+/// XML descriptions of CLI executables saved in an ini file. Entries are
+/// keyed by the executable path and are valid as long as the last
+/// modification time and the size of the executable are unchanged.
+class qSlicerCLIExecutableModuleDescriptionCache
+{
+public:
+  qSlicerCLIExecutableModuleDescriptionCache(const QString& filePath);
+
+  /// Return the cached description of \a executable or an empty string if
+  /// there is none or if the executable has changed since.
+  QString xmlDescription(const QFileInfo& executable);
+  void setXmlDescription(const QFileInfo& executable, const QString& xmlDescription);
+
+  /// Remove the entries of the executables that have been removed or
+  /// changed since they were saved.
+  void removeStaleEntries();
+
+protected:
+  QString entryKey(const QFileInfo& executable)const;
+  /// Return true if the entry of the current group matches \a executable
+  bool isEntryValid(const QFileInfo& executable);
+
+  QSettings Settings;
+};
+
+//-----------------------------------------------------------------------------
+qSlicerCLIExecutableModuleDescriptionCache::qSlicerCLIExecutableModuleDescriptionCache(
+  const QString& filePath)
+  : Settings(filePath, QSettings::IniFormat)
+{
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIExecutableModuleDescriptionCache::entryKey(const QFileInfo& executable)const
+{
+  // Paths can't be used as ini keys
+  return QString(QCryptographicHash::hash(
+    executable.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerCLIExecutableModuleDescriptionCache::isEntryValid(const QFileInfo& executable)
+{
+  return executable.exists() &&
+    this->Settings.value("Path").toString() == executable.absoluteFilePath() &&
+    this->Settings.value("LastModified").toDateTime() == executable.lastModified() &&
+    this->Settings.value("Size").toLongLong() == executable.size();
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIExecutableModuleDescriptionCache::xmlDescription(const QFileInfo& executable)
+{
+  QString xmlDescription;
+  this->Settings.beginGroup(this->entryKey(executable));
+  if (this->isEntryValid(executable))
+    {
+    xmlDescription = this->Settings.value("XmlDescription").toString();
+    }
+  this->Settings.endGroup();
+  return xmlDescription;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIExecutableModuleDescriptionCache::setXmlDescription(
+  const QFileInfo& executable, const QString& xmlDescription)
+{
+  this->Settings.beginGroup(this->entryKey(executable));
+  this->Settings.setValue("Path", executable.absoluteFilePath());
+  this->Settings.setValue("LastModified", executable.lastModified());
+  this->Settings.setValue("Size", executable.size());
+  this->Settings.setValue("XmlDescription", xmlDescription);
+  this->Settings.endGroup();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIExecutableModuleDescriptionCache::removeStaleEntries()
+{
+  foreach(const QString& group, this->Settings.childGroups())
+    {
+    this->Settings.beginGroup(group);
+    bool valid = this->isEntryValid(QFileInfo(this->Settings.value("Path").toString()));
+    this->Settings.endGroup();
+    if (!valid)
+      {
+      this->Settings.remove(group);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerCLIXmlDescriptionRequest
+
+//-----------------------------------------------------------------------------
+/// Output of a CLI executable run with "--xml". The request is run in a
+/// thread of the global thread pool, errors and warnings are collected to be
+/// reported by the factory item in the main thread.
+class qSlicerCLIXmlDescriptionRequest
+{
+public:
+  qSlicerCLIXmlDescriptionRequest(const QString& path);
+
+  /// Run the CLI executable and wake up the threads waiting for the request.
+  void run();
+  /// Block until run() is finished.
+  void waitForFinished();
+
+  QString Path;
+  /// True once run() has been called or scheduled. Only accessed from the
+  /// main thread.
+  bool Started;
+  QString XmlDescription;
+  QStringList ErrorStrings;
+  QStringList WarningStrings;
+
+protected:
+  QString runCLIWithXmlArgument();
+
+  bool Finished;
+  QMutex Mutex;
+  QWaitCondition FinishedCondition;
+};
+
+//-----------------------------------------------------------------------------
+class qSlicerCLIXmlDescriptionRunnable : public QRunnable
+{
+public:
+  qSlicerCLIXmlDescriptionRunnable(const QSharedPointer<qSlicerCLIXmlDescriptionRequest>& request)
+    : Request(request)
+  {
+  }
+  virtual void run()
+  {
+    this->Request->run();
+  }
+protected:
+  QSharedPointer<qSlicerCLIXmlDescriptionRequest> Request;
+};
+
+//-----------------------------------------------------------------------------
+qSlicerCLIXmlDescriptionRequest::qSlicerCLIXmlDescriptionRequest(const QString& path)
+  : Path(path)
+  , Started(false)
+  , Finished(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIXmlDescriptionRequest::run()
+{
+  QString xmlDescription = this->runCLIWithXmlArgument();
+  QMutexLocker locker(&this->Mutex);
+  this->XmlDescription = xmlDescription;
+  this->Finished = true;
+  this->FinishedCondition.wakeAll();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIXmlDescriptionRequest::waitForFinished()
+{
+  QMutexLocker locker(&this->Mutex);
+  while (!this->Finished)
+    {
+    this->FinishedCondition.wait(&this->Mutex);
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIXmlDescriptionRequest::runCLIWithXmlArgument()
+{
+  int cliProcessTimeoutInMs = 5000;
+  QProcess cli;
+  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+  env.insert("ITK_AUTOLOAD_PATH", "");
+  cli.setProcessEnvironment(env);
+  // Changing the current directory of the application is not thread safe
+  cli.setWorkingDirectory(QFileInfo(this->Path).path());
+  cli.start(this->Path, QStringList(QString("--xml")));
+  bool res = cli.waitForFinished(cliProcessTimeoutInMs);
+  if (!res)
+    {
+    this->ErrorStrings << QString("CLI executable: %1").arg(this->Path);
+    QString errorString;
+    switch(cli.error())
+      {
+      case QProcess::FailedToStart:
+        errorString = QLatin1String(
+              "The process failed to start. Either the invoked program is missing, or "
+              "you may have insufficient permissions to invoke the program.");
+        break;
+      case QProcess::Crashed:
+        errorString = QLatin1String(
+              "The process crashed some time after starting successfully.");
+        break;
+      case QProcess::Timedout:
+        errorString = QString(
+              "The process timed out after %1 msecs.").arg(cliProcessTimeoutInMs);
+        break;
+      case QProcess::WriteError:
+        errorString = QLatin1String(
+              "An error occurred when attempting to read from the process. "
+              "For example, the process may not be running.");
+        break;
+      case QProcess::ReadError:
+        errorString = QLatin1String(
+              "An error occurred when attempting to read from the process. "
+              "For example, the process may not be running.");
+        break;
+      case QProcess::UnknownError:
+        errorString = QLatin1String(
+              "Failed to execute process. An unknown error occurred.");
+        break;
+      }
+    this->ErrorStrings << errorString;
+    return QString();
+    }
+  QString errors = cli.readAllStandardError();
+  if (!errors.isEmpty())
+    {
+    this->ErrorStrings << QString("CLI executable: %1").arg(this->Path);
+    this->ErrorStrings << errors;
+    // TODO: More investigation for the following behavior:
+    // on my machine (Ubuntu 10.04 with ITKv4), having standard error trims the
+    // standard output results. The following readAllStandardOutput() is then
+    // missing chars and makes the XML invalid. I'm not sure if it's just on my
+    // machine so there is a chance it succeeds to parse the XML description
+    // on other machines.
+    }
+  QString xmlDescription = cli.readAllStandardOutput();
+  if (xmlDescription.isEmpty())
+    {
+    this->ErrorStrings << QString("CLI executable: %1").arg(this->Path);
+    this->ErrorStrings << QLatin1String("Failed to retrieve Xml Description");
+    return QString();
+    }
+  if (!xmlDescription.startsWith("<?xml"))
+    {
+    this->WarningStrings << QString("CLI executable: %1").arg(this->Path);
+    this->WarningStrings << QLatin1String("XML description doesn't start right away.");
+    this->WarningStrings << QString("Output before '<?xml' is [%1]").arg(
+                              xmlDescription.mid(0, xmlDescription.indexOf("<?xml")));
+    xmlDescription.remove(0, xmlDescription.indexOf("<?xml"));
+    }
+  return xmlDescription;
+}
+
+//-----------------------------------------------------------------------------
+// qSlicerCLIExecutableModuleFactoryItem
+
 //-----------------------------------------------------------------------------
 qSlicerCLIExecutableModuleFactoryItem::qSlicerCLIExecutableModuleFactoryItem(
-  const QString& newTempDirectory) : TempDirectory(newTempDirectory)
+  const QString& newTempDirectory,
+  const QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache>& descriptionCache)
+  : TempDirectory(newTempDirectory)
+  , CLIModule(0)
+  , DescriptionCache(descriptionCache)
 {
 }
 
 //-----------------------------------------------------------------------------
 bool qSlicerCLIExecutableModuleFactoryItem::load()
 {
+  if (QFile::exists(this->xmlModuleDescriptionFilePath()))
+    {
+    return true;
+    }
+  if (!this->DescriptionCache.isNull())
+    {
+    this->CachedXmlDescription = this->DescriptionCache->xmlDescription(QFileInfo(this->path()));
+    }
+  if (this->CachedXmlDescription.isEmpty() && this->XmlDescriptionRequest.isNull())
+    {
+    // Started by the factory when modules get instantiated, the module may
+    // still be ignored or registered by another factory.
+    this->XmlDescriptionRequest = QSharedPointer<qSlicerCLIXmlDescriptionRequest>(
+      new qSlicerCLIXmlDescriptionRequest(this->path()));
+    }
   return true;
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerCLIExecutableModuleFactoryItem::startXmlDescriptionRequest()
+{
+  if (this->XmlDescriptionRequest.isNull() || this->XmlDescriptionRequest->Started)
+    {
+    return;
+    }
+  this->XmlDescriptionRequest->Started = true;
+  QThreadPool::globalInstance()->start(
+    new qSlicerCLIXmlDescriptionRunnable(this->XmlDescriptionRequest));
+}
+
 //-----------------------------------------------------------------------------
 QString qSlicerCLIExecutableModuleFactoryItem::xmlModuleDescriptionFilePath()
 {
@@ -118,6 +412,10 @@ qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactoryItem::instanciator()
       this->appendInstantiateErrorString("Failed to read Xml Description");
       }
     }
+  else if (!this->CachedXmlDescription.isEmpty())
+    {
+    xmlDescription = this->CachedXmlDescription;
+    }
   else
     {
     xmlDescription = this->runCLIWithXmlArgument();
@@ -141,86 +439,53 @@ qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactoryItem::instanciator()
 //-----------------------------------------------------------------------------
 QString qSlicerCLIExecutableModuleFactoryItem::runCLIWithXmlArgument()
 {
-  ctkScopedCurrentDir scopedCurrentDir(QFileInfo(this->path()).path());
-
-  int cliProcessTimeoutInMs = 5000;
-  QProcess cli;
-  QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-  env.insert("ITK_AUTOLOAD_PATH", "");
-  cli.setProcessEnvironment(env);
-  cli.start(this->path(), QStringList(QString("--xml")));
-  bool res = cli.waitForFinished(cliProcessTimeoutInMs);
-  if (!res)
+  QSharedPointer<qSlicerCLIXmlDescriptionRequest> request = this->XmlDescriptionRequest;
+  this->XmlDescriptionRequest.clear();
+  if (request.isNull())
     {
-    this->appendInstantiateErrorString(QString("CLI executable: %1").arg(this->path()));
-    QString errorString;
-    switch(cli.error())
-      {
-      case QProcess::FailedToStart:
-        errorString = QLatin1String(
-              "The process failed to start. Either the invoked program is missing, or "
-              "you may have insufficient permissions to invoke the program.");
-        break;
-      case QProcess::Crashed:
-        errorString = QLatin1String(
-              "The process crashed some time after starting successfully.");
-        break;
-      case QProcess::Timedout:
-        errorString = QString(
-              "The process timed out after %1 msecs.").arg(cliProcessTimeoutInMs);
-        break;
-      case QProcess::WriteError:
-        errorString = QLatin1String(
-              "An error occurred when attempting to read from the process. "
-              "For example, the process may not be running.");
-        break;
-      case QProcess::ReadError:
-        errorString = QLatin1String(
-              "An error occurred when attempting to read from the process. "
-              "For example, the process may not be running.");
-        break;
-      case QProcess::UnknownError:
-        errorString = QLatin1String(
-              "Failed to execute process. An unknown error occurred.");
-        break;
-      }
-    this->appendInstantiateErrorString(errorString);
-    return 0;
+    request = QSharedPointer<qSlicerCLIXmlDescriptionRequest>(
+      new qSlicerCLIXmlDescriptionRequest(this->path()));
     }
-  QString errors = cli.readAllStandardError();
-  if (!errors.isEmpty())
+  if (!request->Started)
     {
-    this->appendInstantiateErrorString(QString("CLI executable: %1").arg(this->path()));
-    this->appendInstantiateErrorString(errors);
-    // TODO: More investigation for the following behavior:
-    // on my machine (Ubuntu 10.04 with ITKv4), having standard error trims the
-    // standard output results. The following readAllStandardOutput() is then
-    // missing chars and makes the XML invalid. I'm not sure if it's just on my
-    // machine so there is a chance it succeeds to parse the XML description
-    // on other machines.
+    request->Started = true;
+    request->run();
     }
-  QString xmlDescription = cli.readAllStandardOutput();
-  if (xmlDescription.isEmpty())
+  request->waitForFinished();
+
+  foreach(const QString& errorString, request->ErrorStrings)
     {
-    this->appendInstantiateErrorString(QString("CLI executable: %1").arg(this->path()));
-    this->appendInstantiateErrorString("Failed to retrieve Xml Description");
-    return QString();
+    this->appendInstantiateErrorString(errorString);
     }
-  if (!xmlDescription.startsWith("<?xml"))
+  foreach(const QString& warningString, request->WarningStrings)
     {
-    this->appendInstantiateWarningString(QString("CLI executable: %1").arg(this->path()));
-    this->appendInstantiateWarningString(QLatin1String("XML description doesn't start right away."));
-    this->appendInstantiateWarningString(QString("Output before '<?xml' is [%1]").arg(
-                                           xmlDescription.mid(0, xmlDescription.indexOf("<?xml"))));
-    xmlDescription.remove(0, xmlDescription.indexOf("<?xml"));
+    this->appendInstantiateWarningString(warningString);
     }
-  return xmlDescription;
+  if (!request->XmlDescription.isEmpty() && request->ErrorStrings.isEmpty())
+    {
+    // Only keep descriptions that can be used, the executable is run again
+    // otherwise.
+    ModuleDescription moduleDescription;
+    ModuleDescriptionParser parser;
+    if (parser.Parse(request->XmlDescription.toStdString(), moduleDescription) == 0)
+      {
+      this->CachedXmlDescription = request->XmlDescription;
+      if (!this->DescriptionCache.isNull())
+        {
+        this->DescriptionCache->setXmlDescription(QFileInfo(this->path()), request->XmlDescription);
+        }
+      }
+    }
+  return request->XmlDescription;
 }
 
 //-----------------------------------------------------------------------------
 void qSlicerCLIExecutableModuleFactoryItem::uninstantiate()
 {
-  this->CLIModule->cliModuleLogic()->KillProcesses();
+  if (this->CLIModule)
+    {
+    this->CLIModule->cliModuleLogic()->KillProcesses();
+    }
   this->ctkAbstractFactoryFileBasedItem<qSlicerAbstractCoreModule>::uninstantiate();
 }
 
@@ -239,6 +504,11 @@ public:
 
 private:
   QString TempDirectory;
+  QString DescriptionCacheFilePath;
+  QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache> DescriptionCache;
+  /// True if items have been created since the "--xml" requests were last
+  /// started.
+  bool HasPendingXmlDescriptionRequests;
 };
 
 //-----------------------------------------------------------------------------
@@ -246,6 +516,7 @@ qSlicerCLIExecutableModuleFactoryPrivate::qSlicerCLIExecutableModuleFactoryPriva
 :q_ptr(&object)
 {
   this->TempDirectory = QDir::tempPath();
+  this->HasPendingXmlDescriptionRequests = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -291,7 +562,30 @@ ctkAbstractFactoryItem<qSlicerAbstractCoreModule>* qSlicerCLIExecutableModuleFac
 ::createFactoryFileBasedItem()
 {
   Q_D(qSlicerCLIExecutableModuleFactory);
-  return new qSlicerCLIExecutableModuleFactoryItem(d->TempDirectory);
+  d->HasPendingXmlDescriptionRequests = true;
+  return new qSlicerCLIExecutableModuleFactoryItem(d->TempDirectory, d->DescriptionCache);
+}
+
+//-----------------------------------------------------------------------------
+qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactory::instantiate(const QString& itemKey)
+{
+  Q_D(qSlicerCLIExecutableModuleFactory);
+  // Modules are instantiated once all of them are registered: retrieve the
+  // descriptions of all the registered executables in parallel.
+  if (d->HasPendingXmlDescriptionRequests)
+    {
+    d->HasPendingXmlDescriptionRequests = false;
+    foreach(const QString& key, this->itemKeys())
+      {
+      qSlicerCLIExecutableModuleFactoryItem* executableItem =
+        dynamic_cast<qSlicerCLIExecutableModuleFactoryItem*>(this->item(key));
+      if (executableItem)
+        {
+        executableItem->startXmlDescriptionRequest();
+        }
+      }
+    }
+  return this->Superclass::instantiate(itemKey);
 }
 
 //-----------------------------------------------------------------------------
@@ -306,3 +600,29 @@ void qSlicerCLIExecutableModuleFactory::setTempDirectory(const QString& newTempD
   Q_D(qSlicerCLIExecutableModuleFactory);
   d->TempDirectory = newTempDirectory;
 }
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIExecutableModuleFactory::setDescriptionCacheFilePath(const QString& filePath)
+{
+  Q_D(qSlicerCLIExecutableModuleFactory);
+  if (d->DescriptionCacheFilePath == filePath)
+    {
+    return;
+    }
+  d->DescriptionCacheFilePath = filePath;
+  // Items already registered keep the previous cache alive
+  d->DescriptionCache.clear();
+  if (!filePath.isEmpty())
+    {
+    d->DescriptionCache = QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache>(
+      new qSlicerCLIExecutableModuleDescriptionCache(filePath));
+    d->DescriptionCache->removeStaleEntries();
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIExecutableModuleFactory::descriptionCacheFilePath()const
+{
+  Q_D(const qSlicerCLIExecutableModuleFactory);
+  return d->DescriptionCacheFilePath;
+}
@@ -30,23 +30,44 @@ class qSlicerCLIModule;
 #include <ctkPimpl.h>
 #include <ctkAbstractPluginFactory.h>
 
+// Qt includes
+#include <QSharedPointer>
+
+class qSlicerCLIExecutableModuleDescriptionCache;
+class qSlicerCLIXmlDescriptionRequest;
+
 //-----------------------------------------------------------------------------
 class qSlicerCLIExecutableModuleFactoryItem
   : public ctkAbstractFactoryFileBasedItem<qSlicerAbstractCoreModule>
 {
 public:
-  qSlicerCLIExecutableModuleFactoryItem(const QString& newTempDirectory);
+  qSlicerCLIExecutableModuleFactoryItem(const QString& newTempDirectory,
+    const QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache>& descriptionCache =
+      QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache>());
+  /// Look up the XML description in the description cache. If the module
+  /// has no XML file and is not in the cache, prepare running the CLI
+  /// executable with "--xml", see startXmlDescriptionRequest().
   virtual bool load();
   virtual void uninstantiate();
+  /// Start running the CLI executable with "--xml" in the global thread pool
+  /// if load() prepared it, so that the descriptions of all the modules
+  /// are retrieved in parallel. Nothing is run for modules that are never
+  /// instantiated (e.g. ignored modules).
+  void startXmlDescriptionRequest();
 protected:
   /// Return path of the expected XML file.
   QString xmlModuleDescriptionFilePath();
 
   virtual qSlicerAbstractCoreModule* instanciator();
+  /// Wait for the CLI executable run with "--xml" and return its output.
+  /// The CLI is run in the calling thread if load() did not start it.
   QString runCLIWithXmlArgument();
 private:
   QString TempDirectory;
   qSlicerCLIModule* CLIModule;
+  QSharedPointer<qSlicerCLIExecutableModuleDescriptionCache> DescriptionCache;
+  QSharedPointer<qSlicerCLIXmlDescriptionRequest> XmlDescriptionRequest;
+  QString CachedXmlDescription;
 };
 
 class qSlicerCLIExecutableModuleFactoryPrivate;
@@ -71,6 +92,21 @@ public:
 
   void setTempDirectory(const QString& newTempDirectory);
 
+  /// Start the "--xml" runs of all the registered executables that are not
+  /// in the description cache before instantiating the module.
+  virtual qSlicerAbstractCoreModule* instantiate(const QString& itemKey);
+
+  /// Set the file where the XML descriptions retrieved by running the CLI
+  /// executables with "--xml" are saved across sessions. An entry is reused
+  /// as long as the path, the last modification time and the size of the
+  /// executable are unchanged. Descriptions are saved only if the
+  /// executable ran without error and they can be parsed. Entries of
+  /// executables that have been removed or changed are pruned when the
+  /// file is set.
+  /// The cache is disabled if \a filePath is empty (default).
+  void setDescriptionCacheFilePath(const QString& filePath);
+  QString descriptionCacheFilePath()const;
+
 protected:
   virtual bool isValidFile(const QFileInfo& file)const;
 
@@ -107,6 +107,17 @@ vtkMRMLAbstractLogic* qSlicerCLIModule::createLogic()
     logic->SetAllowInMemoryTransfer(0);
     }
 
+  // Executables must read and write their images with ITK to use shared
+  // memory transfer: built-in CLIs do, and are enabled by the application
+  // setting. Other executables opt in with the module parameter.
+  bool allowSharedMemoryTransfer =
+    settings.value("Modules/AllowSharedMemoryTransfer", false).toBool();
+  if ((allowSharedMemoryTransfer && this->isBuiltIn())
+      || d->Desc.GetParameterValue("AllowSharedMemoryTransfer") == "true")
+    {
+    logic->SetAllowSharedMemoryTransfer(1);
+    }
+
   return logic;
 }
 
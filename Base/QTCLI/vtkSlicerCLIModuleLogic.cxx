@@ -12,6 +12,7 @@
 
 #include "vtkSlicerCLIModuleLogic.h"
 
+#include "vtkSlicerSharedMemoryVolumeIO.h"
 #include "vtkSlicerTask.h"
 
 // SlicerExecutionModel includes
@@ -30,6 +31,7 @@
 #include <vtkMRMLStorageNode.h>
 #include <vtkMRMLModelStorageNode.h>
 #include <vtkMRMLTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
 
 // VTK includes
 #include <vtkCallbackCommand.h>
@@ -45,6 +47,10 @@
 #include <itksys/SystemTools.hxx>
 #include <itksys/RegularExpression.hxx>
 
+// ITK includes
+#include <itkMutexLock.h>
+#include <itkMutexLockHolder.h>
+
 // QT includes
 #include <QDebug>
 
@@ -81,6 +87,33 @@ struct DigitsToCharacters
 typedef std::pair<vtkSlicerCLIModuleLogic *, vtkMRMLCommandLineModuleNode *> LogicNodePair;
 class MRMLIDMap : public std::map<std::string, std::string> {};
 
+namespace
+{
+// CLIs may run concurrently in several processing threads. The process
+// environment and the standard streams are shared by all of them.
+itk::SimpleMutexLock EnvironmentLock;
+itk::SimpleMutexLock StandardStreamsLock;
+
+// Shared memory objects are created exclusively, every image exchanged
+// through shared memory gets a new name.
+itk::SimpleMutexLock SharedMemoryNameLock;
+unsigned long SharedMemoryNameCounter = 0;
+
+//----------------------------------------------------------------------------
+// Scheduling hints are hidden parameters of the module description: they
+// have neither flag nor index and are never passed to the module.
+int GetSchedulingHint(const ModuleDescription& description,
+                      const std::string& name, int defaultValue)
+{
+  if (!description.HasParameter(name))
+    {
+    return defaultValue;
+    }
+  std::string value = description.GetParameterValue(name);
+  return value.empty() ? defaultValue : atoi(value.c_str());
+}
+}
+
 //---------------------------------------------------------------------------
 class vtkSlicerCLIRescheduleCallback : public vtkCallbackCommand
 {
@@ -91,8 +124,11 @@ public:
   }
   virtual void Execute(vtkObject* caller, unsigned long eid, void *callData)
   {
-    if (std::find(this->ThreadIDs.begin(), this->ThreadIDs.end(),
-                  vtkMultiThreader::GetCurrentThreadID()) != this->ThreadIDs.end())
+    this->ThreadIDsLock.Lock();
+    bool reschedule = std::find(this->ThreadIDs.begin(), this->ThreadIDs.end(),
+      vtkMultiThreader::GetCurrentThreadID()) != this->ThreadIDs.end();
+    this->ThreadIDsLock.Unlock();
+    if (reschedule)
       {
       if (this->CLIModuleLogic)
         {
@@ -128,13 +164,16 @@ public:
       {
       return;
       }
+    itk::MutexLockHolder<itk::SimpleMutexLock> lock(this->ThreadIDsLock);
     if (reschedule)
       {
       this->ThreadIDs.push_back(id);
       }
     else
       {
-      std::remove(this->ThreadIDs.begin(), this->ThreadIDs.end(), id);
+      this->ThreadIDs.erase(
+        std::remove(this->ThreadIDs.begin(), this->ThreadIDs.end(), id),
+        this->ThreadIDs.end());
       }
   }
 protected:
@@ -151,6 +190,7 @@ protected:
   vtkSlicerCLIModuleLogic* CLIModuleLogic;
   int Delay;
   std::vector<vtkMultiThreaderIDType> ThreadIDs;
+  itk::SimpleMutexLock ThreadIDsLock;
 };
 
 //---------------------------------------------------------------------------
@@ -198,6 +238,7 @@ public:
   ModuleDescription DefaultModuleDescription;
   int DeleteTemporaryFiles;
   int AllowInMemoryTransfer;
+  int AllowSharedMemoryTransfer;
 
   int RedirectModuleStreams;
 
@@ -228,6 +269,7 @@ public:
 
   void SetLastRequest(vtkMRMLCommandLineModuleNode* node, vtkMTimeType requestUID)
   {
+    itk::MutexLockHolder<itk::SimpleMutexLock> lock(this->LastRequestsLock);
     RequestType::iterator it = std::find_if(
       this->LastRequests.begin(), this->LastRequests.end(), FindRequest(node));
     if (it == this->LastRequests.end())
@@ -242,6 +284,7 @@ public:
   }
   vtkMTimeType GetLastRequest(vtkMRMLCommandLineModuleNode* node)
   {
+    itk::MutexLockHolder<itk::SimpleMutexLock> lock(this->LastRequestsLock);
     RequestType::iterator it = std::find_if(
       this->LastRequests.begin(), this->LastRequests.end(), FindRequest(node));
     return (it != this->LastRequests.end())? it->first : 0;
@@ -284,6 +327,8 @@ public:
   /// List of read data/scene requests of the CLI nodes
   /// being executed with their.
   RequestType LastRequests;
+  /// CLI nodes are executed concurrently in the processing threads
+  itk::SimpleMutexLock LastRequestsLock;
 
   vtkSmartPointer<vtkSlicerCLIRescheduleCallback> RescheduleCallback;
   vtkSmartPointer<vtkSlicerCLIOneShotCallbackCallback>OneShotCallbackCallback;
@@ -300,6 +345,7 @@ vtkSlicerCLIModuleLogic::vtkSlicerCLIModuleLogic()
   this->Internal->ProcessesKillLock = itk::MutexLock::New();
   this->Internal->DeleteTemporaryFiles = 1;
   this->Internal->AllowInMemoryTransfer = 1;
+  this->Internal->AllowSharedMemoryTransfer = 0;
   this->Internal->RedirectModuleStreams = 1;
   this->Internal->RescheduleCallback =
     vtkSmartPointer<vtkSlicerCLIRescheduleCallback>::New();
@@ -403,6 +449,22 @@ int vtkSlicerCLIModuleLogic::GetAllowInMemoryTransfer() const
   return this->Internal->AllowInMemoryTransfer;
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SetAllowSharedMemoryTransfer(int value)
+{
+  vtkDebugMacro(<< this->GetClassName() << " (" << this << "): setting AllowSharedMemoryTransfer to " << value);
+  if (this->Internal->AllowSharedMemoryTransfer != value)
+    {
+    this->Internal->AllowSharedMemoryTransfer = value;
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerCLIModuleLogic::GetAllowSharedMemoryTransfer() const
+{
+  return this->Internal->AllowSharedMemoryTransfer;
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerCLIModuleLogic::RedirectModuleStreamsOn()
 {
@@ -486,7 +548,8 @@ vtkSlicerCLIModuleLogic
                              const std::string& type,
                              const std::string& name,
                              const std::vector<std::string>& extensions,
-                             CommandLineModuleType commandType)
+                             CommandLineModuleType commandType,
+                             const std::string& cliNodeID)
 {
   std::string fname = name;
   std::string pid;
@@ -512,10 +575,16 @@ vtkSlicerCLIModuleLogic
   // encoded to the same filename every time within that running
   // instance of Slicer).  This last point is an optimization to
   // minimize the number of times a file is written when running a
-  // module.  However, if we change the execution model such that more
-  // than one module can run at the same time within the same Slicer
-  // process, then this encoding will need to be changed to be unique
-  // per module execution.
+  // module.  As more than one module can run at the same time within
+  // the same Slicer process, the ID of the executed CLI node is encoded
+  // as well.
+  //
+  // 4. If the consumer of the file is an executable and shared memory
+  // transfer is allowed, images are encoded as shm:/Slicer_%pid_%s_%n, a
+  // POSIX shared memory object read and written by the
+  // itk::SharedMemoryImageIO of the executable. The name encodes the pid,
+  // the executed CLI node and the node like temporary files, followed by
+  // a counter: objects are created exclusively and never reused.
   //
 
   // Encode process id into a string.  To avoid confusing the
@@ -535,6 +604,12 @@ vtkSlicerCLIModuleLogic
     return fname;
     }
 
+  // CLIs can run concurrently, encode the executed CLI node
+  if (!cliNodeID.empty())
+    {
+    fname = cliNodeID + "_" + fname;
+    }
+
   // To avoid confusing the Archetype readers, convert any
   // numbers in the filename to characters [0-9]->[A-J]
   std::transform(fname.begin(), fname.end(),
@@ -548,11 +623,29 @@ vtkSlicerCLIModuleLogic
     {
     temporaryDirectory = appLogic->GetTemporaryPath();
     }
+  std::string sharedMemoryName = "shm:/Slicer_" + pid + "_" + fname;
   fname = temporaryDirectory + "/" + pid + "_" + fname;
 
   if (tag == "image")
     {
     if ( commandType == CommandLineModule
+         && type != "dynamic-contrast-enhanced"
+         && this->GetAllowSharedMemoryTransfer() != 0
+         && this->GetMRMLScene()
+         && vtkSlicerSharedMemoryVolumeIO::CanTransferNode(
+              this->GetMRMLScene()->GetNodeByID(name.c_str())))
+      {
+      // If running an executable that can map the image from shared
+      // memory, there is no need to go through the disk.
+      std::ostringstream counterString;
+      SharedMemoryNameLock.Lock();
+      counterString << ++SharedMemoryNameCounter;
+      SharedMemoryNameLock.Unlock();
+      std::string counter = counterString.str();
+      std::transform(counter.begin(), counter.end(), counter.begin(), DigitsToCharacters());
+      fname = sharedMemoryName + "_" + counter;
+      }
+    else if ( commandType == CommandLineModule
          || type == "dynamic-contrast-enhanced"
          || this->GetAllowInMemoryTransfer() == 0)
       {
@@ -716,18 +809,27 @@ void vtkSlicerCLIModuleLogic::Apply ( vtkMRMLCommandLineModuleNode* node, bool u
   node->Register(this);
   node->SetAttribute("UpdateDisplay", updateDisplay ? "true" : "false");
 
+  // Scheduling hints from the module description, see GetSchedulingHint()
+  const ModuleDescription& description = node->GetModuleDescription();
+  task->SetPriority(GetSchedulingHint(description, "SchedulingPriority", 0));
+  task->SetNumberOfThreads(GetSchedulingHint(description, "SchedulingNumberOfThreads", 1));
+  // the hint is in megabytes
+  task->SetMemorySize(static_cast<vtkIdType>(GetSchedulingHint(description, "SchedulingMemorySize", 0)) * 1024 * 1024);
+
+  // The task may start in another processing thread as soon as it is
+  // scheduled, the status must be set before.
+  int oldStatus = node->GetStatus();
+  node->SetOutputText("", false);
+  node->SetErrorText("", false);
+  node->SetStatus(vtkMRMLCommandLineModuleNode::Scheduled);
+
   // Schedule the task
   ret = this->GetApplicationLogic()->ScheduleTask( task.GetPointer() );
 
   if (!ret)
     {
     vtkWarningMacro( << "Could not schedule task" );
-    }
-  else
-    {
-    node->SetOutputText("", false);
-    node->SetErrorText("", false);
-    node->SetStatus(vtkMRMLCommandLineModuleNode::Scheduled);
+    node->SetStatus(oldStatus);
     }
 }
 
@@ -963,7 +1065,8 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
                                              (*pit).GetType(),
                                              id,
                                              (*pit).GetFileExtensions(),
-                                             commandType);
+                                             commandType,
+                                             node0->GetID());
 
         filesToDelete.insert(fname);
         if ((*pit).GetChannel() == "input")
@@ -1114,6 +1217,30 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
         }
       }
 
+    // Volumes exchanged with an executable through shared memory do not
+    // need a storage node
+    if (out && vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName((*id2fn0).second.c_str()))
+      {
+      if (vtkSlicerSharedMemoryVolumeIO::WriteVolume(
+            vtkMRMLVolumeNode::SafeDownCast(nd), (*id2fn0).second.c_str()))
+        {
+        out = 0;
+        }
+      else
+        {
+        // Not enough shared memory (or any other failure): go through
+        // a temporary file instead. The command line is built later from
+        // nodesToWrite, so the executable is given the file.
+        // "shm:/Slicer_..." -> "<TemporaryDirectory>/Slicer_....nrrd"
+        std::string fileName = temporaryDirectory + "/"
+          + (*id2fn0).second.substr((*id2fn0).second.find('/') + 1) + ".nrrd";
+        vtkWarningMacro("Unable to write " << (*id2fn0).second
+                        << " to shared memory, using " << fileName << " instead");
+        nodesToWrite[(*id2fn0).first] = fileName;
+        filesToDelete.insert(fileName);
+        }
+      }
+
     // if the file is to be written, then write it
     if (out)
       {
@@ -1836,6 +1963,7 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
     // statically linked to the executable.
     // Historically, there was an nvidia driver bug that causes the module
     // to fail on exit with undefined symbol.
+     EnvironmentLock.Lock();
      std::string saveITKAutoLoadPath;
      itksys::SystemTools::GetEnv("ITK_AUTOLOAD_PATH", saveITKAutoLoadPath);
      std::string emptyString("ITK_AUTOLOAD_PATH=");
@@ -1850,7 +1978,9 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
     //
     itksysProcess *process = itksysProcess_New();
 
+    this->Internal->ProcessesKillLock->Lock();
     this->Internal->Processes.push_back(process);
+    this->Internal->ProcessesKillLock->Unlock();
 
     // setup the command
     itksysProcess_SetCommand(process, command);
@@ -1872,6 +2002,7 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
       {
       vtkErrorMacro( "Unable to restore ITK_AUTOLOAD_PATH. ");
       }
+    EnvironmentLock.Unlock();
 
     // Wait for the command to finish
     char *tbuffer;
@@ -1898,8 +2029,10 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
       if (node0->GetModuleDescription().GetProcessInformation()->Abort)
         {
         itksysProcess_Kill(process);
+        this->Internal->ProcessesKillLock->Lock();
         this->Internal->Processes.erase(
               std::find(this->Internal->Processes.begin(), this->Internal->Processes.end(), process));
+        this->Internal->ProcessesKillLock->Unlock();
         node0->GetModuleDescription().GetProcessInformation()->Progress = 0;
         node0->GetModuleDescription().GetProcessInformation()->StageProgress =0;
         this->GetApplicationLogic()->RequestModified( node0 );
@@ -2156,6 +2289,10 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
     //
     //
 
+    // The standard streams are redirected for the whole process, only one
+    // shared object module can run at a time.
+    itk::MutexLockHolder<itk::SimpleMutexLock> streamsLock(StandardStreamsLock);
+
     std::ostringstream coutstringstream;
     std::ostringstream cerrstringstream;
     std::streambuf* origcoutrdbuf = std::cout.rdbuf();
@@ -2546,7 +2683,13 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
     std::set<std::string>::iterator fit;
     for (fit = filesToDelete.begin(); fit != filesToDelete.end(); ++fit)
       {
-      if (itksys::SystemTools::FileExists((*fit).c_str()))
+      if (vtkSlicerSharedMemoryVolumeIO::IsSharedMemoryFileName((*fit).c_str()))
+        {
+        // Inputs may not have been written if the module was cancelled,
+        // ignore objects that do not exist.
+        vtkSlicerSharedMemoryVolumeIO::RemoveVolume((*fit).c_str());
+        }
+      else if (itksys::SystemTools::FileExists((*fit).c_str()))
         {
         removed = itksys::SystemTools::RemoveFile((*fit).c_str());
         if (!removed)
@@ -2718,16 +2861,22 @@ void vtkSlicerCLIModuleLogic::ProcessMRMLLogicsEvents(vtkObject* caller,
       event == vtkSlicerApplicationLogic::RequestProcessedEvent)
     {
     vtkMTimeType uid = reinterpret_cast<vtkMTimeType>(callData);
+    vtkMRMLCommandLineModuleNode* node = 0;
+    this->Internal->LastRequestsLock.Lock();
     vtkInternal::RequestType::iterator it =
       std::find_if(this->Internal->LastRequests.begin(),
       this->Internal->LastRequests.end(), vtkInternal::FindRequest(uid));
     if (it != this->Internal->LastRequests.end())
       {
-      vtkMRMLCommandLineModuleNode* node = it->second;
+      node = it->second;
+      this->Internal->LastRequests.erase(it);
+      }
+    this->Internal->LastRequestsLock.Unlock();
+    if (node)
+      {
       // If the status is not Completing, then there should be no request made
       // on the application logic.
       assert(node->GetStatus() == vtkMRMLCommandLineModuleNode::Completing);
-      this->Internal->LastRequests.erase(it);
       // we are not interested in any request anymore because the cli node is
       // Completed.
 
@@ -80,6 +80,15 @@ public:
   void SetAllowInMemoryTransfer(int value);
   int GetAllowInMemoryTransfer() const;
 
+  /// Control use of POSIX shared memory instead of temporary files to
+  /// exchange scalar, label map and vector volumes with an executable CLI.
+  /// The executable must read and write its images with ITK and link
+  /// ITKFactoryRegistration (which registers itk::SharedMemoryImageIO).
+  /// Off by default. Ignored on platforms without shared memory support.
+  /// \sa vtkSlicerSharedMemoryVolumeIO
+  void SetAllowSharedMemoryTransfer(int value);
+  int GetAllowSharedMemoryTransfer() const;
+
   /// For debugging, control redirection of cout and cerr
   virtual void RedirectModuleStreamsOn();
   virtual void RedirectModuleStreamsOff();
@@ -89,6 +98,11 @@ public:
   /// Schedules the command line module to run.
   /// The CLI is scheduled to be run in a separate thread. This methods
   /// is non blocking and returns immediately.
+  /// The module description can declare the integer parameters
+  /// "SchedulingPriority", "SchedulingNumberOfThreads" and
+  /// "SchedulingMemorySize" (in MB), without flag nor index, to control
+  /// when the CLI runs relative to other processing tasks.
+  /// \sa vtkSlicerTask, vtkSlicerApplicationLogic::ScheduleTask()
   /// If \a updateDisplay is 'true' the selection node will be updated with the
   /// the created nodes, which would automatically select the created nodes
   /// in the node selectors.
@@ -123,11 +137,14 @@ protected:
   void ProcessMRMLLogicsEvents(vtkObject*, long unsigned int, void*) VTK_OVERRIDE;
 
 
+  /// \a cliNodeID is the ID of the CLI node being executed, it makes the
+  /// file name unique when several CLIs run concurrently on the same node.
   std::string ConstructTemporaryFileName(const std::string& tag,
                                          const std::string& type,
                                          const std::string& name,
                                      const std::vector<std::string>& extensions,
-                                     CommandLineModuleType commandType);
+                                     CommandLineModuleType commandType,
+                                     const std::string& cliNodeID = std::string());
   std::string ConstructTemporarySceneFileName(vtkMRMLScene *scene);
   std::string FindHiddenNodeID(const ModuleDescription& d,
                                const ModuleParameter& p);
@@ -303,6 +303,9 @@ void qSlicerCoreApplicationPrivate::init()
     QString userInfoString = q->userSettings()->value("UserInformation").toString();
     userInfo->SetFromString(userInfoString.toLatin1().constData());
     }
+  // Number of CLI modules (and other processing tasks) allowed to run concurrently
+  this->AppLogic->SetMaximumNumberOfProcessingTasks(
+    q->userSettings()->value("Modules/MaximumNumberOfProcessingTasks", 1).toInt());
   q->qvtkConnect(this->AppLogic, vtkCommand::ModifiedEvent,
               q, SLOT(onSlicerApplicationLogicModified()));
   q->qvtkConnect(this->AppLogic, vtkSlicerApplicationLogic::RequestInvokeEvent,
@@ -120,6 +120,7 @@ void qSlicerSettingsModulesPanelPrivate::init()
 
   // Default values
   this->PreferExecutableCLICheckBox->setChecked(Slicer_CLI_PREFER_EXECUTABLE_DEFAULT);
+  this->AllowSharedMemoryTransferCheckBox->setChecked(false);
   this->TemporaryDirectoryButton->setDirectory(coreApp->defaultTemporaryPath());
   this->DisableModulesListView->setFactoryManager( factoryManager );
   this->FavoritesModulesListView->setFactoryManager( factoryManager );
@@ -154,6 +155,8 @@ void qSlicerSettingsModulesPanelPrivate::init()
 
   q->registerProperty("Modules/PreferExecutableCLI", this->PreferExecutableCLICheckBox,
                       "checked", SIGNAL(toggled(bool)));
+  q->registerProperty("Modules/AllowSharedMemoryTransfer", this->AllowSharedMemoryTransferCheckBox,
+                      "checked", SIGNAL(toggled(bool)));
   q->registerProperty("Modules/HomeModule", this->ModulesMenu,
                       "currentModule", SIGNAL(currentModuleChanged(QString)));
   q->registerProperty("Modules/FavoriteModules", this->FavoritesModulesListView->filterModel(),
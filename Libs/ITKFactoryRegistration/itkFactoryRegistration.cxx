@@ -1,10 +1,29 @@
 
 #include "itkFactoryRegistration.h"
+#include "itkSharedMemoryImageIOFactory.h"
 
 // ITK includes
 #include <itkImageFileReader.h>
 #include <itkTransformFileReader.h>
 
+namespace
+{
+// Register the shared memory ImageIO when the library is loaded so that
+// command line modules can exchange images with Slicer without files.
+class SharedMemoryImageIOFactoryRegistration
+{
+public:
+  SharedMemoryImageIOFactoryRegistration()
+  {
+    if (itk::SharedMemoryImageIO::IsSupported())
+      {
+      itk::SharedMemoryImageIOFactory::RegisterOneFactory();
+      }
+  }
+};
+SharedMemoryImageIOFactoryRegistration SharedMemoryImageIOFactoryRegistrationInstance;
+}
+
 // The following code is required to ensure that the
 // mechanism allowing the ITK factory to be registered is not
 // optimized out by the compiler.
@@ -0,0 +1,385 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#include "itkSharedMemoryImageIO.h"
+
+// ITK includes
+#include <itkIntTypes.h>
+
+// STD includes
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace
+{
+
+const char SHARED_MEMORY_SCHEME[] = "shm:";
+const char SHARED_MEMORY_MAGIC[8] = "SLCRSHM";
+const unsigned int SHARED_MEMORY_VERSION = 1;
+const unsigned int SHARED_MEMORY_MAXIMUM_DIMENSION = 3;
+
+//----------------------------------------------------------------------------
+// Layout of the beginning of the shared memory object. Geometry is in LPS,
+// as in any other ITK ImageIO.
+struct SharedMemoryImageHeader
+{
+  char Magic[8];
+  itk::uint32_t Version;
+  itk::uint32_t NumberOfDimensions;
+  itk::uint32_t NumberOfComponents;
+  itk::int32_t ComponentType;
+  itk::int32_t PixelType;
+  itk::uint64_t Dimensions[SHARED_MEMORY_MAXIMUM_DIMENSION];
+  double Spacing[SHARED_MEMORY_MAXIMUM_DIMENSION];
+  double Origin[SHARED_MEMORY_MAXIMUM_DIMENSION];
+  double Direction[SHARED_MEMORY_MAXIMUM_DIMENSION * SHARED_MEMORY_MAXIMUM_DIMENSION];
+  itk::uint64_t DataSize;
+};
+
+// Voxels start on a cache line boundary after the header
+const size_t SHARED_MEMORY_DATA_OFFSET = ((sizeof(SharedMemoryImageHeader) + 63) / 64) * 64;
+
+//----------------------------------------------------------------------------
+std::string GetSharedMemoryObjectName(const std::string& fileName)
+{
+  // "shm:/name" -> "/name"
+  return fileName.substr(sizeof(SHARED_MEMORY_SCHEME) - 1);
+}
+
+#ifndef _WIN32
+//----------------------------------------------------------------------------
+// Maps a named shared memory object for the lifetime of the instance.
+class SharedMemoryMapping
+{
+public:
+  SharedMemoryMapping()
+    : Address(MAP_FAILED)
+    , Size(0)
+  {
+  }
+
+  ~SharedMemoryMapping()
+  {
+    if (this->Address != MAP_FAILED)
+      {
+      munmap(this->Address, this->Size);
+      }
+  }
+
+  /// Map an existing object read-only if \a createSize is 0, otherwise
+  /// create a new object of \a createSize bytes and map it read-write.
+  /// Creation fails if an object with the same name already exists, so
+  /// that an object created by another process is never overwritten.
+  bool Map(const std::string& objectName, size_t createSize)
+  {
+    bool create = (createSize > 0);
+    int fd = create
+      ? shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR)
+      : shm_open(objectName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      {
+      return false;
+      }
+    if (create)
+      {
+      if (ftruncate(fd, static_cast<off_t>(createSize)) != 0)
+        {
+        int error = errno;
+        close(fd);
+        shm_unlink(objectName.c_str());
+        errno = error;
+        return false;
+        }
+#ifdef __linux__
+      // ftruncate leaves the object sparse: writing to pages that cannot be
+      // backed later (e.g. /dev/shm is full) raises SIGBUS instead of
+      // failing. Reserve all the pages now so that creation fails cleanly.
+      int error = posix_fallocate(fd, 0, static_cast<off_t>(createSize));
+      if (error != 0)
+        {
+        close(fd);
+        shm_unlink(objectName.c_str());
+        errno = error;
+        return false;
+        }
+#endif
+      this->Size = createSize;
+      }
+    else
+      {
+      struct stat status;
+      if (fstat(fd, &status) != 0)
+        {
+        close(fd);
+        return false;
+        }
+      this->Size = static_cast<size_t>(status.st_size);
+      }
+    if (this->Size < SHARED_MEMORY_DATA_OFFSET)
+      {
+      close(fd);
+      return false;
+      }
+    this->Address = mmap(NULL, this->Size, create ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                         MAP_SHARED, fd, 0);
+    int error = errno;
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (this->Address == MAP_FAILED && create)
+      {
+      shm_unlink(objectName.c_str());
+      }
+    errno = error;
+    return this->Address != MAP_FAILED;
+  }
+
+  SharedMemoryImageHeader* GetHeader() const
+  {
+    return static_cast<SharedMemoryImageHeader*>(this->Address);
+  }
+
+  char* GetData() const
+  {
+    return static_cast<char*>(this->Address) + SHARED_MEMORY_DATA_OFFSET;
+  }
+
+  /// Returns true if the header was written by a compatible writer and
+  /// the voxels fit in the mapping.
+  bool IsValid() const
+  {
+    SharedMemoryImageHeader* header = this->GetHeader();
+    return memcmp(header->Magic, SHARED_MEMORY_MAGIC, sizeof(SHARED_MEMORY_MAGIC)) == 0
+      && header->Version == SHARED_MEMORY_VERSION
+      && header->NumberOfDimensions >= 1
+      && header->NumberOfDimensions <= SHARED_MEMORY_MAXIMUM_DIMENSION
+      && header->DataSize <= this->Size - SHARED_MEMORY_DATA_OFFSET;
+  }
+
+  void* Address;
+  size_t Size;
+
+private:
+  SharedMemoryMapping(const SharedMemoryMapping&); //purposely not implemented
+  void operator=(const SharedMemoryMapping&); //purposely not implemented
+};
+#endif
+
+} // end of anonymous namespace
+
+namespace itk
+{
+
+//----------------------------------------------------------------------------
+SharedMemoryImageIO
+::SharedMemoryImageIO()
+{
+}
+
+//----------------------------------------------------------------------------
+SharedMemoryImageIO
+::~SharedMemoryImageIO()
+{
+}
+
+//----------------------------------------------------------------------------
+bool
+SharedMemoryImageIO
+::IsSupported()
+{
+#ifdef _WIN32
+  return false;
+#else
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool
+SharedMemoryImageIO
+::IsSharedMemoryFileName(const char* filename)
+{
+  return filename != NULL
+    && strncmp(filename, SHARED_MEMORY_SCHEME, sizeof(SHARED_MEMORY_SCHEME) - 1) == 0
+    && filename[sizeof(SHARED_MEMORY_SCHEME) - 1] == '/'
+    && filename[sizeof(SHARED_MEMORY_SCHEME)] != '\0';
+}
+
+//----------------------------------------------------------------------------
+bool
+SharedMemoryImageIO
+::RemoveSharedMemory(const char* filename)
+{
+  if (!IsSupported() || !IsSharedMemoryFileName(filename))
+    {
+    return false;
+    }
+#ifdef _WIN32
+  return false;
+#else
+  return shm_unlink(GetSharedMemoryObjectName(filename).c_str()) == 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool
+SharedMemoryImageIO
+::CanReadFile(const char* filename)
+{
+  return IsSupported() && IsSharedMemoryFileName(filename);
+}
+
+//----------------------------------------------------------------------------
+void
+SharedMemoryImageIO
+::ReadImageInformation()
+{
+#ifdef _WIN32
+  itkExceptionMacro("Shared memory images are not supported on this platform");
+#else
+  SharedMemoryMapping mapping;
+  if (!mapping.Map(GetSharedMemoryObjectName(m_FileName), 0))
+    {
+    itkExceptionMacro("Unable to open shared memory image " << m_FileName
+                      << ": " << strerror(errno));
+    }
+  if (!mapping.IsValid())
+    {
+    itkExceptionMacro("Shared memory object " << m_FileName << " does not contain a valid image");
+    }
+
+  const SharedMemoryImageHeader* header = mapping.GetHeader();
+  this->SetNumberOfDimensions(header->NumberOfDimensions);
+  this->SetNumberOfComponents(header->NumberOfComponents);
+  this->SetComponentType(static_cast<IOComponentType>(header->ComponentType));
+  this->SetPixelType(static_cast<IOPixelType>(header->PixelType));
+  for (unsigned int i = 0; i < header->NumberOfDimensions; ++i)
+    {
+    this->SetDimensions(i, static_cast<SizeValueType>(header->Dimensions[i]));
+    this->SetSpacing(i, header->Spacing[i]);
+    this->SetOrigin(i, header->Origin[i]);
+    std::vector<double> direction(header->NumberOfDimensions);
+    for (unsigned int j = 0; j < header->NumberOfDimensions; ++j)
+      {
+      direction[j] = header->Direction[i * SHARED_MEMORY_MAXIMUM_DIMENSION + j];
+      }
+    this->SetDirection(i, direction);
+    }
+
+  if (header->DataSize != this->GetImageSizeInBytes())
+    {
+    itkExceptionMacro("Shared memory image " << m_FileName << " holds " << header->DataSize
+                      << " bytes of data, expected " << this->GetImageSizeInBytes());
+    }
+#endif
+}
+
+//----------------------------------------------------------------------------
+void
+SharedMemoryImageIO
+::Read(void* buffer)
+{
+#ifdef _WIN32
+  (void)buffer;
+  itkExceptionMacro("Shared memory images are not supported on this platform");
+#else
+  SharedMemoryMapping mapping;
+  if (!mapping.Map(GetSharedMemoryObjectName(m_FileName), 0) || !mapping.IsValid())
+    {
+    itkExceptionMacro("Unable to read shared memory image " << m_FileName);
+    }
+  if (mapping.GetHeader()->DataSize != this->GetImageSizeInBytes())
+    {
+    itkExceptionMacro("Shared memory image " << m_FileName << " was modified while reading");
+    }
+  memcpy(buffer, mapping.GetData(), this->GetImageSizeInBytes());
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool
+SharedMemoryImageIO
+::CanWriteFile(const char* filename)
+{
+  return IsSupported() && IsSharedMemoryFileName(filename);
+}
+
+//----------------------------------------------------------------------------
+void
+SharedMemoryImageIO
+::WriteImageInformation()
+{
+}
+
+//----------------------------------------------------------------------------
+void
+SharedMemoryImageIO
+::Write(const void* buffer)
+{
+#ifdef _WIN32
+  (void)buffer;
+  itkExceptionMacro("Shared memory images are not supported on this platform");
+#else
+  const unsigned int numberOfDimensions = this->GetNumberOfDimensions();
+  if (numberOfDimensions < 1 || numberOfDimensions > SHARED_MEMORY_MAXIMUM_DIMENSION)
+    {
+    itkExceptionMacro("Shared memory images support 1 to " << SHARED_MEMORY_MAXIMUM_DIMENSION
+                      << " dimensions, got " << numberOfDimensions);
+    }
+
+  const SizeType dataSize = this->GetImageSizeInBytes();
+  SharedMemoryMapping mapping;
+  if (!mapping.Map(GetSharedMemoryObjectName(m_FileName), SHARED_MEMORY_DATA_OFFSET + dataSize))
+    {
+    itkExceptionMacro("Unable to create shared memory image " << m_FileName
+                      << ": " << strerror(errno));
+    }
+
+  SharedMemoryImageHeader* header = mapping.GetHeader();
+  memset(header, 0, sizeof(SharedMemoryImageHeader));
+  header->Version = SHARED_MEMORY_VERSION;
+  header->NumberOfDimensions = numberOfDimensions;
+  header->NumberOfComponents = this->GetNumberOfComponents();
+  header->ComponentType = static_cast<itk::int32_t>(this->GetComponentType());
+  header->PixelType = static_cast<itk::int32_t>(this->GetPixelType());
+  for (unsigned int i = 0; i < numberOfDimensions; ++i)
+    {
+    header->Dimensions[i] = this->GetDimensions(i);
+    header->Spacing[i] = this->GetSpacing(i);
+    header->Origin[i] = this->GetOrigin(i);
+    std::vector<double> direction = this->GetDirection(i);
+    for (unsigned int j = 0; j < numberOfDimensions && j < direction.size(); ++j)
+      {
+      header->Direction[i * SHARED_MEMORY_MAXIMUM_DIMENSION + j] = direction[j];
+      }
+    }
+  header->DataSize = dataSize;
+  memcpy(mapping.GetData(), buffer, dataSize);
+
+  // Magic is written last so that a partially written object is never valid
+  memcpy(header->Magic, SHARED_MEMORY_MAGIC, sizeof(SHARED_MEMORY_MAGIC));
+#endif
+}
+
+//----------------------------------------------------------------------------
+void
+SharedMemoryImageIO
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Supported: " << (IsSupported() ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
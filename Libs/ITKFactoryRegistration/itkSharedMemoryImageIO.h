@@ -0,0 +1,99 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#ifndef itkSharedMemoryImageIO_h
+#define itkSharedMemoryImageIO_h
+
+#include "itkFactoryRegistrationConfigure.h"
+
+#include "itkImageIOBase.h"
+
+namespace itk
+{
+/** \class SharedMemoryImageIO
+ * \brief ImageIO object for exchanging images through POSIX shared memory
+ *
+ * SharedMemoryImageIO allows an executable command line module to read
+ * its input images from, and write its output images to, a named POSIX
+ * shared memory object created by Slicer instead of a temporary file.
+ * The image is transferred with a single memory copy and never touches
+ * the disk.
+ *
+ * The "filename" specified will look like:
+ *     <code>shm:/\<shared memory object name\></code>
+ *
+ * The shared memory object starts with a fixed size header describing the
+ * image geometry (in LPS), pixel and component types, followed by the
+ * voxels. Writing creates the object and fails if it already exists, it
+ * is never unlinked by this class: the process that chose the name
+ * (Slicer) is responsible for removing it with RemoveSharedMemory().
+ *
+ * Shared memory is not supported on Windows, CanReadFile() and
+ * CanWriteFile() always return false there.
+ */
+class ITKFactoryRegistration_EXPORT SharedMemoryImageIO : public ImageIOBase
+{
+public:
+  /** Standard class typedefs. */
+  typedef SharedMemoryImageIO Self;
+  typedef ImageIOBase         Superclass;
+  typedef SmartPointer<Self>  Pointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SharedMemoryImageIO, ImageIOBase);
+
+  /** Determine the file type. Returns true if this ImageIO can read the
+   * file specified. */
+  virtual bool CanReadFile(const char*) ITK_OVERRIDE;
+
+  /** Set the spacing and dimension information for the set filename. */
+  virtual void ReadImageInformation() ITK_OVERRIDE;
+
+  /** Reads the data from shared memory into the memory buffer provided. */
+  virtual void Read(void* buffer) ITK_OVERRIDE;
+
+  /*-------- This part of the interfaces deals with writing data. ----- */
+
+  /** Determine the file type. Returns true if this ImageIO can write the
+   * file specified. */
+  virtual bool CanWriteFile(const char*) ITK_OVERRIDE;
+
+  /** The header is written along with the voxels in Write(). */
+  virtual void WriteImageInformation() ITK_OVERRIDE;
+
+  /** Writes the header and the data from the memory buffer provided into
+   * a newly created shared memory object. Throws if the object exists. */
+  virtual void Write(const void* buffer) ITK_OVERRIDE;
+
+  /** Returns true if shared memory objects are available on this platform. */
+  static bool IsSupported();
+
+  /** Returns true if \a filename uses the "shm:" scheme. */
+  static bool IsSharedMemoryFileName(const char* filename);
+
+  /** Unlink the shared memory object referenced by \a filename.
+   * Returns false if the object could not be removed. */
+  static bool RemoveSharedMemory(const char* filename);
+
+protected:
+  SharedMemoryImageIO();
+  ~SharedMemoryImageIO();
+  void PrintSelf(std::ostream& os, Indent indent) const ITK_OVERRIDE;
+
+private:
+  SharedMemoryImageIO(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+};
+
+} // end namespace itk
+
+#endif // itkSharedMemoryImageIO_h
@@ -0,0 +1,176 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkEventBroker.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkObservation.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+namespace
+{
+
+int coalesceEvents();
+int priorityOrder();
+int removeQueuedObservation();
+
+std::vector<int> InvokedObservers;
+
+//---------------------------------------------------------------------------
+void RecordCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                    void* clientData, void* vtkNotUsed(callData))
+{
+  InvokedObservers.push_back(*reinterpret_cast<int*>(clientData));
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkEventBrokerAsynchronousTest(int vtkNotUsed(argc),
+                                   char * vtkNotUsed(argv)[] )
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  broker->SetEventModeToAsynchronous();
+  int res = EXIT_SUCCESS;
+  if (coalesceEvents() != EXIT_SUCCESS
+    || priorityOrder() != EXIT_SUCCESS
+    || removeQueuedObservation() != EXIT_SUCCESS)
+    {
+    res = EXIT_FAILURE;
+    }
+  broker->SetEventModeToSynchronous();
+  return res;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int coalesceEvents()
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  broker->ResetEventQueueCounters();
+  InvokedObservers.clear();
+
+  vtkNew<vtkObject> subject;
+  vtkNew<vtkObject> observer;
+  int observerId = 1;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(RecordCallback);
+  callback->SetClientData(&observerId);
+  broker->AddObservation(subject.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), callback.GetPointer());
+
+  for (int i = 0; i < 100; ++i)
+    {
+    subject->Modified();
+    }
+  CHECK_INT(static_cast<int>(InvokedObservers.size()), 0);
+  CHECK_INT(broker->GetNumberOfQueuedObservations(), 1);
+  CHECK_INT(static_cast<int>(broker->GetNumberOfQueuedEvents()), 100);
+  CHECK_INT(static_cast<int>(broker->GetNumberOfMergedEvents()), 99);
+
+  broker->ProcessEventQueue();
+  CHECK_INT(static_cast<int>(InvokedObservers.size()), 1);
+  CHECK_INT(broker->GetNumberOfQueuedObservations(), 0);
+  CHECK_INT(static_cast<int>(broker->GetNumberOfDeliveredEvents()), 1);
+
+  broker->RemoveObservations(subject.GetPointer(), observer.GetPointer());
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int priorityOrder()
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  broker->ResetEventQueueCounters();
+  InvokedObservers.clear();
+
+  vtkNew<vtkObject> subject1;
+  vtkNew<vtkObject> subject2;
+  vtkNew<vtkObject> observer;
+  int observerIds[3] = {0, 1, 2};
+  vtkNew<vtkCallbackCommand> lowCallback;
+  lowCallback->SetCallback(RecordCallback);
+  lowCallback->SetClientData(&observerIds[0]);
+  vtkNew<vtkCallbackCommand> highCallback;
+  highCallback->SetCallback(RecordCallback);
+  highCallback->SetClientData(&observerIds[1]);
+  vtkNew<vtkCallbackCommand> otherHighCallback;
+  otherHighCallback->SetCallback(RecordCallback);
+  otherHighCallback->SetClientData(&observerIds[2]);
+
+  broker->AddObservation(subject1.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), lowCallback.GetPointer(), -1.0f);
+  broker->AddObservation(subject1.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), highCallback.GetPointer(), 10.0f);
+  broker->AddObservation(subject2.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), otherHighCallback.GetPointer(), 10.0f);
+
+  // Higher priorities are invoked first, equal priorities are invoked
+  // in the order they were queued.
+  subject2->Modified();
+  subject1->Modified();
+  subject2->Modified();
+  CHECK_INT(broker->GetNumberOfQueuedObservations(), 3);
+
+  broker->ProcessEventQueue();
+  CHECK_INT(static_cast<int>(InvokedObservers.size()), 3);
+  CHECK_INT(InvokedObservers[0], 2);
+  CHECK_INT(InvokedObservers[1], 1);
+  CHECK_INT(InvokedObservers[2], 0);
+
+  broker->RemoveObservations(observer.GetPointer());
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int removeQueuedObservation()
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  broker->ResetEventQueueCounters();
+  InvokedObservers.clear();
+
+  vtkNew<vtkObject> subject;
+  vtkNew<vtkObject> observer;
+  int observerId = 1;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(RecordCallback);
+  callback->SetClientData(&observerId);
+  broker->AddObservation(subject.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), callback.GetPointer());
+
+  subject->Modified();
+  CHECK_INT(broker->GetNumberOfQueuedObservations(), 1);
+
+  broker->RemoveObservations(subject.GetPointer(), observer.GetPointer());
+  CHECK_INT(broker->GetNumberOfQueuedObservations(), 0);
+  CHECK_INT(static_cast<int>(broker->GetNumberOfDroppedEvents()), 1);
+
+  broker->ProcessEventQueue();
+  CHECK_INT(static_cast<int>(InvokedObservers.size()), 0);
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
@@ -0,0 +1,96 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkEventBroker.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
+
+// STD includes
+#include <string>
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+void EmptyCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                   void* vtkNotUsed(clientData), void* vtkNotUsed(callData))
+{
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkEventBrokerProfilingTest(int vtkNotUsed(argc),
+                                char * vtkNotUsed(argv)[] )
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  CHECK_BOOL(broker->GetProfiling(), false);
+
+  vtkNew<vtkMRMLModelNode> subject;
+  vtkNew<vtkMRMLScene> observer;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(EmptyCallback);
+  broker->AddObservation(subject.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), callback.GetPointer());
+
+  // Nothing is recorded unless profiling is on
+  subject->Modified();
+  CHECK_INT(broker->GetNumberOfProfilingEntries(), 0);
+
+  broker->ProfilingOn();
+  for (int i = 0; i < 10; ++i)
+    {
+    subject->Modified();
+    }
+  broker->ProfilingOff();
+  subject->Modified();
+  CHECK_INT(broker->GetNumberOfProfilingEntries(), 1);
+
+  vtkNew<vtkTable> statistics;
+  broker->GetProfilingStatistics(statistics.GetPointer());
+  CHECK_INT(statistics->GetNumberOfRows(), 1);
+  CHECK_STD_STRING(statistics->GetValueByName(0, "SubjectClass").ToString(),
+                   "vtkMRMLModelNode");
+  CHECK_STD_STRING(statistics->GetValueByName(0, "Event").ToString(),
+                   "ModifiedEvent");
+  CHECK_STD_STRING(statistics->GetValueByName(0, "Observer").ToString(),
+                   "vtkMRMLScene");
+  CHECK_INT(statistics->GetValueByName(0, "Count").ToInt(), 10);
+  CHECK_BOOL(statistics->GetValueByName(0, "MaxTime").ToDouble()
+             <= statistics->GetValueByName(0, "TotalTime").ToDouble(), true);
+
+  std::string csv = broker->GetProfilingReport(vtkEventBroker::ProfilingReportCSV);
+  CHECK_BOOL(csv.find("SubjectClass,Event,Observer,Count,TotalTime,MaxTime\n") == 0, true);
+  CHECK_BOOL(csv.find("\"vtkMRMLModelNode\",\"ModifiedEvent\",\"vtkMRMLScene\",10,") != std::string::npos, true);
+
+  std::string json = broker->GetProfilingReport(vtkEventBroker::ProfilingReportJSON);
+  CHECK_BOOL(json.find("\"SubjectClass\": \"vtkMRMLModelNode\"") != std::string::npos, true);
+  CHECK_BOOL(json.find("\"Count\": 10") != std::string::npos, true);
+
+  broker->ResetProfiling();
+  CHECK_INT(broker->GetNumberOfProfilingEntries(), 0);
+
+  broker->RemoveObservations(subject.GetPointer(), observer.GetPointer());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// MRML includes
+#include "vtkImageScalarHistogram.h"
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <vector>
+
+namespace
+{
+const int MINIMUM_VALUE = -1000;
+const int NUMBER_OF_VALUES = 2000;
+
+//----------------------------------------------------------------------------
+bool CheckLevels(vtkImageScalarHistogram* histogram)
+{
+  for (int level = 0; level < histogram->GetNumberOfLevels(); ++level)
+    {
+    vtkIdTypeArray* counts = histogram->GetBinCounts(level);
+    vtkIdType total = 0;
+    for (vtkIdType bin = 0; bin < counts->GetNumberOfTuples(); ++bin)
+      {
+      total += counts->GetValue(bin);
+      }
+    if (total != histogram->GetNumberOfSamples())
+      {
+      std::cerr << "Level " << level << " holds " << total << " samples, expected "
+                << histogram->GetNumberOfSamples() << std::endl;
+      return false;
+      }
+    }
+  if (histogram->GetNumberOfBins(histogram->GetNumberOfLevels() - 1) != 1)
+    {
+    std::cerr << "Coarsest level is expected to have a single bin" << std::endl;
+    return false;
+    }
+  return true;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkImageScalarHistogramTest1(int , char * [] )
+{
+  // Non uniform distribution: value v appears more often when |v| is small
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(128, 128, 32);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short* voxels = static_cast<short*>(imageData->GetScalarPointer());
+  const vtkIdType numberOfVoxels = imageData->GetNumberOfPoints();
+  std::vector<vtkIdType> expectedCounts(NUMBER_OF_VALUES, 0);
+  for (vtkIdType i = 0; i < numberOfVoxels; ++i)
+    {
+    int value = static_cast<int>((i * 7919) % NUMBER_OF_VALUES);
+    value = (value * value) / NUMBER_OF_VALUES;
+    voxels[i] = static_cast<short>(MINIMUM_VALUE + value);
+    ++expectedCounts[value];
+    }
+
+  // Full histogram, one bin per value
+  vtkNew<vtkImageScalarHistogram> histogram;
+  histogram->SetNumberOfThreads(4);
+  CHECK_BOOL(histogram->Compute(imageData.GetPointer(), 0), true);
+  CHECK_INT(histogram->GetNumberOfSamples(), numberOfVoxels);
+  CHECK_DOUBLE(histogram->GetCumulativeErrorBound(), 0.);
+  CHECK_DOUBLE(histogram->GetBinOrigin(), MINIMUM_VALUE);
+  CHECK_DOUBLE(histogram->GetBinSpacing(0), 1.);
+  CHECK_BOOL(CheckLevels(histogram.GetPointer()), true);
+  vtkIdTypeArray* counts = histogram->GetBinCounts(0);
+  for (vtkIdType bin = 0; bin < counts->GetNumberOfTuples(); ++bin)
+    {
+    if (counts->GetValue(bin) != expectedCounts[bin])
+      {
+      std::cerr << "Line " << __LINE__ << ": bin " << bin << " holds " << counts->GetValue(bin)
+                << " voxels, expected " << expectedCounts[bin] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  CHECK_INT(histogram->GetLevelForMaximumNumberOfBins(1000), 1);
+
+  // Subsampled histogram: exact range, cumulative distribution within bound
+  vtkNew<vtkImageScalarHistogram> sampledHistogram;
+  CHECK_BOOL(sampledHistogram->Compute(imageData.GetPointer(), numberOfVoxels / 10), true);
+  CHECK_BOOL(sampledHistogram->GetSampleStride() >= 10, true);
+  CHECK_BOOL(sampledHistogram->GetNumberOfSamples() <= numberOfVoxels / 10, true);
+  CHECK_DOUBLE(sampledHistogram->GetScalarRange()[0], histogram->GetScalarRange()[0]);
+  CHECK_DOUBLE(sampledHistogram->GetScalarRange()[1], histogram->GetScalarRange()[1]);
+  CHECK_BOOL(CheckLevels(sampledHistogram.GetPointer()), true);
+  const double errorBound = sampledHistogram->GetCumulativeErrorBound();
+  CHECK_BOOL(errorBound > 0. && errorBound < 0.01, true);
+  vtkIdTypeArray* sampledCounts = sampledHistogram->GetBinCounts(0);
+  double cumulative = 0.;
+  double sampledCumulative = 0.;
+  for (vtkIdType bin = 0; bin < sampledCounts->GetNumberOfTuples(); ++bin)
+    {
+    cumulative += static_cast<double>(expectedCounts[bin]) / numberOfVoxels;
+    sampledCumulative += static_cast<double>(sampledCounts->GetValue(bin)) /
+      sampledHistogram->GetNumberOfSamples();
+    if (fabs(cumulative - sampledCumulative) > errorBound)
+      {
+      std::cerr << "Line " << __LINE__ << ": cumulative histogram differs by "
+                << fabs(cumulative - sampledCumulative) << " at bin " << bin
+                << ", bound is " << errorBound << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Cache is reused until the image is modified
+  vtkImageScalarHistogram* cachedHistogram =
+    vtkImageScalarHistogram::GetCachedHistogram(imageData.GetPointer(), 0);
+  CHECK_NOT_NULL(cachedHistogram);
+  CHECK_POINTER(vtkImageScalarHistogram::GetCachedHistogram(imageData.GetPointer(), 0), cachedHistogram);
+  // A full histogram also satisfies requests for fewer samples
+  CHECK_POINTER(vtkImageScalarHistogram::GetCachedHistogram(imageData.GetPointer(), 1000), cachedHistogram);
+  voxels[0] = 5000;
+  imageData->Modified();
+  cachedHistogram = vtkImageScalarHistogram::GetCachedHistogram(imageData.GetPointer(), 0);
+  CHECK_NOT_NULL(cachedHistogram);
+  CHECK_DOUBLE(cachedHistogram->GetScalarRange()[1], 5000.);
+
+  // Floating point images use a fixed number of bins
+  vtkNew<vtkImageData> floatImageData;
+  floatImageData->SetDimensions(100, 100, 1);
+  floatImageData->AllocateScalars(VTK_FLOAT, 1);
+  float* floatVoxels = static_cast<float*>(floatImageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < floatImageData->GetNumberOfPoints(); ++i)
+    {
+    floatVoxels[i] = static_cast<float>(i) * 0.01f;
+    }
+  CHECK_BOOL(histogram->Compute(floatImageData.GetPointer(), 0), true);
+  CHECK_INT(histogram->GetNumberOfBins(0), vtkImageScalarHistogram::MAXIMUM_NUMBER_OF_BINS);
+  CHECK_BOOL(CheckLevels(histogram.GetPointer()), true);
+
+  return EXIT_SUCCESS;
+}
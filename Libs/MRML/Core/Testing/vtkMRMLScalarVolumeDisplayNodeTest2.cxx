@@ -0,0 +1,141 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// MRML includes
+#include "vtkMRMLColorTableNode.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLScalarVolumeDisplayNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkAlgorithm.h>
+#include <vtkAlgorithmOutput.h>
+#include <vtkImageData.h>
+#include <vtkImageToImageStencil.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTrivialProducer.h>
+
+// STD includes
+#include <cstdlib>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> GetColoredImage(vtkMRMLScalarVolumeDisplayNode* displayNode)
+{
+  vtkAlgorithm* producer = displayNode->GetOutputImageDataConnection()->GetProducer();
+  producer->Update();
+  vtkSmartPointer<vtkImageData> coloredImage = vtkSmartPointer<vtkImageData>::New();
+  coloredImage->DeepCopy(producer->GetOutputDataObject(0));
+  return coloredImage;
+}
+
+//----------------------------------------------------------------------------
+bool IsSameColors(vtkImageData* fusedImage, vtkImageData* chainImage)
+{
+  if (fusedImage->GetNumberOfScalarComponents() != 4 ||
+      chainImage->GetNumberOfScalarComponents() != 4 ||
+      fusedImage->GetScalarType() != VTK_UNSIGNED_CHAR ||
+      chainImage->GetScalarType() != VTK_UNSIGNED_CHAR ||
+      fusedImage->GetNumberOfPoints() != chainImage->GetNumberOfPoints())
+    {
+    std::cerr << "Colored images have different formats" << std::endl;
+    return false;
+    }
+  const unsigned char* fused = static_cast<unsigned char*>(fusedImage->GetScalarPointer());
+  const unsigned char* chain = static_cast<unsigned char*>(chainImage->GetScalarPointer());
+  for (vtkIdType i = 0; i < fusedImage->GetNumberOfPoints() * 4; ++i)
+    {
+    // Allow rounding differences in the colors, alpha must match
+    int tolerance = (i % 4 == 3) ? 0 : 1;
+    if (abs(static_cast<int>(fused[i]) - static_cast<int>(chain[i])) > tolerance)
+      {
+      std::cerr << "Colors differ at voxel " << i / 4 << " component " << i % 4
+                << ": fused " << static_cast<int>(fused[i])
+                << ", chain " << static_cast<int>(chain[i]) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkMRMLScalarVolumeDisplayNodeTest2(int , char * [] )
+{
+  // Ramp covering values below, inside and above the window
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(64, 64, 1);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short* voxels = static_cast<short*>(imageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < imageData->GetNumberOfPoints(); ++i)
+    {
+    voxels[i] = static_cast<short>(i % 700 - 300);
+    }
+  vtkNew<vtkTrivialProducer> imageProducer;
+  imageProducer->SetOutput(imageData.GetPointer());
+
+  vtkNew<vtkImageToImageStencil> stencil;
+  stencil->SetInputData(imageData.GetPointer());
+  stencil->ThresholdByUpper(-200);
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLColorTableNode> colorNode;
+  colorNode->SetTypeToRainbow();
+  scene->AddNode(colorNode.GetPointer());
+
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  displayNode->SetAndObserveColorNodeID(colorNode->GetID());
+  displayNode->SetAutoWindowLevel(0);
+  displayNode->SetAutoThreshold(0);
+  displayNode->SetInputImageDataConnection(imageProducer->GetOutputPort());
+
+  CHECK_BOOL(displayNode->GetFusedColoring() != 0, true);
+
+  const double windowLevels[3][2] = { {300., 50.}, {-200., 10.}, {0., 20.} };
+  for (int i = 0; i < 3; ++i)
+    {
+    displayNode->SetWindowLevel(windowLevels[i][0], windowLevels[i][1]);
+    for (int apply = 0; apply < 2; ++apply)
+      {
+      displayNode->SetApplyThreshold(apply);
+      displayNode->SetThreshold(-100., 150.);
+      for (int useStencil = 0; useStencil < 2; ++useStencil)
+        {
+        displayNode->SetBackgroundImageStencilDataConnection(
+          useStencil ? stencil->GetOutputPort() : 0);
+
+        displayNode->SetFusedColoring(1);
+        vtkAlgorithmOutput* fusedConnection = displayNode->GetOutputImageDataConnection();
+        vtkSmartPointer<vtkImageData> fusedImage = GetColoredImage(displayNode.GetPointer());
+
+        displayNode->SetFusedColoring(0);
+        CHECK_POINTER_DIFFERENT(displayNode->GetOutputImageDataConnection(), fusedConnection);
+        vtkSmartPointer<vtkImageData> chainImage = GetColoredImage(displayNode.GetPointer());
+
+        if (!IsSameColors(fusedImage, chainImage))
+          {
+          std::cerr << "Line " << __LINE__ << ": fused coloring differs from the filter chain"
+                    << " with window " << windowLevels[i][0] << ", level " << windowLevels[i][1]
+                    << ", apply threshold " << apply << ", stencil " << useStencil << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <sstream>
+
+namespace
+{
+
+int createNodeByTag();
+int createNodePerformance();
+int importPerformance();
+
+const char* SceneTags[] = { "LinearTransform", "ModelDisplay", "ScriptedModule", "Model" };
+const int SceneTagCount = 4;
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneLoadPerformanceTest(int vtkNotUsed(argc),
+                                    char * vtkNotUsed(argv)[] )
+{
+  CHECK_EXIT_SUCCESS(createNodeByTag());
+  CHECK_EXIT_SUCCESS(createNodePerformance());
+  CHECK_EXIT_SUCCESS(importPerformance());
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int createNodeByTag()
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkSmartPointer<vtkMRMLNode> node =
+    vtkSmartPointer<vtkMRMLNode>::Take(scene->CreateNodeByTag("LinearTransform"));
+  CHECK_NOT_NULL(node);
+  CHECK_STRING(node->GetClassName(), "vtkMRMLLinearTransformNode");
+  CHECK_STRING(scene->GetClassNameByTag("LinearTransform"), "vtkMRMLLinearTransformNode");
+  CHECK_STRING(scene->GetTagByClassName("vtkMRMLLinearTransformNode"), "LinearTransform");
+  CHECK_BOOL(scene->IsNodeClassRegistered("vtkMRMLLinearTransformNode"), true);
+
+  CHECK_NULL(scene->CreateNodeByTag("UnknownTag"));
+  CHECK_NULL(scene->GetClassNameByTag("UnknownTag"));
+  CHECK_BOOL(scene->IsNodeClassRegistered("vtkMRMLUnknownNode"), false);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int createNodePerformance()
+{
+  // This test is for performance
+  vtkNew<vtkMRMLScene> scene;
+  const int nodeCount = 20000;
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  for (int i = 0; i < nodeCount; ++i)
+    {
+    const char* className = scene->GetClassNameByTag(SceneTags[i % SceneTagCount]);
+    vtkSmartPointer<vtkMRMLNode> node =
+      vtkSmartPointer<vtkMRMLNode>::Take(scene->CreateNodeByClass(className));
+    CHECK_NOT_NULL(node);
+    }
+  timer->StopTimer();
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-CreateNodeByClassPerformance-"
+           << nodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int importPerformance()
+{
+  // This test is for performance
+  const int nodeCount = 20000;
+
+  // Synthetic scene with many elements
+  std::stringstream xml;
+  xml << "<MRML version=\"Slicer4.4.0\">" << std::endl;
+  for (int i = 0; i < nodeCount; ++i)
+    {
+    const char* tag = SceneTags[i % SceneTagCount];
+    xml << " <" << tag << " id=\"vtkMRML" << tag << "Node" << i << "\""
+        << " name=\"" << tag << i << "\"></" << tag << ">" << std::endl;
+    }
+  xml << "</MRML>" << std::endl;
+
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetLoadFromXMLString(1);
+  scene->SetSceneXMLString(xml.str());
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  scene->Import();
+  timer->StopTimer();
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLLinearTransformNode"), nodeCount / SceneTagCount);
+
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-ImportPerformance-"
+           << nodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
@@ -0,0 +1,334 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLLinearTransformNode.h"
+#include "vtkMRMLModelDisplayNode.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+int classIndex();
+int nameIndex();
+int insertNode();
+int nthNodeByClass();
+int lookupPerformance();
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneNodeIndexTest(int vtkNotUsed(argc),
+                              char * vtkNotUsed(argv)[] )
+{
+  CHECK_EXIT_SUCCESS(classIndex());
+  CHECK_EXIT_SUCCESS(nameIndex());
+  CHECK_EXIT_SUCCESS(insertNode());
+  CHECK_EXIT_SUCCESS(nthNodeByClass());
+  CHECK_EXIT_SUCCESS(lookupPerformance());
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int classIndex()
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLModelNode> model1;
+  scene->AddNode(model1.GetPointer());
+  vtkNew<vtkMRMLLinearTransformNode> transform1;
+  scene->AddNode(transform1.GetPointer());
+
+  // Build the index for superclasses before more nodes are added
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLModelNode"), 1);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLTransformableNode"), 2);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLNode"), 2);
+
+  vtkNew<vtkMRMLModelNode> model2;
+  scene->AddNode(model2.GetPointer());
+  vtkNew<vtkMRMLModelDisplayNode> display1;
+  scene->AddNode(display1.GetPointer());
+
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLModelNode"), 2);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLTransformableNode"), 3);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLDisplayNode"), 1);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLNode"), 4);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLVolumeNode"), 0);
+
+  // Order must match the order of the nodes in the scene
+  CHECK_POINTER(scene->GetNthNodeByClass(0, "vtkMRMLModelNode"), model1.GetPointer());
+  CHECK_POINTER(scene->GetNthNodeByClass(1, "vtkMRMLModelNode"), model2.GetPointer());
+  CHECK_NULL(scene->GetNthNodeByClass(2, "vtkMRMLModelNode"));
+  CHECK_POINTER(scene->GetNthNodeByClass(1, "vtkMRMLTransformableNode"), transform1.GetPointer());
+
+  scene->RemoveNode(model1.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLTransformableNode"), 2);
+  CHECK_POINTER(scene->GetFirstNodeByClass("vtkMRMLModelNode"), model2.GetPointer());
+
+  std::vector<vtkMRMLNode*> nodes;
+  CHECK_INT(scene->GetNodesByClass("vtkMRMLTransformableNode", nodes), 2);
+  CHECK_POINTER(nodes[0], transform1.GetPointer());
+  CHECK_POINTER(nodes[1], model2.GetPointer());
+
+  // The index must still be valid when the node collection is modified directly
+  scene->GetNodes()->RemoveItem(transform1.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLTransformableNode"), 1);
+
+  // Same for a removal and an addition that keep the number of nodes
+  // followed by an addition through the scene
+  scene->GetNodes()->RemoveItem(model2.GetPointer());
+  scene->GetNodes()->AddItem(transform1.GetPointer());
+  vtkNew<vtkMRMLModelNode> model3;
+  scene->AddNode(model3.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLTransformableNode"), 2);
+  CHECK_POINTER(scene->GetFirstNodeByClass("vtkMRMLModelNode"), model3.GetPointer());
+  CHECK_POINTER(scene->GetNthNodeByClass(0, "vtkMRMLTransformableNode"), transform1.GetPointer());
+
+  scene->Clear(1);
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLNode"), 0);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int nameIndex()
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLModelNode> model1;
+  model1->SetName("Node");
+  scene->AddNode(model1.GetPointer());
+  vtkNew<vtkMRMLLinearTransformNode> transform1;
+  transform1->SetName("Node");
+  scene->AddNode(transform1.GetPointer());
+  vtkNew<vtkMRMLModelNode> model2;
+  model2->SetName("Other");
+  scene->AddNode(model2.GetPointer());
+
+  vtkSmartPointer<vtkCollection> nodes;
+  nodes.TakeReference(scene->GetNodesByName("Node"));
+  CHECK_INT(nodes->GetNumberOfItems(), 2);
+  CHECK_POINTER(nodes->GetItemAsObject(0), model1.GetPointer());
+  CHECK_POINTER(nodes->GetItemAsObject(1), transform1.GetPointer());
+
+  nodes.TakeReference(scene->GetNodesByClassByName("vtkMRMLModelNode", "Node"));
+  CHECK_INT(nodes->GetNumberOfItems(), 1);
+  CHECK_POINTER(nodes->GetItemAsObject(0), model1.GetPointer());
+
+  // Renaming a node in the scene updates the index
+  model1->SetName("Renamed");
+  nodes.TakeReference(scene->GetNodesByName("Node"));
+  CHECK_INT(nodes->GetNumberOfItems(), 1);
+  CHECK_POINTER(scene->GetFirstNodeByName("Renamed"), model1.GetPointer());
+
+  model2->SetName("Node");
+  nodes.TakeReference(scene->GetNodesByName("Node"));
+  CHECK_INT(nodes->GetNumberOfItems(), 2);
+  // Scene order is preserved, not the renaming order
+  CHECK_POINTER(nodes->GetItemAsObject(0), transform1.GetPointer());
+  CHECK_POINTER(nodes->GetItemAsObject(1), model2.GetPointer());
+
+  scene->RemoveNode(transform1.GetPointer());
+  CHECK_POINTER(scene->GetFirstNodeByName("Node"), model2.GetPointer());
+  CHECK_POINTER(scene->GetFirstNode("Node", "vtkMRMLModelNode"), model2.GetPointer());
+  CHECK_NULL(scene->GetFirstNodeByName("Unknown"));
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int insertNode()
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkMRMLModelNode> model1;
+  scene->AddNode(model1.GetPointer());
+  vtkNew<vtkMRMLModelNode> model3;
+  scene->AddNode(model3.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodesByClass("vtkMRMLModelNode"), 2);
+
+  vtkNew<vtkMRMLModelNode> model2;
+  scene->InsertAfterNode(model1.GetPointer(), model2.GetPointer());
+  vtkNew<vtkMRMLModelNode> model0;
+  scene->InsertBeforeNode(model1.GetPointer(), model0.GetPointer());
+
+  std::vector<vtkMRMLNode*> nodes;
+  CHECK_INT(scene->GetNodesByClass("vtkMRMLModelNode", nodes), 4);
+  CHECK_POINTER(nodes[0], model0.GetPointer());
+  CHECK_POINTER(nodes[1], model1.GetPointer());
+  CHECK_POINTER(nodes[2], model2.GetPointer());
+  CHECK_POINTER(nodes[3], model3.GetPointer());
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int nthNodeByClass()
+{
+  vtkNew<vtkMRMLScene> scene;
+  std::vector< vtkSmartPointer<vtkMRMLNode> > transformNodes;
+  for (int i = 0; i < 20; ++i)
+    {
+    vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+    scene->AddNode(transformNode);
+    transformNodes.push_back(transformNode);
+    // Nodes of another class in between
+    scene->AddNode(vtkSmartPointer<vtkMRMLModelNode>::New());
+    }
+
+  // Forward, backward and random access
+  for (int i = 0; i < 20; ++i)
+    {
+    CHECK_POINTER(scene->GetNthNodeByClass(i, "vtkMRMLLinearTransformNode"), transformNodes[i].GetPointer());
+    }
+  for (int i = 19; i >= 0; --i)
+    {
+    CHECK_POINTER(scene->GetNthNodeByClass(i, "vtkMRMLLinearTransformNode"), transformNodes[i].GetPointer());
+    }
+  const int positions[] = { 7, 3, 18, 10, 11, 0, 19, 9 };
+  for (unsigned int i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i)
+    {
+    CHECK_POINTER(scene->GetNthNodeByClass(positions[i], "vtkMRMLLinearTransformNode"),
+                  transformNodes[positions[i]].GetPointer());
+    }
+  CHECK_NULL(scene->GetNthNodeByClass(20, "vtkMRMLLinearTransformNode"));
+
+  // Modifying the scene in the middle of an iteration
+  CHECK_POINTER(scene->GetNthNodeByClass(10, "vtkMRMLLinearTransformNode"), transformNodes[10].GetPointer());
+  scene->RemoveNode(transformNodes[10]);
+  transformNodes.erase(transformNodes.begin() + 10);
+  CHECK_POINTER(scene->GetNthNodeByClass(10, "vtkMRMLLinearTransformNode"), transformNodes[10].GetPointer());
+  CHECK_POINTER(scene->GetNthNodeByClass(11, "vtkMRMLLinearTransformNode"), transformNodes[11].GetPointer());
+  vtkNew<vtkMRMLLinearTransformNode> lastTransformNode;
+  scene->AddNode(lastTransformNode.GetPointer());
+  CHECK_POINTER(scene->GetNthNodeByClass(12, "vtkMRMLLinearTransformNode"), transformNodes[12].GetPointer());
+  CHECK_POINTER(scene->GetNthNodeByClass(19, "vtkMRMLLinearTransformNode"), lastTransformNode.GetPointer());
+  scene->Clear(1);
+  CHECK_NULL(scene->GetNthNodeByClass(0, "vtkMRMLLinearTransformNode"));
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int lookupPerformance()
+{
+  // This test is for performance
+  vtkNew<vtkMRMLScene> scene;
+  const int transformNodeCount = 10000;
+  const int modelNodeCount = 10;
+  const int lookupCount = 1000;
+
+  for (int i = 0; i < transformNodeCount; ++i)
+    {
+    scene->AddNode(vtkSmartPointer<vtkMRMLLinearTransformNode>::New());
+    }
+  for (int i = 0; i < modelNodeCount; ++i)
+    {
+    std::stringstream name;
+    name << "Model" << i;
+    vtkNew<vtkMRMLModelNode> modelNode;
+    modelNode->SetName(name.str().c_str());
+    scene->AddNode(modelNode.GetPointer());
+    }
+
+  // Reference: traverse the whole node collection as it used to be done
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  int foundNodes = 0;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    vtkCollection* sceneNodes = scene->GetNodes();
+    vtkCollectionSimpleIterator it;
+    vtkMRMLNode* node = 0;
+    for (sceneNodes->InitTraversal(it);
+      (node = vtkMRMLNode::SafeDownCast(sceneNodes->GetNextItemAsObject(it)));)
+      {
+      if (node->IsA("vtkMRMLModelNode"))
+        {
+        ++foundNodes;
+        }
+      }
+    }
+  timer->StopTimer();
+  CHECK_INT(foundNodes, modelNodeCount * lookupCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-TraverseByClassPerformance-"
+           << transformNodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  timer->StartTimer();
+  foundNodes = 0;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    std::vector<vtkMRMLNode*> nodes;
+    foundNodes += scene->GetNodesByClass("vtkMRMLModelNode", nodes);
+    }
+  timer->StopTimer();
+  CHECK_INT(foundNodes, modelNodeCount * lookupCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-GetNodesByClassPerformance-"
+           << transformNodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  timer->StartTimer();
+  foundNodes = 0;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    vtkSmartPointer<vtkCollection> nodes;
+    nodes.TakeReference(scene->GetNodesByClassByName("vtkMRMLModelNode", "Model5"));
+    foundNodes += nodes->GetNumberOfItems();
+    }
+  timer->StopTimer();
+  CHECK_INT(foundNodes, lookupCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-GetNodesByClassByNamePerformance-"
+           << transformNodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  // Iterate over all the nodes of a class by position
+  timer->StartTimer();
+  foundNodes = 0;
+  const int numberOfTransformNodes = scene->GetNumberOfNodesByClass("vtkMRMLLinearTransformNode");
+  for (int n = 0; n < numberOfTransformNodes; ++n)
+    {
+    if (scene->GetNthNodeByClass(n, "vtkMRMLLinearTransformNode"))
+      {
+      ++foundNodes;
+      }
+    }
+  timer->StopTimer();
+  CHECK_INT(foundNodes, transformNodeCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-GetNthNodeByClassPerformance-"
+           << transformNodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
@@ -0,0 +1,270 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLLinearTransformNode.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+namespace
+{
+
+int undoModifiedNode();
+int undoAddedNode();
+int undoRemovedNode();
+int undoStackSize();
+int undoStackMemorySize();
+int undoPerformance();
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneUndoTest(int vtkNotUsed(argc), char * vtkNotUsed(argv)[] )
+{
+  CHECK_EXIT_SUCCESS(undoModifiedNode());
+  CHECK_EXIT_SUCCESS(undoAddedNode());
+  CHECK_EXIT_SUCCESS(undoRemovedNode());
+  CHECK_EXIT_SUCCESS(undoStackSize());
+  CHECK_EXIT_SUCCESS(undoStackMemorySize());
+  CHECK_EXIT_SUCCESS(undoPerformance());
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int undoModifiedNode()
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+
+  vtkNew<vtkMRMLModelNode> modelNode;
+  modelNode->SetName("Before");
+  scene->AddNode(modelNode.GetPointer());
+
+  scene->SaveStateForUndo(modelNode.GetPointer());
+  modelNode->SetName("After");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 1);
+
+  scene->Undo();
+  CHECK_STRING(modelNode->GetName(), "Before");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 0);
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 1);
+
+  scene->Redo();
+  CHECK_STRING(modelNode->GetName(), "After");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 1);
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 0);
+
+  // A new checkpoint clears the redo stack
+  scene->Undo();
+  scene->SaveStateForUndo(modelNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 0);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int undoAddedNode()
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+
+  vtkNew<vtkMRMLModelNode> modelNode;
+  scene->AddNode(modelNode.GetPointer());
+
+  scene->SaveStateForUndo();
+  vtkNew<vtkMRMLLinearTransformNode> transformNode;
+  scene->AddNode(transformNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodes(), 2);
+
+  scene->Undo();
+  CHECK_INT(scene->GetNumberOfNodes(), 1);
+  CHECK_NULL(transformNode->GetScene());
+
+  scene->Redo();
+  CHECK_INT(scene->GetNumberOfNodes(), 2);
+  CHECK_POINTER(scene->GetFirstNodeByClass("vtkMRMLLinearTransformNode"), transformNode.GetPointer());
+
+  // Nodes added and removed between two checkpoints are not restored
+  scene->SaveStateForUndo();
+  vtkNew<vtkMRMLModelNode> modelNode2;
+  scene->AddNode(modelNode2.GetPointer());
+  scene->RemoveNode(modelNode2.GetPointer());
+  scene->Undo();
+  CHECK_INT(scene->GetNumberOfNodes(), 2);
+  CHECK_NULL(modelNode2->GetScene());
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int undoRemovedNode()
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+
+  vtkNew<vtkMRMLModelNode> modelNode;
+  modelNode->SetName("Before");
+  scene->AddNode(modelNode.GetPointer());
+  std::string modelNodeID = modelNode->GetID();
+
+  scene->SaveStateForUndo(modelNode.GetPointer());
+  modelNode->SetName("After");
+  scene->RemoveNode(modelNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodes(), 0);
+
+  scene->Undo();
+  CHECK_INT(scene->GetNumberOfNodes(), 1);
+  // The same node is added back, with its saved state
+  CHECK_POINTER(scene->GetNodeByID(modelNodeID), modelNode.GetPointer());
+  CHECK_STRING(modelNode->GetName(), "Before");
+
+  scene->Redo();
+  CHECK_INT(scene->GetNumberOfNodes(), 0);
+
+  // A node removed several times between two checkpoints is restored once
+  vtkNew<vtkMRMLModelNode> modelNode2;
+  scene->AddNode(modelNode2.GetPointer());
+  scene->SaveStateForUndo();
+  scene->RemoveNode(modelNode2.GetPointer());
+  scene->AddNode(modelNode2.GetPointer());
+  scene->RemoveNode(modelNode2.GetPointer());
+  CHECK_INT(scene->GetNumberOfNodes(), 0);
+  scene->Undo();
+  CHECK_INT(scene->GetNumberOfNodes(), 1);
+  CHECK_POINTER(scene->GetFirstNodeByClass("vtkMRMLModelNode"), modelNode2.GetPointer());
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int undoStackSize()
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+  scene->SetUndoStackSize(3);
+
+  vtkNew<vtkMRMLModelNode> modelNode;
+  scene->AddNode(modelNode.GetPointer());
+  for (int i = 0; i < 5; ++i)
+    {
+    scene->SaveStateForUndo(modelNode.GetPointer());
+    }
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 3);
+
+  for (int i = 0; i < 5; ++i)
+    {
+    scene->Undo();
+    }
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 0);
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 3);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> createImageData()
+{
+  // 1000000 bytes
+  vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+  imageData->SetDimensions(100, 100, 100);
+  imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  return imageData;
+}
+
+//---------------------------------------------------------------------------
+int undoStackMemorySize()
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+  scene->SetUndoStackMemorySize(2500000);
+
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(createImageData());
+  scene->AddNode(volumeNode.GetPointer());
+
+  // Each level keeps alive the image data replaced after the checkpoint
+  for (int i = 0; i < 5; ++i)
+    {
+    scene->SaveStateForUndo(volumeNode.GetPointer());
+    volumeNode->SetAndObserveImageData(createImageData());
+    }
+  // The 4 previous levels held 4MB when the last one was started
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 3);
+
+  // Image data still used by the volume node is not counted
+  scene->SaveStateForUndo(volumeNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 3);
+  scene->SaveStateForUndo(volumeNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 4);
+
+  // Level size limit still applies
+  scene->SetUndoStackMemorySize(0);
+  scene->SetUndoStackSize(2);
+  scene->SaveStateForUndo(volumeNode.GetPointer());
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 2);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int undoPerformance()
+{
+  // This test is for performance
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+  const int nodeCount = 10000;
+  const int undoLevelCount = 100;
+
+  for (int i = 0; i < nodeCount; ++i)
+    {
+    scene->AddNode(vtkSmartPointer<vtkMRMLLinearTransformNode>::New());
+    }
+  vtkNew<vtkMRMLModelNode> modelNode;
+  scene->AddNode(modelNode.GetPointer());
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  for (int i = 0; i < undoLevelCount; ++i)
+    {
+    scene->SaveStateForUndo(modelNode.GetPointer());
+    }
+  for (int i = 0; i < undoLevelCount; ++i)
+    {
+    scene->Undo();
+    }
+  timer->StopTimer();
+  CHECK_INT(scene->GetNumberOfRedoLevels(), undoLevelCount);
+
+  std::cout<< "<DartMeasurement name=\"vtkMRMLScene-UndoPerformance-"
+           << nodeCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
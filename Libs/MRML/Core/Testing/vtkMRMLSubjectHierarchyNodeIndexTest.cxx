@@ -0,0 +1,313 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkMRMLSubjectHierarchyNode.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+int dataNodeIndex();
+int uidIndex();
+int importIndex();
+int lookupPerformance();
+
+const char* SeriesUIDName = "DICOM";
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkMRMLSubjectHierarchyNodeIndexTest(int vtkNotUsed(argc),
+                                         char * vtkNotUsed(argv)[] )
+{
+  CHECK_EXIT_SUCCESS(dataNodeIndex());
+  CHECK_EXIT_SUCCESS(uidIndex());
+  CHECK_EXIT_SUCCESS(importIndex());
+  CHECK_EXIT_SUCCESS(lookupPerformance());
+  return EXIT_SUCCESS;
+}
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+int dataNodeIndex()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene.GetPointer());
+  CHECK_NOT_NULL(shNode);
+  vtkIdType sceneItemID = shNode->GetSceneItemID();
+
+  vtkNew<vtkMRMLModelNode> modelNode1;
+  scene->AddNode(modelNode1.GetPointer());
+  vtkNew<vtkMRMLModelNode> modelNode2;
+  scene->AddNode(modelNode2.GetPointer());
+  vtkNew<vtkMRMLModelNode> unusedModelNode;
+  scene->AddNode(unusedModelNode.GetPointer());
+
+  vtkIdType folderItemID = shNode->CreateFolderItem(sceneItemID, "Folder");
+  vtkIdType modelItemID1 = shNode->CreateItem(folderItemID, modelNode1.GetPointer());
+  vtkIdType modelItemID2 = shNode->CreateItem(modelItemID1, modelNode2.GetPointer());
+  CHECK_INT(shNode->GetItemByDataNode(modelNode1.GetPointer()), modelItemID1);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode2.GetPointer()), modelItemID2);
+  CHECK_INT(shNode->GetItemByDataNode(unusedModelNode.GetPointer()), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+
+  // Creating an item for a data node that already has one returns the existing item
+  CHECK_INT(shNode->CreateItem(sceneItemID, modelNode1.GetPointer()), modelItemID1);
+  CHECK_INT(shNode->GetItemParent(modelItemID1), sceneItemID);
+
+  // Reparented items are still found
+  shNode->SetItemParent(modelItemID2, folderItemID);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode2.GetPointer()), modelItemID2);
+  CHECK_BOOL(shNode->ReparentItemByDataNode(folderItemID, modelNode1.GetPointer()), true);
+  CHECK_INT(shNode->GetItemParent(folderItemID), modelItemID1);
+
+  // Children of removed items are reparented and still found
+  CHECK_BOOL(shNode->RemoveItem(folderItemID, false, false), true);
+  CHECK_INT(shNode->GetItemParent(modelItemID2), modelItemID1);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode2.GetPointer()), modelItemID2);
+
+  // Removed items are not found
+  CHECK_BOOL(shNode->RemoveItem(modelItemID2, false, false), true);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode2.GetPointer()), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+  CHECK_BOOL(shNode->RemoveItem(modelItemID1, false, true), true);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode1.GetPointer()), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+
+  // New item for a data node of a removed item
+  vtkIdType newModelItemID = shNode->CreateItem(sceneItemID, modelNode2.GetPointer());
+  CHECK_BOOL(newModelItemID != modelItemID2, true);
+  CHECK_INT(shNode->GetItemByDataNode(modelNode2.GetPointer()), newModelItemID);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int uidIndex()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene.GetPointer());
+  CHECK_NOT_NULL(shNode);
+  vtkIdType sceneItemID = shNode->GetSceneItemID();
+
+  vtkIdType patientItemID = shNode->CreateSubjectItem(sceneItemID, "Patient");
+  vtkIdType studyItemID = shNode->CreateStudyItem(patientItemID, "Study");
+  vtkIdType seriesItemID = shNode->CreateFolderItem(studyItemID, "Series");
+  shNode->SetItemUID(seriesItemID, SeriesUIDName, "1.2.3");
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.3"), seriesItemID);
+  CHECK_INT(shNode->GetItemByUID("OtherUID", "1.2.3"), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2"), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, ""), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+
+  // Changing the UID value replaces it in the index
+  TESTING_OUTPUT_ASSERT_WARNINGS_BEGIN();
+  shNode->SetItemUID(seriesItemID, SeriesUIDName, "1.2.4");
+  TESTING_OUTPUT_ASSERT_WARNINGS_END();
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.3"), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.4"), seriesItemID);
+
+  // The first item in the tree is returned if multiple items have the same UID
+  vtkIdType otherPatientItemID = shNode->CreateSubjectItem(sceneItemID, "OtherPatient");
+  vtkIdType duplicateSeriesItemID = shNode->CreateFolderItem(otherPatientItemID, "DuplicateSeries");
+  shNode->SetItemUID(duplicateSeriesItemID, SeriesUIDName, "1.2.4");
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.4"), seriesItemID);
+  shNode->MoveItem(otherPatientItemID, patientItemID);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.4"), duplicateSeriesItemID);
+
+  // Removing a branch removes all its items from the index
+  CHECK_BOOL(shNode->RemoveItem(otherPatientItemID), true);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.4"), seriesItemID);
+  CHECK_BOOL(shNode->RemoveItem(patientItemID), true);
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.4"), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int importIndex()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene.GetPointer());
+  CHECK_NOT_NULL(shNode);
+  vtkIdType studyItemID = shNode->CreateStudyItem(shNode->GetSceneItemID(), "Study");
+  shNode->SetItemUID(studyItemID, SeriesUIDName, "1.2.5");
+  vtkNew<vtkMRMLModelNode> modelNode;
+  modelNode->SetName("Model");
+  scene->AddNode(modelNode.GetPointer());
+  vtkIdType modelItemID = shNode->CreateItem(studyItemID, modelNode.GetPointer());
+  shNode->SetItemUID(modelItemID, SeriesUIDName, "1.2.6");
+
+  scene->SetSaveToXMLString(1);
+  scene->Commit();
+  std::string sceneXMLString = scene->GetSceneXMLString();
+
+  // Items read from the scene file are indexed when they are resolved
+  vtkNew<vtkMRMLScene> importedScene;
+  importedScene->SetLoadFromXMLString(1);
+  importedScene->SetSceneXMLString(sceneXMLString);
+  importedScene->Import();
+  vtkMRMLSubjectHierarchyNode* importedShNode =
+    vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(importedScene.GetPointer());
+  CHECK_NOT_NULL(importedShNode);
+
+  vtkMRMLNode* importedModelNode = importedScene->GetFirstNodeByName("Model");
+  CHECK_NOT_NULL(importedModelNode);
+  vtkIdType importedModelItemID = importedShNode->GetItemByDataNode(importedModelNode);
+  CHECK_BOOL(importedModelItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID, true);
+  CHECK_INT(importedShNode->GetItemByUID(SeriesUIDName, "1.2.6"), importedModelItemID);
+  vtkIdType importedStudyItemID = importedShNode->GetItemByUID(SeriesUIDName, "1.2.5");
+  CHECK_BOOL(importedStudyItemID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID, true);
+  CHECK_INT(importedShNode->GetItemParent(importedModelItemID), importedStudyItemID);
+
+  // The indexes are separate for each subject hierarchy
+  CHECK_INT(shNode->GetItemByUID(SeriesUIDName, "1.2.6"), modelItemID);
+  CHECK_INT(importedShNode->GetItemByDataNode(modelNode.GetPointer()), vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID);
+
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+std::string GetSeriesUID(int seriesIndex)
+{
+  std::stringstream uid;
+  uid << "1.2.840.113619.2." << seriesIndex;
+  return uid.str();
+}
+
+//---------------------------------------------------------------------------
+int lookupPerformance()
+{
+  // This test is for performance
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene.GetPointer());
+  CHECK_NOT_NULL(shNode);
+
+  const int patientCount = 10;
+  const int studyCount = 10;
+  const int seriesCount = 500;
+  const int itemCount = patientCount * studyCount * seriesCount;
+  // One series in dataNodeStride has a data node
+  const int dataNodeStride = 10;
+  const int lookupCount = 50000;
+  const int traverseLookupCount = 100;
+
+  std::vector<vtkIdType> seriesItemIDs;
+  std::vector<vtkSmartPointer<vtkMRMLModelNode> > dataNodes;
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  for (int patient = 0; patient < patientCount; ++patient)
+    {
+    vtkIdType patientItemID = shNode->CreateSubjectItem(shNode->GetSceneItemID(), "Patient");
+    for (int study = 0; study < studyCount; ++study)
+      {
+      vtkIdType studyItemID = shNode->CreateStudyItem(patientItemID, "Study");
+      for (int series = 0; series < seriesCount; ++series)
+        {
+        vtkIdType seriesItemID = vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID;
+        if (seriesItemIDs.size() % dataNodeStride == 0)
+          {
+          vtkSmartPointer<vtkMRMLModelNode> dataNode = vtkSmartPointer<vtkMRMLModelNode>::New();
+          seriesItemID = shNode->CreateItem(studyItemID, dataNode);
+          dataNodes.push_back(dataNode);
+          }
+        else
+          {
+          seriesItemID = shNode->CreateFolderItem(studyItemID, "Series");
+          }
+        shNode->SetItemUID(seriesItemID, SeriesUIDName, GetSeriesUID(static_cast<int>(seriesItemIDs.size())));
+        seriesItemIDs.push_back(seriesItemID);
+        }
+      }
+    }
+  timer->StopTimer();
+  CHECK_INT(static_cast<int>(seriesItemIDs.size()), itemCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLSubjectHierarchyNode-CreateItemsPerformance-"
+           << itemCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  vtkMath::RandomSeed(2018);
+  std::vector<int> lookupIndices;
+  std::vector<std::string> lookupUIDs;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    int seriesIndex = static_cast<int>(vtkMath::Random(0.0, itemCount - 1));
+    lookupIndices.push_back(seriesIndex);
+    lookupUIDs.push_back(GetSeriesUID(seriesIndex));
+    }
+
+  // Reference: traverse the tree as the UID list lookup does
+  timer->StartTimer();
+  for (int lookup = 0; lookup < traverseLookupCount; ++lookup)
+    {
+    CHECK_INT(shNode->GetItemByUIDList(SeriesUIDName, lookupUIDs[lookup].c_str()), seriesItemIDs[lookupIndices[lookup]]);
+    }
+  timer->StopTimer();
+  std::cout<< "<DartMeasurement name=\"vtkMRMLSubjectHierarchyNode-TraverseByUIDPerformance-"
+           << traverseLookupCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  timer->StartTimer();
+  int foundItems = 0;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    if (shNode->GetItemByUID(SeriesUIDName, lookupUIDs[lookup].c_str()) == seriesItemIDs[lookupIndices[lookup]])
+      {
+      ++foundItems;
+      }
+    }
+  timer->StopTimer();
+  CHECK_INT(foundItems, lookupCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLSubjectHierarchyNode-GetItemByUIDPerformance-"
+           << lookupCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  vtkNew<vtkMRMLModelNode> unusedDataNode;
+  timer->StartTimer();
+  foundItems = 0;
+  for (int lookup = 0; lookup < lookupCount; ++lookup)
+    {
+    int dataNodeIndex = lookupIndices[lookup] / dataNodeStride;
+    if (shNode->GetItemByDataNode(dataNodes[dataNodeIndex]) == seriesItemIDs[dataNodeIndex * dataNodeStride])
+      {
+      ++foundItems;
+      }
+    // Nodes that have no item, as in node added events
+    if (shNode->GetItemByDataNode(unusedDataNode.GetPointer()) != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+      {
+      --foundItems;
+      }
+    }
+  timer->StopTimer();
+  CHECK_INT(foundItems, lookupCount);
+  std::cout<< "<DartMeasurement name=\"vtkMRMLSubjectHierarchyNode-GetItemByDataNodePerformance-"
+           << lookupCount <<"\" type=\"numeric/double\">"
+           << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
@@ -24,16 +24,21 @@
 #include "vtkMRMLTableNode.h"
 #include "vtkMRMLTableSQLiteStorageNode.h"
 
+#include "vtkDoubleArray.h"
 #include "vtkFloatArray.h"
+#include "vtkIntArray.h"
+#include "vtkStringArray.h"
 #include "vtkTable.h"
 #include "vtkTestErrorObserver.h"
+#include "vtkTimerLog.h"
+#include "vtkTypeInt64Array.h"
 
 // ITKSYS includes
 #include <itksys/SystemTools.hxx>
 
 #include "vtkMRMLCoreTestingMacros.h"
 
-static int removeFile(char *fileName)
+static int removeFile(const std::string& fileName)
 {
   int removed = 1;
   if (itksys::SystemTools::FileExists(fileName))
@@ -43,9 +48,161 @@ static int removeFile(char *fileName)
   return removed;
 }
 
-int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
+//---------------------------------------------------------------------------
+// Values are stored with their type and read back without loss
+static int TestPrecision(vtkMRMLScene* scene)
 {
+  vtkNew<vtkMRMLTableNode> tableNode;
+  scene->AddNode(tableNode.GetPointer());
+  vtkNew<vtkMRMLTableSQLiteStorageNode> storageNode;
+  scene->AddNode(storageNode.GetPointer());
+  tableNode->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  const double realValues[] = { 1.0 / 3.0, -2.0e-300, 6.02214076e23, 0.1 + 0.2 };
+  const vtkTypeInt64 integer64Values[] = { 1099511627777LL, -9007199254740993LL, 0, 42 };
+  const int integerValues[] = { 2147483647, -2147483647 - 1, 7, -7 };
+  const char* textValues[] = { "it's", "a \"quoted\", value", "", "1.5" };
+  const int numberOfRows = 4;
+
+  vtkNew<vtkDoubleArray> realColumn;
+  realColumn->SetName("Real values");
+  vtkNew<vtkTypeInt64Array> integer64Column;
+  integer64Column->SetName("Integer64");
+  vtkNew<vtkIntArray> integerColumn;
+  integerColumn->SetName("Integer");
+  vtkNew<vtkStringArray> textColumn;
+  textColumn->SetName("Text");
+  for (int i = 0; i < numberOfRows; ++i)
+    {
+    realColumn->InsertNextValue(realValues[i]);
+    integer64Column->InsertNextValue(integer64Values[i]);
+    integerColumn->InsertNextValue(integerValues[i]);
+    textColumn->InsertNextValue(textValues[i]);
+    }
+  vtkNew<vtkTable> table;
+  table->AddColumn(realColumn.GetPointer());
+  table->AddColumn(integer64Column.GetPointer());
+  table->AddColumn(integerColumn.GetPointer());
+  table->AddColumn(textColumn.GetPointer());
+  tableNode->SetAndObserveTable(table.GetPointer());
+
+  storageNode->SetFileName("testSQLitePrecision.db");
+  storageNode->SetTableName("Precision");
+  removeFile(storageNode->GetFullNameFromFileName());
+  CHECK_INT(storageNode->WriteData(tableNode.GetPointer()), 1);
+  // Writing again replaces the table
+  CHECK_INT(storageNode->WriteData(tableNode.GetPointer()), 1);
+
+  tableNode->RemoveAllColumns();
+  CHECK_INT(storageNode->ReadData(tableNode.GetPointer()), 1);
+  vtkTable* readTable = tableNode->GetTable();
+  CHECK_INT(readTable->GetNumberOfColumns(), 4);
+  CHECK_INT(readTable->GetNumberOfRows(), numberOfRows);
+
+  vtkDoubleArray* readRealColumn = vtkDoubleArray::SafeDownCast(readTable->GetColumnByName("Real values"));
+  vtkTypeInt64Array* readInteger64Column = vtkTypeInt64Array::SafeDownCast(readTable->GetColumnByName("Integer64"));
+  vtkIntArray* readIntegerColumn = vtkIntArray::SafeDownCast(readTable->GetColumnByName("Integer"));
+  vtkStringArray* readTextColumn = vtkStringArray::SafeDownCast(readTable->GetColumnByName("Text"));
+  CHECK_NOT_NULL(readRealColumn);
+  CHECK_NOT_NULL(readInteger64Column);
+  CHECK_NOT_NULL(readIntegerColumn);
+  CHECK_NOT_NULL(readTextColumn);
+  for (int i = 0; i < numberOfRows; ++i)
+    {
+    CHECK_BOOL(readRealColumn->GetValue(i) == realValues[i], true);
+    CHECK_BOOL(readInteger64Column->GetValue(i) == integer64Values[i], true);
+    CHECK_INT(readIntegerColumn->GetValue(i), integerValues[i]);
+    CHECK_STD_STRING(readTextColumn->GetValue(i), textValues[i]);
+    }
+
+  removeFile(storageNode->GetFullNameFromFileName());
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+static int TestReadWritePerformance(vtkMRMLScene* scene)
+{
+  // This test is for performance
+  vtkNew<vtkMRMLTableNode> tableNode;
+  scene->AddNode(tableNode.GetPointer());
+  vtkNew<vtkMRMLTableSQLiteStorageNode> storageNode;
+  scene->AddNode(storageNode.GetPointer());
+  tableNode->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  const int numberOfRows = 200000;
+  vtkNew<vtkIntArray> indexColumn;
+  indexColumn->SetName("Index");
+  indexColumn->SetNumberOfValues(numberOfRows);
+  vtkNew<vtkDoubleArray> valueColumn;
+  valueColumn->SetName("Value");
+  valueColumn->SetNumberOfValues(numberOfRows);
+  vtkNew<vtkFloatArray> floatColumn;
+  floatColumn->SetName("FloatValue");
+  floatColumn->SetNumberOfValues(numberOfRows);
+  vtkNew<vtkStringArray> labelColumn;
+  labelColumn->SetName("Label");
+  labelColumn->SetNumberOfValues(numberOfRows);
+  for (int i = 0; i < numberOfRows; ++i)
+    {
+    indexColumn->SetValue(i, i);
+    valueColumn->SetValue(i, sqrt(static_cast<double>(i)));
+    floatColumn->SetValue(i, static_cast<float>(i) / 7.0f);
+    labelColumn->SetValue(i, (i % 2) ? "odd" : "even");
+    }
+  vtkNew<vtkTable> table;
+  table->AddColumn(indexColumn.GetPointer());
+  table->AddColumn(valueColumn.GetPointer());
+  table->AddColumn(floatColumn.GetPointer());
+  table->AddColumn(labelColumn.GetPointer());
+  tableNode->SetAndObserveTable(table.GetPointer());
+
+  storageNode->SetFileName("testSQLitePerformance.db");
+  storageNode->SetTableName("Measurements");
+  removeFile(storageNode->GetFullNameFromFileName());
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  CHECK_INT(storageNode->WriteData(tableNode.GetPointer()), 1);
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"vtkMRMLTableSQLiteStorageNode-WritePerformance-"
+            << numberOfRows << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  tableNode->RemoveAllColumns();
+  timer->StartTimer();
+  CHECK_INT(storageNode->ReadData(tableNode.GetPointer()), 1);
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"vtkMRMLTableSQLiteStorageNode-ReadPerformance-"
+            << numberOfRows << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  vtkTable* readTable = tableNode->GetTable();
+  CHECK_INT(readTable->GetNumberOfRows(), numberOfRows);
+  vtkDoubleArray* readValueColumn = vtkDoubleArray::SafeDownCast(readTable->GetColumnByName("Value"));
+  vtkDoubleArray* readFloatColumn = vtkDoubleArray::SafeDownCast(readTable->GetColumnByName("FloatValue"));
+  CHECK_NOT_NULL(readValueColumn);
+  CHECK_NOT_NULL(readFloatColumn);
+  for (int i = 0; i < numberOfRows; i += 997)
+    {
+    CHECK_BOOL(readValueColumn->GetValue(i) == valueColumn->GetValue(i), true);
+    CHECK_BOOL(readFloatColumn->GetValue(i) == floatColumn->GetValue(i), true);
+    }
+
+  removeFile(storageNode->GetFullNameFromFileName());
+  return EXIT_SUCCESS;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLTableSQLiteStorageNodeTest(int argc, char * argv[] )
+{
+  if (argc != 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   vtkNew<vtkMRMLScene> scene;
+  scene->SetRootDirectory(argv[1]);
 
   vtkNew<vtkMRMLTableNode> tableNode;
   scene->AddNode(tableNode.GetPointer());
@@ -82,7 +239,7 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
 
   storageNode->SetFileName("testSQLite.db");
   storageNode->SetTableName("SinCos");
-  removeFile(storageNode->GetFileName());
+  removeFile(storageNode->GetFullNameFromFileName());
 
   storageNode->WriteData(tableNode.GetPointer());
 
@@ -90,7 +247,7 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
   if (tableNode->GetNumberOfColumns() != 0)
     {
     std::cerr << "Unable to remove columns " << std::endl;
-    removeFile(storageNode->GetFileName());
+    removeFile(storageNode->GetFullNameFromFileName());
     return EXIT_FAILURE;
     }
 
@@ -100,19 +257,22 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
   if (tableNode->GetNumberOfColumns() != 3)
     {
     std::cerr << "Unable to read table columns from the database " << storageNode->GetFileName() <<std::endl;
-    removeFile(storageNode->GetFileName());
+    removeFile(storageNode->GetFullNameFromFileName());
     return EXIT_FAILURE;
     }
 
   if (tableNode->GetNumberOfRows() != numPoints)
     {
     std::cerr << "Unable to read table rows from the database " << storageNode->GetFileName() <<std::endl;
-    removeFile(storageNode->GetFileName());
+    removeFile(storageNode->GetFullNameFromFileName());
     return EXIT_FAILURE;
     }
 
   // clean up
-  removeFile(storageNode->GetFileName());
+  removeFile(storageNode->GetFullNameFromFileName());
+
+  CHECK_EXIT_SUCCESS(TestPrecision(scene.GetPointer()));
+  CHECK_EXIT_SUCCESS(TestReadWritePerformance(scene.GetPointer()));
 
   std::cout << "vtkMRMLTableSQLiteStorageNodeTest completed successfully" << std::endl;
   return EXIT_SUCCESS;
@@ -0,0 +1,168 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// vtkTeem includes
+#include <vtkTeemNRRDWriter.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// ITK includes
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkNrrdImageIO.h>
+#include <itkVectorImage.h>
+
+// STD includes
+#include <string>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Segmentation-like labelmap with enough voxels for many compressed blocks
+void CreateLabelmap(vtkImageData* image, int numberOfComponents)
+{
+  image->SetDimensions(120, 110, 90);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+  unsigned char* voxels = static_cast<unsigned char*>(image->GetScalarPointer());
+  const vtkIdType numberOfValues = image->GetNumberOfPoints() * numberOfComponents;
+  for (vtkIdType i = 0; i < numberOfValues; ++i)
+    {
+    voxels[i] = static_cast<unsigned char>((i / 97) % 7 == 0 ? (i % 5) : 0);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool WriteLabelmap(vtkImageData* image, const std::string& fileName)
+{
+  vtkNew<vtkTeemNRRDWriter> writer;
+  writer->SetInputData(image);
+  writer->SetFileName(fileName.c_str());
+  writer->SetUseCompression(1);
+  writer->SetParallelCompression(1);
+  writer->SetNumberOfThreads(4);
+  if (image->GetNumberOfScalarComponents() > 1)
+    {
+    // Same as vtkMRMLSegmentationStorageNode
+    writer->SetVectorAxisKind(nrrdKindList);
+    }
+  writer->Write();
+  return writer->GetWriteError() == 0;
+}
+
+//----------------------------------------------------------------------------
+template <class TImage>
+typename TImage::Pointer ReadWithITK(const std::string& fileName)
+{
+  typedef itk::ImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetImageIO(itk::NrrdImageIO::New());
+  reader->SetFileName(fileName);
+  try
+    {
+    reader->Update();
+    }
+  catch (itk::ExceptionObject& error)
+    {
+    std::cerr << "Failed to read " << fileName << " with ITK: " << error << std::endl;
+    return NULL;
+    }
+  return reader->GetOutput();
+}
+
+//----------------------------------------------------------------------------
+int readScalarLabelmap(const std::string& fileName)
+{
+  vtkNew<vtkImageData> image;
+  CreateLabelmap(image.GetPointer(), 1);
+  CHECK_BOOL(WriteLabelmap(image.GetPointer(), fileName), true);
+  const unsigned char* voxels = static_cast<unsigned char*>(image->GetScalarPointer());
+
+  typedef itk::Image<unsigned char, 3> ImageType;
+  ImageType::Pointer itkImage = ReadWithITK<ImageType>(fileName);
+  CHECK_NOT_NULL(itkImage.GetPointer());
+  CHECK_INT(static_cast<int>(itkImage->GetLargestPossibleRegion().GetNumberOfPixels()),
+    static_cast<int>(image->GetNumberOfPoints()));
+  itk::ImageRegionConstIterator<ImageType> it(itkImage, itkImage->GetLargestPossibleRegion());
+  vtkIdType i = 0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++i)
+    {
+    CHECK_INT(it.Get(), voxels[i]);
+    }
+
+  // Legacy segmentations are read as 4D images
+  typedef itk::Image<unsigned char, 4> Image4DType;
+  Image4DType::Pointer itkImage4D = ReadWithITK<Image4DType>(fileName);
+  CHECK_NOT_NULL(itkImage4D.GetPointer());
+  itk::ImageRegionConstIterator<Image4DType> it4D(itkImage4D, itkImage4D->GetLargestPossibleRegion());
+  i = 0;
+  for (it4D.GoToBegin(); !it4D.IsAtEnd(); ++it4D, ++i)
+    {
+    CHECK_INT(it4D.Get(), voxels[i]);
+    }
+  CHECK_INT(static_cast<int>(i), static_cast<int>(image->GetNumberOfPoints()));
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int readMultiComponentLabelmap(const std::string& fileName)
+{
+  const int numberOfComponents = 3;
+  vtkNew<vtkImageData> image;
+  CreateLabelmap(image.GetPointer(), numberOfComponents);
+  CHECK_BOOL(WriteLabelmap(image.GetPointer(), fileName), true);
+  const unsigned char* voxels = static_cast<unsigned char*>(image->GetScalarPointer());
+
+  typedef itk::VectorImage<unsigned char, 3> ImageType;
+  ImageType::Pointer itkImage = ReadWithITK<ImageType>(fileName);
+  CHECK_NOT_NULL(itkImage.GetPointer());
+  CHECK_INT(static_cast<int>(itkImage->GetNumberOfComponentsPerPixel()), numberOfComponents);
+  CHECK_INT(static_cast<int>(itkImage->GetLargestPossibleRegion().GetNumberOfPixels()),
+    static_cast<int>(image->GetNumberOfPoints()));
+  itk::ImageRegionConstIterator<ImageType> it(itkImage, itkImage->GetLargestPossibleRegion());
+  vtkIdType i = 0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+    for (int component = 0; component < numberOfComponents; ++component, ++i)
+      {
+      CHECK_INT(it.Get()[component], voxels[i]);
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkTeemNRRDWriterITKReadTest(int argc, char * argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: vtkTeemNRRDWriterITKReadTest /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+  // Files compressed in parallel are concatenated gzip members that must be
+  // readable by the ITK NRRD reader, used for segmentations and volumes
+  CHECK_EXIT_SUCCESS(readScalarLabelmap(tempDir + "/vtkTeemNRRDWriterITKReadTest.nrrd"));
+  CHECK_EXIT_SUCCESS(readMultiComponentLabelmap(tempDir + "/vtkTeemNRRDWriterITKReadTest.seg.nrrd"));
+  return EXIT_SUCCESS;
+}
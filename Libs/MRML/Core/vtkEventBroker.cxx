@@ -19,8 +19,17 @@
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkCollection.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
 #include <vtkTimerLog.h>
+#include <vtkUnsignedLongArray.h>
+
+// STD includes
+#include <algorithm>
+#include <sstream>
 
 vtkCxxSetObjectMacro(vtkEventBroker, TimerLog, vtkTimerLog);
 
@@ -31,6 +40,76 @@ vtkCxxSetObjectMacro(vtkEventBroker, TimerLog, vtkTimerLog);
 // ClassFinalize methods handle this instance.
 static vtkEventBroker* vtkEventBrokerInstance;
 
+//----------------------------------------------------------------------------
+namespace
+{
+// Order used to keep the event queue sorted by decreasing priority
+bool vtkEventBrokerHigherPriority(vtkObservation* observation1, vtkObservation* observation2)
+{
+  return observation1->GetPriority() > observation2->GetPriority();
+}
+
+// Event name as displayed in the logs and reports
+std::string vtkEventBrokerEventName(unsigned long event)
+{
+  const char* eventString = vtkCommand::GetStringFromEventId(event);
+  if (!strcmp(eventString, "NoEvent") && event != vtkCommand::NoEvent)
+    {
+    std::stringstream ss;
+    ss << event;
+    return ss.str();
+    }
+  return eventString;
+}
+
+// Escape a string for a JSON report
+std::string vtkEventBrokerJSONString(const std::string& str)
+{
+  std::string escaped("\"");
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+    if (*it == '"' || *it == '\\')
+      {
+      escaped += '\\';
+      escaped += *it;
+      }
+    else if (*it == '\n')
+      {
+      escaped += "\\n";
+      }
+    else
+      {
+      escaped += *it;
+      }
+    }
+  escaped += '"';
+  return escaped;
+}
+
+// Quote a string for a CSV report
+std::string vtkEventBrokerCSVString(const std::string& str)
+{
+  std::string quoted("\"");
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+    if (*it == '"')
+      {
+      quoted += '"';
+      }
+    quoted += *it;
+    }
+  quoted += '"';
+  return quoted;
+}
+
+// Order used to list the hottest observations first
+template <class T>
+bool vtkEventBrokerHigherTotalTime(const T& entry1, const T& entry2)
+{
+  return entry1.second.TotalTime > entry2.second.TotalTime;
+}
+}
+
 //----------------------------------------------------------------------------
 // Must NOT be initialized.  Default initialization to zero is necessary.
 unsigned int vtkEventBrokerInitialize::Count;
@@ -95,6 +174,12 @@ vtkEventBroker::vtkEventBroker()
   this->EventNestingLevel = 0;
   this->TimerLog = vtkTimerLog::New();
   this->CompressCallData = 0;
+  this->ProcessingEventQueue = false;
+  this->NumberOfQueuedEvents = 0;
+  this->NumberOfMergedEvents = 0;
+  this->NumberOfDroppedEvents = 0;
+  this->NumberOfDeliveredEvents = 0;
+  this->Profiling = false;
   this->LogFileName = NULL;
   this->ScriptHandler = NULL;
   this->ScriptHandlerClientData = NULL;
@@ -322,6 +407,12 @@ void vtkEventBroker::RemoveObservations (ObservationVector observations)
   // detach and delete each of the observations
   for(ObservationVector::iterator removeIter=observations.begin(); removeIter != observations.end(); removeIter++)
     {
+    if ( (*removeIter)->GetInEventQueue() )
+      {
+      // pending calls will never be invoked
+      this->NumberOfDroppedEvents += (*removeIter)->GetCallDataList()->size();
+      (*removeIter)->GetCallDataList()->clear();
+      }
     (*removeIter)->SetInEventQueue( 0 );
     this->DetachObservation( *removeIter );
     (*removeIter)->Delete();
@@ -749,11 +840,18 @@ void vtkEventBroker::QueueObservation ( vtkObservation *observation,
   // it it's not there, add the current call data to the list so that each unique combination
   // can be invoked.
   // If the event is not currently in the queue, add it and keep a flag.
+  // The queue is sorted by decreasing priority: the observation is inserted
+  // after the observations with the same or a higher priority.
   //
+  ++this->NumberOfQueuedEvents;
   vtkObservation::CallType call(eid, callData);
   if ( this->GetCompressCallData() &&
        observation->GetEvent() != vtkCommand::AnyEvent)
     {
+    if ( !observation->GetCallDataList()->empty() )
+      {
+      ++this->NumberOfMergedEvents;
+      }
     observation->GetCallDataList()->clear();
     observation->GetCallDataList()->push_back( call );
     }
@@ -772,11 +870,18 @@ void vtkEventBroker::QueueObservation ( vtkObservation *observation,
       {
       observation->GetCallDataList()->push_back( call );
       }
+    else
+      {
+      ++this->NumberOfMergedEvents;
+      }
     }
 
   if ( !observation->GetInEventQueue() )
     {
-    this->EventQueue.push_back( observation );
+    std::deque< vtkObservation* >::iterator insertIter =
+      std::upper_bound( this->EventQueue.begin(), this->EventQueue.end(),
+                        observation, vtkEventBrokerHigherPriority );
+    this->EventQueue.insert( insertIter, observation );
     observation->SetInEventQueue(1);
     }
 }
@@ -842,6 +947,10 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
   observation->SetTotalElapsedTime (observation->GetTotalElapsedTime() + elapsedTime);
   observation->SetLastElapsedTime (elapsedTime);
   this->LogEvent (observation);
+  if ( this->Profiling )
+    {
+    this->RecordProfiling (observation, eid, elapsedTime);
+    }
 
   // clear reference to observation (may cause delete)
   observation->Delete();
@@ -852,34 +961,232 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
 void vtkEventBroker::ProcessEventQueue ()
 {
   //
-  // for each observation on the event queue,
+  // for each observation on the event queue (highest priority first),
   // invoke it with each of the stored callData pointers
+  // - take the observation out of the queue before invoking it so that
+  //   observations queued by the callbacks can be inserted by priority,
+  //   but keep its InEventQueue flag so that new calls are appended to
+  //   its call data list and invoked here
   // - register your pointer to the observation in case it
   //   gets deleted during handling of the event
-  // - if the observation is no longer in the queue, stop processing events
-  // - unregister before after dequeing in case the observation should go away
+  // - if the observation has been removed, stop processing its events
+  // - unregister after the last call in case the observation should go away
   //
-  while ( this->GetNumberOfQueuedObservations() > 0 )
+  if ( this->ProcessingEventQueue )
+    {
+    return;
+    }
+  this->ProcessingEventQueue = true;
+  while ( !this->EventQueue.empty() )
     {
     vtkObservation *observation = this->EventQueue.front();
+    this->EventQueue.pop_front();
     observation->Register( this );
-    int finished = 0;
-    while ( !finished )
+    while ( observation->GetInEventQueue() &&
+            !observation->GetCallDataList()->empty() )
       {
       vtkObservation::CallType call = observation->GetCallDataList()->front();
       observation->GetCallDataList()->pop_front();
-      finished = (observation->GetCallDataList()->size() == 0);
+      ++this->NumberOfDeliveredEvents;
       this->InvokeObservation( observation, call.EventID, call.CallData );
-      if ( !observation->GetInEventQueue() )
-        {
-        observation->GetCallDataList()->clear();
-        finished = 1;
-        break;
-        }
       }
-    this->DequeueObservation();
+    observation->GetCallDataList()->clear();
+    observation->SetInEventQueue(0);
     observation->Delete();
     }
+  this->ProcessingEventQueue = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::ResetEventQueueCounters()
+{
+  this->NumberOfQueuedEvents = 0;
+  this->NumberOfMergedEvents = 0;
+  this->NumberOfDroppedEvents = 0;
+  this->NumberOfDeliveredEvents = 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkEventBroker::ProfilingKey::operator<(const ProfilingKey& other) const
+{
+  if (this->Event != other.Event)
+    {
+    return this->Event < other.Event;
+    }
+  if (this->SubjectClass != other.SubjectClass)
+    {
+    return this->SubjectClass < other.SubjectClass;
+    }
+  return this->Observer < other.Observer;
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::RecordProfiling(vtkObservation* observation,
+                                     unsigned long eid, double elapsedTime)
+{
+  ProfilingKey key;
+  key.SubjectClass = observation->GetSubject() ?
+    observation->GetSubject()->GetClassName() : "(none)";
+  key.Event = eid;
+  if ( observation->GetScript() != NULL )
+    {
+    key.Observer = observation->GetScript();
+    }
+  else if ( observation->GetObserver() )
+    {
+    key.Observer = observation->GetObserver()->GetClassName();
+    }
+  else
+    {
+    key.Observer = "(none)";
+    }
+  ProfilingStatistics& statistics = this->ProfilingStatisticsByObservation[key];
+  ++statistics.Count;
+  statistics.TotalTime += elapsedTime;
+  statistics.MaxTime = std::max(statistics.MaxTime, elapsedTime);
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::ResetProfiling()
+{
+  this->ProfilingStatisticsByObservation.clear();
+}
+
+//----------------------------------------------------------------------------
+int vtkEventBroker::GetNumberOfProfilingEntries()
+{
+  return static_cast<int>(this->ProfilingStatisticsByObservation.size());
+}
+
+//----------------------------------------------------------------------------
+vtkEventBroker::ProfilingStatisticsVector vtkEventBroker::GetSortedProfilingStatistics()
+{
+  ProfilingStatisticsVector statistics(
+    this->ProfilingStatisticsByObservation.begin(),
+    this->ProfilingStatisticsByObservation.end());
+  std::stable_sort(statistics.begin(), statistics.end(),
+    vtkEventBrokerHigherTotalTime<ProfilingStatisticsVector::value_type>);
+  return statistics;
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::GetProfilingStatistics(vtkTable* table)
+{
+  if (!table)
+    {
+    vtkErrorMacro("GetProfilingStatistics: invalid table");
+    return;
+    }
+  ProfilingStatisticsVector statistics = this->GetSortedProfilingStatistics();
+  vtkIdType numberOfEntries = static_cast<vtkIdType>(statistics.size());
+
+  vtkNew<vtkStringArray> subjectClassArray;
+  subjectClassArray->SetName("SubjectClass");
+  subjectClassArray->SetNumberOfValues(numberOfEntries);
+  vtkNew<vtkStringArray> eventArray;
+  eventArray->SetName("Event");
+  eventArray->SetNumberOfValues(numberOfEntries);
+  vtkNew<vtkStringArray> observerArray;
+  observerArray->SetName("Observer");
+  observerArray->SetNumberOfValues(numberOfEntries);
+  vtkNew<vtkUnsignedLongArray> countArray;
+  countArray->SetName("Count");
+  countArray->SetNumberOfValues(numberOfEntries);
+  vtkNew<vtkDoubleArray> totalTimeArray;
+  totalTimeArray->SetName("TotalTime");
+  totalTimeArray->SetNumberOfValues(numberOfEntries);
+  vtkNew<vtkDoubleArray> maxTimeArray;
+  maxTimeArray->SetName("MaxTime");
+  maxTimeArray->SetNumberOfValues(numberOfEntries);
+
+  for (vtkIdType i = 0; i < numberOfEntries; ++i)
+    {
+    const ProfilingKey& key = statistics[i].first;
+    const ProfilingStatistics& value = statistics[i].second;
+    subjectClassArray->SetValue(i, key.SubjectClass);
+    eventArray->SetValue(i, vtkEventBrokerEventName(key.Event));
+    observerArray->SetValue(i, key.Observer);
+    countArray->SetValue(i, value.Count);
+    totalTimeArray->SetValue(i, value.TotalTime);
+    maxTimeArray->SetValue(i, value.MaxTime);
+    }
+
+  table->Initialize();
+  table->AddColumn(subjectClassArray.GetPointer());
+  table->AddColumn(eventArray.GetPointer());
+  table->AddColumn(observerArray.GetPointer());
+  table->AddColumn(countArray.GetPointer());
+  table->AddColumn(totalTimeArray.GetPointer());
+  table->AddColumn(maxTimeArray.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+std::string vtkEventBroker::GetProfilingReport(int format)
+{
+  ProfilingStatisticsVector statistics = this->GetSortedProfilingStatistics();
+  std::stringstream report;
+  if (format == vtkEventBroker::ProfilingReportJSON)
+    {
+    report << "[\n";
+    for (ProfilingStatisticsVector::const_iterator it = statistics.begin();
+      it != statistics.end(); ++it)
+      {
+      report << "  {"
+        << "\"SubjectClass\": " << vtkEventBrokerJSONString(it->first.SubjectClass) << ", "
+        << "\"Event\": " << vtkEventBrokerJSONString(vtkEventBrokerEventName(it->first.Event)) << ", "
+        << "\"Observer\": " << vtkEventBrokerJSONString(it->first.Observer) << ", "
+        << "\"Count\": " << it->second.Count << ", "
+        << "\"TotalTime\": " << it->second.TotalTime << ", "
+        << "\"MaxTime\": " << it->second.MaxTime << "}"
+        << (it + 1 != statistics.end() ? ",\n" : "\n");
+      }
+    report << "]\n";
+    }
+  else if (format == vtkEventBroker::ProfilingReportCSV)
+    {
+    report << "SubjectClass,Event,Observer,Count,TotalTime,MaxTime\n";
+    for (ProfilingStatisticsVector::const_iterator it = statistics.begin();
+      it != statistics.end(); ++it)
+      {
+      report << vtkEventBrokerCSVString(it->first.SubjectClass) << ","
+        << vtkEventBrokerCSVString(vtkEventBrokerEventName(it->first.Event)) << ","
+        << vtkEventBrokerCSVString(it->first.Observer) << ","
+        << it->second.Count << ","
+        << it->second.TotalTime << ","
+        << it->second.MaxTime << "\n";
+      }
+    }
+  else
+    {
+    vtkErrorMacro("GetProfilingReport: unknown format " << format);
+    }
+  return report.str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkEventBroker::WriteProfilingReport(const char* fileName)
+{
+  if (!fileName)
+    {
+    vtkErrorMacro("WriteProfilingReport: invalid file name");
+    return false;
+    }
+  std::string name(fileName);
+  std::string extension(".json");
+  int format = vtkEventBroker::ProfilingReportCSV;
+  if (name.size() >= extension.size() &&
+      name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+    {
+    format = vtkEventBroker::ProfilingReportJSON;
+    }
+  std::ofstream reportFile(fileName);
+  if (!reportFile.is_open())
+    {
+    vtkErrorMacro("WriteProfilingReport: unable to open " << fileName);
+    return false;
+    }
+  reportFile << this->GetProfilingReport(format);
+  return reportFile.good();
 }
 
 //----------------------------------------------------------------------------
@@ -890,10 +1197,17 @@ void vtkEventBroker::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "NumberOfObservations: " << this->GetNumberOfObservations() << "\n";
   os << indent << "NumberOfQueueObservations: " << this->GetNumberOfQueuedObservations() << "\n";
   os << indent << "EventMode: " << this->GetEventModeAsString() << "\n";
+  os << indent << "CompressCallData: " << this->CompressCallData << "\n";
+  os << indent << "NumberOfQueuedEvents: " << this->NumberOfQueuedEvents << "\n";
+  os << indent << "NumberOfMergedEvents: " << this->NumberOfMergedEvents << "\n";
+  os << indent << "NumberOfDroppedEvents: " << this->NumberOfDroppedEvents << "\n";
+  os << indent << "NumberOfDeliveredEvents: " << this->NumberOfDeliveredEvents << "\n";
   os << indent << "EventLogging: " << this->EventLogging << "\n";
   os << indent << "EventNestingLevel: " << this->EventNestingLevel << "\n";
   os << indent << "LogFileName: " <<
     (this->LogFileName ? this->LogFileName : "(none)") << "\n";
+  os << indent << "Profiling: " << this->Profiling << "\n";
+  os << indent << "NumberOfProfilingEntries: " << this->GetNumberOfProfilingEntries() << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 
 // VTK includes
 #include <vtkObject.h>
+class vtkTable;
 class vtkTimerLog;
 
 // STD includes
@@ -28,6 +29,7 @@ class vtkTimerLog;
 #include <set>
 #include <map>
 #include <fstream>
+#include <string>
 
 class vtkCollection;
 class vtkCallbackCommand;
@@ -173,6 +175,47 @@ public:
   /// Write out the current list of observations in graphviz format (.dot)
   int GenerateGraphFile ( const char *graphFile );
 
+  /// Profiling
+  ///
+  /// When profiling is on, each invocation is accumulated per subject class,
+  /// event and observer (observer class name, or script): number of
+  /// invocations, total and maximum elapsed time in seconds.
+  /// Elapsed times include the time spent in nested invocations.
+  /// Profiling is off by default.
+  vtkBooleanMacro (Profiling, bool);
+  vtkSetMacro (Profiling, bool);
+  vtkGetMacro (Profiling, bool);
+
+  ///
+  /// Clear all the statistics collected so far
+  void ResetProfiling();
+
+  ///
+  /// Number of distinct (subject class, event, observer) entries profiled
+  int GetNumberOfProfilingEntries();
+
+  ///
+  /// Fill the table with one row per profiled entry, sorted by decreasing
+  /// total time. Columns are SubjectClass, Event, Observer, Count,
+  /// TotalTime and MaxTime.
+  void GetProfilingStatistics(vtkTable* table);
+
+  enum ProfilingReportFormat {
+    ProfilingReportCSV,
+    ProfilingReportJSON
+  };
+
+  ///
+  /// Return the statistics sorted by decreasing total time, formatted as
+  /// CSV or JSON (see ProfilingReportFormat).
+  std::string GetProfilingReport(int format);
+
+  ///
+  /// Write the profiling report into a file. The format is JSON if the
+  /// file name ends with ".json", CSV otherwise.
+  /// Returns false if the file can not be written.
+  bool WriteProfilingReport(const char* fileName);
+
 
   /// Event Queue processing modes
   ///
@@ -220,8 +263,33 @@ public:
   vtkObservation *DequeueObservation ();
   void InvokeObservation (vtkObservation *observation, unsigned long eid,
                           void *callData);
+
+  ///
+  /// Invoke all the queued observations.
+  /// Observations are delivered by decreasing priority; observations with
+  /// the same priority are delivered in the order they were first queued.
+  /// Events triggered by the callbacks are processed before returning.
+  /// Nested calls (from a callback) return immediately, the queue is
+  /// drained by the outermost call.
+  /// This is typically called once per render cycle (see
+  /// vtkMRMLDisplayableManagerGroup).
   void ProcessEventQueue ();
 
+  ///
+  /// Asynchronous mode counters:
+  /// - NumberOfQueuedEvents: events received while in asynchronous mode
+  /// - NumberOfMergedEvents: events coalesced into an observation that was
+  ///   already in the queue (same event and call data, or any call data
+  ///   if CompressCallData is on)
+  /// - NumberOfDroppedEvents: queued events discarded because their
+  ///   observation was removed before being invoked
+  /// - NumberOfDeliveredEvents: events invoked by ProcessEventQueue
+  vtkGetMacro(NumberOfQueuedEvents, unsigned long);
+  vtkGetMacro(NumberOfMergedEvents, unsigned long);
+  vtkGetMacro(NumberOfDroppedEvents, unsigned long);
+  vtkGetMacro(NumberOfDeliveredEvents, unsigned long);
+  void ResetEventQueueCounters();
+
   ///
   /// two modes -
   ///  - CompressCallDataOn: only keep the most recent call data.  this means that if the
@@ -285,8 +353,40 @@ protected:
 
   int EventMode;
   int CompressCallData;
+  bool ProcessingEventQueue;
+
+  unsigned long NumberOfQueuedEvents;
+  unsigned long NumberOfMergedEvents;
+  unsigned long NumberOfDroppedEvents;
+  unsigned long NumberOfDeliveredEvents;
 
   std::ofstream LogFile;
+
+  /// Profiling statistics of an observation
+  struct ProfilingKey
+  {
+    std::string SubjectClass;
+    unsigned long Event;
+    std::string Observer;
+    bool operator<(const ProfilingKey& other) const;
+  };
+  struct ProfilingStatistics
+  {
+    ProfilingStatistics() : Count(0), TotalTime(0.), MaxTime(0.) {}
+    unsigned long Count;
+    double TotalTime;
+    double MaxTime;
+  };
+  typedef std::map< ProfilingKey, ProfilingStatistics > ProfilingStatisticsMap;
+  typedef std::vector< std::pair< ProfilingKey, ProfilingStatistics > > ProfilingStatisticsVector;
+
+  void RecordProfiling(vtkObservation* observation, unsigned long eid, double elapsedTime);
+  /// Statistics sorted by decreasing total time
+  ProfilingStatisticsVector GetSortedProfilingStatistics();
+
+  bool Profiling;
+  ProfilingStatisticsMap ProfilingStatisticsByObservation;
+
 private:
   /// DetachObservations is a fast (but dangerous) method to delete all the
   /// observations. It leaves the event broker in an inconsistent state:
@@ -0,0 +1,340 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#include "vtkImageMapToWindowLevelThresholdColors.h"
+
+// VTK includes
+#include <vtkAlgorithmOutput.h>
+#include <vtkImageData.h>
+#include <vtkImageStencilData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkScalarsToColors.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Window/level mapping of the input type T to 0-255, computed the same way
+// as vtkImageMapToWindowLevelColors so that both pipelines produce
+// identical colors.
+template <class T>
+struct WindowLevelThresholdParameters
+{
+  T Lower;
+  T Upper;
+  unsigned char LowerValue;
+  unsigned char UpperValue;
+  double Shift;
+  double Scale;
+  double LowerThreshold;
+  double UpperThreshold;
+  bool ApplyThreshold;
+
+  WindowLevelThresholdParameters(vtkImageMapToWindowLevelThresholdColors* self, vtkImageData* inData)
+  {
+    const double window = self->GetWindow();
+    const double level = self->GetLevel();
+    const double rangeMin = inData->GetScalarTypeMin();
+    const double rangeMax = inData->GetScalarTypeMax();
+
+    double lower = level - fabs(window) / 2.0;
+    double upper = lower + fabs(window);
+    const double windowLower = lower;
+    lower = vtkMath::ClampValue(lower, rangeMin, rangeMax);
+    upper = vtkMath::ClampValue(upper, rangeMin, rangeMax);
+    this->Lower = static_cast<T>(lower);
+    this->Upper = static_cast<T>(upper);
+
+    if (window == 0.0)
+      {
+      this->Shift = 0.0;
+      this->Scale = 0.0;
+      this->LowerValue = 0;
+      this->UpperValue = 255;
+      }
+    else
+      {
+      this->Shift = window / 2.0 - level;
+      this->Scale = 255.0 / window;
+      // Output values at the bounds when the window extends beyond the
+      // range of the input type
+      const double lowerValue = 255.0 * (lower - windowLower) / fabs(window);
+      const double upperValue = 255.0 * (upper - windowLower) / fabs(window);
+      this->LowerValue = static_cast<unsigned char>(window > 0 ? lowerValue : 255.0 - lowerValue);
+      this->UpperValue = static_cast<unsigned char>(window > 0 ? upperValue : 255.0 - upperValue);
+      }
+
+    this->LowerThreshold = self->GetLowerThreshold();
+    this->UpperThreshold = self->GetUpperThreshold();
+    this->ApplyThreshold = (self->GetApplyThreshold() != 0);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Color count consecutive voxels of a row. The loop has no function
+// calls and writes each output voxel once.
+template <class T>
+void MapSpan(const WindowLevelThresholdParameters<T>& parameters,
+             const unsigned char* colorTable,
+             const T* inPtr, int inIncrement,
+             unsigned char* outPtr, int count, bool insideStencil)
+{
+  const T lower = parameters.Lower;
+  const T upper = parameters.Upper;
+  const unsigned char lowerValue = parameters.LowerValue;
+  const unsigned char upperValue = parameters.UpperValue;
+  const double shift = parameters.Shift;
+  const double scale = parameters.Scale;
+  const double lowerThreshold = parameters.LowerThreshold;
+  const double upperThreshold = parameters.UpperThreshold;
+  const bool applyThreshold = parameters.ApplyThreshold;
+  for (int i = 0; i < count; ++i, inPtr += inIncrement, outPtr += 4)
+    {
+    const T value = *inPtr;
+    unsigned char index;
+    if (value <= lower)
+      {
+      index = lowerValue;
+      }
+    else if (value >= upper)
+      {
+      index = upperValue;
+      }
+    else
+      {
+      index = static_cast<unsigned char>((value + shift) * scale);
+      }
+    const unsigned char* rgba = colorTable + 4 * index;
+    const bool inThreshold = !applyThreshold ||
+      (lowerThreshold <= value && value <= upperThreshold);
+    outPtr[0] = rgba[0];
+    outPtr[1] = rgba[1];
+    outPtr[2] = rgba[2];
+    outPtr[3] = (insideStencil && inThreshold && rgba[3] != 0) ? 255 : 0;
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkImageMapToWindowLevelThresholdColorsExecute(
+  vtkImageMapToWindowLevelThresholdColors* self, const unsigned char* colorTable,
+  vtkImageData* inData, T*, vtkImageData* outData, vtkImageStencilData* stencil,
+  int outExt[6], int threadId)
+{
+  const WindowLevelThresholdParameters<T> parameters(self, inData);
+  const int inIncrement = inData->GetNumberOfScalarComponents();
+
+  unsigned long count = 0;
+  unsigned long target = static_cast<unsigned long>(
+    (outExt[5] - outExt[4] + 1) * (outExt[3] - outExt[2] + 1) / 50.0);
+  target++;
+
+  for (int z = outExt[4]; z <= outExt[5]; ++z)
+    {
+    for (int y = outExt[2]; !self->AbortExecute && y <= outExt[3]; ++y)
+      {
+      if (!threadId)
+        {
+        if (!(count % target))
+          {
+          self->UpdateProgress(count / (50.0 * target));
+          }
+        count++;
+        }
+      const T* inRow = static_cast<T*>(inData->GetScalarPointer(outExt[0], y, z));
+      unsigned char* outRow = static_cast<unsigned char*>(outData->GetScalarPointer(outExt[0], y, z));
+      if (!stencil)
+        {
+        MapSpan(parameters, colorTable, inRow, inIncrement, outRow,
+                outExt[1] - outExt[0] + 1, true);
+        continue;
+        }
+      // Alternate spans outside and inside the stencil
+      int x = outExt[0];
+      int r1 = 0;
+      int r2 = 0;
+      int iter = 0;
+      while (stencil->GetNextExtent(r1, r2, outExt[0], outExt[1], y, z, iter))
+        {
+        MapSpan(parameters, colorTable,
+                inRow + (x - outExt[0]) * inIncrement, inIncrement,
+                outRow + (x - outExt[0]) * 4, r1 - x, false);
+        MapSpan(parameters, colorTable,
+                inRow + (r1 - outExt[0]) * inIncrement, inIncrement,
+                outRow + (r1 - outExt[0]) * 4, r2 - r1 + 1, true);
+        x = r2 + 1;
+        }
+      MapSpan(parameters, colorTable,
+              inRow + (x - outExt[0]) * inIncrement, inIncrement,
+              outRow + (x - outExt[0]) * 4, outExt[1] - x + 1, false);
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageMapToWindowLevelThresholdColors);
+vtkCxxSetObjectMacro(vtkImageMapToWindowLevelThresholdColors, LookupTable, vtkScalarsToColors);
+
+//----------------------------------------------------------------------------
+vtkImageMapToWindowLevelThresholdColors::vtkImageMapToWindowLevelThresholdColors()
+{
+  this->SetNumberOfInputPorts(2);
+  this->Window = 255.;
+  this->Level = 127.5;
+  this->LowerThreshold = VTK_SHORT_MIN;
+  this->UpperThreshold = VTK_SHORT_MAX;
+  this->ApplyThreshold = 0;
+  this->LookupTable = NULL;
+  for (int i = 0; i < 256; ++i)
+    {
+    this->ColorTable[4 * i + 0] = static_cast<unsigned char>(i);
+    this->ColorTable[4 * i + 1] = static_cast<unsigned char>(i);
+    this->ColorTable[4 * i + 2] = static_cast<unsigned char>(i);
+    this->ColorTable[4 * i + 3] = 255;
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkImageMapToWindowLevelThresholdColors::~vtkImageMapToWindowLevelThresholdColors()
+{
+  this->SetLookupTable(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMapToWindowLevelThresholdColors::SetStencilConnection(vtkAlgorithmOutput* outputPort)
+{
+  this->SetInputConnection(1, outputPort);
+}
+
+//----------------------------------------------------------------------------
+vtkAlgorithmOutput* vtkImageMapToWindowLevelThresholdColors::GetStencilConnection()
+{
+  return this->GetNumberOfInputConnections(1) ? this->GetInputConnection(1, 0) : 0;
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkImageMapToWindowLevelThresholdColors::GetMTime()
+{
+  vtkMTimeType mTime = this->Superclass::GetMTime();
+  if (this->LookupTable && this->LookupTable->GetMTime() > mTime)
+    {
+    mTime = this->LookupTable->GetMTime();
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMapToWindowLevelThresholdColors::FillInputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 1)
+    {
+    info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkImageStencilData");
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+    return 1;
+    }
+  return this->Superclass::FillInputPortInformation(port, info);
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMapToWindowLevelThresholdColors::RequestInformation(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector),
+  vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageMapToWindowLevelThresholdColors::RequestData(
+  vtkInformation* request,
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  // Map the 256 possible windowed values once, lookup tables are not
+  // thread safe.
+  if (this->LookupTable)
+    {
+    unsigned char ramp[256];
+    for (int i = 0; i < 256; ++i)
+      {
+      ramp[i] = static_cast<unsigned char>(i);
+      }
+    this->LookupTable->Build();
+    this->LookupTable->MapScalarsThroughTable2(ramp, this->ColorTable,
+      VTK_UNSIGNED_CHAR, 256, 1, VTK_RGBA);
+    }
+  else
+    {
+    for (int i = 0; i < 256; ++i)
+      {
+      this->ColorTable[4 * i + 0] = static_cast<unsigned char>(i);
+      this->ColorTable[4 * i + 1] = static_cast<unsigned char>(i);
+      this->ColorTable[4 * i + 2] = static_cast<unsigned char>(i);
+      this->ColorTable[4 * i + 3] = 255;
+      }
+    }
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMapToWindowLevelThresholdColors::ThreadedRequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* vtkNotUsed(outputVector),
+  vtkImageData*** inData,
+  vtkImageData** outData,
+  int outExt[6], int threadId)
+{
+  vtkImageData* input = inData[0][0];
+  if (!input || !input->GetPointData()->GetScalars())
+    {
+    return;
+    }
+  vtkImageStencilData* stencil = NULL;
+  if (inputVector[1]->GetNumberOfInformationObjects() > 0)
+    {
+    stencil = vtkImageStencilData::SafeDownCast(
+      inputVector[1]->GetInformationObject(0)->Get(vtkDataObject::DATA_OBJECT()));
+    }
+
+  void* inPtr = input->GetScalarPointer();
+  switch (input->GetScalarType())
+    {
+    vtkTemplateMacro(
+      vtkImageMapToWindowLevelThresholdColorsExecute(this, this->ColorTable,
+        input, static_cast<VTK_TT*>(inPtr), outData[0], stencil, outExt, threadId));
+    default:
+      vtkErrorMacro(<< "ThreadedRequestData: Unknown input ScalarType");
+      return;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageMapToWindowLevelThresholdColors::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Window: " << this->Window << "\n";
+  os << indent << "Level: " << this->Level << "\n";
+  os << indent << "LowerThreshold: " << this->LowerThreshold << "\n";
+  os << indent << "UpperThreshold: " << this->UpperThreshold << "\n";
+  os << indent << "ApplyThreshold: " << this->ApplyThreshold << "\n";
+  os << indent << "LookupTable: " << this->LookupTable << "\n";
+}
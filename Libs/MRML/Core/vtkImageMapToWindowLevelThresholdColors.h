@@ -0,0 +1,110 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageMapToWindowLevelThresholdColors_h
+#define __vtkImageMapToWindowLevelThresholdColors_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkThreadedImageAlgorithm.h>
+
+class vtkAlgorithmOutput;
+class vtkImageStencilData;
+class vtkScalarsToColors;
+
+/// \brief Map scalars to RGBA colors for display in a single pass.
+///
+/// This filter produces the same output as the chain of filters that
+/// vtkMRMLScalarVolumeDisplayNode uses to color a slice:
+/// vtkImageMapToWindowLevelColors (luminance), vtkImageMapToColors (RGBA),
+/// vtkImageThreshold, vtkImageStencil, vtkImageLogic and
+/// vtkImageAppendComponents. Instead of allocating an intermediate image
+/// for each step, every voxel is windowed, looked up in a 256 entry color
+/// table and given an alpha value in one sweep over the input.
+///
+/// The alpha component of the output is 255 if the lookup table alpha is
+/// not 0, the voxel is within the threshold range (or ApplyThreshold is
+/// off) and the voxel is inside the optional stencil, 0 otherwise.
+///
+/// Only the first component of the input is used.
+class VTK_MRML_EXPORT vtkImageMapToWindowLevelThresholdColors : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageMapToWindowLevelThresholdColors *New();
+  vtkTypeMacro(vtkImageMapToWindowLevelThresholdColors, vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  ///
+  /// Window and level applied to the scalars before the lookup table.
+  /// A negative window inverts the mapping.
+  vtkSetMacro(Window, double);
+  vtkGetMacro(Window, double);
+  vtkSetMacro(Level, double);
+  vtkGetMacro(Level, double);
+
+  ///
+  /// Voxels outside of [LowerThreshold, UpperThreshold] are transparent
+  /// when ApplyThreshold is on.
+  vtkSetMacro(LowerThreshold, double);
+  vtkGetMacro(LowerThreshold, double);
+  vtkSetMacro(UpperThreshold, double);
+  vtkGetMacro(UpperThreshold, double);
+  vtkSetMacro(ApplyThreshold, int);
+  vtkGetMacro(ApplyThreshold, int);
+  vtkBooleanMacro(ApplyThreshold, int);
+
+  ///
+  /// Lookup table the windowed values (0 to 255) are mapped through.
+  /// If not set, a grayscale ramp is used.
+  virtual void SetLookupTable(vtkScalarsToColors*);
+  vtkGetObjectMacro(LookupTable, vtkScalarsToColors);
+
+  ///
+  /// Optional stencil, voxels outside of it are transparent.
+  void SetStencilConnection(vtkAlgorithmOutput* outputPort);
+  vtkAlgorithmOutput* GetStencilConnection();
+
+  /// Take the lookup table modification time into account
+  virtual vtkMTimeType GetMTime() VTK_OVERRIDE;
+
+protected:
+  vtkImageMapToWindowLevelThresholdColors();
+  ~vtkImageMapToWindowLevelThresholdColors();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info) VTK_OVERRIDE;
+  virtual int RequestInformation(vtkInformation*, vtkInformationVector**,
+                                 vtkInformationVector*) VTK_OVERRIDE;
+  virtual int RequestData(vtkInformation*, vtkInformationVector**,
+                          vtkInformationVector*) VTK_OVERRIDE;
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int outExt[6], int threadId) VTK_OVERRIDE;
+
+  double Window;
+  double Level;
+  double LowerThreshold;
+  double UpperThreshold;
+  int ApplyThreshold;
+  vtkScalarsToColors* LookupTable;
+
+  /// RGBA of each of the 256 windowed values, filled in RequestData before
+  /// the threads are spawned.
+  unsigned char ColorTable[256 * 4];
+
+private:
+  vtkImageMapToWindowLevelThresholdColors(const vtkImageMapToWindowLevelThresholdColors&);
+  void operator=(const vtkImageMapToWindowLevelThresholdColors&);
+};
+
+#endif
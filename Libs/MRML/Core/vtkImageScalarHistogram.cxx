@@ -0,0 +1,494 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#include "vtkImageScalarHistogram.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationObjectBaseKey.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Voxels smaller than this are not worth a thread
+const vtkIdType MINIMUM_NUMBER_OF_VALUES_PER_THREAD = 65536;
+
+//----------------------------------------------------------------------------
+struct HistogramThreadData
+{
+  void* Values;
+  int ScalarType;
+  int NumberOfComponents;
+  vtkIdType NumberOfValues;
+  vtkIdType Stride;
+  vtkIdType NumberOfSamples;
+  double Origin;
+  double InverseSpacing;
+  int NumberOfBins;
+  bool CountPass;
+
+  // One entry per thread, merged after the threads are joined
+  std::vector<double> Minimum;
+  std::vector<double> Maximum;
+  std::vector<std::vector<vtkIdType> > Counts;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+bool IsNaN(T)
+{
+  return false;
+}
+template <>
+bool IsNaN(float value)
+{
+  return value != value;
+}
+template <>
+bool IsNaN(double value)
+{
+  return value != value;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void ComputeRange(const T* values, int numberOfComponents,
+                  vtkIdType begin, vtkIdType end, double& minimum, double& maximum)
+{
+  const T* ptr = values + begin * numberOfComponents;
+  bool found = false;
+  T minValue = T();
+  T maxValue = T();
+  for (vtkIdType i = begin; i < end; ++i, ptr += numberOfComponents)
+    {
+    const T value = *ptr;
+    if (IsNaN(value))
+      {
+      continue;
+      }
+    if (!found)
+      {
+      minValue = maxValue = value;
+      found = true;
+      }
+    else if (value < minValue)
+      {
+      minValue = value;
+      }
+    else if (value > maxValue)
+      {
+      maxValue = value;
+      }
+    }
+  if (found)
+    {
+    minimum = static_cast<double>(minValue);
+    maximum = static_cast<double>(maxValue);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void CountSamples(const T* values, int numberOfComponents,
+                  vtkIdType beginSample, vtkIdType endSample, vtkIdType stride,
+                  double origin, double inverseSpacing, int numberOfBins,
+                  vtkIdType* counts)
+{
+  const vtkIdType increment = stride * numberOfComponents;
+  const T* ptr = values + beginSample * increment;
+  const int lastBin = numberOfBins - 1;
+  for (vtkIdType i = beginSample; i < endSample; ++i, ptr += increment)
+    {
+    const T value = *ptr;
+    if (IsNaN(value))
+      {
+      continue;
+      }
+    int bin = static_cast<int>((static_cast<double>(value) - origin) * inverseSpacing);
+    bin = bin < 0 ? 0 : (bin > lastBin ? lastBin : bin);
+    ++counts[bin];
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE HistogramThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  HistogramThreadData* data = static_cast<HistogramThreadData*>(info->UserData);
+  const int threadId = info->ThreadID;
+  const int numberOfThreads = info->NumberOfThreads;
+
+  if (!data->CountPass)
+    {
+    const vtkIdType begin = data->NumberOfValues * threadId / numberOfThreads;
+    const vtkIdType end = data->NumberOfValues * (threadId + 1) / numberOfThreads;
+    switch (data->ScalarType)
+      {
+      vtkTemplateMacro(ComputeRange(static_cast<VTK_TT*>(data->Values), data->NumberOfComponents,
+        begin, end, data->Minimum[threadId], data->Maximum[threadId]));
+      }
+    }
+  else
+    {
+    const vtkIdType begin = data->NumberOfSamples * threadId / numberOfThreads;
+    const vtkIdType end = data->NumberOfSamples * (threadId + 1) / numberOfThreads;
+    std::vector<vtkIdType>& counts = data->Counts[threadId];
+    counts.assign(data->NumberOfBins, 0);
+    switch (data->ScalarType)
+      {
+      vtkTemplateMacro(CountSamples(static_cast<VTK_TT*>(data->Values), data->NumberOfComponents,
+        begin, end, data->Stride, data->Origin, data->InverseSpacing, data->NumberOfBins,
+        &counts[0]));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType GreatestCommonDivisor(vtkIdType a, vtkIdType b)
+{
+  while (b != 0)
+    {
+    vtkIdType r = a % b;
+    a = b;
+    b = r;
+    }
+  return a;
+}
+
+//----------------------------------------------------------------------------
+bool IsIntegerScalarType(int scalarType)
+{
+  return scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageScalarHistogram);
+vtkInformationKeyMacro(vtkImageScalarHistogram, HISTOGRAM, ObjectBase);
+
+vtkIdType vtkImageScalarHistogram::DefaultMaximumNumberOfSamples = 16 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+vtkImageScalarHistogram::vtkImageScalarHistogram()
+{
+  this->NumberOfThreads = 0;
+  this->ImageMTime = 0;
+  this->ImageScalars = NULL;
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+vtkImageScalarHistogram::~vtkImageScalarHistogram()
+{
+  this->Initialize();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageScalarHistogram::Initialize()
+{
+  for (size_t level = 0; level < this->Levels.size(); ++level)
+    {
+    this->Levels[level]->Delete();
+    }
+  this->Levels.clear();
+  this->ScalarRange[0] = 0.;
+  this->ScalarRange[1] = 0.;
+  this->NumberOfVoxels = 0;
+  this->NumberOfSamples = 0;
+  this->SampleStride = 1;
+  this->BinOrigin = 0.;
+  this->BinSpacing = 1.;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageScalarHistogram::SetDefaultMaximumNumberOfSamples(vtkIdType maximumNumberOfSamples)
+{
+  vtkImageScalarHistogram::DefaultMaximumNumberOfSamples =
+    std::max(maximumNumberOfSamples, static_cast<vtkIdType>(0));
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImageScalarHistogram::GetDefaultMaximumNumberOfSamples()
+{
+  return vtkImageScalarHistogram::DefaultMaximumNumberOfSamples;
+}
+
+//----------------------------------------------------------------------------
+vtkImageScalarHistogram* vtkImageScalarHistogram::GetCachedHistogram(
+  vtkImageData* image, vtkIdType maximumNumberOfSamples)
+{
+  vtkDataArray* scalars = (image && image->GetPointData()) ?
+    image->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    return NULL;
+    }
+  if (maximumNumberOfSamples < 0)
+    {
+    maximumNumberOfSamples = vtkImageScalarHistogram::DefaultMaximumNumberOfSamples;
+    }
+
+  vtkImageScalarHistogram* histogram = vtkImageScalarHistogram::SafeDownCast(
+    image->GetInformation()->Get(vtkImageScalarHistogram::HISTOGRAM()));
+  if (histogram &&
+      histogram->ImageMTime == image->GetMTime() &&
+      histogram->ImageScalars == scalars &&
+      (histogram->NumberOfSamples == histogram->NumberOfVoxels ||
+       (maximumNumberOfSamples > 0 && histogram->NumberOfSamples >=
+         std::min(maximumNumberOfSamples, histogram->NumberOfVoxels))))
+    {
+    return histogram;
+    }
+
+  vtkImageScalarHistogram* newHistogram = vtkImageScalarHistogram::New();
+  if (!newHistogram->Compute(image, maximumNumberOfSamples))
+    {
+    newHistogram->Delete();
+    return NULL;
+    }
+  // The information keeps the only reference
+  image->GetInformation()->Set(vtkImageScalarHistogram::HISTOGRAM(), newHistogram);
+  newHistogram->Delete();
+  return newHistogram;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageScalarHistogram::Compute(vtkImageData* image, vtkIdType maximumNumberOfSamples)
+{
+  this->Initialize();
+  this->ImageScalars = NULL;
+  vtkDataArray* scalars = (image && image->GetPointData()) ?
+    image->GetPointData()->GetScalars() : NULL;
+  if (!scalars)
+    {
+    vtkErrorMacro("Compute: image has no scalars");
+    return false;
+    }
+  this->ImageMTime = image->GetMTime();
+  this->ImageScalars = scalars;
+  this->NumberOfVoxels = scalars->GetNumberOfTuples();
+
+  // Sample stride, kept coprime with the row length so that the samples do
+  // not all fall in the same columns
+  if (maximumNumberOfSamples > 0 && this->NumberOfVoxels > maximumNumberOfSamples)
+    {
+    this->SampleStride = (this->NumberOfVoxels + maximumNumberOfSamples - 1) / maximumNumberOfSamples;
+    const vtkIdType rowLength = image->GetDimensions()[0];
+    while (rowLength > 1 && GreatestCommonDivisor(this->SampleStride, rowLength) != 1)
+      {
+      ++this->SampleStride;
+      }
+    }
+  this->NumberOfSamples = this->NumberOfVoxels > 0 ?
+    (this->NumberOfVoxels - 1) / this->SampleStride + 1 : 0;
+
+  HistogramThreadData data;
+  data.Values = scalars->GetVoidPointer(0);
+  data.ScalarType = scalars->GetDataType();
+  data.NumberOfComponents = scalars->GetNumberOfComponents();
+  data.NumberOfValues = this->NumberOfVoxels;
+  data.Stride = this->SampleStride;
+  data.NumberOfSamples = this->NumberOfSamples;
+  data.CountPass = false;
+
+  vtkNew<vtkMultiThreader> threader;
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = static_cast<int>(std::max(static_cast<vtkIdType>(1), std::min(
+    static_cast<vtkIdType>(numberOfThreads),
+    this->NumberOfVoxels / MINIMUM_NUMBER_OF_VALUES_PER_THREAD)));
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(HistogramThreadFunction, &data);
+
+  // Exact range over all the voxels
+  data.Minimum.assign(numberOfThreads, VTK_DOUBLE_MAX);
+  data.Maximum.assign(numberOfThreads, VTK_DOUBLE_MIN);
+  threader->SingleMethodExecute();
+  double range[2] = {VTK_DOUBLE_MAX, VTK_DOUBLE_MIN};
+  for (int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    range[0] = std::min(range[0], data.Minimum[thread]);
+    range[1] = std::max(range[1], data.Maximum[thread]);
+    }
+  if (range[0] > range[1])
+    {
+    // No voxel or only NaN values
+    range[0] = range[1] = 0.;
+    }
+  this->ScalarRange[0] = range[0];
+  this->ScalarRange[1] = range[1];
+
+  // One bin per integer value if possible
+  int numberOfBins = MAXIMUM_NUMBER_OF_BINS;
+  this->BinOrigin = range[0];
+  if (IsIntegerScalarType(data.ScalarType) && range[1] - range[0] < MAXIMUM_NUMBER_OF_BINS)
+    {
+    numberOfBins = static_cast<int>(range[1] - range[0]) + 1;
+    this->BinSpacing = 1.;
+    }
+  else if (range[1] > range[0])
+    {
+    this->BinSpacing = (range[1] - range[0]) / numberOfBins;
+    }
+  else
+    {
+    numberOfBins = 1;
+    this->BinSpacing = 1.;
+    }
+
+  data.Origin = this->BinOrigin;
+  data.InverseSpacing = 1. / this->BinSpacing;
+  data.NumberOfBins = numberOfBins;
+  data.CountPass = true;
+  data.Counts.resize(numberOfThreads);
+  threader->SingleMethodExecute();
+
+  vtkIdTypeArray* finestLevel = vtkIdTypeArray::New();
+  finestLevel->SetNumberOfValues(numberOfBins);
+  vtkIdType* counts = finestLevel->GetPointer(0);
+  std::fill(counts, counts + numberOfBins, 0);
+  for (int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    const std::vector<vtkIdType>& threadCounts = data.Counts[thread];
+    for (int bin = 0; bin < numberOfBins; ++bin)
+      {
+      counts[bin] += threadCounts[bin];
+      }
+    }
+  this->Levels.push_back(finestLevel);
+
+  // Coarser levels merge pairs of bins
+  while (this->Levels.back()->GetNumberOfTuples() > 1)
+    {
+    vtkIdTypeArray* fineLevel = this->Levels.back();
+    const vtkIdType fineNumberOfBins = fineLevel->GetNumberOfTuples();
+    const vtkIdType* fineCounts = fineLevel->GetPointer(0);
+    vtkIdTypeArray* coarseLevel = vtkIdTypeArray::New();
+    coarseLevel->SetNumberOfValues((fineNumberOfBins + 1) / 2);
+    vtkIdType* coarseCounts = coarseLevel->GetPointer(0);
+    for (vtkIdType bin = 0; bin < coarseLevel->GetNumberOfTuples(); ++bin)
+      {
+      coarseCounts[bin] = fineCounts[2 * bin] +
+        (2 * bin + 1 < fineNumberOfBins ? fineCounts[2 * bin + 1] : 0);
+      }
+    this->Levels.push_back(coarseLevel);
+    }
+
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageScalarHistogram::GetCumulativeErrorBound()
+{
+  if (this->NumberOfSamples <= 0 || this->NumberOfSamples >= this->NumberOfVoxels)
+    {
+    return 0.;
+    }
+  // Dvoretzky-Kiefer-Wolfowitz inequality with a 95% confidence
+  return sqrt(log(2. / 0.05) / (2. * this->NumberOfSamples));
+}
+
+//----------------------------------------------------------------------------
+int vtkImageScalarHistogram::GetNumberOfLevels()
+{
+  return static_cast<int>(this->Levels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkImageScalarHistogram::GetNumberOfBins(int level)
+{
+  vtkIdTypeArray* counts = this->GetBinCounts(level);
+  return counts ? static_cast<int>(counts->GetNumberOfTuples()) : 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageScalarHistogram::GetBinSpacing(int level)
+{
+  return this->BinSpacing * static_cast<double>(1 << std::max(level, 0));
+}
+
+//----------------------------------------------------------------------------
+vtkIdTypeArray* vtkImageScalarHistogram::GetBinCounts(int level)
+{
+  if (level < 0 || level >= this->GetNumberOfLevels())
+    {
+    vtkErrorMacro("GetBinCounts: level " << level << " out of range 0 to "
+                  << this->GetNumberOfLevels() - 1);
+    return NULL;
+    }
+  return this->Levels[level];
+}
+
+//----------------------------------------------------------------------------
+int vtkImageScalarHistogram::GetLevelForMaximumNumberOfBins(int maximumNumberOfBins)
+{
+  for (int level = 0; level < this->GetNumberOfLevels(); ++level)
+    {
+    if (this->Levels[level]->GetNumberOfTuples() <= maximumNumberOfBins)
+      {
+      return level;
+      }
+    }
+  return this->GetNumberOfLevels() - 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageScalarHistogram::ResampleBinCounts(double origin, double spacing,
+                                                int numberOfBins, vtkIdType* counts)
+{
+  std::fill(counts, counts + numberOfBins, 0);
+  if (this->Levels.empty() || spacing <= 0.)
+    {
+    return;
+    }
+  const vtkIdType* finestCounts = this->Levels[0]->GetPointer(0);
+  const vtkIdType finestNumberOfBins = this->Levels[0]->GetNumberOfTuples();
+  for (vtkIdType bin = 0; bin < finestNumberOfBins; ++bin)
+    {
+    if (finestCounts[bin] == 0)
+      {
+      continue;
+      }
+    const double center = this->BinOrigin + (bin + 0.5) * this->BinSpacing;
+    const double position = floor((center - origin) / spacing);
+    if (position >= 0. && position < numberOfBins)
+      {
+      counts[static_cast<int>(position)] += finestCounts[bin];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageScalarHistogram::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "ImageMTime: " << this->ImageMTime << "\n";
+  os << indent << "ScalarRange: " << this->ScalarRange[0] << " " << this->ScalarRange[1] << "\n";
+  os << indent << "NumberOfVoxels: " << this->NumberOfVoxels << "\n";
+  os << indent << "NumberOfSamples: " << this->NumberOfSamples << "\n";
+  os << indent << "SampleStride: " << this->SampleStride << "\n";
+  os << indent << "BinOrigin: " << this->BinOrigin << "\n";
+  os << indent << "BinSpacing: " << this->BinSpacing << "\n";
+  os << indent << "NumberOfLevels: " << this->GetNumberOfLevels() << "\n";
+}
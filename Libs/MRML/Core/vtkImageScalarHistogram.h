@@ -0,0 +1,143 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageScalarHistogram_h
+#define __vtkImageScalarHistogram_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+class vtkDataArray;
+class vtkIdTypeArray;
+class vtkImageData;
+class vtkInformationObjectBaseKey;
+
+/// \brief Multi-resolution histogram of the scalars of an image.
+///
+/// The histogram of the first scalar component is computed on multiple
+/// threads: one pass over all the voxels finds the exact scalar range, a
+/// second pass counts the voxels into bins. The finest level has one bin
+/// per integer value when the range allows it (at most MAXIMUM_NUMBER_OF_BINS
+/// bins), each coarser level merges pairs of bins of the previous level.
+///
+/// Large images can be subsampled: only every SampleStride-th voxel is
+/// counted so that at most a given number of voxels is read in the second
+/// pass. The deviation of the cumulative distribution of the sampled voxels
+/// from the one of all the voxels is then bounded by
+/// GetCumulativeErrorBound().
+///
+/// GetCachedHistogram() stores the histogram in the information of the image
+/// so that it is computed once per image modification and shared by all the
+/// display nodes, widgets and logics that need it.
+class VTK_MRML_EXPORT vtkImageScalarHistogram : public vtkObject
+{
+public:
+  static vtkImageScalarHistogram *New();
+  vtkTypeMacro(vtkImageScalarHistogram, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+    {
+    MAXIMUM_NUMBER_OF_BINS = 65536
+    };
+
+  /// Return the histogram of \a image, computed with at most
+  /// \a maximumNumberOfSamples counted voxels (0 means all the voxels,
+  /// negative means GetDefaultMaximumNumberOfSamples()).
+  /// The histogram is cached in the image information and recomputed only if
+  /// the image was modified since or if it was sampled more sparsely than
+  /// requested. Returns NULL if the image has no scalars.
+  static vtkImageScalarHistogram* GetCachedHistogram(vtkImageData* image,
+                                                     vtkIdType maximumNumberOfSamples = -1);
+
+  /// Maximum number of voxels counted by GetCachedHistogram() by default.
+  /// Defaults to 16M voxels, 0 disables subsampling.
+  static void SetDefaultMaximumNumberOfSamples(vtkIdType maximumNumberOfSamples);
+  static vtkIdType GetDefaultMaximumNumberOfSamples();
+
+  /// Key of the histogram in the image information
+  static vtkInformationObjectBaseKey* HISTOGRAM();
+
+  /// Compute the histogram of \a image counting at most
+  /// \a maximumNumberOfSamples voxels (0 means all the voxels).
+  /// Returns false if the image has no scalars.
+  bool Compute(vtkImageData* image, vtkIdType maximumNumberOfSamples);
+
+  /// Number of threads used by Compute(), 0 means the vtkMultiThreader
+  /// default.
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Modification time of the image when the histogram was computed
+  vtkGetMacro(ImageMTime, vtkMTimeType);
+
+  /// Exact range of the first component, NaN values are ignored
+  vtkGetVector2Macro(ScalarRange, double);
+
+  /// Number of voxels of the image and number of voxels counted in the bins
+  vtkGetMacro(NumberOfVoxels, vtkIdType);
+  vtkGetMacro(NumberOfSamples, vtkIdType);
+  vtkGetMacro(SampleStride, vtkIdType);
+
+  /// Upper bound (95% confidence) of the difference between the normalized
+  /// cumulative histogram and the one of all the voxels. 0 if all the voxels
+  /// were counted.
+  double GetCumulativeErrorBound();
+
+  /// Level 0 is the finest level, the last level has a single bin.
+  int GetNumberOfLevels();
+  int GetNumberOfBins(int level);
+  double GetBinSpacing(int level);
+  /// Lower bound of the first bin, same for all levels
+  vtkGetMacro(BinOrigin, double);
+  /// Count of the voxels in each bin of \a level, bin i covers
+  /// [BinOrigin + i * spacing, BinOrigin + (i + 1) * spacing[
+  vtkIdTypeArray* GetBinCounts(int level);
+
+  /// Return the finest level that has at most \a maximumNumberOfBins bins
+  int GetLevelForMaximumNumberOfBins(int maximumNumberOfBins);
+
+  /// Accumulate the finest level into \a numberOfBins bins of width
+  /// \a spacing starting at \a origin. The bins of the finest level are
+  /// assigned by their center, the ones outside of the range are ignored.
+  void ResampleBinCounts(double origin, double spacing, int numberOfBins,
+                         vtkIdType* counts);
+
+protected:
+  vtkImageScalarHistogram();
+  ~vtkImageScalarHistogram();
+
+  void Initialize();
+
+  int NumberOfThreads;
+  vtkMTimeType ImageMTime;
+  /// Only used to detect that the image scalars were replaced
+  vtkDataArray* ImageScalars;
+  double ScalarRange[2];
+  vtkIdType NumberOfVoxels;
+  vtkIdType NumberOfSamples;
+  vtkIdType SampleStride;
+  double BinOrigin;
+  double BinSpacing;
+  std::vector<vtkIdTypeArray*> Levels;
+
+  static vtkIdType DefaultMaximumNumberOfSamples;
+
+private:
+  vtkImageScalarHistogram(const vtkImageScalarHistogram&);
+  void operator=(const vtkImageScalarHistogram&);
+};
+
+#endif
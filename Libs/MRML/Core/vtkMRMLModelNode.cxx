@@ -36,6 +36,7 @@ Version:   $Revision: 1.3 $
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 #include <vtkTransformFilter.h>
@@ -698,13 +699,28 @@ void vtkMRMLModelNode::ApplyTransform(vtkAbstractTransform* transform)
     return;
     }
 
+  bool isInPipeline = !vtkTrivialProducer::SafeDownCast(
+     this->MeshConnection ? this->MeshConnection->GetProducer() : 0);
+
+  // If the mesh is a data object and only its points are affected by the
+  // transform (no normals or vectors), transform all the points at once
+  // instead of going through the transform filter one point at a time.
+  vtkPointSet* mesh = this->GetMesh();
+  if (!isInPipeline && transform && mesh->GetPoints()
+    && !mesh->GetPointData()->GetNormals() && !mesh->GetPointData()->GetVectors()
+    && !mesh->GetCellData()->GetNormals() && !mesh->GetCellData()->GetVectors())
+    {
+    vtkNew<vtkPoints> transformedPoints;
+    transformedPoints->SetDataType(mesh->GetPoints()->GetDataType());
+    vtkMRMLTransformNode::TransformPoints(transform, mesh->GetPoints(), transformedPoints.GetPointer());
+    mesh->SetPoints(transformedPoints.GetPointer());
+    return;
+    }
+
   vtkTransformFilter* transformFilter = vtkTransformFilter::New();
   transformFilter->SetInputConnection(this->MeshConnection);
   transformFilter->SetTransform(transform);
 
-  bool isInPipeline = !vtkTrivialProducer::SafeDownCast(
-     this->MeshConnection ? this->MeshConnection->GetProducer() : 0);
-
   // If mesh was set through pipeline (SetMeshConnection), append
   // transform filter to that pipeline
   if (isInPipeline)
@@ -717,7 +733,6 @@ void vtkMRMLModelNode::ApplyTransform(vtkAbstractTransform* transform)
   else
     {
     transformFilter->Update();
-    vtkPointSet * mesh = this->GetMesh();
     mesh->DeepCopy(transformFilter->GetOutput());
     }
   transformFilter->Delete();
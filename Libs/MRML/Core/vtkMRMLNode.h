@@ -336,8 +336,10 @@ public:
   vtkSetStringMacro(Description);
   vtkGetStringMacro(Description);
 
-  /// Name of this node, to be set by the user
-  vtkSetStringMacro(Name);
+  /// Name of this node, to be set by the user.
+  /// The scene is notified so that its name index stays up-to-date.
+  /// \sa vtkMRMLScene::GetNodesByName()
+  virtual void SetName(const char* name);
   vtkGetStringMacro(Name);
 
   /// ID use by other nodes to reference this node in XML.
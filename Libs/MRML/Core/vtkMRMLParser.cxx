@@ -114,26 +114,25 @@ void vtkMRMLParser::StartElement(const char* tagName, const char** atts)
     return;
     }
 
-  const char* tmp = this->MRMLScene->GetClassNameByTag(tagName);
-  std::string className = tmp ? tmp : "";
+  // Most elements are registered tags, create the node from the tag lookup
+  vtkMRMLNode* node = this->MRMLScene->CreateNodeByTag(tagName);
 
   // CreateNodeByClass should have a chance to instantiate non-registered node
-  if (className.empty())
+  if (!node)
     {
-    className = "vtkMRML";
+    std::string className = "vtkMRML";
     className += tagName;
     // Append 'Node' prefix only if required
     if (className.find("Node") != className.size() - 4)
       {
       className += "Node";
       }
-    }
-
-  vtkMRMLNode* node = this->MRMLScene->CreateNodeByClass( className.c_str() );
-  if (!node)
-    {
-    vtkWarningMacro(<< "Failed to CreateNodeByClass: " << className);
-    return;
+    node = this->MRMLScene->CreateNodeByClass( className.c_str() );
+    if (!node)
+      {
+      vtkWarningMacro(<< "Failed to CreateNodeByClass: " << className);
+      return;
+      }
     }
 
   // It is needed to have the scene set before ReadXMLAttributes is
@@ -14,6 +14,8 @@ Version:   $Revision: 1.2 $
 
 // MRML includes
 #include "vtkEventBroker.h"
+#include "vtkImageMapToWindowLevelThresholdColors.h"
+#include "vtkImageScalarHistogram.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 #include "vtkMRMLScene.h"
 #include "vtkMRMLProceduralColorNode.h"
@@ -23,7 +25,6 @@ Version:   $Revision: 1.2 $
 #include <vtkAlgorithmOutput.h>
 #include <vtkCallbackCommand.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkImageAccumulate.h>
 #include <vtkImageAppendComponents.h>
 #include <vtkImageExtractComponents.h>
 #include <vtkImageBimodalAnalysis.h>
@@ -35,11 +36,13 @@ Version:   $Revision: 1.2 $
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 #include <vtkLookupTable.h>
+#include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkVersion.h>
 
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 
 //----------------------------------------------------------------------------
@@ -54,6 +57,7 @@ vtkMRMLScalarVolumeDisplayNode::vtkMRMLScalarVolumeDisplayNode()
   this->AutoWindowLevel = 1;
   this->AutoThreshold = 0;
   this->ApplyThreshold = 0;
+  this->FusedColoring = 1;
   //this->LowerThreshold = VTK_SHORT_MIN;
   //this->UpperThreshold = VTK_SHORT_MAX;
 
@@ -105,8 +109,14 @@ vtkMRMLScalarVolumeDisplayNode::vtkMRMLScalarVolumeDisplayNode()
   this->AppendComponents->AddInputConnection(0, this->ExtractRGB->GetOutputPort() );
   this->AppendComponents->AddInputConnection(0, this->AlphaLogic->GetOutputPort() );
 
+  this->MapToWindowLevelThresholdColors = vtkImageMapToWindowLevelThresholdColors::New();
+  this->MapToWindowLevelThresholdColors->SetWindow(this->MapToWindowLevelColors->GetWindow());
+  this->MapToWindowLevelThresholdColors->SetLevel(this->MapToWindowLevelColors->GetLevel());
+  this->MapToWindowLevelThresholdColors->SetLowerThreshold(this->Threshold->GetLowerThreshold());
+  this->MapToWindowLevelThresholdColors->SetUpperThreshold(this->Threshold->GetUpperThreshold());
+  this->MapToWindowLevelThresholdColors->SetApplyThreshold(this->ApplyThreshold);
+
   this->Bimodal = NULL;
-  this->Accumulate = NULL;
   this->IsInCalculateAutoLevels = false;
 
   vtkEventBroker::GetInstance()->AddObservation(
@@ -126,17 +136,13 @@ vtkMRMLScalarVolumeDisplayNode::~vtkMRMLScalarVolumeDisplayNode()
   this->ExtractRGB->Delete();
   this->ExtractAlpha->Delete();
   this->MultiplyAlpha->Delete();
+  this->MapToWindowLevelThresholdColors->Delete();
 
   if (this->Bimodal)
     {
     this->Bimodal->Delete();
     this->Bimodal = NULL;
     }
-  if (this->Accumulate)
-    {
-    this->Accumulate->Delete();
-    this->Accumulate = NULL;
-    }
 }
 
 //----------------------------------------------------------------------------
@@ -178,6 +184,7 @@ void vtkMRMLScalarVolumeDisplayNode
 {
   this->Threshold->SetInputConnection(imageDataConnection);
   this->MapToWindowLevelColors->SetInputConnection(imageDataConnection);
+  this->MapToWindowLevelThresholdColors->SetInputConnection(imageDataConnection);
 }
 
 //----------------------------------------------------------------------------
@@ -185,6 +192,7 @@ void vtkMRMLScalarVolumeDisplayNode
 ::SetBackgroundImageStencilDataConnection(vtkAlgorithmOutput *imageDataConnection)
 {
   this->MultiplyAlpha->SetStencilConnection(imageDataConnection);
+  this->MapToWindowLevelThresholdColors->SetStencilConnection(imageDataConnection);
 }
 //----------------------------------------------------------------------------
 vtkAlgorithmOutput* vtkMRMLScalarVolumeDisplayNode::GetBackgroundImageStencilDataConnection()
@@ -206,9 +214,35 @@ vtkAlgorithmOutput* vtkMRMLScalarVolumeDisplayNode::GetInputImageDataConnection(
 //----------------------------------------------------------------------------
 vtkAlgorithmOutput* vtkMRMLScalarVolumeDisplayNode::GetOutputImageDataConnection()
 {
+  if (this->IsFusedColoringUsed())
+    {
+    return this->MapToWindowLevelThresholdColors->GetOutputPort();
+    }
   return this->AppendComponents->GetOutputPort();
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLScalarVolumeDisplayNode::IsFusedColoringUsed()
+{
+  // Subclasses that override SetInputToImageDataPipeline connect the chain
+  // to their own filters and leave the fused filter without input.
+  return this->FusedColoring &&
+    this->MapToWindowLevelThresholdColors->GetNumberOfInputConnections(0) > 0 &&
+    this->MapToWindowLevelThresholdColors->GetInputConnection(0, 0) ==
+      this->MapToWindowLevelColors->GetInputConnection(0, 0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLScalarVolumeDisplayNode::SetFusedColoring(int fused)
+{
+  if (this->FusedColoring == fused)
+    {
+    return;
+    }
+  this->FusedColoring = fused;
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::WriteXML(ostream& of, int nIndent)
 {
@@ -395,6 +429,7 @@ void vtkMRMLScalarVolumeDisplayNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ApplyThreshold:    " << this->GetApplyThreshold() << "\n";
   os << indent << "UpperThreshold:    " << this->GetUpperThreshold() << "\n";
   os << indent << "LowerThreshold:    " << this->GetLowerThreshold() << "\n";
+  os << indent << "FusedColoring:     " << this->FusedColoring << "\n";
   os << indent << "Interpolate:       " << this->Interpolate << "\n";
 }
 
@@ -435,13 +470,7 @@ double vtkMRMLScalarVolumeDisplayNode::GetWindow()
 //---------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::SetWindow(double window)
 {
-  if (this->MapToWindowLevelColors->GetWindow() == window)
-    {
-    return;
-    }
-
-  this->MapToWindowLevelColors->SetWindow(window);
-  this->Modified();
+  this->SetWindowLevel(window, this->GetLevel());
 }
 
 //---------------------------------------------------------------------------
@@ -453,27 +482,33 @@ double vtkMRMLScalarVolumeDisplayNode::GetLevel()
 //---------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::SetLevel(double level)
 {
-  if (this->MapToWindowLevelColors->GetLevel() == level)
-    {
-    return;
-    }
-
-  this->MapToWindowLevelColors->SetLevel(level);
-  this->Modified();
+  this->SetWindowLevel(this->GetWindow(), level);
 }
 
 //---------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::SetWindowLevel(double window, double level)
 {
   if (this->MapToWindowLevelColors->GetWindow() == window &&
-      this->MapToWindowLevelColors->GetLevel() == level)
+      this->MapToWindowLevelColors->GetLevel() == level &&
+      this->MapToWindowLevelThresholdColors->GetWindow() == window &&
+      this->MapToWindowLevelThresholdColors->GetLevel() == level)
     {
     return;
     }
 
+  this->UpdateWindowLevelFilters(window, level);
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLScalarVolumeDisplayNode::UpdateWindowLevelFilters(double window, double level)
+{
+  // Both the chain of filters and the fused filter must stay in sync, the
+  // output is taken from one or the other depending on the color node.
   this->MapToWindowLevelColors->SetWindow(window);
   this->MapToWindowLevelColors->SetLevel(level);
-  this->Modified();
+  this->MapToWindowLevelThresholdColors->SetWindow(window);
+  this->MapToWindowLevelThresholdColors->SetLevel(level);
 }
 
 //---------------------------------------------------------------------------
@@ -509,6 +544,7 @@ void vtkMRMLScalarVolumeDisplayNode::SetApplyThreshold(int apply)
     }
   this->ApplyThreshold = apply;
   this->Threshold->SetOutValue(apply ? 0 : 255);
+  this->MapToWindowLevelThresholdColors->SetApplyThreshold(apply);
   this->Modified();
 }
 
@@ -545,6 +581,8 @@ void vtkMRMLScalarVolumeDisplayNode::SetThreshold(double lowerThreshold, double
     return;
     }
   this->Threshold->ThresholdBetween( lowerThreshold, upperThreshold );
+  this->MapToWindowLevelThresholdColors->SetLowerThreshold(this->Threshold->GetLowerThreshold());
+  this->MapToWindowLevelThresholdColors->SetUpperThreshold(this->Threshold->GetUpperThreshold());
   this->Modified();
 }
 
@@ -572,6 +610,7 @@ void vtkMRMLScalarVolumeDisplayNode::UpdateLookupTable(vtkMRMLColorNode* newColo
       }
     }
   this->MapToColors->SetLookupTable(lookupTable);
+  this->MapToWindowLevelThresholdColors->SetLookupTable(lookupTable);
 }
 
 //---------------------------------------------------------------------------
@@ -696,7 +735,18 @@ void vtkMRMLScalarVolumeDisplayNode::GetDisplayScalarRange(double range[2])
     return;
     }
   this->GetScalarImageDataConnection()->GetProducer()->Update();
-  imageData->GetScalarRange(range);
+  // The range of single component images is computed along with the cached
+  // histogram, on multiple threads
+  vtkImageScalarHistogram* histogram = imageData->GetNumberOfScalarComponents() == 1 ?
+    vtkImageScalarHistogram::GetCachedHistogram(imageData) : 0;
+  if (histogram)
+    {
+    histogram->GetScalarRange(range);
+    }
+  else
+    {
+    imageData->GetScalarRange(range);
+    }
   if (imageData->GetNumberOfScalarComponents() >=3 &&
       fabs(range[0]) < 0.000001 && fabs(range[1]) < 0.000001)
     {
@@ -705,6 +755,31 @@ void vtkMRMLScalarVolumeDisplayNode::GetDisplayScalarRange(double range[2])
     }
 }
 
+//---------------------------------------------------------------------------
+namespace
+{
+// Fill histogramImage with the bins vtkImageBimodalAnalysis expects, as
+// vtkImageAccumulate would compute them.
+void SetBimodalHistogramImage(vtkImageScalarHistogram* histogram,
+                              double origin, double spacing, int numberOfBins,
+                              vtkImageData* histogramImage)
+{
+  histogramImage->SetExtent(0, numberOfBins - 1, 0, 0, 0, 0);
+  histogramImage->SetOrigin(origin, 0., 0.);
+  histogramImage->SetSpacing(spacing, 1., 1.);
+  histogramImage->AllocateScalars(VTK_ID_TYPE, 1);
+  vtkIdType* counts = static_cast<vtkIdType*>(histogramImage->GetScalarPointer());
+  if (histogram)
+    {
+    histogram->ResampleBinCounts(origin, spacing, numberOfBins, counts);
+    }
+  else
+    {
+    std::fill(counts, counts + numberOfBins, 0);
+    }
+}
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
 {
@@ -741,10 +816,10 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
     {
     this->Bimodal = vtkImageBimodalAnalysis::New();
     }
-  if (this->Accumulate == NULL)
-    {
-    this->Accumulate = vtkImageAccumulate::New();
-    }
+  // The histogram is shared by all the display nodes of the image and only
+  // computed again when the image is modified
+  vtkImageScalarHistogram* histogram = vtkImageScalarHistogram::GetCachedHistogram(imageDataScalar);
+  vtkNew<vtkImageData> histogramImage;
 
   double window = 0.0;
   double level = 0.0;
@@ -770,12 +845,8 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
     // check the scalar type, bimodal analysis only works on int
 
     // Setup filter to work with signed 16-bit integer.
-    int extent[6] = {0, 65535, 0, 0, 0, 0};
-    this->Accumulate->SetComponentExtent(extent);
-    double origin[3] = {-32768, 0, 0};
-    this->Accumulate->SetComponentOrigin(origin);
-    this->Accumulate->SetInputData(imageDataScalar);
-    this->Bimodal->SetInputConnection(this->Accumulate->GetOutputPort());
+    SetBimodalHistogramImage(histogram, -32768., 1., 65536, histogramImage.GetPointer());
+    this->Bimodal->SetInputData(histogramImage.GetPointer());
     this->Bimodal->Update();
     // Workaround for image data where all accumulate samples fall
     // within the same histogram bin
@@ -804,15 +875,10 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
     long minInt = trunc(range[0]) - 1;
     long maxInt = trunc(range[1]) + 1;
 
-    this->Accumulate->SetInputData(imageDataScalar);
-    int extent[6] = {0, 999, 0, 0, 0, 0};
-    this->Accumulate->SetComponentExtent(extent);
-    double origin[3] = {static_cast<double>(minInt), 0.0, 0.0};
-    this->Accumulate->SetComponentOrigin(origin);
     double spacing[3] = {(maxInt-minInt)/1000.0, 1.0, 1.0};
-    this->Accumulate->SetComponentSpacing(spacing);
-
-    this->Bimodal->SetInputConnection(this->Accumulate->GetOutputPort());
+    SetBimodalHistogramImage(histogram, static_cast<double>(minInt), spacing[0], 1000,
+                             histogramImage.GetPointer());
+    this->Bimodal->SetInputData(histogramImage.GetPointer());
     this->Bimodal->Update();
 
     // The bimodal analysis assumes that the bin indices correspond directly to
@@ -20,13 +20,13 @@
 
 // VTK includes
 class vtkImageAlgorithm;
-class vtkImageAccumulate;
 class vtkImageAppendComponents;
 class vtkImageBimodalAnalysis;
 class vtkImageCast;
 class vtkImageLogic;
 class vtkImageMapToColors;
 class vtkImageMapToWindowLevelColors;
+class vtkImageMapToWindowLevelThresholdColors;
 class vtkImageStencil;
 class vtkImageThreshold;
 class vtkImageExtractComponents;
@@ -135,6 +135,17 @@ class VTK_MRML_EXPORT vtkMRMLScalarVolumeDisplayNode : public vtkMRMLVolumeDispl
 
   virtual void SetDefaultColorMap() VTK_OVERRIDE;
 
+  ///
+  /// Color the scalars in a single pass with
+  /// vtkImageMapToWindowLevelThresholdColors instead of the chain of
+  /// window/level, lookup table, threshold, stencil and append filters.
+  /// The chain is still used if FusedColoring is off or if a subclass feeds
+  /// the pipeline from its own filters.
+  /// On by default, not saved in the scene.
+  vtkGetMacro(FusedColoring, int);
+  virtual void SetFusedColoring(int);
+  vtkBooleanMacro(FusedColoring, int);
+
   ///
   /// alternative method to propagate events generated in Display nodes
   virtual void ProcessMRMLEvents ( vtkObject * /*caller*/,
@@ -203,6 +214,13 @@ protected:
 
   virtual void SetInputToImageDataPipeline(vtkAlgorithmOutput *imageDataConnection) VTK_OVERRIDE;
 
+  /// Returns true if the output comes from MapToWindowLevelThresholdColors
+  bool IsFusedColoringUsed();
+
+  /// Set the window and level of both MapToWindowLevelColors and
+  /// MapToWindowLevelThresholdColors
+  void UpdateWindowLevelFilters(double window, double level);
+
   ///
   /// To hold preset values for window and level, so can restore this display
   /// node's window and level to ones read from DICOM files, or defined by
@@ -226,6 +244,7 @@ protected:
   int AutoWindowLevel;
   int ApplyThreshold;
   int AutoThreshold;
+  int FusedColoring;
 
   vtkImageLogic *AlphaLogic;
   vtkImageMapToColors *MapToColors;
@@ -236,13 +255,15 @@ protected:
   vtkImageExtractComponents *ExtractAlpha;
   vtkImageStencil *MultiplyAlpha;
 
+  /// Single pass equivalent of the filters above, kept in sync with them
+  vtkImageMapToWindowLevelThresholdColors *MapToWindowLevelThresholdColors;
+
   ///
   /// window level presets
   std::vector<WindowLevelPreset> WindowLevelPresets;
 
   ///
   /// Used internally in CalculateScalarAutoLevels and CalculateStatisticsAutoLevels
-  vtkImageAccumulate *Accumulate;
   vtkImageBimodalAnalysis *Bimodal;
   bool IsInCalculateAutoLevels;
 };
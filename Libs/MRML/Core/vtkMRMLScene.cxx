@@ -62,6 +62,7 @@ Version:   $Revision: 1.18 $
 #include "vtkMRMLTransformStorageNode.h"
 #include "vtkMRMLVectorVolumeDisplayNode.h"
 #include "vtkMRMLViewNode.h"
+#include "vtkMRMLVolumeNode.h"
 #include "vtkMRMLVolumeArchetypeStorageNode.h"
 #include "vtkURIHandler.h"
 #include "vtkMRMLLayoutNode.h"
@@ -79,9 +80,14 @@ Version:   $Revision: 1.18 $
 #include "vtkMRMLVectorVolumeNode.h"
 #endif
 
+// SegmentationCore includes
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkCollection.h>
+#include <vtkDataObject.h>
 #include <vtkDebugLeaks.h>
 #include <vtkErrorCode.h>
 #include <vtkObjectFactory.h>
@@ -93,6 +99,7 @@ Version:   $Revision: 1.18 $
 
 // STD includes
 #include <algorithm>
+#include <cstdlib>
 #include <numeric>
 
 //#define MRMLSCENE_VERBOSE
@@ -110,6 +117,9 @@ vtkCxxSetObjectMacro(vtkMRMLScene, URIHandlerCollection, vtkCollection)
 vtkMRMLScene::vtkMRMLScene()
 {
   this->NodeIDsMTime = 0;
+  this->NextNodeIndexPosition = 0;
+  this->NodeIndexValid = false;
+  this->IndexedNodesModification = false;
   this->SceneModifiedTime = 0;
 
   this->RegisteredNodeClasses.clear();
@@ -117,7 +127,12 @@ vtkMRMLScene::vtkMRMLScene()
   this->UniqueNames.clear();
 
   this->Nodes =  vtkCollection::New();
+  this->NodesModifiedCallback = vtkCallbackCommand::New();
+  this->NodesModifiedCallback->SetClientData( reinterpret_cast<void *>(this) );
+  this->NodesModifiedCallback->SetCallback( vtkMRMLScene::NodesCallback );
+  this->Nodes->AddObserver(vtkCommand::ModifiedEvent, this->NodesModifiedCallback);
   this->UndoStackSize = 100;
+  this->UndoStackMemorySize = static_cast<vtkIdType>(1) << 30;
   this->UndoFlag = false;
   this->InUndo = false;
 
@@ -237,9 +252,12 @@ vtkMRMLScene::~vtkMRMLScene()
       vtkDebugMacro("CurrentScene should have already been cleared in DeleteEvent callback: ");
       this->Nodes->RemoveAllItems ( );
       }
+    this->Nodes->RemoveObserver(this->NodesModifiedCallback);
     this->Nodes->Delete();
     this->Nodes = NULL;
     }
+  this->NodesModifiedCallback->Delete();
+  this->NodesModifiedCallback = NULL;
 
   for (unsigned int n=0; n<this->RegisteredNodeClasses.size(); n++)
     {
@@ -293,6 +311,20 @@ void vtkMRMLScene::SceneCallback( vtkObject *vtkNotUsed(caller),
   self->Clear(1);
 }
 
+//------------------------------------------------------------------------------
+void vtkMRMLScene::NodesCallback( vtkObject *vtkNotUsed(caller),
+                                  unsigned long vtkNotUsed(eid),
+                                  void *clientData, void *vtkNotUsed(callData) )
+{
+  vtkMRMLScene *self = reinterpret_cast<vtkMRMLScene *>(clientData);
+  if (self == NULL || self->IndexedNodesModification || !self->NodeIndexValid)
+    {
+    return;
+    }
+  // the collection was modified without updating the indexes
+  self->ClearNodeIndex();
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::Clear(int removeSingletons)
 {
@@ -446,13 +478,10 @@ vtkMRMLNode* vtkMRMLScene::CreateNodeByClass(const char* className)
     return NULL;
     }
   vtkMRMLNode* node = NULL;
-  for (unsigned int i=0; i<RegisteredNodeClasses.size(); i++)
+  vtkMRMLNode* registeredNode = this->GetRegisteredNodeByClass(className);
+  if (registeredNode)
     {
-    if (!strcmp(RegisteredNodeClasses[i]->GetClassName(), className))
-      {
-      node = RegisteredNodeClasses[i]->CreateNodeInstance();
-      break;
-      }
+    node = registeredNode->CreateNodeInstance();
     }
   // non-registered nodes can have a registered factory
   if (node == NULL)
@@ -534,6 +563,8 @@ void vtkMRMLScene::RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
       // we could have replace the entry with the new node also.
       this->RegisteredNodeClasses.erase(this->RegisteredNodeClasses.begin() + i);
       this->RegisteredNodeTags.erase(this->RegisteredNodeTags.begin() + i);
+      // Lookup maps refer to the unregistered node, recompute them.
+      this->UpdateRegisteredNodeClassMaps();
       // we found a matching tag, there is maximum one in the list, no need to
       // search any further
       break;
@@ -543,6 +574,68 @@ void vtkMRMLScene::RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
   node->Register(this);
   this->RegisteredNodeClasses.push_back(node);
   this->RegisteredNodeTags.push_back(xmlTag);
+  // The first registered node of a class is used to create nodes by class
+  // name, insert() doesn't replace existing entries.
+  this->RegisteredNodesByClass.insert(std::make_pair(std::string(node->GetClassName()), node));
+  this->RegisteredNodesByTag[xmlTag] = node;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLScene::UpdateRegisteredNodeClassMaps()
+{
+  this->RegisteredNodesByClass.clear();
+  this->RegisteredNodesByTag.clear();
+  for (unsigned int i = 0; i < this->RegisteredNodeClasses.size(); ++i)
+    {
+    vtkMRMLNode* node = this->RegisteredNodeClasses[i];
+    this->RegisteredNodesByClass.insert(std::make_pair(std::string(node->GetClassName()), node));
+    this->RegisteredNodesByTag[this->RegisteredNodeTags[i]] = node;
+    }
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLScene::GetRegisteredNodeByClass(const char* className)
+{
+  if (className == NULL)
+    {
+    return NULL;
+    }
+  std::map< std::string, vtkMRMLNode* >::iterator it = this->RegisteredNodesByClass.find(className);
+  return (it != this->RegisteredNodesByClass.end() ? it->second : NULL);
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLScene::GetRegisteredNodeByTag(const char* tagName)
+{
+  if (tagName == NULL)
+    {
+    return NULL;
+    }
+  std::map< std::string, vtkMRMLNode* >::iterator it = this->RegisteredNodesByTag.find(tagName);
+  return (it != this->RegisteredNodesByTag.end() ? it->second : NULL);
+}
+
+//------------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLScene::CreateNodeByTag(const char* tagName)
+{
+  vtkMRMLNode* registeredNode = this->GetRegisteredNodeByTag(tagName);
+  if (!registeredNode)
+    {
+    return NULL;
+    }
+  // Instantiate the registered node directly instead of looking it up again
+  // by class name with CreateNodeByClass()
+  vtkMRMLNode* node = registeredNode->CreateNodeInstance();
+  if (!node)
+    {
+    return NULL;
+    }
+  vtkMRMLNode* defaultNode = this->GetDefaultNodeByClass(node->GetClassName());
+  if (defaultNode)
+    {
+    node->Reset(defaultNode);
+    }
+  return node;
 }
 
 //------------------------------------------------------------------------------
@@ -594,14 +687,8 @@ const char* vtkMRMLScene::GetClassNameByTag(const char *tagName)
     vtkErrorMacro("GetClassNameByTag: tagname is null");
     return NULL;
     }
-  for (unsigned int i=0; i<RegisteredNodeTags.size(); i++)
-    {
-    if (!strcmp(RegisteredNodeTags[i].c_str(), tagName))
-      {
-      return (RegisteredNodeClasses[i])->GetClassName();
-      }
-    }
-  return NULL;
+  vtkMRMLNode* registeredNode = this->GetRegisteredNodeByTag(tagName);
+  return (registeredNode ? registeredNode->GetClassName() : NULL);
 }
 
 //------------------------------------------------------------------------------
@@ -612,14 +699,8 @@ const char* vtkMRMLScene::GetTagByClassName(const char *className)
     vtkErrorMacro("GetTagByClassName: className is null");
     return NULL;
     }
-  for (unsigned int i=0; i<this->RegisteredNodeClasses.size(); i++)
-    {
-    if (!strcmp(this->RegisteredNodeClasses[i]->GetClassName(), className))
-      {
-      return (this->RegisteredNodeClasses[i])->GetNodeTagName();
-      }
-    }
-  return NULL;
+  vtkMRMLNode* registeredNode = this->GetRegisteredNodeByClass(className);
+  return (registeredNode ? registeredNode->GetNodeTagName() : NULL);
 }
 
 //------------------------------------------------------------------------------
@@ -1183,10 +1264,11 @@ vtkMRMLNode* vtkMRMLScene::AddNodeNoNotify(vtkMRMLNode *n)
     n->SetName(this->GenerateUniqueName(n).c_str());
     }
   n->SetScene( this );
-  this->Nodes->vtkCollection::AddItem((vtkObject *)n);
+  this->AppendNodeToCollection(n);
 
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  this->RecordAddedNodeForUndo(n);
 
   //n->OnNodeAddedToScene();
 
@@ -1345,10 +1427,11 @@ void vtkMRMLScene::RemoveNode(vtkMRMLNode *n)
     {
     n->SetScene(0);
     }
-  this->Nodes->vtkCollection::RemoveItem((vtkObject *)n);
+  this->RemoveNodeFromCollection(n);
 
   std::string nid=n->GetID();
   this->RemoveNodeID(n->GetID());
+  this->RecordRemovedNodeForUndo(n);
 
   this->InvokeEvent(vtkMRMLScene::NodeRemovedEvent, n);
 
@@ -1526,18 +1609,7 @@ int vtkMRMLScene::GetNumberOfNodesByClass(const char *className)
     vtkErrorMacro("GetNumberOfNodesByClass: class name is null.");
     return 0;
     }
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
-    {
-    if (node->IsA(className))
-      {
-      num++;
-      }
-    }
-  return num;
+  return static_cast<int>(this->GetNodeClassIndex(className).size());
 }
 
 //------------------------------------------------------------------------------
@@ -1549,15 +1621,11 @@ int vtkMRMLScene::GetNodesByClass(const char *className, std::vector<vtkMRMLNode
     vtkErrorMacro("GetNodesByClass: class name is null.");
     return 0;
     }
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const NodeIndexType& classNodes = this->GetNodeClassIndex(className);
+  nodes.reserve(classNodes.size());
+  for (NodeIndexType::const_iterator it = classNodes.begin(); it != classNodes.end(); ++it)
     {
-    if (node->IsA(className))
-      {
-      nodes.push_back(node);
-      }
+    nodes.push_back(it->second);
     }
   return static_cast<int>(nodes.size());
 }
@@ -1571,15 +1639,10 @@ vtkCollection* vtkMRMLScene::GetNodesByClass(const char *className)
     return 0;
     }
   vtkCollection* nodes = vtkCollection::New();
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const NodeIndexType& classNodes = this->GetNodeClassIndex(className);
+  for (NodeIndexType::const_iterator it = classNodes.begin(); it != classNodes.end(); ++it)
     {
-    if (node->IsA(className))
-      {
-      nodes->AddItem(node);
-      }
+    nodes->AddItem(it->second);
     }
   return nodes;
 }
@@ -1640,13 +1703,11 @@ vtkMRMLNode* vtkMRMLScene::GetSingletonNode(const char* singletonTag, const char
     return NULL;
     }
 
-  vtkCollectionSimpleIterator it;
-  vtkMRMLNode* node = NULL;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const NodeIndexType& classNodes = this->GetNodeClassIndex(className);
+  for (NodeIndexType::const_iterator it = classNodes.begin(); it != classNodes.end(); ++it)
     {
-    if (node->IsA(className) &&
-        node->GetSingletonTag() != NULL &&
+    vtkMRMLNode* node = it->second;
+    if (node->GetSingletonTag() != NULL &&
         strcmp(node->GetSingletonTag(), singletonTag) == 0)
       {
       return node;
@@ -1716,22 +1777,33 @@ vtkMRMLNode* vtkMRMLScene::GetNthNodeByClass(int n, const char *className)
     return NULL;
     }
 
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const NodeIndexType& classNodes = this->GetNodeClassIndex(className);
+  if (n >= static_cast<int>(classNodes.size()))
     {
-    if (node->IsA(className))
-      {
-      if (num == n)
-        {
-        return node;
-        }
-      num++;
-      }
+    return NULL;
     }
-  return NULL;
+  // Start from the closest of the first node, the last node or the node
+  // returned by the previous call for this class.
+  const int numberOfNodes = static_cast<int>(classNodes.size());
+  int position = 0;
+  NodeIndexType::const_iterator it = classNodes.begin();
+  if (numberOfNodes - 1 - n < n)
+    {
+    position = numberOfNodes - 1;
+    it = classNodes.end();
+    --it;
+    }
+  std::map< std::string, std::pair< int, NodeIndexType::const_iterator > >::iterator cursorIt =
+    this->NthNodeByClassCursors.find(className);
+  if (cursorIt != this->NthNodeByClassCursors.end()
+    && abs(n - cursorIt->second.first) < abs(n - position))
+    {
+    position = cursorIt->second.first;
+    it = cursorIt->second.second;
+    }
+  std::advance(it, n - position);
+  this->NthNodeByClassCursors[className] = std::make_pair(n, it);
+  return it->second;
 }
 
 //------------------------------------------------------------------------------
@@ -1751,15 +1823,15 @@ vtkCollection* vtkMRMLScene::GetNodesByName(const char* name)
     return nodes;
     }
 
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  this->UpdateNodeIndex();
+  std::map< std::string, NodeIndexType >::iterator nameIt = this->NodesByName.find(name);
+  if (nameIt == this->NodesByName.end())
     {
-    if (!strcmp(node->GetName(), name))
-      {
-      nodes->AddItem(node);
-      }
+    return nodes;
+    }
+  for (NodeIndexType::iterator it = nameIt->second.begin(); it != nameIt->second.end(); ++it)
+    {
+    nodes->AddItem(it->second);
     }
   return nodes;
 }
@@ -1770,12 +1842,13 @@ vtkMRMLNode* vtkMRMLScene::GetFirstNode(const char* byName,
                                         const int* byHideFromEditors,
                                         bool exactNameMatch)
 {
-  vtkCollectionSimpleIterator it;
-  vtkMRMLNode* node;
-  for (this->Nodes->InitTraversal(it);
-       (node= vtkMRMLNode::SafeDownCast(
-          this->Nodes->GetNextItemAsObject(it))) ;)
+  // Only traverse the nodes of the requested class if any
+  this->UpdateNodeIndex();
+  const NodeIndexType& candidateNodes = (byClass ?
+    this->GetNodeClassIndex(byClass) : this->IndexedNodesByPosition);
+  for (NodeIndexType::const_iterator it = candidateNodes.begin(); it != candidateNodes.end(); ++it)
     {
+    vtkMRMLNode* node = it->second;
     if (exactNameMatch && byName &&
         node->GetName() != 0 && strcmp(node->GetName(), byName) != 0)
       {
@@ -1786,10 +1859,6 @@ vtkMRMLNode* vtkMRMLScene::GetFirstNode(const char* byName,
       {
       continue;
       }
-    if (byClass && !node->IsA(byClass))
-      {
-      continue;
-      }
     if (byHideFromEditors && node->GetHideFromEditors() != *byHideFromEditors)
       {
       continue;
@@ -1809,16 +1878,13 @@ vtkMRMLNode* vtkMRMLScene::GetFirstNodeByName(const char* name)
     return node;
     }
 
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  this->UpdateNodeIndex();
+  std::map< std::string, NodeIndexType >::iterator nameIt = this->NodesByName.find(name);
+  if (nameIt == this->NodesByName.end() || nameIt->second.empty())
     {
-    if (node->GetName() != 0 && !strcmp(node->GetName(), name))
-      {
-      return node;
-      }
+    return 0;
     }
-  return 0;
+  return nameIt->second.begin()->second;
 }
 
 //------------------------------------------------------------------------------
@@ -1878,13 +1944,17 @@ vtkCollection* vtkMRMLScene::GetNodesByClassByName(const char* className, const
     return nodes;
     }
 
-  vtkMRMLNode *node;
-  for (int n=0; n < this->Nodes->GetNumberOfItems(); n++)
+  this->UpdateNodeIndex();
+  std::map< std::string, NodeIndexType >::iterator nameIt = this->NodesByName.find(name);
+  if (nameIt == this->NodesByName.end())
     {
-    node = (vtkMRMLNode*)this->Nodes->GetItemAsObject(n);
-    if (!strcmp(node->GetName(), name) && node->IsA(className))
+    return nodes;
+    }
+  for (NodeIndexType::iterator it = nameIt->second.begin(); it != nameIt->second.end(); ++it)
+    {
+    if (it->second->IsA(className))
       {
-      nodes->AddItem(node);
+      nodes->AddItem(it->second);
       }
     }
 
@@ -1953,17 +2023,20 @@ vtkMRMLNode* vtkMRMLScene::InsertAfterNode(vtkMRMLNode *item, vtkMRMLNode *n)
   if (itemIndex == 0)
     {
     // it wasn't found, just add
-    this->Nodes->vtkCollection::AddItem((vtkObject *)n);
+    this->AppendNodeToCollection(n);
     }
   else
     {
     // the object was found, the location is the return value-1.
     index = itemIndex - 1;
     vtkDebugMacro("InsertAfterNode: item index = " << itemIndex-1 << ", inserting after index = " << index);
+    // positions of the following nodes change, the collection observer
+    // invalidates the indexes
     this->Nodes->vtkCollection::InsertItem(index, (vtkObject *)n);
     }
   // cache the node so the whole scene cache stays up-to-date
   this->AddNodeID(n);
+  this->RecordAddedNodeForUndo(n);
 
   n->SetDisableModifiedEvent(modifyStatus);
 
@@ -2037,7 +2110,7 @@ vtkMRMLNode* vtkMRMLScene::InsertBeforeNode(vtkMRMLNode *item, vtkMRMLNode *n)
   if (itemIndex == 0)
     {
     // it wasn't found, just add
-    this->Nodes->vtkCollection::AddItem((vtkObject *)n);
+    this->AppendNodeToCollection(n);
     }
   else
     {
@@ -2045,10 +2118,13 @@ vtkMRMLNode* vtkMRMLScene::InsertBeforeNode(vtkMRMLNode *item, vtkMRMLNode *n)
     // then go one more up to get before it
     index = itemIndex - 2;
     vtkDebugMacro("InsertBeforeNode: item index = " << itemIndex-1 << ", inserting after index = " << index);
+    // positions of the following nodes change, the collection observer
+    // invalidates the indexes
     this->Nodes->vtkCollection::InsertItem(index, (vtkObject *)n);
     }
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  this->RecordAddedNodeForUndo(n);
 
   n->SetDisableModifiedEvent(modifyStatus);
 
@@ -2069,6 +2145,10 @@ void vtkMRMLScene::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ErrorCode = " << this->ErrorCode << "\n";
   os << indent << "URL = " << this->GetURL() << "\n";
   os << indent << "Root Directory = " << this->GetRootDirectory() << "\n";
+  os << indent << "UndoStackSize = " << this->UndoStackSize << "\n";
+  os << indent << "UndoStackMemorySize = " << this->UndoStackMemorySize << "\n";
+  os << indent << "Number of undo levels = " << this->UndoStack.size() << "\n";
+  os << indent << "Number of redo levels = " << this->RedoStack.size() << "\n";
 
   this->Nodes->vtkCollection::PrintSelf(os,indent);
   std::list<std::string> classes = this->GetNodeClassesList();
@@ -2145,19 +2225,7 @@ vtkMRMLNode *vtkMRMLScene::GetNthRegisteredNodeClass(int n)
 //------------------------------------------------------------------------------
 bool vtkMRMLScene::IsNodeClassRegistered(const std::string& className)
 {
-  for (int index=0; index < this->GetNumberOfRegisteredNodeClasses(); ++index)
-    {
-    vtkMRMLNode* registeredNodeClass = this->GetNthRegisteredNodeClass(index);
-    if (!registeredNodeClass)
-      {
-      continue;
-      }
-    if (className == registeredNodeClass->GetClassName())
-      {
-      return true;
-      }
-    }
-  return false;
+  return this->RegisteredNodesByClass.find(className) != this->RegisteredNodesByClass.end();
 }
 
 //------------------------------------------------------------------------------
@@ -2439,63 +2507,135 @@ void vtkMRMLScene::SaveStateForUndo ()
 }
 
 //------------------------------------------------------------------------------
-// Make a new collection that has pointers to all the nodes in the current scene
+// Start a new undo level: changes of the scene are recorded in it until the
+// next checkpoint.
 void vtkMRMLScene::PushIntoUndoStack()
 {
-  if (this->Nodes == NULL)
+  if (!this->UndoStack.empty())
     {
-    return;
+    this->UpdateUndoLevelMemorySize(this->UndoStack.back());
     }
+  this->UndoStack.push_back(new UndoLevel);
+  this->TrimUndoLevels(this->UndoStack);
+}
 
-  vtkCollection* newScene = vtkCollection::New();
-
-  vtkCollection* currentScene = this->Nodes;
+//------------------------------------------------------------------------------
+// Start a new redo level: changes made by Undo() are recorded in it.
+void vtkMRMLScene::PushIntoRedoStack()
+{
+  if (!this->RedoStack.empty())
+    {
+    this->UpdateUndoLevelMemorySize(this->RedoStack.back());
+    }
+  this->RedoStack.push_back(new UndoLevel);
+  this->TrimUndoLevels(this->RedoStack);
+}
 
-  int nnodes = currentScene->GetNumberOfItems();
+namespace
+{
 
-  for (int n=0; n<nnodes; n++)
+//------------------------------------------------------------------------------
+// Append the bulk data held by the node to dataObjects
+void GetNodeDataObjects(vtkMRMLNode* node, std::vector<vtkDataObject*>& dataObjects)
+{
+  if (vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(node))
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
+    dataObjects.push_back(volumeNode->GetImageData());
+    }
+  else if (vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node))
+    {
+    dataObjects.push_back(modelNode->GetMesh());
+    }
+  else if (vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(node))
+    {
+    vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+    int numberOfSegments = (segmentation ? segmentation->GetNumberOfSegments() : 0);
+    for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
       {
-      newScene->AddItem(node);
+      vtkSegment* segment = segmentation->GetNthSegment(segmentIndex);
+      std::vector<std::string> representationNames;
+      segment->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator nameIt = representationNames.begin();
+        nameIt != representationNames.end(); ++nameIt)
+        {
+        dataObjects.push_back(segment->GetRepresentation(*nameIt));
+        }
       }
     }
+}
 
-  //TODO check max stack size
-  this->UndoStack.push_back(newScene);
 }
 
 //------------------------------------------------------------------------------
-// Make a new collection that has pointers to the current scene nodes
-void vtkMRMLScene::PushIntoRedoStack()
+void vtkMRMLScene::UpdateUndoLevelMemorySize(UndoLevel* level)
 {
-  if (this->Nodes == NULL)
+  // Data still used by the scene costs nothing to keep. Only the nodes of
+  // the level are visited, so that starting a level does not depend on the
+  // size of the scene or on the number of levels. Data shared by several
+  // levels is counted in each of them.
+  std::set<vtkDataObject*> countedDataObjects;
+  std::vector<vtkDataObject*> dataObjects;
+  for (UndoLevel::NodeStatesType::iterator it = level->ModifiedNodes.begin();
+    it != level->ModifiedNodes.end(); ++it)
     {
-    return;
+    vtkMRMLNode* sceneNode = this->GetNodeByID(it->first);
+    if (sceneNode)
+      {
+      GetNodeDataObjects(sceneNode, dataObjects);
+      countedDataObjects.insert(dataObjects.begin(), dataObjects.end());
+      dataObjects.clear();
+      }
     }
-
-  vtkCollection* newScene = vtkCollection::New();
-
-  vtkCollection* currentScene = this->Nodes;
-
-  int nnodes = currentScene->GetNumberOfItems();
-
-  for (int n=0; n<nnodes; n++)
+  vtkIdType memorySize = 0;
+  for (UndoLevel::NodeStatesType::iterator it = level->ModifiedNodes.begin();
+    it != level->ModifiedNodes.end(); ++it)
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
+    GetNodeDataObjects(it->second, dataObjects);
+    }
+  for (UndoLevel::RemovedNodesType::iterator it = level->RemovedNodes.begin();
+    it != level->RemovedNodes.end(); ++it)
+    {
+    GetNodeDataObjects(*it, dataObjects);
+    }
+  for (std::vector<vtkDataObject*>::iterator dataIt = dataObjects.begin(); dataIt != dataObjects.end(); ++dataIt)
+    {
+    if (*dataIt && countedDataObjects.insert(*dataIt).second)
       {
-      newScene->AddItem(node);
+      // GetActualMemorySize() is in kibibytes
+      memorySize += static_cast<vtkIdType>((*dataIt)->GetActualMemorySize()) * 1024;
       }
     }
+  level->MemorySize = memorySize;
+}
 
-  //TODO check max stack size
-  this->RedoStack.push_back(newScene);
+//------------------------------------------------------------------------------
+void vtkMRMLScene::TrimUndoLevels(std::list< UndoLevel* >& stack)
+{
+  // Oldest levels are discarded first
+  while (this->UndoStackSize > 0 && static_cast<int>(stack.size()) > this->UndoStackSize)
+    {
+    delete stack.front();
+    stack.pop_front();
+    }
+  if (this->UndoStackMemorySize <= 0)
+    {
+    return;
+    }
+  vtkIdType stackMemorySize = 0;
+  for (std::list< UndoLevel* >::iterator levelIt = stack.begin(); levelIt != stack.end(); ++levelIt)
+    {
+    stackMemorySize += (*levelIt)->MemorySize;
+    }
+  while (stackMemorySize > this->UndoStackMemorySize && stack.size() > 1)
+    {
+    stackMemorySize -= stack.front()->MemorySize;
+    delete stack.front();
+    stack.pop_front();
+    }
 }
 
 //------------------------------------------------------------------------------
-// Put a replacement node into the undoable copy of the scene so that the node
+// Save a copy of the node state in the current undo level so that the node
 // can be edited
 void vtkMRMLScene::CopyNodeInUndoStack(vtkMRMLNode *copyNode)
 {
@@ -2504,28 +2644,27 @@ void vtkMRMLScene::CopyNodeInUndoStack(vtkMRMLNode *copyNode)
     vtkErrorMacro("CopyNodeInUndoStack: node is null");
     return;
     }
-
-  vtkMRMLNode *snode = copyNode->CreateNodeInstance();
-  if (snode != NULL)
+  if (this->UndoStack.empty() || !copyNode->GetID())
     {
-    snode->CopyWithScene(copyNode);
+    return;
     }
-  vtkCollection* undoScene = dynamic_cast < vtkCollection *>( this->UndoStack.back() );
-  int nnodes = undoScene->GetNumberOfItems();
-  for (int n=0; n<nnodes; n++)
+  UndoLevel::NodeStatesType& modifiedNodes = this->UndoStack.back()->ModifiedNodes;
+  if (modifiedNodes.find(copyNode->GetID()) != modifiedNodes.end())
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-    if (node == copyNode)
-      {
-      undoScene->ReplaceItem (n, snode);
-      break;
-      }
+    // the state of the node at the checkpoint is already saved
+    return;
     }
-  snode->Delete();
+  vtkSmartPointer<vtkMRMLNode> snode = vtkSmartPointer<vtkMRMLNode>::Take(copyNode->CreateNodeInstance());
+  if (snode == NULL)
+    {
+    return;
+    }
+  snode->CopyWithScene(copyNode);
+  modifiedNodes[copyNode->GetID()] = snode;
 }
 
 //------------------------------------------------------------------------------
-// Put a replacement node into the redoable copy of the scene so that the node
+// Save a copy of the node state in the current redo level so that the node
 // can be replaced by the Undo version
 void vtkMRMLScene::CopyNodeInRedoStack(vtkMRMLNode *copyNode)
 {
@@ -2534,260 +2673,207 @@ void vtkMRMLScene::CopyNodeInRedoStack(vtkMRMLNode *copyNode)
     vtkErrorMacro("CopyNodeInRedoStack: node is null");
     return;
     }
-  vtkMRMLNode *snode = copyNode->CreateNodeInstance();
-  if (snode != NULL)
+  if (this->RedoStack.empty() || !copyNode->GetID())
     {
-    snode->CopyWithSceneWithSingleModifiedEvent(copyNode);
+    return;
     }
-  vtkCollection* undoScene = dynamic_cast < vtkCollection *>( this->RedoStack.back() );
-  int nnodes = undoScene->GetNumberOfItems();
-  for (int n=0; n<nnodes; n++)
+  UndoLevel::NodeStatesType& modifiedNodes = this->RedoStack.back()->ModifiedNodes;
+  if (modifiedNodes.find(copyNode->GetID()) != modifiedNodes.end())
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-    if (node == copyNode)
-      {
-      undoScene->ReplaceItem (n, snode);
-      break;
-      }
+    return;
+    }
+  vtkSmartPointer<vtkMRMLNode> snode = vtkSmartPointer<vtkMRMLNode>::Take(copyNode->CreateNodeInstance());
+  if (snode == NULL)
+    {
+    return;
     }
-  snode->Delete();
+  snode->CopyWithSceneWithSingleModifiedEvent(copyNode);
+  modifiedNodes[copyNode->GetID()] = snode;
 }
 
 //------------------------------------------------------------------------------
-// Replace the current scene by the top of the undo stack
-// -- move the current scene on the redo stack
-void vtkMRMLScene::Undo()
+vtkMRMLScene::UndoLevel* vtkMRMLScene::GetRecordingUndoLevel()
 {
-  if (!this->UndoFlag)
+  if (this->IsClosing())
     {
-    return;
+    // undo and redo stacks are cleared when the scene is closed
+    return NULL;
     }
+  // Changes made by Undo() are recorded in the redo level, all other
+  // changes (including the ones made by Redo()) in the undo level.
+  std::list< UndoLevel* >& stack = (this->InUndo ? this->RedoStack : this->UndoStack);
+  return (stack.empty() ? NULL : stack.back());
+}
 
-  if (this->UndoStack.size() == 0)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RecordAddedNodeForUndo(vtkMRMLNode* node)
+{
+  UndoLevel* level = this->GetRecordingUndoLevel();
+  if (!level || !node || node->IsA("vtkMRMLSceneViewNode"))
     {
     return;
     }
-
-  this->RemoveUnusedNodeReferences();
-
-  this->InUndo = true;
-
-  int nnodes;
-  int n;
-  unsigned int nn;
-
-  PushIntoRedoStack();
-
-  vtkCollection* currentScene = this->Nodes;
-  // We use 2 vectors instead of a map in order to keep the ordering of the
-  // nodes.
-  std::vector<std::string> currentIDs;
-  std::vector<vtkMRMLNode*> currentNodes;
-  nnodes = currentScene->GetNumberOfItems();
-  for (n=0; n<nnodes; n++)
+  // If the node was removed since the checkpoint, it is simply not removed
+  // anymore.
+  std::map< vtkMRMLNode*, UndoLevel::RemovedNodesType::iterator >::iterator removedIt =
+    level->RemovedNodesIndex.find(node);
+  if (removedIt != level->RemovedNodesIndex.end())
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
-      {
-      currentIDs.push_back(node->GetID());
-      currentNodes.push_back(node);
-      }
+    level->RemovedNodes.erase(removedIt->second);
+    level->RemovedNodesIndex.erase(removedIt);
+    return;
     }
+  // A previous entry for the same address is a deleted node (null weak
+  // pointer) that is simply ignored.
+  level->AddedNodesIndex[node] = level->AddedNodes.insert(level->AddedNodes.end(), node);
+}
 
-  vtkCollection* undoScene = NULL;
-  std::vector<std::string> undoIDs;
-  std::vector<vtkMRMLNode*> undoNodes;
-
-  if (!this->UndoStack.empty())
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RecordRemovedNodeForUndo(vtkMRMLNode* node)
+{
+  UndoLevel* level = this->GetRecordingUndoLevel();
+  if (!level || !node || node->IsA("vtkMRMLSceneViewNode"))
     {
-    undoScene = dynamic_cast < vtkCollection *>( this->UndoStack.back() );
-    nnodes = undoScene->GetNumberOfItems();
-    for (n=0; n<nnodes; n++)
-      {
-      vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-      if (node && !node->IsA("vtkMRMLSceneViewNode"))
-        {
-        undoIDs.push_back(node->GetID());
-        undoNodes.push_back(node);
-        }
-      }
+    return;
     }
-
-  std::vector<std::string>::iterator iterID;
-  std::vector<vtkMRMLNode*>::iterator iterNode;
-  std::vector<std::string>::iterator curIterID;
-  std::vector<vtkMRMLNode*>::iterator curIterNode;
-
-  // copy back changes and add deleted nodes to the current scene
-  std::vector<vtkMRMLNode*> addNodes;
-
-  for(iterID=undoIDs.begin(), iterNode = undoNodes.begin(); iterID != undoIDs.end(); iterID++, iterNode++)
+  // If the node was added since the checkpoint, there is nothing to restore.
+  std::map< vtkMRMLNode*, UndoLevel::AddedNodesType::iterator >::iterator addedIt =
+    level->AddedNodesIndex.find(node);
+  if (addedIt != level->AddedNodesIndex.end())
     {
-    curIterID = std::find(currentIDs.begin(), currentIDs.end(), *iterID);
-    curIterNode = currentNodes.begin() + std::distance(currentIDs.begin(), curIterID);
-    if ( curIterID == currentIDs.end() )
+    bool addedSinceCheckpoint = (addedIt->second->GetPointer() == node);
+    level->AddedNodes.erase(addedIt->second);
+    level->AddedNodesIndex.erase(addedIt);
+    if (addedSinceCheckpoint)
       {
-      // the node was deleted, add Node back to the curreent scene
-      addNodes.push_back(*iterNode);
-      }
-    else if (*iterNode != *curIterNode)
-      {
-      // nodes differ, copy from undo to current scene
-      // but before create a copy in redo stack from current
-      this->CopyNodeInRedoStack(*curIterNode);
-      (*curIterNode)->CopyWithSceneWithSingleModifiedEvent(*iterNode);
+      return;
       }
     }
+  // Keep a reference to the node so that it can be added back.
+  if (level->RemovedNodesIndex.find(node) == level->RemovedNodesIndex.end())
+    {
+    level->RemovedNodesIndex[node] = level->RemovedNodes.insert(level->RemovedNodes.end(), node);
+    }
+}
 
-  // remove new nodes created before Undo
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RevertUndoLevel(UndoLevel* level, bool undo)
+{
+  // Remove nodes added since the checkpoint, they get recorded as removed
+  // in the target level.
   std::vector<vtkMRMLNode*> removeNodes;
-  for(curIterID=currentIDs.begin(), curIterNode = currentNodes.begin(); curIterID != currentIDs.end(); curIterID++, curIterNode++)
+  for (UndoLevel::AddedNodesType::reverse_iterator it = level->AddedNodes.rbegin();
+    it != level->AddedNodes.rend(); ++it)
     {
-    iterID = std::find(undoIDs.begin(),undoIDs.end(), *curIterID);
-    // Remove only if the node is not present in the previous state.
-    if ( iterID == undoIDs.end() )
+    vtkMRMLNode* node = it->GetPointer();
+    if (node && node->GetScene() == this && node->GetID() && this->GetNodeByID(node->GetID()) == node)
       {
-      removeNodes.push_back(*curIterNode);
+      removeNodes.push_back(node);
       }
     }
-
-  for (nn=0; nn<addNodes.size(); nn++)
+  for (std::vector<vtkMRMLNode*>::iterator it = removeNodes.begin(); it != removeNodes.end(); ++it)
     {
-    this->AddNode(addNodes[nn]);
-    }
-  for (nn=0; nn<removeNodes.size(); nn++)
-    {
-    vtkMRMLNode* nodeToRemove = removeNodes[nn];
     // Maybe the node has been removed already by a side effect of a previous
     // node removal.
-    if (this->IsNodePresent(nodeToRemove))
+    if ((*it)->GetScene() == this && this->GetNodeByID((*it)->GetID()) == *it)
       {
-      this->RemoveNode(nodeToRemove);
+      this->RemoveNode(*it);
       }
     }
 
-  if (undoScene)
+  // Add back nodes removed since the checkpoint
+  for (UndoLevel::RemovedNodesType::iterator it = level->RemovedNodes.begin();
+    it != level->RemovedNodes.end(); ++it)
     {
-    undoScene->RemoveAllItems();
-    undoScene->Delete();
+    vtkMRMLNode* node = it->GetPointer();
+    if (node->GetScene() != this || this->GetNodeByID(node->GetID()) != node)
+      {
+      this->AddNode(node);
+      }
     }
 
-  this->RemoveUnusedNodeReferences();
-
-  if (!this->UndoStack.empty())
-   {
-   UndoStack.pop_back();
-   }
-  this->Modified();
-
-  this->InUndo = false;
+  // Copy back the state of the nodes saved at the checkpoint,
+  // but before save the current state in the target level.
+  for (UndoLevel::NodeStatesType::iterator it = level->ModifiedNodes.begin();
+    it != level->ModifiedNodes.end(); ++it)
+    {
+    vtkMRMLNode* node = this->GetNodeByID(it->first);
+    if (!node)
+      {
+      continue;
+      }
+    if (undo)
+      {
+      this->CopyNodeInRedoStack(node);
+      }
+    else
+      {
+      this->CopyNodeInUndoStack(node);
+      }
+    node->CopyWithSceneWithSingleModifiedEvent(it->second);
+    }
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLScene::Redo()
+// Revert the changes recorded in the top of the undo stack
+// -- record the reverted changes on the redo stack
+void vtkMRMLScene::Undo()
 {
   if (!this->UndoFlag)
     {
     return;
     }
 
-  if (this->RedoStack.size() == 0)
+  if (this->UndoStack.size() == 0)
     {
     return;
     }
 
-  int nnodes;
-  int n;
-  unsigned int nn;
-
   this->RemoveUnusedNodeReferences();
 
-  PushIntoUndoStack();
-
-  vtkCollection* currentScene = this->Nodes;
-  //std::hash_map<std::string, vtkMRMLNode*> currentMap;
-  std::map<std::string, vtkMRMLNode*> currentMap;
-  nnodes = currentScene->GetNumberOfItems();
-  for (n=0; n<nnodes; n++)
-    {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
-      {
-      currentMap[node->GetID()] = node;
-      }
-    }
+  this->InUndo = true;
 
-  //std::hash_map<std::string, vtkMRMLNode*> undoMap;
-  std::map<std::string, vtkMRMLNode*> undoMap;
+  PushIntoRedoStack();
 
-  vtkCollection* undoScene = NULL;
+  UndoLevel* undoLevel = this->UndoStack.back();
+  this->RevertUndoLevel(undoLevel, true);
 
-  if (!this->RedoStack.empty())
-    {
-    undoScene = dynamic_cast < vtkCollection *>( this->RedoStack.back() );;
-    nnodes = undoScene->GetNumberOfItems();
-    for (n=0; n<nnodes; n++)
-      {
-      vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-      if (node && !node->IsA("vtkMRMLSceneViewNode"))
-        {
-        undoMap[node->GetID()] = node;
-        }
-      }
-    }
+  this->RemoveUnusedNodeReferences();
 
-  //std::hash_map<std::string, vtkMRMLNode*>::iterator iter;
-  //std::hash_map<std::string, vtkMRMLNode*>::iterator curIter;
-  std::map<std::string, vtkMRMLNode*>::iterator iter;
-  std::map<std::string, vtkMRMLNode*>::iterator curIter;
+  this->UndoStack.pop_back();
+  delete undoLevel;
+  this->Modified();
 
-  // copy back changes and add deleted nodes to the current scene
-  std::vector<vtkMRMLNode*> addNodes;
+  this->InUndo = false;
+}
 
-  for(iter=undoMap.begin(); iter != undoMap.end(); iter++)
+//------------------------------------------------------------------------------
+// Revert the changes recorded in the top of the redo stack
+// -- record the reverted changes on the undo stack
+void vtkMRMLScene::Redo()
+{
+  if (!this->UndoFlag)
     {
-    curIter = currentMap.find(iter->first);
-    if ( curIter == currentMap.end() )
-      {
-      // the node was deleted, add Node back to the curreent scene
-      addNodes.push_back(iter->second);
-      }
-    else if (iter->second != curIter->second)
-      {
-      // nodes differ, copy from redo to current scene
-      // but before create a copy in undo stack from current
-      this->CopyNodeInUndoStack(curIter->second);
-      curIter->second->CopyWithSceneWithSingleModifiedEvent(iter->second);
-      }
+    return;
     }
 
-  // remove new nodes created before Undo
-  std::vector<vtkMRMLNode*> removeNodes;
-  for(curIter=currentMap.begin(); curIter != currentMap.end(); curIter++)
+  if (this->RedoStack.size() == 0)
     {
-    iter = undoMap.find(curIter->first);
-    if ( iter == undoMap.end() )
-      {
-      removeNodes.push_back(curIter->second);
-      }
+    return;
     }
 
-  for (nn=0; nn<addNodes.size(); nn++)
-    {
-    this->AddNode(addNodes[nn]);
-    }
-  for (nn=0; nn<removeNodes.size(); nn++)
-    {
-    this->RemoveNode(removeNodes[nn]);
-    }
+  this->RemoveUnusedNodeReferences();
 
-  if (undoScene)
-    {
-    undoScene->RemoveAllItems();
-    undoScene->Delete();
-    }
+  // Pop the redo level first so that the new undo level doesn't get
+  // recorded into it.
+  UndoLevel* redoLevel = this->RedoStack.back();
+  this->RedoStack.pop_back();
+
+  PushIntoUndoStack();
+
+  this->RevertUndoLevel(redoLevel, false);
 
-  RedoStack.pop_back();
+  delete redoLevel;
 
   this->Modified();
 }
@@ -2795,11 +2881,10 @@ void vtkMRMLScene::Redo()
 //------------------------------------------------------------------------------
 void vtkMRMLScene::ClearUndoStack()
 {
-  std::list< vtkCollection* >::iterator iter;
+  std::list< UndoLevel* >::iterator iter;
   for(iter=this->UndoStack.begin(); iter != this->UndoStack.end(); iter++)
     {
-    (*iter)->RemoveAllItems();
-    (*iter)->Delete();
+    delete *iter;
     }
   this->UndoStack.clear();
 }
@@ -2807,11 +2892,10 @@ void vtkMRMLScene::ClearUndoStack()
 //------------------------------------------------------------------------------
 void vtkMRMLScene::ClearRedoStack()
 {
-  std::list< vtkCollection* >::iterator iter;
+  std::list< UndoLevel* >::iterator iter;
   for(iter=this->RedoStack.begin(); iter != this->RedoStack.end(); iter++)
     {
-    (*iter)->RemoveAllItems();
-    (*iter)->Delete();
+    delete *iter;
     }
   this->RedoStack.clear();
 }
@@ -3138,6 +3222,221 @@ void vtkMRMLScene::ClearNodeIDs()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::UpdateNodeIndex()
+{
+  if (this->NodeIndexValid)
+    {
+    // index is up-to-date
+    return;
+    }
+#ifdef MRMLSCENE_VERBOSE
+  std::cerr << "Recompute node class and name index..." << std::endl;
+#endif
+  // Indexed classes are preserved, only their content is recomputed
+  this->ClearNodeIndex();
+  vtkMRMLNode *node;
+  vtkCollectionSimpleIterator it;
+  for (this->Nodes->InitTraversal(it);
+       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+    {
+    this->InsertNodeInIndex(node);
+    }
+  this->NodeIndexValid = true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkMRMLScene::InsertNodeInIndex(vtkMRMLNode *node)
+{
+  if (this->IndexedNodes.find(node) != this->IndexedNodes.end())
+    {
+    // duplicate entry in the Nodes collection
+    return false;
+    }
+  IndexedNodeInfo& info = this->IndexedNodes[node];
+  info.Position = this->NextNodeIndexPosition++;
+  info.HasName = (node->GetName() != NULL);
+  if (info.HasName)
+    {
+    info.Name = node->GetName();
+    this->NodesByName[info.Name][info.Position] = node;
+    }
+  this->IndexedNodesByPosition[info.Position] = node;
+  const std::vector<std::string>& classNames = this->GetIndexedClassesOfNode(node);
+  for (std::vector<std::string>::const_iterator classIt = classNames.begin();
+    classIt != classNames.end(); ++classIt)
+    {
+    this->NodesByClass[*classIt][info.Position] = node;
+    }
+  this->NthNodeByClassCursors.clear();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::AppendNodeToCollection(vtkMRMLNode *node)
+{
+  this->IndexedNodesModification = true;
+  this->Nodes->vtkCollection::AddItem((vtkObject *)node);
+  this->IndexedNodesModification = false;
+  this->AddNodeToIndex(node);
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::RemoveNodeFromCollection(vtkMRMLNode *node)
+{
+  this->IndexedNodesModification = true;
+  this->Nodes->vtkCollection::RemoveItem((vtkObject *)node);
+  this->IndexedNodesModification = false;
+  this->RemoveNodeFromIndex(node);
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::AddNodeToIndex(vtkMRMLNode *node)
+{
+  if (!node || !this->NodeIndexValid)
+    {
+    // index is invalid, it will be rebuilt on next query
+    return;
+    }
+  if (!this->InsertNodeInIndex(node))
+    {
+    // the collection contains duplicates
+    this->ClearNodeIndex();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::RemoveNodeFromIndex(vtkMRMLNode *node)
+{
+  if (!node || !this->NodeIndexValid)
+    {
+    return;
+    }
+  std::map< vtkMRMLNode*, IndexedNodeInfo >::iterator nodeIt = this->IndexedNodes.find(node);
+  if (nodeIt == this->IndexedNodes.end())
+    {
+    this->ClearNodeIndex();
+    return;
+    }
+  const IndexedNodeInfo& info = nodeIt->second;
+  if (info.HasName)
+    {
+    std::map< std::string, NodeIndexType >::iterator nameIt = this->NodesByName.find(info.Name);
+    if (nameIt != this->NodesByName.end())
+      {
+      nameIt->second.erase(info.Position);
+      if (nameIt->second.empty())
+        {
+        this->NodesByName.erase(nameIt);
+        }
+      }
+    }
+  this->IndexedNodesByPosition.erase(info.Position);
+  const std::vector<std::string>& classNames = this->GetIndexedClassesOfNode(node);
+  for (std::vector<std::string>::const_iterator classIt = classNames.begin();
+    classIt != classNames.end(); ++classIt)
+    {
+    this->NodesByClass[*classIt].erase(info.Position);
+    }
+  this->NthNodeByClassCursors.clear();
+  this->IndexedNodes.erase(nodeIt);
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::ClearNodeIndex()
+{
+  this->IndexedNodes.clear();
+  this->IndexedNodesByPosition.clear();
+  this->NodesByName.clear();
+  for (std::map< std::string, NodeIndexType >::iterator classIt = this->NodesByClass.begin();
+    classIt != this->NodesByClass.end(); ++classIt)
+    {
+    classIt->second.clear();
+    }
+  this->NthNodeByClassCursors.clear();
+  this->NextNodeIndexPosition = 0;
+  this->NodeIndexValid = false;
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::UpdateNodeNameIndex(vtkMRMLNode* node)
+{
+  if (!node || !this->NodeIndexValid)
+    {
+    return;
+    }
+  std::map< vtkMRMLNode*, IndexedNodeInfo >::iterator nodeIt = this->IndexedNodes.find(node);
+  if (nodeIt == this->IndexedNodes.end())
+    {
+    // node is not in the scene (yet)
+    return;
+    }
+  IndexedNodeInfo& info = nodeIt->second;
+  if (info.HasName)
+    {
+    std::map< std::string, NodeIndexType >::iterator nameIt = this->NodesByName.find(info.Name);
+    if (nameIt != this->NodesByName.end())
+      {
+      nameIt->second.erase(info.Position);
+      if (nameIt->second.empty())
+        {
+        this->NodesByName.erase(nameIt);
+        }
+      }
+    }
+  info.HasName = (node->GetName() != NULL);
+  info.Name = (info.HasName ? node->GetName() : "");
+  if (info.HasName)
+    {
+    this->NodesByName[info.Name][info.Position] = node;
+    }
+}
+
+//-----------------------------------------------------------------------------
+const vtkMRMLScene::NodeIndexType& vtkMRMLScene::GetNodeClassIndex(const char* className)
+{
+  this->UpdateNodeIndex();
+  std::map< std::string, NodeIndexType >::iterator classIt = this->NodesByClass.find(className);
+  if (classIt != this->NodesByClass.end())
+    {
+    return classIt->second;
+    }
+  // First time this class is queried, index it.
+  NodeIndexType& classNodes = this->NodesByClass[className];
+  for (NodeIndexType::iterator it = this->IndexedNodesByPosition.begin();
+    it != this->IndexedNodesByPosition.end(); ++it)
+    {
+    if (it->second->IsA(className))
+      {
+      classNodes[it->first] = it->second;
+      }
+    }
+  // Cached class hierarchies don't know about the new indexed class.
+  this->IndexedClassesByNodeClass.clear();
+  return classNodes;
+}
+
+//-----------------------------------------------------------------------------
+const std::vector<std::string>& vtkMRMLScene::GetIndexedClassesOfNode(vtkMRMLNode* node)
+{
+  std::map< std::string, std::vector<std::string> >::iterator nodeClassIt =
+    this->IndexedClassesByNodeClass.find(node->GetClassName());
+  if (nodeClassIt != this->IndexedClassesByNodeClass.end())
+    {
+    return nodeClassIt->second;
+    }
+  std::vector<std::string>& classNames = this->IndexedClassesByNodeClass[node->GetClassName()];
+  for (std::map< std::string, NodeIndexType >::iterator classIt = this->NodesByClass.begin();
+    classIt != this->NodesByClass.end(); ++classIt)
+    {
+    if (node->IsA(classIt->first.c_str()))
+      {
+      classNames.push_back(classIt->first);
+      }
+    }
+  return classNames;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::AddURIHandler(vtkURIHandler *handler)
 {
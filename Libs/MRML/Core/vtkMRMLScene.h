@@ -25,6 +25,7 @@ Version:   $Revision: 1.18 $
 // VTK includes
 #include <vtkObject.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 // STD includes
 #include <list>
@@ -146,6 +147,17 @@ public:
   /// \sa RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
   void RegisterNodeClass(vtkMRMLNode* node);
 
+  /// \brief Create node registered with the XML tag \a tagName.
+  ///
+  /// Equivalent to CreateNodeByClass(GetClassNameByTag(tagName)) but the
+  /// registered node is looked up only once, by tag, and not again by class
+  /// name. Like CreateNodeByClass(), the default node of the class is used
+  /// to initialize the new node.
+  /// Returns NULL if no node class is registered for the tag.
+  /// \warning This method does NOT add the new node to the scene.
+  /// \sa RegisterNodeClass(), CreateNodeByClass()
+  vtkMRMLNode* CreateNodeByTag(const char* tagName);
+
   /// Add a path to the list.
   const char* GetClassNameByTag(const char *tagName);
 
@@ -330,6 +342,26 @@ public:
   /// insert a node in the scene before a specified node
   vtkMRMLNode* InsertBeforeNode( vtkMRMLNode *item, vtkMRMLNode *newItem);
 
+  /// \brief Maximum number of undo (and redo) levels.
+  ///
+  /// When a new checkpoint is saved, the oldest levels are discarded.
+  /// A value of 0 or less means no limit. Default is 100.
+  vtkSetMacro(UndoStackSize, int);
+  vtkGetMacro(UndoStackSize, int);
+
+  /// \brief Maximum memory, in bytes, of the data kept alive by the undo
+  /// (and redo) levels.
+  ///
+  /// The bulk data (image data, meshes and segment representations) of the
+  /// volume, model and segmentation nodes saved in or removed since a level
+  /// is counted, except data still used by nodes of the scene and data
+  /// shared with a newer level. The limit is enforced when a new level is
+  /// started, by discarding the oldest levels; the level being recorded is
+  /// never discarded. Other nodes are small and only limited by
+  /// UndoStackSize. A value of 0 or less means no limit. Default is 1GB.
+  vtkSetMacro(UndoStackMemorySize, vtkIdType);
+  vtkGetMacro(UndoStackMemorySize, vtkIdType);
+
   /// Set undo on/off
   void SetUndoOn() {UndoFlag=true;};
   void SetUndoOff() {UndoFlag=false;};
@@ -418,6 +450,12 @@ public:
   /// or NULL if id has not changed
   const char* GetChangedID(const char* id);
 
+  /// \brief Update the name index after the name of \a node has changed.
+  ///
+  /// Called by vtkMRMLNode::SetName(), there is no need to call it directly.
+  /// \sa GetNodesByName(), GetFirstNodeByName()
+  void UpdateNodeNameIndex(vtkMRMLNode* node);
+
   /// \brief Return collection of all nodes referenced directly or indirectly by
   /// \a node.
   ///
@@ -704,12 +742,63 @@ protected:
   vtkMRMLScene();
   virtual ~vtkMRMLScene();
 
+  /// \brief Changes of the scene recorded between two undo checkpoints.
+  ///
+  /// Only the nodes that have been added, removed or saved for undo since the
+  /// checkpoint are stored, so the cost of a level is proportional to the
+  /// number of changed nodes instead of the number of nodes in the scene.
+  struct UndoLevel
+    {
+    typedef std::map< std::string, vtkSmartPointer<vtkMRMLNode> > NodeStatesType;
+    typedef std::list< vtkWeakPointer<vtkMRMLNode> > AddedNodesType;
+    typedef std::list< vtkSmartPointer<vtkMRMLNode> > RemovedNodesType;
+    UndoLevel() : MemorySize(0) {}
+    /// Copies of the nodes saved with SaveStateForUndo(), by node ID.
+    NodeStatesType ModifiedNodes;
+    /// Nodes added to the scene since the checkpoint, in the order they
+    /// were added, and their position in the list.
+    AddedNodesType AddedNodes;
+    std::map< vtkMRMLNode*, AddedNodesType::iterator > AddedNodesIndex;
+    /// Nodes removed from the scene since the checkpoint, in the order they
+    /// were removed, and their position in the list.
+    RemovedNodesType RemovedNodes;
+    std::map< vtkMRMLNode*, RemovedNodesType::iterator > RemovedNodesIndex;
+    /// Bytes of data kept alive only by the level, computed by
+    /// UpdateUndoLevelMemorySize() when the next level is started.
+    vtkIdType MemorySize;
+    };
+
+  /// Start a new undo level. The oldest levels are discarded to keep at
+  /// most UndoStackSize levels.
   void PushIntoUndoStack();
+  /// Start a new redo level.
   void PushIntoRedoStack();
-
+  /// Discard the oldest levels of \a stack if it has more than
+  /// UndoStackSize levels or if they hold more than UndoStackMemorySize
+  /// bytes of data.
+  void TrimUndoLevels(std::list< UndoLevel* >& stack);
+  /// Compute the memory size of a level that does not record changes
+  /// anymore: the data of its nodes that is not used by the scene.
+  void UpdateUndoLevelMemorySize(UndoLevel* level);
+
+  /// Save the state of the node in the current undo level if not already saved.
   void CopyNodeInUndoStack(vtkMRMLNode *node);
+  /// Save the state of the node in the current redo level if not already saved.
   void CopyNodeInRedoStack(vtkMRMLNode *node);
 
+  /// Return the level where node additions and removals are recorded:
+  /// the current redo level during Undo(), the current undo level otherwise.
+  /// Return NULL if there is no such level.
+  UndoLevel* GetRecordingUndoLevel();
+  /// Record in the current level that the node has been added to the scene.
+  void RecordAddedNodeForUndo(vtkMRMLNode* node);
+  /// Record in the current level that the node has been removed from the scene.
+  void RecordRemovedNodeForUndo(vtkMRMLNode* node);
+  /// Revert the changes recorded in \a level. The reverted changes are
+  /// recorded in the current redo level if \a undo is true, in the current
+  /// undo level otherwise.
+  void RevertUndoLevel(UndoLevel* level, bool undo);
+
   /// Add a node to the scene without invoking a vtkMRMLScene::NodeAddedEvent event.
   ///
   /// \warning Use with extreme caution as it might unsynchronize observer.
@@ -721,6 +810,12 @@ protected:
   static void SceneCallback( vtkObject *caller, unsigned long eid,
                              void *clientData, void *callData );
 
+  /// Handle the ModifiedEvent of the \a Nodes collection: invalidate the
+  /// class and name indexes if the collection was not modified by
+  /// AppendNodeToCollection() or RemoveNodeFromCollection().
+  static void NodesCallback( vtkObject *caller, unsigned long eid,
+                             void *clientData, void *callData );
+
   std::string GenerateUniqueID(vtkMRMLNode* node);
   std::string GenerateUniqueID(const std::string& baseID);
   int GetUniqueIDIndex(const std::string& baseID);
@@ -752,9 +847,69 @@ protected:
   /// Clear NodeIDs map used to speedup GetByID() method.
   void ClearNodeIDs();
 
+  /// Recompute RegisteredNodesByClass and RegisteredNodesByTag from
+  /// RegisteredNodeClasses and RegisteredNodeTags.
+  void UpdateRegisteredNodeClassMaps();
+  /// Return the registered node instance of class \a className, NULL if none.
+  vtkMRMLNode* GetRegisteredNodeByClass(const char* className);
+  /// Return the registered node instance for XML tag \a tagName, NULL if none.
+  vtkMRMLNode* GetRegisteredNodeByTag(const char* tagName);
+
   /// Get a NodeReferences iterator for a node reference.
   NodeReferencesType::iterator FindNodeReference(const char* referencedId, vtkMRMLNode* referencingNode);
 
+  /// Nodes of the scene sorted by their position in the \a Nodes collection.
+  typedef std::map< vtkIdType, vtkMRMLNode* > NodeIndexType;
+
+  /// Position and name of a node stored in the class and name indexes.
+  struct IndexedNodeInfo
+    {
+    vtkIdType Position;
+    bool HasName;
+    std::string Name;
+    };
+
+  /// \brief Synchronize the class and name indexes used to speedup
+  /// GetNodesByClass(), GetNodesByName() and related methods with the
+  /// \a Nodes collection.
+  ///
+  /// The indexes are rebuilt from scratch only if they have been invalidated,
+  /// which happens when the \a Nodes collection is modified by other means
+  /// than AppendNodeToCollection() and RemoveNodeFromCollection().
+  void UpdateNodeIndex();
+
+  /// Append node to the \a Nodes collection and to the class and name indexes.
+  void AppendNodeToCollection(vtkMRMLNode *node);
+
+  /// Remove node from the \a Nodes collection and from the class and name
+  /// indexes.
+  void RemoveNodeFromCollection(vtkMRMLNode *node);
+
+  /// Add node to the class and name indexes. The node must have been appended
+  /// to the \a Nodes collection.
+  void AddNodeToIndex(vtkMRMLNode *node);
+
+  /// Insert node in the class and name indexes without checking that they
+  /// are in sync with the \a Nodes collection.
+  /// Returns false if the node is already indexed.
+  bool InsertNodeInIndex(vtkMRMLNode *node);
+
+  /// Remove node from the class and name indexes.
+  void RemoveNodeFromIndex(vtkMRMLNode *node);
+
+  /// Invalidate the class and name indexes, they are rebuilt on next query.
+  void ClearNodeIndex();
+
+  /// \brief Return the index of all nodes that are of class \a className or
+  /// of a class derived from \a className.
+  ///
+  /// The index of a class is built the first time it is requested and then
+  /// kept up-to-date by AddNodeToIndex() and RemoveNodeFromIndex().
+  const NodeIndexType& GetNodeClassIndex(const char* className);
+
+  /// Return the list of indexed classes \a node is a type of.
+  const std::vector<std::string>& GetIndexedClassesOfNode(vtkMRMLNode* node);
+
   vtkCollection*  Nodes;
   vtkMTimeType    SceneModifiedTime;
 
@@ -767,11 +922,12 @@ protected:
   std::vector<unsigned long> States;
 
   int  UndoStackSize;
+  vtkIdType UndoStackMemorySize;
   bool UndoFlag;
   bool InUndo;
 
-  std::list< vtkCollection* >  UndoStack;
-  std::list< vtkCollection* >  RedoStack;
+  std::list< UndoLevel* >  UndoStack;
+  std::list< UndoLevel* >  RedoStack;
 
   std::string                 URL;
   std::string                 RootDirectory;
@@ -782,11 +938,35 @@ protected:
 
   std::vector< vtkMRMLNode* > RegisteredNodeClasses;
   std::vector< std::string >  RegisteredNodeTags;
+  // Lookup maps of registered nodes (elements of RegisteredNodeClasses) used
+  // to speedup node creation by class name or XML tag.
+  std::map< std::string, vtkMRMLNode* > RegisteredNodesByClass;
+  std::map< std::string, vtkMRMLNode* > RegisteredNodesByTag;
 
   NodeReferencesType NodeReferences; // ReferencedIDs (string), ReferencingNodes (node pointer)
   std::map< std::string, std::string > ReferencedIDChanges;
   std::map< std::string, vtkSmartPointer<vtkMRMLNode> > NodeIDs;
 
+  // Class and name indexes of the Nodes collection. They allow retrieving
+  // nodes by class or name in a time proportional to the number of returned
+  // nodes instead of the number of nodes in the scene.
+  std::map< vtkMRMLNode*, IndexedNodeInfo > IndexedNodes;
+  NodeIndexType IndexedNodesByPosition;
+  std::map< std::string, NodeIndexType > NodesByClass; // queried class name, nodes
+  std::map< std::string, NodeIndexType > NodesByName;
+  // Indexed class names (keys of NodesByClass) that a node class is a type of.
+  std::map< std::string, std::vector<std::string> > IndexedClassesByNodeClass;
+  // Position and iterator of the last node returned by GetNthNodeByClass()
+  // for each class, so that iterating over the nodes of a class is linear.
+  // Cleared whenever the class indexes are modified.
+  std::map< std::string, std::pair< int, NodeIndexType::const_iterator > > NthNodeByClassCursors;
+  vtkIdType NextNodeIndexPosition;
+  // False if the indexes must be rebuilt on next query.
+  bool NodeIndexValid;
+  // True while the Nodes collection is modified by AppendNodeToCollection()
+  // or RemoveNodeFromCollection(), which keep the indexes up-to-date.
+  bool IndexedNodesModification;
+
   // Stores default nodes. If a class is created or reset (using CreateNodeByClass or Clear) and
   // a default node is defined for it then the content of the default node will be used to initialize
   // the class. It is useful for overriding default values that are set in a node's constructor.
@@ -810,6 +990,7 @@ protected:
   char * LastLoadedVersion;
 
   vtkCallbackCommand *DeleteEventCallback;
+  vtkCallbackCommand *NodesModifiedCallback;
 
 private:
 
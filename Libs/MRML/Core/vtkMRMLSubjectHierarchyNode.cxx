@@ -107,6 +107,16 @@ public:
   /// It can be static as the item IDs are unique in one application session.
   static std::map<vtkIdType, vtkSubjectHierarchyItem*> ItemCache;
 
+  /// Indexes of the items of the tree by data node and by UID (name and value), to speed up the lookups
+  /// that are performed by every plugin and node event. They are only maintained in the root item of the tree
+  /// (the scene item), for the items that have been added to the tree, and are kept up-to-date in
+  /// \sa AddToTree, \sa SetUID and \sa RemoveChild. Multiple entries are allowed for the same key (for example
+  /// if the same series is loaded twice), in that case the lookup falls back to traversing the tree.
+  typedef std::multimap<vtkMRMLNode*, vtkSubjectHierarchyItem*> DataNodeIndexType;
+  typedef std::multimap<std::pair<std::string, std::string>, vtkSubjectHierarchyItem*> UIDIndexType;
+  DataNodeIndexType DataNodeIndex;
+  UIDIndexType UIDIndex;
+
 // Get/set functions
 public:
   /// Add data item to tree under parent, specifying basic properties
@@ -172,6 +182,14 @@ public:
   /// \param recursive Flag whether to find only direct children (false) or in the whole branch (true). True by default
   /// \return Item if found, NULL otherwise
   vtkSubjectHierarchyItem* FindChildByUIDList(std::string uidName, std::string uidValue, bool recursive=true);
+  /// Find item in the tree by associated data MRML node using the index of the root item.
+  /// Returns the same item as \sa FindChildByDataNode called recursively on the root item
+  /// \return Item if found, NULL otherwise
+  vtkSubjectHierarchyItem* FindIndexedItemByDataNode(vtkMRMLNode* dataNode);
+  /// Find item in the tree by UID (exact match) using the index of the root item.
+  /// Returns the same item as \sa FindChildByUID called recursively on the root item
+  /// \return Item if found, NULL otherwise
+  vtkSubjectHierarchyItem* FindIndexedItemByUID(std::string uidName, std::string uidValue);
   /// Find children by name
   /// \param name Name (or part of a name) to find
   /// \param foundItemIDs List of found item IDs. Needs to be empty when passing as argument!
@@ -229,12 +247,27 @@ public:
   /// Get ancestor subject hierarchy item at a certain level
   /// \param level Level of the ancestor node we start searching.
   vtkSubjectHierarchyItem* GetAncestorAtLevel(std::string level);
+  /// Get the root item of the tree containing this item (the scene item for the items in the tree)
+  vtkSubjectHierarchyItem* GetRootItem();
 
 public:
   vtkSubjectHierarchyItem();
   ~vtkSubjectHierarchyItem();
 
 private:
+  /// Add the data node and the UIDs of the item to the indexes of the root item
+  void AddToIndex();
+  /// Remove the data node and the UIDs of the item from the indexes of the root item
+  void RemoveFromIndex();
+  /// Remove the entry of the item with the given UID from the index of the root item
+  void RemoveUIDFromIndex(const std::string& uidName, const std::string& uidValue);
+
+  /// Flag indicating whether the item is in the indexes of the root item
+  bool Indexed;
+  /// Key of the item in the data node index of the root item. Kept as a raw pointer so that
+  /// the entry can be removed even if the data node has been deleted since
+  vtkMRMLNode* IndexedDataNode;
+
   /// Incremental ID used to uniquely identify subject hierarchy items
   static vtkIdType NextSubjectHierarchyItemID;
 
@@ -263,6 +296,8 @@ vtkSubjectHierarchyItem::vtkSubjectHierarchyItem()
   , TemporaryID(vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
   , TemporaryDataNodeID("")
   , TemporaryParentItemID(vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  , Indexed(false)
+  , IndexedDataNode(NULL)
 {
   this->Children.clear();
   this->Attributes.clear();
@@ -301,8 +336,9 @@ vtkIdType vtkSubjectHierarchyItem::AddToTree(vtkSubjectHierarchyItem* parent, vt
     vtkSmartPointer<vtkSubjectHierarchyItem> childPointer(this);
     this->Parent->Children.push_back(childPointer);
 
-    // Add to cache
+    // Add to cache and indexes
     vtkSubjectHierarchyItem::ItemCache[this->ID] = this;
+    this->AddToIndex();
     }
   else
     {
@@ -338,8 +374,9 @@ vtkIdType vtkSubjectHierarchyItem::AddToTree(vtkSubjectHierarchyItem* parent, st
     vtkSmartPointer<vtkSubjectHierarchyItem> childPointer(this);
     this->Parent->Children.push_back(childPointer);
 
-    // Add to cache
+    // Add to cache and indexes
     vtkSubjectHierarchyItem::ItemCache[this->ID] = this;
+    this->AddToIndex();
     }
   else if (! ( (!name.compare("Scene") && !level.compare("Scene"))
             || (!name.compare("UnresolvedItems") && !level.compare("UnresolvedItems")) ) )
@@ -821,6 +858,57 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindChildByUIDList(std::string
   return NULL;
 }
 
+//---------------------------------------------------------------------------
+vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindIndexedItemByDataNode(vtkMRMLNode* dataNode)
+{
+  if (!dataNode)
+    {
+    return NULL;
+    }
+
+  vtkSubjectHierarchyItem* rootItem = this->GetRootItem();
+  std::pair<DataNodeIndexType::iterator, DataNodeIndexType::iterator> range =
+    rootItem->DataNodeIndex.equal_range(dataNode);
+  if (range.first == range.second)
+    {
+    return NULL;
+    }
+  DataNodeIndexType::iterator nextIt = range.first;
+  if (++nextIt != range.second)
+    {
+    // Multiple items for the same data node, return the first one in the tree
+    return rootItem->FindChildByDataNode(dataNode);
+    }
+
+  // The pointer may belong to a new node allocated at the address of a deleted data node
+  vtkSubjectHierarchyItem* item = range.first->second;
+  return (item->DataNode.GetPointer() == dataNode ? item : NULL);
+}
+
+//---------------------------------------------------------------------------
+vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindIndexedItemByUID(std::string uidName, std::string uidValue)
+{
+  if (uidName.empty() || uidValue.empty())
+    {
+    return NULL;
+    }
+
+  vtkSubjectHierarchyItem* rootItem = this->GetRootItem();
+  std::pair<UIDIndexType::iterator, UIDIndexType::iterator> range =
+    rootItem->UIDIndex.equal_range(std::make_pair(uidName, uidValue));
+  if (range.first == range.second)
+    {
+    return NULL;
+    }
+  UIDIndexType::iterator nextIt = range.first;
+  if (++nextIt != range.second)
+    {
+    // Multiple items with the same UID, return the first one in the tree
+    return rootItem->FindChildByUID(uidName, uidValue);
+    }
+  return range.first->second;
+}
+
 //---------------------------------------------------------------------------
 void vtkSubjectHierarchyItem::FindChildrenByName(std::string name, std::vector<vtkIdType> &foundItemIDs, bool contains/*=false*/, bool recursive/*=true*/)
 {
@@ -1115,8 +1203,9 @@ bool vtkSubjectHierarchyItem::RemoveChild(vtkSubjectHierarchyItem* item)
   // Reparent children to parent node (to avoid them becoming orphans and thus lost to the hierarchy)
   removedItem->ReparentChildrenToParent();
 
-  // Remove from cache
+  // Remove from cache and indexes
   vtkSubjectHierarchyItem::ItemCache.erase(removedItem->ID);
+  removedItem->RemoveFromIndex();
 
   // Invoke events
   this->InvokeEvent(vtkMRMLSubjectHierarchyNode::SubjectHierarchyItemRemovedEvent, item);
@@ -1159,8 +1248,9 @@ bool vtkSubjectHierarchyItem::RemoveChild(vtkIdType itemID)
   // Reparent children to parent node (to avoid them becoming orphans and thus lost to the hierarchy)
   removedItem->ReparentChildrenToParent();
 
-  // Remove from cache
+  // Remove from cache and indexes
   vtkSubjectHierarchyItem::ItemCache.erase(removedItem->ID);
+  removedItem->RemoveFromIndex();
 
   // Invoke events
   this->InvokeEvent(vtkMRMLSubjectHierarchyNode::SubjectHierarchyItemRemovedEvent, removedItem.GetPointer());
@@ -1264,7 +1354,16 @@ void vtkSubjectHierarchyItem::SetUID(std::string uidName, std::string uidValue)
       return; // Do nothing if the UID values match
       }
     }
+  // Update the index if the item is in the tree
+  if (this->Indexed && this->UIDs.find(uidName) != this->UIDs.end())
+    {
+    this->RemoveUIDFromIndex(uidName, this->UIDs[uidName]);
+    }
   this->UIDs[uidName] = uidValue;
+  if (this->Indexed)
+    {
+    this->GetRootItem()->UIDIndex.insert(std::make_pair(std::make_pair(uidName, uidValue), this));
+    }
   this->InvokeEvent(vtkMRMLSubjectHierarchyNode::SubjectHierarchyItemUIDAddedEvent, this);
   this->Modified();
 }
@@ -1409,6 +1508,88 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::GetAncestorAtLevel(std::string
   return NULL;
 }
 
+//---------------------------------------------------------------------------
+vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::GetRootItem()
+{
+  vtkSubjectHierarchyItem* rootItem = this;
+  while (rootItem->Parent)
+    {
+    rootItem = rootItem->Parent;
+    }
+  return rootItem;
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::AddToIndex()
+{
+  vtkSubjectHierarchyItem* rootItem = this->GetRootItem();
+  if (rootItem == this)
+    {
+    // Root items are not indexed
+    return;
+    }
+  this->Indexed = true;
+
+  this->IndexedDataNode = this->DataNode.GetPointer();
+  if (this->IndexedDataNode)
+    {
+    rootItem->DataNodeIndex.insert(std::make_pair(this->IndexedDataNode, this));
+    }
+  std::map<std::string, std::string>::iterator uidIt;
+  for (uidIt=this->UIDs.begin(); uidIt!=this->UIDs.end(); ++uidIt)
+    {
+    rootItem->UIDIndex.insert(std::make_pair(*uidIt, this));
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::RemoveFromIndex()
+{
+  if (!this->Indexed)
+    {
+    return;
+    }
+  this->Indexed = false;
+
+  vtkSubjectHierarchyItem* rootItem = this->GetRootItem();
+  if (this->IndexedDataNode)
+    {
+    std::pair<DataNodeIndexType::iterator, DataNodeIndexType::iterator> range =
+      rootItem->DataNodeIndex.equal_range(this->IndexedDataNode);
+    for (DataNodeIndexType::iterator dataNodeIt=range.first; dataNodeIt!=range.second; ++dataNodeIt)
+      {
+      if (dataNodeIt->second == this)
+        {
+        rootItem->DataNodeIndex.erase(dataNodeIt);
+        break;
+        }
+      }
+    this->IndexedDataNode = NULL;
+    }
+
+  std::map<std::string, std::string>::iterator uidIt;
+  for (uidIt=this->UIDs.begin(); uidIt!=this->UIDs.end(); ++uidIt)
+    {
+    this->RemoveUIDFromIndex(uidIt->first, uidIt->second);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::RemoveUIDFromIndex(const std::string& uidName, const std::string& uidValue)
+{
+  vtkSubjectHierarchyItem* rootItem = this->GetRootItem();
+  std::pair<UIDIndexType::iterator, UIDIndexType::iterator> range =
+    rootItem->UIDIndex.equal_range(std::make_pair(uidName, uidValue));
+  for (UIDIndexType::iterator uidIt=range.first; uidIt!=range.second; ++uidIt)
+    {
+    if (uidIt->second == this)
+      {
+      rootItem->UIDIndex.erase(uidIt);
+      return;
+      }
+    }
+}
+
 
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
@@ -2487,7 +2668,7 @@ bool vtkMRMLSubjectHierarchyNode::ReparentItemByDataNode(vtkIdType itemID, vtkMR
     }
 
   // Get new parent item by the given data node
-  vtkSubjectHierarchyItem* newParentItem = this->Internal->SceneItem->FindChildByDataNode(newParentNode);
+  vtkSubjectHierarchyItem* newParentItem = this->Internal->SceneItem->FindIndexedItemByDataNode(newParentNode);
   if (!newParentItem)
     {
     vtkErrorMacro("ReparentItem: Failed to find subject hierarchy item by data MRML node " << newParentNode->GetName());
@@ -2523,7 +2704,7 @@ vtkIdType vtkMRMLSubjectHierarchyNode::GetItemByUID(const char* uidName, const c
     vtkErrorMacro("GetSubjectHierarchyNodeByUID: Invalid UID name or value");
     return INVALID_ITEM_ID;
     }
-  vtkSubjectHierarchyItem* item = this->Internal->SceneItem->FindChildByUID(uidName, uidValue);
+  vtkSubjectHierarchyItem* item = this->Internal->SceneItem->FindIndexedItemByUID(uidName, uidValue);
   return (item ? item->ID : INVALID_ITEM_ID);
 }
 
@@ -2548,7 +2729,7 @@ vtkIdType vtkMRMLSubjectHierarchyNode::GetItemByDataNode(vtkMRMLNode* dataNode)
     return INVALID_ITEM_ID;
     }
 
-  vtkSubjectHierarchyItem* item = this->Internal->SceneItem->FindChildByDataNode(dataNode);
+  vtkSubjectHierarchyItem* item = this->Internal->SceneItem->FindIndexedItemByDataNode(dataNode);
   return (item ? item->ID : INVALID_ITEM_ID);
 }
 
@@ -30,19 +30,108 @@
 #include <vtkTable.h>
 #include <vtkStringArray.h>
 #include <vtkBitArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
 #include <vtkNew.h>
 #include <vtkSQLQuery.h>
-#include <vtkRowQueryToTable.h>
 #include <vtkSQLDatabase.h>
 #include <vtkSQLiteDatabase.h>
 #include <vtkSQLiteQuery.h>
 #include <vtkSmartPointer.h>
+#include <vtkTypeInt64Array.h>
 
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <vector>
+
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLTableSQLiteStorageNode);
 
+namespace
+{
+
+/// Types of the columns in the database
+enum ColumnType
+{
+  IntegerColumn,
+  Integer64Column,
+  RealColumn,
+  TextColumn
+};
+
+//----------------------------------------------------------------------------
+std::string QuoteIdentifier(const std::string& identifier)
+{
+  std::string quoted = "\"";
+  for (std::string::const_iterator it = identifier.begin(); it != identifier.end(); ++it)
+    {
+    quoted += (*it == '"' ? "\"\"" : std::string(1, *it));
+    }
+  return quoted + "\"";
+}
+
+//----------------------------------------------------------------------------
+// Single component numeric arrays are stored with their type, everything else as text
+int GetColumnType(vtkAbstractArray* column)
+{
+  vtkDataArray* dataArray = vtkDataArray::SafeDownCast(column);
+  if (!dataArray || dataArray->GetNumberOfComponents() != 1)
+    {
+    return TextColumn;
+    }
+  switch (dataArray->GetDataType())
+    {
+    case VTK_FLOAT:
+    case VTK_DOUBLE:
+      return RealColumn;
+    case VTK_BIT:
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+    case VTK_UNSIGNED_CHAR:
+    case VTK_SHORT:
+    case VTK_UNSIGNED_SHORT:
+      return IntegerColumn;
+    default:
+      // int types that are not signed 32-bit may not fit in an int
+      return (dataArray->GetDataType() == VTK_INT
+        || (dataArray->GetDataTypeSize() == 4 && dataArray->GetDataType() == VTK_LONG))
+        ? IntegerColumn : Integer64Column;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Column type from the declared type, following the column affinity rules of SQLite
+int GetColumnTypeFromDeclaredType(std::string declaredType)
+{
+  declaredType = vtksys::SystemTools::UpperCase(declaredType);
+  if (declaredType.find("BIGINT") != std::string::npos)
+    {
+    return Integer64Column;
+    }
+  if (declaredType.find("INT") != std::string::npos)
+    {
+    return IntegerColumn;
+    }
+  if (declaredType.find("CHAR") != std::string::npos
+    || declaredType.find("CLOB") != std::string::npos
+    || declaredType.find("TEXT") != std::string::npos)
+    {
+    return TextColumn;
+    }
+  if (declaredType.find("REAL") != std::string::npos
+    || declaredType.find("FLOA") != std::string::npos
+    || declaredType.find("DOUB") != std::string::npos
+    || declaredType.find("NUMERIC") != std::string::npos
+    || declaredType.find("DECIMAL") != std::string::npos)
+    {
+    return RealColumn;
+    }
+  return TextColumn;
+}
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 vtkMRMLTableSQLiteStorageNode::vtkMRMLTableSQLiteStorageNode()
 {
@@ -84,6 +173,11 @@ int vtkMRMLTableSQLiteStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     vtkErrorMacro("ReadData: unable to cast input node " << refNode->GetID() << " to a table node");
     return 0;
     }
+  if (!this->TableName || std::string(this->TableName).empty())
+    {
+    vtkErrorMacro("ReadData: no table name specified");
+    return 0;
+    }
 
   // Check that the file exists
   if (vtksys::SystemTools::FileExists(fullName) == false)
@@ -104,16 +198,99 @@ int vtkMRMLTableSQLiteStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 
   vtkSmartPointer<vtkSQLiteQuery> query = vtkSmartPointer<vtkSQLiteQuery>::Take(
                    vtkSQLiteQuery::SafeDownCast( database->GetQueryInstance()));
-  std::string queryString("select * from ");
-  queryString += std::string(this->TableName);
+  std::string tableName = QuoteIdentifier(this->TableName);
+
+  // Get the column names and declared types
+  std::vector<std::string> columnNames;
+  std::vector<int> columnTypes;
+  std::string queryString = "PRAGMA table_info(" + tableName + ")";
   query->SetQuery(queryString.c_str());
-  query->Execute();
+  if (!query->Execute())
+    {
+    vtkErrorMacro("ReadData: failed to get the columns of table '" << this->TableName << "': " << query->GetLastErrorText());
+    return 0;
+    }
+  while (query->NextRow())
+    {
+    // the columns of table_info are: cid, name, type, notnull, dflt_value, pk
+    columnNames.push_back(query->DataValue(1).ToString());
+    columnTypes.push_back(GetColumnTypeFromDeclaredType(query->DataValue(2).ToString()));
+    }
+  if (columnNames.empty())
+    {
+    vtkErrorMacro("ReadData: table '" << this->TableName << "' not found in database file '" << fullName << "'");
+    return 0;
+    }
 
-  vtkSmartPointer<vtkRowQueryToTable> queryToTable = vtkSmartPointer<vtkRowQueryToTable>::New();
-  queryToTable->SetQuery(query);
-  queryToTable->Update();
+  queryString = "SELECT COUNT(*) FROM " + tableName;
+  query->SetQuery(queryString.c_str());
+  if (!query->Execute() || !query->NextRow())
+    {
+    vtkErrorMacro("ReadData: failed to count the rows of table '" << this->TableName << "'");
+    return 0;
+    }
+  vtkIdType numberOfRows = static_cast<vtkIdType>(query->DataValue(0).ToTypeInt64());
+
+  // Allocate the columns and fill them row by row, without intermediate tables.
+  // 64-bit integers are selected as text, as the query returns 32-bit integers.
+  vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
+  std::vector<vtkAbstractArray*> columns;
+  queryString = "SELECT ";
+  for (size_t columnIndex = 0; columnIndex < columnNames.size(); ++columnIndex)
+    {
+    vtkSmartPointer<vtkAbstractArray> column;
+    switch (columnTypes[columnIndex])
+      {
+      case IntegerColumn: column = vtkSmartPointer<vtkIntArray>::New(); break;
+      case Integer64Column: column = vtkSmartPointer<vtkTypeInt64Array>::New(); break;
+      case RealColumn: column = vtkSmartPointer<vtkDoubleArray>::New(); break;
+      default: column = vtkSmartPointer<vtkStringArray>::New(); break;
+      }
+    column->SetName(columnNames[columnIndex].c_str());
+    column->SetNumberOfTuples(numberOfRows);
+    table->AddColumn(column);
+    columns.push_back(column);
+
+    std::string columnName = QuoteIdentifier(columnNames[columnIndex]);
+    queryString += (columnIndex > 0 ? ", " : "");
+    queryString += (columnTypes[columnIndex] == Integer64Column ? "CAST(" + columnName + " AS TEXT)" : columnName);
+    }
+  queryString += " FROM " + tableName;
+  query->SetQuery(queryString.c_str());
+  if (!query->Execute())
+    {
+    vtkErrorMacro("ReadData: failed to read table '" << this->TableName << "': " << query->GetLastErrorText());
+    return 0;
+    }
 
-  vtkSmartPointer<vtkTable> table = queryToTable->GetOutput();
+  vtkIdType rowIndex = 0;
+  for (; rowIndex < numberOfRows && query->NextRow(); ++rowIndex)
+    {
+    for (size_t columnIndex = 0; columnIndex < columns.size(); ++columnIndex)
+      {
+      vtkVariant value = query->DataValue(static_cast<vtkIdType>(columnIndex));
+      switch (columnTypes[columnIndex])
+        {
+        case IntegerColumn:
+          static_cast<vtkIntArray*>(columns[columnIndex])->SetValue(rowIndex, value.ToInt());
+          break;
+        case Integer64Column:
+          static_cast<vtkTypeInt64Array*>(columns[columnIndex])->SetValue(rowIndex, value.ToTypeInt64());
+          break;
+        case RealColumn:
+          static_cast<vtkDoubleArray*>(columns[columnIndex])->SetValue(rowIndex, value.ToDouble());
+          break;
+        default:
+          static_cast<vtkStringArray*>(columns[columnIndex])->SetValue(rowIndex, value.ToString());
+          break;
+        }
+      }
+    }
+  if (rowIndex < numberOfRows)
+    {
+    vtkErrorMacro("ReadData: only " << rowIndex << " rows out of " << numberOfRows << " could be read from table '" << this->TableName << "'");
+    return 0;
+    }
 
   tableNode->SetAndObserveTable(table);
 
@@ -149,27 +326,37 @@ int vtkMRMLTableSQLiteStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
-  std::string dbname = std::string("sqlite://") + fullName;
-
-  //vtkSmartPointer<vtkSQLiteDatabase> database = vtkSmartPointer<vtkSQLiteDatabase>::Take(vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str())));
-  vtkSQLiteDatabase *database = vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str()));
+  vtkTable *table = tableNode->GetTable();
+  if (!table)
+    {
+    vtkErrorMacro("WriteData: no table to write for the node '" << std::string(tableNode->GetName()));
+    return 0;
+    }
 
-  if (!database || !database->Open(this->GetPassword(), vtkSQLiteDatabase::USE_EXISTING_OR_CREATE))
+  if (table->GetNumberOfColumns() == 0)
     {
-    vtkErrorMacro("ReadData: database file '" << fullName << "cannot be openned");
+    vtkErrorMacro("WriteData: no columns to write for the node '" << std::string(tableNode->GetName()));
     return 0;
     }
 
-  vtkTable *table = tableNode->GetTable();
-  if (!table)
+  std::string dbname = std::string("sqlite://") + fullName;
+  vtkSmartPointer<vtkSQLiteDatabase> database = vtkSmartPointer<vtkSQLiteDatabase>::Take(
+                   vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str())));
+
+  if (!database.GetPointer() || !database->Open(this->GetPassword(), vtkSQLiteDatabase::USE_EXISTING_OR_CREATE))
     {
-    vtkErrorMacro("ReadData: no table to write for the node '" << std::string(tableNode->GetName()));
+    vtkErrorMacro("WriteData: database file '" << fullName << "cannot be openned");
     return 0;
     }
 
-  if (!this->TableName || std::string(this->TableName).empty())
+  vtkSmartPointer<vtkSQLiteQuery> query = vtkSmartPointer<vtkSQLiteQuery>::Take(
+                   vtkSQLiteQuery::SafeDownCast( database->GetQueryInstance()));
+
+  // Replace the table in a single transaction: the rows are not committed one by one,
+  // and the previous table is kept if writing fails.
+  if (!query->BeginTransaction())
     {
-    vtkErrorMacro("ReadData: no table name for the node '" << std::string(tableNode->GetName()));
+    vtkErrorMacro("WriteData: failed to begin transaction: " << query->GetLastErrorText());
     return 0;
     }
 
@@ -177,91 +364,97 @@ int vtkMRMLTableSQLiteStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
   this->DropTable(this->TableName, database);
 
   //converting this table to SQLite will require two queries: one to create
-  //the table, and another to populate its rows with data.
-  std::string createTableQuery = "CREATE TABLE IF NOT EXISTS ";
-  createTableQuery += this->TableName;
-  createTableQuery += "(";
+  //the table, and another one, prepared once, to insert its rows.
+  std::string tableName = QuoteIdentifier(this->TableName);
+  std::string createTableQuery = "CREATE TABLE IF NOT EXISTS " + tableName + "(";
+  std::string insertQuery = "INSERT INTO " + tableName + " VALUES (";
 
-  std::string insertPreamble = "INSERT into ";
-  insertPreamble += this->TableName;
-  insertPreamble += "(";
-
-  //get the columns from the vtkTable to finish the query
+  //get the columns from the vtkTable to finish the queries
   vtkIdType numColumns = table->GetNumberOfColumns();
+  std::vector<int> columnTypes;
   for(vtkIdType i = 0; i < numColumns; i++)
     {
-    //get this column's name
-    std::string columnName = table->GetColumn(i)->GetName();
-    createTableQuery += columnName;
-    insertPreamble += "'" + columnName + "'";
-
-    //figure out what type of data is stored in this column
-    std::string columnType = table->GetColumn(i)->GetClassName();
+    vtkAbstractArray* column = table->GetColumn(i);
+    columnTypes.push_back(GetColumnType(column));
 
-    if( (columnType.find("String") != std::string::npos) ||
-        (columnType.find("Data") != std::string::npos) ||
-        (columnType.find("Variant") != std::string::npos) )
-      {
-      createTableQuery += " TEXT";
-      }
-    else if( (columnType.find("Double") != std::string::npos) ||
-             (columnType.find("Float") != std::string::npos) )
-      {
-      createTableQuery += " REAL";
-      }
-    else
+    createTableQuery += QuoteIdentifier(column->GetName() ? column->GetName() : "");
+    switch (columnTypes.back())
       {
-      createTableQuery += " INTEGER";
-      }
-    if(i == numColumns - 1)
-      {
-      createTableQuery += ");";
-      insertPreamble += ") VALUES (";
-      }
-    else
-      {
-      createTableQuery += ", ";
-      insertPreamble += ", ";
+      case IntegerColumn: createTableQuery += " INTEGER"; break;
+      case Integer64Column: createTableQuery += " BIGINT"; break;
+      case RealColumn: createTableQuery += " REAL"; break;
+      default: createTableQuery += " TEXT"; break;
       }
+    createTableQuery += (i < numColumns - 1 ? ", " : ");");
+    insertQuery += (i < numColumns - 1 ? "?, " : "?);");
     }
 
   //perform the create table query
-  vtkSQLiteQuery *query =
-    static_cast<vtkSQLiteQuery*>(database->GetQueryInstance());
-
   query->SetQuery(createTableQuery.c_str());
-  cout << "creating the table" << endl;
   if(!query->Execute())
     {
-    vtkErrorMacro(<<"Error performing 'create table' query");
+    vtkErrorMacro(<<"Error performing 'create table' query: " << query->GetLastErrorText());
+    query->RollbackTransaction();
+    return 0;
     }
 
-  //iterate over the rows of the vtkTable to complete the insert query
+  //bind the values of each row to the prepared insert statement
+  query->SetQuery(insertQuery.c_str());
   vtkIdType numRows = table->GetNumberOfRows();
   for(vtkIdType i = 0; i < numRows; i++)
     {
-    std::string insertQuery = insertPreamble;
     for (vtkIdType j = 0; j < numColumns; j++)
       {
-      insertQuery += "'" + table->GetValue(i, j).ToString() + "'";
-      if(j < numColumns - 1)
+      vtkAbstractArray* column = table->GetColumn(j);
+      int parameterIndex = static_cast<int>(j);
+      switch (columnTypes[j])
         {
-        insertQuery += ", ";
+        case IntegerColumn:
+          query->BindParameter(parameterIndex, static_cast<int>(static_cast<vtkDataArray*>(column)->GetTuple1(i)));
+          break;
+        case Integer64Column:
+          query->BindParameter(parameterIndex, column->GetVariantValue(i).ToTypeInt64());
+          break;
+        case RealColumn:
+          query->BindParameter(parameterIndex, static_cast<vtkDataArray*>(column)->GetTuple1(i));
+          break;
+        default:
+          if (vtkStringArray::SafeDownCast(column))
+            {
+            query->BindParameter(parameterIndex, static_cast<vtkStringArray*>(column)->GetValue(i));
+            }
+          else
+            {
+            query->BindParameter(parameterIndex, table->GetValue(i, j).ToString());
+            }
+          break;
         }
       }
-    insertQuery += ");";
     //perform the insert query for this row
-    query->SetQuery(insertQuery.c_str());
     if(!query->Execute())
       {
-      vtkErrorMacro(<<"Error performing 'insert' query");
+      vtkErrorMacro(<<"Error performing 'insert' query: " << query->GetLastErrorText());
+      query->RollbackTransaction();
+      return 0;
       }
     }
 
+  if (!query->CommitTransaction())
+    {
+    // the transaction is still in progress: roll it back to keep the previous table
+    // and release the database lock
+    std::string commitError = query->GetLastErrorText() ? query->GetLastErrorText() : "";
+    if (!query->RollbackTransaction())
+      {
+      vtkErrorMacro("WriteData: failed to roll back transaction: " << query->GetLastErrorText());
+      }
+    vtkErrorMacro("WriteData: failed to commit transaction: " << commitError);
+    return 0;
+    }
+
   //cleanup and return
-  query->Delete();
+  query = NULL;
   database->Close();
-  database->Delete();
 
   vtkDebugMacro("WriteData: successfully wrote table to database: " << fullName);
   return 1;
@@ -290,7 +483,7 @@ int vtkMRMLTableSQLiteStorageNode::DropTable(char *tableName, vtkSQLiteDatabase*
     if (!tables->GetValue(i).compare(tableName))
       {
       std::string dropTableQuery = "DROP TABLE ";
-      dropTableQuery += tableName;
+      dropTableQuery += QuoteIdentifier(tableName);
       query->SetQuery(dropTableQuery.c_str());
       query->Execute();
       break;
@@ -30,6 +30,10 @@
 /// vtkMRMLTableSQLiteStorageNode allows reading/writing of table node from
 /// SQLight database.
 ///
+/// Single component numeric columns are stored with their type (INTEGER,
+/// BIGINT for integers that may not fit in 32 bits, REAL) and read back as
+/// vtkIntArray, vtkTypeInt64Array and vtkDoubleArray without loss of precision.
+/// Other columns are stored as TEXT and read back as vtkStringArray.
 ///
 
 class vtkSQLiteDatabase;
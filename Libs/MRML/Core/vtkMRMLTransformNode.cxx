@@ -35,6 +35,7 @@ Version:   $Revision: 1.14 $
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
+#include <vtkSmartPointer.h>
 #include <vtkThinPlateSplineTransform.h>
 #include <vtkTransform.h>
 
@@ -149,6 +150,56 @@ void vtkMRMLTransformNode::FlattenGeneralTransform(vtkCollection* outputTransfor
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLTransformNode::TransformPoints(vtkAbstractTransform* transform, vtkPoints* inputPoints, vtkPoints* outputPoints)
+{
+  if (inputPoints==NULL || outputPoints==NULL)
+    {
+    vtkGenericWarningMacro("vtkMRMLTransformNode::TransformPoints failed: invalid input or output points");
+    return;
+    }
+  if (transform==NULL)
+    {
+    if (outputPoints!=inputPoints)
+      {
+      outputPoints->DeepCopy(inputPoints);
+      }
+    return;
+    }
+
+  vtkNew<vtkCollection> transformList;
+  FlattenGeneralTransform(transformList.GetPointer(), transform);
+
+  // Each component transform appends its results to an intermediate point set:
+  // the points are kept in double precision until the last component.
+  vtkSmartPointer<vtkPoints> currentPoints = inputPoints;
+  const int numberOfTransforms = transformList->GetNumberOfItems();
+  for (int i = 0; i < numberOfTransforms; i++)
+    {
+    vtkAbstractTransform* concatenatedTransform = vtkAbstractTransform::SafeDownCast(transformList->GetItemAsObject(i));
+    if (concatenatedTransform==NULL)
+      {
+      continue;
+      }
+    vtkSmartPointer<vtkPoints> transformedPoints = vtkSmartPointer<vtkPoints>::New();
+    transformedPoints->SetDataType(i < numberOfTransforms-1 ? VTK_DOUBLE : outputPoints->GetDataType());
+    transformedPoints->Allocate(currentPoints->GetNumberOfPoints());
+    concatenatedTransform->TransformPoints(currentPoints, transformedPoints);
+    currentPoints = transformedPoints;
+    }
+
+  if (currentPoints==inputPoints)
+    {
+    // empty composite transform
+    if (outputPoints!=inputPoints)
+      {
+      outputPoints->DeepCopy(inputPoints);
+      }
+    return;
+    }
+  outputPoints->ShallowCopy(currentPoints);
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLTransformNode::DeepCopyTransform(vtkAbstractTransform* dst, vtkAbstractTransform* src)
 {
@@ -21,6 +21,7 @@ class vtkCollection;
 class vtkAbstractTransform;
 class vtkGeneralTransform;
 class vtkMatrix4x4;
+class vtkPoints;
 class vtkTransform;
 
 /// \brief MRML node for representing a transformation
@@ -314,6 +315,14 @@ public:
   /// into a flat list of transforms. This is useful for simplifying serialization for copying and writing to file.
   static void FlattenGeneralTransform(vtkCollection* outputTransformList, vtkAbstractTransform* inputTransform);
 
+  ///
+  /// Transform all the points of inputPoints and store the results in outputPoints (the previous content of
+  /// outputPoints is replaced). Composite transforms are flattened and each component transforms all the points
+  /// at once, which allows grid and B-spline transforms to process the points in blocks, on multiple threads,
+  /// instead of one point at a time through vtkGeneralTransform.
+  /// inputPoints and outputPoints may be the same object.
+  static void TransformPoints(vtkAbstractTransform* transform, vtkPoints* inputPoints, vtkPoints* outputPoints);
+
   ///
   /// Utility function that determines if a transform is linear. It looks into composite transforms and only returns
   /// with true if all the transform components are linear.
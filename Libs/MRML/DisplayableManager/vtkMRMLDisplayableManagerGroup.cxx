@@ -29,6 +29,7 @@
 #endif
 
 // MRML includes
+#include <vtkEventBroker.h>
 #include <vtkMRMLNode.h>
 
 // VTK includes
@@ -54,6 +55,10 @@ class vtkMRMLDisplayableManagerGroup::vtkInternal
 public:
   vtkInternal();
 
+  /// Process the asynchronous events of the event broker before rendering
+  static void ProcessEventBrokerQueue(vtkObject* caller, unsigned long eid,
+                                      void* clientData, void* callData);
+
   // Collection of Displayable Managers
   std::vector<vtkMRMLAbstractDisplayableManager *> DisplayableManagers;
 
@@ -68,6 +73,7 @@ public:
       NameToDisplayableManagerMapIt;
 
   vtkSmartPointer<vtkCallbackCommand>   CallBackCommand;
+  vtkSmartPointer<vtkCallbackCommand>   RenderStartCallBackCommand;
   vtkMRMLDisplayableManagerFactory*     DisplayableManagerFactory;
   vtkMRMLNode*                          MRMLDisplayableNode;
   vtkRenderer*                          Renderer;
@@ -83,10 +89,27 @@ vtkMRMLDisplayableManagerGroup::vtkInternal::vtkInternal()
   this->MRMLDisplayableNode = 0;
   this->Renderer = 0;
   this->CallBackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RenderStartCallBackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RenderStartCallBackCommand->SetCallback(
+    vtkMRMLDisplayableManagerGroup::vtkInternal::ProcessEventBrokerQueue);
   this->DisplayableManagerFactory = 0;
   this->LightBoxRendererManagerProxy = 0;
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLDisplayableManagerGroup::vtkInternal::ProcessEventBrokerQueue(
+  vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+  void* vtkNotUsed(clientData), void* vtkNotUsed(callData))
+{
+  // In asynchronous mode, the events coalesced since the last render are
+  // delivered once, right before the scene is rendered.
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  if (broker->GetEventMode() == vtkEventBroker::Asynchronous)
+    {
+    broker->ProcessEventQueue();
+    }
+}
+
 //----------------------------------------------------------------------------
 // vtkMRMLDisplayableManagerGroup methods
 
@@ -111,6 +134,7 @@ vtkMRMLDisplayableManagerGroup::~vtkMRMLDisplayableManagerGroup()
 
   if (this->Internal->Renderer)
     {
+    this->Internal->Renderer->RemoveObserver(this->Internal->RenderStartCallBackCommand);
     this->Internal->Renderer->UnRegister(this);
     }
 
@@ -315,6 +339,7 @@ void vtkMRMLDisplayableManagerGroup::SetRenderer(vtkRenderer* newRenderer)
 
   if (this->Internal->Renderer)
     {
+    this->Internal->Renderer->RemoveObserver(this->Internal->RenderStartCallBackCommand);
     this->Internal->Renderer->Delete();
     }
 
@@ -323,6 +348,8 @@ void vtkMRMLDisplayableManagerGroup::SetRenderer(vtkRenderer* newRenderer)
   if (this->Internal->Renderer)
     {
     this->Internal->Renderer->Register(this);
+    this->Internal->Renderer->AddObserver(vtkCommand::StartEvent,
+                                          this->Internal->RenderStartCallBackCommand);
     }
 
   vtkDebugMacro(<< this->GetClassName() << " (" << this << "): "
@@ -62,14 +62,16 @@ int qMRMLNodeComboBoxLazyUpdateTest1( int argc, char * argv [] )
   nodeSelector.setShowHidden(true);
   nodeSelector.setNoneEnabled(true);
 
-  qobject_cast<qMRMLSceneModel*>(nodeSelector.sortFilterProxyModel()->sourceModel())
-    ->setLazyUpdate(true);
   qobject_cast<qMRMLSceneModel*>(treeNodeSelector.sortFilterProxyModel()->sourceModel())
     ->setLazyUpdate(true);
 
   vtkNew<vtkMRMLScene> scene;
   nodeSelector.setMRMLScene(scene.GetPointer());
   treeNodeSelector.setMRMLScene(scene.GetPointer());
+  // The scene model of the combo box is shared by all the combo boxes of
+  // the scene, it is known only once the scene is set.
+  qobject_cast<qMRMLSceneModel*>(nodeSelector.sortFilterProxyModel()->sourceModel())
+    ->setLazyUpdate(true);
 
   scene->StartState(vtkMRMLScene::ImportState);
   vtkNew<vtkMRMLColorTableNode> node;
@@ -100,8 +102,6 @@ int qMRMLNodeComboBoxLazyUpdateTest1( int argc, char * argv [] )
 
   qMRMLColorTableComboBox treeNodeSelector2;
 
-  qobject_cast<qMRMLSceneModel*>(nodeSelector2.sortFilterProxyModel()->sourceModel())
-    ->setLazyUpdate(true);
   qobject_cast<qMRMLSceneModel*>(treeNodeSelector2.sortFilterProxyModel()->sourceModel())
     ->setLazyUpdate(true);
 
@@ -0,0 +1,204 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// QT includes
+#include <QApplication>
+#include <QTimer>
+#include <QWidget>
+
+// Slicer includes
+#include "vtkSlicerConfigure.h"
+
+// CTK includes
+#include <ctkCoreTestingMacros.h>
+
+// qMRML includes
+#include "qMRMLColorTableComboBox.h"
+#include "qMRMLNodeComboBox.h"
+#include "qMRMLSceneExtraItemsProxyModel.h"
+#include "qMRMLSceneModel.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#ifdef Slicer_VTK_USE_QVTKOPENGLWIDGET
+#include <QVTKOpenGLWidget.h>
+#endif
+
+// STD includes
+#include <vector>
+
+// Node combo boxes of a scene share a scene model that only mirrors the nodes
+// of their types
+int qMRMLNodeComboBoxTest10( int argc, char * argv [] )
+{
+#ifdef Slicer_VTK_USE_QVTKOPENGLWIDGET
+  // Set default surface format for QVTKOpenGLWidget
+  QSurfaceFormat format = QVTKOpenGLWidget::defaultFormat();
+  format.setSamples(0);
+  QSurfaceFormat::setDefaultFormat(format);
+#endif
+
+  QApplication app(argc, argv);
+
+  vtkNew<vtkMRMLScene> scene;
+  const int volumeCount = 5;
+  for (int i = 0; i < volumeCount; ++i)
+    {
+    vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+    scene->AddNode(volumeNode.GetPointer());
+    }
+
+  const int comboBoxCount = 50;
+  QWidget parentWidget;
+  std::vector<qMRMLNodeComboBox*> comboBoxes;
+  for (int i = 0; i < comboBoxCount; ++i)
+    {
+    qMRMLNodeComboBox* nodeSelector = new qMRMLNodeComboBox(&parentWidget);
+    nodeSelector->setNodeTypes(QStringList("vtkMRMLVolumeNode"));
+    nodeSelector->setNoneEnabled(true);
+    nodeSelector->setMRMLScene(scene.GetPointer());
+    comboBoxes.push_back(nodeSelector);
+    }
+  qMRMLNodeComboBox* nodeSelector = comboBoxes[0];
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount);
+  qMRMLSceneModel* sceneModel = nodeSelector->sceneModel();
+  CHECK_INT(sceneModel->nodeTypes().count(), 1);
+  for (int i = 0; i < comboBoxCount; ++i)
+    {
+    CHECK_POINTER(comboBoxes[i]->sceneModel(), sceneModel);
+    }
+
+  // "None" and action items are in the proxy model of each combo box
+  CHECK_NOT_NULL(sceneModel->mrmlSceneItem());
+  CHECK_INT(sceneModel->mrmlSceneItem()->rowCount(), volumeCount);
+  CHECK_INT(sceneModel->preItems(sceneModel->mrmlSceneItem()).count(), 0);
+  qMRMLSceneExtraItemsProxyModel* extraItemsModel =
+    qobject_cast<qMRMLSceneExtraItemsProxyModel*>(nodeSelector->model());
+  CHECK_NOT_NULL(extraItemsModel);
+  CHECK_INT(extraItemsModel->preItems().count(), 1);
+  comboBoxes[1]->setNoneEnabled(false);
+  CHECK_INT(extraItemsModel->preItems().count(), 1);
+  CHECK_INT(comboBoxes[1]->nodeCount(), volumeCount);
+  CHECK_POINTER(comboBoxes[1]->nodeFromIndex(0), nodeSelector->nodeFromIndex(0));
+  nodeSelector->setCurrentNodeIndex(volumeCount - 1);
+  vtkMRMLNode* currentNode = nodeSelector->currentNode();
+  CHECK_NOT_NULL(currentNode);
+
+  // Nodes of other types are not added to the scene models
+  const int transformCount = 2000;
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  std::vector<vtkSmartPointer<vtkMRMLNode> > transformNodes;
+  for (int i = 0; i < transformCount; ++i)
+    {
+    vtkSmartPointer<vtkMRMLNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+    scene->AddNode(transformNode);
+    transformNodes.push_back(transformNode);
+    }
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"qMRMLNodeComboBox-AddNodesPerformance-"
+            << comboBoxCount << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  const int sceneItemRowCount = sceneModel->mrmlSceneItem()->rowCount();
+  CHECK_INT(sceneItemRowCount, volumeCount);
+  CHECK_NULL(sceneModel->itemFromNode(transformNodes[0]));
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount);
+
+  // Nodes of the types are inserted in the scene order
+  vtkNew<vtkMRMLScalarVolumeNode> newVolumeNode;
+  scene->AddNode(newVolumeNode.GetPointer());
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount + 1);
+  CHECK_POINTER(nodeSelector->nodeFromIndex(volumeCount), newVolumeNode.GetPointer());
+
+  timer->StartTimer();
+  for (int i = 0; i < transformCount; ++i)
+    {
+    scene->RemoveNode(transformNodes[i]);
+    }
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"qMRMLNodeComboBox-RemoveNodesPerformance-"
+            << comboBoxCount << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+  CHECK_INT(sceneModel->mrmlSceneItem()->rowCount(), sceneItemRowCount + 1);
+
+  scene->RemoveNode(newVolumeNode.GetPointer());
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount);
+
+  // A combo box of another type adds the nodes of its type to the shared
+  // model, without resetting the other combo boxes.
+  vtkNew<vtkMRMLModelNode> modelNode;
+  scene->AddNode(modelNode.GetPointer());
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount);
+  qMRMLNodeComboBox modelSelector;
+  modelSelector.setNodeTypes(QStringList("vtkMRMLModelNode"));
+  modelSelector.setMRMLScene(scene.GetPointer());
+  CHECK_POINTER(modelSelector.sceneModel(), sceneModel);
+  CHECK_INT(sceneModel->nodeTypes().count(), 2);
+  CHECK_NOT_NULL(sceneModel->itemFromNode(modelNode.GetPointer()));
+  CHECK_INT(modelSelector.nodeCount(), 1);
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount);
+  CHECK_POINTER(nodeSelector->currentNode(), currentNode);
+
+  QStringList nodeTypes;
+  nodeTypes << "vtkMRMLVolumeNode" << "vtkMRMLModelNode";
+  nodeSelector->setNodeTypes(nodeTypes);
+  CHECK_INT(nodeSelector->nodeCount(), volumeCount + 1);
+  CHECK_INT(comboBoxes[1]->nodeCount(), volumeCount);
+  nodeSelector->setNodeTypes(QStringList());
+  CHECK_INT(sceneModel->nodeTypes().count(), 0);
+  CHECK_INT(nodeSelector->nodeCount(), scene->GetNumberOfNodes());
+  CHECK_INT(comboBoxes[1]->nodeCount(), volumeCount);
+
+  // Combo boxes of another scene use another model
+  vtkNew<vtkMRMLScene> otherScene;
+  qMRMLNodeComboBox otherSceneSelector;
+  otherSceneSelector.setNodeTypes(QStringList("vtkMRMLVolumeNode"));
+  otherSceneSelector.setMRMLScene(otherScene.GetPointer());
+  CHECK_BOOL(otherSceneSelector.sceneModel() != sceneModel, true);
+  CHECK_INT(otherSceneSelector.nodeCount(), 0);
+
+  // Combo boxes with a custom model don't share it
+  qMRMLColorTableComboBox colorTableSelector;
+  colorTableSelector.setMRMLScene(scene.GetPointer());
+  CHECK_BOOL(colorTableSelector.sceneModel() != sceneModel, true);
+
+  // Closing the scene only updates the shared model once
+  timer->StartTimer();
+  scene->Clear(0);
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"qMRMLNodeComboBox-CloseScenePerformance-"
+            << comboBoxCount << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+  CHECK_INT(comboBoxes[1]->nodeCount(), 0);
+  CHECK_INT(modelSelector.nodeCount(), 0);
+
+  parentWidget.show();
+
+  if (argc < 2 || QString(argv[1]) != "-I")
+    {
+    QTimer::singleShot(200, &app, SLOT(quit()));
+    }
+
+  return app.exec();
+}
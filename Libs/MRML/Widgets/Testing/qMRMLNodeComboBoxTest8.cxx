@@ -25,7 +25,7 @@
 
 // qMRML includes
 #include "qMRMLNodeComboBox.h"
-#include "qMRMLSceneModel.h"
+#include "qMRMLSceneExtraItemsProxyModel.h"
 
 // MRML includes
 #include <vtkMRMLNode.h>
@@ -42,9 +42,9 @@ namespace
 {
 
 // --------------------------------------------------------------------------
-bool checkActionCount(int line, qMRMLSceneModel* sceneModel, int expected)
+bool checkActionCount(int line, qMRMLSceneExtraItemsProxyModel* extraItemsModel, int expected)
 {
-  int current = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int current = extraItemsModel->postItems().size();
   if (current != expected)
     {
     std::cerr << "Line " << line
@@ -91,15 +91,16 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
 
   std::cout << "Before adding new actions size policy = " << nodeSelector.sizeAdjustPolicy() << std::endl;
 
-  qMRMLSceneModel *sceneModel = nodeSelector.sceneModel();
+  qMRMLSceneExtraItemsProxyModel* extraItemsModel =
+    qobject_cast<qMRMLSceneExtraItemsProxyModel*>(nodeSelector.model());
 
-  int startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int startingActions = extraItemsModel->postItems().size();
 
   QAction* action1 = new QAction("Action one",
                                  &nodeSelector);
   nodeSelector.addMenuAction(action1);
 
-  int actionsPlusOne = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int actionsPlusOne = extraItemsModel->postItems().size();
   if (startingActions + 1 != actionsPlusOne)
     {
     std::cout << "After adding a new user action, new number of actions " << actionsPlusOne << " != " << startingActions << " + 1" << std::endl;
@@ -114,7 +115,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   QAction* action2 = new QAction("Create new type of action that conflicts with create new node", &nodeSelector);
   nodeSelector.addMenuAction(action2);
 
-  actionsPlusOne = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  actionsPlusOne = extraItemsModel->postItems().size();
   if (startingActions + 1 != actionsPlusOne)
     {
     std::cout << "After adding a second new user action that conflicts with a "
@@ -132,7 +133,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   // try adding the same action again
   nodeSelector.addMenuAction(action1);
 
-  actionsPlusOne = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  actionsPlusOne = extraItemsModel->postItems().size();
   if (startingActions + 1 != actionsPlusOne)
     {
     std::cout << "After adding a duplicate user action, new number of actions "
@@ -149,7 +150,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   QAction *action3 = new QAction("Action one", &nodeSelector);
   nodeSelector.addMenuAction(action3);
 
-  actionsPlusOne  = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  actionsPlusOne  = extraItemsModel->postItems().size();
   if (startingActions + 1 != actionsPlusOne)
     {
     std::cout << "After adding a third new user action with duplicate text, "
@@ -166,7 +167,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   QAction *action4 = new QAction("Another action text addition", &nodeSelector);
   nodeSelector.addMenuAction(action4);
 
-  int actionsPlusTwo  = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int actionsPlusTwo  = extraItemsModel->postItems().size();
   if (startingActions + 2 != actionsPlusTwo)
     {
     std::cout << "After adding a new user action with valid text, new number of actions " << actionsPlusTwo << " != " << startingActions << " + 2" << std::endl;
@@ -179,13 +180,13 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
 
   // Check if "Create new" and "Create new node as..." actions are added if multiple node types are enabled
 
-  int actionsWithOneNodeType = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int actionsWithOneNodeType = extraItemsModel->postItems().size();
 
   // don't use the view node as that has an attribute filter on it
   nodeSelector.setNodeTypes(QStringList()<<"vtkMRMLScalarVolumeNode"<<"vtkMRMLCameraNode");
 
   // Two new actions should have been added (Create new node; Create new node as...)
-  int actionsWithTwoNodeTypes = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  int actionsWithTwoNodeTypes = extraItemsModel->postItems().size();
   if (actionsWithTwoNodeTypes-actionsWithOneNodeType!=2)
     {
     std::cerr << __LINE__ << " - qMRMLNodeSelector: 2 new actions are expected for each new node type, but actually " << actionsWithTwoNodeTypes-actionsWithOneNodeType
@@ -196,11 +197,11 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   nodeSelector.setNodeTypes(QStringList(QString("vtkMRMLScalarVolumeNode")));
 
   // disable rename action
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setRenameEnabled(false);
 
   int expected = startingActions - 2;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
@@ -210,11 +211,11 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   // disable add action
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setAddEnabled(false);
 
   expected = startingActions - 1;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
@@ -224,11 +225,11 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   // disable delete action
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setRemoveEnabled(false);
 
   expected = startingActions - 1;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
@@ -250,14 +251,14 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
             << "Edit current "
             << "Rename current ")
     {
-    startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+    startingActions = extraItemsModel->postItems().size();
 
     QString actionName = QString("%1node using custom action").arg(actionPrefix);
     QAction *action = new QAction(actionName, &nodeSelector);
     nodeSelector.addMenuAction(action);
 
     expected = startingActions + 1;
-    if (!checkActionCount(__LINE__, sceneModel, expected))
+    if (!checkActionCount(__LINE__, extraItemsModel, expected))
       {
       return EXIT_FAILURE;
       }
@@ -271,7 +272,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
 
   // enabling add action is expected to fail since a custom action
   // with same name already exists
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setAddEnabled(1);
 
   if (nodeSelector.addEnabled() != false)
@@ -282,14 +283,14 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   expected = startingActions;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
 
   // enabling remove action is expected to fail since a custom action
   // with same name already exists
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setRemoveEnabled(1);
 
   if (nodeSelector.removeEnabled() != false)
@@ -300,14 +301,14 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   expected = startingActions;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
 
   // enabling edit action is expected to fail since a custom action
   // with same name already exists
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setEditEnabled(1);
 
   if (nodeSelector.editEnabled() != false)
@@ -318,14 +319,14 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   expected = startingActions;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
 
   // enabling rename action is expected to fail since a custom action
   // with same name already exists
-  startingActions = sceneModel->postItems(sceneModel->mrmlSceneItem()).size();
+  startingActions = extraItemsModel->postItems().size();
   nodeSelector.setRenameEnabled(1);
 
   if (nodeSelector.renameEnabled() != false)
@@ -336,7 +337,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     }
 
   expected = startingActions;
-  if (!checkActionCount(__LINE__, sceneModel, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel, expected))
     {
     return EXIT_FAILURE;
     }
@@ -352,21 +353,22 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
   nodeSelector2.setShowHidden(true);
   nodeSelector2.setMRMLScene(scene.GetPointer());
 
-  qMRMLSceneModel *sceneModel2 = nodeSelector2.sceneModel();
+  qMRMLSceneExtraItemsProxyModel* extraItemsModel2 =
+    qobject_cast<qMRMLSceneExtraItemsProxyModel*>(nodeSelector2.model());
 
   QAction* action = new QAction("Rename current node using custom action", &nodeSelector2);
 
-  startingActions = sceneModel2->postItems(sceneModel2->mrmlSceneItem()).size();
+  startingActions = extraItemsModel2->postItems().size();
   nodeSelector2.addMenuAction(action);
   expected = startingActions + 1;
-  if (!checkActionCount(__LINE__, sceneModel2, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel2, expected))
     {
     return EXIT_FAILURE;
     }
 
   // enabling rename action is expected to fail since a "Rename current "
   // custom action already exists
-  startingActions = sceneModel2->postItems(sceneModel2->mrmlSceneItem()).size();
+  startingActions = extraItemsModel2->postItems().size();
   nodeSelector2.setRenameEnabled(1);
 
   if (nodeSelector2.renameEnabled() != false)
@@ -377,7 +379,7 @@ int qMRMLNodeComboBoxTest8( int argc, char * argv [] )
     return EXIT_FAILURE;
     }
   expected = startingActions;
-  if (!checkActionCount(__LINE__, sceneModel2, expected))
+  if (!checkActionCount(__LINE__, extraItemsModel2, expected))
     {
     return EXIT_FAILURE;
     }
@@ -22,6 +22,7 @@
 #include <QAction>
 #include <QApplication>
 #include <QDebug>
+#include <QHash>
 #include <QHBoxLayout>
 #include <QInputDialog>
 #include <QKeyEvent>
@@ -35,12 +36,42 @@
 #include "qMRMLNodeComboBoxMenuDelegate.h"
 #include "qMRMLNodeComboBox_p.h"
 #include "qMRMLNodeFactory.h"
+#include "qMRMLSceneExtraItemsProxyModel.h"
 #include "qMRMLSceneModel.h"
 
 // MRML includes
 #include <vtkMRMLNode.h>
 #include <vtkMRMLScene.h>
 
+// --------------------------------------------------------------------------
+namespace
+{
+/// Scene models shared by the node combo boxes, one model per scene.
+typedef QHash<vtkMRMLScene*, qMRMLSceneModel*> SharedSceneModelsType;
+SharedSceneModelsType SharedSceneModels;
+/// Number of combo boxes that use each shared scene model.
+QHash<qMRMLSceneModel*, int> SharedSceneModelUseCounts;
+
+// --------------------------------------------------------------------------
+/// Return the classes of both lists, an empty list means all the classes.
+QStringList mergeNodeTypes(const QStringList& nodeTypes, const QStringList& otherNodeTypes)
+{
+  if (nodeTypes.isEmpty() || otherNodeTypes.isEmpty())
+    {
+    return QStringList();
+    }
+  QStringList mergedNodeTypes = nodeTypes;
+  foreach(const QString& nodeType, otherNodeTypes)
+    {
+    if (!mergedNodeTypes.contains(nodeType))
+      {
+      mergedNodeTypes << nodeType;
+      }
+    }
+  return mergedNodeTypes;
+}
+}
+
 // --------------------------------------------------------------------------
 qMRMLNodeComboBoxPrivate::qMRMLNodeComboBoxPrivate(qMRMLNodeComboBox& object)
   : q_ptr(&object)
@@ -48,6 +79,9 @@ qMRMLNodeComboBoxPrivate::qMRMLNodeComboBoxPrivate(qMRMLNodeComboBox& object)
   this->ComboBox = 0;
   this->MRMLNodeFactory = 0;
   this->MRMLSceneModel = 0;
+  this->SharedSceneModel = false;
+  this->SortFilterModel = 0;
+  this->ExtraItemsModel = 0;
   this->NoneEnabled = false;
   this->AddEnabled = true;
   this->RemoveEnabled = true;
@@ -91,6 +125,12 @@ void qMRMLNodeComboBoxPrivate::init(QAbstractItemModel* model)
 
   this->MRMLNodeFactory = new qMRMLNodeFactory(q);
 
+  if (model == 0)
+    {
+    this->SharedSceneModel = true;
+    model = qMRMLNodeComboBoxPrivate::acquireSharedSceneModel(0, QStringList());
+    }
+
   QAbstractItemModel* rootModel = model;
   while (qobject_cast<QAbstractProxyModel*>(rootModel) &&
          qobject_cast<QAbstractProxyModel*>(rootModel)->sourceModel())
@@ -99,13 +139,18 @@ void qMRMLNodeComboBoxPrivate::init(QAbstractItemModel* model)
     }
   this->MRMLSceneModel = qobject_cast<qMRMLSceneModel*>(rootModel);
   Q_ASSERT(this->MRMLSceneModel);
+
+  this->SortFilterModel = new qMRMLSortFilterProxyModel(q);
+  this->SortFilterModel->setSourceModel(model);
+  this->ExtraItemsModel = new qMRMLSceneExtraItemsProxyModel(q);
+  this->ExtraItemsModel->setExtraItemColumn(this->MRMLSceneModel->extraItemColumn());
+  this->ExtraItemsModel->setSourceModel(this->SortFilterModel);
+
   // no need to reset the root model index here as the model is not yet set
   this->updateNoneItem(false);
   this->updateActionItems(false);
 
-  qMRMLSortFilterProxyModel* sortFilterModel = new qMRMLSortFilterProxyModel(q);
-  sortFilterModel->setSourceModel(model);
-  this->setModel(sortFilterModel);
+  this->setModel(this->ExtraItemsModel);
 
   // nodeTypeLabel() works only when the model is set.
   this->updateDefaultText();
@@ -223,11 +268,7 @@ void qMRMLNodeComboBoxPrivate::updateNoneItem(bool resetRootIndex)
     }
   //QVariant currentNode =
   //  this->ComboBox->itemData(this->ComboBox->currentIndex(), qMRMLSceneModel::UIDRole);
-  //qDebug() << "updateNoneItem: " << this->MRMLSceneModel->mrmlSceneItem();
-  if (this->MRMLSceneModel->mrmlSceneItem())
-    {
-    this->MRMLSceneModel->setPreItems(noneItem, this->MRMLSceneModel->mrmlSceneItem());
-    }
+  this->ExtraItemsModel->setPreItems(noneItem);
 /*  if (resetRootIndex)
     {
     this->ComboBox->setRootModelIndex(q->model()->index(0, 0));
@@ -292,7 +333,7 @@ void qMRMLNodeComboBoxPrivate::updateActionItems(bool resetRootIndex)
       extraItems.append(action->text());
       }
     }
-  this->MRMLSceneModel->setPostItems(extraItems, this->MRMLSceneModel->mrmlSceneItem());
+  this->ExtraItemsModel->setPostItems(extraItems);
   QObject::connect(this->ComboBox->view(), SIGNAL(clicked(QModelIndex)),
                    q, SLOT(activateExtraItem(QModelIndex)),
                    Qt::UniqueConnection);
@@ -338,8 +379,7 @@ void qMRMLNodeComboBoxPrivate::updateDelegate(bool force)
 // --------------------------------------------------------------------------
 bool qMRMLNodeComboBoxPrivate::hasPostItem(const QString& name)const
 {
-  foreach(const QString& item,
-          this->MRMLSceneModel->postItems(this->MRMLSceneModel->mrmlSceneItem()))
+  foreach(const QString& item, this->ExtraItemsModel->postItems())
     {
     if (item.startsWith(name))
       {
@@ -349,6 +389,59 @@ bool qMRMLNodeComboBoxPrivate::hasPostItem(const QString& name)const
   return false;
 }
 
+// --------------------------------------------------------------------------
+qMRMLSceneModel* qMRMLNodeComboBoxPrivate::acquireSharedSceneModel(
+  vtkMRMLScene* scene, const QStringList& nodeTypes)
+{
+  qMRMLSceneModel* sceneModel = SharedSceneModels.value(scene, 0);
+  if (sceneModel && sceneModel->mrmlScene() != scene)
+    {
+    // The scene has been deleted and the new scene has the same address.
+    SharedSceneModels.remove(scene);
+    sceneModel = 0;
+    }
+  if (sceneModel == 0)
+    {
+    sceneModel = new qMRMLSceneModel;
+    // The model is populated with the nodes of the combo boxes only.
+    sceneModel->setNodeTypes(nodeTypes);
+    sceneModel->setMRMLScene(scene);
+    SharedSceneModels[scene] = sceneModel;
+    }
+  else
+    {
+    // Only the items of the new classes are created, the other combo boxes
+    // are not reset.
+    sceneModel->setNodeTypes(mergeNodeTypes(sceneModel->nodeTypes(), nodeTypes));
+    }
+  ++SharedSceneModelUseCounts[sceneModel];
+  return sceneModel;
+}
+
+// --------------------------------------------------------------------------
+void qMRMLNodeComboBoxPrivate::releaseSharedSceneModel(qMRMLSceneModel* sceneModel)
+{
+  if (--SharedSceneModelUseCounts[sceneModel] > 0)
+    {
+    return;
+    }
+  SharedSceneModelUseCounts.remove(sceneModel);
+  SharedSceneModelsType::iterator it = SharedSceneModels.begin();
+  while (it != SharedSceneModels.end())
+    {
+    if (it.value() == sceneModel)
+      {
+      it = SharedSceneModels.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+  // The proxy models of a combo box being destructed still use the model.
+  sceneModel->deleteLater();
+}
+
 // --------------------------------------------------------------------------
 // qMRMLNodeComboBox
 
@@ -358,7 +451,7 @@ qMRMLNodeComboBox::qMRMLNodeComboBox(QWidget* parentWidget)
   , d_ptr(new qMRMLNodeComboBoxPrivate(*this))
 {
   Q_D(qMRMLNodeComboBox);
-  d->init(new qMRMLSceneModel(this));
+  d->init(0);
 }
 
 // --------------------------------------------------------------------------
@@ -382,6 +475,11 @@ qMRMLNodeComboBox::qMRMLNodeComboBox(qMRMLNodeComboBoxPrivate* pimpl, QWidget* p
 // --------------------------------------------------------------------------
 qMRMLNodeComboBox::~qMRMLNodeComboBox()
 {
+  Q_D(qMRMLNodeComboBox);
+  if (d->SharedSceneModel)
+    {
+    qMRMLNodeComboBoxPrivate::releaseSharedSceneModel(d->MRMLSceneModel);
+    }
 }
 
 // --------------------------------------------------------------------------
@@ -703,8 +801,7 @@ int qMRMLNodeComboBox::nodeCount()const
 {
   Q_D(const qMRMLNodeComboBox);
   int extraItemsCount =
-    d->MRMLSceneModel->preItems(d->MRMLSceneModel->mrmlSceneItem()).count()
-    + d->MRMLSceneModel->postItems(d->MRMLSceneModel->mrmlSceneItem()).count();
+    d->ExtraItemsModel->preItems().count() + d->ExtraItemsModel->postItems().count();
   //qDebug() << d->MRMLSceneModel->invisibleRootItem() << d->MRMLSceneModel->mrmlSceneItem() << d->ComboBox->count() <<extraItemsCount;
   //printStandardItem(d->MRMLSceneModel->invisibleRootItem(), "  ");
   //qDebug() << d->ComboBox->rootModelIndex();
@@ -744,7 +841,18 @@ void qMRMLNodeComboBox::setMRMLScene(vtkMRMLScene* scene)
 
   // Update factory
   d->MRMLNodeFactory->setMRMLScene(scene);
-  d->MRMLSceneModel->setMRMLScene(scene);
+  if (d->SharedSceneModel)
+    {
+    qMRMLSceneModel* oldSceneModel = d->MRMLSceneModel;
+    d->MRMLSceneModel =
+      qMRMLNodeComboBoxPrivate::acquireSharedSceneModel(scene, this->nodeTypes());
+    d->SortFilterModel->setSourceModel(d->MRMLSceneModel);
+    qMRMLNodeComboBoxPrivate::releaseSharedSceneModel(oldSceneModel);
+    }
+  else
+    {
+    d->MRMLSceneModel->setMRMLScene(scene);
+    }
   d->updateDefaultText();
   d->updateNoneItem(false);
   d->updateActionItems(false);
@@ -870,6 +978,22 @@ void qMRMLNodeComboBox::setNodeTypes(const QStringList& _nodeTypes)
   nodeTypesFiltered.removeAll("");
 
   this->sortFilterProxyModel()->setNodeTypes(nodeTypesFiltered);
+  // The default scene model only needs to contain the nodes of these types,
+  // custom scene models may need other nodes (e.g. parents in hierarchies).
+  if (d->SharedSceneModel)
+    {
+    // The shared model also contains the nodes of the other combo boxes.
+    // The model of a null scene is populated when a scene is set.
+    if (d->MRMLSceneModel->mrmlScene())
+      {
+      d->MRMLSceneModel->setNodeTypes(
+        mergeNodeTypes(d->MRMLSceneModel->nodeTypes(), nodeTypesFiltered));
+      }
+    }
+  else if (d->MRMLSceneModel->metaObject() == &qMRMLSceneModel::staticMetaObject)
+    {
+    d->MRMLSceneModel->setNodeTypes(nodeTypesFiltered);
+    }
   d->updateDefaultText();
   d->updateActionItems();
 }
@@ -1035,8 +1159,9 @@ QList<vtkMRMLNode*> qMRMLNodeComboBox::nodes()const
 //--------------------------------------------------------------------------
 qMRMLSortFilterProxyModel* qMRMLNodeComboBox::sortFilterProxyModel()const
 {
-  Q_ASSERT(qobject_cast<qMRMLSortFilterProxyModel*>(this->model()));
-  return qobject_cast<qMRMLSortFilterProxyModel*>(this->model());
+  Q_D(const qMRMLNodeComboBox);
+  Q_ASSERT(d->SortFilterModel);
+  return d->SortFilterModel;
 }
 
 //--------------------------------------------------------------------------
@@ -52,6 +52,10 @@ class vtkMRMLScene;
 /// In addition to the populated nodes, qMRMLNodeComboBox contains menu
 /// items to add, delete, edit or rename the currently selected node. Each item
 /// can be hidden.
+/// The combo boxes of a scene share the same scene model, it contains the
+/// nodes of the types of all the combo boxes. Each combo box filters the
+/// nodes with its own sortFilterProxyModel() and adds the "None" and menu
+/// items with its own proxy model on top of it.
 class QMRML_WIDGETS_EXPORT qMRMLNodeComboBox
   : public QWidget
 {
@@ -219,7 +223,8 @@ public:
   QList<vtkMRMLNode*> nodes()const;
 
   /// Internal model associated to the combobox.
-  /// It is usually not the scene model but the sort filter proxy model.
+  /// It is a qMRMLSceneExtraItemsProxyModel that adds the "None" and menu
+  /// items to the sort filter proxy model.
   /// \sa sortFilterProxyModel(), sceneModel()
   QAbstractItemModel* model()const;
 
@@ -231,6 +236,9 @@ public:
   /// Retrieve the scene model internally used.
   /// The scene model is usually not used directly, but a sortFilterProxyModel
   /// is plugged in.
+  /// Unless a custom model is given to the constructor, the scene model is
+  /// shared by all the combo boxes of the scene and changes when the scene
+  /// is set.
   /// \sa sortFilterProxyModel()
   qMRMLSceneModel* sceneModel()const;
 
@@ -360,6 +368,8 @@ signals:
 
 protected:
   /// qMRMLNodeComboBox will not take ownership on the model.
+  /// The model is not shared with other combo boxes, subclasses that
+  /// customize the items of the scene model must use it.
   qMRMLNodeComboBox(QAbstractItemModel* model, QWidget* parent = 0);
   qMRMLNodeComboBox(qMRMLNodeComboBoxPrivate* pimpl, QWidget* parent = 0);
   QAbstractItemModel* rootModel()const;
@@ -39,6 +39,7 @@
 #include "qMRMLNodeComboBox.h"
 class QComboBox;
 class qMRMLNodeFactory;
+class qMRMLSceneExtraItemsProxyModel;
 class qMRMLSceneModel;
 
 // -----------------------------------------------------------------------------
@@ -51,6 +52,8 @@ protected:
 public:
   qMRMLNodeComboBoxPrivate(qMRMLNodeComboBox& object);
   virtual ~qMRMLNodeComboBoxPrivate();
+  /// Initialize the combo box with \a model, or with the scene model shared
+  /// by the combo boxes of the scene if \a model is 0.
   virtual void init(QAbstractItemModel* model);
 
   vtkMRMLNode* mrmlNode(int row)const;
@@ -64,9 +67,23 @@ public:
 
   bool hasPostItem(const QString& name)const;
 
+  /// Return the model shared by the combo boxes of \a scene, the model
+  /// contains at least the nodes of \a nodeTypes (all nodes if empty).
+  static qMRMLSceneModel* acquireSharedSceneModel(vtkMRMLScene* scene,
+                                                  const QStringList& nodeTypes);
+  /// The model is deleted when no combo box uses it anymore.
+  static void releaseSharedSceneModel(qMRMLSceneModel* sceneModel);
+
   QComboBox*        ComboBox;
   qMRMLNodeFactory* MRMLNodeFactory;
   qMRMLSceneModel*  MRMLSceneModel;
+  /// True if MRMLSceneModel is shared by all the combo boxes of the scene,
+  /// false if it is a custom model owned by the combo box.
+  bool              SharedSceneModel;
+  qMRMLSortFilterProxyModel*      SortFilterModel;
+  /// "None" and action items, they are not in the scene model that may be
+  /// shared.
+  qMRMLSceneExtraItemsProxyModel* ExtraItemsModel;
   bool              NoneEnabled;
   bool              AddEnabled;
   bool              RemoveEnabled;
@@ -0,0 +1,726 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+
+// qMRML includes
+#include "qMRMLSceneExtraItemsProxyModel.h"
+#include "qMRMLSceneModel.h"
+
+// -----------------------------------------------------------------------------
+// qMRMLSceneExtraItemsProxyModelPrivate
+
+// -----------------------------------------------------------------------------
+class qMRMLSceneExtraItemsProxyModelPrivate
+{
+  Q_DECLARE_PUBLIC(qMRMLSceneExtraItemsProxyModel);
+protected:
+  qMRMLSceneExtraItemsProxyModel* const q_ptr;
+public:
+  qMRMLSceneExtraItemsProxyModelPrivate(qMRMLSceneExtraItemsProxyModel& object);
+  ~qMRMLSceneExtraItemsProxyModelPrivate();
+
+  /// The internal pointer of a proxy index is the mapping of the parent of
+  /// its source index. Extra items use the mapping of the scene index.
+  struct Mapping
+  {
+    QPersistentModelIndex SourceParent;
+  };
+
+  /// Return the mapping of \a sourceParent, create it if needed.
+  Mapping* mapping(const QModelIndex& sourceParent)const;
+  void clearMappings();
+  /// Delete the mappings of the source parents that have been removed.
+  void removeObsoleteMappings();
+
+  /// Search the scene item in the top-level items of the source model.
+  void updateSourceSceneIndex();
+  bool isSourceSceneIndex(const QModelIndex& sourceIndex)const;
+  /// Number of extra items before the children of \a sourceParent.
+  int preItemCount(const QModelIndex& sourceParent)const;
+
+  /// Return true if \a proxyIndex is an extra item. \a post is set to true
+  /// for post items and \a extraRow to the position in the extra items list.
+  bool extraItem(const QModelIndex& proxyIndex, bool& post, int& extraRow)const;
+
+  void setExtraItems(const QStringList& extraItems, bool post);
+
+  QStringList PreItems;
+  QStringList PostItems;
+  int ExtraItemColumn;
+
+  mutable Mapping RootMapping;
+  mutable QList<Mapping*> Mappings;
+  QPersistentModelIndex SourceSceneIndex;
+
+  /// Persistent indexes saved when the source layout is about to change
+  struct LayoutIndex
+  {
+    QPersistentModelIndex SourceIndex;
+    int ExtraRow;
+    bool Post;
+    int Column;
+  };
+  QModelIndexList LayoutProxyIndexes;
+  QList<LayoutIndex> LayoutIndexes;
+};
+
+// -----------------------------------------------------------------------------
+qMRMLSceneExtraItemsProxyModelPrivate::qMRMLSceneExtraItemsProxyModelPrivate(qMRMLSceneExtraItemsProxyModel& object)
+  : q_ptr(&object)
+{
+  this->ExtraItemColumn = 0;
+}
+
+// -----------------------------------------------------------------------------
+qMRMLSceneExtraItemsProxyModelPrivate::~qMRMLSceneExtraItemsProxyModelPrivate()
+{
+  this->clearMappings();
+}
+
+// -----------------------------------------------------------------------------
+qMRMLSceneExtraItemsProxyModelPrivate::Mapping*
+qMRMLSceneExtraItemsProxyModelPrivate::mapping(const QModelIndex& sourceParent)const
+{
+  if (!sourceParent.isValid())
+    {
+    return &this->RootMapping;
+    }
+  // There are very few parents (the scene for combo boxes), a list is enough.
+  foreach(Mapping* parentMapping, this->Mappings)
+    {
+    if (parentMapping->SourceParent == sourceParent)
+      {
+      return parentMapping;
+      }
+    }
+  Mapping* parentMapping = new Mapping;
+  parentMapping->SourceParent = sourceParent;
+  this->Mappings << parentMapping;
+  return parentMapping;
+}
+
+// -----------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModelPrivate::clearMappings()
+{
+  qDeleteAll(this->Mappings);
+  this->Mappings.clear();
+}
+
+// -----------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModelPrivate::removeObsoleteMappings()
+{
+  QList<Mapping*>::iterator it = this->Mappings.begin();
+  while (it != this->Mappings.end())
+    {
+    if (!(*it)->SourceParent.isValid())
+      {
+      delete *it;
+      it = this->Mappings.erase(it);
+      }
+    else
+      {
+      ++it;
+      }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModelPrivate::updateSourceSceneIndex()
+{
+  Q_Q(qMRMLSceneExtraItemsProxyModel);
+  this->SourceSceneIndex = QPersistentModelIndex();
+  QAbstractItemModel* sourceModel = q->sourceModel();
+  if (!sourceModel)
+    {
+    return;
+    }
+  const int rowCount = sourceModel->rowCount();
+  for (int row = 0; row < rowCount; ++row)
+    {
+    QModelIndex index = sourceModel->index(row, 0);
+    if (index.data(qMRMLSceneModel::UIDRole).toString() == "scene")
+      {
+      this->SourceSceneIndex = index;
+      return;
+      }
+    }
+}
+
+// -----------------------------------------------------------------------------
+bool qMRMLSceneExtraItemsProxyModelPrivate::isSourceSceneIndex(const QModelIndex& sourceIndex)const
+{
+  return sourceIndex.isValid() && this->SourceSceneIndex == sourceIndex;
+}
+
+// -----------------------------------------------------------------------------
+int qMRMLSceneExtraItemsProxyModelPrivate::preItemCount(const QModelIndex& sourceParent)const
+{
+  return this->isSourceSceneIndex(sourceParent) ? this->PreItems.count() : 0;
+}
+
+// -----------------------------------------------------------------------------
+bool qMRMLSceneExtraItemsProxyModelPrivate::extraItem(const QModelIndex& proxyIndex, bool& post, int& extraRow)const
+{
+  Q_Q(const qMRMLSceneExtraItemsProxyModel);
+  if (!proxyIndex.isValid() || proxyIndex.model() != q || !q->sourceModel())
+    {
+    return false;
+    }
+  Mapping* parentMapping = static_cast<Mapping*>(proxyIndex.internalPointer());
+  if (!this->isSourceSceneIndex(parentMapping->SourceParent))
+    {
+    return false;
+    }
+  const int row = proxyIndex.row();
+  if (row < this->PreItems.count())
+    {
+    post = false;
+    extraRow = row;
+    return true;
+    }
+  const int lastNodeRow = this->PreItems.count()
+    + q->sourceModel()->rowCount(parentMapping->SourceParent) - 1;
+  if (row > lastNodeRow)
+    {
+    post = true;
+    extraRow = row - lastNodeRow - 1;
+    return true;
+    }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModelPrivate::setExtraItems(const QStringList& extraItems, bool post)
+{
+  Q_Q(qMRMLSceneExtraItemsProxyModel);
+  QStringList& items = post ? this->PostItems : this->PreItems;
+  if (items == extraItems)
+    {
+    return;
+    }
+  QModelIndex sceneIndex = q->mapFromSource(this->SourceSceneIndex);
+  if (!sceneIndex.isValid())
+    {
+    items = extraItems;
+    return;
+    }
+  const int firstRow = post ?
+    this->PreItems.count() + q->sourceModel()->rowCount(this->SourceSceneIndex) : 0;
+  if (items.count() == extraItems.count())
+    {
+    items = extraItems;
+    emit q->dataChanged(q->index(firstRow, 0, sceneIndex),
+      q->index(firstRow + items.count() - 1, q->columnCount(sceneIndex) - 1, sceneIndex));
+    return;
+    }
+  if (items.count())
+    {
+    q->beginRemoveRows(sceneIndex, firstRow, firstRow + items.count() - 1);
+    items.clear();
+    q->endRemoveRows();
+    }
+  if (extraItems.count())
+    {
+    q->beginInsertRows(sceneIndex, firstRow, firstRow + extraItems.count() - 1);
+    items = extraItems;
+    q->endInsertRows();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// qMRMLSceneExtraItemsProxyModel
+
+//------------------------------------------------------------------------------
+qMRMLSceneExtraItemsProxyModel::qMRMLSceneExtraItemsProxyModel(QObject *vparent)
+  : QAbstractProxyModel(vparent)
+  , d_ptr(new qMRMLSceneExtraItemsProxyModelPrivate(*this))
+{
+}
+
+//------------------------------------------------------------------------------
+qMRMLSceneExtraItemsProxyModel::~qMRMLSceneExtraItemsProxyModel()
+{
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::setSourceModel(QAbstractItemModel* newSourceModel)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  if (newSourceModel == this->sourceModel())
+    {
+    return;
+    }
+  this->beginResetModel();
+  if (this->sourceModel())
+    {
+    disconnect(this->sourceModel(), 0, this, 0);
+    }
+  this->Superclass::setSourceModel(newSourceModel);
+  if (newSourceModel)
+    {
+    connect(newSourceModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+            this, SLOT(onSourceDataChanged(QModelIndex,QModelIndex)));
+    connect(newSourceModel, SIGNAL(headerDataChanged(Qt::Orientation,int,int)),
+            this, SLOT(onSourceHeaderDataChanged(Qt::Orientation,int,int)));
+    connect(newSourceModel, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
+            this, SLOT(onSourceRowsAboutToBeInserted(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(rowsInserted(QModelIndex,int,int)),
+            this, SLOT(onSourceRowsInserted(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+            this, SLOT(onSourceRowsAboutToBeRemoved(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+            this, SLOT(onSourceRowsRemoved(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(columnsAboutToBeInserted(QModelIndex,int,int)),
+            this, SLOT(onSourceColumnsAboutToBeInserted(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(columnsInserted(QModelIndex,int,int)),
+            this, SLOT(onSourceColumnsInserted(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(columnsAboutToBeRemoved(QModelIndex,int,int)),
+            this, SLOT(onSourceColumnsAboutToBeRemoved(QModelIndex,int,int)));
+    connect(newSourceModel, SIGNAL(columnsRemoved(QModelIndex,int,int)),
+            this, SLOT(onSourceColumnsRemoved(QModelIndex,int,int)));
+    // Moves are rare (drag and drop in trees), handle them as layout changes
+    connect(newSourceModel, SIGNAL(rowsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(onSourceLayoutAboutToBeChanged()));
+    connect(newSourceModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(onSourceLayoutChanged()));
+    connect(newSourceModel, SIGNAL(columnsAboutToBeMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(onSourceLayoutAboutToBeChanged()));
+    connect(newSourceModel, SIGNAL(columnsMoved(QModelIndex,int,int,QModelIndex,int)),
+            this, SLOT(onSourceLayoutChanged()));
+    connect(newSourceModel, SIGNAL(layoutAboutToBeChanged()),
+            this, SLOT(onSourceLayoutAboutToBeChanged()));
+    connect(newSourceModel, SIGNAL(layoutChanged()),
+            this, SLOT(onSourceLayoutChanged()));
+    connect(newSourceModel, SIGNAL(modelAboutToBeReset()),
+            this, SLOT(onSourceModelAboutToBeReset()));
+    connect(newSourceModel, SIGNAL(modelReset()),
+            this, SLOT(onSourceModelReset()));
+    }
+  d->clearMappings();
+  d->updateSourceSceneIndex();
+  this->endResetModel();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::setPreItems(const QStringList& extraItems)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  d->setExtraItems(extraItems, false);
+}
+
+//------------------------------------------------------------------------------
+QStringList qMRMLSceneExtraItemsProxyModel::preItems()const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  return d->PreItems;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::setPostItems(const QStringList& extraItems)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  d->setExtraItems(extraItems, true);
+}
+
+//------------------------------------------------------------------------------
+QStringList qMRMLSceneExtraItemsProxyModel::postItems()const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  return d->PostItems;
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::setExtraItemColumn(int column)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  if (d->ExtraItemColumn == column)
+    {
+    return;
+    }
+  d->ExtraItemColumn = column;
+  QModelIndex sceneIndex = this->mapFromSource(d->SourceSceneIndex);
+  if (sceneIndex.isValid() && this->rowCount(sceneIndex) > 0)
+    {
+    emit dataChanged(this->index(0, 0, sceneIndex),
+      this->index(this->rowCount(sceneIndex) - 1, this->columnCount(sceneIndex) - 1, sceneIndex));
+    }
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSceneExtraItemsProxyModel::extraItemColumn()const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  return d->ExtraItemColumn;
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneExtraItemsProxyModel::isExtraItem(const QModelIndex& index)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  bool post = false;
+  int extraRow = -1;
+  return d->extraItem(index, post, extraRow);
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneExtraItemsProxyModel::index(int row, int column, const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  if (row < 0 || column < 0 ||
+      row >= this->rowCount(parent) || column >= this->columnCount(parent))
+    {
+    return QModelIndex();
+    }
+  QModelIndex sourceParent = this->mapToSource(parent);
+  return this->createIndex(row, column, d->mapping(sourceParent));
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneExtraItemsProxyModel::parent(const QModelIndex& child)const
+{
+  if (!child.isValid())
+    {
+    return QModelIndex();
+    }
+  qMRMLSceneExtraItemsProxyModelPrivate::Mapping* parentMapping =
+    static_cast<qMRMLSceneExtraItemsProxyModelPrivate::Mapping*>(child.internalPointer());
+  return this->mapFromSource(parentMapping->SourceParent);
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneExtraItemsProxyModel::sibling(int row, int column, const QModelIndex& index)const
+{
+  if (row == index.row() && column == index.column())
+    {
+    return index;
+    }
+  return this->index(row, column, this->parent(index));
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSceneExtraItemsProxyModel::rowCount(const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  if (!this->sourceModel() || this->isExtraItem(parent))
+    {
+    return 0;
+    }
+  QModelIndex sourceParent = this->mapToSource(parent);
+  int count = this->sourceModel()->rowCount(sourceParent);
+  if (d->isSourceSceneIndex(sourceParent))
+    {
+    count += d->PreItems.count() + d->PostItems.count();
+    }
+  return count;
+}
+
+//------------------------------------------------------------------------------
+int qMRMLSceneExtraItemsProxyModel::columnCount(const QModelIndex& parent)const
+{
+  if (!this->sourceModel() || this->isExtraItem(parent))
+    {
+    return 0;
+    }
+  return this->sourceModel()->columnCount(this->mapToSource(parent));
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneExtraItemsProxyModel::hasChildren(const QModelIndex& parent)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  if (!this->sourceModel() || this->isExtraItem(parent))
+    {
+    return false;
+    }
+  QModelIndex sourceParent = this->mapToSource(parent);
+  if (d->isSourceSceneIndex(sourceParent) &&
+      (d->PreItems.count() || d->PostItems.count()))
+    {
+    return true;
+    }
+  return this->sourceModel()->hasChildren(sourceParent);
+}
+
+//------------------------------------------------------------------------------
+QVariant qMRMLSceneExtraItemsProxyModel::data(const QModelIndex& index, int role)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  bool post = false;
+  int extraRow = -1;
+  if (!d->extraItem(index, post, extraRow))
+    {
+    if (role == qMRMLSceneModel::ExtraItemsRole &&
+        d->isSourceSceneIndex(this->mapToSource(index)))
+      {
+      // The extra items of the scene are the ones of the proxy
+      QMap<QString, QVariant> extraItems;
+      extraItems["preItem"] = d->PreItems;
+      extraItems["postItem"] = d->PostItems;
+      return extraItems;
+      }
+    return this->Superclass::data(index, role);
+    }
+  if (index.column() != d->ExtraItemColumn)
+    {
+    return QVariant();
+    }
+  const QString text = post ? d->PostItems[extraRow] : d->PreItems[extraRow];
+  switch (role)
+    {
+    case qMRMLSceneModel::UIDRole:
+      return QString(post ? "postItem" : "preItem");
+    case Qt::AccessibleDescriptionRole:
+      return text == "separator" ? QVariant(QString("separator")) : QVariant();
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+      return text == "separator" ? QVariant() : QVariant(text);
+    default:
+      break;
+    }
+  return QVariant();
+}
+
+//------------------------------------------------------------------------------
+QMap<int, QVariant> qMRMLSceneExtraItemsProxyModel::itemData(const QModelIndex& index)const
+{
+  if (this->isExtraItem(index))
+    {
+    return this->QAbstractItemModel::itemData(index);
+    }
+  return this->Superclass::itemData(index);
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneExtraItemsProxyModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+  if (this->isExtraItem(index))
+    {
+    return false;
+    }
+  return this->Superclass::setData(index, value, role);
+}
+
+//------------------------------------------------------------------------------
+Qt::ItemFlags qMRMLSceneExtraItemsProxyModel::flags(const QModelIndex& index)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  bool post = false;
+  int extraRow = -1;
+  if (!d->extraItem(index, post, extraRow))
+    {
+    return this->Superclass::flags(index);
+    }
+  if (index.column() != d->ExtraItemColumn)
+    {
+    return Qt::NoItemFlags;
+    }
+  // Same flags as qMRMLSceneModel::setPreItems() and setPostItems()
+  Qt::ItemFlags extraItemFlags = Qt::ItemIsEnabled;
+  if (!post)
+    {
+    extraItemFlags |= Qt::ItemIsSelectable;
+    }
+  return extraItemFlags;
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneExtraItemsProxyModel::mapToSource(const QModelIndex& proxyIndex)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  if (!proxyIndex.isValid() || !this->sourceModel())
+    {
+    return QModelIndex();
+    }
+  qMRMLSceneExtraItemsProxyModelPrivate::Mapping* parentMapping =
+    static_cast<qMRMLSceneExtraItemsProxyModelPrivate::Mapping*>(proxyIndex.internalPointer());
+  QModelIndex sourceParent = parentMapping->SourceParent;
+  int row = proxyIndex.row();
+  if (d->isSourceSceneIndex(sourceParent))
+    {
+    row -= d->PreItems.count();
+    if (row < 0 || row >= this->sourceModel()->rowCount(sourceParent))
+      {
+      // extra item
+      return QModelIndex();
+      }
+    }
+  return this->sourceModel()->index(row, proxyIndex.column(), sourceParent);
+}
+
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneExtraItemsProxyModel::mapFromSource(const QModelIndex& sourceIndex)const
+{
+  Q_D(const qMRMLSceneExtraItemsProxyModel);
+  if (!sourceIndex.isValid())
+    {
+    return QModelIndex();
+    }
+  QModelIndex sourceParent = sourceIndex.parent();
+  return this->createIndex(sourceIndex.row() + d->preItemCount(sourceParent),
+                           sourceIndex.column(), d->mapping(sourceParent));
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight)
+{
+  emit dataChanged(this->mapFromSource(topLeft), this->mapFromSource(bottomRight));
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceHeaderDataChanged(Qt::Orientation orientation, int first, int last)
+{
+  emit headerDataChanged(orientation, first, last);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceRowsAboutToBeInserted(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  const int offset = d->preItemCount(sourceParent);
+  this->beginInsertRows(this->mapFromSource(sourceParent), first + offset, last + offset);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceRowsInserted(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+  if (!sourceParent.isValid() && !d->SourceSceneIndex.isValid())
+    {
+    // The extra items must be there when the views are notified.
+    d->updateSourceSceneIndex();
+    }
+  this->endInsertRows();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceRowsAboutToBeRemoved(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  const int offset = d->preItemCount(sourceParent);
+  this->beginRemoveRows(this->mapFromSource(sourceParent), first + offset, last + offset);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceRowsRemoved(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+  if (!sourceParent.isValid() && !d->SourceSceneIndex.isValid())
+    {
+    d->updateSourceSceneIndex();
+    }
+  this->endRemoveRows();
+  d->removeObsoleteMappings();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceColumnsAboutToBeInserted(const QModelIndex& sourceParent, int first, int last)
+{
+  this->beginInsertColumns(this->mapFromSource(sourceParent), first, last);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceColumnsInserted(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_UNUSED(sourceParent);
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+  this->endInsertColumns();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceColumnsAboutToBeRemoved(const QModelIndex& sourceParent, int first, int last)
+{
+  this->beginRemoveColumns(this->mapFromSource(sourceParent), first, last);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceColumnsRemoved(const QModelIndex& sourceParent, int first, int last)
+{
+  Q_UNUSED(sourceParent);
+  Q_UNUSED(first);
+  Q_UNUSED(last);
+  this->endRemoveColumns();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceLayoutAboutToBeChanged()
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  emit layoutAboutToBeChanged();
+  d->LayoutProxyIndexes = this->persistentIndexList();
+  d->LayoutIndexes.clear();
+  foreach(const QModelIndex& proxyIndex, d->LayoutProxyIndexes)
+    {
+    qMRMLSceneExtraItemsProxyModelPrivate::LayoutIndex layoutIndex;
+    layoutIndex.ExtraRow = -1;
+    layoutIndex.Post = false;
+    layoutIndex.Column = proxyIndex.column();
+    if (!d->extraItem(proxyIndex, layoutIndex.Post, layoutIndex.ExtraRow))
+      {
+      layoutIndex.SourceIndex = this->mapToSource(proxyIndex);
+      }
+    d->LayoutIndexes << layoutIndex;
+    }
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceLayoutChanged()
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  d->updateSourceSceneIndex();
+  QModelIndex sceneIndex = this->mapFromSource(d->SourceSceneIndex);
+  QModelIndexList newProxyIndexes;
+  foreach(const qMRMLSceneExtraItemsProxyModelPrivate::LayoutIndex& layoutIndex, d->LayoutIndexes)
+    {
+    if (layoutIndex.ExtraRow < 0)
+      {
+      newProxyIndexes << this->mapFromSource(layoutIndex.SourceIndex);
+      }
+    else
+      {
+      const int row = layoutIndex.Post ?
+        this->rowCount(sceneIndex) - d->PostItems.count() + layoutIndex.ExtraRow :
+        layoutIndex.ExtraRow;
+      newProxyIndexes << this->index(row, layoutIndex.Column, sceneIndex);
+      }
+    }
+  this->changePersistentIndexList(d->LayoutProxyIndexes, newProxyIndexes);
+  d->LayoutProxyIndexes.clear();
+  d->LayoutIndexes.clear();
+  d->removeObsoleteMappings();
+  emit layoutChanged();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceModelAboutToBeReset()
+{
+  this->beginResetModel();
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneExtraItemsProxyModel::onSourceModelReset()
+{
+  Q_D(qMRMLSceneExtraItemsProxyModel);
+  d->clearMappings();
+  d->updateSourceSceneIndex();
+  this->endResetModel();
+}
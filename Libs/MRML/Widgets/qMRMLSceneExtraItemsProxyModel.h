@@ -0,0 +1,109 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Copyright (c) Kitware Inc.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __qMRMLSceneExtraItemsProxyModel_h
+#define __qMRMLSceneExtraItemsProxyModel_h
+
+// Qt includes
+#include <QAbstractProxyModel>
+#include <QStringList>
+
+// qMRML includes
+#include "qMRMLWidgetsExport.h"
+
+class qMRMLSceneExtraItemsProxyModelPrivate;
+
+/// Add extra items (e.g. "None", "Create new node", "separator") before and
+/// after the nodes of the scene item of a scene model, or of a proxy of a
+/// scene model.
+/// Unlike qMRMLSceneModel::setPreItems() and qMRMLSceneModel::setPostItems(),
+/// the source model is not modified: a scene model can be shared by multiple
+/// views that each have their own extra items.
+/// Extra items have the same data and flags as the extra items of
+/// qMRMLSceneModel: the qMRMLSceneModel::UIDRole is "preItem" or
+/// "postItem" and separators have "separator" as
+/// Qt::AccessibleDescriptionRole.
+/// \sa qMRMLSceneModel::setPreItems(), qMRMLNodeComboBox
+class QMRML_WIDGETS_EXPORT qMRMLSceneExtraItemsProxyModel : public QAbstractProxyModel
+{
+  Q_OBJECT
+  /// Items before the nodes of the scene item. Empty by default.
+  Q_PROPERTY(QStringList preItems READ preItems WRITE setPreItems)
+  /// Items after the nodes of the scene item. Empty by default.
+  Q_PROPERTY(QStringList postItems READ postItems WRITE setPostItems)
+  /// Column of the text and flags of the extra items. 0 by default.
+  Q_PROPERTY(int extraItemColumn READ extraItemColumn WRITE setExtraItemColumn)
+
+public:
+  typedef QAbstractProxyModel Superclass;
+  qMRMLSceneExtraItemsProxyModel(QObject *parent=0);
+  virtual ~qMRMLSceneExtraItemsProxyModel();
+
+  virtual void setSourceModel(QAbstractItemModel* sourceModel);
+
+  void setPreItems(const QStringList& extraItems);
+  QStringList preItems()const;
+
+  void setPostItems(const QStringList& extraItems);
+  QStringList postItems()const;
+
+  void setExtraItemColumn(int column);
+  int extraItemColumn()const;
+
+  /// Return true if \a index is a pre or post item of the proxy.
+  bool isExtraItem(const QModelIndex& index)const;
+
+  virtual QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex())const;
+  virtual QModelIndex parent(const QModelIndex& child)const;
+  QModelIndex sibling(int row, int column, const QModelIndex& index)const;
+  virtual int rowCount(const QModelIndex& parent = QModelIndex())const;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex())const;
+  virtual bool hasChildren(const QModelIndex& parent = QModelIndex())const;
+
+  virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole)const;
+  virtual QMap<int, QVariant> itemData(const QModelIndex& index)const;
+  virtual bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+  virtual Qt::ItemFlags flags(const QModelIndex& index)const;
+
+  virtual QModelIndex mapToSource(const QModelIndex& proxyIndex)const;
+  virtual QModelIndex mapFromSource(const QModelIndex& sourceIndex)const;
+
+protected slots:
+  void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+  void onSourceHeaderDataChanged(Qt::Orientation orientation, int first, int last);
+  void onSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last);
+  void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+  void onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+  void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+  void onSourceColumnsAboutToBeInserted(const QModelIndex& parent, int first, int last);
+  void onSourceColumnsInserted(const QModelIndex& parent, int first, int last);
+  void onSourceColumnsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+  void onSourceColumnsRemoved(const QModelIndex& parent, int first, int last);
+  void onSourceLayoutAboutToBeChanged();
+  void onSourceLayoutChanged();
+  void onSourceModelAboutToBeReset();
+  void onSourceModelReset();
+
+protected:
+  QScopedPointer<qMRMLSceneExtraItemsProxyModelPrivate> d_ptr;
+
+private:
+  Q_DECLARE_PRIVATE(qMRMLSceneExtraItemsProxyModel);
+  Q_DISABLE_COPY(qMRMLSceneExtraItemsProxyModel);
+};
+
+#endif
@@ -531,14 +531,15 @@ int qMRMLSceneModel::nodeIndex(vtkMRMLNode* node)const
 
   // Iterate through the scene and see if there is any matching node.
   // First try to find based on ptr value, as it's much faster than comparing string IDs.
-  vtkCollection* nodes = d->MRMLScene->GetNodes();
+  // Nodes that are not of nodeTypes are not in the model and do not count.
+  vtkSmartPointer<vtkCollection> nodes = d->candidateNodes();
   vtkMRMLNode* n = 0;
   vtkCollectionSimpleIterator it;
   for (nodes->InitTraversal(it);
        (n = (vtkMRMLNode*)(nodes->GetNextItemAsObject(it))) ;)
     {
     // note: parent can be NULL, it means that the scene is the parent
-    if (parent == this->parentNode(n))
+    if (parent == this->parentNode(n) && this->isNodeTypeIncluded(n))
       {
       ++index;
       if (node==n)
@@ -554,7 +555,7 @@ int qMRMLSceneModel::nodeIndex(vtkMRMLNode* node)const
        (n = (vtkMRMLNode*)nodes->GetNextItemAsObject(it)) ;)
     {
     // note: parent can be NULL, it means that the scene is the parent
-    if (parent == this->parentNode(n))
+    if (parent == this->parentNode(n) && this->isNodeTypeIncluded(n))
       {
       ++index;
       nId = n->GetID();
@@ -648,6 +649,122 @@ bool qMRMLSceneModel::lazyUpdate()const
   return d->LazyUpdate;
 }
 
+//------------------------------------------------------------------------------
+void qMRMLSceneModel::setNodeTypes(const QStringList& nodeTypes)
+{
+  Q_D(qMRMLSceneModel);
+  if (d->NodeTypes == nodeTypes)
+    {
+    return;
+    }
+  QStringList oldNodeTypes = d->NodeTypes;
+  d->NodeTypes = nodeTypes;
+  if (!d->MRMLScene)
+    {
+    return;
+    }
+  if (d->MRMLScene->IsImporting() || d->MRMLScene->IsClosing() ||
+      (d->LazyUpdate && d->MRMLScene->IsBatchProcessing()))
+    {
+    // The model is repopulated at the end of the import/close/batch
+    return;
+    }
+  // When the new classes include the old ones (e.g. a model shared by
+  // multiple views gets a new class), only the nodes of the new classes are
+  // inserted: the existing items and their indexes are left untouched.
+  bool onlyAddNodes = !oldNodeTypes.isEmpty() && this->mrmlSceneItem() != 0;
+  if (!nodeTypes.isEmpty())
+    {
+    foreach(const QString& oldNodeType, oldNodeTypes)
+      {
+      onlyAddNodes = onlyAddNodes && nodeTypes.contains(oldNodeType);
+      }
+    }
+  if (!onlyAddNodes)
+    {
+    this->updateScene();
+    return;
+    }
+  // Nodes are in the scene order, the row of the top-level nodes is known
+  // without searching the scene (see nodeIndex()).
+  int row = 0;
+  vtkSmartPointer<vtkCollection> nodes = d->candidateNodes();
+  vtkMRMLNode* node = 0;
+  vtkCollectionSimpleIterator it;
+  for (nodes->InitTraversal(it);
+       (node = (vtkMRMLNode*)nodes->GetNextItemAsObject(it)) ;)
+    {
+    if (!this->isNodeTypeIncluded(node))
+      {
+      continue;
+      }
+    bool newNode = !qMRMLSceneModelPrivate::isNodeOfTypes(node, oldNodeTypes);
+    if (this->parentNode(node) != 0)
+      {
+      if (newNode)
+        {
+        this->insertNode(node);
+        }
+      continue;
+      }
+    if (newNode)
+      {
+      d->insertNode(node, row);
+      }
+    ++row;
+    }
+}
+
+//------------------------------------------------------------------------------
+QStringList qMRMLSceneModel::nodeTypes()const
+{
+  Q_D(const qMRMLSceneModel);
+  return d->NodeTypes;
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneModel::isNodeTypeIncluded(vtkMRMLNode* node)const
+{
+  Q_D(const qMRMLSceneModel);
+  return qMRMLSceneModelPrivate::isNodeOfTypes(node, d->NodeTypes);
+}
+
+//------------------------------------------------------------------------------
+bool qMRMLSceneModelPrivate::isNodeOfTypes(vtkMRMLNode* node, const QStringList& nodeTypes)
+{
+  if (nodeTypes.isEmpty())
+    {
+    return true;
+    }
+  if (!node)
+    {
+    return false;
+    }
+  foreach(const QString& nodeType, nodeTypes)
+    {
+    if (node->IsA(nodeType.toLatin1()))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+vtkSmartPointer<vtkCollection> qMRMLSceneModelPrivate::candidateNodes()const
+{
+  vtkSmartPointer<vtkCollection> nodes;
+  if (this->NodeTypes.count() == 1)
+    {
+    nodes.TakeReference(this->MRMLScene->GetNodesByClass(this->NodeTypes[0].toLatin1()));
+    }
+  else
+    {
+    nodes = this->MRMLScene->GetNodes();
+    }
+  return nodes;
+}
+
 //------------------------------------------------------------------------------
 QMimeData* qMRMLSceneModel::mimeData(const QModelIndexList& indexes)const
 {
@@ -773,9 +890,14 @@ void qMRMLSceneModel::populateScene()
   vtkMRMLNode *node = 0;
   vtkCollectionSimpleIterator it;
   d->MisplacedNodes.clear();
-  for (d->MRMLScene->GetNodes()->InitTraversal(it);
-       (node = (vtkMRMLNode*)d->MRMLScene->GetNodes()->GetNextItemAsObject(it)) ;)
+  vtkSmartPointer<vtkCollection> nodes = d->candidateNodes();
+  for (nodes->InitTraversal(it);
+       (node = (vtkMRMLNode*)nodes->GetNextItemAsObject(it)) ;)
     {
+    if (!this->isNodeTypeIncluded(node))
+      {
+      continue;
+      }
     index++;
     d->insertNode(node, index);
     }
@@ -1225,6 +1347,10 @@ void qMRMLSceneModel::onMRMLSceneNodeAdded(vtkMRMLScene* scene, vtkMRMLNode* nod
     // to add a node during importing (see https://issues.slicer.org/view.php?id=4080).
     return;
     }
+  if (!this->isNodeTypeIncluded(node))
+    {
+    return;
+    }
   this->insertNode(node);
 }
 
@@ -1240,6 +1366,11 @@ void qMRMLSceneModel::onMRMLSceneNodeAboutToBeRemoved(vtkMRMLScene* scene, vtkMR
     {
     return;
     }
+  if (!this->isNodeTypeIncluded(node) && !d->RowCache.contains(node))
+    {
+    // the node is not in the model
+    return;
+    }
 
   int connectionsRemoved =
     qvtkDisconnect(node, vtkCommand::ModifiedEvent,
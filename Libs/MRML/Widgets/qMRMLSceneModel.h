@@ -74,6 +74,15 @@ class QMRML_WIDGETS_EXPORT qMRMLSceneModel : public QStandardItemModel
   /// imported/restored.
   Q_PROPERTY (bool lazyUpdate READ lazyUpdate WRITE setLazyUpdate)
 
+  /// Restrict the nodes in the model to the nodes of the given classes (or
+  /// subclasses). Nodes of other classes get no item and are not observed,
+  /// which makes the model and its scene updates proportional to the number
+  /// of nodes of these classes instead of the number of nodes in the scene.
+  /// It is meant for flat models whose views filter by class anyway (e.g.
+  /// qMRMLNodeComboBox), node hierarchies are not taken into account.
+  /// Empty by default: all the nodes of the scene are in the model.
+  Q_PROPERTY (QStringList nodeTypes READ nodeTypes WRITE setNodeTypes)
+
   /// Control in which column vtkMRMLNode names are displayed (Qt::DisplayRole).
   /// A value of -1 hides it. First column (0) by default.
   /// If no property is set in a column, nothing is displayed.
@@ -151,6 +160,18 @@ public:
   bool lazyUpdate()const;
   void setLazyUpdate(bool lazy);
 
+  /// Set the classes of the nodes in the model. If the new classes include
+  /// the old ones, only the nodes of the new classes are inserted, the model
+  /// is repopulated otherwise.
+  /// \sa nodeTypes
+  void setNodeTypes(const QStringList& nodeTypes);
+  QStringList nodeTypes()const;
+
+  /// Return true if \a node is of one of the classes of nodeTypes or if
+  /// nodeTypes is empty.
+  /// \sa nodeTypes
+  bool isNodeTypeIncluded(vtkMRMLNode* node)const;
+
   int nameColumn()const;
   void setNameColumn(int column);
 
@@ -45,6 +45,7 @@ class vtkMRMLScene;
 
 // VTK includes
 #include <vtkCallbackCommand.h>
+#include <vtkCollection.h>
 #include <vtkSmartPointer.h>
 
 //------------------------------------------------------------------------------
@@ -77,9 +78,20 @@ public:
   /// qMRMLSceneModel::nodeIndex(vtkMRMLNode*).
   QStandardItem* insertNode(vtkMRMLNode* node, int index);
 
+  /// Return the nodes of the scene that may be in the model: the nodes of
+  /// the class if there is only one class in NodeTypes (using the class index
+  /// of the scene), all the nodes of the scene otherwise. Nodes are in the
+  /// scene order.
+  vtkSmartPointer<vtkCollection> candidateNodes()const;
+
+  /// Return true if \a node is of one of the classes of \a nodeTypes or if
+  /// \a nodeTypes is empty.
+  static bool isNodeOfTypes(vtkMRMLNode* node, const QStringList& nodeTypes);
+
   vtkSmartPointer<vtkCallbackCommand> CallBack;
   qMRMLSceneModel::NodeTypes ListenNodeModifiedEvent;
   bool LazyUpdate;
+  QStringList NodeTypes;
   int PendingItemModified;
 
   int NameColumn;
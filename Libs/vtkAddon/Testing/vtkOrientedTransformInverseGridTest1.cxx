@@ -0,0 +1,192 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+// vtkAddon includes
+#include "vtkAddonTestingMacros.h"
+#include "vtkOrientedBSplineTransform.h"
+#include "vtkOrientedGridTransform.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+const int GridSize = 15;
+const double GridSpacing = 6.0;
+
+//----------------------------------------------------------------------------
+// Smooth displacement field on a rotated lattice
+void CreateGrid(vtkImageData* grid, vtkMatrix4x4* direction, double amplitude)
+{
+  grid->SetExtent(0, GridSize - 1, 0, GridSize - 1, 0, GridSize - 1);
+  grid->SetOrigin(-40.0, -30.0, -35.0);
+  grid->SetSpacing(GridSpacing, GridSpacing, GridSpacing);
+  grid->AllocateScalars(VTK_DOUBLE, 3);
+  const double period = GridSize * GridSpacing;
+  for (int z = 0; z < GridSize; z++)
+    {
+    for (int y = 0; y < GridSize; y++)
+      {
+      for (int x = 0; x < GridSize; x++)
+        {
+        const double u = 2.0 * vtkMath::Pi() * x * GridSpacing / period;
+        const double v = 2.0 * vtkMath::Pi() * y * GridSpacing / period;
+        const double w = 2.0 * vtkMath::Pi() * z * GridSpacing / period;
+        grid->SetScalarComponentFromDouble(x, y, z, 0, amplitude * sin(v + w));
+        grid->SetScalarComponentFromDouble(x, y, z, 1, amplitude * cos(u) * sin(w));
+        grid->SetScalarComponentFromDouble(x, y, z, 2, amplitude * sin(u + v));
+        }
+      }
+    }
+
+  const double angle = vtkMath::RadiansFromDegrees(20.0);
+  direction->Identity();
+  direction->SetElement(0, 0, cos(angle));
+  direction->SetElement(0, 1, -sin(angle));
+  direction->SetElement(1, 0, sin(angle));
+  direction->SetElement(1, 1, cos(angle));
+}
+
+//----------------------------------------------------------------------------
+// Largest distance between the point transformed back and forth and the
+// point, and largest difference with the reference inverse, for points
+// spread inside the grid.
+void GetInverseErrors(vtkAbstractTransform* transform, vtkMatrix4x4* direction,
+                      double referenceInverses[][3], bool setReference,
+                      double& maxRoundTripError, double& maxReferenceDifference)
+{
+  maxRoundTripError = 0.0;
+  maxReferenceDifference = 0.0;
+  int pointIndex = 0;
+  for (double k = 2.3; k < GridSize - 3; k += 1.7)
+    {
+    for (double j = 2.1; j < GridSize - 3; j += 1.9)
+      {
+      for (double i = 2.2; i < GridSize - 3; i += 1.3, pointIndex++)
+        {
+        const double gridIndex[4] = { i * GridSpacing, j * GridSpacing, k * GridSpacing, 0.0 };
+        double offset[4];
+        direction->MultiplyPoint(gridIndex, offset);
+        const double point[3] = { -40.0 + offset[0], -30.0 + offset[1], -35.0 + offset[2] };
+
+        double inverse[3];
+        transform->GetInverse()->TransformPoint(point, inverse);
+        double roundTrip[3];
+        transform->TransformPoint(inverse, roundTrip);
+        maxRoundTripError = std::max(maxRoundTripError,
+          sqrt(vtkMath::Distance2BetweenPoints(point, roundTrip)));
+
+        if (setReference)
+          {
+          referenceInverses[pointIndex][0] = inverse[0];
+          referenceInverses[pointIndex][1] = inverse[1];
+          referenceInverses[pointIndex][2] = inverse[2];
+          }
+        maxReferenceDifference = std::max(maxReferenceDifference,
+          sqrt(vtkMath::Distance2BetweenPoints(referenceInverses[pointIndex], inverse)));
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class TransformType>
+int InverseGridModesTest(TransformType* transform, vtkMatrix4x4* direction, double interpolationTolerance)
+{
+  double referenceInverses[1000][3];
+  double roundTripError = 0.0;
+  double referenceDifference = 0.0;
+
+  // Newton's method from the inverse grid is the default
+  CHECK_INT(transform->GetInverseGridMode(), TransformType::InverseGridInitialGuess);
+
+  // Newton's method from the point minus its displacement is the reference
+  transform->SetInverseGridModeToOff();
+  GetInverseErrors(transform, direction, referenceInverses, true, roundTripError, referenceDifference);
+  if (roundTripError > 0.01)
+    {
+    std::cerr << "Line " << __LINE__ << ": inverse error " << roundTripError << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Newton's method from the inverse grid converges to the same points
+  transform->SetInverseGridModeToInitialGuess();
+  GetInverseErrors(transform, direction, referenceInverses, false, roundTripError, referenceDifference);
+  if (roundTripError > 0.01 || referenceDifference > 0.01)
+    {
+    std::cerr << "Line " << __LINE__ << ": inverse error " << roundTripError
+              << ", difference with reference " << referenceDifference << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The interpolated inverse is close to the reference
+  transform->SetInverseGridModeToInterpolate();
+  GetInverseErrors(transform, direction, referenceInverses, false, roundTripError, referenceDifference);
+  if (roundTripError > interpolationTolerance || referenceDifference > interpolationTolerance)
+    {
+    std::cerr << "Line " << __LINE__ << ": inverse error " << roundTripError
+              << ", difference with reference " << referenceDifference << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Modifying the transform invalidates the inverse grid
+  transform->SetDisplacementScale(0.5);
+  GetInverseErrors(transform, direction, referenceInverses, false, roundTripError, referenceDifference);
+  if (roundTripError > interpolationTolerance)
+    {
+    std::cerr << "Line " << __LINE__ << ": inverse error " << roundTripError
+              << " after the transform is modified" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Deep copy keeps the mode
+  vtkNew<TransformType> copy;
+  copy->DeepCopy(transform);
+  CHECK_INT(copy->GetInverseGridMode(), TransformType::InverseGridInterpolate);
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+//----------------------------------------------------------------------------
+int vtkOrientedTransformInverseGridTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  {
+  vtkNew<vtkImageData> grid;
+  vtkNew<vtkMatrix4x4> direction;
+  CreateGrid(grid.GetPointer(), direction.GetPointer(), 4.0);
+  vtkNew<vtkOrientedGridTransform> gridTransform;
+  gridTransform->SetGridDirectionMatrix(direction.GetPointer());
+  gridTransform->SetDisplacementGridData(grid.GetPointer());
+  gridTransform->SetInterpolationModeToCubic();
+  CHECK_EXIT_SUCCESS(InverseGridModesTest(gridTransform.GetPointer(), direction.GetPointer(), 0.5));
+  }
+
+  {
+  vtkNew<vtkImageData> grid;
+  vtkNew<vtkMatrix4x4> direction;
+  CreateGrid(grid.GetPointer(), direction.GetPointer(), 4.0);
+  vtkNew<vtkOrientedBSplineTransform> bsplineTransform;
+  bsplineTransform->SetGridDirectionMatrix(direction.GetPointer());
+  bsplineTransform->SetCoefficientData(grid.GetPointer());
+  bsplineTransform->SetBorderModeToZero();
+  CHECK_EXIT_SUCCESS(InverseGridModesTest(bsplineTransform.GetPointer(), direction.GetPointer(), 0.5));
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/*=auto==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+===============================================================================auto=*/
+
+#include "vtkAddonMappedFile.h"
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+vtkAddonMappedFile::vtkAddonMappedFile()
+  : Data(NULL)
+  , Size(0)
+#ifdef _WIN32
+  , File(INVALID_HANDLE_VALUE)
+#else
+  , File(NULL)
+#endif
+  , Mapping(NULL)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkAddonMappedFile::~vtkAddonMappedFile()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+bool vtkAddonMappedFile::Open(const std::string& fileName, bool randomAccess)
+{
+  this->Close();
+#ifdef _WIN32
+  this->File = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, randomAccess ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL, NULL);
+  LARGE_INTEGER fileSize;
+  if (this->File == INVALID_HANDLE_VALUE
+    || !GetFileSizeEx(this->File, &fileSize)
+    || fileSize.QuadPart <= 0
+    || static_cast<vtkTypeUInt64>(fileSize.QuadPart) > static_cast<vtkTypeUInt64>(VTK_SIZE_MAX))
+    {
+    this->Close();
+    return false;
+    }
+  this->Mapping = CreateFileMappingA(this->File, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (this->Mapping == NULL)
+    {
+    this->Close();
+    return false;
+    }
+  this->Data = static_cast<const unsigned char*>(
+    MapViewOfFile(this->Mapping, FILE_MAP_READ, 0, 0, 0));
+  if (this->Data == NULL)
+    {
+    this->Close();
+    return false;
+    }
+  this->Size = static_cast<vtkTypeUInt64>(fileSize.QuadPart);
+#else
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0
+    || fileStat.st_size <= 0
+    || static_cast<vtkTypeUInt64>(fileStat.st_size) > static_cast<vtkTypeUInt64>(VTK_SIZE_MAX))
+    {
+    close(fd);
+    return false;
+    }
+  void* data = mmap(NULL, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping remains valid after the file descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED)
+    {
+    return false;
+    }
+  if (randomAccess)
+    {
+    madvise(data, static_cast<size_t>(fileStat.st_size), MADV_RANDOM);
+    }
+  this->Data = static_cast<const unsigned char*>(data);
+  this->Size = static_cast<vtkTypeUInt64>(fileStat.st_size);
+#endif
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkAddonMappedFile::Close()
+{
+#ifdef _WIN32
+  if (this->Data)
+    {
+    UnmapViewOfFile(this->Data);
+    }
+  if (this->Mapping)
+    {
+    CloseHandle(this->Mapping);
+    }
+  if (this->File != INVALID_HANDLE_VALUE)
+    {
+    CloseHandle(this->File);
+    }
+  this->Mapping = NULL;
+  this->File = INVALID_HANDLE_VALUE;
+#else
+  if (this->Data)
+    {
+    munmap(const_cast<unsigned char*>(this->Data), static_cast<size_t>(this->Size));
+    }
+#endif
+  this->Data = NULL;
+  this->Size = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkAddonMappedFile::WillNeed(vtkTypeUInt64 offset, vtkTypeUInt64 length) const
+{
+#ifndef _WIN32
+  if (!this->Data || offset >= this->Size)
+    {
+    return;
+    }
+  if (length > this->Size - offset)
+    {
+    length = this->Size - offset;
+    }
+  // the advised range must start on a page boundary
+  const vtkTypeUInt64 pageSize = static_cast<vtkTypeUInt64>(sysconf(_SC_PAGESIZE));
+  const vtkTypeUInt64 start = offset - offset % pageSize;
+  madvise(const_cast<unsigned char*>(this->Data) + start,
+    static_cast<size_t>(length + offset - start), MADV_WILLNEED);
+#else
+  (void)offset;
+  (void)length;
+#endif
+}
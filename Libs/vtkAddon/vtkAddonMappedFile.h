@@ -0,0 +1,69 @@
+/*=auto==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+===============================================================================auto=*/
+
+#ifndef __vtkAddonMappedFile_h
+#define __vtkAddonMappedFile_h
+
+#include "vtkAddon.h"
+
+// VTK includes
+#include <vtkType.h>
+
+// STD includes
+#include <string>
+
+/// \brief Read-only memory mapping of a whole file.
+///
+/// The pages are loaded on demand by the operating system and are shared
+/// with its file cache, so mapped files may be much larger than the
+/// available memory. The mapping is released when the object is destroyed.
+class VTK_ADDON_EXPORT vtkAddonMappedFile
+{
+public:
+  vtkAddonMappedFile();
+  ~vtkAddonMappedFile();
+
+  /// Map \a fileName, return false if it cannot be mapped (e.g. empty file
+  /// or address space exhausted).
+  /// If \a randomAccess is true, the file is read in no particular order and
+  /// the read-ahead of the operating system is disabled: use WillNeed() to
+  /// request it explicitly.
+  bool Open(const std::string& fileName, bool randomAccess = false);
+
+  /// Release the mapping
+  void Close();
+
+  /// Content of the file, NULL if no file is mapped
+  const unsigned char* GetData() const { return this->Data; }
+  /// Size of the file in bytes
+  vtkTypeUInt64 GetSize() const { return this->Size; }
+
+  /// Ask the operating system to start reading [offset, offset+length[ in
+  /// the background. Returns immediately, this is a no-op if the platform
+  /// has no asynchronous read-ahead for mappings.
+  void WillNeed(vtkTypeUInt64 offset, vtkTypeUInt64 length) const;
+
+private:
+  vtkAddonMappedFile(const vtkAddonMappedFile&); // Not implemented.
+  void operator=(const vtkAddonMappedFile&); // Not implemented.
+
+  const unsigned char* Data;
+  vtkTypeUInt64 Size;
+  /// File and file mapping handles on Windows
+  void* File;
+  void* Mapping;
+};
+
+#endif
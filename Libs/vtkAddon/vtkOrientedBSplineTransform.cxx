@@ -8,14 +8,25 @@
 =========================================================================auto=*/
 
 #include "vtkOrientedBSplineTransform.h"
+#include "vtkOrientedTransformInverseGrid.h"
 
 #include "vtkImageData.h"
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
+#include "vtkMultiThreader.h"
+#include "vtkNew.h"
 #include "vtkObjectFactory.h"
+#include "vtkPoints.h"
 
+#include <algorithm>
 #include <math.h>
 
+// Number of points transformed together by ForwardTransformPoints
+#define VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE 64
+
+// Smallest number of points worth a thread in TransformPoints
+#define VTK_ORIENTED_BSPLINE_TRANSFORM_POINTS_PER_THREAD 1024
+
 vtkStandardNewMacro(vtkOrientedBSplineTransform);
 
 vtkCxxSetObjectMacro(vtkOrientedBSplineTransform,GridDirectionMatrix,vtkMatrix4x4);
@@ -77,6 +88,59 @@ inline void vtkLinearTransformDerivative(const double matrix[4][4],
     }
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct vtkOrientedBSplineTransformPointsInfo
+{
+  vtkOrientedBSplineTransform* Transform;
+  vtkPoints* InPoints;
+  vtkPoints* OutPoints;
+  vtkIdType OutOffset;
+  vtkIdType NumberOfPoints;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkOrientedBSplineTransformPointsThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkOrientedBSplineTransformPointsInfo* info =
+    static_cast<vtkOrientedBSplineTransformPointsInfo*>(threadInfo->UserData);
+  const vtkIdType begin = info->NumberOfPoints * threadInfo->ThreadID / threadInfo->NumberOfThreads;
+  const vtkIdType end = info->NumberOfPoints * (threadInfo->ThreadID + 1) / threadInfo->NumberOfThreads;
+  info->Transform->ForwardTransformPoints(info->InPoints, begin, end,
+                                          info->OutPoints, info->OutOffset + begin);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkOrientedBSplineTransformLoadPoints(const T* points, int n, double* x, double* y, double* z)
+{
+  for (int l = 0; l < n; l++)
+    {
+    x[l] = static_cast<double>(points[3 * l]);
+    y[l] = static_cast<double>(points[3 * l + 1]);
+    z[l] = static_cast<double>(points[3 * l + 2]);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkOrientedBSplineTransformStorePoints(const double* x, const double* y, const double* z, int n, T* points)
+{
+  for (int l = 0; l < n; l++)
+    {
+    points[3 * l] = static_cast<T>(x[l]);
+    points[3 * l + 1] = static_cast<T>(y[l]);
+    points[3 * l + 2] = static_cast<T>(z[l]);
+    }
+}
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 vtkOrientedBSplineTransform::vtkOrientedBSplineTransform()
 {
@@ -85,6 +149,8 @@ vtkOrientedBSplineTransform::vtkOrientedBSplineTransform()
   this->GridIndexToOutputTransformMatrixCached = vtkMatrix4x4::New();
   this->OutputToGridIndexTransformMatrixCached = vtkMatrix4x4::New();
   this->InverseBulkTransformMatrixCached = vtkMatrix4x4::New();
+  this->InverseGridMode = vtkOrientedBSplineTransform::InverseGridInitialGuess;
+  this->InverseGrid = new vtkOrientedTransformInverseGrid;
 }
 
 //----------------------------------------------------------------------------
@@ -107,6 +173,8 @@ vtkOrientedBSplineTransform::~vtkOrientedBSplineTransform()
     this->InverseBulkTransformMatrixCached->Delete();
     this->InverseBulkTransformMatrixCached=NULL;
     }
+  delete this->InverseGrid;
+  this->InverseGrid = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -124,6 +192,135 @@ void vtkOrientedBSplineTransform::PrintSelf(ostream& os, vtkIndent indent)
     {
     this->GetBulkTransformMatrix()->PrintSelf(os,indent.GetNextIndent());
     }
+  os << indent << "InverseGridMode: " << this->InverseGridMode << "\n";
+  os << indent << "InverseGridMemorySize: " << this->InverseGrid->GetMemorySize() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedBSplineTransform::TransformPoints(vtkPoints *inPts, vtkPoints *outPts)
+{
+  this->Update();
+
+  const int inType = inPts->GetDataType();
+  const int outType = outPts->GetDataType();
+  if (this->InverseFlag || !this->GridPointer || !this->CalculateSpline
+    || inPts == outPts
+    || (inType != VTK_FLOAT && inType != VTK_DOUBLE)
+    || (outType != VTK_FLOAT && outType != VTK_DOUBLE))
+    {
+    this->Superclass::TransformPoints(inPts, outPts);
+    return;
+    }
+
+  const vtkIdType numberOfPoints = inPts->GetNumberOfPoints();
+  const vtkIdType outOffset = outPts->GetNumberOfPoints();
+  outPts->SetNumberOfPoints(outOffset + numberOfPoints);
+
+  vtkOrientedBSplineTransformPointsInfo info;
+  info.Transform = this;
+  info.InPoints = inPts;
+  info.OutPoints = outPts;
+  info.OutOffset = outOffset;
+  info.NumberOfPoints = numberOfPoints;
+
+  vtkNew<vtkMultiThreader> threader;
+  const vtkIdType maxNumberOfThreads = numberOfPoints / VTK_ORIENTED_BSPLINE_TRANSFORM_POINTS_PER_THREAD + 1;
+  threader->SetNumberOfThreads(static_cast<int>(
+    std::min(static_cast<vtkIdType>(threader->GetNumberOfThreads()), maxNumberOfThreads)));
+  threader->SetSingleMethod(vtkOrientedBSplineTransformPointsThread, &info);
+  threader->SingleMethodExecute();
+
+  outPts->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedBSplineTransform::ForwardTransformPoints(vtkPoints *inPts, vtkIdType begin, vtkIdType end,
+                                                         vtkPoints *outPts, vtkIdType outOffset)
+{
+  void *inPtr = inPts->GetData()->GetVoidPointer(0);
+  const int inType = inPts->GetDataType();
+  void *outPtr = outPts->GetData()->GetVoidPointer(0);
+  const int outType = outPts->GetDataType();
+
+  void *gridPtr = this->GridPointer;
+  int *extent = this->GridExtent;
+  vtkIdType *increments = this->GridIncrements;
+  const double scale = this->DisplacementScale;
+  const double (*matrix)[4] = this->OutputToGridIndexTransformMatrixCached->Element;
+
+  // outPoint = BulkTransformMatrix * inPointVector + displacementVector * scale
+  double bulk[3][4] = { { 1.0, 0.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0, 0.0 } };
+  if (this->BulkTransformMatrix)
+    {
+    for (int row = 0; row < 3; row++)
+      {
+      for (int col = 0; col < 4; col++)
+        {
+        bulk[row][col] = this->BulkTransformMatrix->Element[row][col];
+        }
+      }
+    }
+
+  // The points of a block are stored as a structure of arrays so that the
+  // loops without dependencies between points can be vectorized
+  const int blockSize = VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE;
+  double x[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double y[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double z[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double i[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double j[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double k[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double outX[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double outY[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+  double outZ[VTK_ORIENTED_BSPLINE_TRANSFORM_BLOCK_SIZE];
+
+  for (vtkIdType blockBegin = begin; blockBegin < end; blockBegin += blockSize)
+    {
+    const int n = static_cast<int>(std::min(static_cast<vtkIdType>(blockSize), end - blockBegin));
+    const vtkIdType outBlockBegin = outOffset + blockBegin - begin;
+
+    if (inType == VTK_FLOAT)
+      {
+      vtkOrientedBSplineTransformLoadPoints(static_cast<float*>(inPtr) + 3 * blockBegin, n, x, y, z);
+      }
+    else
+      {
+      vtkOrientedBSplineTransformLoadPoints(static_cast<double*>(inPtr) + 3 * blockBegin, n, x, y, z);
+      }
+
+    // Convert the points to i,j,k indices into the deformation grid
+    // plus fractions, and apply the bulk transform
+    for (int l = 0; l < n; l++)
+      {
+      i[l] = matrix[0][0] * x[l] + matrix[0][1] * y[l] + matrix[0][2] * z[l] + matrix[0][3];
+      j[l] = matrix[1][0] * x[l] + matrix[1][1] * y[l] + matrix[1][2] * z[l] + matrix[1][3];
+      k[l] = matrix[2][0] * x[l] + matrix[2][1] * y[l] + matrix[2][2] * z[l] + matrix[2][3];
+      outX[l] = bulk[0][0] * x[l] + bulk[0][1] * y[l] + bulk[0][2] * z[l] + bulk[0][3];
+      outY[l] = bulk[1][0] * x[l] + bulk[1][1] * y[l] + bulk[1][2] * z[l] + bulk[1][3];
+      outZ[l] = bulk[2][0] * x[l] + bulk[2][1] * y[l] + bulk[2][2] * z[l] + bulk[2][3];
+      }
+
+    // CalculateSpline is already specialized for the grid scalar type
+    for (int l = 0; l < n; l++)
+      {
+      double point[3] = { i[l], j[l], k[l] };
+      double displacement[3] = { 0.0, 0.0, 0.0 };
+      this->CalculateSpline(point, displacement, NULL,
+                            gridPtr, extent, increments, this->BorderMode);
+      outX[l] += displacement[0] * scale;
+      outY[l] += displacement[1] * scale;
+      outZ[l] += displacement[2] * scale;
+      }
+
+    if (outType == VTK_FLOAT)
+      {
+      vtkOrientedBSplineTransformStorePoints(outX, outY, outZ, n, static_cast<float*>(outPtr) + 3 * outBlockBegin);
+      }
+    else
+      {
+      vtkOrientedBSplineTransformStorePoints(outX, outY, outZ, n, static_cast<double*>(outPtr) + 3 * outBlockBegin);
+      }
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -263,6 +460,51 @@ void vtkOrientedBSplineTransform::InverseTransformDerivative(const double inPoin
     return;
     }
 
+  double interpolatedInverse[3];
+  bool interpolated = false;
+  if (this->InverseGridMode != vtkOrientedBSplineTransform::InverseGridOff)
+    {
+    int numberOfFailures = this->InverseGrid->Build(this->GridIndexToOutputTransformMatrixCached->Element,
+      this->GridExtent, vtkOrientedBSplineTransform::InverseGridFunction, this);
+    if (numberOfFailures > 0)
+      {
+      vtkWarningMacro("InverseTransformPoint: no convergence at " << numberOfFailures <<
+                      " nodes of the inverse grid.");
+      }
+    double inverseDerivative[3][3];
+    interpolated = this->InverseGrid->Interpolate(inPoint, interpolatedInverse,
+      this->InverseGridMode == vtkOrientedBSplineTransform::InverseGridInterpolate ? inverseDerivative : NULL);
+    if (interpolated && this->InverseGridMode == vtkOrientedBSplineTransform::InverseGridInterpolate)
+      {
+      // return the derivative of the forward transform at the inverse point,
+      // as Newton's method does
+      vtkMath::Invert3x3(inverseDerivative, derivative);
+      outPoint[0] = interpolatedInverse[0];
+      outPoint[1] = interpolatedInverse[1];
+      outPoint[2] = interpolatedInverse[2];
+      return;
+      }
+    }
+
+  double error = 0.0;
+  int iterations = 0;
+  if (!this->NewtonInverseTransformDerivative(inPoint, interpolated ? interpolatedInverse : NULL,
+                                              outPoint, derivative, &error, &iterations))
+    {
+    vtkWarningMacro("InverseTransformPoint: no convergence (" <<
+                    inPoint[0] << ", " << inPoint[1] << ", " << inPoint[2] <<
+                    ") error = " << error << " after " <<
+                    iterations << " iterations.");
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedBSplineTransform::NewtonInverseTransformDerivative(const double inPoint[3],
+                                                     const double* initialGuess,
+                                                     double outPoint[3],
+                                                     double derivative[3][3],
+                                                     double* error, int* iterations)
+{
   void *gridPtr = this->GridPointer;
   int *extent = this->GridExtent;
   vtkIdType *increments = this->GridIncrements;
@@ -282,22 +524,31 @@ void vtkOrientedBSplineTransform::InverseTransformDerivative(const double inPoin
   double f = 1.0;
   double a;
 
-  double inPoint_IJK[3];
-  // Convert the inPoint to i,j,k indices into the deformation grid
-  // plus fractions
-  vtkLinearTransformPoint(this->OutputToGridIndexTransformMatrixCached->Element, inPoint, inPoint_IJK);
-
-  // first guess at inverse_IJK point, just subtract displacement
-  // (the inverse point is given in i,j,k indices plus fractions)
-  this->CalculateSpline(inPoint_IJK, deltaP, 0,
-                        gridPtr, extent, increments, this->BorderMode);
+  if (initialGuess)
+    {
+    inverse[0] = initialGuess[0];
+    inverse[1] = initialGuess[1];
+    inverse[2] = initialGuess[2];
+    }
+  else
+    {
+    double inPoint_IJK[3];
+    // Convert the inPoint to i,j,k indices into the deformation grid
+    // plus fractions
+    vtkLinearTransformPoint(this->OutputToGridIndexTransformMatrixCached->Element, inPoint, inPoint_IJK);
+
+    // first guess at inverse_IJK point, just subtract displacement
+    // (the inverse point is given in i,j,k indices plus fractions)
+    this->CalculateSpline(inPoint_IJK, deltaP, 0,
+                          gridPtr, extent, increments, this->BorderMode);
 
-  double inverseBulkTransformedInPoint[3];
-  vtkLinearTransformPoint(this->InverseBulkTransformMatrixCached->Element,inPoint,inverseBulkTransformedInPoint);
+    double inverseBulkTransformedInPoint[3];
+    vtkLinearTransformPoint(this->InverseBulkTransformMatrixCached->Element,inPoint,inverseBulkTransformedInPoint);
 
-  inverse[0] = inverseBulkTransformedInPoint[0] - deltaP[0]*scale;
-  inverse[1] = inverseBulkTransformedInPoint[1] - deltaP[1]*scale;
-  inverse[2] = inverseBulkTransformedInPoint[2] - deltaP[2]*scale;
+    inverse[0] = inverseBulkTransformedInPoint[0] - deltaP[0]*scale;
+    inverse[1] = inverseBulkTransformedInPoint[1] - deltaP[1]*scale;
+    inverse[2] = inverseBulkTransformedInPoint[2] - deltaP[2]*scale;
+    }
   lastInverse[0] = inverse[0];
   lastInverse[1] = inverse[1];
   lastInverse[2] = inverse[2];
@@ -418,17 +669,22 @@ void vtkOrientedBSplineTransform::InverseTransformDerivative(const double inPoin
     inverse[2] = lastInverse[2] - f*deltaI[2];
     }
 
+  bool converged = true;
   if (iteration >= maxNumberOfIterations)
     {
     // didn't converge: back up to last good result
     inverse[0] = lastInverse[0];
     inverse[1] = lastInverse[1];
     inverse[2] = lastInverse[2];
-
-    vtkWarningMacro("InverseTransformPoint: no convergence (" <<
-                    inPoint[0] << ", " << inPoint[1] << ", " << inPoint[2] <<
-                    ") error = " << sqrt(errorSquared) << " after " <<
-                    iteration << " iterations.");
+    converged = false;
+    }
+  if (error)
+    {
+    *error = sqrt(errorSquared);
+    }
+  if (iterations)
+    {
+    *iterations = iteration;
     }
 
   // Convert the inPoint to i,j,k indices into the deformation grid
@@ -436,6 +692,16 @@ void vtkOrientedBSplineTransform::InverseTransformDerivative(const double inPoin
   outPoint[0] = inverse[0];
   outPoint[1] = inverse[1];
   outPoint[2] = inverse[2];
+
+  return converged;
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedBSplineTransform::InverseGridFunction(void* transform, const double in[3], double out[3])
+{
+  double derivative[3][3];
+  return static_cast<vtkOrientedBSplineTransform*>(transform)->NewtonInverseTransformDerivative(
+    in, NULL, out, derivative);
 }
 
 //----------------------------------------------------------------------------
@@ -444,6 +710,7 @@ void vtkOrientedBSplineTransform::InternalDeepCopy(vtkAbstractTransform *transfo
   vtkOrientedBSplineTransform *orientedBSplineTransform = (vtkOrientedBSplineTransform *)transform;
   this->SetGridDirectionMatrix(orientedBSplineTransform->GetGridDirectionMatrix());
   this->SetBulkTransformMatrix(orientedBSplineTransform ->GetBulkTransformMatrix());
+  this->SetInverseGridMode(orientedBSplineTransform->GetInverseGridMode());
 
   // Cached matrices will be recomputed automatically in InternalUpdate()
   // therefore we do not need to copy them.
@@ -485,6 +752,9 @@ void vtkOrientedBSplineTransform::InternalUpdate()
     {
     vtkMatrix4x4::Invert(this->BulkTransformMatrix, this->InverseBulkTransformMatrixCached);
     }
+
+  // The inverse grid is computed again when it is needed
+  this->InverseGrid->Invalidate();
 }
 
 //----------------------------------------------------------------------------
@@ -31,6 +31,8 @@
 
 #include "vtkBSplineTransform.h"
 
+class vtkOrientedTransformInverseGrid;
+
 class VTK_ADDON_EXPORT vtkOrientedBSplineTransform : public vtkBSplineTransform
 {
 public:
@@ -42,6 +44,19 @@ public:
   // Make another transform of the same type.
   vtkAbstractTransform *MakeTransform() VTK_OVERRIDE;
 
+  // Description:
+  // Apply the transformation to a series of points, and append the
+  // results to outPts. Forward transformation of large point sets is done
+  // on multiple threads, in blocks of points.
+  void TransformPoints(vtkPoints *inPts, vtkPoints *outPts) VTK_OVERRIDE;
+
+  // Description:
+  // Apply the forward transformation to the points [begin, end) of inPts
+  // and store them in outPts from outOffset. Called on each thread by
+  // TransformPoints(), the points must be float or double.
+  void ForwardTransformPoints(vtkPoints *inPts, vtkIdType begin, vtkIdType end,
+                              vtkPoints *outPts, vtkIdType outOffset);
+
   // Description:
   // Set/Get the b-spline grid axis directions.
   // This transform class will never modify the data.
@@ -56,6 +71,36 @@ public:
   virtual void SetBulkTransformMatrix(vtkMatrix4x4*);
   vtkGetObjectMacro(BulkTransformMatrix,vtkMatrix4x4);
 
+  enum InverseGridModes
+    {
+    InverseGridOff = 0,
+    InverseGridInitialGuess,
+    InverseGridInterpolate
+    };
+
+  // Description:
+  // Set/Get how the inverse transform uses a precomputed inverse grid.
+  // The inverse grid stores the inverse displacement at each node of the
+  // b-spline grid. It is computed on multiple threads by the first inverse
+  // computation after the transform is modified.
+  // InverseGridOff: no inverse grid, Newton's method starts from the point
+  // minus its displacement.
+  // InverseGridInitialGuess (default): Newton's method starts from the inverse
+  // interpolated in the inverse grid. The result is unchanged.
+  // InverseGridInterpolate: the inverse is interpolated in the inverse grid,
+  // Newton's method is only used outside of the grid. This is the fastest
+  // mode, but between grid nodes the inverse is only approximated (linear
+  // interpolation of the inverse displacement), b-spline grids are usually
+  // coarse.
+  vtkSetClampMacro(InverseGridMode, int, InverseGridOff, InverseGridInterpolate);
+  vtkGetMacro(InverseGridMode, int);
+  void SetInverseGridModeToOff()
+    { this->SetInverseGridMode(InverseGridOff); };
+  void SetInverseGridModeToInitialGuess()
+    { this->SetInverseGridMode(InverseGridInitialGuess); };
+  void SetInverseGridModeToInterpolate()
+    { this->SetInverseGridMode(InverseGridInterpolate); };
+
 protected:
   vtkOrientedBSplineTransform();
   ~vtkOrientedBSplineTransform();
@@ -81,6 +126,19 @@ protected:
                                   double derivative[3][3]) VTK_OVERRIDE;
   using Superclass::InverseTransformDerivative; // Inherit the float version from parent
 
+  // Description:
+  // Newton's method of InverseTransformDerivative, starting from initialGuess
+  // if it is not NULL. Returns false if it did not converge, out is then the
+  // best estimate, and sets the error and number of iterations if requested.
+  // It does not modify the transform and can be called from several threads.
+  bool NewtonInverseTransformDerivative(const double in[3], const double* initialGuess,
+                                        double out[3], double derivative[3][3],
+                                        double* error = NULL, int* iterations = NULL);
+
+  // Description:
+  // Inverse function used to build the inverse grid.
+  static bool InverseGridFunction(void* transform, const double in[3], double out[3]);
+
   // Description:
   // Grid axis direction vectors (i, j, k) in the output space
   vtkMatrix4x4* GridDirectionMatrix;
@@ -93,6 +151,9 @@ protected:
   vtkMatrix4x4* OutputToGridIndexTransformMatrixCached;
   vtkMatrix4x4* InverseBulkTransformMatrixCached;
 
+  int InverseGridMode;
+  vtkOrientedTransformInverseGrid* InverseGrid;
+
 private:
   vtkOrientedBSplineTransform(const vtkOrientedBSplineTransform&);  // Not implemented.
   void operator=(const vtkOrientedBSplineTransform&);  // Not implemented.
@@ -8,11 +8,22 @@
 =========================================================================auto=*/
 
 #include "vtkOrientedGridTransform.h"
+#include "vtkOrientedTransformInverseGrid.h"
 
 #include "vtkMath.h"
 #include "vtkMatrix4x4.h"
+#include "vtkMultiThreader.h"
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
+#include "vtkPoints.h"
+
+#include <algorithm>
+
+// Number of points transformed together by ForwardTransformPoints
+#define VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE 64
+
+// Smallest number of points worth a thread in TransformPoints
+#define VTK_ORIENTED_GRID_TRANSFORM_POINTS_PER_THREAD 4096
 
 vtkStandardNewMacro(vtkOrientedGridTransform);
 
@@ -26,6 +37,9 @@ vtkOrientedGridTransform::vtkOrientedGridTransform()
   this->OutputToGridIndexTransformMatrixCached = vtkMatrix4x4::New();
 
   this->LastWarningMTime = 0;
+
+  this->InverseGridMode = vtkOrientedGridTransform::InverseGridInitialGuess;
+  this->InverseGrid = new vtkOrientedTransformInverseGrid;
 }
 
 //----------------------------------------------------------------------------
@@ -42,6 +56,8 @@ vtkOrientedGridTransform::~vtkOrientedGridTransform()
     this->OutputToGridIndexTransformMatrixCached->Delete();
     this->OutputToGridIndexTransformMatrixCached = NULL;
     }
+  delete this->InverseGrid;
+  this->InverseGrid = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -54,6 +70,8 @@ void vtkOrientedGridTransform::PrintSelf(ostream& os, vtkIndent indent)
     {
     this->GridDirectionMatrix->PrintSelf(os,indent.GetNextIndent());
     }
+  os << indent << "InverseGridMode: " << this->InverseGridMode << "\n";
+  os << indent << "InverseGridMemorySize: " << this->InverseGrid->GetMemorySize() << "\n";
 }
 
 //------------------------------------------------------------------------
@@ -97,6 +115,267 @@ inline void vtkLinearTransformJacobian(double aMat[3][3], double bMat[4][4], dou
     }
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct vtkOrientedGridTransformPointsInfo
+{
+  vtkOrientedGridTransform* Transform;
+  vtkPoints* InPoints;
+  vtkPoints* OutPoints;
+  vtkIdType OutOffset;
+  vtkIdType NumberOfPoints;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkOrientedGridTransformPointsThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkOrientedGridTransformPointsInfo* info =
+    static_cast<vtkOrientedGridTransformPointsInfo*>(threadInfo->UserData);
+  const vtkIdType begin = info->NumberOfPoints * threadInfo->ThreadID / threadInfo->NumberOfThreads;
+  const vtkIdType end = info->NumberOfPoints * (threadInfo->ThreadID + 1) / threadInfo->NumberOfThreads;
+  info->Transform->ForwardTransformPoints(info->InPoints, begin, end,
+                                          info->OutPoints, info->OutOffset + begin);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkOrientedGridTransformLoadPoints(const T* points, int n, double* x, double* y, double* z)
+{
+  for (int l = 0; l < n; l++)
+    {
+    x[l] = static_cast<double>(points[3 * l]);
+    y[l] = static_cast<double>(points[3 * l + 1]);
+    z[l] = static_cast<double>(points[3 * l + 2]);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void vtkOrientedGridTransformStorePoints(const double* x, const double* y, const double* z, int n, T* points)
+{
+  for (int l = 0; l < n; l++)
+    {
+    points[3 * l] = static_cast<T>(x[l]);
+    points[3 * l + 1] = static_cast<T>(y[l]);
+    points[3 * l + 2] = static_cast<T>(z[l]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Linear interpolation of the displacement of n points given as grid
+// indices. Same as the linear interpolation of vtkGridTransform: points
+// outside of the grid get the displacement of the closest grid boundary.
+template <class T>
+void vtkOrientedGridTransformLinear(const T* gridPtr, const int gridExt[6], const vtkIdType gridInc[3],
+                                    int n, const double* i, const double* j, const double* k,
+                                    double* dx, double* dy, double* dz)
+{
+  const int ext[3] = { gridExt[1] - gridExt[0], gridExt[3] - gridExt[2], gridExt[5] - gridExt[4] };
+  for (int l = 0; l < n; l++)
+    {
+    const double point[3] = { i[l], j[l], k[l] };
+    double f[3];
+    vtkIdType factor0[3];
+    vtkIdType factor1[3];
+    for (int axis = 0; axis < 3; axis++)
+      {
+      const int floor = vtkMath::Floor(point[axis]);
+      f[axis] = point[axis] - floor;
+      int gridId0 = floor - gridExt[2 * axis];
+      int gridId1 = gridId0 + 1;
+      if (gridId0 < 0)
+        {
+        gridId0 = 0;
+        gridId1 = 0;
+        f[axis] = 0;
+        }
+      else if (gridId1 > ext[axis])
+        {
+        gridId0 = ext[axis];
+        gridId1 = ext[axis];
+        f[axis] = 0;
+        }
+      factor0[axis] = gridId0 * gridInc[axis];
+      factor1[axis] = gridId1 * gridInc[axis];
+      }
+
+    const double rx = 1 - f[0];
+    const double ry = 1 - f[1];
+    const double rz = 1 - f[2];
+    const double ryrz = ry * rz;
+    const double ryfz = ry * f[2];
+    const double fyrz = f[1] * rz;
+    const double fyfz = f[1] * f[2];
+    const double rxryrz = rx * ryrz;
+    const double rxryfz = rx * ryfz;
+    const double rxfyrz = rx * fyrz;
+    const double rxfyfz = rx * fyfz;
+    const double fxryrz = f[0] * ryrz;
+    const double fxryfz = f[0] * ryfz;
+    const double fxfyrz = f[0] * fyrz;
+    const double fxfyfz = f[0] * fyfz;
+
+    const T* p000 = gridPtr + factor0[0] + factor0[1] + factor0[2];
+    const T* p001 = gridPtr + factor0[0] + factor0[1] + factor1[2];
+    const T* p010 = gridPtr + factor0[0] + factor1[1] + factor0[2];
+    const T* p011 = gridPtr + factor0[0] + factor1[1] + factor1[2];
+    const T* p100 = gridPtr + factor1[0] + factor0[1] + factor0[2];
+    const T* p101 = gridPtr + factor1[0] + factor0[1] + factor1[2];
+    const T* p110 = gridPtr + factor1[0] + factor1[1] + factor0[2];
+    const T* p111 = gridPtr + factor1[0] + factor1[1] + factor1[2];
+
+    double displacement[3];
+    for (int c = 0; c < 3; c++)
+      {
+      displacement[c] = (rxryrz * p000[c] + rxryfz * p001[c] +
+                         rxfyrz * p010[c] + rxfyfz * p011[c] +
+                         fxryrz * p100[c] + fxryfz * p101[c] +
+                         fxfyrz * p110[c] + fxfyfz * p111[c]);
+      }
+    dx[l] = displacement[0];
+    dy[l] = displacement[1];
+    dz[l] = displacement[2];
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+void vtkOrientedGridTransform::TransformPoints(vtkPoints *inPts, vtkPoints *outPts)
+{
+  this->Update();
+
+  const int inType = inPts->GetDataType();
+  const int outType = outPts->GetDataType();
+  if (this->InverseFlag || this->GridDirectionMatrix == NULL || this->GridPointer == NULL
+    || inPts == outPts
+    || (inType != VTK_FLOAT && inType != VTK_DOUBLE)
+    || (outType != VTK_FLOAT && outType != VTK_DOUBLE))
+    {
+    this->Superclass::TransformPoints(inPts, outPts);
+    return;
+    }
+
+  const vtkIdType numberOfPoints = inPts->GetNumberOfPoints();
+  const vtkIdType outOffset = outPts->GetNumberOfPoints();
+  outPts->SetNumberOfPoints(outOffset + numberOfPoints);
+
+  vtkOrientedGridTransformPointsInfo info;
+  info.Transform = this;
+  info.InPoints = inPts;
+  info.OutPoints = outPts;
+  info.OutOffset = outOffset;
+  info.NumberOfPoints = numberOfPoints;
+
+  vtkNew<vtkMultiThreader> threader;
+  const vtkIdType maxNumberOfThreads = numberOfPoints / VTK_ORIENTED_GRID_TRANSFORM_POINTS_PER_THREAD + 1;
+  threader->SetNumberOfThreads(static_cast<int>(
+    std::min(static_cast<vtkIdType>(threader->GetNumberOfThreads()), maxNumberOfThreads)));
+  threader->SetSingleMethod(vtkOrientedGridTransformPointsThread, &info);
+  threader->SingleMethodExecute();
+
+  outPts->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedGridTransform::ForwardTransformPoints(vtkPoints *inPts, vtkIdType begin, vtkIdType end,
+                                                      vtkPoints *outPts, vtkIdType outOffset)
+{
+  void *inPtr = inPts->GetData()->GetVoidPointer(0);
+  const int inType = inPts->GetDataType();
+  void *outPtr = outPts->GetData()->GetVoidPointer(0);
+  const int outType = outPts->GetDataType();
+
+  void *gridPtr = this->GridPointer;
+  int gridType = this->GridScalarType;
+  int *extent = this->GridExtent;
+  vtkIdType *increments = this->GridIncrements;
+
+  const double scale = this->DisplacementScale;
+  const double shift = this->DisplacementShift;
+  const double (*matrix)[4] = this->OutputToGridIndexTransformMatrixCached->Element;
+
+  // The points of a block are stored as a structure of arrays so that the
+  // loops without dependencies between points can be vectorized
+  const int blockSize = VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE;
+  double x[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double y[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double z[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double i[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double j[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double k[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double dx[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double dy[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+  double dz[VTK_ORIENTED_GRID_TRANSFORM_BLOCK_SIZE];
+
+  for (vtkIdType blockBegin = begin; blockBegin < end; blockBegin += blockSize)
+    {
+    const int n = static_cast<int>(std::min(static_cast<vtkIdType>(blockSize), end - blockBegin));
+    const vtkIdType outBlockBegin = outOffset + blockBegin - begin;
+
+    if (inType == VTK_FLOAT)
+      {
+      vtkOrientedGridTransformLoadPoints(static_cast<float*>(inPtr) + 3 * blockBegin, n, x, y, z);
+      }
+    else
+      {
+      vtkOrientedGridTransformLoadPoints(static_cast<double*>(inPtr) + 3 * blockBegin, n, x, y, z);
+      }
+
+    // Convert the points to i,j,k indices into the deformation grid
+    // plus fractions
+    for (int l = 0; l < n; l++)
+      {
+      i[l] = matrix[0][0] * x[l] + matrix[0][1] * y[l] + matrix[0][2] * z[l] + matrix[0][3];
+      j[l] = matrix[1][0] * x[l] + matrix[1][1] * y[l] + matrix[1][2] * z[l] + matrix[1][3];
+      k[l] = matrix[2][0] * x[l] + matrix[2][1] * y[l] + matrix[2][2] * z[l] + matrix[2][3];
+      }
+
+    if (this->InterpolationMode == VTK_GRID_LINEAR)
+      {
+      switch (gridType)
+        {
+        vtkTemplateMacro(vtkOrientedGridTransformLinear(static_cast<VTK_TT*>(gridPtr), extent, increments,
+                                                        n, i, j, k, dx, dy, dz));
+        }
+      }
+    else
+      {
+      for (int l = 0; l < n; l++)
+        {
+        double point[3] = { i[l], j[l], k[l] };
+        double displacement[3];
+        this->InterpolationFunction(point, displacement, NULL,
+                                    gridPtr, gridType, extent, increments);
+        dx[l] = displacement[0];
+        dy[l] = displacement[1];
+        dz[l] = displacement[2];
+        }
+      }
+
+    for (int l = 0; l < n; l++)
+      {
+      x[l] += dx[l] * scale + shift;
+      y[l] += dy[l] * scale + shift;
+      z[l] += dz[l] * scale + shift;
+      }
+
+    if (outType == VTK_FLOAT)
+      {
+      vtkOrientedGridTransformStorePoints(x, y, z, n, static_cast<float*>(outPtr) + 3 * outBlockBegin);
+      }
+    else
+      {
+      vtkOrientedGridTransformStorePoints(x, y, z, n, static_cast<double*>(outPtr) + 3 * outBlockBegin);
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkOrientedGridTransform::ForwardTransformPoint(const double inPoint[3],
                                              double outPoint[3])
@@ -185,6 +464,63 @@ void vtkOrientedGridTransform::InverseTransformDerivative(const double inPoint[3
     return;
     }
 
+  double interpolatedInverse[3];
+  bool interpolated = false;
+  if (this->InverseGridMode != vtkOrientedGridTransform::InverseGridOff)
+    {
+    int numberOfFailures = this->InverseGrid->Build(this->GridIndexToOutputTransformMatrixCached->Element,
+      this->GridExtent, vtkOrientedGridTransform::InverseGridFunction, this);
+    if (numberOfFailures > 0)
+      {
+      if (this->MTime > this->LastWarningMTime)
+        {
+        vtkWarningMacro("InverseTransformPoint: no convergence at " << numberOfFailures <<
+                        " nodes of the inverse grid."
+                        "  Further convergence warnings suppressed until transform is modified.");
+        this->LastWarningMTime = this->MTime;
+        }
+      this->InvokeEvent(vtkOrientedGridTransform::ConvergenceFailureEvent);
+      }
+    double inverseDerivative[3][3];
+    interpolated = this->InverseGrid->Interpolate(inPoint, interpolatedInverse,
+      this->InverseGridMode == vtkOrientedGridTransform::InverseGridInterpolate ? inverseDerivative : NULL);
+    if (interpolated && this->InverseGridMode == vtkOrientedGridTransform::InverseGridInterpolate)
+      {
+      // return the derivative of the forward transform at the inverse point,
+      // as Newton's method does
+      vtkMath::Invert3x3(inverseDerivative, derivative);
+      outPoint[0] = interpolatedInverse[0];
+      outPoint[1] = interpolatedInverse[1];
+      outPoint[2] = interpolatedInverse[2];
+      return;
+      }
+    }
+
+  double error = 0.0;
+  int iterations = 0;
+  if (!this->NewtonInverseTransformDerivative(inPoint, interpolated ? interpolatedInverse : NULL,
+                                              outPoint, derivative, &error, &iterations))
+    {
+    if (this->MTime > this->LastWarningMTime)
+      {
+      vtkWarningMacro("InverseTransformPoint: no convergence (" <<
+                      inPoint[0] << ", " << inPoint[1] << ", " << inPoint[2] <<
+                      ") error = " << error << " after " <<
+                      iterations << " iterations."
+                      "  Further convergence warnings suppressed until transform is modified.");
+      this->LastWarningMTime = this->MTime;
+      }
+    this->InvokeEvent(vtkOrientedGridTransform::ConvergenceFailureEvent);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedGridTransform::NewtonInverseTransformDerivative(const double inPoint[3],
+                                                  const double* initialGuess,
+                                                  double outPoint[3],
+                                                  double derivative[3][3],
+                                                  double* error, int* iterations)
+{
   void *gridPtr = this->GridPointer;
   int gridType = this->GridScalarType;
 
@@ -208,17 +544,26 @@ void vtkOrientedGridTransform::InverseTransformDerivative(const double inPoint[3
   double f = 1.0;
   double a;
 
-  // convert the inPoint to i,j,k indices plus fractions
-  vtkLinearTransformPoint(this->OutputToGridIndexTransformMatrixCached->Element, inPoint, point);
+  if (initialGuess)
+    {
+    inverse[0] = initialGuess[0];
+    inverse[1] = initialGuess[1];
+    inverse[2] = initialGuess[2];
+    }
+  else
+    {
+    // convert the inPoint to i,j,k indices plus fractions
+    vtkLinearTransformPoint(this->OutputToGridIndexTransformMatrixCached->Element, inPoint, point);
 
-  // first guess at inverse point, just subtract displacement
-  // (the inverse point is given in i,j,k indices plus fractions)
-  this->InterpolationFunction(point, deltaP, NULL,
-                              gridPtr, gridType, extent, increments);
+    // first guess at inverse point, just subtract displacement
+    // (the inverse point is given in i,j,k indices plus fractions)
+    this->InterpolationFunction(point, deltaP, NULL,
+                                gridPtr, gridType, extent, increments);
 
-  inverse[0] = inPoint[0] - (deltaP[0]*scale + shift);
-  inverse[1] = inPoint[1] - (deltaP[1]*scale + shift);
-  inverse[2] = inPoint[2] - (deltaP[2]*scale + shift);
+    inverse[0] = inPoint[0] - (deltaP[0]*scale + shift);
+    inverse[1] = inPoint[1] - (deltaP[1]*scale + shift);
+    inverse[2] = inPoint[2] - (deltaP[2]*scale + shift);
+    }
   lastInverse[0] = inverse[0];
   lastInverse[1] = inverse[1];
   lastInverse[2] = inverse[2];
@@ -317,29 +662,38 @@ void vtkOrientedGridTransform::InverseTransformDerivative(const double inPoint[3
 
   vtkDebugMacro("Inverse Iterations: " << (i+1));
 
+  bool converged = true;
   if (i >= n)
     {
     // didn't converge: back up to last good result
     inverse[0] = lastInverse[0];
     inverse[1] = lastInverse[1];
     inverse[2] = lastInverse[2];
-
-    if (this->MTime > this->LastWarningMTime)
-      {
-      vtkWarningMacro("InverseTransformPoint: no convergence (" <<
-                      inPoint[0] << ", " << inPoint[1] << ", " << inPoint[2] <<
-                      ") error = " << sqrt(errorSquared) << " after " <<
-                      i << " iterations."
-                      "  Further convergence warnings suppressed until transform is modified.");
-      this->LastWarningMTime = this->MTime;
-      }
-    this->InvokeEvent(vtkOrientedGridTransform::ConvergenceFailureEvent);
+    converged = false;
+    }
+  if (error)
+    {
+    *error = sqrt(errorSquared);
+    }
+  if (iterations)
+    {
+    *iterations = i;
     }
 
   // convert point
   outPoint[0] = inverse[0];
   outPoint[1] = inverse[1];
   outPoint[2] = inverse[2];
+
+  return converged;
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedGridTransform::InverseGridFunction(void* transform, const double in[3], double out[3])
+{
+  double derivative[3][3];
+  return static_cast<vtkOrientedGridTransform*>(transform)->NewtonInverseTransformDerivative(
+    in, NULL, out, derivative);
 }
 
 //----------------------------------------------------------------------------
@@ -348,9 +702,10 @@ void vtkOrientedGridTransform::InternalDeepCopy(vtkAbstractTransform *transform)
   vtkOrientedGridTransform *gridTransform = (vtkOrientedGridTransform *)transform;
 
   this->SetGridDirectionMatrix(gridTransform->GetGridDirectionMatrix());
+  this->SetInverseGridMode(gridTransform->GetInverseGridMode());
 
-  // Cached matrices will be recomputed automatically in InternalUpdate()
-  // therefore we do not need to copy them.
+  // Cached matrices and inverse grid will be recomputed automatically after
+  // InternalUpdate() therefore we do not need to copy them.
 
   this->Superclass::InternalDeepCopy(transform);
 }
@@ -385,6 +740,8 @@ void vtkOrientedGridTransform::InternalUpdate()
   // Compute Output to GridIndex transform
   vtkMatrix4x4::Invert(this->GridIndexToOutputTransformMatrixCached, this->OutputToGridIndexTransformMatrixCached);
 
+  // The inverse grid is computed again when it is needed
+  this->InverseGrid->Invalidate();
 }
 
 //----------------------------------------------------------------------------
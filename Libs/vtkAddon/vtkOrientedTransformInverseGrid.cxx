@@ -0,0 +1,272 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+#include "vtkOrientedTransformInverseGrid.h"
+
+#include "vtkMatrix4x4.h"
+#include "vtkNew.h"
+
+#include <math.h>
+
+//----------------------------------------------------------------------------
+struct vtkOrientedTransformInverseGrid::BuildInfo
+{
+  vtkOrientedTransformInverseGrid* Self;
+  double GridIndexToOutput[4][4];
+  InverseFunctionType InverseFunction;
+  void* Transform;
+  // Number of nodes that did not converge, per thread
+  std::vector<int> NumberOfFailures;
+};
+
+//----------------------------------------------------------------------------
+vtkOrientedTransformInverseGrid::vtkOrientedTransformInverseGrid()
+{
+  this->Built.Store(0);
+  for (int i = 0; i < 6; i++)
+    {
+    this->Extent[i] = 0;
+    }
+  for (int i = 0; i < 3; i++)
+    {
+    this->Increments[i] = 0;
+    for (int j = 0; j < 4; j++)
+      {
+      this->OutputToGridIndex[i][j] = (i == j ? 1.0 : 0.0);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkOrientedTransformInverseGrid::~vtkOrientedTransformInverseGrid()
+{
+}
+
+//----------------------------------------------------------------------------
+// Each thread computes the inverse at every NumberOfThreads-th slice of the
+// lattice. Interleaving the slices balances the work when the transform is
+// harder to invert in some regions.
+VTK_THREAD_RETURN_TYPE vtkOrientedTransformInverseGrid::BuildThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BuildInfo* info = static_cast<BuildInfo*>(threadInfo->UserData);
+  vtkOrientedTransformInverseGrid* self = info->Self;
+  const int* extent = self->Extent;
+  float* displacements = &self->Displacements[0];
+
+  int numberOfFailures = 0;
+  for (int k = extent[4] + threadInfo->ThreadID; k <= extent[5]; k += threadInfo->NumberOfThreads)
+    {
+    for (int j = extent[2]; j <= extent[3]; j++)
+      {
+      float* nodeDisplacement = displacements
+        + 3 * ((k - extent[4]) * self->Increments[2] + (j - extent[2]) * self->Increments[1]);
+      for (int i = extent[0]; i <= extent[1]; i++, nodeDisplacement += 3)
+        {
+        const double node_IJK[3] = { static_cast<double>(i), static_cast<double>(j), static_cast<double>(k) };
+        double node[3];
+        for (int row = 0; row < 3; row++)
+          {
+          node[row] = info->GridIndexToOutput[row][0] * node_IJK[0]
+            + info->GridIndexToOutput[row][1] * node_IJK[1]
+            + info->GridIndexToOutput[row][2] * node_IJK[2]
+            + info->GridIndexToOutput[row][3];
+          }
+        double inverse[3];
+        if (!info->InverseFunction(info->Transform, node, inverse))
+          {
+          numberOfFailures++;
+          }
+        nodeDisplacement[0] = static_cast<float>(inverse[0] - node[0]);
+        nodeDisplacement[1] = static_cast<float>(inverse[1] - node[1]);
+        nodeDisplacement[2] = static_cast<float>(inverse[2] - node[2]);
+        }
+      }
+    }
+  info->NumberOfFailures[threadInfo->ThreadID] = numberOfFailures;
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+int vtkOrientedTransformInverseGrid::Build(const double gridIndexToOutput[4][4], const int extent[6],
+                                           InverseFunctionType inverseFunction, void* transform)
+{
+  if (this->Built.Load())
+    {
+    return 0;
+    }
+  this->BuildLock.Lock();
+  if (this->Built.Load())
+    {
+    // another thread built the grid while this one was waiting
+    this->BuildLock.Unlock();
+    return 0;
+    }
+
+  int numberOfFailures = 0;
+  vtkIdType numberOfNodes = 1;
+  for (int i = 0; i < 3; i++)
+    {
+    this->Extent[2 * i] = extent[2 * i];
+    this->Extent[2 * i + 1] = extent[2 * i + 1];
+    this->Increments[i] = numberOfNodes;
+    numberOfNodes *= (extent[2 * i + 1] - extent[2 * i] + 1);
+    }
+  if (numberOfNodes > 0)
+    {
+    double outputToGridIndex[4][4];
+    vtkMatrix4x4::Invert(&gridIndexToOutput[0][0], &outputToGridIndex[0][0]);
+    for (int row = 0; row < 3; row++)
+      {
+      for (int col = 0; col < 4; col++)
+        {
+        this->OutputToGridIndex[row][col] = outputToGridIndex[row][col];
+        }
+      }
+    this->Displacements.resize(3 * numberOfNodes);
+
+    BuildInfo info;
+    info.Self = this;
+    for (int row = 0; row < 4; row++)
+      {
+      for (int col = 0; col < 4; col++)
+        {
+        info.GridIndexToOutput[row][col] = gridIndexToOutput[row][col];
+        }
+      }
+    info.InverseFunction = inverseFunction;
+    info.Transform = transform;
+
+    vtkNew<vtkMultiThreader> threader;
+    int numberOfThreads = threader->GetNumberOfThreads();
+    if (numberOfThreads > extent[5] - extent[4] + 1)
+      {
+      numberOfThreads = extent[5] - extent[4] + 1;
+      }
+    threader->SetNumberOfThreads(numberOfThreads);
+    info.NumberOfFailures.resize(numberOfThreads, 0);
+    threader->SetSingleMethod(vtkOrientedTransformInverseGrid::BuildThread, &info);
+    threader->SingleMethodExecute();
+
+    for (int i = 0; i < numberOfThreads; i++)
+      {
+      numberOfFailures += info.NumberOfFailures[i];
+      }
+    this->Built.Store(1);
+    }
+
+  this->BuildLock.Unlock();
+  return numberOfFailures;
+}
+
+//----------------------------------------------------------------------------
+void vtkOrientedTransformInverseGrid::Invalidate()
+{
+  this->BuildLock.Lock();
+  this->Built.Store(0);
+  // release the memory
+  std::vector<float>().swap(this->Displacements);
+  this->BuildLock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkOrientedTransformInverseGrid::Interpolate(const double point[3], double inverse[3],
+                                                  double derivative[3][3]) const
+{
+  if (!this->Built.Load())
+    {
+    return false;
+    }
+
+  // Lattice cell containing the point and position of the point in the cell
+  vtkIdType offset = 0;
+  vtkIdType nextIncrement[3];
+  double fraction[3];
+  for (int axis = 0; axis < 3; axis++)
+    {
+    const double index = this->OutputToGridIndex[axis][0] * point[0]
+      + this->OutputToGridIndex[axis][1] * point[1]
+      + this->OutputToGridIndex[axis][2] * point[2]
+      + this->OutputToGridIndex[axis][3] - this->Extent[2 * axis];
+    const int lastIndex = this->Extent[2 * axis + 1] - this->Extent[2 * axis];
+    // the negated comparisons reject NaN as well
+    if (!(index >= 0.0) || !(index <= lastIndex))
+      {
+      return false;
+      }
+    int baseIndex = static_cast<int>(floor(index));
+    if (baseIndex >= lastIndex)
+      {
+      // on the last node, or single node along this axis
+      baseIndex = (lastIndex > 0 ? lastIndex - 1 : 0);
+      }
+    fraction[axis] = index - baseIndex;
+    offset += baseIndex * this->Increments[axis];
+    nextIncrement[axis] = (lastIndex > 0 ? 3 * this->Increments[axis] : 0);
+    }
+
+  const float* d000 = &this->Displacements[3 * offset];
+  const float* d100 = d000 + nextIncrement[0];
+  const float* d010 = d000 + nextIncrement[1];
+  const float* d110 = d010 + nextIncrement[0];
+  const float* d001 = d000 + nextIncrement[2];
+  const float* d101 = d001 + nextIncrement[0];
+  const float* d011 = d001 + nextIncrement[1];
+  const float* d111 = d011 + nextIncrement[0];
+
+  const double fx = fraction[0], fy = fraction[1], fz = fraction[2];
+  const double rx = 1.0 - fx, ry = 1.0 - fy, rz = 1.0 - fz;
+
+  double displacement[3];
+  double displacementDerivative_IJK[3][3];
+  for (int c = 0; c < 3; c++)
+    {
+    const double v00 = rx * d000[c] + fx * d100[c];
+    const double v10 = rx * d010[c] + fx * d110[c];
+    const double v01 = rx * d001[c] + fx * d101[c];
+    const double v11 = rx * d011[c] + fx * d111[c];
+    const double v0 = ry * v00 + fy * v10;
+    const double v1 = ry * v01 + fy * v11;
+    displacement[c] = rz * v0 + fz * v1;
+    if (derivative)
+      {
+      displacementDerivative_IJK[c][0] =
+        rz * (ry * (d100[c] - d000[c]) + fy * (d110[c] - d010[c]))
+        + fz * (ry * (d101[c] - d001[c]) + fy * (d111[c] - d011[c]));
+      displacementDerivative_IJK[c][1] = rz * (v10 - v00) + fz * (v11 - v01);
+      displacementDerivative_IJK[c][2] = v1 - v0;
+      }
+    }
+
+  if (derivative)
+    {
+    // chain rule with the output to grid index transform
+    for (int row = 0; row < 3; row++)
+      {
+      for (int col = 0; col < 3; col++)
+        {
+        derivative[row][col] = (row == col ? 1.0 : 0.0)
+          + displacementDerivative_IJK[row][0] * this->OutputToGridIndex[0][col]
+          + displacementDerivative_IJK[row][1] * this->OutputToGridIndex[1][col]
+          + displacementDerivative_IJK[row][2] * this->OutputToGridIndex[2][col];
+        }
+      }
+    }
+
+  inverse[0] = point[0] + displacement[0];
+  inverse[1] = point[1] + displacement[1];
+  inverse[2] = point[2] + displacement[2];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkOrientedTransformInverseGrid::GetMemorySize() const
+{
+  return this->Displacements.size() * sizeof(float);
+}
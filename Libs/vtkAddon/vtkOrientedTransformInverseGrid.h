@@ -0,0 +1,89 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+/// \brief vtkOrientedTransformInverseGrid - sampled inverse of a warp transform.
+///
+/// Helper class of vtkOrientedGridTransform and vtkOrientedBSplineTransform.
+/// The inverse of the transform is computed at each node of an oriented
+/// lattice (the lattice of the forward grid) on multiple threads and stored
+/// as a displacement field: inverse(p) - p. The inverse of any point of the
+/// lattice is then interpolated trilinearly, which is orders of magnitude
+/// faster than an iterative inversion.
+///
+/// Build() is thread-safe: the first caller builds the grid while the others
+/// wait, and the grid is not rebuilt until Invalidate() is called.
+
+#ifndef __vtkOrientedTransformInverseGrid_h
+#define __vtkOrientedTransformInverseGrid_h
+
+#include "vtkAddon.h"
+
+#include <vtkAtomic.h>
+#include <vtkMultiThreader.h>
+#include <vtkSimpleCriticalSection.h>
+
+#include <vector>
+
+class VTK_ADDON_EXPORT vtkOrientedTransformInverseGrid
+{
+public:
+  /// Compute in \a out the inverse of \a in with the iterative method of the
+  /// transform and return false if it did not converge.
+  /// It is called from several threads at once.
+  typedef bool (*InverseFunctionType)(void* transform, const double in[3], double out[3]);
+
+  vtkOrientedTransformInverseGrid();
+  ~vtkOrientedTransformInverseGrid();
+
+  /// Build the grid if it is not already built: one node per voxel of
+  /// \a extent, mapped to the output space by \a gridIndexToOutput.
+  /// Returns the number of nodes where \a inverseFunction did not converge
+  /// if the grid was built by this call, 0 otherwise.
+  int Build(const double gridIndexToOutput[4][4], const int extent[6],
+            InverseFunctionType inverseFunction, void* transform);
+
+  /// Discard the grid, the next call to Build() computes it again.
+  /// Must not be called while other threads use the grid.
+  void Invalidate();
+
+  /// Return true if the grid is built.
+  bool IsBuilt() const { return this->Built.Load() != 0; }
+
+  /// Interpolate the inverse of \a point and optionally its derivative
+  /// (derivative of the inverse transform).
+  /// Returns false if the grid is not built or if the point is outside of
+  /// the lattice, in that case the outputs are not modified.
+  bool Interpolate(const double point[3], double inverse[3], double derivative[3][3]) const;
+
+  /// Number of bytes used by the grid.
+  size_t GetMemorySize() const;
+
+protected:
+  struct BuildInfo;
+  static VTK_THREAD_RETURN_TYPE BuildThread(void* arg);
+
+  // Non-zero once the displacements are computed. It is stored last, with
+  // a memory barrier, so that Build() and Interpolate() can check it without
+  // locking and then safely read the grid.
+  vtkAtomic<int> Built;
+
+  vtkSimpleCriticalSection BuildLock;
+
+  int Extent[6];
+  vtkIdType Increments[3];
+  double OutputToGridIndex[3][4];
+  // Displacements are stored in single precision, as in most grids
+  std::vector<float> Displacements;
+
+private:
+  vtkOrientedTransformInverseGrid(const vtkOrientedTransformInverseGrid&);  // Not implemented.
+  void operator=(const vtkOrientedTransformInverseGrid&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,212 @@
+// vtkITK includes
+#include <itkTimeSeriesDatabase.h>
+
+// ITK includes
+#include <itkConfigure.h>
+#include <itkFactoryRegistration.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+typedef itk::TimeSeriesDatabase<short> DatabaseType;
+typedef DatabaseType::OutputImageType  ImageType;
+
+// Larger than one block (16 voxels) along each axis so that the images are
+// split in partial and full blocks
+const unsigned int IMAGE_SIZE[3] = { 20, 18, 33 };
+const unsigned int NUMBER_OF_VOLUMES = 3;
+
+//----------------------------------------------------------------------------
+short ExpectedValue(const ImageType::IndexType& idx, unsigned int volume)
+{
+  return static_cast<short>(idx[0] + 20 * idx[1] + 360 * idx[2] + 10000 * volume);
+}
+
+//----------------------------------------------------------------------------
+std::string VolumeFileName(const std::string& tempDir, unsigned int volume)
+{
+  std::ostringstream fileName;
+  fileName << tempDir << "/TimeSeriesDatabaseVolume_00" << volume + 1 << ".nrrd";
+  return fileName.str();
+}
+
+//----------------------------------------------------------------------------
+bool WriteVolumes(const std::string& tempDir)
+{
+  ImageType::RegionType region;
+  region.SetSize(0, IMAGE_SIZE[0]);
+  region.SetSize(1, IMAGE_SIZE[1]);
+  region.SetSize(2, IMAGE_SIZE[2]);
+  for (unsigned int volume = 0; volume < NUMBER_OF_VOLUMES; ++volume)
+    {
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->Allocate();
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      it.Set(ExpectedValue(it.GetIndex(), volume));
+      }
+    itk::ImageFileWriter<ImageType>::Pointer writer = itk::ImageFileWriter<ImageType>::New();
+    writer->SetFileName(VolumeFileName(tempDir, volume));
+    writer->SetInput(image);
+    try
+      {
+      writer->Update();
+      }
+    catch (itk::ExceptionObject& err)
+      {
+      std::cerr << "Unable to write " << VolumeFileName(tempDir, volume) << ": " << err << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestDatabase(const std::string& databaseFileName, bool useMemoryMapping)
+{
+  DatabaseType::Pointer database = DatabaseType::New();
+  database->SetUseMemoryMapping(useMemoryMapping);
+  database->Connect(databaseFileName.c_str());
+  if (database->GetNumberOfVolumes() != static_cast<int>(NUMBER_OF_VOLUMES))
+    {
+    std::cerr << "Line " << __LINE__ << ": " << database->GetNumberOfVolumes()
+              << " volumes, expected " << NUMBER_OF_VOLUMES << std::endl;
+    return false;
+    }
+
+  // GenerateData
+  for (unsigned int volume = 0; volume < NUMBER_OF_VOLUMES; ++volume)
+    {
+    database->SetCurrentImage(volume);
+    database->Update();
+    ImageType* output = database->GetOutput();
+    for (unsigned int axis = 0; axis < 3; ++axis)
+      {
+      if (output->GetBufferedRegion().GetSize(axis) != IMAGE_SIZE[axis])
+        {
+        std::cerr << "Line " << __LINE__ << ": output size is " << output->GetBufferedRegion().GetSize()
+                  << ", memory mapping " << useMemoryMapping << std::endl;
+        return false;
+        }
+      }
+    itk::ImageRegionConstIteratorWithIndex<ImageType> it(output, output->GetBufferedRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      if (it.Get() != ExpectedValue(it.GetIndex(), volume))
+        {
+        std::cerr << "Line " << __LINE__ << ": voxel " << it.GetIndex() << " of volume " << volume
+                  << " is " << it.Get() << ", expected " << ExpectedValue(it.GetIndex(), volume)
+                  << ", memory mapping " << useMemoryMapping << std::endl;
+        return false;
+        }
+      }
+    }
+
+  // GetVoxelTimeSeries, in full and partial blocks
+  const ImageType::IndexType voxels[] = {
+    { { 0, 0, 0 } },
+    { { 5, 7, 9 } },
+    { { 17, 3, 20 } },
+    { { 19, 17, 32 } }
+    };
+  for (unsigned int voxel = 0; voxel < sizeof(voxels) / sizeof(voxels[0]); ++voxel)
+    {
+    DatabaseType::ArrayType timeSeries;
+    database->GetVoxelTimeSeries(voxels[voxel], timeSeries);
+    if (timeSeries.GetSize() != NUMBER_OF_VOLUMES)
+      {
+      std::cerr << "Line " << __LINE__ << ": time series of size " << timeSeries.GetSize() << std::endl;
+      return false;
+      }
+    for (unsigned int volume = 0; volume < NUMBER_OF_VOLUMES; ++volume)
+      {
+      if (timeSeries[volume] != ExpectedValue(voxels[voxel], volume))
+        {
+        std::cerr << "Line " << __LINE__ << ": voxel " << voxels[voxel] << " of volume " << volume
+                  << " is " << timeSeries[volume] << ", expected " << ExpectedValue(voxels[voxel], volume)
+                  << ", memory mapping " << useMemoryMapping << std::endl;
+        return false;
+        }
+      }
+    }
+
+  // Voxels outside of the image are rejected
+  bool exceptionThrown = false;
+  try
+    {
+    const ImageType::IndexType outside = { { 0, static_cast<itk::IndexValueType>(IMAGE_SIZE[1]), 0 } };
+    DatabaseType::ArrayType timeSeries;
+    database->GetVoxelTimeSeries(outside, timeSeries);
+    }
+  catch (itk::ExceptionObject&)
+    {
+    exceptionThrown = true;
+    }
+  if (!exceptionThrown)
+    {
+    std::cerr << "Line " << __LINE__ << ": no exception for a voxel outside of the image" << std::endl;
+    return false;
+    }
+
+  database->Disconnect();
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  itk::itkFactoryRegistration();
+
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+  if (!WriteVolumes(tempDir))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // 3 blocks per file: the 2x2x3 blocks of the volumes are spread across
+  // multiple database files
+  const std::string databaseFileName = tempDir + "/itkTimeSeriesDatabaseTest1.tsd";
+  try
+    {
+    DatabaseType::CreateFromFileArchetype(databaseFileName.c_str(), VolumeFileName(tempDir, 0).c_str(),
+      3 * TimeSeriesVolumeBlockSize * sizeof(short));
+    }
+  catch (itk::ExceptionObject& err)
+    {
+    std::cerr << "Unable to create the database: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  try
+    {
+    if (!TestDatabase(databaseFileName, true)
+      || !TestDatabase(databaseFileName, false))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  catch (itk::ExceptionObject& err)
+    {
+    std::cerr << "Unexpected exception: " << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
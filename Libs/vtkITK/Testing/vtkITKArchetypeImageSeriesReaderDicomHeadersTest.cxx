@@ -0,0 +1,224 @@
+// vtkITK includes
+#include <vtkITKArchetypeImageSeriesReader.h>
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+
+// ITK includes
+#include <itkFactoryRegistration.h>
+#include <itkGDCMImageIO.h>
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkMetaDataObject.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+typedef itk::Image<short, 3> ImageType;
+
+const int NUMBER_OF_SLICES = 24;
+const double SLICE_SPACING = 2.5;
+const char* const SERIES_INSTANCE_UID = "1.2.826.0.1.3680043.2.1125.1.4711";
+const char* const OTHER_SERIES_INSTANCE_UID = "1.2.826.0.1.3680043.2.1125.1.4711.42.42";
+
+//----------------------------------------------------------------------------
+std::string SliceFileName(const std::string& tempDir, int slice)
+{
+  std::ostringstream fileName;
+  fileName << tempDir << "/DicomHeadersTestSlice" << (slice < 10 ? "0" : "") << slice << ".dcm";
+  return fileName.str();
+}
+
+//----------------------------------------------------------------------------
+bool WriteSlice(const std::string& tempDir, int slice, const char* seriesInstanceUID)
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::SizeType size = { { 8, 8, 1 } };
+  image->SetRegions(size);
+  ImageType::PointType origin;
+  origin[0] = 0.;
+  origin[1] = 0.;
+  origin[2] = slice * SLICE_SPACING;
+  image->SetOrigin(origin);
+  image->Allocate();
+  image->FillBuffer(static_cast<short>(slice));
+
+  std::ostringstream sliceLocation;
+  sliceLocation << slice * SLICE_SPACING;
+  std::ostringstream instanceNumber;
+  instanceNumber << slice + 1;
+  itk::MetaDataDictionary& dict = image->GetMetaDataDictionary();
+  itk::EncapsulateMetaData<std::string>(dict, "0008|0060", "MR");
+  itk::EncapsulateMetaData<std::string>(dict, "0020|000e", seriesInstanceUID);
+  itk::EncapsulateMetaData<std::string>(dict, "0020|0013", instanceNumber.str());
+  itk::EncapsulateMetaData<std::string>(dict, "0020|1041", sliceLocation.str());
+
+  itk::GDCMImageIO::Pointer gdcmIO = itk::GDCMImageIO::New();
+  gdcmIO->KeepOriginalUIDOn();
+  typedef itk::ImageFileWriter<ImageType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetImageIO(gdcmIO);
+  writer->SetInput(image);
+  writer->SetFileName(SliceFileName(tempDir, slice));
+  try
+    {
+    writer->Update();
+    }
+  catch (itk::ExceptionObject& err)
+    {
+    std::cerr << "Unable to write slice " << slice << ": " << err << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Values of the grouping tables filled by AnalyzeDicomHeaders()
+struct AnalyzedHeaders
+{
+  std::vector<std::string> SeriesInstanceUIDs;
+  std::vector<float> SliceLocations;
+  std::vector<float> ImagePositionsPatient;
+};
+
+//----------------------------------------------------------------------------
+bool AnalyzeHeaders(const std::string& tempDir, AnalyzedHeaders& headers)
+{
+  vtkSmartPointer<vtkITKArchetypeImageSeriesReader> reader =
+    vtkSmartPointer<vtkITKArchetypeImageSeriesReader>::New();
+  reader->SetArchetype(SliceFileName(tempDir, 0).c_str());
+  for (int slice = 0; slice < NUMBER_OF_SLICES; ++slice)
+    {
+    reader->AddFileName(SliceFileName(tempDir, slice).c_str());
+    }
+  reader->UpdateInformation();
+  if (reader->GetNumberOfImagePositionPatient() == 0)
+    {
+    std::cerr << "Line " << __LINE__ << ": headers were not analyzed" << std::endl;
+    return false;
+    }
+  for (unsigned int i = 0; i < reader->GetNumberOfSeriesInstanceUIDs(); ++i)
+    {
+    headers.SeriesInstanceUIDs.push_back(reader->GetNthSeriesInstanceUID(i));
+    }
+  for (unsigned int i = 0; i < reader->GetNumberOfSliceLocation(); ++i)
+    {
+    headers.SliceLocations.push_back(reader->GetNthSliceLocation(i));
+    }
+  for (unsigned int i = 0; i < reader->GetNumberOfImagePositionPatient(); ++i)
+    {
+    headers.ImagePositionsPatient.push_back(reader->GetNthImagePositionPatient(i)[2]);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool CheckHeaders(const AnalyzedHeaders& headers, const AnalyzedHeaders& expected, const char* description)
+{
+  if (headers.SeriesInstanceUIDs != expected.SeriesInstanceUIDs
+    || headers.SliceLocations != expected.SliceLocations
+    || headers.ImagePositionsPatient != expected.ImagePositionsPatient)
+    {
+    std::cerr << description << ": analyzed headers differ from the serial analysis" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  itk::itkFactoryRegistration();
+
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+  for (int slice = 0; slice < NUMBER_OF_SLICES; ++slice)
+    {
+    if (!WriteSlice(tempDir, slice, SERIES_INSTANCE_UID))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Serial analysis
+  vtkITKArchetypeImageSeriesReader::ClearDicomHeaderCache();
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(1);
+  AnalyzedHeaders serialHeaders;
+  if (!AnalyzeHeaders(tempDir, serialHeaders))
+    {
+    return EXIT_FAILURE;
+    }
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(0);
+  if (serialHeaders.SeriesInstanceUIDs.size() != 1
+    || serialHeaders.SeriesInstanceUIDs[0] != SERIES_INSTANCE_UID
+    || static_cast<int>(serialHeaders.ImagePositionsPatient.size()) != NUMBER_OF_SLICES
+    || static_cast<int>(serialHeaders.SliceLocations.size()) != NUMBER_OF_SLICES)
+    {
+    std::cerr << "Line " << __LINE__ << ": expected one series of " << NUMBER_OF_SLICES
+              << " slices, got " << serialHeaders.SeriesInstanceUIDs.size() << " series and "
+              << serialHeaders.ImagePositionsPatient.size() << " positions" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // Tables are filled in file order
+  for (int slice = 0; slice < NUMBER_OF_SLICES; ++slice)
+    {
+    if (serialHeaders.ImagePositionsPatient[slice] != static_cast<float>(slice * SLICE_SPACING))
+      {
+      std::cerr << "Line " << __LINE__ << ": position " << slice << " is "
+                << serialHeaders.ImagePositionsPatient[slice] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Parallel analysis gives the same tables
+  vtkITKArchetypeImageSeriesReader::ClearDicomHeaderCache();
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(4);
+  AnalyzedHeaders parallelHeaders;
+  if (!AnalyzeHeaders(tempDir, parallelHeaders)
+    || !CheckHeaders(parallelHeaders, serialHeaders, "Parallel analysis"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Headers of unchanged files come from the cache
+  AnalyzedHeaders cachedHeaders;
+  if (!AnalyzeHeaders(tempDir, cachedHeaders)
+    || !CheckHeaders(cachedHeaders, serialHeaders, "Cached analysis"))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // A modified file is parsed again: its size changes with the longer UID
+  if (!WriteSlice(tempDir, NUMBER_OF_SLICES - 1, OTHER_SERIES_INSTANCE_UID))
+    {
+    return EXIT_FAILURE;
+    }
+  AnalyzedHeaders modifiedHeaders;
+  if (!AnalyzeHeaders(tempDir, modifiedHeaders))
+    {
+    return EXIT_FAILURE;
+    }
+  vtkMultiThreader::SetGlobalDefaultNumberOfThreads(0);
+  if (modifiedHeaders.SeriesInstanceUIDs.size() != 2
+    || modifiedHeaders.SeriesInstanceUIDs[1] != OTHER_SERIES_INSTANCE_UID)
+    {
+    std::cerr << "Line " << __LINE__ << ": the modified file was not analyzed again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkITKArchetypeImageSeriesReader::ClearDicomHeaderCache();
+  return EXIT_SUCCESS;
+}
@@ -5,10 +5,15 @@
 #include <itkImage.h>
 #include <itkArray.h>
 #include <itkImageSource.h>
+#include <itkMultiThreader.h>
+#include <itkSimpleFastMutexLock.h>
 #include <iostream>
 #include <fstream>
 #include <itkTimeSeriesDatabaseHelper.h>
 
+// vtkAddon includes
+#include <vtkAddonMappedFile.h>
+
 #define TimeSeriesBlockSize 16
 #define TimeSeriesBlockSizeP2 TimeSeriesBlockSize*TimeSeriesBlockSize
 #define TimeSeriesBlockSizeP3 TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize
@@ -24,6 +29,12 @@ namespace itk
  * The main idea behind TimeSeriesDatabase is to have a representation of a 4 dimensional dataset that
  * is larger than main memory, but may still be accessed in a rapid manner.  Though not strictly
  * ITK conforming, this initial pass is strictly 4 dimensional datasets.
+ *
+ * The database files are memory mapped when possible: blocks are then read
+ * directly from the mapping by multiple threads and the blocks of the
+ * neighbouring time points are prefetched in the background, so that
+ * browsing the time series only waits for the disk when jumping far away.
+ * Files that cannot be mapped are read through a LRU cache of blocks.
  */
 template <class TPixel> class TimeSeriesDatabase : public ImageSource<Image<TPixel,3> > {
 public:
@@ -89,11 +100,28 @@ public:
   virtual void GenerateData(void) ITK_OVERRIDE;
 
   /** A convience method for reading a voxel's time course
-   * Subsequent calls to voxels in the immediate region of this will be
-   * cached for quick access
+   * Only the block holding the voxel is read for each time point, whole
+   * volumes are never assembled. Subsequent calls to voxels in the
+   * immediate region of this will be cached for quick access.
+   * Throws an exception if idx is outside of the image.
    */
   void GetVoxelTimeSeries ( typename OutputImageType::IndexType idx, ArrayType& array );
 
+  /** Memory map the database files in Connect (on by default).
+   * Files that cannot be mapped (e.g. 32 bit address space exhausted)
+   * are read through the block cache.
+   */
+  itkSetMacro ( UseMemoryMapping, bool );
+  itkGetConstMacro ( UseMemoryMapping, bool );
+  itkBooleanMacro ( UseMemoryMapping );
+
+  /** Number of time points before and after the CurrentImage whose blocks
+   * are prefetched in the background after GenerateData (1 by default,
+   * 0 disables prefetching). Only memory mapped files are prefetched.
+   */
+  itkSetMacro ( PrefetchRadius, unsigned int );
+  itkGetConstMacro ( PrefetchRadius, unsigned int );
+
   /** Set the size of the cache in MiB (1 MiB = 2^20 bytes)
    */
   void SetCacheSizeInMiB ( float sz );
@@ -116,6 +144,7 @@ protected:
   typename OutputImageType::DirectionType m_OutputDirection;
 
   typedef itk::TimeSeriesDatabaseHelper::counted_ptr<std::fstream> StreamPtr;
+  typedef itk::TimeSeriesDatabaseHelper::counted_ptr<vtkAddonMappedFile> MappedFilePtr;
 
   static std::streampos CalculatePosition ( unsigned long index, unsigned long BlocksPerFile );
 
@@ -137,6 +166,8 @@ protected:
   unsigned int m_CurrentImage;
 
   std::vector<StreamPtr>   m_DatabaseFiles;
+  /// Mapping of each database file, null if it is read through the cache
+  std::vector<MappedFilePtr> m_MappedFiles;
   std::vector<std::string> m_DatabaseFileNames;
   unsigned long            m_BlocksPerFile;
 
@@ -146,7 +177,31 @@ protected:
     TPixel data[TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize];
   };
   TimeSeriesDatabaseHelper::LRUCache<unsigned long, CacheBlock> m_Cache;
+  /// Not thread safe, lock m_CacheLock while the block is in use
   CacheBlock* GetCacheBlock ( unsigned long index );
+  SimpleFastMutexLock m_CacheLock;
+
+  bool         m_UseMemoryMapping;
+  unsigned int m_PrefetchRadius;
+
+  /// Return the block from the file mapping, NULL if it is not mapped
+  const TPixel* GetMappedBlock ( unsigned long index ) const;
+  /// Thread safe access to a block, \a scratch holds a copy of the block
+  /// if it is not mapped.
+  const TPixel* GetBlock ( unsigned long index, CacheBlock& scratch );
+  /// Start reading the mapped blocks [first, last] in the background
+  void PrefetchBlocks ( unsigned long first, unsigned long last ) const;
+  void PrefetchImage ( int ImagePosition, const Size<3>& BlockStart, const Size<3>& BlockCount ) const;
+
+  struct ThreadStruct
+  {
+    Self*            Database;
+    OutputImageType* Output;
+    Size<3>          BlockStart;
+    Size<3>          BlockCount;
+  };
+  static ITK_THREAD_RETURN_TYPE GenerateDataThreaderCallback ( void* arg );
+  void GenerateBlocks ( const ThreadStruct& str, unsigned long firstBlock, unsigned long lastBlock );
 };
 
 } // end namespace itk
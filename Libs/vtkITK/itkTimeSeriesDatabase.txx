@@ -9,8 +9,11 @@
 #include <itksys/SystemTools.hxx>
 #include <itkImage.h>
 #include <itkImageFileReader.h>
+#include <itkMutexLockHolder.h>
 #include <itksys/SystemTools.hxx>
 #include "itkArchetypeSeriesFileNames.h"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <vector>
 
@@ -66,6 +69,9 @@ void TimeSeriesDatabase<TPixel>::Disconnect ()
     }
   this->m_DatabaseFiles.clear();
   this->m_DatabaseFileNames.clear();
+  this->m_MappedFiles.clear();
+  MutexLockHolder<SimpleFastMutexLock> holder ( this->m_CacheLock );
+  this->m_Cache.clear();
 }
 
 template <class TPixel>
@@ -122,6 +128,7 @@ void TimeSeriesDatabase<TPixel>::Connect ( const char* filename )
   o >> dummy;
   this->m_DatabaseFiles.clear();
   this->m_DatabaseFileNames.clear();
+  this->m_MappedFiles.clear();
   // Read and open the files
   for ( int idx = 0; idx < NumberOfFiles; idx++ )
     {
@@ -130,6 +137,19 @@ void TimeSeriesDatabase<TPixel>::Connect ( const char* filename )
     // std::cout << "Reading file " << idx << " " << Filename << std::endl;
     this->m_DatabaseFileNames.push_back ( Filename );
     this->m_DatabaseFiles.push_back ( StreamPtr ( new std::fstream ( Filename.c_str(), ::std::ios::in | ::std::ios::binary ) ) );
+    MappedFilePtr mapping;
+    if ( this->m_UseMemoryMapping )
+      {
+      mapping = MappedFilePtr ( new vtkAddonMappedFile );
+      // Blocks are read in no particular order, the read-ahead is requested
+      // explicitly by PrefetchBlocks()
+      if ( !mapping->Open ( Filename, true ) )
+        {
+        itkDebugMacro ( "TimeSeriesDatabase::Connect: failed to map " << Filename << ", reading it through the cache" );
+        mapping = MappedFilePtr();
+        }
+      }
+    this->m_MappedFiles.push_back ( mapping );
     }
   /*
   std::cout << "ImageSize: " << m_OutputRegion.GetSize() << endl;
@@ -192,6 +212,8 @@ typename TimeSeriesDatabase<TPixel>::CacheBlock* TimeSeriesDatabase<TPixel>::Get
     CacheBlock B;
     int FileIdx = this->CalculateFileIndex ( index );
 
+    // A short read of a previous block must not fail all the next ones
+    this->m_DatabaseFiles[FileIdx]->clear();
     this->m_DatabaseFiles[FileIdx]->seekg ( this->CalculatePosition ( index, this->m_BlocksPerFile ) );
     this->m_DatabaseFiles[FileIdx]->read ( reinterpret_cast<char*> ( B.data ), TimeSeriesVolumeBlockSize * sizeof ( TPixel ) );
     this->m_Cache.insert ( index, B );
@@ -201,26 +223,113 @@ typename TimeSeriesDatabase<TPixel>::CacheBlock* TimeSeriesDatabase<TPixel>::Get
 }
 
 
+template <class TPixel>
+const TPixel* TimeSeriesDatabase<TPixel>::GetMappedBlock ( unsigned long index ) const
+{
+  unsigned int FileIdx = CalculateFileIndex ( index, this->m_BlocksPerFile );
+  if ( FileIdx >= this->m_MappedFiles.size() || !this->m_MappedFiles[FileIdx].get() )
+    {
+    return NULL;
+    }
+  const vtkAddonMappedFile* file = this->m_MappedFiles[FileIdx].get();
+  size_t position = ( index % this->m_BlocksPerFile ) * sizeof ( CacheBlock );
+  if ( position + sizeof ( CacheBlock ) > file->GetSize() )
+    {
+    return NULL;
+    }
+  return reinterpret_cast<const TPixel*> ( file->GetData() + position );
+}
+
+
+template <class TPixel>
+const TPixel* TimeSeriesDatabase<TPixel>::GetBlock ( unsigned long index, CacheBlock& scratch )
+{
+  const TPixel* block = this->GetMappedBlock ( index );
+  if ( block )
+    {
+    return block;
+    }
+  // The cached block may be evicted by another thread as soon as the lock
+  // is released, keep a copy
+  MutexLockHolder<SimpleFastMutexLock> holder ( this->m_CacheLock );
+  CacheBlock* Buffer = this->GetCacheBlock ( index );
+  memcpy ( scratch.data, Buffer->data, sizeof ( CacheBlock ) );
+  return scratch.data;
+}
+
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::PrefetchBlocks ( unsigned long first, unsigned long last ) const
+{
+  while ( first <= last )
+    {
+    unsigned int FileIdx = CalculateFileIndex ( first, this->m_BlocksPerFile );
+    unsigned long LastInFile = TSD_MIN<unsigned long> ( last, ( FileIdx + 1 ) * this->m_BlocksPerFile - 1 );
+    if ( FileIdx < this->m_MappedFiles.size() && this->m_MappedFiles[FileIdx].get() )
+      {
+      this->m_MappedFiles[FileIdx]->WillNeed ( ( first % this->m_BlocksPerFile ) * sizeof ( CacheBlock ),
+                                               ( LastInFile - first + 1 ) * sizeof ( CacheBlock ) );
+      }
+    first = LastInFile + 1;
+    }
+}
+
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::PrefetchImage ( int ImagePosition, const Size<3>& BlockStart, const Size<3>& BlockCount ) const
+{
+  unsigned int BlocksPerImage[3] = { this->m_BlocksPerImage[0], this->m_BlocksPerImage[1], this->m_BlocksPerImage[2] };
+  // Blocks along x are contiguous in the files, prefetch them row by row
+  Size<3> CurrentBlock = BlockStart;
+  for ( CurrentBlock[2] = BlockStart[2]; CurrentBlock[2] < BlockStart[2] + BlockCount[2]; CurrentBlock[2]++ )
+    {
+    for ( CurrentBlock[1] = BlockStart[1]; CurrentBlock[1] < BlockStart[1] + BlockCount[1]; CurrentBlock[1]++ )
+      {
+      unsigned long first = CalculateIndex ( CurrentBlock, ImagePosition, BlocksPerImage );
+      this->PrefetchBlocks ( first, first + BlockCount[0] - 1 );
+      }
+    }
+}
+
+
 template <class TPixel>
 void TimeSeriesDatabase<TPixel>::GetVoxelTimeSeries ( typename OutputImageType::IndexType idx, ArrayType& array )
 {
+  if ( !this->IsOpen() )
+    {
+    itkExceptionMacro ( "TimeSeriesDatabase::GetVoxelTimeSeries: not open for reading" );
+    }
   // See if the index is inside the volume
   // and figure out which cache block we need
   Size<3> CurrentBlock;
-  Size<3> Offset;
-  for ( int i = 0; i < 3; i++ ) {
-    if ( idx[i] < 0 || idx[i] > this->m_OutputRegion.Size[i] ) {
-      throw 1;
+  unsigned long offset = 0;
+  unsigned long stride = 1;
+  for ( int i = 0; i < 3; i++ )
+    {
+    if ( idx[i] < 0 || idx[i] >= static_cast<IndexValueType> ( this->m_OutputRegion.GetSize(i) ) )
+      {
+      itkExceptionMacro ( "TimeSeriesDatabase::GetVoxelTimeSeries: index " << idx << " is outside of the image" );
+      }
+    CurrentBlock[i] = idx[i] / TimeSeriesBlockSize;
+    offset += ( idx[i] % TimeSeriesBlockSize ) * stride;
+    stride *= TimeSeriesBlockSize;
+    }
+  // Each time point is in a different block, only the block holding the
+  // voxel is read. Start reading all of them at once rather than waiting
+  // for the disk once per time point.
+  unsigned long FirstIndex = this->CalculateIndex ( CurrentBlock, 0 );
+  unsigned long BlocksPerImage = this->m_BlocksPerImage[0] * this->m_BlocksPerImage[1] * this->m_BlocksPerImage[2];
+  for ( unsigned int volume = 0; volume < this->m_Dimensions[3]; volume++ )
+    {
+    unsigned long index = FirstIndex + volume * BlocksPerImage;
+    this->PrefetchBlocks ( index, index );
+    }
+  array.SetSize ( this->m_Dimensions[3] );
+  CacheBlock scratch;
+  for ( unsigned int volume = 0; volume < this->m_Dimensions[3]; volume++ )
+    {
+    array[volume] = this->GetBlock ( FirstIndex + volume * BlocksPerImage, scratch )[offset];
     }
-    CurrentBlock[i] = reinterpret_cast<unsigned long> ( idx[i] / (double)TimeSeriesBlockSize );
-    Offset[i] = idx[i] % TimeSeriesBlockSize;
-  }
-  unsigned long offset = Offset[0] + Offset[1] * TimeSeriesBlockSize + Offset[2] * TimeSeriesBlockSizeP2;
-  array = ArrayType ( this->m_Dimensions[3] );
-  for ( int volume = 0; volume < this->m_Dimensions[3]; volume++ ) {
-    CacheBlock* cache = this->GetCacheBlock ( CurrentBlock, volume );
-    array[volume] = cache->data[offset];
-  }
 }
 
 
@@ -255,86 +364,87 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
     BlockCount[i] = (int) TSD_MAX ( 1.0, ceil ( (Region.GetIndex(i)+Region.GetSize(i)) / (double)TimeSeriesBlockSize ) - BlockStart[i] );
   }
 
-  bool print = Region.GetIndex(0) == 0 && Region.GetIndex(1) == 0 && Region.GetIndex(2) == 80;
-  print = false;
-  if ( print )
+  // Blocks are independent, split them between the threads
+  ThreadStruct str;
+  str.Database = this;
+  str.Output = output;
+  str.BlockStart = BlockStart;
+  str.BlockCount = BlockCount;
+  unsigned long NumberOfBlocks = BlockCount[0] * BlockCount[1] * BlockCount[2];
+  unsigned long NumberOfThreads = TSD_MIN<unsigned long> ( this->GetNumberOfThreads(), NumberOfBlocks );
+  if ( NumberOfThreads <= 1 )
     {
-    std::cout << "GenerateData for " << output->GetRequestedRegion() << std::endl;
-    output->Print ( std::cout );
+    this->GenerateBlocks ( str, 0, NumberOfBlocks );
+    }
+  else
+    {
+    this->GetMultiThreader()->SetNumberOfThreads ( NumberOfThreads );
+    this->GetMultiThreader()->SetSingleMethod ( Self::GenerateDataThreaderCallback, &str );
+    this->GetMultiThreader()->SingleMethodExecute();
     }
 
-  Size<3> CurrentBlock;
-  // Now, read our data, caching as we go, in future, make this thread safe
-  Size<3> BlockSize = { {TimeSeriesBlockSize, TimeSeriesBlockSize, TimeSeriesBlockSize }};
-  ImageRegion<3> BlockRegion;
-  BlockRegion.SetSize ( BlockSize );
-  // Fetch only the blocks we need
-  for ( CurrentBlock[2] = BlockStart[2]; CurrentBlock[2] < BlockStart[2] + BlockCount[2]; CurrentBlock[2]++ ) {
-    for ( CurrentBlock[1] = BlockStart[1]; CurrentBlock[1] < BlockStart[1] + BlockCount[1]; CurrentBlock[1]++ ) {
-      for ( CurrentBlock[0] = BlockStart[0]; CurrentBlock[0] < BlockStart[0] + BlockCount[0]; CurrentBlock[0]++ ) {
-        typename OutputImageType::RegionType BR, IR;
-        if ( print ) {  std::cout << "For Block Index: " << CurrentBlock << std::endl; }
-        unsigned long index = this->CalculateIndex ( CurrentBlock, this->m_CurrentImage );
-        CacheBlock* Buffer = this->GetCacheBlock ( index );
-        if ( this->CalculateIntersection ( CurrentBlock, Region, BR, IR ) ) {
-          // Just iterate over whole block
-          // Good we can use an iterator!
-          if ( print ) {
-            std::cout << "The easy way! " << std::endl;
-            std::cout << "Block Region: " << BR;
-            std::cout << "Image Region: " << IR;
-          }
-          Index<3> BlockIndex = {{ static_cast<IndexValueType>( CurrentBlock[0] * TimeSeriesBlockSize),
-                                   static_cast<IndexValueType>( CurrentBlock[1] * TimeSeriesBlockSize),
-                                   static_cast<IndexValueType>( CurrentBlock[2] * TimeSeriesBlockSize) }};
-          BlockRegion.SetIndex ( BlockIndex );
-          ImageRegionIterator<OutputImageType> it ( output, IR );
-          it.GoToBegin();
-          TPixel* ptr = Buffer->data;
-          while ( !it.IsAtEnd() ) {
-            it.Set ( *ptr );
-            ++it;
-            ++ptr;
-          }
-        } else {
-          // Now we do it the hard way...
-          Index<3> ImageIndex;
-          Size<3> Count = BR.GetSize();
-          if ( print ) {
-            std::cout << "The Hard way" << std::endl;
-            std::cout << "Count: " << Count << std::endl;
-            std::cout << "Block Region: " << BR;
-            std::cout << "Image Region: " << IR;
-            std::cout << "First voxel: " << Buffer->data[0] << std::endl;
-          }
-          unsigned int bx, by, bz, x, y, z;
-          for ( z = 0; z < Count[2]; z++ ) {
-            ImageIndex[2] = IR.GetIndex(2) + z;
-            bz = BR.GetIndex(2) + z;
-            for ( y = 0; y < Count[1]; y++ ) {
-              ImageIndex[1] = IR.GetIndex(1) + y;
-              by = BR.GetIndex(1) + y;
-              for ( x = 0; x < Count[0]; x++ ) {
-                ImageIndex[0] = IR.GetIndex(0) + x;
-                bx = BR.GetIndex(0) + x;
-                /*
-                int BufferIndex = bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz;
-                if ( ImageIndex[0] == 45 && ImageIndex[1] == 0 && ImageIndex[2] == 0 ) {
-                  std::cout << "Index: " << ImageIndex << " Volume Value: " << output->GetPixel ( ImageIndex ) << " buffer: " << Buffer->data[BufferIndex] << std::endl;
-                std::cout << "Index: " << ImageIndex << " From " << BufferIndex << " ( " << bx << ", " << by << ", " << bz << " )\n" << std::endl;
-                }
-                */
+  // Browsing usually moves to the next or previous time point, let the
+  // operating system read their blocks while this one is being displayed
+  for ( unsigned int r = 1; r <= this->m_PrefetchRadius; r++ )
+    {
+    if ( this->m_CurrentImage + r < this->m_Dimensions[3] )
+      {
+      this->PrefetchImage ( this->m_CurrentImage + r, BlockStart, BlockCount );
+      }
+    if ( this->m_CurrentImage >= r )
+      {
+      this->PrefetchImage ( this->m_CurrentImage - r, BlockStart, BlockCount );
+      }
+    }
+}
 
-                output->SetPixel ( ImageIndex, Buffer->data[bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz] );
-                }
-              }
-            }
-          }
+
+template <class TPixel>
+ITK_THREAD_RETURN_TYPE TimeSeriesDatabase<TPixel>::GenerateDataThreaderCallback ( void* arg )
+{
+  MultiThreader::ThreadInfoStruct* info = static_cast<MultiThreader::ThreadInfoStruct*> ( arg );
+  ThreadStruct* str = static_cast<ThreadStruct*> ( info->UserData );
+  unsigned long NumberOfBlocks = str->BlockCount[0] * str->BlockCount[1] * str->BlockCount[2];
+  unsigned long first = NumberOfBlocks * info->ThreadID / info->NumberOfThreads;
+  unsigned long last = NumberOfBlocks * ( info->ThreadID + 1 ) / info->NumberOfThreads;
+  str->Database->GenerateBlocks ( *str, first, last );
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::GenerateBlocks ( const ThreadStruct& str, unsigned long firstBlock, unsigned long lastBlock )
+{
+  typename OutputImageType::RegionType Region = str.Output->GetBufferedRegion();
+  TPixel* OutputBuffer = str.Output->GetBufferPointer();
+  SizeValueType RowStride = Region.GetSize(0);
+  SizeValueType SliceStride = RowStride * Region.GetSize(1);
+  CacheBlock scratch;
+  for ( unsigned long b = firstBlock; b < lastBlock; b++ )
+    {
+    Size<3> CurrentBlock;
+    CurrentBlock[0] = str.BlockStart[0] + b % str.BlockCount[0];
+    CurrentBlock[1] = str.BlockStart[1] + ( b / str.BlockCount[0] ) % str.BlockCount[1];
+    CurrentBlock[2] = str.BlockStart[2] + b / ( str.BlockCount[0] * str.BlockCount[1] );
+    typename OutputImageType::RegionType BR, IR;
+    this->CalculateIntersection ( CurrentBlock, Region, BR, IR );
+    const TPixel* Buffer = this->GetBlock ( this->CalculateIndex ( CurrentBlock, this->m_CurrentImage ), scratch );
+    // Copy the intersection row by row
+    Size<3> Count = BR.GetSize();
+    for ( SizeValueType z = 0; z < Count[2]; z++ )
+      {
+      for ( SizeValueType y = 0; y < Count[1]; y++ )
+        {
+        const TPixel* src = Buffer + BR.GetIndex(0)
+          + TimeSeriesBlockSize * ( BR.GetIndex(1) + y )
+          + TimeSeriesBlockSizeP2 * ( BR.GetIndex(2) + z );
+        TPixel* dst = OutputBuffer + ( IR.GetIndex(0) - Region.GetIndex(0) )
+          + RowStride * ( IR.GetIndex(1) - Region.GetIndex(1) + y )
+          + SliceStride * ( IR.GetIndex(2) - Region.GetIndex(2) + z );
+        std::copy ( src, src + Count[0], dst );
         }
       }
     }
-
-  return;
 }
 
 
@@ -569,12 +679,15 @@ void TimeSeriesDatabase<TPixel>::SetCacheSizeInMiB ( float sz )
 {
   // How many blocks is this?
   double BlockSizeInMiB = sizeof ( TPixel ) * TimeSeriesVolumeBlockSize / ( 1024*1024.);
-  unsigned long int blocks = (unsigned long int) ceil ( sz * BlockSizeInMiB );
+  unsigned long int blocks = (unsigned long int) ceil ( sz / BlockSizeInMiB );
+  MutexLockHolder<SimpleFastMutexLock> holder ( this->m_CacheLock );
   this->m_Cache.set_maxsize ( blocks );
 }
 
 template <class TPixel>
-TimeSeriesDatabase<TPixel>::TimeSeriesDatabase () : m_Cache ( 1024 ){
+TimeSeriesDatabase<TPixel>::TimeSeriesDatabase ()
+  : m_CurrentImage ( 0 ), m_BlocksPerFile ( 0 ), m_Cache ( 1024 ),
+    m_UseMemoryMapping ( true ), m_PrefetchRadius ( 1 ) {
   this->m_Dimensions.SetSize ( 4 );
   this->m_BlocksPerImage.SetSize ( 4 );
 }
@@ -593,6 +706,8 @@ TimeSeriesDatabase<TPixel>
 
   os << indent << "Dimensions: " << m_Dimensions << "\n";
   os << indent << "Filename: " << m_Filename << "\n";
+  os << indent << "UseMemoryMapping: " << m_UseMemoryMapping << "\n";
+  os << indent << "PrefetchRadius: " << m_PrefetchRadius << "\n";
   os << indent << "BlocksPerImage: " << m_BlocksPerImage[0] << " "  << "\n";
   os << indent << "OutputSpacing: " << m_OutputSpacing << "\n";
   os << indent << "OutputRegion: " << m_OutputRegion;
@@ -601,6 +716,12 @@ TimeSeriesDatabase<TPixel>
   if ( this->IsOpen() ) {
     os << indent << "Database is open." << "\n";
     os << indent << "Blocks per file: " << this->m_BlocksPerFile << "\n";
+    ::size_t mapped = 0;
+    for ( ::size_t idx = 0; idx < this->m_MappedFiles.size(); idx++ )
+      {
+      mapped += this->m_MappedFiles[idx].get() ? 1 : 0;
+      }
+    os << indent << "Memory mapped files: " << mapped << "/" << this->m_MappedFiles.size() << "\n";
     os << indent << "File names: " << "\n";
     for ( ::size_t idx = 0; idx < this->m_DatabaseFileNames.size(); idx++ )
       {
@@ -6,6 +6,7 @@
 #include <string>
 #include <cstdarg>
 #include <cassert>
+#include <cstddef>
 
 namespace itk {
   namespace TimeSeriesDatabaseHelper {
@@ -23,10 +23,12 @@
 #include <vtkMatrix4x4.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtksys/SystemTools.hxx>
 
 // ITK includes
 #include <itkNiftiImageIO.h>
@@ -35,10 +37,13 @@
 #include <itkMetaDataObjectBase.h>
 #include <itkMetaDataObject.h>
 #include <itkMetaImageIO.h>
+#include <itkMutexLockHolder.h>
+#include <itkSimpleFastMutexLock.h>
 #include <itkTimeProbe.h>
 
 // STD includes
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include "itkArchetypeSeriesFileNames.h"
@@ -52,6 +57,106 @@
 
 vtkStandardNewMacro(vtkITKArchetypeImageSeriesReader);
 
+#ifdef VTKITK_BUILD_DICOM_SUPPORT
+namespace
+{
+
+/// DICOM tags read by AnalyzeDicomHeaders()
+enum
+{
+  SERIES_INSTANCE_UID_TAG = 0,
+  CONTENT_TIME_TAG,
+  TRIGGER_TIME_TAG,
+  ECHO_NUMBERS_TAG,
+  DIFFUSION_GRADIENT_ORIENTATION_TAG,
+  SLICE_LOCATION_TAG,
+  IMAGE_ORIENTATION_PATIENT_TAG,
+  IMAGE_POSITION_PATIENT_TAG,
+  NUMBER_OF_DICOM_HEADER_TAGS
+};
+const char* const DICOM_HEADER_TAGS[NUMBER_OF_DICOM_HEADER_TAGS] =
+{
+  "0020|000e", "0008|0033", "0018|1060", "0018|0086", "0010|9089", "0020|1041", "0020|0037", "0020|0032"
+};
+
+/// Values of the DICOM tags of a file, spaces removed
+struct DicomHeaderValues
+{
+  std::string Values[NUMBER_OF_DICOM_HEADER_TAGS];
+};
+
+/// Cached header values, valid while the size and modification time of the
+/// file are unchanged
+struct DicomHeaderCacheEntry
+{
+  unsigned long FileSize;
+  long ModifiedTime;
+  DicomHeaderValues Header;
+};
+typedef std::map<std::string, DicomHeaderCacheEntry> DicomHeaderCacheType;
+
+/// The cache is emptied when it reaches this number of files
+const size_t MAXIMUM_DICOM_HEADER_CACHE_SIZE = 200000;
+
+DicomHeaderCacheType DicomHeaderCache;
+itk::SimpleFastMutexLock DicomHeaderCacheLock;
+
+//----------------------------------------------------------------------------
+struct AnalyzeDicomHeadersThreadData
+{
+  const std::vector<std::string>* FileNames;
+  /// Indices in FileNames of the files to parse
+  std::vector<int> FilesToParse;
+  std::vector<DicomHeaderValues>* Headers;
+  /// Index of the file that could not be parsed by each thread (-1 if
+  /// none) and the exception it threw
+  std::vector<int> FailedFiles;
+  std::vector<itk::ExceptionObject> Exceptions;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE AnalyzeDicomHeadersThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  AnalyzeDicomHeadersThreadData* data = static_cast<AnalyzeDicomHeadersThreadData*>(info->UserData);
+  const int numberOfFiles = static_cast<int>(data->FilesToParse.size());
+
+  // GDCMImageIO is not thread safe, each thread has its own
+  itk::GDCMImageIO::Pointer gdcmIO = itk::GDCMImageIO::New();
+  // interleave the files so that the threads read from the same region of
+  // the disk and have a similar amount of work
+  for (int i = info->ThreadID; i < numberOfFiles; i += info->NumberOfThreads)
+    {
+    const int f = data->FilesToParse[i];
+    try
+      {
+      gdcmIO->SetFileName((*data->FileNames)[f]);
+      gdcmIO->ReadImageInformation();
+      }
+    catch (itk::ExceptionObject& exception)
+      {
+      data->FailedFiles[info->ThreadID] = f;
+      data->Exceptions[info->ThreadID] = exception;
+      // stop at the first error, as the serial analysis did
+      break;
+      }
+    // Use vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces to remove extra spaces
+    // from the DICOM tag, because extra spaces were found in some DICOM file before/after the
+    // multi-value separator backslashes.
+    const itk::MetaDataDictionary& dict = gdcmIO->GetMetaDataDictionary();
+    DicomHeaderValues& header = (*data->Headers)[f];
+    for (int tag = 0; tag < NUMBER_OF_DICOM_HEADER_TAGS; ++tag)
+      {
+      header.Values[tag] = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(
+        dict, DICOM_HEADER_TAGS[tag]);
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+#endif
+
 //----------------------------------------------------------------------------
 vtkITKArchetypeImageSeriesReader::vtkITKArchetypeImageSeriesReader()
 {
@@ -1225,20 +1330,83 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
   // if Archetype is a Dicom File
-  gdcmIO->SetFileName( this->Archetype );
-  for (int f = 0; f < nFiles; f++)
+
+  // Reuse the headers of the files that were not modified since their last
+  // analysis, parse the others on multiple threads
+  std::vector<DicomHeaderValues> headers(nFiles);
+  std::vector<unsigned long> fileSizes(nFiles);
+  std::vector<long> modifiedTimes(nFiles);
+  AnalyzeDicomHeadersThreadData data;
+  data.FileNames = &this->AllFileNames;
+  data.Headers = &headers;
   {
-    gdcmIO->SetFileName( this->AllFileNames[f] );
-    gdcmIO->ReadImageInformation();
-    itk::MetaDataDictionary &dict = gdcmIO->GetMetaDataDictionary();
-    std::string tagValue;
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(DicomHeaderCacheLock);
+    for (int f = 0; f < nFiles; f++)
+      {
+      const std::string& fileName = this->AllFileNames[f];
+      fileSizes[f] = vtksys::SystemTools::FileLength(fileName.c_str());
+      modifiedTimes[f] = vtksys::SystemTools::ModifiedTime(fileName.c_str());
+      DicomHeaderCacheType::const_iterator cached = DicomHeaderCache.find(fileName);
+      if (cached != DicomHeaderCache.end()
+        && cached->second.FileSize == fileSizes[f]
+        && cached->second.ModifiedTime == modifiedTimes[f])
+        {
+        headers[f] = cached->second.Header;
+        }
+      else
+        {
+        data.FilesToParse.push_back(f);
+        }
+      }
+  }
 
-    // Use vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces to remove extra spaces
-    // from the DICOM tag, because extra spaces were found in some DICOM file before/after the
-    // multi-value separator backslashes.
+  int firstFailedFile = -1;
+  itk::ExceptionObject firstException;
+  if (!data.FilesToParse.empty())
+    {
+    vtkNew<vtkMultiThreader> threader;
+    int numberOfThreads = std::min(vtkMultiThreader::GetGlobalDefaultNumberOfThreads(),
+      static_cast<int>(data.FilesToParse.size()));
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(AnalyzeDicomHeadersThreadFunction, &data);
+    data.FailedFiles.assign(numberOfThreads, -1);
+    data.Exceptions.resize(numberOfThreads);
+    threader->SingleMethodExecute();
+    for (int thread = 0; thread < numberOfThreads; ++thread)
+      {
+      if (data.FailedFiles[thread] >= 0
+        && (firstFailedFile < 0 || data.FailedFiles[thread] < firstFailedFile))
+        {
+        firstFailedFile = data.FailedFiles[thread];
+        firstException = data.Exceptions[thread];
+        }
+      }
+
+    itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(DicomHeaderCacheLock);
+    if (DicomHeaderCache.size() + data.FilesToParse.size() > MAXIMUM_DICOM_HEADER_CACHE_SIZE)
+      {
+      DicomHeaderCache.clear();
+      }
+    for (std::vector<int>::const_iterator it = data.FilesToParse.begin();
+      it != data.FilesToParse.end() && (firstFailedFile < 0 || *it < firstFailedFile); ++it)
+      {
+      DicomHeaderCacheEntry& entry = DicomHeaderCache[this->AllFileNames[*it]];
+      entry.FileSize = fileSizes[*it];
+      entry.ModifiedTime = modifiedTimes[*it];
+      entry.Header = headers[*it];
+      }
+    }
+
+  // Merge the headers in file order, so that the result does not depend on
+  // the order the threads parsed the files
+  const int numberOfParsedFiles = firstFailedFile < 0 ? nFiles : firstFailedFile;
+  for (int f = 0; f < numberOfParsedFiles; f++)
+  {
+    const DicomHeaderValues& header = headers[f];
+    std::string tagValue;
 
     // series instance UID
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|000e");
+    tagValue = header.Values[SERIES_INSTANCE_UID_TAG];
     if (!tagValue.empty())
     {
       int idx = InsertSeriesInstanceUIDs( tagValue.c_str() );
@@ -1250,7 +1418,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // content time
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0008|0033");
+    tagValue = header.Values[CONTENT_TIME_TAG];
     if (!tagValue.empty())
     {
       int idx = InsertContentTime( tagValue.c_str() );
@@ -1262,7 +1430,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // trigger time
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0018|1060");
+    tagValue = header.Values[TRIGGER_TIME_TAG];
     if (!tagValue.empty())
     {
       int idx = InsertTriggerTime( tagValue.c_str() );
@@ -1274,7 +1442,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // echo numbers
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0018|0086");
+    tagValue = header.Values[ECHO_NUMBERS_TAG];
     if (!tagValue.empty())
     {
       int idx = InsertEchoNumbers( tagValue.c_str() );
@@ -1286,7 +1454,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // diffision gradient orientation
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0010|9089");
+    tagValue = header.Values[DIFFUSION_GRADIENT_ORIENTATION_TAG];
     if (!tagValue.empty())
     {
       float a[3] = { -1 };
@@ -1300,7 +1468,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // slice location
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|1041");
+    tagValue = header.Values[SLICE_LOCATION_TAG];
     if (!tagValue.empty())
     {
       float a = -1;
@@ -1314,7 +1482,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // image orientation patient
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|0037");
+    tagValue = header.Values[IMAGE_ORIENTATION_PATIENT_TAG];
     if (!tagValue.empty())
     {
       float a[6] = { -1 };
@@ -1327,7 +1495,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
       this->IndexImageOrientationPatient[f] = -1;
     }
     // image position patient
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|0032");
+    tagValue = header.Values[IMAGE_POSITION_PATIENT_TAG];
     if (!tagValue.empty())
     {
       float a[3] = { -1 };
@@ -1341,6 +1509,11 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
   }
 
+  if (firstFailedFile >= 0)
+    {
+    throw firstException;
+    }
+
   AnalyzeTime.Stop();
 
   // double timeelapsed = AnalyzeTime.GetMean(); UNUSED
@@ -1348,6 +1521,15 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
 #endif
 }
 
+//----------------------------------------------------------------------------
+void vtkITKArchetypeImageSeriesReader::ClearDicomHeaderCache()
+{
+#ifdef VTKITK_BUILD_DICOM_SUPPORT
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(DicomHeaderCacheLock);
+  DicomHeaderCache.clear();
+#endif
+}
+
 //----------------------------------------------------------------------------
 const itk::MetaDataDictionary&
 vtkITKArchetypeImageSeriesReader
@@ -776,8 +776,17 @@ public:
       return (this->ImagePositionPatient.size()-1);
     }
 
+  /// Read the DICOM tags used to group AllFileNames into volumes. Headers
+  /// are parsed on multiple threads and cached: files that were not
+  /// modified since they were last analyzed are not parsed again.
   void AnalyzeDicomHeaders( );
 
+  /// Remove all the entries of the DICOM header cache
+  static void ClearDicomHeaderCache();
+
+  /// Get MetaData from dictionary, removing all whitespaces from the string.
+  static std::string GetMetaDataWithoutSpaces(const itk::MetaDataDictionary &dict, const std::string& tag);
+
   void AssembleNthVolume( int n );
   int AssembleVolumeContainingArchetype();
 
@@ -803,9 +812,6 @@ protected:
   vtkITKArchetypeImageSeriesReader();
   ~vtkITKArchetypeImageSeriesReader();
 
-  /// Get MetaData from dictionary, removing all whitespaces from the string.
-  static std::string GetMetaDataWithoutSpaces(const itk::MetaDataDictionary &dict, const std::string& tag);
-
   char *Archetype;
   int SingleFile;
   int UseOrientationFromFile;
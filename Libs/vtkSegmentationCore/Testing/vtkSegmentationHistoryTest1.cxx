@@ -0,0 +1,185 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VTK includes
+#include <vtkNew.h>
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+#include "vtkSegmentationHistory.h"
+
+// STD includes
+#include <cstring>
+
+namespace
+{
+const int IMAGE_SIZE = 100;
+
+//----------------------------------------------------------------------------
+void SetBox(vtkOrientedImageData* imageData, int first, int last, unsigned char value)
+{
+  for (int z = first; z <= last; ++z)
+    {
+    for (int y = first; y <= last; ++y)
+      {
+      for (int x = first; x <= last; ++x)
+        {
+        *static_cast<unsigned char*>(imageData->GetScalarPointer(x, y, z)) = value;
+        }
+      }
+    }
+  imageData->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkOrientedImageData* GetLabelmap(vtkSegment* segment)
+{
+  return vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()));
+}
+
+//----------------------------------------------------------------------------
+bool IsSameVoxels(vtkOrientedImageData* imageData1, vtkOrientedImageData* imageData2)
+{
+  if (!imageData1 || !imageData2)
+    {
+    return false;
+    }
+  int* extent1 = imageData1->GetExtent();
+  int* extent2 = imageData2->GetExtent();
+  for (int i = 0; i < 6; ++i)
+    {
+    if (extent1[i] != extent2[i])
+      {
+      return false;
+      }
+    }
+  return memcmp(imageData1->GetScalarPointer(), imageData2->GetScalarPointer(),
+    imageData1->GetNumberOfPoints() * imageData1->GetScalarSize()) == 0;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentationHistoryTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Create segmentation with a cube labelmap segment
+  vtkNew<vtkOrientedImageData> labelmap;
+  labelmap->SetExtent(0, IMAGE_SIZE - 1, 0, IMAGE_SIZE - 1, 0, IMAGE_SIZE - 1);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  memset(labelmap->GetScalarPointer(), 0, labelmap->GetNumberOfPoints());
+  SetBox(labelmap.GetPointer(), 25, 75, 1);
+
+  vtkNew<vtkSegment> segment;
+  segment->SetName("cube");
+  segment->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap.GetPointer());
+  vtkNew<vtkSegmentation> segmentation;
+  segmentation->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+  segmentation->AddSegment(segment.GetPointer());
+
+  vtkNew<vtkSegmentationHistory> history;
+  history->SetSegmentation(segmentation.GetPointer());
+  if (history->GetMemorySize() != 0)
+    {
+    std::cerr << __LINE__ << ": Empty history is expected to use no memory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Save state before editing, then edit a small region
+  vtkNew<vtkOrientedImageData> originalLabelmap;
+  originalLabelmap->DeepCopy(labelmap.GetPointer());
+  if (!history->SaveState())
+    {
+    std::cerr << __LINE__ << ": Failed to save state" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkTypeInt64 singleStateMemorySize = history->GetMemorySize();
+  if (singleStateMemorySize <= 0 || singleStateMemorySize >= labelmap->GetNumberOfPoints())
+    {
+    std::cerr << __LINE__ << ": Stored labelmap is expected to be compressed, memory size: "
+      << singleStateMemorySize << std::endl;
+    return EXIT_FAILURE;
+    }
+  SetBox(labelmap.GetPointer(), 40, 50, 0);
+  vtkNew<vtkOrientedImageData> editedLabelmap;
+  editedLabelmap->DeepCopy(labelmap.GetPointer());
+
+  // Undo: current state is saved and only the changed region of the previous state is kept
+  if (!history->RestorePreviousState())
+    {
+    std::cerr << __LINE__ << ": Failed to restore previous state" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!IsSameVoxels(GetLabelmap(segment.GetPointer()), originalLabelmap.GetPointer()))
+    {
+    std::cerr << __LINE__ << ": Restored previous state does not match the original labelmap" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (history->GetMemorySize() >= 2 * singleStateMemorySize)
+    {
+    std::cerr << __LINE__ << ": Previous state is expected to store only differences, memory size: "
+      << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Redo
+  if (!history->IsRestoreNextStateAvailable() || !history->RestoreNextState())
+    {
+    std::cerr << __LINE__ << ": Failed to restore next state" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!IsSameVoxels(GetLabelmap(segment.GetPointer()), editedLabelmap.GetPointer()))
+    {
+    std::cerr << __LINE__ << ": Restored next state does not match the edited labelmap" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Undo again then edit: next state is removed, previous state must remain restorable
+  history->RestorePreviousState();
+  SetBox(GetLabelmap(segment.GetPointer()), 10, 20, 1);
+  segmentation->InvokeEvent(vtkSegmentation::MasterRepresentationModified);
+  if (history->IsRestoreNextStateAvailable())
+    {
+    std::cerr << __LINE__ << ": Next state is expected to be removed after modifying the segmentation" << std::endl;
+    return EXIT_FAILURE;
+    }
+  history->RestorePreviousState();
+  if (!IsSameVoxels(GetLabelmap(segment.GetPointer()), originalLabelmap.GetPointer()))
+    {
+    std::cerr << __LINE__ << ": Restored state does not match the original labelmap after removing next states" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Memory budget removes the oldest states
+  history->SetMaximumMemorySize(1);
+  if (history->IsRestorePreviousStateAvailable())
+    {
+    std::cerr << __LINE__ << ": Previous states are expected to be removed when exceeding the memory limit" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (history->GetMemorySize() <= 0)
+    {
+    std::cerr << __LINE__ << ": Most recent state is expected to be kept when exceeding the memory limit" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Segmentation history test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
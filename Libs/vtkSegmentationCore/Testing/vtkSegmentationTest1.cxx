@@ -264,6 +264,72 @@ int vtkSegmentationTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
     return EXIT_FAILURE;
     }
 
+  //////////////////////////////////////////////////////////////////////////
+  // Convert multiple segments concurrently and compare with sequential conversion
+
+  vtkNew<vtkSegmentation> sequentialSegmentation;
+  sequentialSegmentation->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName() );
+  sequentialSegmentation->SetNumberOfConversionThreads(1);
+  vtkNew<vtkSegmentation> threadedSegmentation;
+  threadedSegmentation->SetMasterRepresentationName(
+    vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName() );
+  threadedSegmentation->SetNumberOfConversionThreads(4);
+  const int numberOfThreadedSegments = 6;
+  for (int segmentIndex = 0; segmentIndex < numberOfThreadedSegments; ++segmentIndex)
+    {
+    vtkNew<vtkPolyData> segmentPolyData;
+    CreateSpherePolyData(segmentPolyData.GetPointer());
+    vtkNew<vtkSegment> sequentialSegment;
+    sequentialSegment->AddRepresentation(
+      vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(), segmentPolyData.GetPointer());
+    sequentialSegmentation->AddSegment(sequentialSegment.GetPointer());
+    vtkNew<vtkSegment> threadedSegment;
+    threadedSegment->AddRepresentation(
+      vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName(), segmentPolyData.GetPointer());
+    threadedSegmentation->AddSegment(threadedSegment.GetPointer());
+    }
+  if (!sequentialSegmentation->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName())
+    || !threadedSegmentation->CreateRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()))
+    {
+    std::cerr << __LINE__ << ": Failed to convert multiple segments to binary labelmap!" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int segmentIndex = 0; segmentIndex < numberOfThreadedSegments; ++segmentIndex)
+    {
+    vtkOrientedImageData* sequentialImageData = vtkOrientedImageData::SafeDownCast(
+      sequentialSegmentation->GetNthSegment(segmentIndex)->GetRepresentation(
+      vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    vtkOrientedImageData* threadedImageData = vtkOrientedImageData::SafeDownCast(
+      threadedSegmentation->GetNthSegment(segmentIndex)->GetRepresentation(
+      vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()) );
+    if (!sequentialImageData || !threadedImageData)
+      {
+      std::cerr << __LINE__ << ": Failed to convert segment " << segmentIndex << " to binary labelmap!" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (vtkSegmentationConverter::SerializeImageGeometry(sequentialImageData)
+      != vtkSegmentationConverter::SerializeImageGeometry(threadedImageData))
+      {
+      std::cerr << __LINE__ << ": Geometry mismatch between sequential and concurrent conversion of segment " << segmentIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+      }
+    vtkNew<vtkImageAccumulate> sequentialAccumulate;
+    sequentialAccumulate->SetInputData(sequentialImageData);
+    sequentialAccumulate->IgnoreZeroOn();
+    sequentialAccumulate->Update();
+    vtkNew<vtkImageAccumulate> threadedAccumulate;
+    threadedAccumulate->SetInputData(threadedImageData);
+    threadedAccumulate->IgnoreZeroOn();
+    threadedAccumulate->Update();
+    if (sequentialAccumulate->GetVoxelCount() == 0
+      || sequentialAccumulate->GetVoxelCount() != threadedAccumulate->GetVoxelCount())
+      {
+      std::cerr << __LINE__ << ": Voxel count mismatch between sequential and concurrent conversion of segment " << segmentIndex << "!" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
   //////////////////////////////////////////////////////////////////////////
   // Copy and move segments between segmentations
 
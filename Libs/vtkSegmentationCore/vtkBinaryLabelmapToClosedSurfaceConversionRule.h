@@ -67,6 +67,9 @@ public:
   /// Human-readable name of the converter rule
   virtual const char* GetName()  VTK_OVERRIDE { return "Binary labelmap to closed surface"; };
 
+  /// Copies of the rule share no state and only run VTK filters on their own data
+  virtual bool IsThreadSafe() VTK_OVERRIDE { return true; };
+
   /// Human-readable name of the source representation
   virtual const char* GetSourceRepresentationName() VTK_OVERRIDE { return vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(); };
 
@@ -38,6 +38,7 @@
 #include <vtkStringArray.h>
 #include <vtkAbstractTransform.h>
 #include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkTransform.h>
 #include <vtkPolyData.h>
 #include <vtkTransformPolyDataFilter.h>
@@ -78,6 +79,8 @@ vtkSegmentation::vtkSegmentation()
 
   this->SegmentIdAutogeneratorIndex = 0;
 
+  this->NumberOfConversionThreads = 4;
+
   this->SetMasterRepresentationName(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
 }
 
@@ -141,6 +144,7 @@ void vtkSegmentation::DeepCopy(vtkSegmentation* aSegmentation)
 
   // Copy properties
   this->SetMasterRepresentationName(aSegmentation->GetMasterRepresentationName());
+  this->NumberOfConversionThreads = aSegmentation->NumberOfConversionThreads;
 
   // Copy conversion parameters
   this->Converter->DeepCopy(aSegmentation->Converter);
@@ -171,6 +175,7 @@ void vtkSegmentation::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "MasterRepresentationName:  " << this->MasterRepresentationName << "\n";
   os << indent << "Number of segments:  " << this->Segments.size() << "\n";
+  os << indent << "NumberOfConversionThreads:  " << this->NumberOfConversionThreads << "\n";
 
   for (std::deque< std::string >::iterator segmentIdIt = this->SegmentIds.begin();
     segmentIdIt != this->SegmentIds.end(); ++segmentIdIt)
@@ -969,6 +974,247 @@ bool vtkSegmentation::ConvertSegmentUsingPath(vtkSegment* segment, vtkSegmentati
   return true;
 }
 
+//---------------------------------------------------------------------------
+namespace
+{
+/// Conversion of a segment in a worker thread. The created representations
+/// are stored here and added to the segment on the main thread.
+struct SegmentConversionTask
+{
+  SegmentConversionTask(vtkSegment* segment)
+    : Segment(segment)
+    , Success(true)
+  {
+  }
+  vtkSegment* Segment;
+  std::vector< std::pair< std::string, vtkSmartPointer<vtkDataObject> > > Representations;
+  bool Success;
+  /// Reason of the failure, reported on the main thread
+  std::string ErrorMessage;
+  /// Errors (true) and warnings (false) logged by the conversion rules,
+  /// reported on the main thread
+  std::vector< std::pair<bool, std::string> > Messages;
+};
+
+/// Conversion state of a worker thread. The thread uses its own copy of the
+/// conversion rules, whose errors and warnings are stored in the task being
+/// converted instead of being displayed from the thread.
+struct SegmentConversionThreadState
+{
+  SegmentConversionThreadState()
+    : CurrentTask(NULL)
+  {
+  }
+  vtkSegmentationConverter::ConversionPathType Path;
+  SegmentConversionTask* CurrentTask;
+};
+
+struct SegmentConversionThreadData
+{
+  std::vector<SegmentConversionTask>* Tasks;
+  std::vector<SegmentConversionThreadState> ThreadStates;
+  bool OverwriteExisting;
+};
+
+//---------------------------------------------------------------------------
+void OnConversionRuleMessage(vtkObject* vtkNotUsed(caller), unsigned long eventId, void* clientData, void* callData)
+{
+  SegmentConversionThreadState* state = static_cast<SegmentConversionThreadState*>(clientData);
+  const char* text = static_cast<const char*>(callData);
+  if (state && state->CurrentTask)
+    {
+    state->CurrentTask->Messages.push_back(std::make_pair(eventId == vtkCommand::ErrorEvent, std::string(text ? text : "")));
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkDataObject* GetConvertedRepresentation(SegmentConversionTask& task, const std::string& representationName)
+{
+  for (size_t i = 0; i < task.Representations.size(); ++i)
+    {
+    if (task.Representations[i].first == representationName)
+      {
+      return task.Representations[i].second;
+      }
+    }
+  // The segment is only read from worker threads
+  return task.Segment->GetRepresentation(representationName);
+}
+
+//---------------------------------------------------------------------------
+void ConvertSegmentTask(SegmentConversionTask& task, vtkSegmentationConverter::ConversionPathType& path, bool overwriteExisting)
+{
+  for (vtkSegmentationConverter::ConversionPathType::iterator pathIt = path.begin(); pathIt != path.end(); ++pathIt)
+    {
+    vtkSegmentationConverterRule* currentConversionRule = (*pathIt);
+    vtkDataObject* sourceRepresentation = GetConvertedRepresentation(task, currentConversionRule->GetSourceRepresentationName());
+    if (!sourceRepresentation)
+      {
+      task.Success = false;
+      task.ErrorMessage = std::string("Source representation ") + currentConversionRule->GetSourceRepresentationName()
+        + " of conversion rule " + currentConversionRule->GetName() + " does not exist!";
+      return;
+      }
+    std::string targetRepresentationName = currentConversionRule->GetTargetRepresentationName();
+    if (GetConvertedRepresentation(task, targetRepresentationName) && !overwriteExisting)
+      {
+      continue;
+      }
+    // Always convert into a new object, existing representations are updated on the main thread
+    vtkSmartPointer<vtkDataObject> targetRepresentation = vtkSmartPointer<vtkDataObject>::Take(
+      currentConversionRule->ConstructRepresentationObjectByRepresentation(targetRepresentationName) );
+    if (!targetRepresentation.GetPointer())
+      {
+      task.Success = false;
+      task.ErrorMessage = "Failed to create target representation " + targetRepresentationName
+        + " of conversion rule " + currentConversionRule->GetName() + "!";
+      return;
+      }
+    currentConversionRule->Convert(sourceRepresentation, targetRepresentation);
+    task.Representations.push_back(std::make_pair(targetRepresentationName, targetRepresentation));
+    }
+}
+
+//---------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ConvertSegmentsThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SegmentConversionThreadData* data = static_cast<SegmentConversionThreadData*>(info->UserData);
+  std::vector<SegmentConversionTask>& tasks = *(data->Tasks);
+  SegmentConversionThreadState& state = data->ThreadStates[info->ThreadID];
+  // Each thread converts every NumberOfThreads-th segment
+  for (size_t taskIndex = info->ThreadID; taskIndex < tasks.size(); taskIndex += info->NumberOfThreads)
+    {
+    state.CurrentTask = &tasks[taskIndex];
+    ConvertSegmentTask(tasks[taskIndex], state.Path, data->OverwriteExisting);
+    }
+  state.CurrentTask = NULL;
+  return VTK_THREAD_RETURN_VALUE;
+}
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegmentation::ConvertSegmentsUsingPath(std::vector<vtkSegment*> segments,
+  vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting/*=false*/)
+{
+  bool threadSafePath = true;
+  for (vtkSegmentationConverter::ConversionPathType::iterator pathIt = path.begin(); pathIt != path.end(); ++pathIt)
+    {
+    if (!(*pathIt))
+      {
+      vtkErrorMacro("ConvertSegmentsUsingPath: Invalid converter rule!");
+      return false;
+      }
+    threadSafePath = threadSafePath && (*pathIt)->IsThreadSafe();
+    }
+
+  // Conversion rules may run multi-threaded filters, never use more threads than cores
+  int numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  if (this->NumberOfConversionThreads > 0)
+    {
+    numberOfThreads = std::min(numberOfThreads, this->NumberOfConversionThreads);
+    }
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(segments.size()));
+  numberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  if (numberOfThreads <= 1 || path.empty() || !threadSafePath)
+    {
+    for (std::vector<vtkSegment*>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+      {
+      if (!this->ConvertSegmentUsingPath(*segmentIt, path, overwriteExisting))
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  // Conversion rules keep state, so each thread gets its own copy
+  std::vector<SegmentConversionTask> tasks;
+  for (std::vector<vtkSegment*>::iterator segmentIt = segments.begin(); segmentIt != segments.end(); ++segmentIt)
+    {
+    tasks.push_back(SegmentConversionTask(*segmentIt));
+    }
+  SegmentConversionThreadData threadData;
+  threadData.Tasks = &tasks;
+  threadData.OverwriteExisting = overwriteExisting;
+  threadData.ThreadStates.resize(numberOfThreads);
+  std::vector< vtkSmartPointer<vtkSegmentationConverterRule> > ruleCopies;
+  std::vector< vtkSmartPointer<vtkCallbackCommand> > messageCallbacks;
+  for (int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+    {
+    SegmentConversionThreadState& state = threadData.ThreadStates[threadIndex];
+    vtkSmartPointer<vtkCallbackCommand> messageCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+    messageCallback->SetClientData(&state);
+    messageCallback->SetCallback(OnConversionRuleMessage);
+    messageCallbacks.push_back(messageCallback);
+    for (vtkSegmentationConverter::ConversionPathType::iterator pathIt = path.begin(); pathIt != path.end(); ++pathIt)
+      {
+      vtkSmartPointer<vtkSegmentationConverterRule> ruleCopy = vtkSmartPointer<vtkSegmentationConverterRule>::Take((*pathIt)->Clone());
+      // vtkErrorMacro and vtkWarningMacro invoke the events instead of
+      // displaying the message when they are observed
+      ruleCopy->AddObserver(vtkCommand::ErrorEvent, messageCallback);
+      ruleCopy->AddObserver(vtkCommand::WarningEvent, messageCallback);
+      ruleCopies.push_back(ruleCopy);
+      state.Path.push_back(ruleCopy);
+      }
+    }
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(ConvertSegmentsThreadFunction, &threadData);
+  threader->SingleMethodExecute();
+
+  // Report messages and failures on the main thread
+  bool success = true;
+  for (std::vector<SegmentConversionTask>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+    {
+    std::string segmentId = this->GetSegmentIdBySegment(taskIt->Segment);
+    for (std::vector< std::pair<bool, std::string> >::iterator messageIt = taskIt->Messages.begin();
+      messageIt != taskIt->Messages.end(); ++messageIt)
+      {
+      if (messageIt->first)
+        {
+        vtkErrorMacro("ConvertSegmentsUsingPath: Error while converting segment " << segmentId << ": " << messageIt->second);
+        }
+      else
+        {
+        vtkWarningMacro("ConvertSegmentsUsingPath: Warning while converting segment " << segmentId << ": " << messageIt->second);
+        }
+      }
+    if (!taskIt->Success)
+      {
+      vtkErrorMacro("ConvertSegmentsUsingPath: Failed to convert segment " << segmentId << ": " << taskIt->ErrorMessage);
+      success = false;
+      }
+    }
+  if (!success)
+    {
+    // Do not leave the segmentation partly converted
+    return false;
+    }
+
+  // Store results in the segments
+  for (std::vector<SegmentConversionTask>::iterator taskIt = tasks.begin(); taskIt != tasks.end(); ++taskIt)
+    {
+    for (size_t i = 0; i < taskIt->Representations.size(); ++i)
+      {
+      const std::string& representationName = taskIt->Representations[i].first;
+      vtkDataObject* convertedRepresentation = taskIt->Representations[i].second;
+      vtkDataObject* existingRepresentation = taskIt->Segment->GetRepresentation(representationName);
+      if (existingRepresentation && existingRepresentation->IsA(convertedRepresentation->GetClassName()))
+        {
+        // Update the existing object, as sequential conversion converts in place
+        existingRepresentation->ShallowCopy(convertedRepresentation);
+        }
+      else
+        {
+        taskIt->Segment->AddRepresentation(representationName, convertedRepresentation);
+        }
+      }
+    }
+  return true;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSegmentation::CreateRepresentation(const std::string& targetRepresentationName, bool alwaysConvert/*=false*/)
 {
@@ -1031,17 +1277,28 @@ bool vtkSegmentation::CreateRepresentation(const std::string& targetRepresentati
     }
 
   // Perform conversion on all segments (no overwrites)
+  std::vector<vtkSegment*> segments;
+  std::vector<vtkDataObject*> representationsBefore;
+  std::vector<vtkMTimeType> representationMTimesBefore;
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
     {
     vtkDataObject* representationBefore = segmentIt->second->GetRepresentation(targetRepresentationName);
-    if (!this->ConvertSegmentUsingPath(segmentIt->second, cheapestPath, alwaysConvert))
-      {
-      vtkErrorMacro("CreateRepresentation: Conversion failed");
-      return false;
-      }
+    segments.push_back(segmentIt->second);
+    representationsBefore.push_back(representationBefore);
+    representationMTimesBefore.push_back(representationBefore ? representationBefore->GetMTime() : 0);
+    }
+  if (!this->ConvertSegmentsUsingPath(segments, cheapestPath, alwaysConvert))
+    {
+    vtkErrorMacro("CreateRepresentation: Conversion failed");
+    return false;
+    }
+  int segmentIndex = 0;
+  for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt, ++segmentIndex)
+    {
+    vtkDataObject* representationBefore = representationsBefore[segmentIndex];
     vtkDataObject* representationAfter = segmentIt->second->GetRepresentation(targetRepresentationName);
     if (representationBefore != representationAfter
-      || (representationBefore != NULL && representationAfter != NULL && representationBefore->GetMTime() != representationAfter->GetMTime()) )
+      || (representationAfter != NULL && representationMTimesBefore[segmentIndex] != representationAfter->GetMTime()) )
       {
       // representation has been modified
       const char* segmentId = segmentIt->first.c_str();
@@ -1071,13 +1328,18 @@ bool vtkSegmentation::CreateRepresentation(vtkSegmentationConverter::ConversionP
   this->Converter->SetConversionParameters(parameters);
 
   // Perform conversion on all segments (do overwrites)
+  std::vector<vtkSegment*> segments;
+  for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
+    {
+    segments.push_back(segmentIt->second);
+    }
+  if (!this->ConvertSegmentsUsingPath(segments, path, true))
+    {
+    vtkErrorMacro("CreateRepresentation: Conversion failed");
+    return false;
+    }
   for (SegmentMap::iterator segmentIt = this->Segments.begin(); segmentIt != this->Segments.end(); ++segmentIt)
     {
-    if (!this->ConvertSegmentUsingPath(segmentIt->second, path, true))
-      {
-      vtkErrorMacro("CreateRepresentation: Conversion failed");
-      return false;
-      }
     const char* segmentId = segmentIt->first.c_str();
     this->InvokeEvent(vtkSegmentation::RepresentationModified, (void*)segmentId);
     }
@@ -376,6 +376,16 @@ public:
   /// the segmentation! Use \sa CreateRepresentation for that.
   virtual void SetMasterRepresentationName(const std::string& representationName);
 
+  /// Number of threads used for converting segments in \sa CreateRepresentation.
+  /// Segments are converted concurrently, each thread using its own copy of the conversion rules,
+  /// only if all the rules of the conversion path are thread-safe (\sa vtkSegmentationConverterRule::IsThreadSafe).
+  /// At most the default number of threads of vtkMultiThreader are used, as the conversion
+  /// rules may run multi-threaded filters themselves. Default is 4.
+  /// If 0 then the default number of threads of vtkMultiThreader is used.
+  /// If 1 then segments are converted one by one.
+  vtkSetMacro(NumberOfConversionThreads, int);
+  vtkGetMacro(NumberOfConversionThreads, int);
+
 protected:
   /// Convert given segment along a specified path
   /// \param segment Segment to convert
@@ -385,6 +395,15 @@ protected:
   /// \return Success flag
   bool ConvertSegmentUsingPath(vtkSegment* segment, vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting=false);
 
+  /// Convert given segments along a specified path.
+  /// Conversions run on up to \sa NumberOfConversionThreads threads, then the created representations
+  /// are added to the segments on the calling thread. If any segment fails to be converted concurrently,
+  /// none of the created representations are added. Sequential conversion converts the segments one by one
+  /// in place and stops at the first failure.
+  /// \sa ConvertSegmentUsingPath for the meaning of the arguments
+  /// \return Success flag, false if any of the segments could not be converted
+  bool ConvertSegmentsUsingPath(std::vector<vtkSegment*> segments, vtkSegmentationConverter::ConversionPathType path, bool overwriteExisting=false);
+
   /// Converts a single segment to a representation.
   bool ConvertSingleSegment(std::string segmentId, std::string targetRepresentationName);
 
@@ -443,6 +462,9 @@ protected:
   /// alphabetical order)
   std::deque< std::string > SegmentIds;
 
+  /// Number of threads used for converting segments
+  int NumberOfConversionThreads;
+
   friend class vtkSlicerSegmentationsModuleLogic;
   friend class qMRMLSegmentEditorWidgetPrivate;
 };
@@ -97,6 +97,11 @@ public:
   /// Human-readable name of the converter rule
   virtual const char* GetName() = 0;
 
+  /// Return true if copies of the rule made by \sa Clone can convert different
+  /// segments on different threads at the same time.
+  /// Rules are converted on the calling thread only by default.
+  virtual bool IsThreadSafe() { return false; };
+
   /// Human-readable name of the source representation
   virtual const char* GetSourceRepresentationName() = 0;
 
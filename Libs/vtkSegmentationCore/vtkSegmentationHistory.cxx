@@ -22,21 +22,103 @@
 #include "vtkSegmentationHistory.h"
 #include "vtkSegmentationConverterFactory.h"
 #include "vtkSegmentation.h"
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
 
 // VTK includes
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkCallbackCommand.h>
+#include <vtkDataArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <set>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSegmentationHistory);
 
+namespace
+{
+//----------------------------------------------------------------------------
+/// Returns the representation as image if its voxels can be stored run-length encoded
+vtkOrientedImageData* GetEncodableImage(vtkDataObject* representation)
+{
+  vtkOrientedImageData* image = vtkOrientedImageData::SafeDownCast(representation);
+  if (!image || !image->GetPointData())
+    {
+    return NULL;
+    }
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (!scalars || scalars->GetNumberOfTuples() != image->GetNumberOfPoints())
+    {
+    return NULL;
+    }
+  return image;
+}
+
+//----------------------------------------------------------------------------
+void CopyImageGeometry(vtkOrientedImageData* source, vtkOrientedImageData* destination)
+{
+  destination->SetExtent(source->GetExtent());
+  vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+  source->GetImageToWorldMatrix(imageToWorldMatrix.GetPointer());
+  destination->SetImageToWorldMatrix(imageToWorldMatrix.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+/// Add voxels to the end of the run-length encoded voxel list
+void AppendRun(std::vector<vtkIdType>& runLengths, std::vector<char>& runValues,
+  const char* value, vtkIdType length, int tupleSize)
+{
+  if (!runLengths.empty() && memcmp(&runValues[runValues.size() - tupleSize], value, tupleSize) == 0)
+    {
+    runLengths.back() += length;
+    return;
+    }
+  runLengths.push_back(length);
+  runValues.insert(runValues.end(), value, value + tupleSize);
+}
+
+//----------------------------------------------------------------------------
+/// Release unused capacity, to keep memory usage of stored states minimal
+void ShrinkRuns(std::vector<vtkIdType>& runLengths, std::vector<char>& runValues)
+{
+  std::vector<vtkIdType>(runLengths).swap(runLengths);
+  std::vector<char>(runValues).swap(runValues);
+}
+
+//----------------------------------------------------------------------------
+bool IsExtentEmpty(const int extent[6])
+{
+  return extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5];
+}
+}
+
+//----------------------------------------------------------------------------
+vtkSegmentationHistory::ImageState::ImageState()
+  : ScalarType(VTK_VOID)
+  , NumberOfScalarComponents(0)
+  , Delta(false)
+{
+  this->StoredExtent[0] = 0;
+  this->StoredExtent[1] = -1;
+  this->StoredExtent[2] = 0;
+  this->StoredExtent[3] = -1;
+  this->StoredExtent[4] = 0;
+  this->StoredExtent[5] = -1;
+}
+
 //----------------------------------------------------------------------------
 vtkSegmentationHistory::vtkSegmentationHistory()
 {
   this->Segmentation = NULL;
 
   this->MaximumNumberOfStates = 5;
+  this->MaximumMemorySize = 0;
 
   this->LastRestoredState = 0;
   this->RestoreStateInProgress = false;
@@ -95,6 +177,9 @@ void vtkSegmentationHistory::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Modified Time: " << this->GetMTime() << "\n";
 
   os << indent << "Number of saved states:  " << this->SegmentationStates.size() << "\n";
+  os << indent << "MaximumNumberOfStates:  " << this->MaximumNumberOfStates << "\n";
+  os << indent << "MaximumMemorySize:  " << this->MaximumMemorySize << "\n";
+  os << indent << "MemorySize:  " << this->GetMemorySize() << "\n";
 }
 
 //---------------------------------------------------------------------------
@@ -114,7 +199,14 @@ bool vtkSegmentationHistory::SaveState()
 
   this->RemoveAllNextStates();
 
-  SegmentationState newSegmentationState;
+  // Add the new state in place (references to the previous state remain valid in a deque)
+  SegmentationState* previousSegmentationState = NULL;
+  if (this->SegmentationStates.size() > 0)
+    {
+    previousSegmentationState = &(this->SegmentationStates.back());
+    }
+  this->SegmentationStates.push_back(SegmentationState());
+  SegmentationState& newSegmentationState = this->SegmentationStates.back();
 
   std::vector<std::string> segmentIDs;
   this->Segmentation->GetSegmentIDs(segmentIDs);
@@ -130,19 +222,81 @@ bool vtkSegmentationHistory::SaveState()
     // Previous saved state of the segment
     // (if the new state has exactly the same representation then only a shallow copy will be made)
     vtkSegment* baselineSegment = NULL;
-    if (this->SegmentationStates.size() > 0)
+    ImageStatesMap* previousImageStates = NULL;
+    if (previousSegmentationState)
       {
-      SegmentsMap::iterator baselineSegmentIt = this->SegmentationStates.back().Segments.find(*segmentIDIt);
-      if (baselineSegmentIt != this->SegmentationStates.back().Segments.end())
+      SegmentsMap::iterator baselineSegmentIt = previousSegmentationState->Segments.find(*segmentIDIt);
+      if (baselineSegmentIt != previousSegmentationState->Segments.end())
         {
         baselineSegment = baselineSegmentIt->second.GetPointer();
         }
+      std::map<std::string, ImageStatesMap>::iterator previousImageStatesIt = previousSegmentationState->ImageStates.find(*segmentIDIt);
+      if (previousImageStatesIt != previousSegmentationState->ImageStates.end())
+        {
+        previousImageStates = &(previousImageStatesIt->second);
+        }
       }
     vtkSmartPointer<vtkSegment> segmentClone = vtkSmartPointer<vtkSegment>::New();
     CopySegment(segmentClone, segment, baselineSegment);
     newSegmentationState.Segments[*segmentIDIt] = segmentClone;
+
+    // Store image representations run-length encoded. The new state stores the complete image,
+    // the previous state is changed to store only the voxels that are different from the new state.
+    std::vector<std::string> representationNames;
+    segment->GetContainedRepresentationNames(representationNames);
+    for (std::vector<std::string>::iterator representationNameIt = representationNames.begin();
+      representationNameIt != representationNames.end(); ++representationNameIt)
+      {
+      vtkOrientedImageData* image = GetEncodableImage(segment->GetRepresentation(*representationNameIt));
+      if (!image)
+        {
+        continue;
+        }
+      ImageState& imageState = newSegmentationState.ImageStates[*segmentIDIt][*representationNameIt];
+      imageState.Geometry = vtkSmartPointer<vtkOrientedImageData>::New();
+      CopyImageGeometry(image, imageState.Geometry);
+      imageState.ScalarType = image->GetScalarType();
+      imageState.NumberOfScalarComponents = image->GetNumberOfScalarComponents();
+
+      ImageState* previousImageState = NULL;
+      if (previousImageStates)
+        {
+        ImageStatesMap::iterator previousImageStateIt = previousImageStates->find(*representationNameIt);
+        if (previousImageStateIt != previousImageStates->end()
+          && vtkSegmentationHistory::IsImageCompatible(previousImageStateIt->second, image))
+          {
+          previousImageState = &(previousImageStateIt->second);
+          }
+        }
+      if (!previousImageState)
+        {
+        vtkSegmentationHistory::EncodeImageRegion(image, image->GetExtent(), imageState);
+        imageState.StoredTime.Modified();
+        continue;
+        }
+
+      int changedExtent[6] = { 0, -1, 0, -1, 0, -1 };
+      if (image->GetMTime() > previousImageState->StoredTime.GetMTime()
+        && vtkSegmentationHistory::GetChangedExtent(*previousImageState, image, changedExtent))
+        {
+        ImageState previousImageDelta;
+        vtkSegmentationHistory::ExtractImageRegion(*previousImageState, changedExtent, previousImageDelta);
+        vtkSegmentationHistory::EncodeImageRegion(image, image->GetExtent(), imageState);
+        previousImageState->RunLengths.swap(previousImageDelta.RunLengths);
+        previousImageState->RunValues.swap(previousImageDelta.RunValues);
+        }
+      else
+        {
+        // Image is unchanged, move the stored voxels to the new state
+        imageState.RunLengths.swap(previousImageState->RunLengths);
+        imageState.RunValues.swap(previousImageState->RunValues);
+        std::copy(previousImageState->StoredExtent, previousImageState->StoredExtent + 6, imageState.StoredExtent);
+        }
+      std::copy(changedExtent, changedExtent + 6, previousImageState->StoredExtent);
+      previousImageState->Delta = true;
+      imageState.StoredTime.Modified();
+      }
     }
-  this->SegmentationStates.push_back(newSegmentationState);
 
   // Set the current state as last restored state
   this->LastRestoredState = this->SegmentationStates.size();
@@ -165,6 +319,11 @@ void vtkSegmentationHistory::CopySegment(vtkSegment* destination, vtkSegment* so
     representationNameIt != representationNames.end(); ++representationNameIt)
     {
     vtkDataObject* sourceRepresentation = source->GetRepresentation(*representationNameIt);
+    if (GetEncodableImage(sourceRepresentation))
+      {
+      // Image representations are stored in image states
+      continue;
+      }
     vtkDataObject* baselineRepresentation = NULL;
     if (baseline)
       {
@@ -245,25 +404,45 @@ bool vtkSegmentationHistory::RestoreState(unsigned int stateIndex)
 {
   this->RestoreStateInProgress = true;
 
-  SegmentationState restoredState = this->SegmentationStates[stateIndex];
+  const SegmentationState& restoredState = this->SegmentationStates[stateIndex];
 
   std::set<std::string> segmentIDsToKeep;
-  for (SegmentsMap::iterator restoredSegmentsIt = restoredState.Segments.begin();
+  for (SegmentsMap::const_iterator restoredSegmentsIt = restoredState.Segments.begin();
     restoredSegmentsIt != restoredState.Segments.end(); ++restoredSegmentsIt)
     {
     segmentIDsToKeep.insert(restoredSegmentsIt->first);
     vtkSegment* segment = this->Segmentation->GetSegment(restoredSegmentsIt->first);
-    if (segment != NULL)
+    vtkSmartPointer<vtkSegment> newSegment;
+    if (segment == NULL)
       {
-      segment->DeepCopy(restoredSegmentsIt->second);
-      segment->Modified();
+      newSegment = vtkSmartPointer<vtkSegment>::New();
+      segment = newSegment;
       }
-    else
+    segment->DeepCopy(restoredSegmentsIt->second);
+
+    // Restore image representations
+    std::map<std::string, ImageStatesMap>::const_iterator imageStatesIt = restoredState.ImageStates.find(restoredSegmentsIt->first);
+    if (imageStatesIt != restoredState.ImageStates.end())
+      {
+      for (ImageStatesMap::const_iterator imageStateIt = imageStatesIt->second.begin();
+        imageStateIt != imageStatesIt->second.end(); ++imageStateIt)
+        {
+        vtkSmartPointer<vtkOrientedImageData> image = this->RestoreImage(stateIndex, restoredSegmentsIt->first, imageStateIt->first);
+        if (image)
+          {
+          segment->AddRepresentation(imageStateIt->first, image);
+          }
+        }
+      }
+
+    if (newSegment)
       {
-      vtkSmartPointer<vtkSegment> newSegment = vtkSmartPointer<vtkSegment>::New();
-      newSegment->DeepCopy(restoredSegmentsIt->second);
       this->Segmentation->AddSegment(newSegment);
       }
+    else
+      {
+      segment->Modified();
+      }
     }
 
   // Removed segments that were not in the restored state
@@ -288,6 +467,269 @@ bool vtkSegmentationHistory::RestoreState(unsigned int stateIndex)
   return true;
 }
 
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkOrientedImageData> vtkSegmentationHistory::RestoreImage(unsigned int stateIndex,
+  const std::string& segmentId, const std::string& representationName)
+{
+  // Collect image states from the requested state up to the first complete image
+  std::vector<const ImageState*> imageStates;
+  for (unsigned int index = stateIndex; index < this->SegmentationStates.size(); ++index)
+    {
+    const SegmentationState& state = this->SegmentationStates[index];
+    std::map<std::string, ImageStatesMap>::const_iterator imageStatesIt = state.ImageStates.find(segmentId);
+    if (imageStatesIt == state.ImageStates.end())
+      {
+      break;
+      }
+    ImageStatesMap::const_iterator imageStateIt = imageStatesIt->second.find(representationName);
+    if (imageStateIt == imageStatesIt->second.end())
+      {
+      break;
+      }
+    imageStates.push_back(&(imageStateIt->second));
+    if (!imageStateIt->second.Delta)
+      {
+      break;
+      }
+    }
+  if (imageStates.empty() || imageStates.back()->Delta)
+    {
+    vtkErrorMacro("RestoreImage: Failed to restore " << representationName << " representation of segment " << segmentId);
+    return NULL;
+    }
+
+  // Decode the complete image then apply the differences in reverse order
+  const ImageState* completeImageState = imageStates.back();
+  vtkSmartPointer<vtkOrientedImageData> image = vtkSmartPointer<vtkOrientedImageData>::New();
+  CopyImageGeometry(completeImageState->Geometry, image);
+  image->AllocateScalars(completeImageState->ScalarType, completeImageState->NumberOfScalarComponents);
+  for (std::vector<const ImageState*>::reverse_iterator imageStateIt = imageStates.rbegin();
+    imageStateIt != imageStates.rend(); ++imageStateIt)
+    {
+    vtkSegmentationHistory::DecodeImageRegion(**imageStateIt, image);
+    }
+  return image;
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::StoreCompleteImages(unsigned int stateIndex)
+{
+  SegmentationState& state = this->SegmentationStates[stateIndex];
+  for (std::map<std::string, ImageStatesMap>::iterator imageStatesIt = state.ImageStates.begin();
+    imageStatesIt != state.ImageStates.end(); ++imageStatesIt)
+    {
+    for (ImageStatesMap::iterator imageStateIt = imageStatesIt->second.begin();
+      imageStateIt != imageStatesIt->second.end(); ++imageStateIt)
+      {
+      if (!imageStateIt->second.Delta)
+        {
+        continue;
+        }
+      vtkSmartPointer<vtkOrientedImageData> image = this->RestoreImage(stateIndex, imageStatesIt->first, imageStateIt->first);
+      if (!image)
+        {
+        continue;
+        }
+      vtkSegmentationHistory::EncodeImageRegion(image, image->GetExtent(), imageStateIt->second);
+      imageStateIt->second.Delta = false;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::EncodeImageRegion(vtkOrientedImageData* image, const int region[6], ImageState& imageState)
+{
+  imageState.RunLengths.clear();
+  imageState.RunValues.clear();
+  std::copy(region, region + 6, imageState.StoredExtent);
+  if (IsExtentEmpty(region))
+    {
+    return;
+    }
+
+  int* extent = image->GetExtent();
+  int tupleSize = image->GetScalarSize() * image->GetNumberOfScalarComponents();
+  vtkIdType rowSize = extent[1] - extent[0] + 1;
+  vtkIdType sliceSize = rowSize * (extent[3] - extent[2] + 1);
+  const char* scalars = static_cast<const char*>(image->GetScalarPointer());
+
+  const char* runValue = NULL;
+  vtkIdType runLength = 0;
+  for (int z = region[4]; z <= region[5]; ++z)
+    {
+    for (int y = region[2]; y <= region[3]; ++y)
+      {
+      const char* voxel = scalars + ((z - extent[4]) * sliceSize + (y - extent[2]) * rowSize + (region[0] - extent[0])) * tupleSize;
+      for (int x = region[0]; x <= region[1]; ++x, voxel += tupleSize)
+        {
+        if (runLength > 0 && memcmp(voxel, runValue, tupleSize) == 0)
+          {
+          ++runLength;
+          continue;
+          }
+        if (runLength > 0)
+          {
+          AppendRun(imageState.RunLengths, imageState.RunValues, runValue, runLength, tupleSize);
+          }
+        runValue = voxel;
+        runLength = 1;
+        }
+      }
+    }
+  if (runLength > 0)
+    {
+    AppendRun(imageState.RunLengths, imageState.RunValues, runValue, runLength, tupleSize);
+    }
+  ShrinkRuns(imageState.RunLengths, imageState.RunValues);
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::ExtractImageRegion(const ImageState& completeImageState, const int region[6], ImageState& regionImageState)
+{
+  regionImageState.RunLengths.clear();
+  regionImageState.RunValues.clear();
+  std::copy(region, region + 6, regionImageState.StoredExtent);
+  if (IsExtentEmpty(region))
+    {
+    return;
+    }
+
+  const int* extent = completeImageState.StoredExtent;
+  int tupleSize = vtkDataArray::GetDataTypeSize(completeImageState.ScalarType) * completeImageState.NumberOfScalarComponents;
+  vtkIdType rowSize = extent[1] - extent[0] + 1;
+  vtkIdType columnSize = extent[3] - extent[2] + 1;
+
+  // Walk through the runs row by row and keep the parts that are inside the region
+  vtkIdType voxelIndex = 0;
+  for (size_t runIndex = 0; runIndex < completeImageState.RunLengths.size(); ++runIndex)
+    {
+    const char* runValue = &completeImageState.RunValues[runIndex * tupleSize];
+    vtkIdType remainingLength = completeImageState.RunLengths[runIndex];
+    while (remainingLength > 0)
+      {
+      vtkIdType x = extent[0] + voxelIndex % rowSize;
+      vtkIdType row = voxelIndex / rowSize;
+      vtkIdType y = extent[2] + row % columnSize;
+      vtkIdType z = extent[4] + row / columnSize;
+      vtkIdType length = std::min(remainingLength, extent[1] - x + 1);
+      if (y >= region[2] && y <= region[3] && z >= region[4] && z <= region[5])
+        {
+        vtkIdType first = std::max(x, static_cast<vtkIdType>(region[0]));
+        vtkIdType last = std::min(x + length - 1, static_cast<vtkIdType>(region[1]));
+        if (first <= last)
+          {
+          AppendRun(regionImageState.RunLengths, regionImageState.RunValues, runValue, last - first + 1, tupleSize);
+          }
+        }
+      voxelIndex += length;
+      remainingLength -= length;
+      }
+    }
+  ShrinkRuns(regionImageState.RunLengths, regionImageState.RunValues);
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::DecodeImageRegion(const ImageState& imageState, vtkOrientedImageData* image)
+{
+  const int* region = imageState.StoredExtent;
+  if (IsExtentEmpty(region) || imageState.RunLengths.empty())
+    {
+    return;
+    }
+
+  int* extent = image->GetExtent();
+  int tupleSize = image->GetScalarSize() * image->GetNumberOfScalarComponents();
+  vtkIdType rowSize = extent[1] - extent[0] + 1;
+  vtkIdType sliceSize = rowSize * (extent[3] - extent[2] + 1);
+  char* scalars = static_cast<char*>(image->GetScalarPointer());
+
+  size_t runIndex = 0;
+  vtkIdType remainingLength = imageState.RunLengths[0];
+  for (int z = region[4]; z <= region[5]; ++z)
+    {
+    for (int y = region[2]; y <= region[3]; ++y)
+      {
+      char* voxel = scalars + ((z - extent[4]) * sliceSize + (y - extent[2]) * rowSize + (region[0] - extent[0])) * tupleSize;
+      for (int x = region[0]; x <= region[1]; ++x, voxel += tupleSize)
+        {
+        while (remainingLength == 0)
+          {
+          if (++runIndex >= imageState.RunLengths.size())
+            {
+            return;
+            }
+          remainingLength = imageState.RunLengths[runIndex];
+          }
+        memcpy(voxel, &imageState.RunValues[runIndex * tupleSize], tupleSize);
+        --remainingLength;
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegmentationHistory::GetChangedExtent(const ImageState& completeImageState, vtkOrientedImageData* image, int changedExtent[6])
+{
+  int* extent = image->GetExtent();
+  int tupleSize = image->GetScalarSize() * image->GetNumberOfScalarComponents();
+  vtkIdType rowSize = extent[1] - extent[0] + 1;
+  vtkIdType columnSize = extent[3] - extent[2] + 1;
+  const char* voxel = static_cast<const char*>(image->GetScalarPointer());
+
+  bool changed = false;
+  vtkIdType voxelIndex = 0;
+  for (size_t runIndex = 0; runIndex < completeImageState.RunLengths.size(); ++runIndex)
+    {
+    const char* runValue = &completeImageState.RunValues[runIndex * tupleSize];
+    vtkIdType runLength = completeImageState.RunLengths[runIndex];
+    for (vtkIdType i = 0; i < runLength; ++i, ++voxelIndex, voxel += tupleSize)
+      {
+      if (memcmp(voxel, runValue, tupleSize) == 0)
+        {
+        continue;
+        }
+      int x = extent[0] + static_cast<int>(voxelIndex % rowSize);
+      vtkIdType row = voxelIndex / rowSize;
+      int y = extent[2] + static_cast<int>(row % columnSize);
+      int z = extent[4] + static_cast<int>(row / columnSize);
+      if (!changed)
+        {
+        changedExtent[0] = changedExtent[1] = x;
+        changedExtent[2] = changedExtent[3] = y;
+        changedExtent[4] = changedExtent[5] = z;
+        changed = true;
+        continue;
+        }
+      changedExtent[0] = std::min(changedExtent[0], x);
+      changedExtent[1] = std::max(changedExtent[1], x);
+      changedExtent[2] = std::min(changedExtent[2], y);
+      changedExtent[3] = std::max(changedExtent[3], y);
+      changedExtent[4] = std::min(changedExtent[4], z);
+      changedExtent[5] = std::max(changedExtent[5], z);
+      }
+    }
+  return changed;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSegmentationHistory::IsImageCompatible(const ImageState& imageState, vtkOrientedImageData* image)
+{
+  if (imageState.Delta || !imageState.Geometry)
+    {
+    return false;
+    }
+  if (imageState.ScalarType != image->GetScalarType()
+    || imageState.NumberOfScalarComponents != image->GetNumberOfScalarComponents())
+    {
+    return false;
+    }
+  if (!vtkOrientedImageDataResample::DoExtentsMatch(imageState.Geometry, image))
+    {
+    return false;
+    }
+  return vtkOrientedImageDataResample::DoGeometriesMatch(imageState.Geometry, image);
+}
+
 //---------------------------------------------------------------------------
 bool vtkSegmentationHistory::IsRestorePreviousStateAvailable()
 {
@@ -311,6 +753,11 @@ bool vtkSegmentationHistory::IsRestoreNextStateAvailable()
 void vtkSegmentationHistory::RemoveAllNextStates()
 {
   bool modified = false;
+  if (this->SegmentationStates.size() > this->LastRestoredState + 1)
+    {
+    // The last restored state may store only differences relative to the states that are removed now
+    this->StoreCompleteImages(this->LastRestoredState);
+    }
   while ((this->SegmentationStates.size() > this->LastRestoredState + 1) && (!this->SegmentationStates.empty()))
     {
     this->SegmentationStates.pop_back();
@@ -326,10 +773,15 @@ void vtkSegmentationHistory::RemoveAllNextStates()
 void vtkSegmentationHistory::RemoveAllObsoleteStates()
 {
   bool modified = false;
-  while ((this->SegmentationStates.size() > this->MaximumNumberOfStates) && (!this->SegmentationStates.empty()))
+  while (!this->SegmentationStates.empty()
+    && (this->SegmentationStates.size() > this->MaximumNumberOfStates
+      || (this->MaximumMemorySize > 0 && this->SegmentationStates.size() > 1 && this->GetMemorySize() > this->MaximumMemorySize)))
     {
     this->SegmentationStates.pop_front();
-    this->LastRestoredState--;
+    if (this->LastRestoredState > 0)
+      {
+      this->LastRestoredState--;
+      }
     modified = true;
    }
   if (modified)
@@ -350,6 +802,56 @@ void vtkSegmentationHistory::SetMaximumNumberOfStates(unsigned int maximumNumber
   this->Modified();
 }
 
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::SetMaximumMemorySize(vtkTypeInt64 maximumMemorySize)
+{
+  if (maximumMemorySize == this->MaximumMemorySize)
+    {
+    return;
+    }
+  this->MaximumMemorySize = maximumMemorySize;
+  this->RemoveAllObsoleteStates();
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+vtkTypeInt64 vtkSegmentationHistory::GetMemorySize()
+{
+  vtkTypeInt64 memorySize = 0;
+  // Unchanged representations are shared between states, count them only once
+  std::set<vtkDataObject*> countedRepresentations;
+  for (std::deque<SegmentationState>::iterator stateIt = this->SegmentationStates.begin();
+    stateIt != this->SegmentationStates.end(); ++stateIt)
+    {
+    for (SegmentsMap::iterator segmentIt = stateIt->Segments.begin(); segmentIt != stateIt->Segments.end(); ++segmentIt)
+      {
+      std::vector<std::string> representationNames;
+      segmentIt->second->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator representationNameIt = representationNames.begin();
+        representationNameIt != representationNames.end(); ++representationNameIt)
+        {
+        vtkDataObject* representation = segmentIt->second->GetRepresentation(*representationNameIt);
+        if (representation && countedRepresentations.insert(representation).second)
+          {
+          // GetActualMemorySize returns kibibytes
+          memorySize += static_cast<vtkTypeInt64>(representation->GetActualMemorySize()) * 1024;
+          }
+        }
+      }
+    for (std::map<std::string, ImageStatesMap>::iterator imageStatesIt = stateIt->ImageStates.begin();
+      imageStatesIt != stateIt->ImageStates.end(); ++imageStatesIt)
+      {
+      for (ImageStatesMap::iterator imageStateIt = imageStatesIt->second.begin();
+        imageStateIt != imageStatesIt->second.end(); ++imageStateIt)
+        {
+        memorySize += static_cast<vtkTypeInt64>(imageStateIt->second.RunLengths.size() * sizeof(vtkIdType)
+          + imageStateIt->second.RunValues.size());
+        }
+      }
+    }
+  return memorySize;
+}
+
 //---------------------------------------------------------------------------
 void vtkSegmentationHistory::OnSegmentationModified(vtkObject* vtkNotUsed(caller),
   unsigned long vtkNotUsed(eid),
@@ -24,6 +24,7 @@
 // VTK includes
 #include <vtkObject.h>
 #include <vtkSmartPointer.h>
+#include <vtkTimeStamp.h>
 
 // STD includes
 #include <deque>
@@ -33,10 +34,16 @@
 #include "vtkSegmentationCoreConfigure.h"
 
 class vtkCallbackCommand;
+class vtkOrientedImageData;
 class vtkSegment;
 class vtkSegmentation;
 
 /// \ingroup SegmentationCore
+/// \brief Stores previous states of a segmentation for undo/redo
+///
+/// Image representations (such as binary labelmaps) are stored run-length encoded.
+/// Only the most recent state of an image is stored completely, older states only
+/// store the bounding box of voxels that are different from the next state.
 class vtkSegmentationCore_EXPORT vtkSegmentationHistory : public vtkObject
 {
 public:
@@ -82,6 +89,17 @@ public:
   /// Get the limit of how many states may be stored.
   vtkGetMacro(MaximumNumberOfStates, unsigned int);
 
+  /// Limits how much memory (in bytes) the stored states may use.
+  /// If the limit is exceeded then the oldest states are removed. The most recent state is always kept.
+  /// 0 means there is no limit (this is the default).
+  void SetMaximumMemorySize(vtkTypeInt64 maximumMemorySize);
+
+  /// Get the limit of how much memory (in bytes) the stored states may use.
+  vtkGetMacro(MaximumMemorySize, vtkTypeInt64);
+
+  /// Get the memory (in bytes) used by all the stored states.
+  vtkTypeInt64 GetMemorySize();
+
 protected:
   /// Callback function called when the segmentation has been modified.
   /// It clears all states that are more recent than the last restored state.
@@ -96,6 +114,11 @@ protected:
   /// Restores a state defined by stateIndex.
   bool RestoreState(unsigned int stateIndex);
 
+  /// Reconstructs an image representation of a segment in the specified state
+  /// by applying the stored differences to the most recent complete image.
+  vtkSmartPointer<vtkOrientedImageData> RestoreImage(unsigned int stateIndex,
+    const std::string& segmentId, const std::string& representationName);
+
 protected:
   vtkSegmentationHistory();
   ~vtkSegmentationHistory();
@@ -103,21 +126,65 @@ protected:
 
   /// Deep copies source segment to destination segment. If the same representation is found in baseline
   /// with up-to-date timestamp then the representation is reused from baseline.
+  /// Image representations are not copied, as they are stored in ImageStates instead.
   void CopySegment(vtkSegment* destination, vtkSegment* source, vtkSegment* baseline);
 
 protected:  /// Container type for segments. Maps segment IDs to segment objects
   typedef std::map<std::string, vtkSmartPointer<vtkSegment> > SegmentsMap;
 
+  /// Run-length encoded voxels of an image representation
+  struct ImageState
+    {
+    ImageState();
+    /// Geometry of the image (scalars are not allocated)
+    vtkSmartPointer<vtkOrientedImageData> Geometry;
+    int ScalarType;
+    int NumberOfScalarComponents;
+    /// If true then only voxels that are different from the same image in the next state are stored
+    bool Delta;
+    /// Extent of the stored voxels. Empty if no voxels are stored.
+    int StoredExtent[6];
+    /// Number of voxels and voxel value of each run
+    std::vector<vtkIdType> RunLengths;
+    std::vector<char> RunValues;
+    /// Time when the image was stored, used for detecting unchanged images without comparing voxels
+    vtkTimeStamp StoredTime;
+    };
+  /// Maps representation names to image states
+  typedef std::map<std::string, ImageState> ImageStatesMap;
+
   struct SegmentationState
     {
-    SegmentsMap Segments;
+    SegmentsMap Segments; // segment metadata and non-image representations
+    std::map<std::string, ImageStatesMap> ImageStates; // image representations of each segment
     std::vector<std::string> SegmentIds; // order of segments
     };
 
+  /// Store the voxels of the image within the region extent
+  static void EncodeImageRegion(vtkOrientedImageData* image, const int region[6], ImageState& imageState);
+
+  /// Store voxels of the region extent from a complete image state
+  static void ExtractImageRegion(const ImageState& completeImageState, const int region[6], ImageState& regionImageState);
+
+  /// Write the stored voxels into the image
+  static void DecodeImageRegion(const ImageState& imageState, vtkOrientedImageData* image);
+
+  /// Get bounding extent of voxels that are different in a complete image state and the image.
+  /// \return True if any voxels are different
+  static bool GetChangedExtent(const ImageState& completeImageState, vtkOrientedImageData* image, int changedExtent[6]);
+
+  /// Returns true if the image can be stored in the image state as a difference
+  static bool IsImageCompatible(const ImageState& imageState, vtkOrientedImageData* image);
+
+  /// Replace stored differences in a state by complete images.
+  /// Required before the states that the differences are relative to are removed.
+  void StoreCompleteImages(unsigned int stateIndex);
+
   vtkSegmentation* Segmentation;
   vtkCallbackCommand* SegmentationModifiedCallbackCommand;
   std::deque<SegmentationState> SegmentationStates;
   unsigned int MaximumNumberOfStates;
+  vtkTypeInt64 MaximumMemorySize;
 
   // Index of the state in SegmentationStates that was restored last.
   // If index == size of states then it means that the segmentation has changed
@@ -0,0 +1,272 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// vtkTeem includes
+#include <vtkDiffusionTensorMathematics.h>
+
+// VTK includes
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Symmetric tensor R^T diag(e) R with R a random rotation
+void RandomTensor(double e0, double e1, double e2, bool rotate, float tensor[9])
+{
+  double q[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
+  if (rotate)
+    {
+    double axis[3] = {vtkMath::Random(-1., 1.), vtkMath::Random(-1., 1.), vtkMath::Random(-1., 1.)};
+    vtkMath::Normalize(axis);
+    double quaternion[4];
+    const double angle = vtkMath::Random(0., vtkMath::Pi());
+    quaternion[0] = cos(angle / 2.);
+    for (int i = 0; i < 3; ++i)
+      {
+      quaternion[i + 1] = sin(angle / 2.) * axis[i];
+      }
+    vtkMath::QuaternionToMatrix3x3(quaternion, q);
+    }
+  const double e[3] = {e0, e1, e2};
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      double value = 0.;
+      for (int k = 0; k < 3; ++k)
+        {
+        value += q[k][i] * e[k] * q[k][j];
+        }
+      tensor[3 * i + j] = static_cast<float>(value);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+bool CompareWithTeem(const float tensor[9], const double w[3], const double v[9])
+{
+  // TeemEigenSolver reads the transposed tensor
+  double m0[3], m1[3], m2[3], *m[3] = {m0, m1, m2};
+  double v0[3], v1[3], v2[3], *tv[3] = {v0, v1, v2};
+  double tw[3];
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      m[i][j] = tensor[3 * j + i];
+      }
+    }
+  vtkDiffusionTensorMathematics::TeemEigenSolver(m, tw, tv);
+
+  // Tensors are float: compare relatively to the largest eigenvalue
+  const double scale = std::max(std::max(fabs(tw[0]), fabs(tw[2])), 1e-30);
+  for (int k = 0; k < 3; ++k)
+    {
+    if (fabs(w[k] - tw[k]) > 1e-6 * scale)
+      {
+      std::cerr << "Eigenvalue " << k << " is " << w[k] << ", teem gives " << tw[k] << std::endl;
+      return false;
+      }
+    }
+  // Eigenvectors are only defined (up to their sign) for separated eigenvalues
+  for (int k = 0; k < 3; ++k)
+    {
+    const double gap = std::min(k > 0 ? tw[k - 1] - tw[k] : VTK_DOUBLE_MAX,
+                                k < 2 ? tw[k] - tw[k + 1] : VTK_DOUBLE_MAX);
+    if (gap < 1e-3 * scale)
+      {
+      continue;
+      }
+    const double dot = v[k] * tv[0][k] + v[3 + k] * tv[1][k] + v[6 + k] * tv[2][k];
+    if (fabs(fabs(dot) - 1.) > 1e-5)
+      {
+      std::cerr << "Eigenvector " << k << " differs from teem: dot product " << dot << std::endl;
+      return false;
+      }
+    }
+  // The eigenvectors are always orthonormal
+  for (int k = 0; k < 3; ++k)
+    {
+    for (int l = 0; l < 3; ++l)
+      {
+      const double dot = v[k] * v[l] + v[3 + k] * v[3 + l] + v[6 + k] * v[6 + l];
+      if (fabs(dot - (k == l ? 1. : 0.)) > 1e-10)
+        {
+        std::cerr << "Eigenvectors " << k << " and " << l << " are not orthonormal" << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool CompareOutputs(vtkImageData* expected, vtkImageData* actual, int operation)
+{
+  vtkDataArray* expectedScalars = expected->GetPointData()->GetScalars();
+  vtkDataArray* actualScalars = actual->GetPointData()->GetScalars();
+  if (!expectedScalars || !actualScalars ||
+      expectedScalars->GetDataType() != actualScalars->GetDataType() ||
+      expectedScalars->GetNumberOfTuples() != actualScalars->GetNumberOfTuples() ||
+      expectedScalars->GetNumberOfComponents() != actualScalars->GetNumberOfComponents())
+    {
+    std::cerr << "Operation " << operation << ": outputs differ in layout" << std::endl;
+    return false;
+    }
+  for (vtkIdType i = 0; i < expectedScalars->GetNumberOfTuples(); ++i)
+    {
+    for (int c = 0; c < expectedScalars->GetNumberOfComponents(); ++c)
+      {
+      const double a = expectedScalars->GetComponent(i, c);
+      const double b = actualScalars->GetComponent(i, c);
+      if (a != b && !(vtkMath::IsNan(a) && vtkMath::IsNan(b)))
+        {
+        std::cerr << "Operation " << operation << ": voxel " << i << " component " << c
+                  << " is " << b << " instead of " << a << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+}
+
+//----------------------------------------------------------------------------
+int vtkDiffusionTensorMathematicsTest2(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkMath::RandomSeed(2017);
+
+  // Batched solver against teem on random and degenerate tensors
+  const int numberOfTensors = 10000;
+  std::vector<float> tensors(9 * numberOfTensors);
+  for (int i = 0; i < numberOfTensors; ++i)
+    {
+    double e[3] = {vtkMath::Random(0., 3e-3), vtkMath::Random(0., 3e-3), vtkMath::Random(-1e-4, 3e-3)};
+    switch (i % 6)
+      {
+      case 1: e[1] = e[0]; break;          // oblate
+      case 2: e[2] = e[1]; break;          // prolate
+      case 3: e[1] = e[2] = e[0]; break;   // isotropic
+      case 4: e[0] = e[1] = e[2] = 0.; break;
+      default: break;
+      }
+    RandomTensor(e[0], e[1], e[2], i % 12 != 5, &tensors[9 * i]);
+    }
+  std::vector<double> w(3 * numberOfTensors);
+  std::vector<double> v(9 * numberOfTensors);
+  vtkDiffusionTensorMathematics::BatchEigenSolver(&tensors[0], numberOfTensors, &w[0], &v[0]);
+  for (int i = 0; i < numberOfTensors; ++i)
+    {
+    if (!CompareWithTeem(&tensors[9 * i], &w[3 * i], &v[9 * i]))
+      {
+      std::cerr << "Tensor " << i << " failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  // Eigenvalues only
+  std::vector<double> wOnly(3 * numberOfTensors);
+  vtkDiffusionTensorMathematics::BatchEigenSolver(&tensors[0], numberOfTensors, &wOnly[0], NULL);
+  if (wOnly != w)
+    {
+    std::cerr << "Eigenvalues depend on the computation of the eigenvectors" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Several maps in one pass give the same results as separate executions
+  vtkNew<vtkImageData> tensorImage;
+  tensorImage->SetDimensions(25, 20, 20);
+  vtkNew<vtkFloatArray> tensorArray;
+  tensorArray->SetNumberOfComponents(9);
+  tensorArray->SetName("tensors");
+  tensorArray->SetNumberOfTuples(tensorImage->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < tensorImage->GetNumberOfPoints(); ++i)
+    {
+    tensorArray->SetTypedTuple(i, &tensors[9 * (i % numberOfTensors)]);
+    }
+  tensorImage->GetPointData()->SetTensors(tensorArray.GetPointer());
+
+  const int operations[4] = {
+    vtkDiffusionTensorMathematics::VTK_TENS_FRACTIONAL_ANISOTROPY,
+    vtkDiffusionTensorMathematics::VTK_TENS_MEAN_DIFFUSIVITY,
+    vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION,
+    vtkDiffusionTensorMathematics::VTK_TENS_TRACE};
+  vtkNew<vtkDiffusionTensorMathematics> multiFilter;
+  multiFilter->SetInputData(tensorImage.GetPointer());
+  multiFilter->SetOperation(operations[0]);
+  for (int i = 1; i < 4; ++i)
+    {
+    multiFilter->AddAdditionalOperation(operations[i]);
+    }
+  if (multiFilter->GetNumberOfOutputPorts() != 4 ||
+      multiFilter->GetNumberOfAdditionalOperations() != 3 ||
+      multiFilter->GetOutputOperation(2) != operations[2])
+    {
+    std::cerr << "Additional operations are not mapped to output ports" << std::endl;
+    return EXIT_FAILURE;
+    }
+  multiFilter->Update();
+  for (int i = 0; i < 4; ++i)
+    {
+    vtkNew<vtkDiffusionTensorMathematics> filter;
+    filter->SetInputData(tensorImage.GetPointer());
+    filter->SetOperation(operations[i]);
+    filter->Update();
+    if (!CompareOutputs(filter->GetOutput(), multiFilter->GetOutput(i), operations[i]))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  // Scalar maps of a whole-brain DTI volume in one pass
+  vtkNew<vtkImageData> brainImage;
+  brainImage->SetDimensions(128, 128, 70);
+  vtkNew<vtkFloatArray> brainArray;
+  brainArray->SetNumberOfComponents(9);
+  brainArray->SetName("tensors");
+  brainArray->SetNumberOfTuples(brainImage->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < brainImage->GetNumberOfPoints(); ++i)
+    {
+    brainArray->SetTypedTuple(i, &tensors[9 * (i % numberOfTensors)]);
+    }
+  brainImage->GetPointData()->SetTensors(brainArray.GetPointer());
+  vtkNew<vtkDiffusionTensorMathematics> brainFilter;
+  brainFilter->SetInputData(brainImage.GetPointer());
+  brainFilter->SetOperation(vtkDiffusionTensorMathematics::VTK_TENS_FRACTIONAL_ANISOTROPY);
+  brainFilter->AddAdditionalOperation(vtkDiffusionTensorMathematics::VTK_TENS_MEAN_DIFFUSIVITY);
+  brainFilter->AddAdditionalOperation(vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION);
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  brainFilter->Update();
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"WholeBrainScalarMaps\" "
+            << "type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  multiFilter->RemoveAllAdditionalOperations();
+  if (multiFilter->GetNumberOfOutputPorts() != 1)
+    {
+    std::cerr << "Additional operations were not removed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkTeemNRRDReader.h>
+#include <vtkTeemNRRDWriter.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CompareExtent(vtkImageData* expected, vtkImageData* actual, const int extent[6])
+{
+  int actualExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  actual->GetExtent(actualExtent);
+  for (int i = 0; i < 6; ++i)
+    {
+    if (actualExtent[i] != extent[i])
+      {
+      std::cerr << "Read extent differs from the update extent" << std::endl;
+      return false;
+      }
+    }
+  if (actual->GetScalarType() != VTK_SHORT
+    || actual->GetNumberOfScalarComponents() != expected->GetNumberOfScalarComponents())
+    {
+    std::cerr << "Read scalars have a different type" << std::endl;
+    return false;
+    }
+  const int numberOfComponents = expected->GetNumberOfScalarComponents();
+  for (int z = extent[4]; z <= extent[5]; ++z)
+    {
+    for (int y = extent[2]; y <= extent[3]; ++y)
+      {
+      for (int x = extent[0]; x <= extent[1]; ++x)
+        {
+        const short* expectedPixel = static_cast<short*>(expected->GetScalarPointer(x, y, z));
+        const short* actualPixel = static_cast<short*>(actual->GetScalarPointer(x, y, z));
+        for (int c = 0; c < numberOfComponents; ++c)
+          {
+          if (expectedPixel[c] != actualPixel[c])
+            {
+            std::cerr << "Voxel (" << x << ", " << y << ", " << z << ") component " << c
+                      << " is " << actualPixel[c] << ", expected " << expectedPixel[c] << std::endl;
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool TestReadWrite(vtkImageData* image, const std::string& fileName, bool useCompression)
+{
+  vtkNew<vtkTeemNRRDWriter> writer;
+  writer->SetInputData(image);
+  writer->SetFileName(fileName.c_str());
+  writer->SetUseCompression(useCompression);
+  writer->Write();
+  if (writer->GetWriteError())
+    {
+    std::cerr << "Failed to write " << fileName << std::endl;
+    return false;
+    }
+
+  int wholeExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  image->GetExtent(wholeExtent);
+  // slab of slices, a single row and a sub-volume
+  const int extents[3][6] =
+    {
+      { wholeExtent[0], wholeExtent[1], wholeExtent[2], wholeExtent[3], 3, 7 },
+      { wholeExtent[0], wholeExtent[1], 5, 5, 2, 2 },
+      { 4, 17, 3, 11, 1, 9 }
+    };
+
+  for (int useMemoryMapping = 0; useMemoryMapping < 2; ++useMemoryMapping)
+    {
+    vtkNew<vtkTeemNRRDReader> reader;
+    reader->SetFileName(fileName.c_str());
+    reader->SetUseMemoryMapping(useMemoryMapping != 0);
+    reader->SetNumberOfThreads(4);
+    reader->Update();
+    if (!CompareExtent(image, reader->GetOutput(), wholeExtent))
+      {
+      std::cerr << "Failed to read " << fileName << " with memory mapping "
+                << useMemoryMapping << std::endl;
+      return false;
+      }
+    for (int i = 0; i < 3; ++i)
+      {
+      int extent[6] = { 0 };
+      std::copy(extents[i], extents[i] + 6, extent);
+      reader->UpdateExtent(extent);
+      if (!CompareExtent(image, reader->GetOutput(), extent))
+        {
+        std::cerr << "Failed to read extent " << i << " of " << fileName
+                  << " with memory mapping " << useMemoryMapping << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkTeemNRRDReaderTest1(int argc, char* argv[])
+{
+  if (argc != 2)
+    {
+    std::cerr << "Line " << __LINE__
+              << " - Missing parameters !\n"
+              << "Usage: " << argv[0] << " /path/to/temp"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(23, 17, 13);
+  image->AllocateScalars(VTK_SHORT, 3);
+  short* voxels = static_cast<short*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints() * 3; ++i)
+    {
+    voxels[i] = static_cast<short>((i * 7919) % 65536 - 32768);
+    }
+
+  if (!TestReadWrite(image.GetPointer(), tempDir + "/vtkTeemNRRDReaderTest1Raw.nrrd", false)
+    || !TestReadWrite(image.GetPointer(), tempDir + "/vtkTeemNRRDReaderTest1Gzip.nrrd", true)
+    || !TestReadWrite(image.GetPointer(), tempDir + "/vtkTeemNRRDReaderTest1Raw.nhdr", false)
+    || !TestReadWrite(image.GetPointer(), tempDir + "/vtkTeemNRRDReaderTest1Gzip.nhdr", true))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkTeemNRRDReader.h>
+#include <vtkTeemNRRDWriter.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool WriteAndRead(vtkImageData* image, const std::string& fileName,
+                  int parallelCompression, int compressionLevel, int numberOfThreads)
+{
+  const double dataSize = static_cast<double>(image->GetNumberOfPoints())
+    * image->GetNumberOfScalarComponents() * image->GetScalarSize();
+
+  vtkNew<vtkTeemNRRDWriter> writer;
+  writer->SetInputData(image);
+  writer->SetFileName(fileName.c_str());
+  writer->SetUseCompression(1);
+  writer->SetParallelCompression(parallelCompression);
+  writer->SetCompressionLevel(compressionLevel);
+  writer->SetNumberOfThreads(numberOfThreads);
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  writer->Write();
+  timer->StopTimer();
+  if (writer->GetWriteError())
+    {
+    std::cerr << "Failed to write " << fileName << std::endl;
+    return false;
+    }
+  std::cout << "Compression " << (parallelCompression ? "parallel" : "single stream")
+            << ", level " << compressionLevel << ", " << numberOfThreads << " thread(s): "
+            << dataSize / (1024. * 1024.) / std::max(timer->GetElapsedTime(), 1e-6)
+            << " MB/s" << std::endl;
+
+  vtkNew<vtkTeemNRRDReader> reader;
+  reader->SetFileName(fileName.c_str());
+  reader->Update();
+  vtkImageData* readImage = reader->GetOutput();
+  if (readImage->GetNumberOfPoints() != image->GetNumberOfPoints()
+    || readImage->GetScalarType() != image->GetScalarType()
+    || memcmp(readImage->GetScalarPointer(), image->GetScalarPointer(),
+      static_cast<size_t>(dataSize)) != 0)
+    {
+    std::cerr << "Voxels read from " << fileName << " differ from the written ones" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkTeemNRRDWriterTest1(int argc, char* argv[])
+{
+  if (argc != 2)
+    {
+    std::cerr << "Line " << __LINE__
+              << " - Missing parameters !\n"
+              << "Usage: " << argv[0] << " /path/to/temp"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+
+  // Smooth ramp with some noise, compressible like a typical scan
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(256, 256, 64);
+  image->AllocateScalars(VTK_SHORT, 1);
+  short* voxels = static_cast<short*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i)
+    {
+    voxels[i] = static_cast<short>((i / 256) % 2000 + (i * 7919) % 17);
+    }
+
+  const std::string fileName = tempDir + "/vtkTeemNRRDWriterTest1.nrrd";
+  if (!WriteAndRead(image.GetPointer(), fileName, 0, -1, 1)
+    || !WriteAndRead(image.GetPointer(), fileName, 1, -1, 1)
+    || !WriteAndRead(image.GetPointer(), fileName, 1, -1, 0)
+    || !WriteAndRead(image.GetPointer(), fileName, 1, 1, 0)
+    || !WriteAndRead(image.GetPointer(), fileName, 1, 0, 0))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Detached headers use the single stream compression
+  if (!WriteAndRead(image.GetPointer(), tempDir + "/vtkTeemNRRDWriterTest1.nhdr", 1, -1, 0))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -161,7 +161,6 @@ int vtkDiffusionTensorGlyph::RequestData(
   vtkDataArray *inTensors;
   vtkDataArray *inScalars;
   vtkIdType numPts, numSourcePts, numSourceCells, inPtId, i;
-  int j;
   vtkPoints *sourcePts;
   vtkDataArray *sourceNormals;
   vtkCellArray *sourceCells, *cells;
@@ -178,9 +177,8 @@ int vtkDiffusionTensorGlyph::RequestData(
   vtkIdType subIncr;
   int numDirs, dir, eigen_dir, symmetric_dir;
   vtkMatrix4x4 *matrix;
-  double *m[3], w[3], *v[3];
-  double m0[3], m1[3], m2[3];
-  double v0[3], v1[3], v2[3];
+  double w[3], *v[3];
+  double evec[9];
   double xv[3], yv[3], zv[3];
   double maxScale;
   vtkPointData *pd, *outPD;
@@ -208,9 +206,8 @@ int vtkDiffusionTensorGlyph::RequestData(
   trans = vtkTransform::New();
   matrix = vtkMatrix4x4::New();
 
-  // set up working matrices
-  m[0] = m0; m[1] = m1; m[2] = m2;
-  v[0] = v0; v[1] = v1; v[2] = v2;
+  // set up working matrix, v[j][k] is the component j of the k-th eigenvector
+  v[0] = evec; v[1] = evec + 3; v[2] = evec + 6;
 
   vtkDebugMacro(<<"Generating tensor glyphs");
 
@@ -427,20 +424,9 @@ int vtkDiffusionTensorGlyph::RequestData(
       // compute orientation vectors and scale factors from tensor
       if ( this->ExtractEigenvalues ) // extract appropriate eigenfunctions
         {
-        for (j=0; j<3; j++)
-          {
-          for (i=0; i<3; i++)
-            {
-            // this line from vtkTensorGlyph actually transposes
-            //m[i][j] = tensor[i+3*j];
-            // simpler code with 3x3 array:
-            m[i][j] = tensor[j][i];
-            }
-          }
-
         //vtkMath::Jacobi(m, w, v);
-        // Use superior eigensolve from teem.
-        vtkDiffusionTensorMathematics::TeemEigenSolver(m,w,v);
+        // Use the closed-form eigensolver shared with vtkDiffusionTensorMathematics.
+        vtkDiffusionTensorMathematics::BatchEigenSolver(&tensor[0][0], 1, w, evec);
 
         //copy eigenvectors
         xv[0] = v[0][0]; xv[1] = v[1][0]; xv[2] = v[2][0];
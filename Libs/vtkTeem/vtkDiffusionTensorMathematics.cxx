@@ -38,6 +38,7 @@ extern "C" {
 
 #include <ctime>
 #include <limits>
+#include <vector>
 
 #define VTK_EPS 1e-16
 #define DOUBLE_NAN (std::numeric_limits<double>::quiet_NaN())
@@ -81,6 +82,62 @@ vtkDiffusionTensorMathematics::vtkDiffusionTensorMathematics()
      }
  }
 
+//----------------------------------------------------------------------------
+void vtkDiffusionTensorMathematics::AddAdditionalOperation(int op)
+{
+  if (op < VTK_TENS_TRACE || op > VTK_TENS_MEAN_DIFFUSIVITY)
+    {
+    vtkErrorMacro(<< "AddAdditionalOperation: invalid operation " << op);
+    return;
+    }
+  this->AdditionalOperations.push_back(op);
+  this->SetNumberOfOutputPorts(1 + static_cast<int>(this->AdditionalOperations.size()));
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkDiffusionTensorMathematics::RemoveAllAdditionalOperations()
+{
+  if (this->AdditionalOperations.empty())
+    {
+    return;
+    }
+  this->AdditionalOperations.clear();
+  this->SetNumberOfOutputPorts(1);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkDiffusionTensorMathematics::GetNumberOfAdditionalOperations()
+{
+  return static_cast<int>(this->AdditionalOperations.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkDiffusionTensorMathematics::GetAdditionalOperation(int i)
+{
+  if (i < 0 || i >= static_cast<int>(this->AdditionalOperations.size()))
+    {
+    vtkErrorMacro(<< "GetAdditionalOperation: index " << i << " out of range");
+    return -1;
+    }
+  return this->AdditionalOperations[i];
+}
+
+//----------------------------------------------------------------------------
+int vtkDiffusionTensorMathematics::GetOutputOperation(int port)
+{
+  return port == 0 ? this->Operation : this->GetAdditionalOperation(port - 1);
+}
+
+//----------------------------------------------------------------------------
+// Operations that output RGBA colors
+static bool vtkDiffusionTensorMathematicsIsColorOperation(int op)
+{
+  return op == vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION ||
+         op == vtkDiffusionTensorMathematics::VTK_TENS_COLOR_MODE;
+}
+
 //----------------------------------------------------------------------------
 int vtkDiffusionTensorMathematics::RequestInformation (
   vtkInformation * vtkNotUsed(request),
@@ -88,7 +145,6 @@ int vtkDiffusionTensorMathematics::RequestInformation (
   vtkInformationVector *outputVector)
 {
   // get the info objects
-  vtkInformation *outInfo = outputVector->GetInformationObject(0);
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
   //vtkInformation *inInfo2 = inputVector[1]->GetInformationObject(0);
 
@@ -106,21 +162,21 @@ int vtkDiffusionTensorMathematics::RequestInformation (
     ext[3] << " " << ext[4] << " " << ext[5]);
 
 
-  // We always want to output float, unless it is color
-  if (this->Operation == VTK_TENS_COLOR_ORIENTATION)
+  for (int port = 0; port < outputVector->GetNumberOfInformationObjects(); ++port)
     {
-    // output color (RGBA)
-    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
-    }
-  else if (this->Operation == VTK_TENS_COLOR_MODE)
-    {
-    // output color (RGBA)
-    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
-    }
-  else {
-    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+    vtkInformation *outInfo = outputVector->GetInformationObject(port);
+    // We always want to output float, unless it is color
+    if (vtkDiffusionTensorMathematicsIsColorOperation(this->GetOutputOperation(port)))
+      {
+      // output color (RGBA)
+      vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+      }
+    else
+      {
+      vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+      }
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), ext, 6);
     }
-  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), ext, 6);
   return 1;
 }
 
@@ -199,6 +255,7 @@ static void GetContinuousIncrements(vtkImageData* img, int extent[6], vtkIdType
 // Handles the ops where eigensystems are not computed.
 template <class T>
 static void vtkDiffusionTensorMathematicsExecute1(vtkDiffusionTensorMathematics *self,
+                    int op,
                     vtkImageData *in1Data,
                     vtkImageData *outData, T *outPtr,
                     int outExt[6], int id)
@@ -212,8 +269,6 @@ static void vtkDiffusionTensorMathematicsExecute1(vtkDiffusionTensorMathematics
   // progress
   unsigned long count = 0;
   unsigned long target;
-  // math operation
-  int op = self->GetOperation();
   // tensor variables
   vtkDataArray *inTensors;
   double tensor[3][3];
@@ -365,30 +420,412 @@ inline Type tensor_math_clamp(const Type a,
                   const Type c) { return (a) > (b) ? ((a) < (c) ? (a) : (c)) : (b) ; }
 
 //----------------------------------------------------------------------------
-// This templated function executes the filter for any type of data.
-// Handles the one input operations.
-// Handles the ops where eigensystems are computed.
+// Number of tensors decomposed together by BatchEigenSolver. The tensors of
+// a block are stored as a structure of arrays and every step of the
+// decomposition is a loop over the block without dependencies between
+// iterations, so the compiler can map the tensors onto SIMD lanes.
+#define VTK_TENS_EIGEN_BLOCK_SIZE 16
+
+//----------------------------------------------------------------------------
+// Closed-form eigen-decomposition of at most VTK_TENS_EIGEN_BLOCK_SIZE
+// symmetric tensors. Like TeemEigenSolver, only the lower triangle of the
+// tensors is read.
+template <class TTensor>
+static void vtkDiffusionTensorMathematicsEigenBlock(const TTensor* tensors, int n,
+                                                    double* w, double* v)
+{
+  double a00[VTK_TENS_EIGEN_BLOCK_SIZE], a01[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double a02[VTK_TENS_EIGEN_BLOCK_SIZE], a11[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double a12[VTK_TENS_EIGEN_BLOCK_SIZE], a22[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double l0[VTK_TENS_EIGEN_BLOCK_SIZE], l1[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double l2[VTK_TENS_EIGEN_BLOCK_SIZE];
+  int l;
+
+  for (l = 0; l < n; ++l)
+    {
+    const TTensor* t = tensors + 9 * l;
+    a00[l] = static_cast<double>(t[0]);
+    a01[l] = static_cast<double>(t[3]);
+    a02[l] = static_cast<double>(t[6]);
+    a11[l] = static_cast<double>(t[4]);
+    a12[l] = static_cast<double>(t[7]);
+    a22[l] = static_cast<double>(t[8]);
+    }
+
+  // Eigenvalues: trigonometric solution of the characteristic equation of
+  // the deviatoric tensor B = A - mean * I, whose roots are
+  // 2 * p * cos(phi + 2 * k * pi / 3) with p^2 = tr(B^2) / 6 and
+  // cos(3 * phi) = det(B) / (2 * p^3). phi is in [0, pi/3] so the
+  // eigenvalues come out in decreasing order.
+  const double sqrt2 = sqrt(2.);
+  const double sqrt1_5 = sqrt(1.5);
+  const double sqrt3 = sqrt(3.);
+  for (l = 0; l < n; ++l)
+    {
+    const double mean = (a00[l] + a11[l] + a22[l]) / 3.;
+    const double b00 = a00[l] - mean;
+    const double b11 = a11[l] - mean;
+    const double b22 = a22[l] - mean;
+    const double p2 = (b00 * b00 + b11 * b11 + b22 * b22 +
+      2. * (a01[l] * a01[l] + a02[l] * a02[l] + a12[l] * a12[l])) / 6.;
+    const double p = sqrt(p2);
+    const double halfDet = 0.5 * (b00 * (b11 * b22 - a12[l] * a12[l])
+                                  - a01[l] * (a01[l] * b22 - a12[l] * a02[l])
+                                  + a02[l] * (a01[l] * a12[l] - b11 * a02[l]));
+    const double p3 = p2 * p;
+    // isotropic tensors have p == 0 and det(B) == 0
+    double r = halfDet / (p3 > 0. ? p3 : 1.);
+    r = r < -1. ? -1. : (r > 1. ? 1. : r);
+    // c = cos(acos(r) / 3) without acos and cos, which are not vectorized:
+    // c is the largest root of 4 * c^3 - 3 * c = r, that is
+    // 2 * u^3 - 3 * u = sqrt(2) * x with u = sqrt(1 + c) in
+    // [sqrt(1.5), sqrt(2)] and x = sqrt((1 + r) / 2) in [0, 1]. Three Newton
+    // iterations from the linear interpolation converge to double precision.
+    const double x = sqrt(0.5 * (1. + r));
+    double u = sqrt1_5 + (sqrt2 - sqrt1_5) * x;
+    for (int k = 0; k < 3; ++k)
+      {
+      u -= (2. * u * u * u - 3. * u - sqrt2 * x) / (6. * u * u - 3.);
+      }
+    const double c = u * u - 1.;
+    // cos(phi + 2 * pi / 3) = -(cos(phi) + sqrt(3) * sin(phi)) / 2
+    const double s2 = 1. - c * c;
+    const double s = sqrt(s2 > 0. ? s2 : 0.);
+    l0[l] = mean + 2. * p * c;
+    l2[l] = mean - p * (c + sqrt3 * s);
+    // rounding errors must not break the order of close eigenvalues
+    const double middle = 3. * mean - l0[l] - l2[l];
+    l1[l] = middle > l0[l] ? l0[l] : (middle < l2[l] ? l2[l] : middle);
+    }
+  for (l = 0; l < n; ++l)
+    {
+    w[3 * l] = l0[l];
+    w[3 * l + 1] = l1[l];
+    w[3 * l + 2] = l2[l];
+    }
+  if (v == NULL)
+    {
+    return;
+    }
+
+  double x0[VTK_TENS_EIGEN_BLOCK_SIZE], y0[VTK_TENS_EIGEN_BLOCK_SIZE], z0[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double x1[VTK_TENS_EIGEN_BLOCK_SIZE], y1[VTK_TENS_EIGEN_BLOCK_SIZE], z1[VTK_TENS_EIGEN_BLOCK_SIZE];
+  double x2[VTK_TENS_EIGEN_BLOCK_SIZE], y2[VTK_TENS_EIGEN_BLOCK_SIZE], z2[VTK_TENS_EIGEN_BLOCK_SIZE];
+  // Eigenvectors: the one of the eigenvalue the furthest from the two others
+  // is the best conditioned, it is orthogonal to the rows of A - lambda * I
+  // and computed as the largest cross product of two rows. The two others
+  // are the eigenvectors of the 2x2 restriction of A to the orthogonal
+  // plane, which stays well defined when their eigenvalues are close.
+  for (l = 0; l < n; ++l)
+    {
+    const bool majorFirst = (l0[l] - l1[l]) >= (l1[l] - l2[l]);
+    const double lambda = majorFirst ? l0[l] : l2[l];
+    const double r00 = a00[l] - lambda;
+    const double r11 = a11[l] - lambda;
+    const double r22 = a22[l] - lambda;
+    // row0 x row1, row0 x row2 and row1 x row2
+    const double c0x = a01[l] * a12[l] - a02[l] * r11;
+    const double c0y = a02[l] * a01[l] - r00 * a12[l];
+    const double c0z = r00 * r11 - a01[l] * a01[l];
+    const double c1x = a01[l] * r22 - a02[l] * a12[l];
+    const double c1y = a02[l] * a02[l] - r00 * r22;
+    const double c1z = r00 * a12[l] - a01[l] * a02[l];
+    const double c2x = r11 * r22 - a12[l] * a12[l];
+    const double c2y = a12[l] * a02[l] - a01[l] * r22;
+    const double c2z = a01[l] * a12[l] - r11 * a02[l];
+    const double n0 = c0x * c0x + c0y * c0y + c0z * c0z;
+    const double n1 = c1x * c1x + c1y * c1y + c1z * c1z;
+    const double n2 = c2x * c2x + c2y * c2y + c2z * c2z;
+    // selects rather than branches keep the loop vectorizable
+    const bool pick1 = n1 > n0;
+    const double n01 = pick1 ? n1 : n0;
+    const bool pick2 = n2 > n01;
+    const double en = pick2 ? n2 : n01;
+    // isotropic tensors have no preferred direction, use the x axis
+    const bool isotropic = !(en > 0.);
+    const double invNorm = 1. / sqrt(isotropic ? 1. : en);
+    const double ex = isotropic ? 1. : (pick2 ? c2x : (pick1 ? c1x : c0x)) * invNorm;
+    const double ey = isotropic ? 0. : (pick2 ? c2y : (pick1 ? c1y : c0y)) * invNorm;
+    const double ez = isotropic ? 0. : (pick2 ? c2z : (pick1 ? c1z : c0z)) * invNorm;
+
+    // orthonormal basis (u, s) of the plane orthogonal to e
+    const bool useY = fabs(ex) > fabs(ey);
+    const double uNorm = 1. / sqrt(useY ? ex * ex + ez * ez : ey * ey + ez * ez);
+    const double ux = useY ? -ez * uNorm : 0.;
+    const double uy = useY ? 0. : ez * uNorm;
+    const double uz = useY ? ex * uNorm : -ey * uNorm;
+    const double sx = ey * uz - ez * uy;
+    const double sy = ez * ux - ex * uz;
+    const double sz = ex * uy - ey * ux;
+
+    // restriction of A to the plane
+    const double aux = a00[l] * ux + a01[l] * uy + a02[l] * uz;
+    const double auy = a01[l] * ux + a11[l] * uy + a12[l] * uz;
+    const double auz = a02[l] * ux + a12[l] * uy + a22[l] * uz;
+    const double asx = a00[l] * sx + a01[l] * sy + a02[l] * sz;
+    const double asy = a01[l] * sx + a11[l] * sy + a12[l] * sz;
+    const double asz = a02[l] * sx + a12[l] * sy + a22[l] * sz;
+    const double muu = ux * aux + uy * auy + uz * auz;
+    const double mus = sx * aux + sy * auy + sz * auz;
+    const double mss = sx * asx + sy * asy + sz * asz;
+    // largest eigenvalue of the 2x2 restriction and its eigenvector (c, s)
+    const double halfDiff = 0.5 * (muu - mss);
+    const double mu = 0.5 * (muu + mss) + sqrt(halfDiff * halfDiff + mus * mus);
+    const double m0 = mus * mus + (mu - muu) * (mu - muu);
+    const double m1 = (mu - mss) * (mu - mss) + mus * mus;
+    const bool pickM1 = m1 > m0;
+    const double m = pickM1 ? m1 : m0;
+    // isotropic restriction: any vector of the plane is an eigenvector
+    const bool planeIsotropic = !(m > 0.);
+    const double cNorm = 1. / sqrt(planeIsotropic ? 1. : m);
+    const double cu = planeIsotropic ? 1. : (pickM1 ? mu - mss : mus) * cNorm;
+    const double cs = planeIsotropic ? 0. : (pickM1 ? mus : mu - muu) * cNorm;
+    const double fx = cu * ux + cs * sx;
+    const double fy = cu * uy + cs * sy;
+    const double fz = cu * uz + cs * sz;
+    const double gx = cu * sx - cs * ux;
+    const double gy = cu * sy - cs * uy;
+    const double gz = cu * sz - cs * uz;
+
+    // sorted eigenvectors
+    x0[l] = majorFirst ? ex : fx; y0[l] = majorFirst ? ey : fy; z0[l] = majorFirst ? ez : fz;
+    x1[l] = majorFirst ? fx : gx; y1[l] = majorFirst ? fy : gy; z1[l] = majorFirst ? fz : gz;
+    x2[l] = majorFirst ? gx : ex; y2[l] = majorFirst ? gy : ey; z2[l] = majorFirst ? gz : ez;
+    }
+  // v[3 * j + k] is the component j of the k-th eigenvector
+  for (l = 0; l < n; ++l)
+    {
+    double* vl = v + 9 * l;
+    vl[0] = x0[l]; vl[1] = x1[l]; vl[2] = x2[l];
+    vl[3] = y0[l]; vl[4] = y1[l]; vl[5] = y2[l];
+    vl[6] = z0[l]; vl[7] = z1[l]; vl[8] = z2[l];
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class TTensor>
+static void vtkDiffusionTensorMathematicsBatchEigenSolver(const TTensor* tensors,
+                                                          vtkIdType numberOfTensors,
+                                                          double* w, double* v)
+{
+  for (vtkIdType first = 0; first < numberOfTensors; first += VTK_TENS_EIGEN_BLOCK_SIZE)
+    {
+    const int n = static_cast<int>(MIN(numberOfTensors - first, VTK_TENS_EIGEN_BLOCK_SIZE));
+    vtkDiffusionTensorMathematicsEigenBlock(tensors + 9 * first, n, w + 3 * first,
+                                            v ? v + 9 * first : NULL);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Operations that need the eigenvectors, not only the eigenvalues
+static bool vtkDiffusionTensorMathematicsNeedsEigenvectors(int op)
+{
+  switch (op)
+    {
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJX:
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJY:
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJZ:
+    case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJX:
+    case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJY:
+    case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJZ:
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJX:
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJY:
+    case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJZ:
+    case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION:
+      return true;
+    default:
+      return false;
+    }
+}
+
+//----------------------------------------------------------------------------
+// This templated function writes one output row of an operation computed
+// from the eigensystems of the row: w holds 3 eigenvalues and v 9
+// eigenvector components per voxel (see BatchEigenSolver).
 template <class T>
+static void vtkDiffusionTensorMathematicsEigenRow(int op, T *outPtr, int rowLength,
+                                                  double *w, double *v,
+                                                  const short *maskPtr, int maskLabel,
+                                                  double scaleFactor, vtkTransform *trans)
+{
+  // working matrix pointing to the eigenvectors of the voxel
+  double *vm[3];
+  double v_maj[3];
+  double r, g, b;
+  double cl;
+
+  // map 0..1 values into the range a char takes on
+  // but use scaleFactor so user can bump up the brightness
+  const double rgb_scale = (double)VTK_UNSIGNED_CHAR_MAX * scaleFactor / 1000.;
+  double rgb_temp = 0.;
+
+  for (int idxR = 0; idxR < rowLength; idxR++, w += 3, v += 9)
+    {
+    if (maskPtr && maskPtr[idxR] != maskLabel)
+      {
+      *outPtr = 0;
+
+      if (vtkDiffusionTensorMathematicsIsColorOperation(op))
+        {
+        outPtr++;
+        *outPtr = 0; // green
+        outPtr++;
+        *outPtr = 0; // blue
+        outPtr++;
+        *outPtr = VTK_UNSIGNED_CHAR_MAX ; // alpha
+        }
+      outPtr++;
+      continue;
+      }
+
+    vm[0] = v; vm[1] = v + 3; vm[2] = v + 6;
+
+    // pixel operation
+    switch (op)
+      {
+      case vtkDiffusionTensorMathematics::VTK_TENS_RELATIVE_ANISOTROPY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RelativeAnisotropy(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_FRACTIONAL_ANISOTROPY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::FractionalAnisotropy(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_LINEAR_MEASURE:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::LinearMeasure(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_PLANAR_MEASURE:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::PlanarMeasure(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_SPHERICAL_MEASURE:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::SphericalMeasure(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE:
+        *outPtr = (T)w[0];
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MID_EIGENVALUE:
+        *outPtr = (T)w[1];
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MIN_EIGENVALUE:
+        *outPtr = (T)w[2];
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_PARALLEL_DIFFUSIVITY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::ParallelDiffusivity(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_PERPENDICULAR_DIFFUSIVITY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::PerpendicularDiffusivity(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MEAN_DIFFUSIVITY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MeanDiffusivity(w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJX:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionX(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionY(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJZ:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionZ(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJX:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecX(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecY(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJZ:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecZ(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJX:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecX(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJY:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecY(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJZ:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecZ(vm,w));
+        break;
+      case vtkDiffusionTensorMathematics::VTK_TENS_MODE:
+        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::Mode(w));
+        break;
+
+      case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_MODE:
+        vtkDiffusionTensorMathematics::ColorByMode(w,r,g,b);
+        // scale maps 0..1 values into the range a char takes on
+        rgb_temp = (rgb_scale*r);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        rgb_temp = (rgb_scale*g);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        rgb_temp = (rgb_scale*b);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
+        break;
+
+      case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION:
+        // If the user has set the rotation matrix
+        // then transform the eigensystem first
+        // This is used to rotate the vector into RAS space
+        // for consistent anatomical coloring.
+        v_maj[0]=vm[0][0];
+        v_maj[1]=vm[1][0];
+        v_maj[2]=vm[2][0];
+        if (trans)
+          {
+          trans->TransformPoint(v_maj,v_maj);
+          }
+        // Color R, G, B depending on max eigenvector
+        // scale maps 0..1 values into the range a char takes on
+        cl = vtkDiffusionTensorMathematics::LinearMeasure(w);
+        rgb_temp = (rgb_scale*fabs(v_maj[0])*cl);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        rgb_temp = (rgb_scale*fabs(v_maj[1])*cl);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        rgb_temp = (rgb_scale*fabs(v_maj[2])*cl);
+        *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
+        outPtr++;
+        *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
+        break;
+      }
+
+    // scale double if the user requested this
+    if (scaleFactor != 1 && !vtkDiffusionTensorMathematicsIsColorOperation(op))
+      {
+      *outPtr = (T) ((*outPtr) * scaleFactor);
+      }
+    outPtr++;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Output of an operation computed from the eigensystems
+struct vtkDiffusionTensorMathematicsEigenOutput
+{
+  int Operation;
+  vtkImageData *Data;
+};
+
+//----------------------------------------------------------------------------
+// This function executes the filter for all the outputs of operations
+// where eigensystems are computed: the eigensystems of each row are
+// computed once by the batched solver and shared by all the outputs.
 static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathematics *self,
                           vtkImageData *in1Data,
-                          vtkImageData *outData,
-                          T *outPtr,
+                          const std::vector<vtkDiffusionTensorMathematicsEigenOutput>& outputs,
                           int outExt[6], int id)
 {
   // image variables
   int idxR, idxY, idxZ;
   int maxY, maxZ;
-  vtkIdType outIncX, outIncY, outIncZ;
   vtkIdType inIncX, inIncY, inIncZ;
   int rowLength;
   // progress
   unsigned long count = 0;
   unsigned long target;
-  // math operation
-  int op = self->GetOperation();
   // tensor variables
   vtkDataArray *inTensors;
-  double tensor[3][3];
   vtkPointData *pd;
   int numPts;
   // time
@@ -396,25 +833,11 @@ static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathema
   clock_t tStart, tEnd, tDiff;
   tStart = clock();
 #endif
-  // working matrices
-  double *m[3], w[3], *v[3];
-  double m0[3], m1[3], m2[3];
-  double v0[3], v1[3], v2[3];
-  double v_maj[3];
-  m[0] = m0; m[1] = m1; m[2] = m2;
-  v[0] = v0; v[1] = v1; v[2] = v2;
-  int i, j;
-  double r, g, b;
+  int i, k;
   int extractEigenvalues;
-  double cl;
   // scaling
   double scaleFactor = self->GetScaleFactor();
 
-  // map 0..1 values into the range a char takes on
-  // but use scaleFactor so user can bump up the brightness
-  const double rgb_scale = (double)VTK_UNSIGNED_CHAR_MAX * scaleFactor / 1000.;
-  double rgb_temp = 0.;
-
   // find the input region to loop over
   pd = in1Data->GetPointData();
   inTensors = pd->GetTensors();
@@ -438,8 +861,6 @@ static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathema
   target = (unsigned long)((maxZ+1)*(maxY+1)/50.0);
   target++;
 
-  // Get increments to march through output data
-  outData->GetContinuousIncrements(outExt, outIncX, outIncY, outIncZ);
   // Call special version of GetContinuousIncrements that works for Tensors
   GetContinuousIncrements(in1Data, outExt, inIncX, inIncY, inIncZ);
 
@@ -452,15 +873,27 @@ static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathema
   // decide whether to extract eigenfunctions or just use input cols
   extractEigenvalues = self->GetExtractEigenvalues();
 
+  // eigenvectors are only computed if an output needs them
+  bool needsEigenvectors = false;
+  for (std::vector<vtkDiffusionTensorMathematicsEigenOutput>::const_iterator it = outputs.begin();
+       it != outputs.end(); ++it)
+    {
+    needsEigenvectors = needsEigenvectors || vtkDiffusionTensorMathematicsNeedsEigenvectors(it->Operation);
+    }
+
+  // eigensystems of the current row
+  std::vector<double> w(3 * rowLength, 0.);
+  std::vector<double> v(9 * rowLength, 0.);
+  double col[3];
+
   // transformation of tensor orientations for coloring
-  vtkTransform *trans = vtkTransform::New();
-  int useTransform = 0;
+  vtkTransform *trans = NULL;
 
   // if the user has set this matrix grab it
   if (self->GetTensorRotationMatrix())
     {
+    trans = vtkTransform::New();
     trans->SetMatrix(self->GetTensorRotationMatrix());
-    useTransform = 1;
     }
 
   // Check for masking
@@ -476,10 +909,7 @@ static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathema
     doMasking = self->GetScalarMask()->GetPointData()->GetScalars() != 0;
     }
 
-   //vtkGenericWarningMacro( "Do masking: " << doMasking );
-
-
-  // Loop through output pixels and input points
+  // Loop through output rows and input points
 
   for (idxZ = 0; idxZ <= maxZ; idxZ++)
     {
@@ -494,306 +924,95 @@ static void vtkDiffusionTensorMathematicsExecute1Eigen(vtkDiffusionTensorMathema
         count++;
         }
 
-      for (idxR = 0; idxR < rowLength; idxR++)
+      // get eigenvalues and eigenvectors appropriately
+      if (extractEigenvalues)
         {
-        if (doMasking && *inMaskPtr != self->GetMaskLabelValue())
-          {
-          *outPtr = 0;
-
-          if (op ==  vtkDiffusionTensorMathematics::VTK_TENS_COLOR_MODE ||
-            op ==  vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION) {
-            outPtr++;
-            *outPtr = 0; // green
-            outPtr++;
-            *outPtr = 0; // blue
-            outPtr++;
-            *outPtr = VTK_UNSIGNED_CHAR_MAX ; // alpha
-          }
+        vtkDiffusionTensorMathematics::BatchEigenSolver(
+          inPtr, rowLength, &w[0], needsEigenvectors ? &v[0] : NULL);
         }
-        else {
-
-          // tensor at this voxel
-          tensor[0][0] = static_cast<double>(inPtr[0]);
-          tensor[0][1] = static_cast<double>(inPtr[1]);
-          tensor[0][2] = static_cast<double>(inPtr[2]);
-          tensor[1][0] = static_cast<double>(inPtr[3]);
-          tensor[1][1] = static_cast<double>(inPtr[4]);
-          tensor[1][2] = static_cast<double>(inPtr[5]);
-          tensor[2][0] = static_cast<double>(inPtr[6]);
-          tensor[2][1] = static_cast<double>(inPtr[7]);
-          tensor[2][2] = static_cast<double>(inPtr[8]);
-
-          // get eigenvalues and eigenvectors appropriately
-          if (extractEigenvalues)
+      else
+        {
+        // tensor columns are evectors scaled by evals
+        for (idxR = 0; idxR < rowLength; idxR++)
+          {
+          for (k=0; k<3; k++)
             {
-            for (j=0; j<3; j++)
+            for (i=0; i<3; i++)
               {
-              for (i=0; i<3; i++)
-                {
-                // transpose
-                m[i][j] = tensor[j][i];
-                }
+              col[i] = static_cast<double>(inPtr[9*idxR + 3*i + k]);
               }
-            // compute eigensystem
-            //vtkMath::Jacobi(m, w, v);
-            vtkDiffusionTensorMathematics::TeemEigenSolver(m,w,v);
-            }
-          else
-            {
-            // tensor columns are evectors scaled by evals
+            w[3*idxR + k] = vtkMath::Normalize(col);
             for (i=0; i<3; i++)
               {
-              v0[i] = tensor[i][0];
-              v1[i] = tensor[i][1];
-              v2[i] = tensor[i][2];
+              v[9*idxR + 3*i + k] = col[i];
               }
-            w[0] = vtkMath::Normalize(v0);
-            w[1] = vtkMath::Normalize(v1);
-            w[2] = vtkMath::Normalize(v2);
             }
-
-          //Correct for negative eigenvalues. Three possible options:
-          //  1. Round to zero
-          //  2. Take absolute value
-          //  3. Increase eigenvalues by negative part
-          // The two first options have been problematic. Try 3
-          if (self->GetFixNegativeEigenvalues()==1){
-            const double min_eval = MIN3(w[0], w[1], w[2]);
-            if (min_eval < 0)
-              {
-                const double add_to_eval = -min_eval + VTK_EPS;
-                w[0] += add_to_eval;
-                w[1] += add_to_eval;
-                w[2] += add_to_eval;
-              }
-//            if (vtkDiffusionTensorMathematics::FixNegativeEigenvaluesMethod(w)) {
-//              vtkGenericWarningMacro( "Warning: Eigenvalues are not properly sorted" );
-//            }
-            if ((w[0] < 0) || (w[1] < 0) || (w[2] < 0))
-              vtkGenericWarningMacro( "Warning: Negative Eigenvalues after positivity fix" );
-          } else {
-            if (w[0] < 0)
-              w[0] = DOUBLE_NAN;
-            if (w[1] < 0)
-              w[1] = DOUBLE_NAN;
-            if (w[2] < 0)
-              w[2] = DOUBLE_NAN;
           }
+        }
 
-          // pixel operation
-          switch (op)
+      for (idxR = 0; idxR < rowLength; idxR++)
+        {
+        double* wR = &w[3*idxR];
+        //Correct for negative eigenvalues. Three possible options:
+        //  1. Round to zero
+        //  2. Take absolute value
+        //  3. Increase eigenvalues by negative part
+        // The two first options have been problematic. Try 3
+        if (self->GetFixNegativeEigenvalues()==1){
+          const double min_eval = MIN3(wR[0], wR[1], wR[2]);
+          if (min_eval < 0)
             {
-          case vtkDiffusionTensorMathematics::VTK_TENS_RELATIVE_ANISOTROPY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RelativeAnisotropy(w));
-            break;
-          case vtkDiffusionTensorMathematics::VTK_TENS_FRACTIONAL_ANISOTROPY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::FractionalAnisotropy(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_LINEAR_MEASURE:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::LinearMeasure(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_PLANAR_MEASURE:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::PlanarMeasure(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_SPHERICAL_MEASURE:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::SphericalMeasure(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE:
-            *outPtr = (T)w[0];
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MID_EIGENVALUE:
-            *outPtr = (T)w[1];
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MIN_EIGENVALUE:
-            *outPtr = (T)w[2];
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_PARALLEL_DIFFUSIVITY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::ParallelDiffusivity(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_PERPENDICULAR_DIFFUSIVITY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::PerpendicularDiffusivity(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MEAN_DIFFUSIVITY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MeanDiffusivity(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJX:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionX(v,w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJY:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionY(v,w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVALUE_PROJZ:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvalueProjectionZ(v,w));
-            break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJX:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecX(v,w));
-        break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJY:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecY(v,w));
-        break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_RAI_MAX_EIGENVEC_PROJZ:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::RAIMaxEigenvecZ(v,w));
-        break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJX:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecX(v,w));
-        break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJY:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecY(v,w));
-        break;
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_MAX_EIGENVEC_PROJZ:
-        *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::MaxEigenvecZ(v,w));
-        break;
-
-
-      case vtkDiffusionTensorMathematics::VTK_TENS_MODE:
-            *outPtr = static_cast<T> (vtkDiffusionTensorMathematics::Mode(w));
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_MODE:
-
-            vtkDiffusionTensorMathematics::ColorByMode(w,r,g,b);
-            // scale maps 0..1 values into the range a char takes on
-            rgb_temp = (rgb_scale*r);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*g);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*b);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
-
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION:
-            // If the user has set the rotation matrix
-            // then transform the eigensystem first
-            // This is used to rotate the vector into RAS space
-            // for consistent anatomical coloring.
-            v_maj[0]=v[0][0];
-            v_maj[1]=v[1][0];
-            v_maj[2]=v[2][0];
-            if (useTransform)
-              {
-              trans->TransformPoint(v_maj,v_maj);
-              }
-            // Color R, G, B depending on max eigenvector
-            // scale maps 0..1 values into the range a char takes on
-            cl = vtkDiffusionTensorMathematics::LinearMeasure(w);
-            rgb_temp = (rgb_scale*fabs(v_maj[0])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[1])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[2])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
-
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION_MIDDLE_EIGENVECTOR:
-            // If the user has set the rotation matrix
-            // then transform the eigensystem first
-            // This is used to rotate the vector into RAS space
-            // for consistent anatomical coloring.
-            v_maj[0]=v[0][1];
-            v_maj[1]=v[1][1];
-            v_maj[2]=v[2][1];
-            if (useTransform)
-              {
-              trans->TransformPoint(v_maj,v_maj);
-              }
-            // Color R, G, B depending on max eigenvector
-            // scale maps 0..1 values into the range a char takes on
-            cl = vtkDiffusionTensorMathematics::LinearMeasure(w);
-            rgb_temp = (rgb_scale*fabs(v_maj[0])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[1])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[2])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
-
-            break;
-
-          case vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION_MIN_EIGENVECTOR:
-            // If the user has set the rotation matrix
-            // then transform the eigensystem first
-            // This is used to rotate the vector into RAS space
-            // for consistent anatomical coloring.
-            v_maj[0]=v[0][2];
-            v_maj[1]=v[1][2];
-            v_maj[2]=v[2][2];
-            if (useTransform)
-              {
-              trans->TransformPoint(v_maj,v_maj);
-              }
-            // Color R, G, B depending on max eigenvector
-            // scale maps 0..1 values into the range a char takes on
-            cl = vtkDiffusionTensorMathematics::LinearMeasure(w);
-            rgb_temp = (rgb_scale*fabs(v_maj[0])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[1])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            rgb_temp = (rgb_scale*fabs(v_maj[2])*cl);
-            *outPtr = (T)tensor_math_clamp(rgb_temp, (double)VTK_UNSIGNED_CHAR_MIN, (double)VTK_UNSIGNED_CHAR_MAX);
-            outPtr++;
-            *outPtr = (T)VTK_UNSIGNED_CHAR_MAX; //alpha
-
-            break;
-
-
+              const double add_to_eval = -min_eval + VTK_EPS;
+              wR[0] += add_to_eval;
+              wR[1] += add_to_eval;
+              wR[2] += add_to_eval;
             }
+          if ((wR[0] < 0) || (wR[1] < 0) || (wR[2] < 0))
+            vtkGenericWarningMacro( "Warning: Negative Eigenvalues after positivity fix" );
+        } else {
+          if (wR[0] < 0)
+            wR[0] = DOUBLE_NAN;
+          if (wR[1] < 0)
+            wR[1] = DOUBLE_NAN;
+          if (wR[2] < 0)
+            wR[2] = DOUBLE_NAN;
+        }
+        }
 
-          // scale double if the user requested this
-          if (scaleFactor != 1 && op !=  vtkDiffusionTensorMathematics::VTK_TENS_COLOR_ORIENTATION
-            && op !=  vtkDiffusionTensorMathematics::VTK_TENS_COLOR_MODE)
-            {
-            *outPtr = (T) ((*outPtr) * scaleFactor);
-            }
+      // pixel operations of each output
+      for (std::vector<vtkDiffusionTensorMathematicsEigenOutput>::const_iterator it = outputs.begin();
+           it != outputs.end(); ++it)
+        {
+        void *outPtr = it->Data->GetScalarPointer(outExt[0], outExt[2] + idxY, outExt[4] + idxZ);
+        switch (it->Data->GetScalarType())
+          {
+          vtkTemplateMacro(vtkDiffusionTensorMathematicsEigenRow(
+                    it->Operation, static_cast<VTK_TT*>(outPtr), rowLength,
+                    &w[0], &v[0], doMasking ? inMaskPtr : NULL,
+                    self->GetMaskLabelValue(), scaleFactor, trans));
+          default:
+            vtkGenericWarningMacro(<< "Execute: Unknown ScalarType");
+            break;
           }
+        }
 
-
-        outPtr++;
-        inPtr+=9;
-        inMaskPtr++;
+      inPtr += 9*rowLength + inIncY;
+      if (inMaskPtr)
+        {
+        inMaskPtr += rowLength + maskIncY;
         }
-      outPtr += outIncY;
-      inPtr += inIncY;
-      inMaskPtr += maskIncY;
       }
-    outPtr += outIncZ;
     inPtr += inIncZ;
-    inMaskPtr += maskIncZ;
+    if (inMaskPtr)
+      {
+      inMaskPtr += maskIncZ;
+      }
     }
   // Cleanup
-  trans->Delete();
+  if (trans)
+    {
+    trans->Delete();
+    }
 
 #ifndef NDEBUG
   tEnd = clock();
@@ -849,67 +1068,76 @@ void vtkDiffusionTensorMathematics::ThreadedRequestData(
     return;
     }
 
-  outPtr = outData[0]->GetScalarPointerForExtent(outExt);
-
   // single input only for now
   vtkDebugMacro ("In Threaded Execute. scalar type is " << inData[0][0]->GetScalarType() << "op is: " << this->Operation);
 
-  switch (this->GetOperation())
-    {
+  // outputs of the operations where eigenvalues are computed, they are
+  // all filled in the same pass over the tensors
+  std::vector<vtkDiffusionTensorMathematicsEigenOutput> eigenOutputs;
 
-      // Operations where eigenvalues are not computed
-    case VTK_TENS_D11:
-    case VTK_TENS_D22:
-    case VTK_TENS_D33:
-    case VTK_TENS_TRACE:
-    case VTK_TENS_DETERMINANT:
-      switch (outData[0]->GetScalarType())
-      {
-      // we set the output data scalar type depending on the op
-      // already.  And we only access the input tensors
-      // which are float.  So this switch statement on output
-      // scalar type is sufficient.
-      vtkTemplateMacro(vtkDiffusionTensorMathematicsExecute1(
-                this,inData[0][0], outData[0],
-                static_cast<VTK_TT*>(outPtr), outExt, id));
-      default:
-        vtkErrorMacro(<< "Execute: Unknown ScalarType");
-        return;
-      }
-      break;
-
-    // Operations where eigenvalues are computed
-    case VTK_TENS_RELATIVE_ANISOTROPY:
-    case VTK_TENS_FRACTIONAL_ANISOTROPY:
-    case VTK_TENS_LINEAR_MEASURE:
-    case VTK_TENS_PLANAR_MEASURE:
-    case VTK_TENS_SPHERICAL_MEASURE:
-    case VTK_TENS_MAX_EIGENVALUE:
-    case VTK_TENS_MID_EIGENVALUE:
-    case VTK_TENS_MIN_EIGENVALUE:
-    case VTK_TENS_MAX_EIGENVALUE_PROJX:
-    case VTK_TENS_MAX_EIGENVALUE_PROJY:
-    case VTK_TENS_MAX_EIGENVALUE_PROJZ:
-    case VTK_TENS_RAI_MAX_EIGENVEC_PROJX:
-    case VTK_TENS_RAI_MAX_EIGENVEC_PROJY:
-    case VTK_TENS_RAI_MAX_EIGENVEC_PROJZ:
-    case VTK_TENS_COLOR_ORIENTATION:
-    case VTK_TENS_MODE:
-    case VTK_TENS_COLOR_MODE:
-    case VTK_TENS_PARALLEL_DIFFUSIVITY:
-    case VTK_TENS_PERPENDICULAR_DIFFUSIVITY:
-    case VTK_TENS_MEAN_DIFFUSIVITY:
-      switch (outData[0]->GetScalarType())
+  for (int port = 0; port < this->GetNumberOfOutputPorts(); ++port)
+    {
+    const int op = this->GetOutputOperation(port);
+    switch (op)
       {
-        vtkTemplateMacro(vtkDiffusionTensorMathematicsExecute1Eigen(
-                this,inData[0][0], outData[0],
-                static_cast<VTK_TT*>(outPtr), outExt, id));
+
+        // Operations where eigenvalues are not computed
+      case VTK_TENS_D11:
+      case VTK_TENS_D22:
+      case VTK_TENS_D33:
+      case VTK_TENS_TRACE:
+      case VTK_TENS_DETERMINANT:
+        outPtr = outData[port]->GetScalarPointerForExtent(outExt);
+        switch (outData[port]->GetScalarType())
+        {
+        // we set the output data scalar type depending on the op
+        // already.  And we only access the input tensors
+        // which are float.  So this switch statement on output
+        // scalar type is sufficient.
+        vtkTemplateMacro(vtkDiffusionTensorMathematicsExecute1(
+                  this, op, inData[0][0], outData[port],
+                  static_cast<VTK_TT*>(outPtr), outExt, id));
         default:
-        vtkErrorMacro(<< "Execute: Unknown ScalarType");
-        return;
+          vtkErrorMacro(<< "Execute: Unknown ScalarType");
+          return;
+        }
+        break;
+
+      // Operations where eigenvalues are computed
+      case VTK_TENS_RELATIVE_ANISOTROPY:
+      case VTK_TENS_FRACTIONAL_ANISOTROPY:
+      case VTK_TENS_LINEAR_MEASURE:
+      case VTK_TENS_PLANAR_MEASURE:
+      case VTK_TENS_SPHERICAL_MEASURE:
+      case VTK_TENS_MAX_EIGENVALUE:
+      case VTK_TENS_MID_EIGENVALUE:
+      case VTK_TENS_MIN_EIGENVALUE:
+      case VTK_TENS_MAX_EIGENVALUE_PROJX:
+      case VTK_TENS_MAX_EIGENVALUE_PROJY:
+      case VTK_TENS_MAX_EIGENVALUE_PROJZ:
+      case VTK_TENS_RAI_MAX_EIGENVEC_PROJX:
+      case VTK_TENS_RAI_MAX_EIGENVEC_PROJY:
+      case VTK_TENS_RAI_MAX_EIGENVEC_PROJZ:
+      case VTK_TENS_COLOR_ORIENTATION:
+      case VTK_TENS_MODE:
+      case VTK_TENS_COLOR_MODE:
+      case VTK_TENS_PARALLEL_DIFFUSIVITY:
+      case VTK_TENS_PERPENDICULAR_DIFFUSIVITY:
+      case VTK_TENS_MEAN_DIFFUSIVITY:
+        {
+        vtkDiffusionTensorMathematicsEigenOutput eigenOutput;
+        eigenOutput.Operation = op;
+        eigenOutput.Data = outData[port];
+        eigenOutputs.push_back(eigenOutput);
+        }
+        break;
       }
-    break;
-  }
+    }
+
+  if (!eigenOutputs.empty())
+    {
+    vtkDiffusionTensorMathematicsExecute1Eigen(this, inData[0][0], eigenOutputs, outExt, id);
+    }
 }
 
 
@@ -1163,6 +1391,13 @@ void vtkDiffusionTensorMathematics::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os,indent);
 
   os << indent << "Operation: " << this->Operation << "\n";
+  os << indent << "AdditionalOperations:";
+  for (std::vector<int>::const_iterator it = this->AdditionalOperations.begin();
+       it != this->AdditionalOperations.end(); ++it)
+    {
+    os << " " << *it;
+    }
+  os << "\n";
 }
 
 // Colormap: convert our mode value (-1..1) to RGB
@@ -1368,3 +1603,19 @@ int vtkDiffusionTensorMathematics::TeemEigenSolver(double **m, double *w, double
     return res;
 
 }
+
+//----------------------------------------------------------------------------
+void vtkDiffusionTensorMathematics::BatchEigenSolver(const float *tensors,
+                                                     vtkIdType numberOfTensors,
+                                                     double *w, double *v)
+{
+  vtkDiffusionTensorMathematicsBatchEigenSolver(tensors, numberOfTensors, w, v);
+}
+
+//----------------------------------------------------------------------------
+void vtkDiffusionTensorMathematics::BatchEigenSolver(const double *tensors,
+                                                     vtkIdType numberOfTensors,
+                                                     double *w, double *v)
+{
+  vtkDiffusionTensorMathematicsBatchEigenSolver(tensors, numberOfTensors, w, v);
+}
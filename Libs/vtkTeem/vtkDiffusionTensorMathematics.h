@@ -32,6 +32,9 @@
 // VTK includes
 #include <vtkThreadedImageAlgorithm.h>
 
+// STD includes
+#include <vector>
+
 class vtkMatrix4x4;
 class vtkImageData;
 class VTK_Teem_EXPORT vtkDiffusionTensorMathematics : public vtkThreadedImageAlgorithm
@@ -80,6 +83,20 @@ public:
   vtkGetMacro(Operation,int);
   vtkSetClampMacro(Operation,int, VTK_TENS_TRACE, VTK_TENS_MEAN_DIFFUSIVITY);
 
+  ///
+  /// Compute additional operations in the same pass as Operation, e.g.
+  /// FA, MD and color orientation maps from a single execution: the
+  /// eigensystem of each tensor is computed once for all the operations.
+  /// The result of the i-th additional operation is the output of port i+1.
+  void AddAdditionalOperation(int op);
+  void RemoveAllAdditionalOperations();
+  int GetNumberOfAdditionalOperations();
+  int GetAdditionalOperation(int i);
+
+  ///
+  /// Operation whose result is the output of \a port
+  int GetOutputOperation(int port);
+
   ///
   /// Output the trace (sum of eigenvalues = sum along diagonal)
   void SetOperationToTrace()
@@ -268,6 +285,19 @@ public:
   //Description
   //Wrap function to teem eigen solver
   static int TeemEigenSolver(double **m, double *w, double **v);
+
+  ///
+  /// Closed-form eigen-decomposition of \a numberOfTensors symmetric tensors
+  /// of 9 values each. Eigenvalues are written in decreasing order in \a w
+  /// (3 per tensor). If \a v is not NULL, v[9*i + 3*j + k] is the component
+  /// j of the k-th eigenvector of the i-th tensor, the same layout as
+  /// TeemEigenSolver. Tensors are processed by blocks whose arithmetic is
+  /// vectorized across tensors. Results match TeemEigenSolver within the
+  /// precision of float tensors.
+  static void BatchEigenSolver(const float *tensors, vtkIdType numberOfTensors,
+                               double *w, double *v);
+  static void BatchEigenSolver(const double *tensors, vtkIdType numberOfTensors,
+                               double *w, double *v);
   void ComputeTensorIncrements(vtkImageData *imageData, vtkIdType incr[3]);
 
 protected:
@@ -275,6 +305,7 @@ protected:
   ~vtkDiffusionTensorMathematics();
 
   int Operation; /// math operation to perform
+  std::vector<int> AdditionalOperations; /// operations of the other output ports
   double ScaleFactor; /// Scale factor for output scalars
   int ExtractEigenvalues; /// Boolean controls eigenfunction extraction
 
@@ -30,6 +30,7 @@
 
 // VTK includes
 #include "vtkBitArray.h"
+#include <vtkByteSwap.h>
 #include "vtkCharArray.h"
 #include "vtkDoubleArray.h"
 #include "vtkFloatArray.h"
@@ -39,6 +40,7 @@
 #include "vtkIntArray.h"
 #include "vtkLongArray.h"
 #include "vtkMath.h"
+#include <vtkMultiThreader.h>
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkShortArray.h"
@@ -48,12 +50,323 @@
 #include "vtkUnsignedIntArray.h"
 #include "vtkUnsignedLongArray.h"
 #include <vtksys/SystemTools.hxx>
+#include <vtk_zlib.h>
+
+// vtkAddon includes
+#include <vtkAddonMappedFile.h>
 
 // Teem includes
 #include "teem/ten.h"
 
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
 vtkStandardNewMacro(vtkTeemNRRDReader);
 
+namespace
+{
+
+/// Size of the buffers used to stream and decompress the data
+const vtkTypeUInt64 STREAM_BUFFER_SIZE = 1 << 20;
+
+//----------------------------------------------------------------------------
+/// Position of the update extent in the decoded data. The data is stored
+/// with the layout of the whole extent, components interleaved.
+struct DataLayout
+{
+  vtkTypeUInt64 PixelSize;
+  /// Number of bytes of a row and number of rows of a slice of the whole extent
+  vtkTypeUInt64 RowSize;
+  vtkTypeUInt64 NumberOfRows;
+  /// Update extent, relative to the first voxel of the whole extent
+  vtkTypeUInt64 Extent[6];
+  /// Range of the decoded bytes that contains the update extent
+  vtkTypeUInt64 Begin;
+  vtkTypeUInt64 End;
+  /// Bytes to skip at the beginning of the decoded stream
+  vtkTypeUInt64 ByteSkip;
+  char* Output;
+};
+
+//----------------------------------------------------------------------------
+void InitializeLayout(DataLayout& layout, const int wholeExtent[6], const int extent[6],
+                      vtkTypeUInt64 pixelSize, vtkTypeUInt64 byteSkip, void* output)
+{
+  for (int i = 0; i < 6; ++i)
+    {
+    layout.Extent[i] = static_cast<vtkTypeUInt64>(extent[i] - wholeExtent[i - i % 2]);
+    }
+  layout.PixelSize = pixelSize;
+  layout.RowSize = static_cast<vtkTypeUInt64>(wholeExtent[1] - wholeExtent[0] + 1) * pixelSize;
+  layout.NumberOfRows = static_cast<vtkTypeUInt64>(wholeExtent[3] - wholeExtent[2] + 1);
+  layout.Begin = (layout.Extent[4] * layout.NumberOfRows + layout.Extent[2]) * layout.RowSize
+    + layout.Extent[0] * pixelSize;
+  layout.End = (layout.Extent[5] * layout.NumberOfRows + layout.Extent[3]) * layout.RowSize
+    + (layout.Extent[1] + 1) * pixelSize;
+  layout.ByteSkip = byteSkip;
+  layout.Output = static_cast<char*>(output);
+}
+
+//----------------------------------------------------------------------------
+/// Copy the decoded bytes [chunkBegin, chunkBegin + chunkSize[ of the data
+/// (byte skip excluded) that fall into the update extent to the output.
+void CopyToExtent(const DataLayout& layout, const unsigned char* chunk,
+                  vtkTypeUInt64 chunkBegin, vtkTypeUInt64 chunkSize)
+{
+  const vtkTypeUInt64 chunkEnd = chunkBegin + chunkSize;
+  if (chunkEnd <= layout.Begin || chunkBegin >= layout.End)
+    {
+    return;
+    }
+  const vtkTypeUInt64 outputRowSize = (layout.Extent[1] - layout.Extent[0] + 1) * layout.PixelSize;
+  const vtkTypeUInt64 outputSliceSize = (layout.Extent[3] - layout.Extent[2] + 1) * outputRowSize;
+  const vtkTypeUInt64 firstRow = std::max(chunkBegin, layout.Begin) / layout.RowSize;
+  const vtkTypeUInt64 lastRow = (std::min(chunkEnd, layout.End) - 1) / layout.RowSize;
+  for (vtkTypeUInt64 row = firstRow; row <= lastRow; ++row)
+    {
+    const vtkTypeUInt64 y = row % layout.NumberOfRows;
+    const vtkTypeUInt64 z = row / layout.NumberOfRows;
+    if (y < layout.Extent[2] || y > layout.Extent[3])
+      {
+      continue;
+      }
+    const vtkTypeUInt64 rowBegin = row * layout.RowSize + layout.Extent[0] * layout.PixelSize;
+    const vtkTypeUInt64 begin = std::max(rowBegin, chunkBegin);
+    const vtkTypeUInt64 end = std::min(rowBegin + outputRowSize, chunkEnd);
+    if (begin >= end)
+      {
+      continue;
+      }
+    memcpy(layout.Output + (z - layout.Extent[4]) * outputSliceSize
+      + (y - layout.Extent[2]) * outputRowSize + (begin - rowBegin),
+      chunk + (begin - chunkBegin), static_cast<size_t>(end - begin));
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Same as CopyToExtent() for bytes [decodedBegin, decodedBegin + size[ of
+/// the decoded stream, that starts with the skipped bytes.
+void CopyDecodedToExtent(const DataLayout& layout, const unsigned char* decoded,
+                         vtkTypeUInt64 decodedBegin, vtkTypeUInt64 size)
+{
+  if (decodedBegin + size <= layout.ByteSkip)
+    {
+    return;
+    }
+  if (decodedBegin < layout.ByteSkip)
+    {
+    const vtkTypeUInt64 skipped = layout.ByteSkip - decodedBegin;
+    CopyToExtent(layout, decoded + skipped, 0, size - skipped);
+    }
+  else
+    {
+    CopyToExtent(layout, decoded, decodedBegin - layout.ByteSkip, size);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Decompress gzip (or zlib) data sequentially until the update extent is
+/// decoded. Concatenated gzip members are supported. The compressed data is
+/// read either from memory or from a stream.
+bool InflateToExtent(const DataLayout& layout, const unsigned char* data, vtkTypeUInt64 dataSize,
+                     std::istream* stream)
+{
+  z_stream zstream;
+  memset(&zstream, 0, sizeof(zstream));
+  // 15: maximum window size, +32: detect gzip or zlib header
+  if (inflateInit2(&zstream, 15 + 32) != Z_OK)
+    {
+    return false;
+    }
+  std::vector<unsigned char> input(stream ? STREAM_BUFFER_SIZE : 0);
+  std::vector<unsigned char> output(STREAM_BUFFER_SIZE);
+  const vtkTypeUInt64 end = layout.ByteSkip + layout.End;
+  vtkTypeUInt64 decoded = 0;
+  int status = Z_OK;
+  bool success = true;
+  while (decoded < end)
+    {
+    if (zstream.avail_in == 0)
+      {
+      if (stream)
+        {
+        stream->read(reinterpret_cast<char*>(&input[0]), static_cast<std::streamsize>(input.size()));
+        zstream.next_in = &input[0];
+        zstream.avail_in = static_cast<uInt>(stream->gcount());
+        }
+      else
+        {
+        const vtkTypeUInt64 inputSize = std::min(dataSize, static_cast<vtkTypeUInt64>(1) << 30);
+        zstream.next_in = const_cast<Bytef*>(data);
+        zstream.avail_in = static_cast<uInt>(inputSize);
+        data += inputSize;
+        dataSize -= inputSize;
+        }
+      if (zstream.avail_in == 0)
+        {
+        // truncated data
+        success = false;
+        break;
+        }
+      }
+    if (status == Z_STREAM_END)
+      {
+      // next gzip member
+      inflateReset(&zstream);
+      }
+    zstream.next_out = &output[0];
+    zstream.avail_out = static_cast<uInt>(output.size());
+    status = inflate(&zstream, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END)
+      {
+      success = false;
+      break;
+      }
+    const vtkTypeUInt64 size = output.size() - zstream.avail_out;
+    CopyDecodedToExtent(layout, &output[0], decoded, size);
+    decoded += size;
+    }
+  inflateEnd(&zstream);
+  return success;
+}
+
+//----------------------------------------------------------------------------
+struct GzipMember
+{
+  vtkTypeUInt64 Offset;
+  vtkTypeUInt64 Size;
+  vtkTypeUInt64 DecodedOffset;
+  vtkTypeUInt64 DecodedSize;
+};
+
+//----------------------------------------------------------------------------
+/// List the members of BGZF ("blocked gzip") data, a series of gzip members
+/// that each store their compressed size in a "BC" extra subfield. Returns
+/// false if the data has another layout, in which case it can only be
+/// decompressed sequentially.
+bool GetBlockGzipMembers(const unsigned char* data, vtkTypeUInt64 dataSize,
+                         std::vector<GzipMember>& members)
+{
+  members.clear();
+  GzipMember member;
+  member.Offset = 0;
+  member.DecodedOffset = 0;
+  while (member.Offset < dataSize)
+    {
+    const unsigned char* header = data + member.Offset;
+    const vtkTypeUInt64 remainingSize = dataSize - member.Offset;
+    // magic number, deflate method and FEXTRA flag
+    if (remainingSize < 18 || header[0] != 31 || header[1] != 139 || header[2] != 8
+      || (header[3] & 4) == 0)
+      {
+      return false;
+      }
+    const vtkTypeUInt64 extraSize = header[10] | (header[11] << 8);
+    if (remainingSize < 12 + extraSize)
+      {
+      return false;
+      }
+    member.Size = 0;
+    for (vtkTypeUInt64 pos = 0; pos + 4 <= extraSize;)
+      {
+      const unsigned char* subfield = header + 12 + pos;
+      const vtkTypeUInt64 subfieldSize = subfield[2] | (subfield[3] << 8);
+      if (subfield[0] == 'B' && subfield[1] == 'C' && subfieldSize == 2 && pos + 6 <= extraSize)
+        {
+        member.Size = (subfield[4] | (subfield[5] << 8)) + 1;
+        }
+      pos += 4 + subfieldSize;
+      }
+    if (member.Size < 12 + extraSize + 8 || member.Size > remainingSize)
+      {
+      return false;
+      }
+    // ISIZE, size of the decompressed data modulo 2^32
+    const unsigned char* trailer = header + member.Size - 4;
+    member.DecodedSize = static_cast<vtkTypeUInt64>(trailer[0])
+      | (static_cast<vtkTypeUInt64>(trailer[1]) << 8)
+      | (static_cast<vtkTypeUInt64>(trailer[2]) << 16)
+      | (static_cast<vtkTypeUInt64>(trailer[3]) << 24);
+    members.push_back(member);
+    member.Offset += member.Size;
+    member.DecodedOffset += member.DecodedSize;
+    }
+  return !members.empty();
+}
+
+//----------------------------------------------------------------------------
+struct ReadThreadData
+{
+  const DataLayout* Layout;
+  /// Data in memory, after the header
+  const unsigned char* Data;
+  /// Empty if the data is not compressed
+  const std::vector<GzipMember>* Members;
+  int Error;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ReadThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  ReadThreadData* data = static_cast<ReadThreadData*>(info->UserData);
+  const DataLayout& layout = *data->Layout;
+  const vtkTypeUInt64 threadId = static_cast<vtkTypeUInt64>(info->ThreadID);
+  const vtkTypeUInt64 numberOfThreads = static_cast<vtkTypeUInt64>(info->NumberOfThreads);
+
+  if (data->Members->empty())
+    {
+    // raw data: copy a part of the update extent
+    const vtkTypeUInt64 size = layout.End - layout.Begin;
+    const vtkTypeUInt64 begin = layout.Begin + size * threadId / numberOfThreads;
+    const vtkTypeUInt64 end = layout.Begin + size * (threadId + 1) / numberOfThreads;
+    CopyToExtent(layout, data->Data + begin, begin, end - begin);
+    return VTK_THREAD_RETURN_VALUE;
+    }
+
+  // compressed data: decompress a range of members
+  const std::vector<GzipMember>& members = *data->Members;
+  const vtkTypeUInt64 numberOfMembers = members.size();
+  z_stream zstream;
+  memset(&zstream, 0, sizeof(zstream));
+  // 15: maximum window size, +16: gzip header
+  if (inflateInit2(&zstream, 15 + 16) != Z_OK)
+    {
+    data->Error = 1;
+    return VTK_THREAD_RETURN_VALUE;
+    }
+  std::vector<unsigned char> decoded;
+  for (vtkTypeUInt64 i = numberOfMembers * threadId / numberOfThreads;
+    i < numberOfMembers * (threadId + 1) / numberOfThreads && !data->Error; ++i)
+    {
+    const GzipMember& member = members[i];
+    if (member.DecodedSize == 0
+      || member.DecodedOffset + member.DecodedSize <= layout.ByteSkip + layout.Begin
+      || member.DecodedOffset >= layout.ByteSkip + layout.End)
+      {
+      continue;
+      }
+    decoded.resize(static_cast<size_t>(member.DecodedSize));
+    inflateReset(&zstream);
+    zstream.next_in = const_cast<Bytef*>(data->Data + member.Offset);
+    zstream.avail_in = static_cast<uInt>(member.Size);
+    zstream.next_out = &decoded[0];
+    zstream.avail_out = static_cast<uInt>(decoded.size());
+    if (inflate(&zstream, Z_FINISH) != Z_STREAM_END || zstream.avail_out != 0)
+      {
+      data->Error = 1;
+      break;
+      }
+    CopyDecodedToExtent(layout, &decoded[0], member.DecodedOffset, member.DecodedSize);
+    }
+  inflateEnd(&zstream);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 vtkTeemNRRDReader::vtkTeemNRRDReader()
 {
@@ -66,6 +379,13 @@ vtkTeemNRRDReader::vtkTeemNRRDReader()
   this->PointDataType = -1;
   this->DataType = -1;
   this->NumberOfComponents = -1;
+  this->UseMemoryMapping = true;
+  this->NumberOfThreads = 0;
+  this->CanReadDataDirectly = false;
+  this->DataFileOffset = 0;
+  this->DataByteSkip = 0;
+  this->DataCompressed = false;
+  this->DataSwapBytes = false;
 }
 
 //----------------------------------------------------------------------------
@@ -343,6 +663,7 @@ void vtkTeemNRRDReader::ExecuteInformation()
     return;
     }
   this->CurrentFileName = this->GetFileName();
+  this->CanReadDataDirectly = false;
 
   nrrdNuke(this->nrrd); // nuke and reallocate to reset the state
   this->nrrd = nrrdNew();
@@ -658,6 +979,8 @@ void vtkTeemNRRDReader::ExecuteInformation()
       }
     }
 
+  this->UpdateDataFileInformation(nio);
+
   this->vtkImageReader2::ExecuteInformation();
   nio = nrrdIoStateNix(nio);
 }
@@ -885,43 +1208,243 @@ int vtkTeemNRRDReader::tenSpaceDirectionReduce(Nrrd *nout, const Nrrd *nin, doub
   return 0;
 }
 
+//----------------------------------------------------------------------------
+void vtkTeemNRRDReader::UpdateDataFileInformation(NrrdIoState *nio)
+{
+  this->CanReadDataDirectly = false;
+  this->DataFileName.clear();
+  this->DataFileOffset = 0;
+  this->DataByteSkip = nio->byteSkip;
+  this->DataCompressed = (nio->encoding == nrrdEncodingGzip);
+
+  if (nio->encoding != nrrdEncodingRaw && nio->encoding != nrrdEncodingGzip)
+    {
+    return;
+    }
+  if (nio->lineSkip > 0 || (nio->byteSkip < 0 && this->DataCompressed))
+    {
+    return;
+    }
+  // Data split across several files
+  if (nio->dataFNFormat != NULL || (nio->dataFNArr != NULL && nio->dataFNArr->len > 1))
+    {
+    return;
+    }
+  // The data must have the layout of the output scalars: components first
+  // and no tensor expansion.
+  if (this->DataType == VTK_VOID || this->DataType == -1)
+    {
+    return;
+    }
+  unsigned int rangeAxisIdx[NRRD_DIM_MAX] = { 0 };
+  unsigned int rangeAxisNum = nrrdRangeAxesGet(this->nrrd, rangeAxisIdx);
+  if (rangeAxisNum > 1
+    || (rangeAxisNum == 1
+      && (rangeAxisIdx[0] != 0
+        || static_cast<int>(this->nrrd->axis[0].size) != this->NumberOfComponents
+        || nrrdKind3DMaskedSymMatrix == this->nrrd->axis[0].kind
+        || nrrdKind3DSymMatrix == this->nrrd->axis[0].kind)))
+    {
+    return;
+    }
+
+  if (nio->dataFNArr != NULL && nio->dataFNArr->len == 1 && strcmp(nio->dataFN[0], "LOCAL") != 0)
+    {
+    // detached header
+    this->DataFileName = nio->dataFN[0];
+    if (!vtksys::SystemTools::FileIsFullPath(this->DataFileName.c_str()))
+      {
+      this->DataFileName = vtksys::SystemTools::CollapseFullPath(this->DataFileName.c_str(),
+        vtksys::SystemTools::GetFilenamePath(this->GetFileName()).c_str());
+      }
+    }
+  else
+    {
+    // the data follows the header, that ends with the first empty line
+    this->DataFileName = this->GetFileName();
+    std::ifstream headerStream(this->GetFileName(), std::ios::in | std::ios::binary);
+    std::string line;
+    while (std::getline(headerStream, line) && !line.empty() && line != "\r")
+      {
+      }
+    if (!headerStream)
+      {
+      return;
+      }
+    this->DataFileOffset = static_cast<vtkTypeInt64>(headerStream.tellg());
+    }
+
+  size_t elementSize = nrrdElementSize(this->nrrd);
+#ifdef VTK_WORDS_BIGENDIAN
+  const int hostEndian = airEndianBig;
+#else
+  const int hostEndian = airEndianLittle;
+#endif
+  this->DataSwapBytes = (elementSize > 1 && nio->endian != hostEndian);
+  this->CanReadDataDirectly = true;
+}
 
 //----------------------------------------------------------------------------
-// This function reads a data from a file.  The datas extent/axes
-// are assumed to be the same as the file extent/order.
-void vtkTeemNRRDReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInformation* outInfo)
+bool vtkTeemNRRDReader::ReadDataDirectly(vtkImageData *imageData, void *ptr)
 {
-  if (this->GetOutputInformation(0))
+  if (!ptr)
     {
-    this->GetOutputInformation(0)->Set(
-      vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
-      this->GetOutputInformation(0)->Get(
-        vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+    return false;
+    }
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  imageData->GetExtent(extent);
+  if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+    return true;
+    }
+  const vtkTypeUInt64 elementSize = vtkDataArray::GetDataTypeSize(this->DataType);
+  const vtkTypeUInt64 pixelSize = elementSize * this->NumberOfComponents;
+  const vtkTypeUInt64 dataSize = pixelSize
+    * (this->DataExtent[1] - this->DataExtent[0] + 1)
+    * (this->DataExtent[3] - this->DataExtent[2] + 1)
+    * (this->DataExtent[5] - this->DataExtent[4] + 1);
+
+  vtkAddonMappedFile mappedFile;
+  vtkTypeUInt64 fileSize = 0;
+  if (this->UseMemoryMapping && mappedFile.Open(this->DataFileName))
+    {
+    fileSize = mappedFile.GetSize();
+    }
+  else
+    {
+    fileSize = vtksys::SystemTools::FileLength(this->DataFileName.c_str());
     }
 
-  vtkImageData *imageData = this->AllocateOutputData(output, outInfo);
+  vtkTypeUInt64 dataOffset = static_cast<vtkTypeUInt64>(this->DataFileOffset);
+  vtkTypeUInt64 byteSkip = 0;
+  if (this->DataCompressed)
+    {
+    // the byte skip applies to the decompressed data
+    byteSkip = static_cast<vtkTypeUInt64>(this->DataByteSkip);
+    }
+  else if (this->DataByteSkip < 0)
+    {
+    if (fileSize < dataSize)
+      {
+      vtkWarningMacro("Read: " << this->DataFileName << " is too small for the data size");
+      return false;
+      }
+    dataOffset = fileSize - dataSize;
+    }
+  else
+    {
+    dataOffset += static_cast<vtkTypeUInt64>(this->DataByteSkip);
+    }
+  if (fileSize < dataOffset || (!this->DataCompressed && fileSize - dataOffset < dataSize))
+    {
+    vtkWarningMacro("Read: " << this->DataFileName << " is too small for the data size");
+    return false;
+    }
 
-  if (this->GetFileName() == NULL)
+  DataLayout layout;
+  InitializeLayout(layout, this->DataExtent, extent, pixelSize, byteSkip, ptr);
+
+  std::vector<GzipMember> members;
+  bool success = true;
+  if (mappedFile.GetData()
+    && (!this->DataCompressed
+      || GetBlockGzipMembers(mappedFile.GetData() + dataOffset, fileSize - dataOffset, members)))
     {
-    vtkErrorMacro(<< "Either a FileName or FilePrefix must be specified.");
-    return;
+    // copy or decompress parts of the data on multiple threads
+    ReadThreadData data;
+    data.Layout = &layout;
+    data.Data = mappedFile.GetData() + dataOffset;
+    data.Members = &members;
+    data.Error = 0;
+
+    const vtkTypeUInt64 workSize = this->DataCompressed ?
+      static_cast<vtkTypeUInt64>(members.size()) : (layout.End - layout.Begin) / STREAM_BUFFER_SIZE;
+    int numberOfThreads = this->NumberOfThreads > 0 ?
+      this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    numberOfThreads = static_cast<int>(std::max(static_cast<vtkTypeUInt64>(1),
+      std::min(static_cast<vtkTypeUInt64>(numberOfThreads), workSize)));
+
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(ReadThreadFunction, &data);
+    threader->SingleMethodExecute();
+    success = (data.Error == 0);
+    }
+  else if (this->DataCompressed)
+    {
+    // a single gzip stream can only be decompressed sequentially
+    if (mappedFile.GetData())
+      {
+      success = InflateToExtent(layout, mappedFile.GetData() + dataOffset, fileSize - dataOffset, NULL);
+      }
+    else
+      {
+      std::ifstream dataStream(this->DataFileName.c_str(), std::ios::in | std::ios::binary);
+      dataStream.seekg(static_cast<std::streamoff>(dataOffset));
+      success = dataStream.good() && InflateToExtent(layout, NULL, 0, &dataStream);
+      }
+    }
+  else
+    {
+    // read the rows of the update extent through a buffer, or directly into
+    // the output when the update extent is contiguous in the file
+    std::ifstream dataStream(this->DataFileName.c_str(), std::ios::in | std::ios::binary);
+    dataStream.seekg(static_cast<std::streamoff>(dataOffset + layout.Begin));
+    const bool contiguous = (layout.End - layout.Begin
+      == static_cast<vtkTypeUInt64>(imageData->GetNumberOfPoints()) * pixelSize);
+    std::vector<unsigned char> buffer(contiguous ? 0 : STREAM_BUFFER_SIZE);
+    for (vtkTypeUInt64 position = layout.Begin; position < layout.End && success;)
+      {
+      const vtkTypeUInt64 size = std::min(layout.End - position, STREAM_BUFFER_SIZE);
+      char* destination = contiguous ?
+        layout.Output + (position - layout.Begin) : reinterpret_cast<char*>(&buffer[0]);
+      dataStream.read(destination, static_cast<std::streamsize>(size));
+      success = !dataStream.fail();
+      if (success && !contiguous)
+        {
+        CopyToExtent(layout, &buffer[0], position, size);
+        }
+      position += size;
+      }
+    }
+  if (!success)
+    {
+    vtkWarningMacro("Read: Error reading data from " << this->DataFileName);
+    return false;
     }
 
-  // Read in the this->nrrd.  Yes, this means that the header is being read
-  // twice: once by ExecuteInformation, and once here
-  if ( nrrdLoad(this->nrrd, this->GetFileName(), NULL) != 0 )
+  if (this->DataSwapBytes)
     {
-    char *err =  biffGetDone(NRRD); // would be nice to free(err)
-    vtkErrorMacro("Read: Error reading " << this->GetFileName() << ":\n" << err);
-    return;
+    vtkByteSwap::SwapVoidRange(ptr,
+      static_cast<size_t>(imageData->GetNumberOfPoints() * this->NumberOfComponents),
+      static_cast<size_t>(elementSize));
     }
+  return true;
+}
 
-  if (this->nrrd->data == NULL)
+//----------------------------------------------------------------------------
+// This function reads a data from a file.  The datas extent/axes
+// are assumed to be the same as the file extent/order.
+void vtkTeemNRRDReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInformation* outInfo)
+{
+  if (this->GetFileName() == NULL)
     {
-    vtkErrorMacro(<< "data is null.");
+    vtkErrorMacro(<< "Either a FileName or FilePrefix must be specified.");
     return;
     }
 
+  // Only the direct read can decode a part of the volume. The header was
+  // parsed by ExecuteInformation() in RequestInformation.
+  if (!this->CanReadDataDirectly && this->GetOutputInformation(0))
+    {
+    this->GetOutputInformation(0)->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+      this->GetOutputInformation(0)->Get(
+        vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+    }
+
+  vtkImageData *imageData = this->AllocateOutputData(output, outInfo);
+
   void *ptr = NULL;
   switch(this->PointDataType)
     {
@@ -946,6 +1469,41 @@ void vtkTeemNRRDReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInf
     }
   this->ComputeDataIncrements();
 
+  if (this->CanReadDataDirectly)
+    {
+    // decode the data straight into the output scalars, without loading the
+    // whole volume in a teem buffer first
+    if (this->ReadDataDirectly(imageData, ptr))
+      {
+      return;
+      }
+    // teem can only load the whole volume
+    int extent[6] = { 0, -1, 0, -1, 0, -1 };
+    imageData->GetExtent(extent);
+    if (!std::equal(extent, extent + 6, this->DataExtent))
+      {
+      vtkErrorMacro("Read: Error reading data from " << this->DataFileName);
+      this->ReadStatus = 1;
+      return;
+      }
+    vtkWarningMacro("Read: direct read of " << this->DataFileName << " failed, loading it with teem");
+    }
+
+  // Read in the this->nrrd.  Yes, this means that the header is being read
+  // twice: once by ExecuteInformation, and once here
+  if ( nrrdLoad(this->nrrd, this->GetFileName(), NULL) != 0 )
+    {
+    char *err =  biffGetDone(NRRD); // would be nice to free(err)
+    vtkErrorMacro("Read: Error reading " << this->GetFileName() << ":\n" << err);
+    return;
+    }
+
+  if (this->nrrd->data == NULL)
+    {
+    vtkErrorMacro(<< "data is null.");
+    return;
+    }
+
   unsigned int rangeAxisIdx[NRRD_DIM_MAX] = { 0 };
   unsigned int rangeAxisNum = nrrdRangeAxesGet(this->nrrd, rangeAxisIdx);
   if (rangeAxisNum > 1)
@@ -31,6 +31,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <iostream>
 
 #include "vtkTeemConfigure.h"
@@ -128,6 +129,20 @@ public:
   vtkGetMacro(NumberOfComponents,int);
 
 
+  ///
+  /// Map uncompressed data files in memory instead of reading them
+  /// through a file stream. Enabled by default, it can be disabled for
+  /// file systems where memory mapping performs poorly.
+  vtkSetMacro(UseMemoryMapping,bool);
+  vtkGetMacro(UseMemoryMapping,bool);
+  vtkBooleanMacro(UseMemoryMapping,bool);
+
+  ///
+  /// Number of threads used to copy and decompress the data,
+  /// 0 means the vtkMultiThreader default.
+  vtkSetClampMacro(NumberOfThreads,int,0,VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads,int);
+
   ///
   /// Use image origin from the file
   void SetUseNativeOriginOn()
@@ -251,6 +266,21 @@ protected:
   int DataType;
   int NumberOfComponents;
   bool UseNativeOrigin;
+  bool UseMemoryMapping;
+  int NumberOfThreads;
+
+  /// Set by ExecuteInformation() when the data is stored in a single raw or
+  /// gzip encoded file with the layout of the output scalars, so that
+  /// ReadDataDirectly() can decode it straight into the output.
+  bool CanReadDataDirectly;
+  std::string DataFileName;
+  /// Offset of the data in DataFileName (size of the attached header)
+  vtkTypeInt64 DataFileOffset;
+  /// NRRD "byte skip": skipped bytes of the decoded stream, -1 means that
+  /// the raw data is at the end of the file.
+  vtkTypeInt64 DataByteSkip;
+  bool DataCompressed;
+  bool DataSwapBytes;
 
   std::map <std::string, std::string> HeaderKeyValue;
   std::string HeaderKeys; // buffer for returning key list
@@ -263,6 +293,15 @@ protected:
 
   int tenSpaceDirectionReduce(Nrrd *nout, const Nrrd *nin, double SD[9]);
 
+  /// Find where the data is stored from the state of the header reader
+  void UpdateDataFileInformation(NrrdIoState *nio);
+
+  /// Decode the update extent of the data file into \a ptr without
+  /// intermediate copy of the whole volume.
+  /// Return false if the data could not be read, in which case the whole
+  /// volume can still be loaded by teem.
+  bool ReadDataDirectly(vtkImageData *imageData, void *ptr);
+
 private:
   vtkTeemNRRDReader(const vtkTeemNRRDReader&);  /// Not implemented.
   void operator=(const vtkTeemNRRDReader&);  /// Not implemented.
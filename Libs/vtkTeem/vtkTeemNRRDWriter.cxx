@@ -7,13 +7,146 @@
 #include "vtkPointData.h"
 #include "vtkObjectFactory.h"
 #include "vtkInformation.h"
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
 #include <vtkVersion.h>
+#include <vtksys/SystemTools.hxx>
+#include <vtk_zlib.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
 
 class AttributeMapType: public std::map<std::string, std::string> {};
 class AxisInfoMapType : public std::map<unsigned int, std::string> {};
 
 vtkStandardNewMacro(vtkTeemNRRDWriter);
 
+namespace
+{
+
+/// Uncompressed size of a BGZF member, small enough for the compressed
+/// member to always fit in 64 KiB
+const vtkTypeUInt64 BGZF_BLOCK_SIZE = 0xff00;
+const vtkTypeUInt64 BGZF_MAX_MEMBER_SIZE = 0x10000;
+const vtkTypeUInt64 BGZF_HEADER_SIZE = 18;
+const vtkTypeUInt64 BGZF_FOOTER_SIZE = 8;
+/// Number of members compressed by each thread before they are written
+const vtkTypeUInt64 BGZF_BLOCKS_PER_THREAD = 64;
+
+/// Empty member that marks the end of BGZF data
+const unsigned char BGZF_EOF[28] =
+{
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+  0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+//----------------------------------------------------------------------------
+void WriteLittleEndian(unsigned char* buffer, vtkTypeUInt64 value, int numberOfBytes)
+{
+  for (int i = 0; i < numberOfBytes; ++i)
+    {
+    buffer[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Compress \a size bytes into a gzip member with a "BC" extra subfield
+/// holding the member size. Returns the member size, 0 on error.
+vtkTypeUInt64 CompressBlock(z_stream& zstream, z_stream& storedZStream,
+                            const unsigned char* data, vtkTypeUInt64 size,
+                            unsigned char* member)
+{
+  // gzip header: magic, deflate, FEXTRA, no time, unknown OS, 6 extra bytes
+  const unsigned char header[12] = { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0x00 };
+  memcpy(member, header, 12);
+  member[12] = 'B';
+  member[13] = 'C';
+  WriteLittleEndian(member + 14, 2, 2);
+
+  // incompressible data is stored, which always fits in a member
+  z_stream* streams[2] = { &zstream, &storedZStream };
+  vtkTypeUInt64 compressedSize = 0;
+  for (int i = 0; i < 2 && compressedSize == 0; ++i)
+    {
+    z_stream& stream = *streams[i];
+    deflateReset(&stream);
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = member + BGZF_HEADER_SIZE;
+    stream.avail_out = static_cast<uInt>(BGZF_MAX_MEMBER_SIZE - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE);
+    if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+      {
+      compressedSize = stream.total_out;
+      }
+    }
+  if (compressedSize == 0)
+    {
+    return 0;
+    }
+
+  const vtkTypeUInt64 memberSize = BGZF_HEADER_SIZE + compressedSize + BGZF_FOOTER_SIZE;
+  WriteLittleEndian(member + 16, memberSize - 1, 2);
+  unsigned char* footer = member + BGZF_HEADER_SIZE + compressedSize;
+  WriteLittleEndian(footer, crc32(crc32(0L, Z_NULL, 0), data, static_cast<uInt>(size)), 4);
+  WriteLittleEndian(footer + 4, size, 4);
+  return memberSize;
+}
+
+//----------------------------------------------------------------------------
+struct CompressThreadData
+{
+  const unsigned char* Data;
+  vtkTypeUInt64 DataSize;
+  int Level;
+  /// Blocks of the current batch
+  vtkTypeUInt64 FirstBlock;
+  vtkTypeUInt64 NumberOfBlocks;
+  /// Compressed members of the batch, MAX_MEMBER_SIZE bytes per block
+  std::vector<unsigned char> Members;
+  std::vector<vtkTypeUInt64> MemberSizes;
+  int Error;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE CompressThreadFunction(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  CompressThreadData* data = static_cast<CompressThreadData*>(info->UserData);
+  const vtkTypeUInt64 threadId = static_cast<vtkTypeUInt64>(info->ThreadID);
+  const vtkTypeUInt64 numberOfThreads = static_cast<vtkTypeUInt64>(info->NumberOfThreads);
+
+  z_stream zstream;
+  z_stream storedZStream;
+  memset(&zstream, 0, sizeof(zstream));
+  memset(&storedZStream, 0, sizeof(storedZStream));
+  // raw deflate streams (-15), the gzip header is written by CompressBlock
+  if (deflateInit2(&zstream, data->Level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK
+    || deflateInit2(&storedZStream, 0, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+    data->Error = 1;
+    }
+  for (vtkTypeUInt64 i = data->NumberOfBlocks * threadId / numberOfThreads;
+    i < data->NumberOfBlocks * (threadId + 1) / numberOfThreads && !data->Error; ++i)
+    {
+    const vtkTypeUInt64 begin = (data->FirstBlock + i) * BGZF_BLOCK_SIZE;
+    const vtkTypeUInt64 size = std::min(BGZF_BLOCK_SIZE, data->DataSize - begin);
+    data->MemberSizes[i] = CompressBlock(zstream, storedZStream, data->Data + begin, size,
+      &data->Members[i * BGZF_MAX_MEMBER_SIZE]);
+    if (data->MemberSizes[i] == 0)
+      {
+      data->Error = 1;
+      }
+    }
+  deflateEnd(&zstream);
+  deflateEnd(&storedZStream);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 vtkTeemNRRDWriter::vtkTeemNRRDWriter()
 {
@@ -23,6 +156,9 @@ vtkTeemNRRDWriter::vtkTeemNRRDWriter()
   this->IJKToRASMatrix = vtkMatrix4x4::New();
   this->MeasurementFrameMatrix = vtkMatrix4x4::New();
   this->UseCompression = 1;
+  this->ParallelCompression = 1;
+  this->CompressionLevel = -1;
+  this->NumberOfThreads = 0;
   this->DiffusionWeigthedData = 0;
   this->FileType = VTK_BINARY;
   this->WriteErrorOff();
@@ -376,11 +512,24 @@ void vtkTeemNRRDWriter::WriteData()
       }
     }
 
+  nio->zlibLevel = this->CompressionLevel;
+
   // set endianness as unknown of output
   nio->endian = airEndianUnknown;
 
+  // Detached headers are left to teem, that knows how to name the data file
+  std::string extension = vtksys::SystemTools::LowerCase(
+    vtksys::SystemTools::GetFilenameLastExtension(this->GetFileName()));
+  if (nio->encoding == nrrdEncodingGzip && this->ParallelCompression
+    && extension == ".nrrd" && nrrd->data != NULL)
+    {
+    if (!this->WriteParallelCompressedData(nrrd, nio))
+      {
+      this->WriteErrorOn();
+      }
+    }
   // Write the nrrd to file.
-  if (nrrdSave(this->GetFileName(), nrrd, nio))
+  else if (nrrdSave(this->GetFileName(), nrrd, nio))
     {
     char *err = biffGetDone(NRRD); // would be nice to free(err)
     vtkErrorMacro("Write: Error writing "
@@ -393,6 +542,69 @@ void vtkTeemNRRDWriter::WriteData()
   return;
 }
 
+//----------------------------------------------------------------------------
+bool vtkTeemNRRDWriter::WriteParallelCompressedData(Nrrd *nrrd, NrrdIoState *nio)
+{
+  // Let teem format the header only
+  nio->format = nrrdFormatNRRD;
+  nrrdIoStateSet(nio, nrrdIoStateSkipData, AIR_TRUE);
+  char *headerString = NULL;
+  if (nrrdStringWrite(&headerString, nrrd, nio))
+    {
+    char *err = biffGetDone(NRRD); // would be nice to free(err)
+    vtkErrorMacro("Write: Error writing header of "
+                      << this->GetFileName() << ":\n" << err);
+    return false;
+    }
+  std::string header(headerString);
+  free(headerString);
+  // attached data starts after the first empty line
+  header.erase(header.find_last_not_of('\n') + 1);
+  header += "\n\n";
+
+  std::ofstream file(this->GetFileName(), std::ios::out | std::ios::binary);
+  file.write(header.c_str(), static_cast<std::streamsize>(header.size()));
+
+  CompressThreadData data;
+  data.Data = static_cast<const unsigned char*>(nrrd->data);
+  data.DataSize = static_cast<vtkTypeUInt64>(nrrdElementNumber(nrrd) * nrrdElementSize(nrrd));
+  data.Level = this->CompressionLevel;
+  data.Error = 0;
+  const vtkTypeUInt64 numberOfBlocks = (data.DataSize + BGZF_BLOCK_SIZE - 1) / BGZF_BLOCK_SIZE;
+
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = static_cast<int>(std::max(static_cast<vtkTypeUInt64>(1),
+    std::min(static_cast<vtkTypeUInt64>(numberOfThreads), numberOfBlocks)));
+  const vtkTypeUInt64 blocksPerBatch = numberOfThreads * BGZF_BLOCKS_PER_THREAD;
+  data.Members.resize(static_cast<size_t>(std::min(blocksPerBatch, numberOfBlocks) * BGZF_MAX_MEMBER_SIZE));
+  data.MemberSizes.resize(static_cast<size_t>(std::min(blocksPerBatch, numberOfBlocks)));
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(numberOfThreads);
+  threader->SetSingleMethod(CompressThreadFunction, &data);
+  for (data.FirstBlock = 0; data.FirstBlock < numberOfBlocks && file.good() && !data.Error;
+    data.FirstBlock += blocksPerBatch)
+    {
+    data.NumberOfBlocks = std::min(blocksPerBatch, numberOfBlocks - data.FirstBlock);
+    threader->SingleMethodExecute();
+    for (vtkTypeUInt64 i = 0; i < data.NumberOfBlocks && !data.Error; ++i)
+      {
+      file.write(reinterpret_cast<const char*>(&data.Members[i * BGZF_MAX_MEMBER_SIZE]),
+        static_cast<std::streamsize>(data.MemberSizes[i]));
+      }
+    }
+  file.write(reinterpret_cast<const char*>(BGZF_EOF), sizeof(BGZF_EOF));
+  file.close();
+
+  if (data.Error || file.fail())
+    {
+    vtkErrorMacro("Write: Error writing compressed data to " << this->GetFileName());
+    return false;
+    }
+  return true;
+}
+
 void vtkTeemNRRDWriter::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
@@ -55,6 +55,27 @@ public:
   vtkGetMacro(UseCompression,int);
   vtkBooleanMacro(UseCompression,int);
 
+  ///
+  /// Compress independent chunks of the data on multiple threads when
+  /// writing a compressed .nrrd file. The data is then stored as a series of
+  /// gzip members (BGZF layout) that any gzip or NRRD reader can decompress.
+  /// On by default.
+  vtkSetMacro(ParallelCompression,int);
+  vtkGetMacro(ParallelCompression,int);
+  vtkBooleanMacro(ParallelCompression,int);
+
+  ///
+  /// zlib compression level, from 0 (no compression) to 9 (best
+  /// compression), -1 means the zlib default.
+  vtkSetClampMacro(CompressionLevel,int,-1,9);
+  vtkGetMacro(CompressionLevel,int);
+
+  ///
+  /// Number of threads used by the parallel compression,
+  /// 0 means the vtkMultiThreader default.
+  vtkSetClampMacro(NumberOfThreads,int,0,VTK_INT_MAX);
+  vtkGetMacro(NumberOfThreads,int);
+
   vtkSetClampMacro(FileType,int,VTK_ASCII,VTK_BINARY);
   vtkGetMacro(FileType,int);
   void SetFileTypeToASCII() {this->SetFileType(VTK_ASCII);};
@@ -92,6 +113,11 @@ protected:
   /// Write method. It is called by vtkWriter::Write();
   void WriteData() VTK_OVERRIDE;
 
+  ///
+  /// Write the header with teem and the data as BGZF members compressed on
+  /// multiple threads.
+  bool WriteParallelCompressedData(Nrrd *nrrd, NrrdIoState *nio);
+
   ///
   /// Flag to set to on when a write error occured
   int WriteError;
@@ -105,6 +131,9 @@ protected:
   vtkMatrix4x4* MeasurementFrameMatrix;
 
   int UseCompression;
+  int ParallelCompression;
+  int CompressionLevel;
+  int NumberOfThreads;
   int FileType;
 
   AttributeMapType *Attributes;
@@ -24,12 +24,12 @@
 #include <itkRigid3DTransform.h>
 #include <itkThinPlateSplineKernelTransform.h>
 #include <itkTransformFileReader.h>
-#include <itkVectorResampleImageFilter.h>
 #include <itkWindowedSincInterpolateImageFunction.h>
 #include <itkConstantBoundaryCondition.h>
 
 // ResampleScalarVectorDWIVolume includes
 #include "ResampleScalarVectorDWIVolumeCLP.h"
+#include "itkMultiComponentResampleImageFilter.h"
 
 // ResampleDTIVolume includes
 #include "dtiprocessFiles/deformationfieldio.h"
@@ -462,18 +462,14 @@ void ResampleDeformationField( DeformationImageType::Pointer & field,
     {
     return;
     }
-  typedef itk::VectorLinearInterpolateImageFunction<DeformationImageType> VectorInterpolatorType;
-  VectorInterpolatorType::Pointer linearVectorInterpolator = VectorInterpolatorType::New();
-  typedef itk::VectorResampleImageFilter<DeformationImageType,
-                                         DeformationImageType,
-                                         double
-                                         > ResampleImageFilter;
+  // Linear interpolation of the 3 components at once, identity transform
+  typedef itk::MultiComponentResampleImageFilter<DeformationImageType,
+                                                 DeformationImageType
+                                                 > ResampleImageFilter;
   ResampleImageFilter::Pointer resampleFieldFilter = ResampleImageFilter::New();
-  DeformationPixelType         defaultPixel;
-  defaultPixel.Fill( 0.0 );
-  resampleFieldFilter->SetDefaultPixelValue( defaultPixel );
+  resampleFieldFilter->SetDefaultPixelValue( 0.0 );
   resampleFieldFilter->SetInput( field );
-  resampleFieldFilter->SetInterpolator( linearVectorInterpolator );
+  resampleFieldFilter->SetInterpolation( ResampleImageFilter::Linear );
   resampleFieldFilter->SetOutputDirection( direction );
   resampleFieldFilter->SetSize( size );
   resampleFieldFilter->SetOutputSpacing( spacing );
@@ -684,45 +680,6 @@ SetAllTransform( parameters & list,
   return transform;
 }
 
-// Write back the vector of images into a image vector
-template <class PixelType>
-int AddImage( typename itk::VectorImage<PixelType, 3>
-              ::Pointer & imagePile,
-              const std::vector<typename itk::Image<PixelType, 3>::Pointer> & vectorImage
-              )
-{
-  typedef itk::Image<PixelType, 3> ImageType;
-  imagePile->SetRegions( vectorImage.at( 0 )->GetLargestPossibleRegion().GetSize() );
-  imagePile->SetOrigin( vectorImage.at( 0 )->GetOrigin() );
-  imagePile->SetDirection( vectorImage.at( 0 )->GetDirection() );
-  imagePile->SetSpacing( vectorImage.at( 0 )->GetSpacing() );
-  imagePile->SetVectorLength( vectorImage.size() );
-  imagePile->Allocate();
-  typename itk::ImageRegionIterator<itk::VectorImage<PixelType, 3> > out( imagePile,
-                                                                          imagePile->GetLargestPossibleRegion()
-                                                                          );
-  typedef typename itk::ImageRegionIterator<ImageType> IteratorImageType;
-  std::vector<IteratorImageType> in;
-  for( unsigned int i = 0; i < imagePile->GetVectorLength(); i++ )
-    {
-    IteratorImageType intemp( vectorImage.at( i ), vectorImage.at( i )->GetLargestPossibleRegion() );
-    intemp.GoToBegin();
-    in.push_back( intemp );
-    }
-  itk::VariableLengthVector<PixelType> value;
-  value.SetSize( vectorImage.size() );
-  for( out.GoToBegin(); !out.IsAtEnd(); ++out )
-    {
-    for( unsigned int i = 0; i < imagePile->GetVectorLength(); i++ )
-      {
-      value.SetElement( i, in.at( i ).Get() );
-      ++in[i];
-      }
-    out.Set( value );
-    }
-  return EXIT_SUCCESS;
-}
-
 // Separate the vector image into a vector of images
 template <class PixelType>
 int SeparateImages( const typename itk::VectorImage<PixelType, 3>
@@ -1216,12 +1173,13 @@ SetInterpolator( const parameters & list )
 template <class PixelType>
 int Rotate( parameters & list )
 {
-  typedef itk::Image<PixelType, 3>                         ImageType;
-  typedef itk::InterpolateImageFunction<ImageType, double> InterpolatorType;
-  typedef itk::ResampleImageFilter<ImageType, ImageType>   ResampleType;
-  typedef itk::Transform<double, 3, 3>                     TransformType;
-  typedef itk::VectorImage<PixelType, 3>                   VectorImageType;
-  typename ImageType::Pointer image;
+  typedef itk::Image<PixelType, 3>                                                 ImageType;
+  typedef itk::InterpolateImageFunction<ImageType, double>                         InterpolatorType;
+  typedef itk::ResampleImageFilter<ImageType, ImageType>                           ResampleType;
+  typedef itk::Transform<double, 3, 3>                                             TransformType;
+  typedef itk::VectorImage<PixelType, 3>                                           VectorImageType;
+  typedef itk::MultiComponentResampleImageFilter<VectorImageType, VectorImageType> VectorResampleType;
+  typename VectorImageType::Pointer        inputImage;
   std::vector<typename ImageType::Pointer> vectorOfImage;
   itk::MetaDataDictionary                  dico;
   try
@@ -1237,42 +1195,113 @@ int Rotate( parameters & list )
       }
     // Save metadata dictionary
     dico = reader->GetOutput()->GetMetaDataDictionary();
-    // Separate the vector image into a vector of images
-    SeparateImages<PixelType>( reader->GetOutput(), vectorOfImage );
+    inputImage = reader->GetOutput();
+    inputImage->DisconnectPipeline();
+    // Interpolators other than nearest neighbor and linear work on scalar
+    // images: separate the vector image into a vector of images
+    if( list.interpolationType.compare( "nn" ) && list.interpolationType.compare( "linear" ) )
+      {
+      SeparateImages<PixelType>( inputImage, vectorOfImage );
+      }
     }
   catch( itk::ExceptionObject exception )
     {
     std::cerr << exception << std::endl;
     return EXIT_FAILURE;
     }
-  // Set interpolator
-  typename InterpolatorType::Pointer interpol;
-  interpol = SetInterpolator<ImageType>( list );
+  // Scalar image with the geometry of the input, without voxels, used to
+  // compute the output parameters and the transforms
+  typename ImageType::Pointer image = ImageType::New();
+  image->CopyInformation( inputImage );
+  image->SetRegions( inputImage->GetLargestPossibleRegion() );
   // Create resampler and initialize its output parameters
   typename ResampleType::Pointer resample = ResampleType::New();
-  SetOutputParameters<ImageType>( list, resample, vectorOfImage[0] );
+  SetOutputParameters<ImageType>( list, resample, image );
   TransformType::Pointer transform;
   // Load transforms and compute a merged transform
-  transform = SetAllTransform<ImageType>( list, resample, vectorOfImage[0] );
+  transform = SetAllTransform<ImageType>( list, resample, image );
   if( !transform )
     {
     return EXIT_FAILURE;
     }
-  resample->SetTransform( transform );
-  resample->SetInterpolator( interpol );
-  std::vector<typename ImageType::Pointer> vectorOutputImage;
-  // Resample all the images separately
-  for( ::size_t idx = 0; idx < vectorOfImage.size(); idx++ )
+  typename VectorImageType::Pointer outputImage;
+  if( !list.interpolationType.compare( "nn" ) || !list.interpolationType.compare( "linear" ) )
+    {
+    // Resample all the components at once: the transform and the
+    // interpolation weights are computed once per voxel
+    typename VectorResampleType::Pointer vectorResample = VectorResampleType::New();
+    vectorResample->SetInput( inputImage );
+    vectorResample->SetTransform( transform );
+    vectorResample->SetOutputSpacing( resample->GetOutputSpacing() );
+    vectorResample->SetOutputOrigin( resample->GetOutputOrigin() );
+    vectorResample->SetOutputDirection( resample->GetOutputDirection() );
+    vectorResample->SetSize( resample->GetSize() );
+    vectorResample->SetDefaultPixelValue( list.defaultPixelValue );
+    if( list.numberOfThread )
+      {
+      vectorResample->SetNumberOfThreads( list.numberOfThread );
+      }
+    vectorResample->SetInterpolation( !list.interpolationType.compare( "nn" ) ?
+                                      VectorResampleType::NearestNeighbor : VectorResampleType::Linear );
+    try
+      {
+      vectorResample->Update();
+      }
+    catch( itk::ExceptionObject exception )
+      {
+      std::cerr << exception << std::endl;
+      return EXIT_FAILURE;
+      }
+    outputImage = vectorResample->GetOutput();
+    outputImage->DisconnectPipeline();
+    }
+  else
     {
-    resample->SetInput( vectorOfImage[idx] );
-    resample->Update();
-    vectorOutputImage.push_back( resample->GetOutput() );
-    vectorOutputImage[idx]->DisconnectPipeline();
+    // Windowed sinc and B-spline interpolators work on scalar images:
+    // resample the components one after another so that only one
+    // interpolator (and one image of B-spline coefficients) exists at a time
+    const unsigned int numberOfComponents = vectorOfImage.size();
+    outputImage = VectorImageType::New();
+    outputImage->SetRegions( resample->GetSize() );
+    outputImage->SetOrigin( resample->GetOutputOrigin() );
+    outputImage->SetSpacing( resample->GetOutputSpacing() );
+    outputImage->SetDirection( resample->GetOutputDirection() );
+    outputImage->SetVectorLength( numberOfComponents );
+    outputImage->Allocate();
+    const ::size_t numberOfPixels = outputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+    resample->SetTransform( transform );
+    if( list.numberOfThread )
+      {
+      resample->SetNumberOfThreads( list.numberOfThread );
+      }
+    for( unsigned int idx = 0; idx < numberOfComponents; idx++ )
+      {
+      typename InterpolatorType::Pointer interpol;
+      interpol = SetInterpolator<ImageType>( list );
+      resample->SetInterpolator( interpol );
+      resample->SetInput( vectorOfImage[idx] );
+      try
+        {
+        resample->Update();
+        }
+      catch( itk::ExceptionObject exception )
+        {
+        std::cerr << exception << std::endl;
+        return EXIT_FAILURE;
+        }
+      // Copy the component into the output
+      const PixelType* in = resample->GetOutput()->GetBufferPointer();
+      PixelType*       out = outputImage->GetBufferPointer() + idx;
+      for( ::size_t i = 0; i < numberOfPixels; i++, out += numberOfComponents )
+        {
+        *out = in[i];
+        }
+      // Release the input component, the interpolator is released when the
+      // next one is set
+      vectorOfImage[idx] = NULL;
+      }
     }
-  typename itk::VectorImage<PixelType, 3>::Pointer outputImage;
-  outputImage = itk::VectorImage<PixelType, 3>::New();
-  AddImage<PixelType>( outputImage, vectorOutputImage );
-  vectorOutputImage.clear();
+  vectorOfImage.clear();
   // If necessary, transform gradient vectors with the loaded transformations
   int dwmriProblem = CheckDWMRI( dico, transform );
   if( list.space ) // && list.transformationFile.compare( "" ) )
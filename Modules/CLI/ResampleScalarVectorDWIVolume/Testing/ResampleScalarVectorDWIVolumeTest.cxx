@@ -8,8 +8,10 @@
 #endif
 
 extern "C" MODULE_IMPORT int ModuleEntryPoint(int, char * []);
+int itkMultiComponentResampleImageFilterTest(int, char * []);
 
 void RegisterTests()
 {
   StringToTestFunctionMap["ModuleEntryPoint"] = ModuleEntryPoint;
+  StringToTestFunctionMap["itkMultiComponentResampleImageFilterTest"] = itkMultiComponentResampleImageFilterTest;
 }
@@ -0,0 +1,278 @@
+/*=========================================================================
+
+  Program:   Slicer
+  Language:  C++
+  Module:    $HeadURL$
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+#include "itkMultiComponentResampleImageFilter.h"
+
+#include <itkAffineTransform.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkNearestNeighborInterpolateImageFunction.h>
+#include <itkResampleImageFilter.h>
+#include <itkVectorImage.h>
+#include <itkVectorResampleImageFilter.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+typedef itk::VectorImage<short, 3>                        VectorImageType;
+typedef itk::VectorImage<float, 3>                        OutputVectorImageType;
+typedef itk::Image<short, 3>                              ComponentImageType;
+typedef itk::Image<float, 3>                              OutputComponentImageType;
+typedef itk::Image<itk::Vector<double, 3>, 3>             DeformationImageType;
+typedef itk::AffineTransform<double, 3>                   AffineTransformType;
+
+const unsigned int NumberOfComponents = 7;
+
+// Smooth and different in every component, so that a mix-up of components
+// or of neighbors changes the interpolated values
+double TestValue( const itk::Index<3> & index, unsigned int component )
+{
+  return 1000. * std::sin( 0.3 * index[0] + 0.7 * component )
+         + 50. * index[1] - 30. * index[2] * ( component % 3 ) + 7. * component;
+}
+
+VectorImageType::Pointer CreateVectorImage()
+{
+  VectorImageType::Pointer   image = VectorImageType::New();
+  VectorImageType::SizeType  size = { { 17, 13, 11 } };
+  VectorImageType::IndexType start = { { 3, -2, 5 } };
+  image->SetRegions( VectorImageType::RegionType( start, size ) );
+  image->SetNumberOfComponentsPerPixel( NumberOfComponents );
+  double spacing[3] = { 1.2, 0.9, 2.5 };
+  double origin[3] = { -10.3, 4.1, 7.7 };
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  VectorImageType::DirectionType direction;
+  direction.SetIdentity();
+  direction[0][0] = 0.;
+  direction[0][1] = -1.;
+  direction[1][0] = 1.;
+  direction[1][1] = 0.;
+  image->SetDirection( direction );
+  image->Allocate();
+  itk::VariableLengthVector<short> pixel( NumberOfComponents );
+  itk::ImageRegionIterator<VectorImageType> it( image, image->GetBufferedRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    for( unsigned int k = 0; k < NumberOfComponents; k++ )
+      {
+      pixel[k] = static_cast<short>( TestValue( it.GetIndex(), k ) );
+      }
+    it.Set( pixel );
+    }
+  return image;
+}
+
+ComponentImageType::Pointer ExtractComponent( VectorImageType::Pointer image, unsigned int component )
+{
+  ComponentImageType::Pointer componentImage = ComponentImageType::New();
+  componentImage->CopyInformation( image );
+  componentImage->SetRegions( image->GetBufferedRegion() );
+  componentImage->Allocate();
+  itk::ImageRegionConstIterator<VectorImageType> it( image, image->GetBufferedRegion() );
+  itk::ImageRegionIterator<ComponentImageType>   componentIt( componentImage, image->GetBufferedRegion() );
+  for( it.GoToBegin(), componentIt.GoToBegin(); !it.IsAtEnd(); ++it, ++componentIt )
+    {
+    componentIt.Set( it.Get()[component] );
+    }
+  return componentImage;
+}
+
+// Rotation about a skew axis and a translation that are not aligned with
+// the voxels, so that the linear weights are all non trivial
+AffineTransformType::Pointer CreateTransform()
+{
+  AffineTransformType::Pointer           transform = AffineTransformType::New();
+  AffineTransformType::OutputVectorType axis;
+  axis[0] = 0.3;
+  axis[1] = -0.5;
+  axis[2] = 0.8;
+  transform->Rotate3D( axis, 0.37 );
+  AffineTransformType::OutputVectorType translation;
+  translation[0] = 1.37;
+  translation[1] = -0.62;
+  translation[2] = 2.15;
+  transform->Translate( translation );
+  return transform;
+}
+
+template <class TFilter>
+void SetOutputGeometry( TFilter * filter, VectorImageType::Pointer image )
+{
+  itk::Vector<double, 3> spacing;
+  spacing[0] = 0.83;
+  spacing[1] = 1.1;
+  spacing[2] = 1.7;
+  itk::Point<double, 3> origin = image->GetOrigin();
+  origin[0] += 0.41;
+  origin[1] -= 3.3;
+  origin[2] += 1.9;
+  itk::Size<3> size = { { 23, 14, 15 } };
+  filter->SetOutputSpacing( spacing );
+  filter->SetOutputOrigin( origin );
+  filter->SetOutputDirection( image->GetDirection() );
+  filter->SetSize( size );
+}
+
+bool CompareComponents( OutputVectorImageType::Pointer image, unsigned int component,
+                        OutputComponentImageType::Pointer baseline, const char* interpolation )
+{
+  itk::ImageRegionConstIterator<OutputVectorImageType>    it( image, image->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<OutputComponentImageType> baselineIt( baseline, baseline->GetBufferedRegion() );
+  unsigned int                                            numberOfDefaultVoxels = 0;
+  for( it.GoToBegin(), baselineIt.GoToBegin(); !it.IsAtEnd(); ++it, ++baselineIt )
+    {
+    const float value = it.Get()[component];
+    if( std::fabs( value - baselineIt.Get() ) > 1e-3 * ( 1. + std::fabs( baselineIt.Get() ) ) )
+      {
+      std::cerr << interpolation << " interpolation: component " << component << " of voxel "
+                << it.GetIndex() << " is " << value << " instead of " << baselineIt.Get() << std::endl;
+      return false;
+      }
+    if( value == -1.f )
+      {
+      ++numberOfDefaultVoxels;
+      }
+    }
+  // The transform must map voxels both inside and outside of the input
+  if( numberOfDefaultVoxels == 0 || numberOfDefaultVoxels == image->GetBufferedRegion().GetNumberOfPixels() )
+    {
+    std::cerr << interpolation << " interpolation: " << numberOfDefaultVoxels
+              << " voxels are outside of the input" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+// Every component against a scalar itk::ResampleImageFilter of the component
+int TestVectorImage( bool linear )
+{
+  const char* interpolation = linear ? "Linear" : "NearestNeighbor";
+  VectorImageType::Pointer     image = CreateVectorImage();
+  AffineTransformType::Pointer transform = CreateTransform();
+
+  typedef itk::MultiComponentResampleImageFilter<VectorImageType, OutputVectorImageType> FilterType;
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( image );
+  filter->SetTransform( transform );
+  filter->SetInterpolation( linear ? FilterType::Linear : FilterType::NearestNeighbor );
+  filter->SetDefaultPixelValue( -1. );
+  SetOutputGeometry( filter.GetPointer(), image );
+  filter->Update();
+  OutputVectorImageType::Pointer output = filter->GetOutput();
+  if( output->GetNumberOfComponentsPerPixel() != NumberOfComponents )
+    {
+    std::cerr << interpolation << " interpolation: " << output->GetNumberOfComponentsPerPixel()
+              << " components instead of " << NumberOfComponents << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::ResampleImageFilter<ComponentImageType, OutputComponentImageType> ComponentFilterType;
+  for( unsigned int k = 0; k < NumberOfComponents; k++ )
+    {
+    ComponentFilterType::Pointer componentFilter = ComponentFilterType::New();
+    componentFilter->SetInput( ExtractComponent( image, k ) );
+    componentFilter->SetTransform( transform );
+    if( linear )
+      {
+      componentFilter->SetInterpolator(
+        itk::LinearInterpolateImageFunction<ComponentImageType, double>::New() );
+      }
+    else
+      {
+      componentFilter->SetInterpolator(
+        itk::NearestNeighborInterpolateImageFunction<ComponentImageType, double>::New() );
+      }
+    componentFilter->SetDefaultPixelValue( -1.f );
+    SetOutputGeometry( componentFilter.GetPointer(), image );
+    componentFilter->Update();
+    if( !CompareComponents( output, k, componentFilter->GetOutput(), interpolation ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+// Deformation fields are resampled to the output geometry with the identity
+// transform and linear interpolation, as VectorResampleImageFilter does
+int TestDeformationField()
+{
+  VectorImageType::Pointer       image = CreateVectorImage();
+  DeformationImageType::Pointer field = DeformationImageType::New();
+  field->CopyInformation( image );
+  field->SetRegions( image->GetBufferedRegion() );
+  field->Allocate();
+  itk::ImageRegionIterator<DeformationImageType> it( field, field->GetBufferedRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    DeformationImageType::PixelType displacement;
+    for( unsigned int d = 0; d < 3; d++ )
+      {
+      displacement[d] = 1e-3 * TestValue( it.GetIndex(), d );
+      }
+    it.Set( displacement );
+    }
+
+  typedef itk::MultiComponentResampleImageFilter<DeformationImageType, DeformationImageType> FilterType;
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( field );
+  filter->SetInterpolation( FilterType::Linear );
+  filter->SetDefaultPixelValue( 0. );
+  SetOutputGeometry( filter.GetPointer(), image );
+  filter->Update();
+
+  typedef itk::VectorResampleImageFilter<DeformationImageType, DeformationImageType> BaselineFilterType;
+  BaselineFilterType::Pointer baselineFilter = BaselineFilterType::New();
+  baselineFilter->SetInput( field );
+  DeformationImageType::PixelType zero;
+  zero.Fill( 0. );
+  baselineFilter->SetDefaultPixelValue( zero );
+  SetOutputGeometry( baselineFilter.GetPointer(), image );
+  baselineFilter->Update();
+
+  itk::ImageRegionConstIterator<DeformationImageType> outputIt(
+    filter->GetOutput(), filter->GetOutput()->GetBufferedRegion() );
+  itk::ImageRegionConstIterator<DeformationImageType> baselineIt(
+    baselineFilter->GetOutput(), baselineFilter->GetOutput()->GetBufferedRegion() );
+  for( outputIt.GoToBegin(), baselineIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt, ++baselineIt )
+    {
+    for( unsigned int d = 0; d < 3; d++ )
+      {
+      if( std::fabs( outputIt.Get()[d] - baselineIt.Get()[d] ) > 1e-9 )
+        {
+        std::cerr << "Deformation field: component " << d << " of voxel " << outputIt.GetIndex()
+                  << " is " << outputIt.Get()[d] << " instead of " << baselineIt.Get()[d] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+int itkMultiComponentResampleImageFilterTest( int, char * [] )
+{
+  if( TestVectorImage( false ) != EXIT_SUCCESS
+      || TestVectorImage( true ) != EXIT_SUCCESS
+      || TestDeformationField() != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
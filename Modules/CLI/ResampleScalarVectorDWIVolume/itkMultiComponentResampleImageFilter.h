@@ -0,0 +1,128 @@
+/*=========================================================================
+
+  Program:   Slicer
+  Language:  C++
+  Module:    $HeadURL$
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+#ifndef itkMultiComponentResampleImageFilter_h
+#define itkMultiComponentResampleImageFilter_h
+
+#include <itkImageToImageFilter.h>
+#include <itkIdentityTransform.h>
+#include <itkNumericTraits.h>
+#include <itkTransform.h>
+
+namespace itk
+{
+/** \class MultiComponentResampleImageFilter
+ *
+ * Resample images with several components per voxel (itk::VectorImage or
+ * itk::Image of itk::Vector) in a single pass: the transform and the
+ * interpolation weights are computed once per output voxel and applied to
+ * all the components, instead of once per component when each component
+ * is resampled as a separate scalar image.
+ *
+ * Nearest neighbor and linear interpolations are supported and give the
+ * same values as itk::NearestNeighborInterpolateImageFunction and
+ * itk::LinearInterpolateImageFunction. Interpolations that need per
+ * component data (e.g. B-spline coefficients) are better done one component
+ * at a time with itk::ResampleImageFilter, to limit the memory used.
+ *
+ * Output components are clamped to the range of the output component type,
+ * voxels mapped outside of the input are set to DefaultPixelValue.
+ */
+template <class TInputImage, class TOutputImage>
+class MultiComponentResampleImageFilter
+  : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  typedef MultiComponentResampleImageFilter             Self;
+  typedef ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef SmartPointer<Self>                            Pointer;
+  typedef SmartPointer<const Self>                      ConstPointer;
+
+  typedef TInputImage                                                            InputImageType;
+  typedef TOutputImage                                                           OutputImageType;
+  typedef typename NumericTraits<typename InputImageType::PixelType>::ValueType  InputComponentType;
+  typedef typename NumericTraits<typename OutputImageType::PixelType>::ValueType OutputComponentType;
+  typedef typename OutputImageType::RegionType                                   OutputImageRegionType;
+  typedef typename OutputImageType::SpacingType                                  SpacingType;
+  typedef typename OutputImageType::PointType                                    PointType;
+  typedef typename OutputImageType::DirectionType                                DirectionType;
+  typedef typename OutputImageType::SizeType                                     SizeType;
+  typedef Transform<double, 3, 3>                                                TransformType;
+
+  typedef enum { NearestNeighbor, Linear } InterpolationType;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(MultiComponentResampleImageFilter, ImageToImageFilter);
+
+  itkNewMacro( Self );
+
+// /Set the transform, mapping output points to input points (identity by default)
+  itkSetObjectMacro( Transform, TransformType );
+  itkGetConstObjectMacro( Transform, TransformType );
+
+// /Set the native interpolation (linear by default)
+  itkSetMacro( Interpolation, InterpolationType );
+  itkGetConstMacro( Interpolation, InterpolationType );
+
+// /Value of the components of the voxels mapped outside of the input
+  itkSetMacro( DefaultPixelValue, double );
+  itkGetConstMacro( DefaultPixelValue, double );
+
+// /Output image geometry
+  itkSetMacro( OutputSpacing, SpacingType );
+  itkGetConstReferenceMacro( OutputSpacing, SpacingType );
+  itkSetMacro( OutputOrigin, PointType );
+  itkGetConstReferenceMacro( OutputOrigin, PointType );
+  itkSetMacro( OutputDirection, DirectionType );
+  itkGetConstReferenceMacro( OutputDirection, DirectionType );
+  itkSetMacro( Size, SizeType );
+  itkGetConstReferenceMacro( Size, SizeType );
+
+// /Get the time of the last modification of the object
+  unsigned long GetMTime() const ITK_OVERRIDE;
+
+protected:
+  MultiComponentResampleImageFilter();
+
+  void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  void ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId ) ITK_OVERRIDE;
+
+  void GenerateOutputInformation() ITK_OVERRIDE;
+
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  void PrintSelf( std::ostream & os, Indent indent ) const ITK_OVERRIDE;
+
+private:
+  MultiComponentResampleImageFilter(const Self &); // purposely not implemented
+  void operator=(const Self &);                   // purposely not implemented
+
+  OutputComponentType ClampComponent( double value ) const;
+
+  typename TransformType::Pointer m_Transform;
+  InterpolationType               m_Interpolation;
+  double                          m_DefaultPixelValue;
+  SpacingType                     m_OutputSpacing;
+  PointType                       m_OutputOrigin;
+  DirectionType                   m_OutputDirection;
+  SizeType                        m_Size;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkMultiComponentResampleImageFilter.txx"
+#endif
+
+#endif
@@ -0,0 +1,264 @@
+/*=========================================================================
+
+  Program:   Slicer
+  Language:  C++
+  Module:    $HeadURL$
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See License.txt or http://www.slicer.org/copyright/copyright.txt for details.
+
+==========================================================================*/
+#ifndef itkMultiComponentResampleImageFilter_txx
+#define itkMultiComponentResampleImageFilter_txx
+
+#include "itkMultiComponentResampleImageFilter.h"
+
+#include <itkContinuousIndex.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkMath.h>
+
+namespace itk
+{
+
+template <class TInputImage, class TOutputImage>
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::MultiComponentResampleImageFilter()
+{
+  this->SetNumberOfRequiredInputs( 1 );
+  m_Transform = IdentityTransform<double, 3>::New();
+  m_Interpolation = Linear;
+  m_DefaultPixelValue = 0.0;
+  m_OutputSpacing.Fill( 1.0 );
+  m_OutputOrigin.Fill( 0.0 );
+  m_OutputDirection.SetIdentity();
+  m_Size.Fill( 0 );
+}
+
+template <class TInputImage, class TOutputImage>
+unsigned long
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::GetMTime() const
+{
+  unsigned long latestTime = Superclass::GetMTime();
+
+  if( m_Transform.IsNotNull() && latestTime < m_Transform->GetMTime() )
+    {
+    latestTime = m_Transform->GetMTime();
+    }
+  return latestTime;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  if( m_Transform.IsNull() )
+    {
+    itkExceptionMacro( << "Transform not set" );
+    }
+  if( !this->GetInput( 0 ) )
+    {
+    itkExceptionMacro( << "Input image not set" );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+typename MultiComponentResampleImageFilter<TInputImage, TOutputImage>::OutputComponentType
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::ClampComponent( double value ) const
+{
+  // Same bounds checking as itk::ResampleImageFilter
+  const OutputComponentType minComponent = NumericTraits<OutputComponentType>::NonpositiveMin();
+  const OutputComponentType maxComponent = NumericTraits<OutputComponentType>::max();
+  if( value < static_cast<double>( minComponent ) )
+    {
+    return minComponent;
+    }
+  if( value > static_cast<double>( maxComponent ) )
+    {
+    return maxComponent;
+    }
+  return static_cast<OutputComponentType>( value );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData( const OutputImageRegionType &outputRegionForThread,
+                        ThreadIdType itkNotUsed(threadId) )
+{
+  const InputImageType * inputPtr = this->GetInput( 0 );
+  OutputImageType *      outputPtr = this->GetOutput( 0 );
+  const unsigned int     components = inputPtr->GetNumberOfComponentsPerPixel();
+  // Both images store the components of a voxel contiguously
+  const InputComponentType * inputBuffer =
+    reinterpret_cast<const InputComponentType *>( inputPtr->GetBufferPointer() );
+  OutputComponentType * outputBuffer =
+    reinterpret_cast<OutputComponentType *>( outputPtr->GetBufferPointer() );
+
+  const typename InputImageType::RegionType inputRegion = inputPtr->GetBufferedRegion();
+  const OffsetValueType *                   offsetTable = inputPtr->GetOffsetTable();
+  IndexValueType                            startIndex[3];
+  IndexValueType                            endIndex[3];
+  for( int d = 0; d < 3; d++ )
+    {
+    startIndex[d] = inputRegion.GetIndex()[d];
+    endIndex[d] = startIndex[d] + static_cast<IndexValueType>( inputRegion.GetSize()[d] ) - 1;
+    }
+  const OutputComponentType defaultValue = this->ClampComponent( m_DefaultPixelValue );
+
+  ImageRegionConstIteratorWithIndex<OutputImageType> it( outputPtr, outputRegionForThread );
+  Point<double, 3>                                   outputPoint;
+  Point<double, 3>                                   inputPoint;
+  ContinuousIndex<double, 3>                         inputIndex;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    const typename OutputImageType::IndexType index = it.GetIndex();
+    OutputComponentType * out = outputBuffer + outputPtr->ComputeOffset( index ) * components;
+    // The geometry is computed once for all the components
+    outputPtr->TransformIndexToPhysicalPoint( index, outputPoint );
+    inputPoint = m_Transform->TransformPoint( outputPoint );
+    inputPtr->TransformPhysicalPointToContinuousIndex( inputPoint, inputIndex );
+    // Same test as itk::ImageFunction::IsInsideBuffer
+    bool inside = true;
+    for( int d = 0; d < 3; d++ )
+      {
+      if( !( inputIndex[d] >= startIndex[d] - 0.5 && inputIndex[d] < endIndex[d] + 0.5 ) )
+        {
+        inside = false;
+        }
+      }
+    if( !inside )
+      {
+      for( unsigned int k = 0; k < components; k++ )
+        {
+        out[k] = defaultValue;
+        }
+      continue;
+      }
+    if( m_Interpolation == NearestNeighbor )
+      {
+      OffsetValueType offset = 0;
+      for( int d = 0; d < 3; d++ )
+        {
+        offset += ( Math::RoundHalfIntegerUp<IndexValueType>( inputIndex[d] ) - startIndex[d] ) * offsetTable[d];
+        }
+      const InputComponentType * in = inputBuffer + offset * components;
+      for( unsigned int k = 0; k < components; k++ )
+        {
+        out[k] = this->ClampComponent( static_cast<double>( in[k] ) );
+        }
+      continue;
+      }
+    // Linear interpolation: neighbors and weights as in
+    // itk::LinearInterpolateImageFunction, the neighbors past the end of
+    // the image are replaced by the last voxel
+    OffsetValueType offset0[3];
+    OffsetValueType offset1[3];
+    double          distance[3];
+    for( int d = 0; d < 3; d++ )
+      {
+      IndexValueType base = Math::Floor<IndexValueType>( inputIndex[d] );
+      if( base < startIndex[d] )
+        {
+        base = startIndex[d];
+        }
+      distance[d] = inputIndex[d] - static_cast<double>( base );
+      IndexValueType next = base + 1;
+      if( distance[d] <= 0. || next > endIndex[d] )
+        {
+        distance[d] = 0.;
+        next = base;
+        }
+      offset0[d] = ( base - startIndex[d] ) * offsetTable[d];
+      offset1[d] = ( next - startIndex[d] ) * offsetTable[d];
+      }
+    const InputComponentType * in000 = inputBuffer + ( offset0[0] + offset0[1] + offset0[2] ) * components;
+    const InputComponentType * in100 = inputBuffer + ( offset1[0] + offset0[1] + offset0[2] ) * components;
+    const InputComponentType * in010 = inputBuffer + ( offset0[0] + offset1[1] + offset0[2] ) * components;
+    const InputComponentType * in110 = inputBuffer + ( offset1[0] + offset1[1] + offset0[2] ) * components;
+    const InputComponentType * in001 = inputBuffer + ( offset0[0] + offset0[1] + offset1[2] ) * components;
+    const InputComponentType * in101 = inputBuffer + ( offset1[0] + offset0[1] + offset1[2] ) * components;
+    const InputComponentType * in011 = inputBuffer + ( offset0[0] + offset1[1] + offset1[2] ) * components;
+    const InputComponentType * in111 = inputBuffer + ( offset1[0] + offset1[1] + offset1[2] ) * components;
+    for( unsigned int k = 0; k < components; k++ )
+      {
+      const double valx00 = in000[k] + ( static_cast<double>( in100[k] ) - in000[k] ) * distance[0];
+      const double valx10 = in010[k] + ( static_cast<double>( in110[k] ) - in010[k] ) * distance[0];
+      const double valxx0 = valx00 + ( valx10 - valx00 ) * distance[1];
+      const double valx01 = in001[k] + ( static_cast<double>( in101[k] ) - in001[k] ) * distance[0];
+      const double valx11 = in011[k] + ( static_cast<double>( in111[k] ) - in011[k] ) * distance[0];
+      const double valxx1 = valx01 + ( valx11 - valx01 ) * distance[1];
+      out[k] = this->ClampComponent( valxx0 + ( valxx1 - valxx0 ) * distance[2] );
+      }
+    }
+}
+
+/**
+ * Inform pipeline of required output region
+ */
+template <class TInputImage, class TOutputImage>
+void
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+  // get pointers to the input and output
+  OutputImageType * outputPtr = this->GetOutput( 0 );
+  if( !outputPtr || !this->GetInput( 0 ) )
+    {
+    return;
+    }
+  outputPtr->SetSpacing( m_OutputSpacing );
+  outputPtr->SetOrigin( m_OutputOrigin );
+  outputPtr->SetDirection( m_OutputDirection );
+  outputPtr->SetRegions( m_Size );
+  outputPtr->SetNumberOfComponentsPerPixel( this->GetInput( 0 )->GetNumberOfComponentsPerPixel() );
+}
+
+/**
+ * Inform pipeline of necessary input image region
+ *
+ * Determining the actual input region is non-trivial, especially
+ * when we cannot assume anything about the transform being used.
+ * So we do the easy thing and request the entire input image.
+ */
+template <class TInputImage, class TOutputImage>
+void
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  // call the superclass's implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  if( !this->GetInput() )
+    {
+    return;
+    }
+  InputImageType * inputPtr = const_cast<InputImageType *>( this->GetInput() );
+  inputPtr->SetRequestedRegion( inputPtr->GetLargestPossibleRegion() );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+MultiComponentResampleImageFilter<TInputImage, TOutputImage>
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
+  os << indent << "Interpolation: " << ( m_Interpolation == NearestNeighbor ? "NearestNeighbor" : "Linear" )
+     << std::endl;
+  os << indent << "DefaultPixelValue: " << m_DefaultPixelValue << std::endl;
+  os << indent << "OutputSpacing: " << m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << m_OutputDirection << std::endl;
+  os << indent << "Size: " << m_Size << std::endl;
+}
+
+} // end namespace itk
+#endif
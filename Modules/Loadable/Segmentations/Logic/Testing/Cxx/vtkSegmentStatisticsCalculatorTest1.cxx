@@ -0,0 +1,217 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Segmentations includes
+#include "vtkSegmentStatisticsCalculator.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkThinPlateSplineTransform.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Labelmap of 10x10x10 voxels with ones in the box
+vtkSmartPointer<vtkOrientedImageData> CreateBoxLabelmap(
+  int i0, int i1, int j0, int j1, int k0, int k1, double spacing = 1.0, double origin = 0.0)
+{
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetExtent(0, 9, 0, 9, 0, 9);
+  labelmap->SetSpacing(spacing, spacing, spacing);
+  labelmap->SetOrigin(origin, origin, origin);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  for (int k = 0; k <= 9; k++)
+    {
+    for (int j = 0; j <= 9; j++)
+      {
+      for (int i = 0; i <= 9; i++)
+        {
+        *static_cast<unsigned char*>(labelmap->GetScalarPointer(i, j, k)) =
+          (i >= i0 && i <= i1 && j >= j0 && j <= j1 && k >= k0 && k <= k1) ? 1 : 0;
+        }
+      }
+    }
+  return labelmap;
+}
+
+//----------------------------------------------------------------------------
+void AddSegment(vtkMRMLSegmentationNode* segmentationNode, const char* segmentID,
+                vtkOrientedImageData* labelmap)
+{
+  vtkNew<vtkSegment> segment;
+  segment->SetName(segmentID);
+  segment->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentationNode->GetSegmentation()->AddSegment(segment.GetPointer(), segmentID);
+}
+
+//----------------------------------------------------------------------------
+int CheckStatistics(vtkSegmentStatisticsCalculator* calculator, const char* segmentID,
+                    vtkIdType voxelCount, double minimum, double maximum, double mean,
+                    double median, double percentile25, double percentile90)
+{
+  CHECK_BOOL(calculator->HasSegment(segmentID), true);
+  CHECK_INT(calculator->GetVoxelCount(segmentID), voxelCount);
+  CHECK_DOUBLE_TOLERANCE(calculator->GetVolumeMm3(segmentID), voxelCount, 1e-9);
+  CHECK_DOUBLE(calculator->GetMinimum(segmentID), minimum);
+  CHECK_DOUBLE(calculator->GetMaximum(segmentID), maximum);
+  CHECK_DOUBLE_TOLERANCE(calculator->GetMean(segmentID), mean, 1e-9);
+  CHECK_DOUBLE(calculator->GetMedian(segmentID), median);
+  CHECK_DOUBLE(calculator->GetPercentile(segmentID, 0), percentile25);
+  CHECK_DOUBLE(calculator->GetPercentile(segmentID, 1), percentile90);
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkSegmentStatisticsCalculatorTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  // Scalar volume of 10x10x10 voxels, value of voxel (i,j,k) is i+10*j+100*k
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(10, 10, 10);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k <= 9; k++)
+    {
+    for (int j = 0; j <= 9; j++)
+      {
+      for (int i = 0; i <= 9; i++)
+        {
+        *static_cast<short*>(imageData->GetScalarPointer(i, j, k)) = static_cast<short>(i + 10 * j + 100 * k);
+        }
+      }
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(volumeNode.GetPointer());
+
+  // Segmentation in the geometry of the volume
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  // Values 2,3,4,5,12,13,14,15
+  AddSegment(segmentationNode.GetPointer(), "Box", CreateBoxLabelmap(2, 5, 0, 1, 0, 0));
+  // Labelmap voxel (1,1,1) of spacing 2 covers the volume voxels (2..3,2..3,2..3):
+  // values 222,223,232,233,322,323,332,333
+  AddSegment(segmentationNode.GetPointer(), "Coarse", CreateBoxLabelmap(1, 1, 1, 1, 1, 1, 2.0, 0.5));
+  AddSegment(segmentationNode.GetPointer(), "Empty", CreateBoxLabelmap(1, 0, 1, 0, 1, 0));
+
+  // Segmentation translated by 3mm along R: values 123,124
+  vtkNew<vtkMRMLSegmentationNode> translatedSegmentationNode;
+  scene->AddNode(translatedSegmentationNode.GetPointer());
+  AddSegment(translatedSegmentationNode.GetPointer(), "Translated", CreateBoxLabelmap(0, 1, 2, 2, 1, 1));
+  vtkNew<vtkMRMLLinearTransformNode> translationNode;
+  scene->AddNode(translationNode.GetPointer());
+  vtkNew<vtkMatrix4x4> translation;
+  translation->SetElement(0, 3, 3.0);
+  translationNode->SetMatrixTransformToParent(translation.GetPointer());
+  translatedSegmentationNode->SetAndObserveTransformNodeID(translationNode->GetID());
+
+  // Same translation, as a non-linear transform
+  vtkNew<vtkMRMLSegmentationNode> warpedSegmentationNode;
+  scene->AddNode(warpedSegmentationNode.GetPointer());
+  AddSegment(warpedSegmentationNode.GetPointer(), "Warped", CreateBoxLabelmap(0, 1, 2, 2, 1, 1));
+  vtkNew<vtkPoints> sourceLandmarks;
+  vtkNew<vtkPoints> targetLandmarks;
+  for (int corner = 0; corner < 8; corner++)
+    {
+    const double x = (corner & 1) ? 20.0 : -10.0;
+    const double y = (corner & 2) ? 20.0 : -10.0;
+    const double z = (corner & 4) ? 20.0 : -10.0;
+    sourceLandmarks->InsertNextPoint(x, y, z);
+    targetLandmarks->InsertNextPoint(x + 3.0, y, z);
+    }
+  vtkNew<vtkThinPlateSplineTransform> warp;
+  warp->SetBasisToR();
+  warp->SetSourceLandmarks(sourceLandmarks.GetPointer());
+  warp->SetTargetLandmarks(targetLandmarks.GetPointer());
+  vtkNew<vtkMRMLTransformNode> warpNode;
+  scene->AddNode(warpNode.GetPointer());
+  warpNode->SetAndObserveTransformToParent(warp.GetPointer());
+  warpedSegmentationNode->SetAndObserveTransformNodeID(warpNode->GetID());
+
+  vtkNew<vtkSegmentStatisticsCalculator> calculator;
+  calculator->AddPercentile(25.0);
+  calculator->AddPercentile(90.0);
+  CHECK_INT(calculator->GetNumberOfPercentiles(), 2);
+
+  // Invalid inputs
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_BOOL(calculator->Compute(), false);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+  // Voxel counts in the labelmap geometry
+  calculator->SetSegmentationNode(segmentationNode.GetPointer());
+  CHECK_BOOL(calculator->Compute(), true);
+  CHECK_INT(calculator->GetVoxelCount("Box"), 8);
+  CHECK_DOUBLE(calculator->GetVolumeMm3("Box"), 8.0);
+  CHECK_INT(calculator->GetVoxelCount("Coarse"), 1);
+  CHECK_DOUBLE(calculator->GetVolumeMm3("Coarse"), 8.0);
+  CHECK_INT(calculator->GetVoxelCount("Empty"), 0);
+  CHECK_DOUBLE(calculator->GetMean("Box"), 0.0);
+
+  // Scalar statistics
+  calculator->SetScalarVolumeNode(volumeNode.GetPointer());
+  CHECK_BOOL(calculator->Compute(), true);
+  CHECK_EXIT_SUCCESS(CheckStatistics(calculator.GetPointer(), "Box", 8, 2., 15., 8.5, 5., 3., 15.));
+  // Sample standard deviation: sum of squared deviations is 210
+  CHECK_DOUBLE_TOLERANCE(calculator->GetStandardDeviation("Box"), sqrt(210.0 / 7.0), 1e-9);
+  CHECK_EXIT_SUCCESS(CheckStatistics(calculator.GetPointer(), "Coarse", 8, 222., 333., 277.5, 233., 223., 333.));
+  CHECK_INT(calculator->GetVoxelCount("Empty"), 0);
+  CHECK_DOUBLE(calculator->GetMedian("Empty"), 0.0);
+
+  // Subset of the segments
+  vtkNew<vtkStringArray> segmentIDs;
+  segmentIDs->InsertNextValue("Coarse");
+  CHECK_BOOL(calculator->Compute(segmentIDs.GetPointer()), true);
+  CHECK_BOOL(calculator->HasSegment("Coarse"), true);
+  CHECK_BOOL(calculator->HasSegment("Box"), false);
+
+  // Linearly transformed segmentation
+  calculator->SetSegmentationNode(translatedSegmentationNode.GetPointer());
+  CHECK_BOOL(calculator->Compute(), true);
+  CHECK_EXIT_SUCCESS(CheckStatistics(calculator.GetPointer(), "Translated", 2, 123., 124., 123.5, 123., 123., 124.));
+
+  // Non-linearly transformed segmentation
+  calculator->SetSegmentationNode(warpedSegmentationNode.GetPointer());
+  CHECK_BOOL(calculator->Compute(), true);
+  CHECK_EXIT_SUCCESS(CheckStatistics(calculator.GetPointer(), "Warped", 2, 123., 124., 123.5, 123., 123., 124.));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,900 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "vtkSegmentStatisticsCalculator.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkOrientedImageDataResample.h>
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLTransformNode.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkGeneralTransform.h>
+#include <vtkImageThreshold.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSimpleCriticalSection.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkSegmentStatisticsCalculator);
+vtkCxxSetObjectMacro(vtkSegmentStatisticsCalculator, SegmentationNode, vtkMRMLSegmentationNode);
+vtkCxxSetObjectMacro(vtkSegmentStatisticsCalculator, ScalarVolumeNode, vtkMRMLScalarVolumeNode);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct SegmentStatistics
+{
+  SegmentStatistics()
+    : VoxelCount(0)
+    , VolumeMm3(0.0)
+    , Minimum(0.0)
+    , Maximum(0.0)
+    , Mean(0.0)
+    , StandardDeviation(0.0)
+    , Median(0.0)
+  {
+  }
+  vtkIdType VoxelCount;
+  double VolumeMm3;
+  double Minimum;
+  double Maximum;
+  double Mean;
+  double StandardDeviation;
+  double Median;
+  std::vector<double> Percentiles;
+};
+
+//----------------------------------------------------------------------------
+// Sums of the voxel values of a segment. Work items of the segment are
+// merged into it.
+struct SegmentAccumulator
+{
+  SegmentAccumulator()
+    : AllocatedMaskSize(0)
+    , VoxelVolume(0.0)
+    , VoxelCount(0)
+    , Sum(0.0)
+    , SumOfSquares(0.0)
+    , Minimum(VTK_DOUBLE_MAX)
+    , Maximum(VTK_DOUBLE_MIN)
+    , NumberOfRemainingItems(0)
+  {
+    this->Extent[0] = this->Extent[2] = this->Extent[4] = 0;
+    this->Extent[1] = this->Extent[3] = this->Extent[5] = -1;
+  }
+  std::string SegmentID;
+  // Binary mask in the geometry of the scalar volume, or of the segment
+  // labelmap when there is no scalar volume. Nonzero voxels are inside.
+  vtkSmartPointer<vtkImageData> Mask;
+  // Region of the mask to process
+  int Extent[6];
+  // Number of voxels allocated for the mask, 0 if the labelmap is used
+  // directly
+  vtkIdType AllocatedMaskSize;
+  double VoxelVolume;
+
+  vtkIdType VoxelCount;
+  double Sum;
+  double SumOfSquares;
+  double Minimum;
+  double Maximum;
+  std::vector<vtkIdType> Histogram;
+  int NumberOfRemainingItems;
+};
+
+//----------------------------------------------------------------------------
+// Slab of a segment processed by one thread
+struct WorkItem
+{
+  int SegmentIndex;
+  int FirstSlice;
+  int LastSlice;
+};
+
+//----------------------------------------------------------------------------
+vtkIdType GetNumberOfVoxels(const int extent[6])
+{
+  if (extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5])
+    {
+    return 0;
+    }
+  return static_cast<vtkIdType>(extent[1] - extent[0] + 1)
+    * (extent[3] - extent[2] + 1) * (extent[5] - extent[4] + 1);
+}
+
+//----------------------------------------------------------------------------
+bool CompareSegmentSize(const SegmentAccumulator* segment1, const SegmentAccumulator* segment2)
+{
+  return GetNumberOfVoxels(segment1->Extent) > GetNumberOfVoxels(segment2->Extent);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+class vtkSegmentStatisticsCalculator::vtkInternal
+{
+public:
+  vtkInternal(vtkSegmentStatisticsCalculator* external);
+
+  /// Create the mask of the segment in the reference geometry and set the
+  /// region to process. Return false if the segment has no labelmap.
+  bool InitializeSegment(SegmentAccumulator* segment, vtkOrientedImageData* labelmap);
+  void InitializeHistogram();
+  /// Accumulate the voxels of the initialized segments in multiple threads
+  /// and finalize them, which releases their masks.
+  void ProcessSegments();
+  void FinalizeSegment(SegmentAccumulator* segment);
+  double GetHistogramPercentile(const SegmentAccumulator* segment, double percent);
+  /// Return the statistics of the segment, NULL if not found
+  SegmentStatistics* GetStatistics(const char* segmentID);
+
+  vtkSegmentStatisticsCalculator* External;
+  std::vector<double> Percentiles;
+  std::map<std::string, SegmentStatistics> Statistics;
+
+  // Inputs of the computation
+  vtkImageData* ScalarImage;
+  vtkSmartPointer<vtkOrientedImageData> ReferenceGeometry;
+  vtkSmartPointer<vtkGeneralTransform> SegmentationToReferenceTransform;
+  bool LinearSegmentationToReferenceTransform;
+  bool IdentitySegmentationToReferenceTransform;
+  double HistogramOrigin;
+  double HistogramSpacing;
+  int NumberOfBins;
+
+  // State of the computation
+  std::vector<SegmentAccumulator*> Segments;
+  std::vector<WorkItem> WorkItems;
+  size_t NextWorkItem;
+  vtkSimpleCriticalSection Lock;
+};
+
+//----------------------------------------------------------------------------
+vtkSegmentStatisticsCalculator::vtkInternal::vtkInternal(vtkSegmentStatisticsCalculator* external)
+  : External(external)
+  , ScalarImage(NULL)
+  , LinearSegmentationToReferenceTransform(true)
+  , IdentitySegmentationToReferenceTransform(true)
+  , HistogramOrigin(0.0)
+  , HistogramSpacing(1.0)
+  , NumberOfBins(0)
+  , NextWorkItem(0)
+{
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentStatisticsCalculator::vtkInternal::InitializeSegment(
+  SegmentAccumulator* segment, vtkOrientedImageData* labelmap)
+{
+  if (!labelmap || labelmap->IsEmpty())
+    {
+    return false;
+    }
+  vtkSmartPointer<vtkImageData> mask;
+  if (!this->ScalarImage)
+    {
+    // Count the voxels in the labelmap geometry
+    mask = labelmap;
+    labelmap->GetExtent(segment->Extent);
+    double* spacing = labelmap->GetSpacing();
+    segment->VoxelVolume = spacing[0] * spacing[1] * spacing[2];
+    }
+  else if (this->IdentitySegmentationToReferenceTransform
+    && vtkOrientedImageDataResample::DoGeometriesMatch(labelmap, this->ReferenceGeometry))
+    {
+    // The labelmap voxels are the scalar volume voxels
+    mask = labelmap;
+    int* labelmapExtent = labelmap->GetExtent();
+    int* referenceExtent = this->ReferenceGeometry->GetExtent();
+    for (int i = 0; i < 3; i++)
+      {
+      segment->Extent[2 * i] = std::max(labelmapExtent[2 * i], referenceExtent[2 * i]);
+      segment->Extent[2 * i + 1] = std::min(labelmapExtent[2 * i + 1], referenceExtent[2 * i + 1]);
+      }
+    }
+  else
+    {
+    // Only resample the region of the scalar volume covered by the segment
+    int effectiveExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    if (!vtkOrientedImageDataResample::CalculateEffectiveExtent(labelmap, effectiveExtent))
+      {
+      return false;
+      }
+    int* referenceExtent = this->ReferenceGeometry->GetExtent();
+    int regionExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    std::copy(referenceExtent, referenceExtent + 6, regionExtent);
+    if (this->LinearSegmentationToReferenceTransform)
+      {
+      // Only the corners of the extent are transformed, which bounds the
+      // region for linear transforms only. A non-linear transform may map
+      // the inside of the segment outside of these corners, in which case
+      // the entire scalar volume is resampled.
+      vtkNew<vtkGeneralTransform> labelmapToReferenceIJKTransform;
+      labelmapToReferenceIJKTransform->PostMultiply();
+      vtkNew<vtkMatrix4x4> labelmapToWorldMatrix;
+      labelmap->GetImageToWorldMatrix(labelmapToWorldMatrix.GetPointer());
+      labelmapToReferenceIJKTransform->Concatenate(labelmapToWorldMatrix.GetPointer());
+      labelmapToReferenceIJKTransform->Concatenate(this->SegmentationToReferenceTransform);
+      vtkNew<vtkMatrix4x4> worldToReferenceMatrix;
+      this->ReferenceGeometry->GetWorldToImageMatrix(worldToReferenceMatrix.GetPointer());
+      labelmapToReferenceIJKTransform->Concatenate(worldToReferenceMatrix.GetPointer());
+      vtkOrientedImageDataResample::TransformExtent(effectiveExtent,
+        labelmapToReferenceIJKTransform.GetPointer(), regionExtent);
+      for (int i = 0; i < 3; i++)
+        {
+        regionExtent[2 * i] = std::max(regionExtent[2 * i] - 1, referenceExtent[2 * i]);
+        regionExtent[2 * i + 1] = std::min(regionExtent[2 * i + 1] + 1, referenceExtent[2 * i + 1]);
+        }
+      }
+    if (GetNumberOfVoxels(regionExtent) == 0)
+      {
+      return true;
+      }
+
+    vtkNew<vtkOrientedImageData> regionGeometry;
+    regionGeometry->SetExtent(regionExtent);
+    vtkNew<vtkMatrix4x4> referenceToWorldMatrix;
+    this->ReferenceGeometry->GetImageToWorldMatrix(referenceToWorldMatrix.GetPointer());
+    regionGeometry->SetGeometryFromImageToWorldMatrix(referenceToWorldMatrix.GetPointer());
+
+    vtkSmartPointer<vtkOrientedImageData> resampledLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    if (!vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
+      labelmap, regionGeometry.GetPointer(), resampledLabelmap,
+      false, // nearest neighbor interpolation
+      false, // no padding
+      this->SegmentationToReferenceTransform))
+      {
+      return true;
+      }
+    mask = resampledLabelmap;
+    resampledLabelmap->GetExtent(segment->Extent);
+    }
+
+  if (mask->GetScalarType() != VTK_UNSIGNED_CHAR)
+    {
+    // Positive voxels are inside the segment
+    vtkNew<vtkImageThreshold> threshold;
+    threshold->SetInputData(mask);
+    threshold->ThresholdByLower(0);
+    threshold->SetInValue(0);
+    threshold->SetOutValue(1);
+    threshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
+    threshold->Update();
+    mask = threshold->GetOutput();
+    }
+  segment->Mask = mask;
+  if (mask.GetPointer() != labelmap)
+    {
+    segment->AllocatedMaskSize = GetNumberOfVoxels(mask->GetExtent());
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::vtkInternal::InitializeHistogram()
+{
+  double range[2] = { 0.0, 0.0 };
+  this->ScalarImage->GetPointData()->GetScalars()->GetRange(range, 0);
+  const int scalarType = this->ScalarImage->GetScalarType();
+  const int maximumNumberOfBins = this->External->MaximumNumberOfBins;
+  this->HistogramOrigin = range[0];
+  if (range[1] <= range[0])
+    {
+    this->HistogramSpacing = 1.0;
+    this->NumberOfBins = 1;
+    }
+  else if (scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE
+    && range[1] - range[0] < maximumNumberOfBins)
+    {
+    // One bin per value
+    this->HistogramSpacing = 1.0;
+    this->NumberOfBins = static_cast<int>(range[1] - range[0]) + 1;
+    }
+  else
+    {
+    this->HistogramSpacing = (range[1] - range[0]) / (maximumNumberOfBins - 1);
+    this->NumberOfBins = maximumNumberOfBins;
+    }
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::vtkInternal::GetHistogramPercentile(
+  const SegmentAccumulator* segment, double percent)
+{
+  // Nearest rank
+  vtkIdType rank = static_cast<vtkIdType>(ceil(percent / 100.0 * segment->VoxelCount));
+  rank = std::min(std::max(rank, static_cast<vtkIdType>(1)), segment->VoxelCount);
+  vtkIdType cumulativeCount = 0;
+  for (int bin = 0; bin < this->NumberOfBins; bin++)
+    {
+    cumulativeCount += segment->Histogram[bin];
+    if (cumulativeCount >= rank)
+      {
+      const double value = this->HistogramOrigin + bin * this->HistogramSpacing;
+      return std::min(std::max(value, segment->Minimum), segment->Maximum);
+      }
+    }
+  return segment->Maximum;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::vtkInternal::FinalizeSegment(SegmentAccumulator* segment)
+{
+  SegmentStatistics& statistics = this->Statistics[segment->SegmentID];
+  statistics.VoxelCount = segment->VoxelCount;
+  statistics.VolumeMm3 = segment->VoxelCount * segment->VoxelVolume;
+  statistics.Percentiles.resize(this->Percentiles.size(), 0.0);
+  if (this->ScalarImage && segment->VoxelCount > 0)
+    {
+    const double count = static_cast<double>(segment->VoxelCount);
+    statistics.Minimum = segment->Minimum;
+    statistics.Maximum = segment->Maximum;
+    statistics.Mean = segment->Sum / count;
+    if (segment->VoxelCount > 1)
+      {
+      // Sample standard deviation, as vtkImageAccumulate
+      const double variance = (segment->SumOfSquares - segment->Sum * statistics.Mean) / (count - 1.0);
+      statistics.StandardDeviation = sqrt(std::max(variance, 0.0));
+      }
+    statistics.Median = this->GetHistogramPercentile(segment, 50.0);
+    for (size_t i = 0; i < this->Percentiles.size(); i++)
+      {
+      statistics.Percentiles[i] = this->GetHistogramPercentile(segment, this->Percentiles[i]);
+      }
+    }
+  // Release the memory
+  std::vector<vtkIdType>().swap(segment->Histogram);
+  segment->Mask = NULL;
+  segment->AllocatedMaskSize = 0;
+}
+
+//----------------------------------------------------------------------------
+SegmentStatistics* vtkSegmentStatisticsCalculator::vtkInternal::GetStatistics(const char* segmentID)
+{
+  if (!segmentID)
+    {
+    return NULL;
+    }
+  std::map<std::string, SegmentStatistics>::iterator it = this->Statistics.find(segmentID);
+  if (it == this->Statistics.end())
+    {
+    return NULL;
+    }
+  return &it->second;
+}
+
+//----------------------------------------------------------------------------
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Sums of the voxel values of a work item
+struct ItemAccumulator
+{
+  void Reset()
+  {
+    this->VoxelCount = 0;
+    this->Sum = 0.0;
+    this->SumOfSquares = 0.0;
+    this->Minimum = VTK_DOUBLE_MAX;
+    this->Maximum = VTK_DOUBLE_MIN;
+    this->FirstBin = static_cast<int>(this->Histogram.size());
+    this->LastBin = -1;
+  }
+  vtkIdType VoxelCount;
+  double Sum;
+  double SumOfSquares;
+  double Minimum;
+  double Maximum;
+  std::vector<vtkIdType> Histogram;
+  // Range of nonzero histogram bins
+  int FirstBin;
+  int LastBin;
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void AccumulateScalars(vtkImageData* scalarImage, vtkImageData* mask, const int extent[6],
+                       double histogramOrigin, double histogramSpacing, ItemAccumulator& item)
+{
+  const int numberOfComponents = scalarImage->GetNumberOfScalarComponents();
+  const int numberOfBins = static_cast<int>(item.Histogram.size());
+  const double binsPerValue = 1.0 / histogramSpacing;
+  vtkIdType* histogram = &item.Histogram[0];
+  for (int k = extent[4]; k <= extent[5]; k++)
+    {
+    for (int j = extent[2]; j <= extent[3]; j++)
+      {
+      const unsigned char* maskPtr = static_cast<unsigned char*>(mask->GetScalarPointer(extent[0], j, k));
+      const T* valuePtr = static_cast<T*>(scalarImage->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; i++, maskPtr++, valuePtr += numberOfComponents)
+        {
+        if (!*maskPtr)
+          {
+          continue;
+          }
+        const double value = static_cast<double>(*valuePtr);
+        item.VoxelCount++;
+        item.Sum += value;
+        item.SumOfSquares += value * value;
+        if (value < item.Minimum)
+          {
+          item.Minimum = value;
+          }
+        if (value > item.Maximum)
+          {
+          item.Maximum = value;
+          }
+        // NaN goes to the first bin
+        const double binPosition = (value - histogramOrigin) * binsPerValue + 0.5;
+        int bin = 0;
+        if (binPosition >= 1.0)
+          {
+          bin = (binPosition < numberOfBins ? static_cast<int>(binPosition) : numberOfBins - 1);
+          }
+        histogram[bin]++;
+        if (bin < item.FirstBin)
+          {
+          item.FirstBin = bin;
+          }
+        if (bin > item.LastBin)
+          {
+          item.LastBin = bin;
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void CountVoxels(vtkImageData* mask, const int extent[6], ItemAccumulator& item)
+{
+  for (int k = extent[4]; k <= extent[5]; k++)
+    {
+    for (int j = extent[2]; j <= extent[3]; j++)
+      {
+      const unsigned char* maskPtr = static_cast<unsigned char*>(mask->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; i++, maskPtr++)
+        {
+        if (*maskPtr)
+          {
+          item.VoxelCount++;
+          }
+        }
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkSegmentStatisticsCalculator::vtkSegmentStatisticsCalculator()
+{
+  this->SegmentationNode = NULL;
+  this->ScalarVolumeNode = NULL;
+  this->MaximumNumberOfBins = 65536;
+  this->Internal = new vtkInternal(this);
+}
+
+//----------------------------------------------------------------------------
+vtkSegmentStatisticsCalculator::~vtkSegmentStatisticsCalculator()
+{
+  this->SetSegmentationNode(NULL);
+  this->SetScalarVolumeNode(NULL);
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SegmentationNode: " << this->SegmentationNode << "\n";
+  os << indent << "ScalarVolumeNode: " << this->ScalarVolumeNode << "\n";
+  os << indent << "MaximumNumberOfBins: " << this->MaximumNumberOfBins << "\n";
+  os << indent << "Percentiles:";
+  for (size_t i = 0; i < this->Internal->Percentiles.size(); i++)
+    {
+    os << " " << this->Internal->Percentiles[i];
+    }
+  os << "\n";
+  os << indent << "NumberOfSegments: " << this->Internal->Statistics.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::AddPercentile(double percent)
+{
+  if (percent < 0.0 || percent > 100.0)
+    {
+    vtkErrorMacro("AddPercentile: Invalid percentile " << percent);
+    return;
+    }
+  this->Internal->Percentiles.push_back(percent);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::RemoveAllPercentiles()
+{
+  if (this->Internal->Percentiles.empty())
+    {
+    return;
+    }
+  this->Internal->Percentiles.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentStatisticsCalculator::GetNumberOfPercentiles()
+{
+  return static_cast<int>(this->Internal->Percentiles.size());
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkSegmentStatisticsCalculator::ComputeThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  vtkInternal* internal = static_cast<vtkInternal*>(threadInfo->UserData);
+
+  ItemAccumulator item;
+  if (internal->ScalarImage)
+    {
+    item.Histogram.resize(internal->NumberOfBins, 0);
+    }
+  while (true)
+    {
+    internal->Lock.Lock();
+    if (internal->NextWorkItem >= internal->WorkItems.size())
+      {
+      internal->Lock.Unlock();
+      break;
+      }
+    const WorkItem& workItem = internal->WorkItems[internal->NextWorkItem++];
+    internal->Lock.Unlock();
+
+    SegmentAccumulator* segment = internal->Segments[workItem.SegmentIndex];
+    int extent[6] = { segment->Extent[0], segment->Extent[1], segment->Extent[2], segment->Extent[3],
+                      workItem.FirstSlice, workItem.LastSlice };
+    item.Reset();
+    if (internal->ScalarImage)
+      {
+      switch (internal->ScalarImage->GetScalarType())
+        {
+        vtkTemplateMacro(AccumulateScalars<VTK_TT>(internal->ScalarImage, segment->Mask, extent,
+          internal->HistogramOrigin, internal->HistogramSpacing, item));
+        }
+      }
+    else
+      {
+      CountVoxels(segment->Mask, extent, item);
+      }
+
+    internal->Lock.Lock();
+    segment->VoxelCount += item.VoxelCount;
+    segment->Sum += item.Sum;
+    segment->SumOfSquares += item.SumOfSquares;
+    segment->Minimum = std::min(segment->Minimum, item.Minimum);
+    segment->Maximum = std::max(segment->Maximum, item.Maximum);
+    if (item.LastBin >= item.FirstBin)
+      {
+      if (segment->Histogram.empty())
+        {
+        segment->Histogram.resize(internal->NumberOfBins, 0);
+        }
+      for (int bin = item.FirstBin; bin <= item.LastBin; bin++)
+        {
+        segment->Histogram[bin] += item.Histogram[bin];
+        item.Histogram[bin] = 0;
+        }
+      }
+    if (--segment->NumberOfRemainingItems == 0)
+      {
+      internal->FinalizeSegment(segment);
+      }
+    internal->Lock.Unlock();
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentStatisticsCalculator::Compute(vtkStringArray* segmentIDs/*=NULL*/)
+{
+  vtkInternal* internal = this->Internal;
+  internal->Statistics.clear();
+
+  if (!this->SegmentationNode || !this->SegmentationNode->GetSegmentation())
+    {
+    vtkErrorMacro("Compute: Invalid segmentation node");
+    return false;
+    }
+  vtkSegmentation* segmentation = this->SegmentationNode->GetSegmentation();
+  const std::string labelmapRepresentationName =
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName();
+  if (!segmentation->ContainsRepresentation(labelmapRepresentationName))
+    {
+    vtkErrorMacro("Compute: Segmentation does not contain binary labelmap representation");
+    return false;
+    }
+
+  internal->ScalarImage = NULL;
+  internal->ReferenceGeometry = NULL;
+  internal->SegmentationToReferenceTransform = NULL;
+  internal->LinearSegmentationToReferenceTransform = true;
+  internal->IdentitySegmentationToReferenceTransform = true;
+  if (this->ScalarVolumeNode)
+    {
+    internal->ScalarImage = this->ScalarVolumeNode->GetImageData();
+    if (!internal->ScalarImage || !internal->ScalarImage->GetPointData()->GetScalars())
+      {
+      vtkErrorMacro("Compute: Scalar volume node has no image data");
+      return false;
+      }
+    internal->ReferenceGeometry = vtkSmartPointer<vtkOrientedImageData>::New();
+    internal->ReferenceGeometry->SetExtent(internal->ScalarImage->GetExtent());
+    vtkNew<vtkMatrix4x4> ijkToRASMatrix;
+    this->ScalarVolumeNode->GetIJKToRASMatrix(ijkToRASMatrix.GetPointer());
+    internal->ReferenceGeometry->SetGeometryFromImageToWorldMatrix(ijkToRASMatrix.GetPointer());
+
+    internal->SegmentationToReferenceTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+    vtkMRMLTransformNode::GetTransformBetweenNodes(this->SegmentationNode->GetParentTransformNode(),
+      this->ScalarVolumeNode->GetParentTransformNode(), internal->SegmentationToReferenceTransform);
+    vtkNew<vtkTransform> segmentationToReferenceLinearTransform;
+    vtkNew<vtkMatrix4x4> identityMatrix;
+    internal->LinearSegmentationToReferenceTransform =
+      vtkOrientedImageDataResample::IsTransformLinear(internal->SegmentationToReferenceTransform,
+        segmentationToReferenceLinearTransform.GetPointer());
+    internal->IdentitySegmentationToReferenceTransform =
+      internal->LinearSegmentationToReferenceTransform
+      && vtkOrientedImageDataResample::IsEqual(segmentationToReferenceLinearTransform->GetMatrix(),
+        identityMatrix.GetPointer());
+    internal->InitializeHistogram();
+    }
+
+  std::vector<std::string> segmentIDList;
+  if (segmentIDs)
+    {
+    for (vtkIdType i = 0; i < segmentIDs->GetNumberOfValues(); i++)
+      {
+      segmentIDList.push_back(segmentIDs->GetValue(i));
+      }
+    }
+  else
+    {
+    segmentation->GetSegmentIDs(segmentIDList);
+    }
+
+  // Masks of the segments in the reference geometry. Segments are processed
+  // in batches so that the masks resampled at once do not take more voxels
+  // than the scalar volume (or than a minimum batch size for small volumes),
+  // the masks of a batch are released before the next batch is resampled.
+  std::vector<SegmentAccumulator> segments(segmentIDList.size());
+  internal->Segments.clear();
+  double referenceVoxelVolume = 0.0;
+  vtkIdType maximumAllocatedMaskSize = 0;
+  if (internal->ReferenceGeometry)
+    {
+    double* spacing = internal->ReferenceGeometry->GetSpacing();
+    referenceVoxelVolume = spacing[0] * spacing[1] * spacing[2];
+    maximumAllocatedMaskSize = std::max(GetNumberOfVoxels(internal->ReferenceGeometry->GetExtent()),
+      static_cast<vtkIdType>(1 << 24));
+    }
+  vtkIdType allocatedMaskSize = 0;
+  for (size_t segmentIndex = 0; segmentIndex < segmentIDList.size(); segmentIndex++)
+    {
+    vtkSegment* segment = segmentation->GetSegment(segmentIDList[segmentIndex]);
+    if (!segment)
+      {
+      vtkWarningMacro("Compute: Segment " << segmentIDList[segmentIndex] << " not found");
+      continue;
+      }
+    SegmentAccumulator* accumulator = &segments[segmentIndex];
+    accumulator->SegmentID = segmentIDList[segmentIndex];
+    accumulator->VoxelVolume = referenceVoxelVolume;
+    vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(
+      segment->GetRepresentation(labelmapRepresentationName));
+    if (!internal->InitializeSegment(accumulator, labelmap)
+      || GetNumberOfVoxels(accumulator->Extent) == 0)
+      {
+      // Empty segment
+      internal->FinalizeSegment(accumulator);
+      continue;
+      }
+    internal->Segments.push_back(accumulator);
+    allocatedMaskSize += accumulator->AllocatedMaskSize;
+    if (allocatedMaskSize >= maximumAllocatedMaskSize && maximumAllocatedMaskSize > 0)
+      {
+      internal->ProcessSegments();
+      allocatedMaskSize = 0;
+      }
+    }
+
+  internal->ProcessSegments();
+  internal->ScalarImage = NULL;
+  internal->ReferenceGeometry = NULL;
+  internal->SegmentationToReferenceTransform = NULL;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentStatisticsCalculator::vtkInternal::ProcessSegments()
+{
+  // Split the segments in slabs, largest segments first so that the threads
+  // finish together
+  std::stable_sort(this->Segments.begin(), this->Segments.end(), CompareSegmentSize);
+  vtkNew<vtkMultiThreader> threader;
+  const int maximumNumberOfThreads = threader->GetNumberOfThreads();
+  vtkIdType totalNumberOfVoxels = 0;
+  for (size_t segmentIndex = 0; segmentIndex < this->Segments.size(); segmentIndex++)
+    {
+    totalNumberOfVoxels += GetNumberOfVoxels(this->Segments[segmentIndex]->Extent);
+    }
+  const vtkIdType voxelsPerItem = std::max(
+    totalNumberOfVoxels / (4 * maximumNumberOfThreads), static_cast<vtkIdType>(1 << 20));
+  this->WorkItems.clear();
+  for (size_t segmentIndex = 0; segmentIndex < this->Segments.size(); segmentIndex++)
+    {
+    SegmentAccumulator* segment = this->Segments[segmentIndex];
+    const int numberOfSlices = segment->Extent[5] - segment->Extent[4] + 1;
+    const vtkIdType voxelsPerSlice = GetNumberOfVoxels(segment->Extent) / numberOfSlices;
+    const int slicesPerItem = static_cast<int>(std::max(voxelsPerItem / voxelsPerSlice, static_cast<vtkIdType>(1)));
+    for (int firstSlice = segment->Extent[4]; firstSlice <= segment->Extent[5]; firstSlice += slicesPerItem)
+      {
+      WorkItem item;
+      item.SegmentIndex = static_cast<int>(segmentIndex);
+      item.FirstSlice = firstSlice;
+      item.LastSlice = std::min(firstSlice + slicesPerItem - 1, segment->Extent[5]);
+      this->WorkItems.push_back(item);
+      segment->NumberOfRemainingItems++;
+      }
+    }
+
+  if (!this->WorkItems.empty())
+    {
+    this->NextWorkItem = 0;
+    threader->SetNumberOfThreads(std::min(maximumNumberOfThreads, static_cast<int>(this->WorkItems.size())));
+    threader->SetSingleMethod(vtkSegmentStatisticsCalculator::ComputeThread, this);
+    threader->SingleMethodExecute();
+    }
+
+  this->Segments.clear();
+  this->WorkItems.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentStatisticsCalculator::HasSegment(const char* segmentID)
+{
+  return this->Internal->GetStatistics(segmentID) != NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkSegmentStatisticsCalculator::GetVoxelCount(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetVoxelCount: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0;
+    }
+  return statistics->VoxelCount;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetVolumeMm3(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetVolumeMm3: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->VolumeMm3;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetMinimum(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetMinimum: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->Minimum;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetMaximum(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetMaximum: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->Maximum;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetMean(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetMean: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->Mean;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetStandardDeviation(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetStandardDeviation: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->StandardDeviation;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetMedian(const char* segmentID)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetMedian: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  return statistics->Median;
+}
+
+//----------------------------------------------------------------------------
+double vtkSegmentStatisticsCalculator::GetPercentile(const char* segmentID, int percentileIndex)
+{
+  SegmentStatistics* statistics = this->Internal->GetStatistics(segmentID);
+  if (!statistics)
+    {
+    vtkErrorMacro("GetPercentile: No statistics for segment " << (segmentID ? segmentID : "(null)"));
+    return 0.0;
+    }
+  if (percentileIndex < 0 || percentileIndex >= static_cast<int>(statistics->Percentiles.size()))
+    {
+    vtkErrorMacro("GetPercentile: Invalid percentile index " << percentileIndex);
+    return 0.0;
+    }
+  return statistics->Percentiles[percentileIndex];
+}
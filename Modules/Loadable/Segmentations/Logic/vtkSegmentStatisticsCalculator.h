@@ -0,0 +1,116 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkSegmentStatisticsCalculator_h
+#define __vtkSegmentStatisticsCalculator_h
+
+#include "vtkSlicerSegmentationsModuleLogicExport.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkObject.h>
+
+class vtkMRMLScalarVolumeNode;
+class vtkMRMLSegmentationNode;
+class vtkStringArray;
+
+/// \ingroup SlicerRt_QtModules_Segmentations
+/// \brief Compute voxel count, volume and scalar value statistics of segments.
+///
+/// The binary labelmap representation of the segments is used. If a scalar
+/// volume is set, the segments are resampled to the volume geometry (only
+/// within the extent they cover, unless the segmentation is transformed
+/// non-linearly) and the minimum, maximum, mean, standard deviation, median
+/// and requested percentiles of the voxel values inside each segment are
+/// computed. Otherwise only the voxel count and volume are computed, in the
+/// geometry of each segment labelmap.
+///
+/// The statistics of the segments are computed together: the voxels of the
+/// segments are split in work items that are processed by multiple threads,
+/// and the values of each segment are accumulated in a histogram (of bin
+/// width 1 for integer volumes) from which percentiles are read. Resampled
+/// masks are kept until all the work items of their segment are processed;
+/// segments are processed in batches of about as many resampled voxels as
+/// the scalar volume, so that the masks alive at once take at most two
+/// bytes per voxel of the scalar volume.
+class VTK_SLICER_SEGMENTATIONS_LOGIC_EXPORT vtkSegmentStatisticsCalculator : public vtkObject
+{
+public:
+  static vtkSegmentStatisticsCalculator* New();
+  vtkTypeMacro(vtkSegmentStatisticsCalculator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Segmentation containing the segments
+  void SetSegmentationNode(vtkMRMLSegmentationNode* node);
+  vtkGetObjectMacro(SegmentationNode, vtkMRMLSegmentationNode);
+
+  /// Volume of the scalar values. Scalar statistics are not computed if NULL.
+  void SetScalarVolumeNode(vtkMRMLScalarVolumeNode* node);
+  vtkGetObjectMacro(ScalarVolumeNode, vtkMRMLScalarVolumeNode);
+
+  /// Maximum number of histogram bins. Integer volumes with a smaller range
+  /// of values are binned exactly. Default is 65536.
+  vtkSetClampMacro(MaximumNumberOfBins, int, 2, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfBins, int);
+
+  /// Percentiles (between 0 and 100) computed in addition to the median
+  void AddPercentile(double percent);
+  void RemoveAllPercentiles();
+  int GetNumberOfPercentiles();
+
+  /// Compute the statistics of the segments listed in \a segmentIDs, or of
+  /// all the segments if \a segmentIDs is NULL. Results of previous calls
+  /// are discarded.
+  /// \return False if the inputs are invalid.
+  bool Compute(vtkStringArray* segmentIDs = NULL);
+
+  /// Return true if the statistics of the segment have been computed
+  bool HasSegment(const char* segmentID);
+
+  /// Number of voxels in the segment
+  vtkIdType GetVoxelCount(const char* segmentID);
+  /// Volume of the segment in cubic millimeters
+  double GetVolumeMm3(const char* segmentID);
+
+  /// Scalar statistics of the segment. Return 0 if there is no scalar
+  /// volume or if the segment is empty.
+  double GetMinimum(const char* segmentID);
+  double GetMaximum(const char* segmentID);
+  double GetMean(const char* segmentID);
+  double GetStandardDeviation(const char* segmentID);
+  double GetMedian(const char* segmentID);
+  /// Value of the \a percentileIndex-th percentile added by AddPercentile()
+  double GetPercentile(const char* segmentID, int percentileIndex);
+
+protected:
+  vtkSegmentStatisticsCalculator();
+  ~vtkSegmentStatisticsCalculator();
+
+  static VTK_THREAD_RETURN_TYPE ComputeThread(void* arg);
+
+  vtkMRMLSegmentationNode* SegmentationNode;
+  vtkMRMLScalarVolumeNode* ScalarVolumeNode;
+  int MaximumNumberOfBins;
+
+private:
+  class vtkInternal;
+  vtkInternal* Internal;
+  friend class vtkInternal;
+
+  vtkSegmentStatisticsCalculator(const vtkSegmentStatisticsCalculator&); // Not implemented.
+  void operator=(const vtkSegmentStatisticsCalculator&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Segmentations includes
+#include "vtkMRMLSegmentationsDisplayableManager2D.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkOrientedImageDataResample.h>
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+
+// MRMLDisplayableManager includes
+#include <vtkMRMLDisplayableManagerGroup.h>
+
+// MRMLLogic includes
+#include <vtkMRMLApplicationLogic.h>
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include <vtkMRMLScene.h>
+#include <vtkMRMLSegmentationDisplayNode.h>
+#include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLSliceNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkSmartPointer.h>
+#include <vtkWindowToImageFilter.h>
+
+// STD includes
+#include <cstdlib>
+
+namespace
+{
+
+const int VIEW_SIZE = 100;
+// Screen position of the center of each segment. Slice pixel (i,j) is at
+// R = VIEW_SIZE/2 - i, A = j - VIEW_SIZE/2 in the axial slice view.
+const int RED_PIXEL[2] = { 35, 65 };
+const int GREEN_PIXEL[2] = { 65, 65 };
+
+//----------------------------------------------------------------------------
+// Segment labelmap covering R in [rMin, rMin + 10] and A in [10, 20] at S = 0.
+// All the labelmaps have the same geometry so that they can be merged.
+vtkSmartPointer<vtkOrientedImageData> CreateSegmentLabelmap(double rMin)
+{
+  vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  labelmap->SetOrigin(-20.0, 10.0, 0.0);
+  const int iMin = static_cast<int>(rMin + 20.0);
+  labelmap->SetExtent(iMin, iMin + 10, 0, 10, 0, 0);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkOrientedImageDataResample::FillImage(labelmap, 1.0);
+  return labelmap;
+}
+
+//----------------------------------------------------------------------------
+void AddSegment(vtkSegmentation* segmentation, const char* segmentID,
+                vtkOrientedImageData* labelmap, double r, double g, double b)
+{
+  vtkNew<vtkSegment> segment;
+  segment->SetName(segmentID);
+  segment->SetColor(r, g, b);
+  segment->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap);
+  segmentation->AddSegment(segment.GetPointer(), segmentID);
+}
+
+//----------------------------------------------------------------------------
+int CheckPixel(vtkRenderWindow* renderWindow, const int pixel[2],
+               int expectedRed, int expectedGreen, int expectedBlue, int line)
+{
+  renderWindow->Render();
+  vtkNew<vtkWindowToImageFilter> windowToImage;
+  windowToImage->SetInput(renderWindow);
+  windowToImage->SetInputBufferTypeToRGB();
+  windowToImage->ReadFrontBufferOff();
+  windowToImage->Update();
+  unsigned char* color = static_cast<unsigned char*>(
+    windowToImage->GetOutput()->GetScalarPointer(pixel[0], pixel[1], 0));
+  const int expected[3] = { expectedRed, expectedGreen, expectedBlue };
+  for (int component = 0; component < 3; ++component)
+    {
+    if (abs(static_cast<int>(color[component]) - expected[component]) > 3)
+      {
+      std::cerr << "Line " << line << ": pixel (" << pixel[0] << "," << pixel[1] << ") is ("
+                << static_cast<int>(color[0]) << "," << static_cast<int>(color[1]) << "," << static_cast<int>(color[2])
+                << "), expected (" << expectedRed << "," << expectedGreen << "," << expectedBlue << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int TestSegmentDisplayProperties(bool mergeSegmentLabelmaps)
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLApplicationLogic> applicationLogic;
+  applicationLogic->SetMRMLScene(scene.GetPointer());
+
+  vtkNew<vtkMRMLSliceNode> sliceNode;
+  sliceNode->SetLayoutName("Red");
+  sliceNode->SetOrientationToAxial();
+  sliceNode->SetDimensions(VIEW_SIZE, VIEW_SIZE, 1);
+  sliceNode->SetFieldOfView(VIEW_SIZE, VIEW_SIZE, 1.0);
+  sliceNode->SetSliceOffset(0.0);
+  scene->AddNode(sliceNode.GetPointer());
+
+  vtkNew<vtkRenderer> renderer;
+  vtkNew<vtkRenderWindow> renderWindow;
+  vtkNew<vtkRenderWindowInteractor> renderWindowInteractor;
+  renderWindow->SetSize(VIEW_SIZE, VIEW_SIZE);
+  renderWindow->SetMultiSamples(0);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  renderWindow->SetInteractor(renderWindowInteractor.GetPointer());
+
+  vtkNew<vtkMRMLDisplayableManagerGroup> displayableManagerGroup;
+  displayableManagerGroup->SetRenderer(renderer.GetPointer());
+  displayableManagerGroup->SetMRMLDisplayableNode(sliceNode.GetPointer());
+  vtkNew<vtkMRMLSegmentationsDisplayableManager2D> displayableManager;
+  displayableManager->SetMRMLApplicationLogic(applicationLogic.GetPointer());
+  displayableManager->SetMergeSegmentLabelmaps(mergeSegmentLabelmaps);
+  displayableManagerGroup->AddDisplayableManager(displayableManager.GetPointer());
+
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->CreateDefaultDisplayNodes();
+  vtkMRMLSegmentationDisplayNode* displayNode =
+    vtkMRMLSegmentationDisplayNode::SafeDownCast(segmentationNode->GetDisplayNode());
+  CHECK_NOT_NULL(displayNode);
+  displayNode->SetVisibility2DOutline(false);
+  displayNode->SetOpacity2DFill(1.0);
+
+  vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+  vtkSmartPointer<vtkOrientedImageData> redLabelmap = CreateSegmentLabelmap(10.0);
+  AddSegment(segmentation, "Red", redLabelmap, 1.0, 0.0, 0.0);
+  AddSegment(segmentation, "Green", CreateSegmentLabelmap(-20.0), 0.0, 1.0, 0.0);
+
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 255, 0, 0, __LINE__));
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 255, 0, __LINE__));
+
+  // Segment visibility
+  displayNode->SetSegmentVisibility("Green", false);
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 255, 0, 0, __LINE__));
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 0, 0, __LINE__));
+  displayNode->SetSegmentVisibility("Green", true);
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 255, 0, __LINE__));
+
+  // Segment opacity
+  displayNode->SetSegmentOpacity2DFill("Red", 0.5);
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 128, 0, 0, __LINE__));
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 255, 0, __LINE__));
+  displayNode->SetSegmentOpacity2DFill("Green", 0.0);
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 0, 0, __LINE__));
+  displayNode->SetSegmentOpacity2DFill("Green", 1.0);
+
+  // Editing one segment only updates that segment
+  vtkOrientedImageDataResample::FillImage(redLabelmap, 0.0);
+  redLabelmap->Modified();
+  segmentation->GetSegment("Red")->Modified();
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 0, 0, 0, __LINE__));
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 255, 0, __LINE__));
+  vtkOrientedImageDataResample::FillImage(redLabelmap, 1.0);
+  redLabelmap->Modified();
+  segmentation->GetSegment("Red")->Modified();
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 128, 0, 0, __LINE__));
+
+  // Removing the display node releases its merged labelmap
+  scene->RemoveNode(displayNode);
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), RED_PIXEL, 0, 0, 0, __LINE__));
+  CHECK_EXIT_SUCCESS(CheckPixel(renderWindow.GetPointer(), GREEN_PIXEL, 0, 0, 0, __LINE__));
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationsDisplayableManager2DTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  CHECK_EXIT_SUCCESS(TestSegmentDisplayProperties(true));
+  // Same results with one pipeline per segment
+  CHECK_EXIT_SUCCESS(TestSegmentDisplayProperties(false));
+  return EXIT_SUCCESS;
+}
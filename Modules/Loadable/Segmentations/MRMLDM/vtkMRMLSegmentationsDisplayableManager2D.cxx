@@ -73,12 +73,15 @@
 #include <vtkDoubleArray.h>
 #include <vtkIntArray.h>
 #include <vtkImageThreshold.h>
+#include <vtkTimeStamp.h>
+#include <vtkWeakPointer.h>
 
 // STD includes
 #include <algorithm>
 #include <set>
 #include <map>
 #include <sstream>
+#include <vector>
 
 //---------------------------------------------------------------------------
 vtkStandardNewMacro(vtkMRMLSegmentationsDisplayableManager2D );
@@ -125,6 +128,282 @@ void SnapToPermuteMatrix(vtkTransform* transform)
     }
 }
 
+//---------------------------------------------------------------------------
+namespace
+{
+//---------------------------------------------------------------------------
+// Labelmap containing all the binary labelmaps of a segmentation.
+// Voxel value is the index of the segment in SegmentIDs plus one (0 is background).
+struct MergedLabelmap
+{
+  MergedLabelmap()
+    : Valid(false)
+  {
+  }
+  vtkSmartPointer<vtkOrientedImageData> Labelmap;
+  std::vector<std::string> SegmentIDs;
+  // Weak pointers: a deleted labelmap must not be mistaken for a new one
+  // allocated at the same address
+  std::vector< vtkWeakPointer<vtkOrientedImageData> > SegmentLabelmaps;
+  // Extent of each segment labelmap when it was merged
+  std::vector< std::vector<int> > SegmentExtents;
+  vtkTimeStamp BuildTime;
+  // false if the segments cannot be merged (different geometry, fractional
+  // labelmaps or overlapping segments)
+  bool Valid;
+};
+
+//---------------------------------------------------------------------------
+bool IsExtentEmpty(const int* extent)
+{
+  return extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5];
+}
+
+//---------------------------------------------------------------------------
+bool IsBinaryLabelmap(vtkOrientedImageData* segmentLabelmap)
+{
+  return segmentLabelmap
+    && segmentLabelmap->GetNumberOfScalarComponents() == 1
+    && !segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName())
+    && !segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetThresholdValueFieldName())
+    && !segmentLabelmap->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetInterpolationTypeFieldName());
+}
+
+//---------------------------------------------------------------------------
+template <class T>
+bool MergeSegmentLabelmap(vtkImageData* segmentLabelmap, T*, vtkImageData* mergedLabelmap, unsigned short label)
+{
+  int extent[6] = { 0, -1, 0, -1, 0, -1 };
+  segmentLabelmap->GetExtent(extent);
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      T* segmentPtr = static_cast<T*>(segmentLabelmap->GetScalarPointer(extent[0], j, k));
+      unsigned short* mergedPtr = static_cast<unsigned short*>(mergedLabelmap->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; ++i, ++segmentPtr, ++mergedPtr)
+        {
+        if (*segmentPtr == 0)
+          {
+          continue;
+          }
+        if (*mergedPtr != 0)
+          {
+          // overlapping segments cannot be represented in a single labelmap
+          return false;
+          }
+        *mergedPtr = label;
+        }
+      }
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool MergeSegmentLabelmap(vtkOrientedImageData* segmentLabelmap, vtkImageData* mergedLabelmap, unsigned short label)
+{
+  switch (segmentLabelmap->GetScalarType())
+    {
+    vtkTemplateMacro(return MergeSegmentLabelmap(segmentLabelmap, static_cast<VTK_TT*>(NULL), mergedLabelmap, label));
+    default:
+      return false;
+    }
+}
+
+//---------------------------------------------------------------------------
+void ClearSegmentLabel(vtkImageData* mergedLabelmap, const std::vector<int>& extent, unsigned short label)
+{
+  if (extent.size() != 6 || IsExtentEmpty(&extent[0]))
+    {
+    return;
+    }
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      unsigned short* mergedPtr = static_cast<unsigned short*>(mergedLabelmap->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; ++i, ++mergedPtr)
+        {
+        if (*mergedPtr == label)
+          {
+          *mergedPtr = 0;
+          }
+        }
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+void BuildMergedLabelmap(MergedLabelmap& entry, vtkSegmentation* segmentation,
+  const std::vector<std::string>& segmentIDs, const std::string& representationName)
+{
+  entry.SegmentIDs = segmentIDs;
+  entry.SegmentLabelmaps.clear();
+  entry.SegmentExtents.clear();
+  entry.Labelmap = NULL;
+  entry.Valid = false;
+  entry.BuildTime.Modified();
+
+  vtkOrientedImageData* referenceLabelmap = NULL;
+  int mergedExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  bool validLabelmaps = (segmentIDs.size() < VTK_UNSIGNED_SHORT_MAX);
+  for (std::vector<std::string>::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+    {
+    vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast(
+      segmentation->GetSegmentRepresentation(*segmentIdIt, representationName));
+    entry.SegmentLabelmaps.push_back(segmentLabelmap);
+    entry.SegmentExtents.push_back(segmentLabelmap ?
+      std::vector<int>(segmentLabelmap->GetExtent(), segmentLabelmap->GetExtent() + 6) : std::vector<int>());
+    if (!validLabelmaps)
+      {
+      continue;
+      }
+    if (!IsBinaryLabelmap(segmentLabelmap))
+      {
+      // only binary labelmaps can be merged
+      validLabelmaps = false;
+      continue;
+      }
+    int* extent = segmentLabelmap->GetExtent();
+    if (IsExtentEmpty(extent))
+      {
+      // empty labelmap
+      continue;
+      }
+    if (!referenceLabelmap)
+      {
+      referenceLabelmap = segmentLabelmap;
+      segmentLabelmap->GetExtent(mergedExtent);
+      continue;
+      }
+    if (!vtkOrientedImageDataResample::DoGeometriesMatch(referenceLabelmap, segmentLabelmap))
+      {
+      validLabelmaps = false;
+      continue;
+      }
+    for (int i = 0; i < 3; ++i)
+      {
+      mergedExtent[2 * i] = std::min(mergedExtent[2 * i], extent[2 * i]);
+      mergedExtent[2 * i + 1] = std::max(mergedExtent[2 * i + 1], extent[2 * i + 1]);
+      }
+    }
+  if (!validLabelmaps || !referenceLabelmap)
+    {
+    return;
+    }
+
+  vtkSmartPointer<vtkOrientedImageData> mergedLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+  vtkSmartPointer<vtkMatrix4x4> imageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  referenceLabelmap->GetImageToWorldMatrix(imageToWorldMatrix);
+  mergedLabelmap->SetImageToWorldMatrix(imageToWorldMatrix);
+  mergedLabelmap->SetExtent(mergedExtent);
+  mergedLabelmap->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+  vtkOrientedImageDataResample::FillImage(mergedLabelmap, 0.0);
+
+  for (size_t segmentIndex = 0; segmentIndex < entry.SegmentLabelmaps.size(); ++segmentIndex)
+    {
+    vtkOrientedImageData* segmentLabelmap = entry.SegmentLabelmaps[segmentIndex];
+    if (IsExtentEmpty(segmentLabelmap->GetExtent()))
+      {
+      continue;
+      }
+    if (!MergeSegmentLabelmap(segmentLabelmap, mergedLabelmap, static_cast<unsigned short>(segmentIndex + 1)))
+      {
+      return;
+      }
+    }
+
+  entry.Labelmap = mergedLabelmap;
+  entry.Valid = true;
+}
+
+//---------------------------------------------------------------------------
+// Replace the labels of the modified segments in the merged labelmap.
+// Returns false if the merged labelmap must be rebuilt.
+bool UpdateMergedLabelmapSegments(MergedLabelmap& entry, const std::vector<size_t>& modifiedSegmentIndices)
+{
+  if (!entry.Valid || !entry.Labelmap)
+    {
+    return false;
+    }
+  int* mergedExtent = entry.Labelmap->GetExtent();
+  for (std::vector<size_t>::const_iterator indexIt = modifiedSegmentIndices.begin(); indexIt != modifiedSegmentIndices.end(); ++indexIt)
+    {
+    vtkOrientedImageData* segmentLabelmap = entry.SegmentLabelmaps[*indexIt];
+    if (!IsBinaryLabelmap(segmentLabelmap))
+      {
+      return false;
+      }
+    int* extent = segmentLabelmap->GetExtent();
+    if (IsExtentEmpty(extent))
+      {
+      continue;
+      }
+    if (!vtkOrientedImageDataResample::DoGeometriesMatch(entry.Labelmap, segmentLabelmap))
+      {
+      return false;
+      }
+    for (int i = 0; i < 3; ++i)
+      {
+      if (extent[2 * i] < mergedExtent[2 * i] || extent[2 * i + 1] > mergedExtent[2 * i + 1])
+        {
+        // the segment grew out of the merged labelmap
+        return false;
+        }
+      }
+    }
+
+  for (std::vector<size_t>::const_iterator indexIt = modifiedSegmentIndices.begin(); indexIt != modifiedSegmentIndices.end(); ++indexIt)
+    {
+    vtkOrientedImageData* segmentLabelmap = entry.SegmentLabelmaps[*indexIt];
+    unsigned short label = static_cast<unsigned short>(*indexIt + 1);
+    // Only the voxels within the previous and the new extent of the segment are visited
+    ClearSegmentLabel(entry.Labelmap, entry.SegmentExtents[*indexIt], label);
+    int* extent = segmentLabelmap->GetExtent();
+    entry.SegmentExtents[*indexIt] = std::vector<int>(extent, extent + 6);
+    if (!IsExtentEmpty(extent) && !MergeSegmentLabelmap(segmentLabelmap, entry.Labelmap, label))
+      {
+      return false;
+      }
+    }
+  entry.Labelmap->Modified();
+  entry.BuildTime.Modified();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// The merged labelmap is only recomputed when segments are edited, added or removed.
+// If the segments cannot be merged then this is remembered until then.
+void UpdateMergedLabelmap(MergedLabelmap& entry, vtkSegmentation* segmentation,
+  const std::vector<std::string>& segmentIDs, const std::string& representationName)
+{
+  bool rebuild = (entry.BuildTime.GetMTime() == 0 || entry.SegmentIDs != segmentIDs);
+  std::vector<size_t> modifiedSegmentIndices;
+  for (size_t segmentIndex = 0; !rebuild && segmentIndex < segmentIDs.size(); ++segmentIndex)
+    {
+    vtkOrientedImageData* segmentLabelmap = vtkOrientedImageData::SafeDownCast(
+      segmentation->GetSegmentRepresentation(segmentIDs[segmentIndex], representationName));
+    if (segmentLabelmap != entry.SegmentLabelmaps[segmentIndex].GetPointer())
+      {
+      rebuild = true;
+      }
+    else if (segmentLabelmap && segmentLabelmap->GetMTime() > entry.BuildTime.GetMTime())
+      {
+      modifiedSegmentIndices.push_back(segmentIndex);
+      }
+    }
+  if (!rebuild && modifiedSegmentIndices.empty())
+    {
+    return;
+    }
+  if (!rebuild && UpdateMergedLabelmapSegments(entry, modifiedSegmentIndices))
+    {
+    return;
+    }
+  BuildMergedLabelmap(entry, segmentation, segmentIDs, representationName);
+}
+}
+
 //---------------------------------------------------------------------------
 class vtkMRMLSegmentationsDisplayableManager2D::vtkInternal
 {
@@ -288,10 +567,80 @@ public:
     vtkMTimeType SliceIntersectionUpdatedTime;
     };
 
+  /// Pipeline displaying all the segments of a segmentation from a single
+  /// merged labelmap, used instead of the segment pipelines when possible.
+  struct MergedPipeline
+    {
+    MergedPipeline()
+      {
+      this->NodeToWorldTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      this->WorldToNodeTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      this->ImageOutlineActor = vtkSmartPointer<vtkActor2D>::New();
+      this->ImageFillActor = vtkSmartPointer<vtkActor2D>::New();
+      this->Reslice = vtkSmartPointer<vtkImageReslice>::New();
+      this->SliceToImageTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      this->LabelOutline = vtkSmartPointer<vtkImageLabelOutline>::New();
+      this->LookupTableOutline = vtkSmartPointer<vtkLookupTable>::New();
+      this->LookupTableFill = vtkSmartPointer<vtkLookupTable>::New();
+
+      this->Reslice->SetBackgroundColor(0.0, 0.0, 0.0, 0.0);
+      this->Reslice->AutoCropOutputOff();
+      this->Reslice->SetOptimization(1);
+      this->Reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+      this->Reslice->SetOutputSpacing(1.0, 1.0, 1.0);
+      this->Reslice->SetOutputDimensionality(3);
+      this->Reslice->SetInterpolationModeToNearestNeighbor();
+
+      this->SliceToImageTransform->PostMultiply();
+
+      // Image outline
+      this->LabelOutline->SetInputConnection(this->Reslice->GetOutputPort());
+      vtkSmartPointer<vtkImageMapToRGBA> outlineColorMapper = vtkSmartPointer<vtkImageMapToRGBA>::New();
+      outlineColorMapper->SetInputConnection(this->LabelOutline->GetOutputPort());
+      outlineColorMapper->SetOutputFormatToRGBA();
+      outlineColorMapper->SetLookupTable(this->LookupTableOutline);
+      vtkSmartPointer<vtkImageMapper> imageOutlineMapper = vtkSmartPointer<vtkImageMapper>::New();
+      imageOutlineMapper->SetInputConnection(outlineColorMapper->GetOutputPort());
+      imageOutlineMapper->SetColorWindow(255);
+      imageOutlineMapper->SetColorLevel(127.5);
+      this->ImageOutlineActor->SetMapper(imageOutlineMapper);
+      this->ImageOutlineActor->SetVisibility(0);
+
+      // Image fill
+      vtkSmartPointer<vtkImageMapToRGBA> fillColorMapper = vtkSmartPointer<vtkImageMapToRGBA>::New();
+      fillColorMapper->SetInputConnection(this->Reslice->GetOutputPort());
+      fillColorMapper->SetOutputFormatToRGBA();
+      fillColorMapper->SetLookupTable(this->LookupTableFill);
+      vtkSmartPointer<vtkImageMapper> imageFillMapper = vtkSmartPointer<vtkImageMapper>::New();
+      imageFillMapper->SetInputConnection(fillColorMapper->GetOutputPort());
+      imageFillMapper->SetColorWindow(255);
+      imageFillMapper->SetColorLevel(127.5);
+      this->ImageFillActor->SetMapper(imageFillMapper);
+      this->ImageFillActor->SetVisibility(0);
+      }
+
+    /// Merged labelmap of the segmentation of the display node
+    MergedLabelmap Merged;
+
+    vtkSmartPointer<vtkGeneralTransform> NodeToWorldTransform;
+    vtkSmartPointer<vtkGeneralTransform> WorldToNodeTransform;
+
+    vtkSmartPointer<vtkActor2D> ImageOutlineActor;
+    vtkSmartPointer<vtkActor2D> ImageFillActor;
+    vtkSmartPointer<vtkImageReslice> Reslice;
+    vtkSmartPointer<vtkGeneralTransform> SliceToImageTransform;
+    vtkSmartPointer<vtkImageLabelOutline> LabelOutline;
+    vtkSmartPointer<vtkLookupTable> LookupTableOutline;
+    vtkSmartPointer<vtkLookupTable> LookupTableFill;
+    };
+
   typedef std::map<std::string, Pipeline*> PipelineMapType; // first: segment ID; second: display pipeline
   typedef std::map < vtkMRMLSegmentationDisplayNode*, PipelineMapType > PipelinesCacheType;
   PipelinesCacheType DisplayPipelines;
 
+  typedef std::map < vtkMRMLSegmentationDisplayNode*, MergedPipeline* > MergedPipelinesCacheType;
+  MergedPipelinesCacheType MergedPipelines;
+
   typedef std::map < vtkMRMLSegmentationNode*, std::set< vtkMRMLSegmentationDisplayNode* > > SegmentationToDisplayCacheType;
   SegmentationToDisplayCacheType SegmentationToDisplayNodes;
 
@@ -317,6 +666,12 @@ public:
   void UpdateDisplayNodePipeline(vtkMRMLSegmentationDisplayNode*, PipelineMapType);
   void RemoveDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode);
 
+  // Merged labelmap display
+  bool UpdateMergedPipeline(vtkMRMLSegmentationDisplayNode* displayNode, vtkMRMLSegmentationNode* segmentationNode,
+    const std::string& representationName, bool displayNodeVisible);
+  void HideMergedPipeline(vtkMRMLSegmentationDisplayNode* displayNode);
+  void RemoveMergedPipeline(vtkMRMLSegmentationDisplayNode* displayNode);
+
   // Observations
   void AddObservations(vtkMRMLSegmentationNode* node);
   void RemoveObservations(vtkMRMLSegmentationNode* node);
@@ -337,6 +692,9 @@ private:
 
   bool SmoothFractionalLabelMapBorder;
   vtkIdType DefaultFractionalInterpolationType;
+
+public:
+  bool MergeSegmentLabelmaps;
 };
 
 //---------------------------------------------------------------------------
@@ -352,6 +710,7 @@ vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::vtkInternal(vtkMRMLSegmen
 
   this->SmoothFractionalLabelMapBorder = true;
   this->DefaultFractionalInterpolationType = VTK_LINEAR_INTERPOLATION;
+  this->MergeSegmentLabelmaps = true;
 }
 
 //---------------------------------------------------------------------------
@@ -541,6 +900,152 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveDisplayNode(vt
     delete pipeline;
     }
   this->DisplayPipelines.erase(pipelinesIter);
+  this->RemoveMergedPipeline(displayNode);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::HideMergedPipeline(vtkMRMLSegmentationDisplayNode* displayNode)
+{
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedPipelines.find(displayNode);
+  if (mergedPipelineIt == this->MergedPipelines.end())
+    {
+    return;
+    }
+  mergedPipelineIt->second->ImageOutlineActor->SetVisibility(false);
+  mergedPipelineIt->second->ImageFillActor->SetVisibility(false);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveMergedPipeline(vtkMRMLSegmentationDisplayNode* displayNode)
+{
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedPipelines.find(displayNode);
+  if (mergedPipelineIt == this->MergedPipelines.end())
+    {
+    return;
+    }
+  MergedPipeline* pipeline = mergedPipelineIt->second;
+  this->External->GetRenderer()->RemoveActor(pipeline->ImageOutlineActor);
+  this->External->GetRenderer()->RemoveActor(pipeline->ImageFillActor);
+  delete pipeline;
+  this->MergedPipelines.erase(mergedPipelineIt);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateMergedPipeline(
+  vtkMRMLSegmentationDisplayNode* displayNode, vtkMRMLSegmentationNode* segmentationNode,
+  const std::string& representationName, bool displayNodeVisible)
+{
+  vtkSegmentation* segmentation = segmentationNode->GetSegmentation();
+  if (!this->MergeSegmentLabelmaps || !segmentation
+    || representationName != vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName())
+    {
+    return false;
+    }
+  std::vector< std::string > segmentIDs;
+  segmentation->GetSegmentIDs(segmentIDs);
+  if (segmentIDs.size() < 2)
+    {
+    // nothing to gain from merging
+    return false;
+    }
+
+  MergedPipeline* pipeline = NULL;
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedPipelines.find(displayNode);
+  if (mergedPipelineIt != this->MergedPipelines.end())
+    {
+    pipeline = mergedPipelineIt->second;
+    }
+  else
+    {
+    pipeline = new MergedPipeline();
+    this->External->GetRenderer()->AddActor(pipeline->ImageOutlineActor);
+    this->External->GetRenderer()->AddActor(pipeline->ImageFillActor);
+    this->MergedPipelines[displayNode] = pipeline;
+    }
+
+  MergedLabelmap& mergedLabelmap = pipeline->Merged;
+  UpdateMergedLabelmap(mergedLabelmap, segmentation, segmentIDs, representationName);
+  if (!mergedLabelmap.Valid)
+    {
+    pipeline->ImageOutlineActor->SetVisibility(false);
+    pipeline->ImageFillActor->SetVisibility(false);
+    return false;
+    }
+
+  // Segment colors and opacities, indexed by label value
+  int numberOfLabels = static_cast<int>(segmentIDs.size());
+  pipeline->LookupTableOutline->SetNumberOfTableValues(numberOfLabels + 1);
+  pipeline->LookupTableOutline->SetTableRange(0, numberOfLabels);
+  pipeline->LookupTableOutline->SetTableValue(0, 0, 0, 0, 0);
+  pipeline->LookupTableFill->SetNumberOfTableValues(numberOfLabels + 1);
+  pipeline->LookupTableFill->SetTableRange(0, numberOfLabels);
+  pipeline->LookupTableFill->SetTableValue(0, 0, 0, 0, 0);
+  bool anyOutlineVisible = false;
+  bool anyFillVisible = false;
+  for (int segmentIndex = 0; segmentIndex < numberOfLabels; ++segmentIndex)
+    {
+    const std::string& segmentID = segmentIDs[segmentIndex];
+    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+    displayNode->GetSegmentDisplayProperties(segmentID, properties);
+
+    double outlineOpacity = properties.Opacity2DOutline * displayNode->GetOpacity2DOutline() * displayNode->GetOpacity();
+    bool segmentOutlineVisible = displayNodeVisible && properties.Visible
+      && properties.Visible2DOutline && displayNode->GetVisibility2DOutline() && (outlineOpacity > 0.0);
+    double fillOpacity = properties.Opacity2DFill * displayNode->GetOpacity2DFill() * displayNode->GetOpacity();
+    bool segmentFillVisible = displayNodeVisible && properties.Visible
+      && properties.Visible2DFill && displayNode->GetVisibility2DFill() && (fillOpacity > 0.0);
+    anyOutlineVisible = anyOutlineVisible || segmentOutlineVisible;
+    anyFillVisible = anyFillVisible || segmentFillVisible;
+
+    double color[3] = {vtkSegment::SEGMENT_COLOR_INVALID[0], vtkSegment::SEGMENT_COLOR_INVALID[1], vtkSegment::SEGMENT_COLOR_INVALID[2]};
+    displayNode->GetSegmentColor(segmentID, color);
+    pipeline->LookupTableOutline->SetTableValue(segmentIndex + 1,
+      color[0], color[1], color[2], segmentOutlineVisible ? outlineOpacity : 0.0);
+    pipeline->LookupTableFill->SetTableValue(segmentIndex + 1,
+      color[0], color[1], color[2], segmentFillVisible ? fillOpacity : 0.0);
+    }
+
+  if (anyOutlineVisible || anyFillVisible)
+    {
+    // Calculate slice XY to merged labelmap IJK transform
+    this->GetNodeTransformToWorld(segmentationNode, pipeline->NodeToWorldTransform, pipeline->WorldToNodeTransform);
+    pipeline->SliceToImageTransform->Identity();
+    pipeline->SliceToImageTransform->Concatenate(this->SliceXYToRAS);
+    pipeline->SliceToImageTransform->Concatenate(pipeline->WorldToNodeTransform);
+    vtkSmartPointer<vtkMatrix4x4> worldToImageMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    mergedLabelmap.Labelmap->GetWorldToImageMatrix(worldToImageMatrix);
+    pipeline->SliceToImageTransform->Concatenate(worldToImageMatrix);
+
+    vtkSmartPointer<vtkImageData> identityImageData = vtkSmartPointer<vtkImageData>::New();
+    identityImageData->ShallowCopy(mergedLabelmap.Labelmap);
+    identityImageData->SetOrigin(0.0, 0.0, 0.0);
+    identityImageData->SetSpacing(1.0, 1.0, 1.0);
+
+    vtkSmartPointer<vtkTransform> linearSliceToImageTransform = vtkSmartPointer<vtkTransform>::New();
+    if (vtkMRMLTransformNode::IsGeneralTransformLinear(pipeline->SliceToImageTransform, linearSliceToImageTransform))
+      {
+      SnapToPermuteMatrix(linearSliceToImageTransform);
+      pipeline->Reslice->SetResliceTransform(linearSliceToImageTransform);
+      }
+    else
+      {
+      pipeline->Reslice->SetResliceTransform(pipeline->SliceToImageTransform);
+      }
+    pipeline->Reslice->SetInputData(identityImageData);
+
+    int dimensions[3] = { 0, 0, 0 };
+    this->SliceNode->GetDimensions(dimensions);
+    int sliceOutputExtent[6] = { 0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1 };
+    pipeline->Reslice->SetOutputExtent(sliceOutputExtent);
+
+    pipeline->LabelOutline->SetOutline(displayNode->GetSliceIntersectionThickness());
+    }
+
+  pipeline->ImageOutlineActor->SetVisibility(anyOutlineVisible);
+  pipeline->ImageOutlineActor->SetPosition(0,0);
+  pipeline->ImageFillActor->SetVisibility(anyFillVisible);
+  pipeline->ImageFillActor->SetPosition(0,0);
+  return true;
 }
 
 //---------------------------------------------------------------------------
@@ -705,6 +1210,7 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
   if (shownRepresenatationName.empty())
     {
     // Hide segmentation if there is no 2D representation to show
+    this->HideMergedPipeline(displayNode);
     for (PipelineMapType::iterator pipelineIt=pipelines.begin(); pipelineIt!=pipelines.end(); ++pipelineIt)
       {
       pipelineIt->second->PolyDataOutlineActor->SetVisibility(false);
@@ -733,6 +1239,20 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
     return;
     }
 
+  // Display all segments with a single reslice if their labelmaps can be merged
+  if (this->UpdateMergedPipeline(displayNode, segmentationNode, shownRepresenatationName, displayNodeVisible))
+    {
+    for (PipelineMapType::iterator pipelineIt=pipelines.begin(); pipelineIt!=pipelines.end(); ++pipelineIt)
+      {
+      pipelineIt->second->PolyDataOutlineActor->SetVisibility(false);
+      pipelineIt->second->PolyDataFillActor->SetVisibility(false);
+      pipelineIt->second->ImageOutlineActor->SetVisibility(false);
+      pipelineIt->second->ImageFillActor->SetVisibility(false);
+      }
+    return;
+    }
+  this->HideMergedPipeline(displayNode);
+
   // For all pipelines (pipeline per segment)
   for (PipelineMapType::iterator pipelineIt=pipelines.begin(); pipelineIt!=pipelines.end(); ++pipelineIt)
     {
@@ -1170,6 +1690,30 @@ void vtkMRMLSegmentationsDisplayableManager2D::PrintSelf(ostream& os, vtkIndent
 {
   this->Superclass::PrintSelf(os, indent);
   os << indent << "vtkMRMLSegmentationsDisplayableManager2D: " << this->GetClassName() << "\n";
+  os << indent << "MergeSegmentLabelmaps: " << this->Internal->MergeSegmentLabelmaps << "\n";
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::SetMergeSegmentLabelmaps(bool merge)
+{
+  if (this->Internal->MergeSegmentLabelmaps == merge)
+    {
+    return;
+    }
+  this->Internal->MergeSegmentLabelmaps = merge;
+  vtkInternal::PipelinesCacheType::iterator displayNodeIt;
+  for (displayNodeIt = this->Internal->DisplayPipelines.begin(); displayNodeIt != this->Internal->DisplayPipelines.end(); ++displayNodeIt)
+    {
+    this->Internal->UpdateDisplayNodePipeline(displayNodeIt->first, displayNodeIt->second);
+    }
+  this->Modified();
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSegmentationsDisplayableManager2D::GetMergeSegmentLabelmaps()
+{
+  return this->Internal->MergeSegmentLabelmaps;
 }
 
 //---------------------------------------------------------------------------
@@ -52,6 +52,14 @@ public:
   virtual void GetVisibleSegmentsForPosition(double ras[3], vtkMRMLSegmentationDisplayNode* displayNode,
     vtkStringArray* segmentIDs, vtkDoubleArray* segmentValues = NULL);
 
+  /// Display all the segments of a segmentation from a single merged labelmap
+  /// when their binary labelmaps have the same geometry and do not overlap.
+  /// Slice changes then require one reslice per segmentation instead of one per segment.
+  /// Segments are displayed with one pipeline each otherwise.
+  /// Enabled by default.
+  void SetMergeSegmentLabelmaps(bool merge);
+  bool GetMergeSegmentLabelmaps();
+
 protected:
   virtual void UnobserveMRMLScene() VTK_OVERRIDE;
   virtual void OnMRMLSceneNodeAdded(vtkMRMLNode* node) VTK_OVERRIDE;
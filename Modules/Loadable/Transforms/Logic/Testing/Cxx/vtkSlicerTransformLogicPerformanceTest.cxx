@@ -0,0 +1,211 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// Logic includes
+#include "vtkSlicerTransformLogic.h"
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLGridTransformNode.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkOrientedGridTransform.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+// Smooth displacement field covering [-100, 100] in each direction
+void CreateGridTransform(vtkOrientedGridTransform* gridTransform, vtkImageData* grid, vtkMatrix4x4* direction)
+{
+  const int gridSize = 21;
+  grid->SetExtent(0, gridSize - 1, 0, gridSize - 1, 0, gridSize - 1);
+  grid->SetOrigin(-100.0, -100.0, -100.0);
+  grid->SetSpacing(10.0, 10.0, 10.0);
+  grid->AllocateScalars(VTK_DOUBLE, 3);
+  for (int z = 0; z < gridSize; z++)
+    {
+    for (int y = 0; y < gridSize; y++)
+      {
+      for (int x = 0; x < gridSize; x++)
+        {
+        const double u = 2.0 * vtkMath::Pi() * x / gridSize;
+        const double v = 2.0 * vtkMath::Pi() * y / gridSize;
+        const double w = 2.0 * vtkMath::Pi() * z / gridSize;
+        grid->SetScalarComponentFromDouble(x, y, z, 0, 5.0 * sin(v + w));
+        grid->SetScalarComponentFromDouble(x, y, z, 1, 5.0 * cos(u) * sin(w));
+        grid->SetScalarComponentFromDouble(x, y, z, 2, 5.0 * sin(u + v));
+        }
+      }
+    }
+  const double angle = vtkMath::RadiansFromDegrees(15.0);
+  direction->Identity();
+  direction->SetElement(0, 0, cos(angle));
+  direction->SetElement(0, 2, sin(angle));
+  direction->SetElement(2, 0, -sin(angle));
+  direction->SetElement(2, 2, cos(angle));
+  gridTransform->SetGridDirectionMatrix(direction);
+  gridTransform->SetDisplacementGridData(grid);
+}
+
+//-----------------------------------------------------------------------------
+int HardenModelTest(vtkMRMLScene* scene, vtkMRMLTransformNode* transformNode, int numberOfPoints)
+{
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(numberOfPoints);
+  for (int i = 0; i < numberOfPoints; i++)
+    {
+    points->SetPoint(i, vtkMath::Random(-110.0, 110.0), vtkMath::Random(-110.0, 110.0), vtkMath::Random(-110.0, 110.0));
+    }
+  vtkNew<vtkPolyData> polyData;
+  polyData->SetPoints(points.GetPointer());
+
+  vtkNew<vtkPoints> originalPoints;
+  originalPoints->DeepCopy(points.GetPointer());
+
+  vtkNew<vtkMRMLModelNode> modelNode;
+  modelNode->SetAndObservePolyData(polyData.GetPointer());
+  scene->AddNode(modelNode.GetPointer());
+  modelNode->SetAndObserveTransformNodeID(transformNode->GetID());
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  CHECK_BOOL(vtkSlicerTransformLogic::hardenTransform(modelNode.GetPointer()), true);
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"vtkSlicerTransformLogic-HardenGridTransformPerformance-"
+            << numberOfPoints << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  // Batch transformation gives the same points as one point at a time
+  vtkPoints* hardenedPoints = modelNode->GetPolyData()->GetPoints();
+  CHECK_INT(hardenedPoints->GetNumberOfPoints(), numberOfPoints);
+  CHECK_INT(hardenedPoints->GetDataType(), VTK_FLOAT);
+  vtkAbstractTransform* transform = transformNode->GetTransformToParent();
+  for (int i = 0; i < numberOfPoints; i++)
+    {
+    double expected[3];
+    transform->TransformPoint(originalPoints->GetPoint(i), expected);
+    double* actual = hardenedPoints->GetPoint(i);
+    if (sqrt(vtkMath::Distance2BetweenPoints(expected, actual)) > 1e-3)
+      {
+      std::cerr << "Line " << __LINE__ << ": point " << i << " is transformed to "
+                << actual[0] << " " << actual[1] << " " << actual[2] << " instead of "
+                << expected[0] << " " << expected[1] << " " << expected[2] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  scene->RemoveNode(modelNode.GetPointer());
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int DisplacementVolumeTest(vtkMRMLScene* scene, vtkMRMLTransformNode* transformNode, int volumeSize)
+{
+  vtkNew<vtkImageData> referenceImage;
+  referenceImage->SetDimensions(volumeSize, volumeSize, volumeSize);
+  referenceImage->AllocateScalars(VTK_SHORT, 1);
+  vtkNew<vtkMRMLScalarVolumeNode> referenceVolumeNode;
+  referenceVolumeNode->SetAndObserveImageData(referenceImage.GetPointer());
+  referenceVolumeNode->SetOrigin(-90.0, -95.0, -100.0);
+  const double spacing = 190.0 / volumeSize;
+  referenceVolumeNode->SetSpacing(spacing, spacing, spacing);
+  scene->AddNode(referenceVolumeNode.GetPointer());
+
+  vtkNew<vtkSlicerTransformLogic> logic;
+  logic->SetMRMLScene(scene);
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  vtkMRMLVolumeNode* displacementVolumeNode = logic->CreateDisplacementVolumeFromTransform(
+    transformNode, referenceVolumeNode.GetPointer(), false);
+  timer->StopTimer();
+  std::cout << "<DartMeasurement name=\"vtkSlicerTransformLogic-CreateDisplacementVolumePerformance-"
+            << volumeSize << "\" type=\"numeric/double\">"
+            << timer->GetElapsedTime() << "</DartMeasurement>" << std::endl;
+
+  CHECK_NOT_NULL(displacementVolumeNode);
+  vtkImageData* displacementImage = displacementVolumeNode->GetImageData();
+  CHECK_NOT_NULL(displacementImage);
+  CHECK_INT(displacementImage->GetNumberOfScalarComponents(), 3);
+
+  vtkNew<vtkMatrix4x4> ijkToRAS;
+  referenceVolumeNode->GetIJKToRASMatrix(ijkToRAS.GetPointer());
+  vtkAbstractTransform* transform = transformNode->GetTransformToParent();
+  for (int k = 0; k < volumeSize; k += 7)
+    {
+    for (int j = 0; j < volumeSize; j += 5)
+      {
+      for (int i = 0; i < volumeSize; i += 3)
+        {
+        const double point_IJK[4] = { static_cast<double>(i), static_cast<double>(j), static_cast<double>(k), 1.0 };
+        double point_RAS[4];
+        ijkToRAS->MultiplyPoint(point_IJK, point_RAS);
+        double transformedPoint_RAS[3];
+        transform->TransformPoint(point_RAS, transformedPoint_RAS);
+        for (int c = 0; c < 3; c++)
+          {
+          const double expected = transformedPoint_RAS[c] - point_RAS[c];
+          const double actual = displacementImage->GetScalarComponentAsDouble(i, j, k, c);
+          if (fabs(expected - actual) > 1e-4)
+            {
+            std::cerr << "Line " << __LINE__ << ": displacement component " << c << " at voxel "
+                      << i << " " << j << " " << k << " is " << actual << " instead of " << expected << std::endl;
+            return EXIT_FAILURE;
+            }
+          }
+        }
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerTransformLogicPerformanceTest(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkMath::RandomSeed(2017);
+
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkImageData> grid;
+  vtkNew<vtkMatrix4x4> direction;
+  vtkNew<vtkOrientedGridTransform> gridTransform;
+  CreateGridTransform(gridTransform.GetPointer(), grid.GetPointer(), direction.GetPointer());
+
+  vtkNew<vtkMRMLGridTransformNode> transformNode;
+  scene->AddNode(transformNode.GetPointer());
+  transformNode->SetAndObserveTransformToParent(gridTransform.GetPointer());
+
+  // Type specialized linear interpolation
+  gridTransform->SetInterpolationModeToLinear();
+  CHECK_EXIT_SUCCESS(HardenModelTest(scene.GetPointer(), transformNode.GetPointer(), 500000));
+  CHECK_EXIT_SUCCESS(DisplacementVolumeTest(scene.GetPointer(), transformNode.GetPointer(), 96));
+
+  // Cubic interpolation, as grid transforms read from files
+  gridTransform->SetInterpolationModeToCubic();
+  CHECK_EXIT_SUCCESS(HardenModelTest(scene.GetPointer(), transformNode.GetPointer(), 500000));
+  CHECK_EXIT_SUCCESS(DisplacementVolumeTest(scene.GetPointer(), transformNode.GetPointer(), 96));
+
+  return EXIT_SUCCESS;
+}
@@ -384,6 +384,28 @@ void vtkSlicerTransformLogic::GetTransformedPointSamplesOnSlice(vtkPointSet* out
   outputPointSet->GetPointData()->SetActiveAttribute(GetVisualizationDisplacementMagnitudeScalarName(), vtkDataSetAttributes::SCALARS);
 }
 
+//----------------------------------------------------------------------------
+namespace
+{
+// Replace the content of points_RAS by the RAS positions of the voxels of slice k of extent
+void GetSlicePoints(vtkMatrix4x4* ijkToRAS, const int extent[6], double k, vtkPoints* points_RAS)
+{
+  points_RAS->SetNumberOfPoints(
+    static_cast<vtkIdType>(extent[1] - extent[0] + 1) * static_cast<vtkIdType>(extent[3] - extent[2] + 1));
+  double point_IJK[4] = { 0, 0, k, 1 };
+  double point_RAS[4] = { 0, 0, 0, 1 };
+  vtkIdType pointIndex = 0;
+  for (point_IJK[1] = extent[2]; point_IJK[1] <= extent[3]; point_IJK[1]++)
+  {
+    for (point_IJK[0] = extent[0]; point_IJK[0] <= extent[1]; point_IJK[0]++)
+    {
+      ijkToRAS->MultiplyPoint(point_IJK, point_RAS);
+      points_RAS->SetPoint(pointIndex++, point_RAS);
+    }
+  }
+}
+}
+
 //----------------------------------------------------------------------------
 bool vtkSlicerTransformLogic::GetTransformedPointSamplesAsMagnitudeImage(vtkImageData* magnitudeImage,
   vtkMRMLTransformNode* inputTransformNode, vtkMatrix4x4* ijkToRAS, bool transformToWorld /* = true */)
@@ -409,33 +431,32 @@ bool vtkSlicerTransformLogic::GetTransformedPointSamplesAsMagnitudeImage(vtkImag
   // if the direction matrix is not identity.
   magnitudeImage->AllocateScalars(VTK_FLOAT, 1);
 
-  double point_RAS[4] = { 0, 0, 0, 1 };
-  double transformedPoint_RAS[4] = { 0, 0, 0, 1 };
-  double pointDislocationVector_RAS[4] = { 0, 0, 0, 1 };
+  // Transform the points one slice at a time, in a single call,
+  // so that the component transforms can process them in batches
+  vtkNew<vtkPoints> points_RAS;
+  points_RAS->SetDataTypeToDouble();
+  vtkNew<vtkPoints> transformedPoints_RAS;
+  transformedPoints_RAS->SetDataTypeToDouble();
   double point_IJK[4] = { 0, 0, 0, 1 };
+  double point_RAS[4] = { 0, 0, 0, 1 };
   float* voxelPtr = static_cast<float*>(magnitudeImage->GetScalarPointer());
   int* extent = magnitudeImage->GetExtent();
   for (point_IJK[2] = extent[4]; point_IJK[2] <= extent[5]; point_IJK[2]++)
   {
-    for (point_IJK[1] = extent[2]; point_IJK[1] <= extent[3]; point_IJK[1]++)
+    GetSlicePoints(ijkToRAS, extent, point_IJK[2], points_RAS.GetPointer());
+    vtkMRMLTransformNode::TransformPoints(inputTransform.GetPointer(), points_RAS.GetPointer(), transformedPoints_RAS.GetPointer());
+    vtkIdType numberOfPoints = points_RAS->GetNumberOfPoints();
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
     {
-      for (point_IJK[0] = extent[0]; point_IJK[0] <= extent[1]; point_IJK[0]++)
+      points_RAS->GetPoint(pointIndex, point_RAS);
+      double* transformedPoint_RAS = transformedPoints_RAS->GetPoint(pointIndex);
+      double pointDislocationVector_RAS[3] =
       {
-        ijkToRAS->MultiplyPoint(point_IJK, point_RAS);
-
-        inputTransform->TransformPoint(point_RAS, transformedPoint_RAS);
-
-        pointDislocationVector_RAS[0] = transformedPoint_RAS[0] - point_RAS[0];
-        pointDislocationVector_RAS[1] = transformedPoint_RAS[1] - point_RAS[1];
-        pointDislocationVector_RAS[2] = transformedPoint_RAS[2] - point_RAS[2];
-
-        float mag = sqrt(
-          pointDislocationVector_RAS[0] * pointDislocationVector_RAS[0] +
-          pointDislocationVector_RAS[1] * pointDislocationVector_RAS[1] +
-          pointDislocationVector_RAS[2] * pointDislocationVector_RAS[2]);
-
-        *(voxelPtr++) = mag;
-      }
+        transformedPoint_RAS[0] - point_RAS[0],
+        transformedPoint_RAS[1] - point_RAS[1],
+        transformedPoint_RAS[2] - point_RAS[2]
+      };
+      *(voxelPtr++) = static_cast<float>(vtkMath::Norm(pointDislocationVector_RAS));
     }
   }
 
@@ -703,26 +724,29 @@ bool vtkSlicerTransformLogic::GetTransformedPointSamplesAsVectorImage(vtkImageDa
   // if the direction matrix is not identity.
   vectorImage->AllocateScalars(VTK_FLOAT, 3);
 
-  double point_RAS[4] = { 0, 0, 0, 1 };
-  double transformedPoint_RAS[4] = { 0, 0, 0, 1 };
+  // Transform the points one slice at a time, in a single call,
+  // so that the component transforms can process them in batches
+  vtkNew<vtkPoints> points_RAS;
+  points_RAS->SetDataTypeToDouble();
+  vtkNew<vtkPoints> transformedPoints_RAS;
+  transformedPoints_RAS->SetDataTypeToDouble();
   double point_IJK[4] = { 0, 0, 0, 1 };
+  double point_RAS[4] = { 0, 0, 0, 1 };
   float* voxelPtr = static_cast<float*>(vectorImage->GetScalarPointer());
   int* extent = vectorImage->GetExtent();
   for (point_IJK[2] = extent[4]; point_IJK[2] <= extent[5]; point_IJK[2]++)
   {
-    for (point_IJK[1] = extent[2]; point_IJK[1] <= extent[3]; point_IJK[1]++)
+    GetSlicePoints(ijkToRAS, extent, point_IJK[2], points_RAS.GetPointer());
+    vtkMRMLTransformNode::TransformPoints(inputTransform.GetPointer(), points_RAS.GetPointer(), transformedPoints_RAS.GetPointer());
+    vtkIdType numberOfPoints = points_RAS->GetNumberOfPoints();
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
     {
-      for (point_IJK[0] = extent[0]; point_IJK[0] <= extent[1]; point_IJK[0]++)
-      {
-        ijkToRAS->MultiplyPoint(point_IJK, point_RAS);
-
-        inputTransform->TransformPoint(point_RAS, transformedPoint_RAS);
-
-        // store the pointDislocationVector_RAS components in the image
-        *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[0] - point_RAS[0]);
-        *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[1] - point_RAS[1]);
-        *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[2] - point_RAS[2]);
-      }
+      points_RAS->GetPoint(pointIndex, point_RAS);
+      double* transformedPoint_RAS = transformedPoints_RAS->GetPoint(pointIndex);
+      // store the pointDislocationVector_RAS components in the image
+      *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[0] - point_RAS[0]);
+      *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[1] - point_RAS[1]);
+      *(voxelPtr++) = static_cast<float>(transformedPoint_RAS[2] - point_RAS[2]);
     }
   }
 
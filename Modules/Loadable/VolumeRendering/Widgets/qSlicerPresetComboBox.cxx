@@ -140,6 +140,9 @@ qSlicerPresetComboBoxPrivate::qSlicerPresetComboBoxPrivate(
 void qSlicerPresetComboBoxPrivate::init()
 {
   Q_Q(qSlicerPresetComboBox);
+  // The scene model is not shared with other combo boxes, it has the icons
+  // of the presets.
+  q->rootModel()->setParent(q);
 
   q->setNodeTypes(QStringList("vtkMRMLVolumePropertyNode"));
   q->setSelectNodeUponCreation(false);
@@ -155,7 +158,7 @@ void qSlicerPresetComboBoxPrivate::init()
 
 // --------------------------------------------------------------------------
 qSlicerPresetComboBox::qSlicerPresetComboBox(QWidget* parentWidget)
-  : Superclass(parentWidget)
+  : Superclass(new qMRMLSceneModel, parentWidget)
   , d_ptr(new qSlicerPresetComboBoxPrivate(*this))
 {
   Q_D(qSlicerPresetComboBox);
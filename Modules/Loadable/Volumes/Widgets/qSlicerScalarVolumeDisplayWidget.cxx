@@ -11,6 +11,7 @@
 #include <ctkVTKHistogram.h>
 
 // MRML includes
+#include "vtkImageScalarHistogram.h"
 #include "vtkMRMLColorNode.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 #include "vtkMRMLScalarVolumeNode.h"
@@ -263,7 +264,17 @@ void qSlicerScalarVolumeDisplayWidget::updateHistogram()
     }
   else
     {
-    double* range = voxelValues->GetRange();
+    // Reuse the range computed along with the cached histogram
+    double range[2] = {0., 0.};
+    vtkImageScalarHistogram* histogram = vtkImageScalarHistogram::GetCachedHistogram(imageData);
+    if (histogram)
+      {
+      histogram->GetScalarRange(range);
+      }
+    else
+      {
+      voxelValues->GetRange(range);
+      }
     int binCount = static_cast<int>(range[1] - range[0] + 1);
     if (binCount > maxBinCount)
       {
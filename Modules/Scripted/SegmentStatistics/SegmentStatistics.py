@@ -415,6 +415,12 @@ class SegmentStatisticsLogic(ScriptedLoadableModuleLogic):
     if visibleSegmentIds.GetNumberOfValues() == 0:
       logging.debug("computeStatistics will not return any results: there are no visible segments")
 
+    # let plugins compute the measurements of all the segments at once
+    for plugin in self.plugins:
+      pluginName = plugin.__class__.__name__
+      if self.getParameterNode().GetParameter(pluginName+'.enabled')=='True':
+        plugin.prepareStatistics(visibleSegmentIds)
+
     # update statistics for all segment IDs
     for segmentIndex in range(visibleSegmentIds.GetNumberOfValues()):
       segmentID = visibleSegmentIds.GetValue(segmentIndex)
@@ -682,6 +688,20 @@ class SegmentStatisticsTest(ScriptedLoadableModuleTest):
     self.assertEqual( segStatLogic.getStatistics()["Test_2","LabelmapSegmentStatisticsPlugin.voxel_count"], 9807)
     self.assertEqual( segStatLogic.getStatistics()["Test_4","ScalarVolumeSegmentStatisticsPlugin.voxel_count"], 380)
 
+    self.delayDisplay("Check percentiles computed for all segments at once")
+    segStatLogic.getParameterNode().SetParameter("ScalarVolumeSegmentStatisticsPlugin.percentile_5.enabled",str(True))
+    segStatLogic.getParameterNode().SetParameter("ScalarVolumeSegmentStatisticsPlugin.percentile_95.enabled",str(True))
+    segStatLogic.computeStatistics()
+    statistics = segStatLogic.getStatistics()
+    for segmentID in statistics["SegmentIDs"]:
+      values = [statistics[segmentID,"ScalarVolumeSegmentStatisticsPlugin."+key]
+                for key in ["min", "percentile_5", "median", "percentile_95", "max"]]
+      self.assertEqual(values, sorted(values))
+    allSegmentsMean = statistics["Test_4","ScalarVolumeSegmentStatisticsPlugin.mean"]
+    segStatLogic.updateStatisticsForSegment('Test_4')
+    self.assertEqual( segStatLogic.getStatistics()["Test_4","ScalarVolumeSegmentStatisticsPlugin.voxel_count"], 380)
+    self.assertAlmostEqual( segStatLogic.getStatistics()["Test_4","ScalarVolumeSegmentStatisticsPlugin.mean"], allSegmentsMean)
+
     self.delayDisplay("Export results to table")
     resultsTableNode = slicer.vtkMRMLTableNode()
     slicer.mrmlScene.AddNode(resultsTableNode)
@@ -11,57 +11,58 @@ class LabelmapSegmentStatisticsPlugin(SegmentStatisticsPluginBase):
     self.keys = ["voxel_count", "volume_mm3", "volume_cm3"]
     self.defaultKeys = self.keys # calculate all measurements by default
     #... developer may add extra options to configure other parameters
+    self.calculator = None
+    self.preparedSegmentIDs = set()
 
-  def computeStatistics(self, segmentID):
+  def prepareStatistics(self, segmentIDs):
+    self.calculator = self.computeStatisticsForSegments(segmentIDs)
+    self.preparedSegmentIDs = set(segmentIDs.GetValue(i) for i in range(segmentIDs.GetNumberOfValues()))
+
+  def computeStatisticsForSegments(self, segmentIDs):
+    """Compute the measurements of several segments at once, return the calculator holding the results"""
     import vtkSegmentationCorePython as vtkSegmentationCore
-    requestedKeys = self.getRequestedKeys()
+    if len(self.getRequestedKeys())==0:
+      return None
 
     segmentationNode = slicer.mrmlScene.GetNodeByID(self.getParameterNode().GetParameter("Segmentation"))
-
-    if len(requestedKeys)==0:
-      return {}
-
     containsLabelmapRepresentation = segmentationNode.GetSegmentation().ContainsRepresentation(
       vtkSegmentationCore.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName())
     if not containsLabelmapRepresentation:
-      return {}
-
-    segment = segmentationNode.GetSegmentation().GetSegment(segmentID)
-    segBinaryLabelName = vtkSegmentationCore.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName()
-    segmentLabelmap = segment.GetRepresentation(segBinaryLabelName)
+      return None
 
-    # We need to know exactly the value of the segment voxels, apply threshold to make force the selected label value
-    labelValue = 1
-    backgroundValue = 0
-    thresh = vtk.vtkImageThreshold()
-    thresh.SetInputData(segmentLabelmap)
-    thresh.ThresholdByLower(0)
-    thresh.SetInValue(backgroundValue)
-    thresh.SetOutValue(labelValue)
-    thresh.SetOutputScalarType(vtk.VTK_UNSIGNED_CHAR)
-    thresh.Update()
+    # Voxels are counted in the geometry of each segment labelmap
+    calculator = slicer.vtkSegmentStatisticsCalculator()
+    calculator.SetSegmentationNode(segmentationNode)
+    if not calculator.Compute(segmentIDs):
+      return None
+    return calculator
 
-    #  Use binary labelmap as a stencil
-    stencil = vtk.vtkImageToImageStencil()
-    stencil.SetInputData(thresh.GetOutput())
-    stencil.ThresholdByUpper(labelValue)
-    stencil.Update()
+  def computeStatistics(self, segmentID):
+    requestedKeys = self.getRequestedKeys()
+    if len(requestedKeys)==0:
+      return {}
 
-    stat = vtk.vtkImageAccumulate()
-    stat.SetInputData(thresh.GetOutput())
-    stat.SetStencilData(stencil.GetOutput())
-    stat.Update()
+    # Use the results of prepareStatistics only once: the segment may be modified afterward
+    calculator = None
+    if segmentID in self.preparedSegmentIDs:
+      self.preparedSegmentIDs.remove(segmentID)
+      calculator = self.calculator
+    if calculator is None or not calculator.HasSegment(segmentID):
+      segmentIDs = vtk.vtkStringArray()
+      segmentIDs.InsertNextValue(segmentID)
+      calculator = self.computeStatisticsForSegments(segmentIDs)
+    if calculator is None or not calculator.HasSegment(segmentID):
+      return {}
 
     # Add data to statistics list
-    cubicMMPerVoxel = reduce(lambda x,y: x*y, segmentLabelmap.GetSpacing())
     ccPerCubicMM = 0.001
     stats = {}
     if "voxel_count" in requestedKeys:
-      stats["voxel_count"] = stat.GetVoxelCount()
+      stats["voxel_count"] = calculator.GetVoxelCount(segmentID)
     if "volume_mm3" in requestedKeys:
-      stats["volume_mm3"] = stat.GetVoxelCount() * cubicMMPerVoxel
+      stats["volume_mm3"] = calculator.GetVolumeMm3(segmentID)
     if "volume_cm3" in requestedKeys:
-      stats["volume_cm3"] = stat.GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM
+      stats["volume_cm3"] = calculator.GetVolumeMm3(segmentID) * ccPerCubicMM
     return stats
 
   def getMeasurementInfo(self, key):
@@ -8,101 +8,88 @@ class ScalarVolumeSegmentStatisticsPlugin(SegmentStatisticsPluginBase):
   def __init__(self):
     super(ScalarVolumeSegmentStatisticsPlugin,self).__init__()
     self.name = "Scalar Volume"
-    self.keys = ["voxel_count", "volume_mm3", "volume_cm3", "min", "max", "mean", "median", "stdev"]
-    self.defaultKeys = self.keys # calculate all measurements by default
+    self.keys = ["voxel_count", "volume_mm3", "volume_cm3", "min", "max", "mean", "median", "stdev",
+                 "percentile_5", "percentile_95"]
+    self.defaultKeys = ["voxel_count", "volume_mm3", "volume_cm3", "min", "max", "mean", "median", "stdev"]
     #... developer may add extra options to configure other parameters
+    self.percentiles = [("percentile_5", 5.0), ("percentile_95", 95.0)]
+    self.calculator = None
+    self.preparedSegmentIDs = set()
 
-  def computeStatistics(self, segmentID):
+  def prepareStatistics(self, segmentIDs):
+    self.calculator = self.computeStatisticsForSegments(segmentIDs)
+    self.preparedSegmentIDs = set(segmentIDs.GetValue(i) for i in range(segmentIDs.GetNumberOfValues()))
+
+  def computeStatisticsForSegments(self, segmentIDs):
+    """Compute the measurements of several segments at once, return the calculator holding the results"""
     import vtkSegmentationCorePython as vtkSegmentationCore
-    requestedKeys = self.getRequestedKeys()
+    if len(self.getRequestedKeys())==0:
+      return None
 
     segmentationNode = slicer.mrmlScene.GetNodeByID(self.getParameterNode().GetParameter("Segmentation"))
     grayscaleNode = slicer.mrmlScene.GetNodeByID(self.getParameterNode().GetParameter("ScalarVolume"))
 
-    if len(requestedKeys)==0:
-      return {}
-
     containsLabelmapRepresentation = segmentationNode.GetSegmentation().ContainsRepresentation(
       vtkSegmentationCore.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName())
     if not containsLabelmapRepresentation:
-      return {}
+      return None
 
     if grayscaleNode is None or grayscaleNode.GetImageData() is None:
-      return {}
+      return None
+
+    # Segments are resampled to the geometry of the grayscale volume, taking into account
+    # the transforms of the segmentation and the volume
+    calculator = slicer.vtkSegmentStatisticsCalculator()
+    calculator.SetSegmentationNode(segmentationNode)
+    calculator.SetScalarVolumeNode(grayscaleNode)
+    for key, percent in self.percentiles:
+      calculator.AddPercentile(percent)
+    if not calculator.Compute(segmentIDs):
+      return None
+    return calculator
 
-    # Get geometry of grayscale volume node as oriented image data
-    # reference geometry in reference node coordinate system
-    referenceGeometry_Reference = vtkSegmentationCore.vtkOrientedImageData()
-    referenceGeometry_Reference.SetExtent(grayscaleNode.GetImageData().GetExtent())
-    ijkToRasMatrix = vtk.vtkMatrix4x4()
-    grayscaleNode.GetIJKToRASMatrix(ijkToRasMatrix)
-    referenceGeometry_Reference.SetGeometryFromImageToWorldMatrix(ijkToRasMatrix)
+  def computeStatistics(self, segmentID):
+    requestedKeys = self.getRequestedKeys()
+    if len(requestedKeys)==0:
+      return {}
 
-    # Get transform between grayscale volume and segmentation
-    segmentationToReferenceGeometryTransform = vtk.vtkGeneralTransform()
-    slicer.vtkMRMLTransformNode.GetTransformBetweenNodes(segmentationNode.GetParentTransformNode(),
-      grayscaleNode.GetParentTransformNode(), segmentationToReferenceGeometryTransform)
+    # Use the results of prepareStatistics only once: the segment may be modified afterward
+    calculator = None
+    if segmentID in self.preparedSegmentIDs:
+      self.preparedSegmentIDs.remove(segmentID)
+      calculator = self.calculator
+    if calculator is None or not calculator.HasSegment(segmentID):
+      segmentIDs = vtk.vtkStringArray()
+      segmentIDs.InsertNextValue(segmentID)
+      calculator = self.computeStatisticsForSegments(segmentIDs)
+    if calculator is None or not calculator.HasSegment(segmentID):
+      return {}
 
-    cubicMMPerVoxel = reduce(lambda x,y: x*y, referenceGeometry_Reference.GetSpacing())
     ccPerCubicMM = 0.001
-
-    segment = segmentationNode.GetSegmentation().GetSegment(segmentID)
-    segBinaryLabelName = vtkSegmentationCore.vtkSegmentationConverter.GetSegmentationBinaryLabelmapRepresentationName()
-    segmentLabelmap = segment.GetRepresentation(segBinaryLabelName)
-
-    segmentLabelmap_Reference = vtkSegmentationCore.vtkOrientedImageData()
-    vtkSegmentationCore.vtkOrientedImageDataResample.ResampleOrientedImageToReferenceOrientedImage(
-      segmentLabelmap, referenceGeometry_Reference, segmentLabelmap_Reference,
-      False, # nearest neighbor interpolation
-      False, # no padding
-      segmentationToReferenceGeometryTransform)
-
-    # We need to know exactly the value of the segment voxels, apply threshold to make force the selected label value
-    labelValue = 1
-    backgroundValue = 0
-    thresh = vtk.vtkImageThreshold()
-    thresh.SetInputData(segmentLabelmap_Reference)
-    thresh.ThresholdByLower(0)
-    thresh.SetInValue(backgroundValue)
-    thresh.SetOutValue(labelValue)
-    thresh.SetOutputScalarType(vtk.VTK_UNSIGNED_CHAR)
-    thresh.Update()
-
-    #  Use binary labelmap as a stencil
-    stencil = vtk.vtkImageToImageStencil()
-    stencil.SetInputData(thresh.GetOutput())
-    stencil.ThresholdByUpper(labelValue)
-    stencil.Update()
-
-    stat = vtk.vtkImageAccumulate()
-    stat.SetInputData(grayscaleNode.GetImageData())
-    stat.SetStencilData(stencil.GetOutput())
-    stat.Update()
-
-    medians = vtk.vtkImageHistogramStatistics()
-    medians.SetInputData(grayscaleNode.GetImageData())
-    medians.SetStencilData(stencil.GetOutput())
-    medians.Update()
+    voxelCount = calculator.GetVoxelCount(segmentID)
 
     # create statistics list
     stats = {}
     if "voxel_count" in requestedKeys:
-      stats["voxel_count"] = stat.GetVoxelCount()
+      stats["voxel_count"] = voxelCount
     if "volume_mm3" in requestedKeys:
-      stats["volume_mm3"] = stat.GetVoxelCount() * cubicMMPerVoxel
+      stats["volume_mm3"] = calculator.GetVolumeMm3(segmentID)
     if "volume_cm3" in requestedKeys:
-      stats["volume_cm3"] = stat.GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM
-    if stat.GetVoxelCount()>0:
+      stats["volume_cm3"] = calculator.GetVolumeMm3(segmentID) * ccPerCubicMM
+    if voxelCount>0:
       if "min" in requestedKeys:
-        stats["min"] = stat.GetMin()[0]
+        stats["min"] = calculator.GetMinimum(segmentID)
       if "max" in requestedKeys:
-        stats["max"] = stat.GetMax()[0]
+        stats["max"] = calculator.GetMaximum(segmentID)
       if "mean" in requestedKeys:
-        stats["mean"] = stat.GetMean()[0]
+        stats["mean"] = calculator.GetMean(segmentID)
       if "stdev" in requestedKeys:
-        stats["stdev"] = stat.GetStandardDeviation()[0]
+        stats["stdev"] = calculator.GetStandardDeviation(segmentID)
       if "median" in requestedKeys:
-        stats["median"] = medians.GetMedian()
+        stats["median"] = calculator.GetMedian(segmentID)
+      for percentileIndex, (key, percent) in enumerate(self.percentiles):
+        if key in requestedKeys:
+          stats[key] = calculator.GetPercentile(segmentID, percentileIndex)
     return stats
 
   def getMeasurementInfo(self, key):
@@ -177,4 +164,18 @@ class ScalarVolumeSegmentStatisticsPlugin(SegmentStatisticsPluginBase):
                                    unitsDicomCode=scalarVolumeUnits.GetAsString(),
                                    derivationDicomCode=self.createCodedEntry('R-10047','SRT','Standard Deviation', True))
 
+    info["percentile_5"] = \
+      self.createMeasurementInfo(name="5th percentile", description="5th percentile of scalar values",
+                                   units=scalarVolumeUnits.GetCodeMeaning(),
+                                   quantityDicomCode=scalarVolumeQuantity.GetAsString(),
+                                   unitsDicomCode=scalarVolumeUnits.GetAsString(),
+                                   derivationDicomCode=self.createCodedEntry("percentile5","99QIICR","5th percentile", True))
+
+    info["percentile_95"] = \
+      self.createMeasurementInfo(name="95th percentile", description="95th percentile of scalar values",
+                                   units=scalarVolumeUnits.GetCodeMeaning(),
+                                   quantityDicomCode=scalarVolumeQuantity.GetAsString(),
+                                   unitsDicomCode=scalarVolumeUnits.GetAsString(),
+                                   derivationDicomCode=self.createCodedEntry("percentile95","99QIICR","95th percentile", True))
+
     return info[key] if key in info else None
@@ -55,6 +55,13 @@ class SegmentStatisticsPluginBase(object):
     """
     pass
 
+  def prepareStatistics(self, segmentIDs):
+    """Called with the IDs (vtkStringArray) of all the segments before computeStatistics
+    is called for each of them. Plugins that compute the measurements of all the segments
+    together may do it here and return the results from computeStatistics.
+    """
+    pass
+
   def getMeasurementInfo(self, key):
     """Get information (name, description, units, ...) about the measurement for the given key.
     Utilize createMeasurementInfo() to create the dictionary containing the measurement information.